@@ -267,6 +267,7 @@ static const char alarm_names[][10] = {
 	[SYSTEMALARMS_ALARM_GYROBIAS] = "GYROBIAS",
 	[SYSTEMALARMS_ALARM_ADC] = "ADC",
 	[SYSTEMALARMS_ALARM_GIMBAL] = "GIMBAL",
+	[SYSTEMALARMS_ALARM_LOOPTIMING] = "TIMING",
 };
 
 // If someone adds a new alarm, we'd like it added to the array above.
@@ -327,7 +328,7 @@ const char *AlarmBootReason(uint8_t reason) {
 	return (const char*)&boot_reason_names[reason];
 }
 
-int32_t AlarmString(SystemAlarmsData *alarm, char *buf, size_t buflen, bool blink, uint8_t *state) {
+int32_t AlarmString(const SystemAlarmsData *alarm, char *buf, size_t buflen, bool blink, uint8_t *state) {
 	*state = SYSTEMALARMS_ALARM_OK;
 	buf[0] = '\0';
 	int pos = 0;
@@ -0,0 +1,168 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ *
+ * @file       control_latency.c
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2016
+ * @brief      Receiver frame to output latency statistics
+ *
+ * ManualControl reports each receiver frame it turns into a
+ * ManualControlCommand, and Actuator reports each time it updates the
+ * outputs.  The time from the frame arriving to each of those is kept in a
+ * histogram per stage, whose percentiles are published in ControlLatency.
+ * Each histogram is only touched by the task reporting that stage.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "openpilot.h"
+#include "pios_thread.h"
+
+#include "control_latency.h"
+#include "misc_math.h"
+#include "timing_histogram.h"
+
+#include "controllatency.h"
+
+//! How often the percentiles are published
+#define PUBLISH_PERIOD_MS 1000
+
+struct latency_stage {
+	struct timing_histogram hist;
+	uint32_t last_publish;
+};
+
+static struct latency_stage *command_stage;
+static struct latency_stage *actuator_stage;
+static uint32_t frames;
+
+//! Frame time of the latest command not yet seen by Actuator
+static volatile uint32_t pending_frame;
+static volatile bool frame_pending;
+
+/**
+ * Set up the latency statistics.  Until this is called reports are ignored.
+ *
+ * @returns 0 on success, -1 on failure
+ */
+int32_t control_latency_initialize(void)
+{
+	if (command_stage) {
+		return 0;
+	}
+
+	if (ControlLatencyInitialize() == -1) {
+		return -1;
+	}
+
+	struct latency_stage *stages = PIOS_malloc(2 * sizeof(*stages));
+
+	if (!stages) {
+		return -1;
+	}
+
+	timing_histogram_clear(&stages[0].hist);
+	timing_histogram_clear(&stages[1].hist);
+	stages[0].last_publish = stages[1].last_publish = 0;
+
+	actuator_stage = &stages[1];
+	command_stage = &stages[0];
+
+	return 0;
+}
+
+//! Percentiles of a stage, if it is time to publish them
+static bool stage_update(struct latency_stage *stage, uint32_t latency_us,
+		uint16_t out[CONTROLLATENCY_FRAMETOCOMMAND_NUMELEM])
+{
+	timing_histogram_add(&stage->hist, latency_us);
+
+	uint32_t now = PIOS_Thread_Systime();
+
+	if (now - stage->last_publish < PUBLISH_PERIOD_MS) {
+		return false;
+	}
+
+	stage->last_publish = now;
+
+	const float fractions[] = { 0.5f, 0.9f, 0.99f };
+
+	for (int i = 0; i < NELEMENTS(fractions); i++) {
+		uint32_t val = timing_histogram_percentile(&stage->hist,
+				fractions[i]);
+
+		out[i] = MIN(val, UINT16_MAX);
+	}
+
+	out[NELEMENTS(fractions)] = MIN(stage->hist.max, UINT16_MAX);
+
+	return true;
+}
+
+/**
+ * Note that a ManualControlCommand has just been set from a receiver frame.
+ * Called from the ManualControl task.
+ *
+ * @param[in] frame_raw when the frame was received, from PIOS_DELAY_GetRaw()
+ */
+void control_latency_command(uint32_t frame_raw)
+{
+	if (!command_stage) {
+		return;
+	}
+
+	pending_frame = frame_raw;
+	frame_pending = true;
+
+	frames++;
+
+	uint16_t percentiles[CONTROLLATENCY_FRAMETOCOMMAND_NUMELEM];
+
+	if (stage_update(command_stage, PIOS_DELAY_DiffuS(frame_raw),
+				percentiles)) {
+		ControlLatencyFrameToCommandSet(percentiles);
+		ControlLatencyFramesSet(&frames);
+	}
+}
+
+/**
+ * Note that ActuatorCommand has just been updated.  Called from the
+ * Actuator task; only the first update after each command is counted.
+ */
+void control_latency_actuator(void)
+{
+	if (!actuator_stage || !frame_pending) {
+		return;
+	}
+
+	/* A newer frame may land in between, its time is just as good */
+	frame_pending = false;
+	uint32_t frame_raw = pending_frame;
+
+	uint16_t percentiles[CONTROLLATENCY_FRAMETOACTUATOR_NUMELEM];
+
+	if (stage_update(actuator_stage, PIOS_DELAY_DiffuS(frame_raw),
+				percentiles)) {
+		ControlLatencyFrameToActuatorSet(percentiles);
+	}
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,186 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ *
+ * @file       imu_increments.c
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @brief      Hands accumulated IMU increments from the sensors to the INS
+ *
+ * The sensors stage adds every gyro/accel sample.  Once the samples span the
+ * period the consumer asked for, the coning and sculling corrected increments
+ * are queued for it and a new interval begins.  If the consumer is behind and
+ * the queue is full, the interval keeps growing so that short stalls lose
+ * nothing; once it spans MAX_INTERVAL with nobody taking it (e.g. when the
+ * INS isn't running) it is thrown away and a new one begins.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "openpilot.h"
+#include "pios_queue.h"
+
+#include "imu_increments.h"
+
+//! Intervals which nobody picked up for this long are dropped, s
+#define MAX_INTERVAL 0.05f
+
+#define QUEUE_LEN 2
+
+//! Owned by the sensors stage
+static struct preintegration *accum;
+
+static struct pios_queue *queue;
+
+//! Interval the consumer wants, s; 0 for every sample
+static volatile float period;
+
+//! Whether a consumer is taking the increments
+static volatile bool active;
+
+//! Set by the consumer to drop what was summed before it (re)started
+static volatile bool restart;
+
+/**
+ * Set up the handoff.  Until this is called samples are ignored.  Safe to
+ * call from both the producer and the consumer.
+ *
+ * @returns 0 on success, -1 on failure
+ */
+int32_t imu_increments_initialize(void)
+{
+	if (queue) {
+		return 0;
+	}
+
+	struct preintegration *p = PIOS_malloc(sizeof(*p));
+
+	if (!p) {
+		return -1;
+	}
+
+	struct pios_queue *q = PIOS_Queue_Create(QUEUE_LEN,
+			sizeof(struct imu_increment));
+
+	if (!q) {
+		PIOS_free(p);
+		return -1;
+	}
+
+	preintegration_init(p);
+	accum = p;
+	queue = q;
+
+	return 0;
+}
+
+/**
+ * Add a sample.  Only to be called from the sensors stage.
+ *
+ * @param[in] gyro body rates, rad/s
+ * @param[in] accel specific force, m/s^2
+ * @param[in] dt time since the previous sample, s
+ */
+void imu_increments_add(const float gyro[3], const float accel[3], float dt)
+{
+	if (!queue) {
+		return;
+	}
+
+	if (restart) {
+		restart = false;
+		preintegration_restart(accum);
+	}
+
+	preintegration_add(accum, gyro, accel, dt);
+
+	if (accum->dt < period) {
+		return;
+	}
+
+	struct imu_increment inc;
+	preintegration_get(accum, &inc);
+
+	if (PIOS_Queue_Send(queue, &inc, 0) || accum->dt > MAX_INTERVAL) {
+		preintegration_restart(accum);
+	}
+}
+
+/**
+ * Choose how much time each increment should span.  Samples are not split,
+ * so intervals come out as a whole number of sample periods.
+ *
+ * @param[in] new_period interval in seconds, 0 for every sample
+ */
+void imu_increments_set_period(float new_period)
+{
+	period = new_period;
+}
+
+/**
+ * Say whether anything is taking the increments.  While nothing is the
+ * sensors stage needn't add its samples.
+ *
+ * @param[in] new_active true if a consumer is receiving increments
+ */
+void imu_increments_set_active(bool new_active)
+{
+	if (new_active && !active) {
+		restart = true;
+	}
+
+	active = new_active;
+}
+
+/**
+ * @returns true if a consumer is taking the increments
+ */
+bool imu_increments_active(void)
+{
+	return active;
+}
+
+/**
+ * Wait for the next increment.
+ *
+ * @param[out] inc the increments over the interval
+ * @param[in] timeout_ms how long to wait
+ * @returns true if an increment was received
+ */
+bool imu_increments_receive(struct imu_increment *inc, uint32_t timeout_ms)
+{
+	if (!queue) {
+		return false;
+	}
+
+	return PIOS_Queue_Receive(queue, inc, timeout_ms);
+}
+
+/**
+ * Throw away the queued increments, e.g. when (re)starting a filter.
+ */
+void imu_increments_flush(void)
+{
+	struct imu_increment inc;
+
+	while (imu_increments_receive(&inc, 0));
+}
+
+/**
+ * @}
+ */
@@ -50,7 +50,7 @@ int32_t AlarmsHasCritical();
  * (e.g., SYSTEMALARMS_ALARM_WARNING).
  * @returns The number of bytes written to the buffer.
  */
-int32_t AlarmString(SystemAlarmsData *alarm, char *buf, size_t buflen,
+int32_t AlarmString(const SystemAlarmsData *alarm, char *buf, size_t buflen,
 		    bool blink, uint8_t *state);
 const char *AlarmBootReason(uint8_t reason);
 
@@ -0,0 +1,41 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ *
+ * @file       control_latency.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2016
+ * @brief      Receiver frame to output latency statistics
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef CONTROL_LATENCY_H
+#define CONTROL_LATENCY_H
+
+#include <stdint.h>
+
+int32_t control_latency_initialize(void);
+void control_latency_command(uint32_t frame_raw);
+void control_latency_actuator(void);
+
+#endif /* CONTROL_LATENCY_H */
+
+/**
+ * @}
+ */
@@ -0,0 +1,48 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ *
+ * @file       imu_increments.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @brief      Hands accumulated IMU increments from the sensors to the INS
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef IMU_INCREMENTS_H
+#define IMU_INCREMENTS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "preintegration.h"
+
+int32_t imu_increments_initialize(void);
+void imu_increments_add(const float gyro[3], const float accel[3], float dt);
+void imu_increments_set_period(float period);
+void imu_increments_set_active(bool active);
+bool imu_increments_active(void);
+bool imu_increments_receive(struct imu_increment *inc, uint32_t timeout_ms);
+void imu_increments_flush(void);
+
+#endif /* IMU_INCREMENTS_H */
+
+/**
+ * @}
+ */
@@ -0,0 +1,51 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ *
+ * @file       loop_timing.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @brief      Period and execution time statistics of the control loops
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef LOOP_TIMING_H
+#define LOOP_TIMING_H
+
+#include <stdint.h>
+
+//! The loops measured; each must only be reported from one task
+enum loop_timing_loop {
+	LOOP_TIMING_SENSORS,
+	LOOP_TIMING_STABILIZATION,
+	LOOP_TIMING_ATTITUDE,
+	LOOP_TIMING_ACTUATOR,
+	LOOP_TIMING_NUM
+};
+
+int32_t loop_timing_initialize(void);
+void loop_timing_begin(enum loop_timing_loop loop);
+void loop_timing_end(enum loop_timing_loop loop);
+void loop_timing_output(void);
+
+#endif /* LOOP_TIMING_H */
+
+/**
+ * @}
+ */
@@ -0,0 +1,75 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ *
+ * @file       polyfence.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @brief      Polygon geofence zones with a spatial index
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef POLYFENCE_H
+#define POLYFENCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define POLYFENCE_MAX_ZONES 32
+
+enum polyfence_zone_type {
+	POLYFENCE_DISABLED,
+	POLYFENCE_KEEP_IN,	//!< Must stay inside one of these, if any are defined
+	POLYFENCE_KEEP_OUT,	//!< Must not enter any of these
+};
+
+struct polyfence_zone {
+	uint8_t type;			//!< enum polyfence_zone_type
+	float floor;			//!< Lowest altitude the zone applies at, m
+	float ceiling;			//!< Highest altitude the zone applies at, m
+	uint16_t first_vertex;		//!< Vertices are north, east pairs in m
+	uint16_t num_vertices;
+};
+
+struct polyfence_result {
+	bool breached;		//!< Outside every keep-in or inside a keep-out
+	float margin;		//!< Distance to the nearest boundary, m
+	int8_t zone;		//!< Zone of the nearest boundary, -1 if none
+};
+
+struct polyfence;
+
+size_t polyfence_size(const struct polyfence_zone *zones, uint8_t num_zones,
+		const float (*vertices)[2], uint16_t num_vertices);
+uint8_t polyfence_rejected_zones(const struct polyfence_zone *zones,
+		uint8_t num_zones, uint16_t num_vertices);
+struct polyfence *polyfence_build(void *mem, size_t len,
+		const struct polyfence_zone *zones, uint8_t num_zones,
+		const float (*vertices)[2], uint16_t num_vertices);
+void polyfence_check(const struct polyfence *fence, const float pos[3],
+		struct polyfence_result *result);
+bool polyfence_predict(const struct polyfence *fence, const float pos[3],
+		const float vel[3], float horizon, float *time_to_breach);
+
+#endif /* POLYFENCE_H */
+
+/**
+ * @}
+ */
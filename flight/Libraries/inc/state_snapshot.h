@@ -0,0 +1,119 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ *
+ * @file       state_snapshot.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @brief      Shared snapshot of the flight state, for the telemetry bridges
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef STATE_SNAPSHOT_H
+#define STATE_SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "accels.h"
+#include "actuatordesired.h"
+#include "airspeedactual.h"
+#include "attitudeactual.h"
+#include "baroaltitude.h"
+#include "flightbatterystate.h"
+#include "flightstatus.h"
+#include "gpsposition.h"
+#include "gpstime.h"
+#include "gpsvelocity.h"
+#include "gyros.h"
+#include "homelocation.h"
+#include "manualcontrolcommand.h"
+#include "positionactual.h"
+#include "stabilizationdesired.h"
+#include "systemalarms.h"
+#include "systemstats.h"
+#include "velocityactual.h"
+
+//! The objects in a snapshot, as bits of its present mask
+enum state_snapshot_object {
+	STATE_SNAPSHOT_ACCELS,
+	STATE_SNAPSHOT_ACTUATORDESIRED,
+	STATE_SNAPSHOT_AIRSPEEDACTUAL,
+	STATE_SNAPSHOT_ATTITUDEACTUAL,
+	STATE_SNAPSHOT_BAROALTITUDE,
+	STATE_SNAPSHOT_FLIGHTBATTERYSTATE,
+	STATE_SNAPSHOT_FLIGHTSTATUS,
+	STATE_SNAPSHOT_GPSPOSITION,
+	STATE_SNAPSHOT_GPSTIME,
+	STATE_SNAPSHOT_GPSVELOCITY,
+	STATE_SNAPSHOT_GYROS,
+	STATE_SNAPSHOT_HOMELOCATION,
+	STATE_SNAPSHOT_MANUALCONTROLCOMMAND,
+	STATE_SNAPSHOT_POSITIONACTUAL,
+	STATE_SNAPSHOT_STABILIZATIONDESIRED,
+	STATE_SNAPSHOT_SYSTEMALARMS,
+	STATE_SNAPSHOT_SYSTEMSTATS,
+	STATE_SNAPSHOT_VELOCITYACTUAL,
+	STATE_SNAPSHOT_NUM
+};
+
+/**
+ * The objects the bridges and OSDs export, all read in one pass.  Objects
+ * that don't exist on this board are left zeroed, with their bit clear in
+ * present.
+ */
+struct state_snapshot {
+	uint32_t version;	//!< Counts up by one with each snapshot taken
+	uint32_t time;		//!< When it was taken, ms
+	uint32_t present;	//!< Bits of state_snapshot_object
+
+	AccelsData accels;
+	ActuatorDesiredData actuator_desired;
+	AirspeedActualData airspeed;
+	AttitudeActualData attitude;
+	BaroAltitudeData baro;
+	FlightBatteryStateData battery;
+	FlightStatusData flight_status;
+	GPSPositionData gps_position;
+	GPSTimeData gps_time;
+	GPSVelocityData gps_velocity;
+	GyrosData gyros;
+	HomeLocationData home;
+	ManualControlCommandData manual_control;
+	PositionActualData position;
+	StabilizationDesiredData stab_desired;
+	SystemAlarmsData alarms;
+	SystemStatsData stats;
+	VelocityActualData velocity;
+};
+
+int32_t state_snapshot_initialize(uint16_t period_ms);
+bool state_snapshot_get(struct state_snapshot *snapshot);
+
+static inline bool state_snapshot_has(const struct state_snapshot *snapshot,
+		enum state_snapshot_object object)
+{
+	return snapshot->present & (1 << object);
+}
+
+#endif /* STATE_SNAPSHOT_H */
+
+/**
+ * @}
+ */
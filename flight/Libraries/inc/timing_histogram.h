@@ -0,0 +1,64 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ *
+ * @file       timing_histogram.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2016
+ * @brief      Compact histogram of durations, for percentile statistics
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef TIMING_HISTOGRAM_H
+#define TIMING_HISTOGRAM_H
+
+#include <stdint.h>
+
+//! Bins per doubling of the duration; each bin is 1/8th of an octave wide
+#define TIMING_HISTOGRAM_SUB_BITS  3
+#define TIMING_HISTOGRAM_SUB_BINS  (1 << TIMING_HISTOGRAM_SUB_BITS)
+//! Durations of 2^17 us (131 ms) and more all land in the last bin
+#define TIMING_HISTOGRAM_MAX_BITS  17
+#define TIMING_HISTOGRAM_BINS \
+	((TIMING_HISTOGRAM_MAX_BITS - TIMING_HISTOGRAM_SUB_BITS - 2) * \
+	 TIMING_HISTOGRAM_SUB_BINS)
+
+/**
+ * Log-linear histogram of durations in microseconds. Durations under 64us
+ * are binned linearly, 8us at a time, and from there on the bins grow with
+ * the duration so that each is within 1/8th of its value. When a bin fills
+ * up every bin is halved, so old samples fade rather than the counts
+ * wrapping.
+ */
+struct timing_histogram {
+	uint32_t count;
+	uint32_t max;
+	uint16_t bins[TIMING_HISTOGRAM_BINS];
+};
+
+void timing_histogram_clear(struct timing_histogram *h);
+void timing_histogram_add(struct timing_histogram *h, uint32_t duration_us);
+uint32_t timing_histogram_percentile(const struct timing_histogram *h,
+		float fraction);
+
+#endif /* TIMING_HISTOGRAM_H */
+
+/**
+ * @}
+ */
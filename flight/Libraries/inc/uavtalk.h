@@ -52,6 +52,24 @@ typedef struct {
 
 typedef void* UAVTalkConnection;
 
+//! Most file data carried by one packet
+#define UAVTALK_MAX_FILEDATA_LENGTH 100
+
+//! File holding every object instance, read by the GCS when it connects
+#define UAVTALK_STATE_FILE_ID 0x101
+//! The state file without settings objects
+#define UAVTALK_DYNAMIC_STATE_FILE_ID 0x103
+//! Each settings instance's CRC in place of its data, then a record for
+//! object 0 holding UAVObjGetSettingsCRC()
+#define UAVTALK_SETTINGS_CRC_FILE_ID 0x102
+
+//! Each instance in the state file is this header, then its packed data
+struct uavtalk_state_record {
+	uint32_t obj_id;
+	uint16_t inst_id;
+	uint16_t length;
+} __attribute__((packed));
+
 typedef enum {UAVTALK_STATE_ERROR = 0, UAVTALK_STATE_SYNC, UAVTALK_STATE_TYPE, UAVTALK_STATE_SIZE, UAVTALK_STATE_OBJID, UAVTALK_STATE_INSTID,
 	      UAVTALK_STATE_DATA, UAVTALK_STATE_CS, UAVTALK_STATE_COMPLETE} UAVTalkRxState;
 
@@ -60,9 +78,13 @@ UAVTalkConnection UAVTalkInitialize(void *ctx, UAVTalkOutputCb outputStream, UAV
 int32_t UAVTalkSendObject(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, uint8_t acked);
 int32_t UAVTalkSendObjectTimestamped(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId);
 int32_t UAVTalkSendNack(UAVTalkConnection connectionHandle, uint32_t objId, uint16_t instId);
-void UAVTalkProcessInputStream(UAVTalkConnection connectionHandle, uint8_t *rxbytes,
+int32_t UAVTalkSendFileData(UAVTalkConnection connectionHandle, uint32_t file_id,
+		uint32_t offset, uint8_t flags, const uint8_t *data, uint16_t length);
+void UAVTalkProcessInputStream(UAVTalkConnection connectionHandle, const uint8_t *rxbytes,
 		int numbytes);
 UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connection, uint8_t rxbyte);
+int32_t UAVTalkProcessInputBlock(UAVTalkConnection connectionHandle, const uint8_t *rxbytes,
+		int32_t numbytes, UAVTalkRxState *state);
 int32_t UAVTalkRelayPacket(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle);
 int32_t UAVTalkReceiveObject(UAVTalkConnection connectionHandle);
 void UAVTalkGetStats(UAVTalkConnection connection, UAVTalkStats *stats);
@@ -93,6 +93,8 @@ typedef struct {
 	UAVTalkStats stats;
 	UAVTalkInputProcessor iproc;
 	uint8_t *rxBuffer;
+	const uint8_t *rxData;  /**< Payload of the current packet, in rxBuffer or where it was received */
+	const uint8_t *rxFrame; /**< The whole current packet, if it was parsed where it was received */
 	uint32_t txSize;
 	uint8_t *txBuffer;
 
@@ -59,13 +59,18 @@ void LinearizeFG(float X[NUMX], float U[NUMU], float F[NUMX][NUMX],
 void MeasurementEq(float X[NUMX], float Be[3], float Y[NUMV]);
 void LinearizeH(float X[NUMX], float Be[3], float H[NUMV][NUMX]);
 
-// Private variables
-float F[NUMX][NUMX], G[NUMX][NUMW], H[NUMV][NUMX];	// linearized system matrices
+// Private variables.  Host builds that run a filter per thread (e.g. the
+// python module) define INSGPS_STATE as __thread.
+#ifndef INSGPS_STATE
+#define INSGPS_STATE
+#endif
+
+INSGPS_STATE float F[NUMX][NUMX], G[NUMX][NUMW], H[NUMV][NUMX];	// linearized system matrices
 													// global to init to zero and maintain zero elements
-float Be[3];			// local magnetic unit vector in NED frame
-float P[NUMX][NUMX], X[NUMX];	// covariance matrix and state vector
-float Q[NUMW], R[NUMV];		// input noise and measurement noise variances
-float K[NUMX][NUMV];		// feedback gain matrix
+INSGPS_STATE float Be[3];			// local magnetic unit vector in NED frame
+INSGPS_STATE float P[NUMX][NUMX], X[NUMX];	// covariance matrix and state vector
+INSGPS_STATE float Q[NUMW], R[NUMV];		// input noise and measurement noise variances
+INSGPS_STATE float K[NUMX][NUMV];		// feedback gain matrix
 
 //  *************  Exposed Functions ****************
 //  *************************************************
@@ -0,0 +1,253 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ *
+ * @file       loop_timing.c
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @brief      Period and execution time statistics of the control loops
+ *
+ * Each loop reports when an iteration begins, once it has its input, and
+ * when it ends.  The time between beginnings and the time from beginning
+ * to end are kept in histograms, whose percentiles are published in
+ * LoopTiming.  The beginning of the sensors loop is when a gyro sample
+ * arrives; the time from then to the first output update after it is kept
+ * as well.
+ *
+ * Jitter is the P99 period less the median one.  When it exceeds the bound
+ * in LoopTimingSettings for any loop the LoopTiming alarm is raised.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "openpilot.h"
+#include "pios_thread.h"
+
+#include "loop_timing.h"
+#include "misc_math.h"
+#include "timing_histogram.h"
+
+#include "looptiming.h"
+#include "looptimingsettings.h"
+
+//! How often the percentiles are published
+#define PUBLISH_PERIOD_MS 1000
+
+struct loop_stage {
+	struct timing_histogram period;
+	struct timing_histogram execution;
+	uint32_t begin_raw;
+	uint32_t last_publish;
+	bool started;		/* begin_raw is valid, for the period */
+	bool running;		/* begun and not yet ended */
+	bool jitter_high;
+};
+
+struct loop_fields {
+	void (*period_set)(uint16_t *);
+	void (*execution_set)(uint16_t *);
+};
+
+static const struct loop_fields fields[LOOP_TIMING_NUM] = {
+	[LOOP_TIMING_SENSORS] = {
+		LoopTimingSensorsPeriodSet, LoopTimingSensorsExecutionSet },
+	[LOOP_TIMING_STABILIZATION] = {
+		LoopTimingStabilizationPeriodSet,
+		LoopTimingStabilizationExecutionSet },
+	[LOOP_TIMING_ATTITUDE] = {
+		LoopTimingAttitudePeriodSet, LoopTimingAttitudeExecutionSet },
+	[LOOP_TIMING_ACTUATOR] = {
+		LoopTimingActuatorPeriodSet, LoopTimingActuatorExecutionSet },
+};
+
+DONT_BUILD_IF(LOOPTIMINGSETTINGS_MAXJITTER_NUMELEM != LOOP_TIMING_NUM,
+		LoopTimingSettingsElements);
+
+static struct loop_stage *stages;
+static struct timing_histogram *output_hist;
+
+//! Arrival time of the latest gyro sample not yet output
+static volatile uint32_t pending_sample;
+static volatile bool sample_pending;
+
+/**
+ * Set up the loop statistics.  Until this is called reports are ignored.
+ * Safe to call from each module that reports.
+ *
+ * @returns 0 on success, -1 on failure
+ */
+int32_t loop_timing_initialize(void)
+{
+	if (stages) {
+		return 0;
+	}
+
+	if (LoopTimingInitialize() == -1 ||
+			LoopTimingSettingsInitialize() == -1) {
+		return -1;
+	}
+
+	struct timing_histogram *hist = PIOS_malloc(sizeof(*hist));
+	struct loop_stage *s = PIOS_malloc(LOOP_TIMING_NUM * sizeof(*s));
+
+	if (!hist || !s) {
+		return -1;
+	}
+
+	timing_histogram_clear(hist);
+	memset(s, 0, LOOP_TIMING_NUM * sizeof(*s));
+
+	output_hist = hist;
+	stages = s;
+
+	AlarmsClear(SYSTEMALARMS_ALARM_LOOPTIMING);
+
+	return 0;
+}
+
+//! P50, P99 and maximum of a histogram
+static void percentiles(const struct timing_histogram *hist, uint16_t *out)
+{
+	out[0] = MIN(timing_histogram_percentile(hist, 0.5f), UINT16_MAX);
+	out[1] = MIN(timing_histogram_percentile(hist, 0.99f), UINT16_MAX);
+	out[2] = MIN(hist->max, UINT16_MAX);
+}
+
+static void publish(enum loop_timing_loop loop, struct loop_stage *stage)
+{
+	uint16_t period[LOOPTIMING_SENSORSPERIOD_NUMELEM];
+	uint16_t execution[LOOPTIMING_SENSORSEXECUTION_NUMELEM];
+
+	percentiles(&stage->period, period);
+	percentiles(&stage->execution, execution);
+
+	uint16_t jitter = period[LOOPTIMING_SENSORSPERIOD_P99] -
+		period[LOOPTIMING_SENSORSPERIOD_P50];
+	period[LOOPTIMING_SENSORSPERIOD_JITTER] = jitter;
+
+	fields[loop].period_set(period);
+	fields[loop].execution_set(execution);
+
+	if (loop == LOOP_TIMING_ACTUATOR) {
+		uint16_t output[LOOPTIMING_SENSORTOOUTPUT_NUMELEM];
+
+		percentiles(output_hist, output);
+		LoopTimingSensorToOutputSet(output);
+	}
+
+	uint16_t max_jitter[LOOPTIMINGSETTINGS_MAXJITTER_NUMELEM];
+	LoopTimingSettingsMaxJitterGet(max_jitter);
+
+	/* Only this task writes its flag; the others are just read */
+	stage->jitter_high = max_jitter[loop] && (jitter > max_jitter[loop]);
+
+	bool alarm = false;
+
+	for (int i = 0; i < LOOP_TIMING_NUM; i++) {
+		alarm = alarm || stages[i].jitter_high;
+	}
+
+	if (alarm) {
+		AlarmsSet(SYSTEMALARMS_ALARM_LOOPTIMING,
+				SYSTEMALARMS_ALARM_WARNING);
+	} else {
+		AlarmsClear(SYSTEMALARMS_ALARM_LOOPTIMING);
+	}
+}
+
+/**
+ * Note that an iteration of a loop begins, once its input is available.
+ *
+ * @param[in] loop which loop
+ */
+void loop_timing_begin(enum loop_timing_loop loop)
+{
+	if (!stages) {
+		return;
+	}
+
+	struct loop_stage *stage = &stages[loop];
+	uint32_t now = PIOS_DELAY_GetRaw();
+
+	if (stage->started) {
+		timing_histogram_add(&stage->period,
+				PIOS_DELAY_DiffuS2(stage->begin_raw, now));
+	}
+
+	stage->begin_raw = now;
+	stage->started = true;
+	stage->running = true;
+
+	if (loop == LOOP_TIMING_SENSORS) {
+		pending_sample = now;
+		sample_pending = true;
+	}
+}
+
+/**
+ * Note that an iteration of a loop is complete, and publish the statistics
+ * of the loop if it is time to.  Ignored unless the iteration began.
+ *
+ * @param[in] loop which loop
+ */
+void loop_timing_end(enum loop_timing_loop loop)
+{
+	if (!stages) {
+		return;
+	}
+
+	struct loop_stage *stage = &stages[loop];
+
+	if (!stage->running) {
+		return;
+	}
+
+	stage->running = false;
+
+	timing_histogram_add(&stage->execution,
+			PIOS_DELAY_DiffuS(stage->begin_raw));
+
+	uint32_t now = PIOS_Thread_Systime();
+
+	if (now - stage->last_publish >= PUBLISH_PERIOD_MS) {
+		stage->last_publish = now;
+
+		publish(loop, stage);
+	}
+}
+
+/**
+ * Note that the outputs have just been updated.  Called from the Actuator
+ * task; only the first update after each gyro sample is counted.
+ */
+void loop_timing_output(void)
+{
+	if (!output_hist || !sample_pending) {
+		return;
+	}
+
+	/* A newer sample may land in between, its time is just as good */
+	sample_pending = false;
+	uint32_t sample_raw = pending_sample;
+
+	timing_histogram_add(output_hist, PIOS_DELAY_DiffuS(sample_raw));
+}
+
+/**
+ * @}
+ */
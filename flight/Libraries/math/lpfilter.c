@@ -92,9 +92,11 @@ void lpfilter_construct_single_biquad(struct lpfilter_biquad *b, float cutoff, f
 	b->a1 = 2.0f * (f*f - 1.0f) * b->b0;
 	b->a2 = -(1.0f - q*f + f*f) * b->b0;
 
-	b->s = PIOS_malloc_no_dma(sizeof(struct lpfilter_biquad_state)*width);
-	if(!b->s)
-		PIOS_Assert(0);
+	if(!b->s) {
+		b->s = PIOS_malloc_no_dma(sizeof(struct lpfilter_biquad_state)*width);
+		if(!b->s)
+			PIOS_Assert(0);
+	}
 
 	memset((void*)b->s, 0, sizeof(struct lpfilter_biquad_state)*width);
 }
@@ -120,11 +122,32 @@ void lpfilter_construct_biquads(lpfilter_state_t filt, float cutoff, float dT, i
 			filt->biquad[i] = PIOS_malloc_no_dma(sizeof(struct lpfilter_biquad));
 			if(!filt->biquad[i])
 				PIOS_Assert(0);
+			memset(filt->biquad[i], 0, sizeof(struct lpfilter_biquad));
 		}
 		lpfilter_construct_single_biquad(filt->biquad[i], cutoff, dT, lpfilter_butterworth_factors[addr+i], width);
 	}
 }
 
+/* Frees everything sized by the filter width */
+static void lpfilter_free_stages(lpfilter_state_t filt)
+{
+	if(filt->first_order) {
+		PIOS_free(filt->first_order->prev);
+		PIOS_free(filt->first_order);
+		filt->first_order = NULL;
+	}
+
+	for(int i = 0; i < 4; i++) {
+		if(filt->biquad[i]) {
+			PIOS_free(filt->biquad[i]->s);
+			PIOS_free(filt->biquad[i]);
+			filt->biquad[i] = NULL;
+		}
+	}
+
+	filt->width = 0;
+}
+
 void lpfilter_create(lpfilter_state_t *filter_ptr, float cutoff, float dT, uint8_t order, uint8_t width)
 {
 	if(!filter_ptr) {
@@ -141,12 +164,15 @@ void lpfilter_create(lpfilter_state_t *filter_ptr, float cutoff, float dT, uint8
 
 	lpfilter_state_t filter = *filter_ptr;
 
-	if((filter->width != 0 && filter->width != width) || (width > MAX_FILTER_WIDTH)) {
-		// We can't free memory, so if some caller keeps tossing varying
-		// filter widths while updating an already allocated filter, go fail.
+	if(width > MAX_FILTER_WIDTH) {
 		PIOS_Assert(0);
 	}
 
+	if(filter->width != 0 && filter->width != width) {
+		// The stages were sized for another width, start over.
+		lpfilter_free_stages(filter);
+	}
+
 	// Clamp order count. If zero, this bypasses the filter.
 	if(order == 0) {
 		filter->order = 0;
@@ -0,0 +1,138 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ * @addtogroup FlightMath Filtering support libraries
+ * @{
+ *
+ * @file       preintegration.c
+ * @author     dRonin, http://dronin.org, Copyright (C) 2017
+ * @brief      Delta angle and delta velocity accumulation of IMU samples
+ *
+ * Sums gyro and accel samples over an interval so that a filter can be
+ * propagated once per interval instead of once per sample.  Plain sums lose
+ * the effect of rotation during the interval, so the sums are corrected for
+ * coning (the rotation axis moving) and sculling (rotation while
+ * accelerating), using the two sample algorithms from Savage, "Strapdown
+ * Inertial Navigation Integration Algorithm Design", JGCD 1998.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "coordinate_conversions.h"
+#include "preintegration.h"
+
+/**
+ * Start from nothing, forgetting the previous samples
+ * @param[out] p the accumulator
+ */
+void preintegration_init(struct preintegration *p)
+{
+	memset(p, 0, sizeof(*p));
+}
+
+/**
+ * Start a new interval.  The last sample is remembered, as the corrections
+ * for the first sample of the next interval use it.
+ * @param[in,out] p the accumulator
+ */
+void preintegration_restart(struct preintegration *p)
+{
+	for (int i = 0; i < 3; i++) {
+		p->alpha[i] = 0;
+		p->beta[i] = 0;
+		p->nu[i] = 0;
+		p->sculling[i] = 0;
+	}
+
+	p->dt = 0;
+	p->samples = 0;
+}
+
+/**
+ * Add a sample to the interval
+ * @param[in,out] p the accumulator
+ * @param[in] gyro body rates, rad/s
+ * @param[in] accel specific force, m/s^2
+ * @param[in] dt time the sample stands for, s
+ */
+void preintegration_add(struct preintegration *p, const float gyro[3],
+		const float accel[3], float dt)
+{
+	float d_alpha[3], d_nu[3];
+	float a[3], v[3];
+
+	for (int i = 0; i < 3; i++) {
+		d_alpha[i] = gyro[i] * dt;
+		d_nu[i] = accel[i] * dt;
+
+		a[i] = p->alpha[i] + p->last_alpha[i] * (1.0f / 6.0f);
+		v[i] = p->nu[i] + p->last_nu[i] * (1.0f / 6.0f);
+	}
+
+	float coning[3], scul_a[3], scul_b[3];
+
+	CrossProduct(a, d_alpha, coning);
+	CrossProduct(a, d_nu, scul_a);
+	CrossProduct(v, d_alpha, scul_b);
+
+	for (int i = 0; i < 3; i++) {
+		p->beta[i] += 0.5f * coning[i];
+		p->sculling[i] += 0.5f * (scul_a[i] + scul_b[i]);
+
+		p->alpha[i] += d_alpha[i];
+		p->nu[i] += d_nu[i];
+
+		p->last_alpha[i] = d_alpha[i];
+		p->last_nu[i] = d_nu[i];
+	}
+
+	p->dt += dt;
+	p->samples++;
+}
+
+/**
+ * Get the corrected increments of the interval so far.
+ *
+ * The velocity increment is what a constant specific force, applied in the
+ * body frame as it rotates through the interval, would have to be to give
+ * the same result; that is what a filter which holds its inputs over the
+ * step expects.  Add 0.5 * delta_angle x delta_velocity to express it in the
+ * body frame at the start of the interval instead.
+ *
+ * @param[in] p the accumulator
+ * @param[out] inc the increments
+ */
+void preintegration_get(const struct preintegration *p,
+		struct imu_increment *inc)
+{
+	for (int i = 0; i < 3; i++) {
+		inc->delta_angle[i] = p->alpha[i] + p->beta[i];
+		inc->delta_velocity[i] = p->nu[i] + p->sculling[i];
+	}
+
+	inc->dt = p->dt;
+	inc->samples = p->samples;
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,66 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ * @addtogroup FlightMath Filtering support libraries
+ * @{
+ *
+ * @file       preintegration.h
+ * @author     dRonin, http://dronin.org, Copyright (C) 2017
+ * @brief      Delta angle and delta velocity accumulation of IMU samples
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef PREINTEGRATION_H
+#define PREINTEGRATION_H
+
+#include <stdint.h>
+
+//! What an interval of IMU samples adds up to
+struct imu_increment {
+	float delta_angle[3];		//!< Rotation vector over the interval, rad
+	float delta_velocity[3];	//!< Specific force times time, m/s, in the rotating body frame
+	float dt;			//!< Length of the interval, s
+	uint16_t samples;		//!< Number of samples in the interval
+};
+
+struct preintegration {
+	float alpha[3];		//!< Sum of the angle increments
+	float beta[3];		//!< Coning correction
+	float nu[3];		//!< Sum of the velocity increments
+	float sculling[3];	//!< Sculling correction
+	float last_alpha[3];	//!< Previous angle increment
+	float last_nu[3];	//!< Previous velocity increment
+	float dt;
+	uint16_t samples;
+};
+
+void preintegration_init(struct preintegration *p);
+void preintegration_restart(struct preintegration *p);
+void preintegration_add(struct preintegration *p, const float gyro[3],
+		const float accel[3], float dt);
+void preintegration_get(const struct preintegration *p,
+		struct imu_increment *inc);
+
+#endif /* PREINTEGRATION_H */
+
+/**
+ * @}
+ * @}
+ */
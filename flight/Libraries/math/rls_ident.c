@@ -0,0 +1,246 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ * @addtogroup FlightMath Filtering support libraries
+ * @{
+ *
+ * @file       rls_ident.c
+ * @author     dRonin, http://dronin.org, Copyright (C) 2017
+ * @brief      Recursive least squares identification of an axis' response
+ *
+ * The autotune model of an axis is an actuator with a first order lag of
+ * time constant tau, driving an angular acceleration of e^beta per unit:
+ *
+ *   tau * da/dt = u - a,   dw/dt = e^beta * a + bias
+ *
+ * Sampled every dt, with alpha = e^(-dt/tau) and the actuator command held
+ * between samples, the change in rate per sample then follows
+ *
+ *   dw[k] = alpha * dw[k-1] + c * (s * u[k-1] + (1 - s) * u[k-2]) + d
+ *
+ * where c = (1 - alpha) * e^beta * dt, d = (1 - alpha) * bias * dt, and the
+ * input splits across two samples as the lag carries part of it into the
+ * next, s = 1 / (1 - alpha) + 1 / ln(alpha), between 1/2 and 1.  With s
+ * taken from the last estimate of alpha that's linear in alpha, c and d,
+ * which are estimated by recursive least squares with a forgetting factor.
+ *
+ * Differencing the gyro leaves the noise in dw[k-1] as large as the signal,
+ * which biases least squares badly.  So the gyro and the actuator first
+ * pass through the same two pole low pass filter: that leaves the relation
+ * above unchanged, as both sides see the same linear filter, but takes out
+ * most of the noise.  Each sample costs a fixed few dozen
+ * multiplies; working out tau and beta with their bounds is left until
+ * they're wanted.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "rls_ident.h"
+
+//! Initial parameter covariance; large, as nothing is known yet
+#define INITIAL_COVARIANCE 100.0f
+
+//! Stop inflating the covariance past this, when the input isn't exciting
+#define MAX_COVARIANCE_TRACE 1e4f
+
+//! How often to rework the input split from alpha, in samples
+#define SPLIT_INTERVAL 32
+
+//! Corner of the filter applied to both inputs; the relation holds whatever
+//! it is, so it's set low enough to leave little noise past the wiggles
+#define PREFILTER_HZ 5.0f
+
+static void update_split(struct rls_ident *id)
+{
+	float alpha = id->theta[0];
+
+	if (alpha > 0.01f && alpha < 0.9999f) {
+		id->split = 1.0f / (1.0f - alpha) + 1.0f / logf(alpha);
+	} else {
+		id->split = 0.5f;
+	}
+}
+
+/**
+ * Start identifying an axis.
+ *
+ * @param[in] dt time between samples, s
+ * @param[in] lambda forgetting factor, just below one; samples are
+ * forgotten with a time constant of about dt / (1 - lambda)
+ */
+void rls_ident_init(struct rls_ident *id, float dt, float lambda)
+{
+	memset(id, 0, sizeof(*id));
+
+	id->initialized = true;
+	id->dt = dt;
+	id->lambda = lambda;
+	id->filt_k = 1.0f - expf(-2.0f * (float) M_PI * PREFILTER_HZ * dt);
+
+	/* A plausible start: tau of 30ms, with unknown gain */
+	id->theta[0] = expf(-dt / 0.03f);
+	update_split(id);
+
+	for (int i = 0; i < RLS_IDENT_PARAMS; i++) {
+		id->P[i][i] = INITIAL_COVARIANCE;
+	}
+}
+
+/**
+ * Add a sample.
+ *
+ * @param[in] gyro the rate measured this sample
+ * @param[in] actuator the actuator command worked out from it
+ */
+void rls_ident_update(struct rls_ident *id, float gyro, float actuator)
+{
+	/* Zeroed, lambda would be 0 and the covariance divided by it */
+	if (!id->initialized) {
+		return;
+	}
+
+	float k = id->filt_k;
+
+	if (id->samples == 0) {
+		id->filt_gyro[0] = id->filt_gyro[1] = gyro;
+		id->filt_actuator[0] = id->filt_actuator[1] = actuator;
+	}
+
+	id->filt_gyro[0] += k * (gyro - id->filt_gyro[0]);
+	id->filt_gyro[1] += k * (id->filt_gyro[0] - id->filt_gyro[1]);
+	id->filt_actuator[0] += k * (actuator - id->filt_actuator[0]);
+	id->filt_actuator[1] += k * (id->filt_actuator[0] - id->filt_actuator[1]);
+
+	gyro = id->filt_gyro[1];
+	actuator = id->filt_actuator[1];
+
+	float delta = gyro - id->last_gyro;
+
+	if (id->samples >= 3) {
+		if ((id->samples % SPLIT_INTERVAL) == 0) {
+			update_split(id);
+		}
+
+		const float phi[RLS_IDENT_PARAMS] = {
+			id->last_delta,
+			id->split * id->last_actuator[0] +
+				(1.0f - id->split) * id->last_actuator[1],
+			1.0f
+		};
+
+		float err = delta;
+		float Pphi[RLS_IDENT_PARAMS];
+		float denom = id->lambda;
+		float trace = 0;
+
+		for (int i = 0; i < RLS_IDENT_PARAMS; i++) {
+			err -= id->theta[i] * phi[i];
+
+			Pphi[i] = 0;
+
+			for (int j = 0; j < RLS_IDENT_PARAMS; j++) {
+				Pphi[i] += id->P[i][j] * phi[j];
+			}
+
+			denom += phi[i] * Pphi[i];
+			trace += id->P[i][i];
+		}
+
+		float gain[RLS_IDENT_PARAMS];
+
+		for (int i = 0; i < RLS_IDENT_PARAMS; i++) {
+			gain[i] = Pphi[i] / denom;
+			id->theta[i] += gain[i] * err;
+		}
+
+		float scale = trace < MAX_COVARIANCE_TRACE ?
+			1.0f / id->lambda : 1.0f;
+
+		/* P = (P - gain * Pphi') / lambda, kept symmetric */
+		for (int i = 0; i < RLS_IDENT_PARAMS; i++) {
+			for (int j = i; j < RLS_IDENT_PARAMS; j++) {
+				float p = (id->P[i][j] - gain[i] * Pphi[j]) * scale;
+
+				id->P[i][j] = p;
+				id->P[j][i] = p;
+			}
+		}
+
+		id->noise = id->lambda * id->noise +
+			(1.0f - id->lambda) * err * err;
+	}
+
+	id->last_delta = delta;
+	id->last_gyro = gyro;
+	id->last_actuator[1] = id->last_actuator[0];
+	id->last_actuator[0] = actuator;
+	id->samples++;
+}
+
+/**
+ * Work out the model found so far.
+ *
+ * @param[out] est the model, with bounds from the parameter covariance
+ * @returns false if the parameters don't make a stable, positive gain
+ * model yet
+ */
+bool rls_ident_estimate(const struct rls_ident *id,
+		struct rls_ident_estimate *est)
+{
+	float alpha = id->theta[0];
+	float c = id->theta[1];
+
+	if (!id->initialized) {
+		return false;
+	}
+
+	if (!(alpha > 0.0f && alpha < 1.0f && c > 0.0f)) {
+		return false;
+	}
+
+	float log_alpha = logf(alpha);
+	float one_minus = 1.0f - alpha;
+
+	est->tau = -id->dt / log_alpha;
+	est->beta = logf(c / (one_minus * id->dt));
+	est->bias = id->theta[2] / (one_minus * id->dt);
+
+	/* First order propagation of the covariance, noise * P */
+	float dtau = id->dt / (alpha * log_alpha * log_alpha);
+	float dbeta_alpha = 1.0f / one_minus;
+	float dbeta_c = 1.0f / c;
+
+	float var_tau = id->noise * dtau * dtau * id->P[0][0];
+	float var_beta = id->noise * (dbeta_alpha * dbeta_alpha * id->P[0][0] +
+			2.0f * dbeta_alpha * dbeta_c * id->P[0][1] +
+			dbeta_c * dbeta_c * id->P[1][1]);
+
+	est->tau_bound = 2.0f * sqrtf(fmaxf(var_tau, 0.0f));
+	est->beta_bound = 2.0f * sqrtf(fmaxf(var_beta, 0.0f));
+
+	return true;
+}
+
+/**
+ * @}
+ * @}
+ */
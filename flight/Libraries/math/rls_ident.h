@@ -0,0 +1,74 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ * @addtogroup FlightMath Filtering support libraries
+ * @{
+ *
+ * @file       rls_ident.h
+ * @author     dRonin, http://dronin.org, Copyright (C) 2017
+ * @brief      Recursive least squares identification of an axis' response
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef RLS_IDENT_H
+#define RLS_IDENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define RLS_IDENT_PARAMS 3
+
+struct rls_ident {
+	float theta[RLS_IDENT_PARAMS];	//!< Lag pole, input gain and bias
+	float P[RLS_IDENT_PARAMS][RLS_IDENT_PARAMS];	//!< Scaled covariance
+	float split;		//!< Share of the input felt the next sample
+	float noise;		//!< Running variance of the prediction error
+	float filt_gyro[2];	//!< Both inputs pass the same low pass filter
+	float filt_actuator[2];
+	float filt_k;
+	float last_gyro;
+	float last_delta;
+	float last_actuator[2];
+	float lambda;		//!< Forgetting factor
+	float dt;
+	uint32_t samples;
+	bool initialized;	//!< Samples before rls_ident_init() are dropped
+};
+
+//! The model an axis was found to follow, as the autotune wizard uses it
+struct rls_ident_estimate {
+	float tau;		//!< Actuator time constant, s
+	float beta;		//!< Log of the gain, ln(deg/s^2 per unit actuator)
+	float bias;		//!< Angular acceleration with no input, deg/s^2
+	float tau_bound;	//!< Two standard deviations of tau
+	float beta_bound;	//!< Two standard deviations of beta
+};
+
+void rls_ident_init(struct rls_ident *id, float dt, float lambda);
+void rls_ident_update(struct rls_ident *id, float gyro, float actuator);
+bool rls_ident_estimate(const struct rls_ident *id,
+		struct rls_ident_estimate *est);
+
+#endif /* RLS_IDENT_H */
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,685 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ *
+ * @file       polyfence.c
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @brief      Polygon geofence zones with a spatial index
+ *
+ * Zones are polygons, each applying between a floor and a ceiling altitude.
+ * Their edges are put in a uniform grid over the area, sized to hold about
+ * one edge per cell, and for each cell the zones containing its center are
+ * precomputed.  A query then only looks at the edges of one cell to find
+ * which zones contain a point, and at the cells in growing rings around it
+ * to find the nearest boundary.  Both take near constant time however many
+ * edges the fence has.
+ *
+ * Positions are north, east and altitude (up) in m, relative to home.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "polyfence.h"
+
+//! Most grid cells to use, whatever the number of edges
+#define MAX_CELLS 16384
+
+//! Margin around the edges covered by the grid, m
+#define GRID_PAD 1.0f
+
+//! Smallest step when looking ahead for a breach, m
+#define MIN_PREDICT_STEP 0.5f
+
+#define ALIGN(x) (((x) + 7) & ~((size_t) 7))
+
+struct fence_edge {
+	float x0, y0, x1, y1;		//!< North, east of both ends
+	uint8_t zone;
+};
+
+struct crossing {
+	float x;
+	uint8_t zone;
+};
+
+struct polyfence {
+	uint32_t keep_in;		//!< Masks of zones by type
+	uint32_t keep_out;
+	uint8_t num_zones;
+	float floor[POLYFENCE_MAX_ZONES];
+	float ceiling[POLYFENCE_MAX_ZONES];
+
+	uint16_t num_edges;
+	uint16_t nx, ny;		//!< Cells north and east
+	float x0, y0;			//!< South west corner of the grid
+	float cell;			//!< Cell size, m
+	float inv_cell;
+
+	struct fence_edge *edges;
+	uint32_t *cell_start;		//!< Index into cell_edges, per cell + 1
+	uint16_t *cell_edges;
+	uint32_t *cell_mask;		//!< Zones containing each cell center
+	struct crossing *scratch;	//!< Only used while building
+};
+
+static bool zone_usable(const struct polyfence_zone *z, uint8_t idx,
+		uint16_t num_vertices)
+{
+	return idx < POLYFENCE_MAX_ZONES &&
+		(z->type == POLYFENCE_KEEP_IN || z->type == POLYFENCE_KEEP_OUT) &&
+		z->num_vertices >= 3 &&
+		z->first_vertex + z->num_vertices <= num_vertices;
+}
+
+static int cell_of(const struct polyfence *f, float v, float origin, int n)
+{
+	int i = floorf((v - origin) * f->inv_cell);
+
+	if (i < 0) {
+		return 0;
+	} else if (i >= n) {
+		return n - 1;
+	}
+
+	return i;
+}
+
+static float orient(float ax, float ay, float bx, float by, float cx, float cy)
+{
+	return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+//! Whether an edge passes through a cell, or very nearly
+static bool edge_touches_cell(const struct polyfence *f,
+		const struct fence_edge *e, int i, int j)
+{
+	float eps = f->cell * 1e-3f;
+	float cx0 = f->x0 + i * f->cell - eps;
+	float cy0 = f->y0 + j * f->cell - eps;
+	float cx1 = cx0 + f->cell + 2 * eps;
+	float cy1 = cy0 + f->cell + 2 * eps;
+
+	float s0 = orient(e->x0, e->y0, e->x1, e->y1, cx0, cy0);
+	float s1 = orient(e->x0, e->y0, e->x1, e->y1, cx1, cy0);
+	float s2 = orient(e->x0, e->y0, e->x1, e->y1, cx0, cy1);
+	float s3 = orient(e->x0, e->y0, e->x1, e->y1, cx1, cy1);
+
+	/* All corners on one side of the line: no */
+	if ((s0 > 0 && s1 > 0 && s2 > 0 && s3 > 0) ||
+			(s0 < 0 && s1 < 0 && s2 < 0 && s3 < 0)) {
+		return false;
+	}
+
+	return true;
+}
+
+/* Runs the statement that follows for each cell the edge passes through */
+#define FOR_EDGE_CELLS(f, e, i, j) \
+	for (int j = cell_of((f), fminf((e)->y0, (e)->y1), (f)->y0, (f)->ny), \
+			j##_end = cell_of((f), fmaxf((e)->y0, (e)->y1), (f)->y0, (f)->ny); \
+			j <= j##_end; j++) \
+		for (int i = cell_of((f), fminf((e)->x0, (e)->x1), (f)->x0, (f)->nx), \
+				i##_end = cell_of((f), fmaxf((e)->x0, (e)->x1), (f)->x0, (f)->nx); \
+				i <= i##_end; i++) \
+			if (edge_touches_cell((f), (e), i, j))
+
+/**
+ * Works out the edges and the grid, and counts how many cell entries the
+ * edges need.  Fills in everything of f but the arrays.
+ */
+static uint32_t plan(struct polyfence *f, const struct polyfence_zone *zones,
+		uint8_t num_zones, const float (*vertices)[2], uint16_t num_vertices)
+{
+	memset(f, 0, sizeof(*f));
+
+	float min_x = INFINITY, min_y = INFINITY;
+	float max_x = -INFINITY, max_y = -INFINITY;
+	uint32_t num_edges = 0;
+
+	f->num_zones = num_zones < POLYFENCE_MAX_ZONES ?
+		num_zones : POLYFENCE_MAX_ZONES;
+
+	for (uint8_t z = 0; z < f->num_zones; z++) {
+		f->floor[z] = zones[z].floor;
+		f->ceiling[z] = zones[z].ceiling;
+
+		if (!zone_usable(&zones[z], z, num_vertices)) {
+			continue;
+		}
+
+		if (zones[z].type == POLYFENCE_KEEP_IN) {
+			f->keep_in |= 1u << z;
+		} else {
+			f->keep_out |= 1u << z;
+		}
+
+		for (int k = 0; k < zones[z].num_vertices; k++) {
+			const float *v = vertices[zones[z].first_vertex + k];
+
+			min_x = fminf(min_x, v[0]);
+			max_x = fmaxf(max_x, v[0]);
+			min_y = fminf(min_y, v[1]);
+			max_y = fmaxf(max_y, v[1]);
+		}
+
+		num_edges += zones[z].num_vertices;
+	}
+
+	if (num_edges == 0 || num_edges > UINT16_MAX) {
+		f->keep_in = f->keep_out = 0;
+		return 0;
+	}
+
+	f->num_edges = num_edges;
+
+	f->x0 = min_x - GRID_PAD;
+	f->y0 = min_y - GRID_PAD;
+
+	float w = max_x - min_x + 2 * GRID_PAD;
+	float h = max_y - min_y + 2 * GRID_PAD;
+
+	/* About one edge per cell */
+	uint32_t target = num_edges < MAX_CELLS ? num_edges : MAX_CELLS;
+	f->cell = sqrtf(w * h / target);
+
+	while (true) {
+		uint32_t nx = ceilf(w / f->cell);
+		uint32_t ny = ceilf(h / f->cell);
+
+		if (nx * ny <= MAX_CELLS) {
+			f->nx = nx;
+			f->ny = ny;
+			break;
+		}
+
+		f->cell *= 1.1f;
+	}
+
+	f->inv_cell = 1.0f / f->cell;
+
+	uint32_t entries = 0;
+
+	for (uint8_t z = 0; z < f->num_zones; z++) {
+		if (!zone_usable(&zones[z], z, num_vertices)) {
+			continue;
+		}
+
+		for (int k = 0; k < zones[z].num_vertices; k++) {
+			const float *a = vertices[zones[z].first_vertex + k];
+			const float *b = vertices[zones[z].first_vertex +
+				(k + 1) % zones[z].num_vertices];
+
+			struct fence_edge e = { a[0], a[1], b[0], b[1], z };
+
+			FOR_EDGE_CELLS(f, &e, i, j) {
+				entries++;
+			}
+		}
+	}
+
+	return entries;
+}
+
+static size_t layout(struct polyfence *f, uint32_t entries, uint8_t *base)
+{
+	uint32_t cells = f->nx * f->ny;
+	size_t offsets[5];
+	size_t pos = ALIGN(sizeof(struct polyfence));
+
+	offsets[0] = pos;
+	pos += ALIGN(f->num_edges * sizeof(struct fence_edge));
+	offsets[1] = pos;
+	pos += ALIGN((cells + 1) * sizeof(uint32_t));
+	offsets[2] = pos;
+	pos += ALIGN(cells * sizeof(uint32_t));
+	offsets[3] = pos;
+	pos += ALIGN(entries * sizeof(uint16_t));
+	offsets[4] = pos;
+	pos += ALIGN(f->num_edges * sizeof(struct crossing));
+
+	if (base) {
+		f->edges = (struct fence_edge *) (base + offsets[0]);
+		f->cell_start = (uint32_t *) (base + offsets[1]);
+		f->cell_mask = (uint32_t *) (base + offsets[2]);
+		f->cell_edges = (uint16_t *) (base + offsets[3]);
+		f->scratch = (struct crossing *) (base + offsets[4]);
+	}
+
+	return pos;
+}
+
+/**
+ * Works out how much memory polyfence_build() needs for these zones.
+ *
+ * @param[in] zones the zones, up to POLYFENCE_MAX_ZONES
+ * @param[in] vertices north, east pairs the zones refer to, m
+ * @returns bytes needed
+ */
+size_t polyfence_size(const struct polyfence_zone *zones, uint8_t num_zones,
+		const float (*vertices)[2], uint16_t num_vertices)
+{
+	struct polyfence f;
+	uint32_t entries = plan(&f, zones, num_zones, vertices, num_vertices);
+
+	return layout(&f, entries, NULL);
+}
+
+/**
+ * Counts the enabled zones polyfence_build() will leave out, as they have
+ * fewer than three vertices or refer to vertices past the end.
+ *
+ * @param[in] zones the zones, up to POLYFENCE_MAX_ZONES
+ * @param[in] num_vertices how many vertices the zones can refer to
+ * @returns number of keep-in and keep-out zones left out
+ */
+uint8_t polyfence_rejected_zones(const struct polyfence_zone *zones,
+		uint8_t num_zones, uint16_t num_vertices)
+{
+	uint8_t rejected = 0;
+
+	for (uint8_t z = 0; z < num_zones; z++) {
+		if ((zones[z].type == POLYFENCE_KEEP_IN ||
+					zones[z].type == POLYFENCE_KEEP_OUT) &&
+				!zone_usable(&zones[z], z, num_vertices)) {
+			rejected++;
+		}
+	}
+
+	return rejected;
+}
+
+static int compare_crossings(const void *a, const void *b)
+{
+	float xa = ((const struct crossing *) a)->x;
+	float xb = ((const struct crossing *) b)->x;
+
+	return (xa > xb) - (xa < xb);
+}
+
+//! Precompute which zones contain each cell center, a row at a time
+static void fill_masks(struct polyfence *f)
+{
+	for (int j = 0; j < f->ny; j++) {
+		float yc = f->y0 + (j + 0.5f) * f->cell;
+		int n = 0;
+
+		for (int k = 0; k < f->num_edges; k++) {
+			const struct fence_edge *e = &f->edges[k];
+
+			if ((e->y0 <= yc) == (e->y1 <= yc)) {
+				continue;
+			}
+
+			f->scratch[n].x = e->x0 + (yc - e->y0) *
+				(e->x1 - e->x0) / (e->y1 - e->y0);
+			f->scratch[n].zone = e->zone;
+			n++;
+		}
+
+		qsort(f->scratch, n, sizeof(f->scratch[0]), compare_crossings);
+
+		uint32_t mask = 0;
+		int k = 0;
+
+		for (int i = 0; i < f->nx; i++) {
+			float xc = f->x0 + (i + 0.5f) * f->cell;
+
+			while (k < n && f->scratch[k].x < xc) {
+				mask ^= 1u << f->scratch[k].zone;
+				k++;
+			}
+
+			f->cell_mask[j * f->nx + i] = mask;
+		}
+	}
+}
+
+/**
+ * Builds the fence into the memory given.
+ *
+ * @param[in] mem where to build, at least polyfence_size() bytes, 8 byte aligned
+ * @param[in] len size of mem
+ * @param[in] zones the zones; disabled ones are ignored, as are the ones
+ * polyfence_rejected_zones() counts
+ * @param[in] vertices north, east pairs the zones refer to, m
+ * @returns the fence, or NULL if mem is too small
+ */
+struct polyfence *polyfence_build(void *mem, size_t len,
+		const struct polyfence_zone *zones, uint8_t num_zones,
+		const float (*vertices)[2], uint16_t num_vertices)
+{
+	struct polyfence *f = mem;
+	uint32_t entries = plan(f, zones, num_zones, vertices, num_vertices);
+
+	if (layout(f, entries, mem) > len) {
+		return NULL;
+	}
+
+	if (!f->num_edges) {
+		return f;
+	}
+
+	uint16_t n = 0;
+
+	for (uint8_t z = 0; z < f->num_zones; z++) {
+		if (!zone_usable(&zones[z], z, num_vertices)) {
+			continue;
+		}
+
+		for (int k = 0; k < zones[z].num_vertices; k++) {
+			const float *a = vertices[zones[z].first_vertex + k];
+			const float *b = vertices[zones[z].first_vertex +
+				(k + 1) % zones[z].num_vertices];
+
+			f->edges[n++] = (struct fence_edge) {
+				a[0], a[1], b[0], b[1], z
+			};
+		}
+	}
+
+	/* Count the edges of each cell, then turn the counts into where
+	 * each cell's run ends and fill backwards */
+	uint32_t cells = f->nx * f->ny;
+	memset(f->cell_start, 0, (cells + 1) * sizeof(uint32_t));
+
+	for (int k = 0; k < f->num_edges; k++) {
+		FOR_EDGE_CELLS(f, &f->edges[k], i, j) {
+			f->cell_start[j * f->nx + i + 1]++;
+		}
+	}
+
+	for (uint32_t c = 0; c < cells; c++) {
+		f->cell_start[c + 1] += f->cell_start[c];
+	}
+
+	for (int k = f->num_edges - 1; k >= 0; k--) {
+		FOR_EDGE_CELLS(f, &f->edges[k], i, j) {
+			uint32_t c = j * f->nx + i;
+
+			/* Borrow the next cell's start as a cursor */
+			f->cell_edges[--f->cell_start[c + 1]] = k;
+		}
+	}
+
+	/* The cursors ended up at each cell's start, one place along */
+	memmove(&f->cell_start[0], &f->cell_start[1], cells * sizeof(uint32_t));
+	f->cell_start[cells] = entries;
+
+	fill_masks(f);
+
+	f->scratch = NULL;
+
+	return f;
+}
+
+static bool in_grid(const struct polyfence *f, float x, float y)
+{
+	return x >= f->x0 && y >= f->y0 &&
+		x < f->x0 + f->nx * f->cell && y < f->y0 + f->ny * f->cell;
+}
+
+//! Zones whose polygon contains the point, whatever the altitude
+static uint32_t containing_zones(const struct polyfence *f, float x, float y)
+{
+	if (!f->num_edges || !in_grid(f, x, y)) {
+		return 0;
+	}
+
+	int i = cell_of(f, x, f->x0, f->nx);
+	int j = cell_of(f, y, f->y0, f->ny);
+	uint32_t c = j * f->nx + i;
+
+	float xc = f->x0 + (i + 0.5f) * f->cell;
+	float yc = f->y0 + (j + 0.5f) * f->cell;
+
+	/* Start from the center and flip for each edge crossed on the way to
+	 * the point; the way lies within the cell, so only its edges count */
+	uint32_t mask = f->cell_mask[c];
+
+	for (uint32_t k = f->cell_start[c]; k < f->cell_start[c + 1]; k++) {
+		const struct fence_edge *e = &f->edges[f->cell_edges[k]];
+
+		float d1 = orient(e->x0, e->y0, e->x1, e->y1, xc, yc);
+		float d2 = orient(e->x0, e->y0, e->x1, e->y1, x, y);
+
+		if ((d1 > 0) == (d2 > 0)) {
+			continue;
+		}
+
+		float d3 = orient(xc, yc, x, y, e->x0, e->y0);
+		float d4 = orient(xc, yc, x, y, e->x1, e->y1);
+
+		if ((d3 > 0) != (d4 > 0)) {
+			mask ^= 1u << e->zone;
+		}
+	}
+
+	return mask;
+}
+
+static float edge_dist2(const struct fence_edge *e, float x, float y)
+{
+	float dx = e->x1 - e->x0, dy = e->y1 - e->y0;
+	float px = x - e->x0, py = y - e->y0;
+	float len2 = dx * dx + dy * dy;
+	float t = len2 > 0 ? (px * dx + py * dy) / len2 : 0;
+
+	if (t < 0) {
+		t = 0;
+	} else if (t > 1) {
+		t = 1;
+	}
+
+	px -= t * dx;
+	py -= t * dy;
+
+	return px * px + py * py;
+}
+
+static void visit_cell(const struct polyfence *f, int i, int j, float x,
+		float y, const float *vgap2, float *best, int8_t *zone)
+{
+	uint32_t c = j * f->nx + i;
+
+	for (uint32_t k = f->cell_start[c]; k < f->cell_start[c + 1]; k++) {
+		const struct fence_edge *e = &f->edges[f->cell_edges[k]];
+		float d2 = edge_dist2(e, x, y) + vgap2[e->zone];
+
+		if (d2 < *best) {
+			*best = d2;
+			*zone = e->zone;
+		}
+	}
+}
+
+/**
+ * Squared distance to the nearest side wall of a zone, searching rings of
+ * cells around the point until no unvisited cell can be closer.
+ */
+static float nearest_wall(const struct polyfence *f, float x, float y,
+		const float *vgap2, int8_t *zone)
+{
+	float best = INFINITY;
+	*zone = -1;
+
+	if (!f->num_edges) {
+		return best;
+	}
+
+	int ci = cell_of(f, x, f->x0, f->nx);
+	int cj = cell_of(f, y, f->y0, f->ny);
+
+	for (int k = 0; ; k++) {
+		int i0 = ci - k, i1 = ci + k;
+		int j0 = cj - k, j1 = cj + k;
+
+		for (int j = j0 > 0 ? j0 : 0; j <= j1 && j < f->ny; j++) {
+			if (j == j0 || j == j1) {
+				for (int i = i0 > 0 ? i0 : 0; i <= i1 && i < f->nx; i++) {
+					visit_cell(f, i, j, x, y, vgap2, &best, zone);
+				}
+			} else {
+				if (i0 >= 0) {
+					visit_cell(f, i0, j, x, y, vgap2, &best, zone);
+				}
+
+				if (i1 < f->nx && i1 != i0) {
+					visit_cell(f, i1, j, x, y, vgap2, &best, zone);
+				}
+			}
+		}
+
+		/* Closest any cell outside the rings so far could be */
+		float bound = INFINITY;
+
+		if (i0 > 0) {
+			bound = fminf(bound, x - (f->x0 + i0 * f->cell));
+		}
+
+		if (i1 < f->nx - 1) {
+			bound = fminf(bound, f->x0 + (i1 + 1) * f->cell - x);
+		}
+
+		if (j0 > 0) {
+			bound = fminf(bound, y - (f->y0 + j0 * f->cell));
+		}
+
+		if (j1 < f->ny - 1) {
+			bound = fminf(bound, f->y0 + (j1 + 1) * f->cell - y);
+		}
+
+		if (bound == INFINITY || best <= bound * bound) {
+			return best;
+		}
+	}
+}
+
+/**
+ * Checks a position against the fence.
+ *
+ * @param[in] fence from polyfence_build()
+ * @param[in] pos north, east, altitude, m
+ * @param[out] result whether the position breaches the fence, and how far
+ * it is from the nearest boundary of any zone
+ */
+void polyfence_check(const struct polyfence *fence, const float pos[3],
+		struct polyfence_result *result)
+{
+	const struct polyfence *f = fence;
+	float alt = pos[2];
+
+	uint32_t active = 0;
+	float vgap2[POLYFENCE_MAX_ZONES];
+
+	for (uint8_t z = 0; z < f->num_zones; z++) {
+		float gap = 0;
+
+		if (alt < f->floor[z]) {
+			gap = f->floor[z] - alt;
+		} else if (alt > f->ceiling[z]) {
+			gap = alt - f->ceiling[z];
+		} else {
+			active |= 1u << z;
+		}
+
+		vgap2[z] = gap * gap;
+	}
+
+	uint32_t inside = containing_zones(f, pos[0], pos[1]);
+
+	result->breached = (f->keep_in && !(inside & active & f->keep_in)) ||
+		(inside & active & f->keep_out);
+
+	result->margin = sqrtf(nearest_wall(f, pos[0], pos[1], vgap2,
+				&result->zone));
+
+	/* Zones above or below, or whose floor or ceiling is nearer than
+	 * their walls */
+	for (uint8_t z = 0; z < f->num_zones; z++) {
+		if (!(inside & (1u << z))) {
+			continue;
+		}
+
+		float d;
+
+		if (active & (1u << z)) {
+			d = fminf(alt - f->floor[z], f->ceiling[z] - alt);
+		} else {
+			d = sqrtf(vgap2[z]);
+		}
+
+		if (d < result->margin) {
+			result->margin = d;
+			result->zone = z;
+		}
+	}
+}
+
+/**
+ * Looks ahead along the current velocity for a breach.  Steps by the margin
+ * to the nearest boundary each time, which can't skip over a zone, though
+ * slivers thinner than MIN_PREDICT_STEP may be missed.
+ *
+ * @param[in] fence from polyfence_build()
+ * @param[in] pos north, east, altitude, m
+ * @param[in] vel north, east, up, m/s
+ * @param[in] horizon how far ahead to look, s
+ * @param[out] time_to_breach when the breach would happen, s
+ * @returns true if the fence would be breached within the horizon
+ */
+bool polyfence_predict(const struct polyfence *fence, const float pos[3],
+		const float vel[3], float horizon, float *time_to_breach)
+{
+	float speed = sqrtf(vel[0] * vel[0] + vel[1] * vel[1] + vel[2] * vel[2]);
+	float t = 0;
+
+	while (true) {
+		float p[3] = {
+			pos[0] + vel[0] * t,
+			pos[1] + vel[1] * t,
+			pos[2] + vel[2] * t,
+		};
+
+		struct polyfence_result res;
+		polyfence_check(fence, p, &res);
+
+		if (res.breached) {
+			*time_to_breach = t;
+			return true;
+		}
+
+		if (speed < 1e-3f || !isfinite(res.margin)) {
+			return false;
+		}
+
+		t += fmaxf(res.margin, MIN_PREDICT_STEP) / speed;
+
+		if (t > horizon) {
+			return false;
+		}
+	}
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,204 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ *
+ * @file       state_snapshot.c
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @brief      Shared snapshot of the flight state, for the telemetry bridges
+ *
+ * The protocol bridges and OSDs each export much the same few dozen fields,
+ * and fetching each object takes the object manager's lock and copies the
+ * whole object.  Instead one snapshot of all of them is taken from the
+ * event dispatcher, at the fastest rate any consumer asked for, and the
+ * consumers copy the latest one out without taking any lock.
+ *
+ * There are two slots: the snapshot is built in the one readers aren't
+ * pointed at, which is then published.  Each slot has a sequence count that
+ * is odd while it's written, so a reader slow enough to still be copying a
+ * slot when it's reused sees that and tries again.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "openpilot.h"
+#include "eventdispatcher.h"
+#include "pios_thread.h"
+
+#include "state_snapshot.h"
+
+struct snapshot_slot {
+	volatile uint32_t seq;
+	struct state_snapshot snapshot;
+};
+
+struct snapshot_source {
+	UAVObjHandle (*handle)(void);
+	uint16_t offset;
+	uint16_t size;
+};
+
+#define SOURCE(name, member) { \
+	name ## Handle, \
+	offsetof(struct state_snapshot, member), \
+	sizeof(((struct state_snapshot *) 0)->member) }
+
+static const struct snapshot_source sources[STATE_SNAPSHOT_NUM] = {
+	[STATE_SNAPSHOT_ACCELS] = SOURCE(Accels, accels),
+	[STATE_SNAPSHOT_ACTUATORDESIRED] =
+		SOURCE(ActuatorDesired, actuator_desired),
+	[STATE_SNAPSHOT_AIRSPEEDACTUAL] = SOURCE(AirspeedActual, airspeed),
+	[STATE_SNAPSHOT_ATTITUDEACTUAL] = SOURCE(AttitudeActual, attitude),
+	[STATE_SNAPSHOT_BAROALTITUDE] = SOURCE(BaroAltitude, baro),
+	[STATE_SNAPSHOT_FLIGHTBATTERYSTATE] =
+		SOURCE(FlightBatteryState, battery),
+	[STATE_SNAPSHOT_FLIGHTSTATUS] = SOURCE(FlightStatus, flight_status),
+	[STATE_SNAPSHOT_GPSPOSITION] = SOURCE(GPSPosition, gps_position),
+	[STATE_SNAPSHOT_GPSTIME] = SOURCE(GPSTime, gps_time),
+	[STATE_SNAPSHOT_GPSVELOCITY] = SOURCE(GPSVelocity, gps_velocity),
+	[STATE_SNAPSHOT_GYROS] = SOURCE(Gyros, gyros),
+	[STATE_SNAPSHOT_HOMELOCATION] = SOURCE(HomeLocation, home),
+	[STATE_SNAPSHOT_MANUALCONTROLCOMMAND] =
+		SOURCE(ManualControlCommand, manual_control),
+	[STATE_SNAPSHOT_POSITIONACTUAL] = SOURCE(PositionActual, position),
+	[STATE_SNAPSHOT_STABILIZATIONDESIRED] =
+		SOURCE(StabilizationDesired, stab_desired),
+	[STATE_SNAPSHOT_SYSTEMALARMS] = SOURCE(SystemAlarms, alarms),
+	[STATE_SNAPSHOT_SYSTEMSTATS] = SOURCE(SystemStats, stats),
+	[STATE_SNAPSHOT_VELOCITYACTUAL] = SOURCE(VelocityActual, velocity),
+};
+
+DONT_BUILD_IF(STATE_SNAPSHOT_NUM > 32, StateSnapshotPresentMask);
+
+static struct snapshot_slot *slots;
+static volatile uint32_t published;	/* index of the slot to read */
+static uint16_t snapshot_period;
+
+static void take_snapshot(const UAVObjEvent *ev,
+		void *ctx, void *obj, int len);
+
+/**
+ * Start taking snapshots, at least as often as asked.  Safe to call from
+ * each consumer, which must do so from its start function, once the
+ * event dispatcher is running.
+ *
+ * @param[in] period_ms how stale a snapshot this consumer can use
+ * @returns 0 on success, -1 on failure
+ */
+int32_t state_snapshot_initialize(uint16_t period_ms)
+{
+	UAVObjEvent ev;
+	memset(&ev, 0, sizeof(ev));
+
+	if (slots) {
+		if (period_ms < snapshot_period) {
+			snapshot_period = period_ms;
+			EventPeriodicCallbackUpdate(&ev, take_snapshot,
+					snapshot_period);
+		}
+
+		return 0;
+	}
+
+	struct snapshot_slot *s = PIOS_malloc_no_dma(2 * sizeof(*s));
+
+	if (!s) {
+		return -1;
+	}
+
+	memset(s, 0, 2 * sizeof(*s));
+
+	slots = s;
+	snapshot_period = period_ms;
+
+	take_snapshot(NULL, NULL, NULL, 0);
+
+	return EventPeriodicCallbackCreate(&ev, take_snapshot,
+			snapshot_period);
+}
+
+/**
+ * Copy out the latest snapshot.  Takes no locks, so it may be called from
+ * any task.
+ *
+ * @param[out] snapshot where to put it
+ * @returns false if no snapshots are being taken
+ */
+bool state_snapshot_get(struct state_snapshot *snapshot)
+{
+	if (!slots) {
+		memset(snapshot, 0, sizeof(*snapshot));
+		return false;
+	}
+
+	const struct snapshot_slot *slot;
+	uint32_t seq;
+
+	do {
+		slot = &slots[__atomic_load_n(&published, __ATOMIC_ACQUIRE)];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+
+		memcpy(snapshot, &slot->snapshot, sizeof(*snapshot));
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while ((seq & 1) ||
+			seq != __atomic_load_n(&slot->seq, __ATOMIC_RELAXED));
+
+	return true;
+}
+
+/**
+ * Periodic callback, from the event dispatcher, that fetches every object
+ * into the slot not being read and then publishes it.
+ */
+static void take_snapshot(const UAVObjEvent *ev,
+		void *ctx, void *obj, int len)
+{
+	(void) ev; (void) ctx; (void) obj; (void) len;
+
+	uint32_t next = published ^ 1;
+	struct snapshot_slot *slot = &slots[next];
+	struct state_snapshot *snapshot = &slot->snapshot;
+	uint32_t version = slots[published].snapshot.version + 1;
+
+	__atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	snapshot->present = 0;
+
+	for (int i = 0; i < STATE_SNAPSHOT_NUM; i++) {
+		UAVObjHandle handle = sources[i].handle();
+		uint8_t *data = (uint8_t *) snapshot + sources[i].offset;
+
+		if (handle && !UAVObjGetData(handle, data)) {
+			snapshot->present |= 1 << i;
+		} else {
+			memset(data, 0, sources[i].size);
+		}
+	}
+
+	snapshot->version = version;
+	snapshot->time = PIOS_Thread_Systime();
+
+	__atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&published, next, __ATOMIC_RELEASE);
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,144 @@
+/**
+ ******************************************************************************
+ * @addtogroup Libraries Libraries
+ * @{
+ *
+ * @file       timing_histogram.c
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2016
+ * @brief      Compact histogram of durations, for percentile statistics
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <string.h>
+
+#include "timing_histogram.h"
+
+//! Below this everything is binned linearly
+#define LINEAR_LIMIT (1 << (TIMING_HISTOGRAM_SUB_BITS + 3))
+
+static int bin_of(uint32_t duration_us)
+{
+	if (duration_us < LINEAR_LIMIT) {
+		return duration_us >> 3;
+	}
+
+	if (duration_us >= (1 << TIMING_HISTOGRAM_MAX_BITS)) {
+		return TIMING_HISTOGRAM_BINS - 1;
+	}
+
+	int msb = 31 - __builtin_clz(duration_us);
+	int octave = msb - (TIMING_HISTOGRAM_SUB_BITS + 2);
+	int sub = (duration_us >> (msb - TIMING_HISTOGRAM_SUB_BITS)) &
+		(TIMING_HISTOGRAM_SUB_BINS - 1);
+
+	return octave * TIMING_HISTOGRAM_SUB_BINS + sub;
+}
+
+//! Largest duration that falls in a bin
+static uint32_t bin_upper(int bin)
+{
+	if (bin < TIMING_HISTOGRAM_SUB_BINS) {
+		return bin * 8 + 7;
+	}
+
+	int octave = bin / TIMING_HISTOGRAM_SUB_BINS;
+	int sub = bin % TIMING_HISTOGRAM_SUB_BINS;
+	int shift = octave + 2;
+
+	return ((uint32_t) (TIMING_HISTOGRAM_SUB_BINS + sub + 1) << shift) - 1;
+}
+
+void timing_histogram_clear(struct timing_histogram *h)
+{
+	memset(h, 0, sizeof(*h));
+}
+
+/**
+ * Add a duration to the histogram.
+ *
+ * @param[in] h the histogram
+ * @param[in] duration_us the duration, in microseconds
+ */
+void timing_histogram_add(struct timing_histogram *h, uint32_t duration_us)
+{
+	int bin = bin_of(duration_us);
+
+	if (h->bins[bin] == UINT16_MAX) {
+		h->count = 0;
+
+		for (int i = 0; i < TIMING_HISTOGRAM_BINS; i++) {
+			h->bins[i] >>= 1;
+			h->count += h->bins[i];
+		}
+	}
+
+	h->bins[bin]++;
+	h->count++;
+
+	if (duration_us > h->max) {
+		h->max = duration_us;
+	}
+}
+
+/**
+ * Find a percentile of the durations added so far.
+ *
+ * @param[in] h the histogram
+ * @param[in] fraction which percentile, 0.5 for the median
+ * @returns the upper edge of the bin the percentile falls in, never more
+ * than the longest duration seen; 0 if the histogram is empty
+ */
+uint32_t timing_histogram_percentile(const struct timing_histogram *h,
+		float fraction)
+{
+	if (h->count == 0) {
+		return 0;
+	}
+
+	uint32_t rank = fraction * h->count + 0.999f;
+
+	if (rank < 1) {
+		rank = 1;
+	} else if (rank > h->count) {
+		rank = h->count;
+	}
+
+	uint32_t seen = 0;
+
+	for (int i = 0; i < TIMING_HISTOGRAM_BINS; i++) {
+		seen += h->bins[i];
+
+		if (seen >= rank) {
+			if (i == TIMING_HISTOGRAM_BINS - 1) {
+				/* Open ended */
+				return h->max;
+			}
+
+			uint32_t upper = bin_upper(i);
+
+			return (upper < h->max) ? upper : h->max;
+		}
+	}
+
+	return h->max;
+}
+
+/**
+ * @}
+ */
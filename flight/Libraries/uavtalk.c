@@ -46,6 +46,8 @@ static int32_t sendObject(UAVTalkConnectionData *connection, UAVObjHandle obj, u
 static int32_t sendSingleObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t type);
 static int32_t receiveObject(UAVTalkConnectionData *connection);
 static int32_t sendNack(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId);
+static bool setupPacketLengths(UAVTalkInputProcessor *iproc);
+static int32_t parsePacketInPlace(UAVTalkConnectionData *connection, const uint8_t *rxbytes, int32_t numbytes);
 
 /**
  * Initialize the UAVTalk library
@@ -79,6 +81,7 @@ UAVTalkConnection UAVTalkInitialize(void *ctx, UAVTalkOutputCb outputStream,
 	// allocate buffers
 	connection->rxBuffer = PIOS_malloc(UAVTALK_MAX_PACKET_LENGTH);
 	if (!connection->rxBuffer) return 0;
+	connection->rxData = connection->rxBuffer;
 	connection->txBuffer = PIOS_malloc(UAVTALK_MAX_PACKET_LENGTH);
 	if (!connection->txBuffer) return 0;
 
@@ -171,6 +174,80 @@ static int32_t objectTransaction(UAVTalkConnectionData *connection, UAVObjHandle
 	}
 }
 
+/**
+ * Work out the instance ID and payload lengths of a packet, once the header
+ * up to and including the object ID is known, and check them against the
+ * packet size.
+ * \param[in] iproc Parser state, with the type, packet size, object ID and
+ * bytes received so far filled in
+ * \return true if the packet looks sane
+ */
+static bool setupPacketLengths(UAVTalkInputProcessor *iproc)
+{
+	if (iproc->type == UAVTALK_TYPE_FILEREQ) {
+		/* Slightly overloaded from "normal" case.  Consume
+		 * 4 bytes of offset and 2 bytes of flags.
+		 */
+
+		iproc->instanceLength = 0;
+		iproc->length = 6;
+
+		return (iproc->packet_size - iproc->rxPacketLength) ==
+			iproc->length;
+	}
+
+	// Search for object.
+	iproc->obj = UAVObjGetByID(iproc->objId);
+
+	// Determine data length
+	if (iproc->type == UAVTALK_TYPE_OBJ_REQ || iproc->type == UAVTALK_TYPE_ACK || iproc->type == UAVTALK_TYPE_NACK) {
+		iproc->length = 0;
+		iproc->instanceLength = 0;
+
+		/* Length is always pretty much expected to be 0
+		 * here, but it can be 2 if it's a multiple inst
+		 * obj requested.  Don't peer into metadata to
+		 * figure this out-- use the packet length
+		 * [so we can properly NAK objects we don't know]
+		 */
+		if ((iproc->packet_size - iproc->rxPacketLength) == 2) {
+			iproc->instanceLength = 2;
+		} else if (iproc->length > 0) {
+			return false;
+		}
+	} else {
+		if (iproc->obj) {
+			iproc->length = UAVObjGetNumBytes(iproc->obj);
+			iproc->instanceLength = (UAVObjIsSingleInstance(iproc->obj) ? 0 : 2);
+		} else {
+			// We don't know if it's a multi-instance object, so just assume it's 0.
+			iproc->instanceLength = 0;
+			iproc->length = iproc->packet_size - iproc->rxPacketLength;
+		}
+	}
+
+	// Check length
+	if (iproc->length >= UAVTALK_MAX_PAYLOAD_LENGTH) {
+		return false;
+	}
+
+	// Check the lengths match
+	if ((iproc->rxPacketLength + iproc->instanceLength + iproc->length) != iproc->packet_size) { // packet error - mismatched packet size
+		if (iproc->instanceLength == 0) {
+			// Try again with a 2 inst len
+			// to accept LP's fork of
+			// protocol.
+			iproc->instanceLength = 2;
+		}
+	}
+
+	if ((iproc->rxPacketLength + iproc->instanceLength + iproc->length) != iproc->packet_size) { // packet error - mismatched packet size
+		return false;
+	}
+
+	return true;
+}
+
 /**
  * Process an byte from the telemetry stream.
  * \param[in] connection UAVTalkConnection to be used
@@ -207,6 +284,9 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 
 		iproc->rxPacketLength = 1;
 
+		connection->rxData = connection->rxBuffer;
+		connection->rxFrame = NULL;
+
 		iproc->state = UAVTALK_STATE_TYPE;
 		break;
 
@@ -262,75 +342,14 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 		if (iproc->rxCount < 4)
 			break;
 
-		if (iproc->type == UAVTALK_TYPE_FILEREQ) {
-			/* Slightly overloaded from "normal" case.  Consume
-			 * 4 bytes of offset and 2 bytes of flags.
-			 */
-
-			iproc->instanceLength = 0;
-			iproc->rxCount = 0;
-			iproc->length = 6;
-
-			if ((iproc->packet_size - iproc->rxPacketLength) !=
-					iproc->length) {
-				iproc->state = UAVTALK_STATE_ERROR;
-				break;
-			}
-
-			iproc->state = UAVTALK_STATE_DATA;
-
-			break;
-		}
-
-		// Search for object.
-		iproc->obj = UAVObjGetByID(iproc->objId);
-
-		// Determine data length
-		if (iproc->type == UAVTALK_TYPE_OBJ_REQ || iproc->type == UAVTALK_TYPE_ACK || iproc->type == UAVTALK_TYPE_NACK) {
-			iproc->length = 0;
-			iproc->instanceLength = 0;
-
-			/* Length is always pretty much expected to be 0
-			 * here, but it can be 2 if it's a multiple inst
-			 * obj requested.  Don't peer into metadata to
-			 * figure this out-- use the packet length
-			 * [so we can properly NAK objects we don't know]
-			 */
-			if ((iproc->packet_size - iproc->rxPacketLength) == 2) {
-				iproc->instanceLength = 2;
-			} else if (iproc->length > 0) {
-				iproc->state = UAVTALK_STATE_ERROR;
-				break; 
-			}
-		} else {
-			if (iproc->obj) {
-				iproc->length = UAVObjGetNumBytes(iproc->obj);
-				iproc->instanceLength = (UAVObjIsSingleInstance(iproc->obj) ? 0 : 2);
-			} else {
-				// We don't know if it's a multi-instance object, so just assume it's 0.
-				iproc->instanceLength = 0;
-				iproc->length = iproc->packet_size - iproc->rxPacketLength;
-			}
-		}
-
-		// Check length and determine next state
-		if (iproc->length >= UAVTALK_MAX_PAYLOAD_LENGTH) {
+		if (!setupPacketLengths(iproc)) {
 			iproc->state = UAVTALK_STATE_ERROR;
 			break;
 		}
 
-		// Check the lengths match
-		if ((iproc->rxPacketLength + iproc->instanceLength + iproc->length) != iproc->packet_size) { // packet error - mismatched packet size
-			if (iproc->instanceLength == 0) {
-				// Try again with a 2 inst len
-				// to accept LP's fork of
-				// protocol.
-				iproc->instanceLength = 2;
-			}
-		}
-
-		if ((iproc->rxPacketLength + iproc->instanceLength + iproc->length) != iproc->packet_size) { // packet error - mismatched packet size
-			iproc->state = UAVTALK_STATE_ERROR;
+		if (iproc->type == UAVTALK_TYPE_FILEREQ) {
+			iproc->rxCount = 0;
+			iproc->state = UAVTALK_STATE_DATA;
 			break;
 		}
 
@@ -415,26 +434,176 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 }
 
 /**
- * Process an byte from the telemetry stream.
+ * Take a whole packet from the start of a block of received bytes in one
+ * go, leaving it where it is.  Only complete, valid packets are taken;
+ * anything else is left to the byte by byte state machine, which knows how
+ * to deal with partial and broken packets and keeps the error counts.
  * \param[in] connection UAVTalkConnection to be used
- * \param[in] rxbyte Received byte
- * \return UAVTalkRxState
+ * \param[in] rxbytes Received bytes, starting with a sync byte
+ * \param[in] numbytes Number of received bytes
+ * \return The length of the packet taken, or 0 if none was
+ */
+static int32_t parsePacketInPlace(UAVTalkConnectionData *connection,
+		const uint8_t *rxbytes, int32_t numbytes)
+{
+	UAVTalkInputProcessor *iproc = &connection->iproc;
+
+	if (numbytes < UAVTALK_MIN_HEADER_LENGTH + UAVTALK_CHECKSUM_LENGTH) {
+		return 0;
+	}
+
+	uint8_t type = rxbytes[1];
+	uint16_t packet_size = rxbytes[2] | (rxbytes[3] << 8);
+
+	if ((type & UAVTALK_TYPE_MASK) != UAVTALK_TYPE_VER) {
+		return 0;
+	}
+
+	if (packet_size < UAVTALK_MIN_HEADER_LENGTH ||
+			packet_size > UAVTALK_MAX_HEADER_LENGTH + UAVTALK_MAX_PAYLOAD_LENGTH) {
+		return 0;
+	}
+
+	// NACKs never carry anything past the object ID
+	if (type == UAVTALK_TYPE_NACK &&
+			packet_size != UAVTALK_MIN_HEADER_LENGTH) {
+		return 0;
+	}
+
+	// Wait for the rest of it
+	if (numbytes < packet_size + UAVTALK_CHECKSUM_LENGTH) {
+		return 0;
+	}
+
+	uint8_t cs = PIOS_CRC_updateCRC(0, rxbytes, packet_size);
+
+	if (cs != rxbytes[packet_size]) {
+		return 0;
+	}
+
+	iproc->type = type;
+	iproc->packet_size = packet_size;
+	iproc->objId = rxbytes[4] | (rxbytes[5] << 8) | (rxbytes[6] << 16) |
+		((uint32_t) rxbytes[7] << 24);
+	iproc->rxPacketLength = UAVTALK_MIN_HEADER_LENGTH;
+
+	if (!setupPacketLengths(iproc)) {
+		return 0;
+	}
+
+	iproc->instId = 0;
+	if (iproc->instanceLength) {
+		iproc->instId = rxbytes[8] | (rxbytes[9] << 8);
+	}
+
+	iproc->cs = cs;
+	iproc->rxPacketLength = packet_size + UAVTALK_CHECKSUM_LENGTH;
+	iproc->state = UAVTALK_STATE_COMPLETE;
+
+	connection->rxData = rxbytes + UAVTALK_MIN_HEADER_LENGTH +
+		iproc->instanceLength;
+	connection->rxFrame = rxbytes;
+
+	connection->stats.rxBytes += iproc->rxPacketLength;
+	connection->stats.rxObjectBytes += iproc->length;
+	connection->stats.rxObjects++;
+
+	return iproc->rxPacketLength;
+}
+
+/**
+ * Process received bytes up to the end of the next complete packet.
+ *
+ * Packets that arrived whole are checked and used where they are, without
+ * copying; anything else goes through UAVTalkProcessInputStreamQuiet().
+ * Once a packet is complete it can be received or relayed until the next
+ * call, so the bytes must be left in place until then.
+ * \param[in] connectionHandle UAVTalkConnection to be used
+ * \param[in] rxbytes Received bytes
+ * \param[in] numbytes Number of received bytes
+ * \param[out] state Parser state after the last byte consumed
+ * \return Number of bytes consumed
+ * \return -1 Failure
+ */
+int32_t UAVTalkProcessInputBlock(UAVTalkConnection connectionHandle,
+		const uint8_t *rxbytes, int32_t numbytes, UAVTalkRxState *state)
+{
+	UAVTalkConnectionData *connection;
+
+	CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+	UAVTalkInputProcessor *iproc = &connection->iproc;
+	int32_t i = 0;
+
+	while (i < numbytes) {
+		if (iproc->state == UAVTALK_STATE_SYNC ||
+				iproc->state == UAVTALK_STATE_COMPLETE ||
+				iproc->state == UAVTALK_STATE_ERROR) {
+			// Between packets, as the state machine would do
+			if (iproc->state == UAVTALK_STATE_ERROR) {
+				connection->stats.rxErrors++;
+			}
+
+			iproc->state = UAVTALK_STATE_SYNC;
+
+			const uint8_t *sync = memchr(rxbytes + i,
+					UAVTALK_SYNC_VAL, numbytes - i);
+
+			if (!sync) {
+				connection->stats.rxBytes += numbytes - i;
+				i = numbytes;
+				break;
+			}
+
+			connection->stats.rxBytes += sync - (rxbytes + i);
+			i = sync - rxbytes;
+
+			int32_t len = parsePacketInPlace(connection,
+					rxbytes + i, numbytes - i);
+
+			if (len > 0) {
+				i += len;
+				break;
+			}
+		}
+
+		if (UAVTalkProcessInputStreamQuiet(connectionHandle,
+					rxbytes[i++]) == UAVTALK_STATE_COMPLETE) {
+			break;
+		}
+	}
+
+	*state = iproc->state;
+
+	return i;
+}
+
+/**
+ * Process bytes from the telemetry stream, receiving every packet
+ * completed along the way.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] rxbytes Received bytes
+ * \param[in] numbytes Number of received bytes
  */
-void UAVTalkProcessInputStream(UAVTalkConnection connectionHandle, uint8_t *rxbytes,
-		int numbytes)
+void UAVTalkProcessInputStream(UAVTalkConnection connectionHandle,
+		const uint8_t *rxbytes, int numbytes)
 {
 	UAVTalkConnectionData *connection;
 
 	CHECKCONHANDLE(connectionHandle,connection,return);
 
-	for (int i = 0; i < numbytes; i++) {
-		UAVTalkRxState state =
-			UAVTalkProcessInputStreamQuiet(connectionHandle,
-					rxbytes[i]);
+	while (numbytes > 0) {
+		UAVTalkRxState state;
+
+		int32_t used = UAVTalkProcessInputBlock(connectionHandle,
+				rxbytes, numbytes, &state);
 
 		if (state == UAVTALK_STATE_COMPLETE) {
 			receiveObject(connection);
 		}
+
+		rxbytes += used;
+		numbytes -= used;
 	}
 }
 
@@ -472,38 +641,50 @@ int32_t UAVTalkRelayPacket(UAVTalkConnection inConnectionHandle, UAVTalkConnecti
 	// Lock
 	PIOS_Recursive_Mutex_Lock(outConnection->lock, PIOS_MUTEX_TIMEOUT_MAX);
 
-	outConnection->txBuffer[0] = UAVTALK_SYNC_VAL;
-	// Setup type
-	outConnection->txBuffer[1] = inIproc->type;
-	// next 2 bytes are reserved for data length (inserted here later)
-	// Setup object ID
-	outConnection->txBuffer[4] = (uint8_t)(inIproc->objId & 0xFF);
-	outConnection->txBuffer[5] = (uint8_t)((inIproc->objId >> 8) & 0xFF);
-	outConnection->txBuffer[6] = (uint8_t)((inIproc->objId >> 16) & 0xFF);
-	outConnection->txBuffer[7] = (uint8_t)((inIproc->objId >> 24) & 0xFF);
 	int32_t headerLength = 8;
 
 	if (inIproc->instanceLength) {
-		// Setup instance ID
-		outConnection->txBuffer[8] = (uint8_t)(inIproc->instId & 0xFF);
-		outConnection->txBuffer[9] = (uint8_t)((inIproc->instId >> 8) & 0xFF);
 		headerLength = 10;
 	}
 
-	// Copy data (if any)
-	if (inIproc->length > 0) {
-		memcpy(&outConnection->txBuffer[headerLength], inConnection->rxBuffer, inIproc->length);
-	}
+	uint8_t *txBuffer = outConnection->txBuffer;
 
-	// Store the packet length
-	outConnection->txBuffer[2] = (uint8_t)((headerLength + inIproc->length) & 0xFF);
-	outConnection->txBuffer[3] = (uint8_t)(((headerLength + inIproc->length) >> 8) & 0xFF);
+	if (inConnection->rxFrame) {
+		/* The packet was parsed where it was received, so it can go
+		 * out exactly as it came in. */
+		txBuffer = (uint8_t *) inConnection->rxFrame;
+	} else {
+		txBuffer[0] = UAVTALK_SYNC_VAL;
+		// Setup type
+		txBuffer[1] = inIproc->type;
+		// next 2 bytes are reserved for data length (inserted here later)
+		// Setup object ID
+		txBuffer[4] = (uint8_t)(inIproc->objId & 0xFF);
+		txBuffer[5] = (uint8_t)((inIproc->objId >> 8) & 0xFF);
+		txBuffer[6] = (uint8_t)((inIproc->objId >> 16) & 0xFF);
+		txBuffer[7] = (uint8_t)((inIproc->objId >> 24) & 0xFF);
+
+		if (inIproc->instanceLength) {
+			// Setup instance ID
+			txBuffer[8] = (uint8_t)(inIproc->instId & 0xFF);
+			txBuffer[9] = (uint8_t)((inIproc->instId >> 8) & 0xFF);
+		}
 
-	// Copy the checksum
-	outConnection->txBuffer[headerLength + inIproc->length] = inIproc->cs;
+		// Copy data (if any)
+		if (inIproc->length > 0) {
+			memcpy(&txBuffer[headerLength], inConnection->rxData, inIproc->length);
+		}
+
+		// Store the packet length
+		txBuffer[2] = (uint8_t)((headerLength + inIproc->length) & 0xFF);
+		txBuffer[3] = (uint8_t)(((headerLength + inIproc->length) >> 8) & 0xFF);
+
+		// Copy the checksum
+		txBuffer[headerLength + inIproc->length] = inIproc->cs;
+	}
 
 	// Send the buffer.
-	int32_t rc = (*outConnection->outCb)(outConnection->cbCtx, outConnection->txBuffer, headerLength + inIproc->length + UAVTALK_CHECKSUM_LENGTH);
+	int32_t rc = (*outConnection->outCb)(outConnection->cbCtx, txBuffer, headerLength + inIproc->length + UAVTALK_CHECKSUM_LENGTH);
 
 	// Update stats
 	outConnection->stats.txBytes += (rc > 0) ? rc : 0;
@@ -579,7 +760,8 @@ static void handleFileReq(UAVTalkConnectionData *connection)
 	UAVTalkInputProcessor *iproc = &connection->iproc;
 	uint32_t file_id = iproc->objId;
 
-	struct filereq_data *req = (struct filereq_data *) connection->rxBuffer;
+	const struct filereq_data *req =
+		(const struct filereq_data *) connection->rxData;
 
 	/* printf("Got filereq for file_id=%08x offs=%d\n", file_id, req->offset); */
 
@@ -614,7 +796,8 @@ static void handleFileReq(UAVTalkConnectionData *connection)
 		if (connection->fileCb) {
 			cb_numbytes = connection->fileCb(connection->cbCtx,
 				connection->txBuffer + data_offs,
-				file_id, file_offset, 100);
+				file_id, file_offset,
+				UAVTALK_MAX_FILEDATA_LENGTH);
 		}
 
 		uint8_t total_len = data_offs;
@@ -722,7 +905,7 @@ static int32_t receiveObject(UAVTalkConnectionData *connection)
 		// All instances, not allowed for OBJ messages
 		if (obj && (instId != UAVOBJ_ALL_INSTANCES)) {
 			// Unpack object, if the instance does not exist it will be created!
-			UAVObjUnpack(obj, instId, connection->rxBuffer);
+			UAVObjUnpack(obj, instId, connection->rxData);
 		} else {
 			ret = -1;
 		}
@@ -731,7 +914,7 @@ static int32_t receiveObject(UAVTalkConnectionData *connection)
 		// All instances, not allowed for OBJ_ACK messages
 		if (obj && (instId != UAVOBJ_ALL_INSTANCES)) {
 			// Unpack object, if the instance does not exist it will be created!
-			if (UAVObjUnpack(obj, instId, connection->rxBuffer) == 0) {
+			if (UAVObjUnpack(obj, instId, connection->rxData) == 0) {
 				// Transmit ACK
 				sendObject(connection, obj, instId, UAVTALK_TYPE_ACK);
 			} else {
@@ -909,6 +1092,74 @@ int32_t UAVTalkSendNack(UAVTalkConnection connectionHandle, uint32_t objId,
 	return sendNack(connection, objId, instId);
 }
 
+/**
+ * Send a chunk of file data, unsolicited.  Used to put file contents into
+ * a stream, e.g. a log, in the same form as answers to file requests.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] file_id The file the data belongs to
+ * \param[in] offset Offset of the data in the file
+ * \param[in] flags UAVTALK_FILEDATA_* flags
+ * \param[in] data The data
+ * \param[in] length Length of the data, at most UAVTALK_MAX_FILEDATA_LENGTH
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSendFileData(UAVTalkConnection connectionHandle,
+		uint32_t file_id, uint32_t offset, uint8_t flags,
+		const uint8_t *data, uint16_t length)
+{
+	UAVTalkConnectionData *connection;
+	CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+	if (!connection->outCb || length > UAVTALK_MAX_FILEDATA_LENGTH) {
+		return -1;
+	}
+
+	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	connection->txBuffer[0] = UAVTALK_SYNC_VAL;  // sync byte
+	connection->txBuffer[1] = UAVTALK_TYPE_FILEDATA;
+	// data length inserted here below
+	connection->txBuffer[4] = (uint8_t)(file_id & 0xFF);
+	connection->txBuffer[5] = (uint8_t)((file_id >> 8) & 0xFF);
+	connection->txBuffer[6] = (uint8_t)((file_id >> 16) & 0xFF);
+	connection->txBuffer[7] = (uint8_t)((file_id >> 24) & 0xFF);
+
+	uint16_t data_offs = 8;
+
+	struct fileresp_data *resp =
+		(struct fileresp_data *) (connection->txBuffer + data_offs);
+
+	resp->offset = offset;
+	resp->flags = flags;
+
+	data_offs += sizeof(*resp);
+
+	memcpy(connection->txBuffer + data_offs, data, length);
+
+	uint16_t total_len = data_offs + length;
+
+	// Store the packet length
+	connection->txBuffer[2] = (uint8_t)((total_len) & 0xFF);
+	connection->txBuffer[3] = (uint8_t)(((total_len) >> 8) & 0xFF);
+
+	// Calculate checksum
+	connection->txBuffer[total_len] = PIOS_CRC_updateCRC(0,
+			connection->txBuffer, total_len);
+
+	int32_t rc = (*connection->outCb)(connection->cbCtx,
+			connection->txBuffer, total_len + 1);
+
+	if (rc == total_len + 1) {
+		// Update stats
+		connection->stats.txBytes += total_len + 1;
+	}
+
+	PIOS_Recursive_Mutex_Unlock(connection->lock);
+
+	return (rc == total_len + 1) ? 0 : -1;
+}
+
 static int32_t sendNack(UAVTalkConnectionData *connection, uint32_t objId,
 		uint16_t instId)
 {
@@ -52,6 +52,9 @@
 #include "pios_thread.h"
 #include "pios_queue.h"
 #include "misc_math.h"
+#include "mixer.h"
+#include "control_latency.h"
+#include "loop_timing.h"
 
 // Private constants
 #define MAX_QUEUE_SIZE 2
@@ -72,6 +75,9 @@
 DONT_BUILD_IF(ACTUATORSETTINGS_TIMERUPDATEFREQ_NUMELEM > PIOS_SERVO_MAX_BANKS, TooManyServoBanks);
 DONT_BUILD_IF(MAX_MIX_ACTUATORS > ACTUATORCOMMAND_CHANNEL_NUMELEM, TooManyMixers);
 DONT_BUILD_IF((MIXERSETTINGS_MIXER1VECTOR_NUMELEM - MIXERSETTINGS_MIXER1VECTOR_ACCESSORY0) < MANUALCONTROLCOMMAND_ACCESSORY_NUMELEM, AccessoryMismatch);
+DONT_BUILD_IF(MAX_MIX_ACTUATORS > MIXER_MAX_OUTPUTS, MixerTooSmall);
+DONT_BUILD_IF(MIXERSETTINGS_MIXER1VECTOR_NUMELEM != MIXER_NUM_INPUTS, MixerInputMismatch);
+DONT_BUILD_IF(MIXERSETTINGS_MIXER1VECTOR_YAW != MIXER_INPUT_YAW, MixerYawMismatch);
 
 #define MIXER_SCALE 128
 #define ACTUATOR_EPSILON 0.00001f
@@ -94,9 +100,23 @@ static MixerSettingsMixer1TypeOptions types_mixer[MAX_MIX_ACTUATORS];
 
 /* In the mixer, a row consists of values for one output actuator.
  * A column consists of values for scaling one axis's desired command.
+ * Only servo and motor rows are kept.
  */
+static struct mixer_matrix mixer;
+
+/* MotorInputOutputCurveFit and MotorInputOutputGain, tabulated */
+static struct mixer_curve motor_curve;
+
+/* Per channel output scaling, worked out from ActuatorSettings once */
+struct channel_scale {
+	float pos_gain;		/* max - neutral - deadband */
+	float neg_gain;		/* neutral - min - deadband */
+	float deadband;		/* half the deadband, signed by channel direction */
+	float lo;
+	float hi;
+};
 
-static float motor_mixer[MAX_MIX_ACTUATORS * MIXERSETTINGS_MIXER1VECTOR_NUMELEM];
+static struct channel_scale channel_scales[MAX_MIX_ACTUATORS];
 
 /* These are various settings objects used throughout the actuator code */
 static ActuatorSettingsData actuatorSettings;
@@ -251,6 +271,10 @@ int32_t ActuatorInitialize()
 		return -1;
 	}
 
+	if (loop_timing_initialize() == -1) {
+		return -1;
+	}
+
 #if defined(MIXERSTATUS_DIAGNOSTICS)
 	// UAVO only used for inspecting the internal status of the mixer during debug
 	if (MixerStatusInitialize()  == -1) {
@@ -322,19 +346,15 @@ static void compute_one_mixer(int mixnum,
 		MixerSettingsMixer1TypeOptions type,
 		float scale_adjustment)
 {
-	types_mixer[mixnum] = type;
+	float row[MIXERSETTINGS_MIXER1VECTOR_NUMELEM];
 
-	mixnum *= MIXERSETTINGS_MIXER1VECTOR_NUMELEM;
+	types_mixer[mixnum] = type;
 
-	if ((type != MIXERSETTINGS_MIXER1TYPE_SERVO) &&
-			(type != MIXERSETTINGS_MIXER1TYPE_MOTOR)) {
-		for (int i = 0; i < MIXERSETTINGS_MIXER1VECTOR_NUMELEM; i++) {
-			// Ensure unused types are zero-filled
-			motor_mixer[mixnum+i] = 0;
-		}
-	} else {
+	// Other types aren't mixed, they get no row
+	if ((type == MIXERSETTINGS_MIXER1TYPE_SERVO) ||
+			(type == MIXERSETTINGS_MIXER1TYPE_MOTOR)) {
 		for (int i = 0; i < MIXERSETTINGS_MIXER1VECTOR_NUMELEM; i++) {
-			motor_mixer[mixnum+i] = (*vals)[i] * (1.0f / MIXER_SCALE);
+			row[i] = (*vals)[i] * (1.0f / MIXER_SCALE);
 		}
 
 		if (type == MIXERSETTINGS_MIXER1TYPE_MOTOR) {
@@ -351,13 +371,13 @@ static void compute_one_mixer(int mixnum,
 			 * same control authority irrespective of
 			 * motor scale setting.
 			 */
-			motor_mixer[mixnum + MIXERSETTINGS_MIXER1VECTOR_ROLL] *=
-				scale_adjustment;
-			motor_mixer[mixnum + MIXERSETTINGS_MIXER1VECTOR_PITCH] *=
-				scale_adjustment;
-			motor_mixer[mixnum + MIXERSETTINGS_MIXER1VECTOR_YAW] *=
-				scale_adjustment;
+			row[MIXERSETTINGS_MIXER1VECTOR_ROLL] *= scale_adjustment;
+			row[MIXERSETTINGS_MIXER1VECTOR_PITCH] *= scale_adjustment;
+			row[MIXERSETTINGS_MIXER1VECTOR_YAW] *= scale_adjustment;
 		}
+
+		mixer_matrix_add_row(&mixer, mixnum, row,
+				type == MIXERSETTINGS_MIXER1TYPE_MOTOR);
 	}
 }
 
@@ -374,10 +394,14 @@ static void compute_mixer()
 		scale_adjustment = powf(1 / output_gain, 1 / curve_fit);
 	}
 
+	mixer_curve_build(&motor_curve, curve_fit, output_gain);
+
 	MixerSettingsData mixerSettings;
 
 	MixerSettingsGet(&mixerSettings);
 
+	mixer_matrix_clear(&mixer);
+
 #if MAX_MIX_ACTUATORS > 0
 	compute_one_token_paste(1);
 #endif
@@ -544,6 +568,18 @@ static void post_process_scale_and_commit(float *motor_vect,
 		}
 	}
 
+	/* Before squashing every axis to fit, give up yaw so that roll
+	 * and pitch keep their authority.
+	 */
+	if ((max_chan - min_chan) > 1.0f) {
+		float yaw_cmd = desired_vect[MIXERSETTINGS_MIXER1VECTOR_YAW];
+
+		mixer_desaturate_yaw(&mixer, neg_throttle ? -yaw_cmd : yaw_cmd,
+				motor_vect);
+		mixer_motor_range(&mixer, motor_vect, &min_chan, &max_chan,
+				&neg_clip);
+	}
+
 	float gain = 1.0f;
 	float offset = 0.0f;
 
@@ -618,9 +654,7 @@ static void post_process_scale_and_commit(float *motor_vect,
 
 				if (motor_vect[ct] > 0) {
 					// Apply curve fitting, mapping the input to the propeller output.
-
-					motor_vect[ct] = powapprox(motor_vect[ct], actuatorSettings.MotorInputOutputCurveFit);
-					motor_vect[ct] *= actuatorSettings.MotorInputOutputGain;
+					motor_vect[ct] = mixer_curve_eval(&motor_curve, motor_vect[ct]);
 				} else {
 					/* Clip to minimum spin in this direction */
 					if (!flip_over_mode) {
@@ -654,6 +688,7 @@ static void post_process_scale_and_commit(float *motor_vect,
 	// Update output object
 	if (!ActuatorCommandReadOnly()) {
 		ActuatorCommandSet(&command);
+		control_latency_actuator();
 	} else {
 		// it's read only during servo configuration--
 		// so GCS takes precedence.
@@ -753,6 +788,21 @@ static void actuator_settings_update()
 		if (actuatorSettings.ChannelDeadband[i]) {
 			desired_3d_mask |= (1 << i);
 		}
+
+		float max = actuatorSettings.ChannelMax[i];
+		float min = actuatorSettings.ChannelMin[i];
+		float neutral = actuatorSettings.ChannelNeutral[i];
+		float deadband = actuatorSettings.ChannelDeadband[i] / 2.0f;
+
+		if (min > max) {
+			deadband = -deadband;
+		}
+
+		channel_scales[i].pos_gain = max - neutral - deadband;
+		channel_scales[i].neg_gain = neutral - min - deadband;
+		channel_scales[i].deadband = deadband;
+		channel_scales[i].lo = MIN(min, max);
+		channel_scales[i].hi = MAX(min, max);
 	}
 
 	hangtime_leakybucket_timeconstant = actuatorSettings.LowPowerStabilizationTimeConstant;
@@ -822,6 +872,8 @@ static void actuator_task(void* parameters)
 			continue;
 		}
 
+		loop_timing_begin(LOOP_TIMING_ACTUATOR);
+
 		uint32_t this_systime = PIOS_Thread_Systime();
 
 		/* Check how long since last update; this is stored into the
@@ -871,7 +923,7 @@ static void actuator_task(void* parameters)
 		}
 
 
-		float motor_vect[MAX_MIX_ACTUATORS];
+		float motor_vect[MAX_MIX_ACTUATORS] = { 0 };
 
 		bool armed, spin_while_armed, stabilize_now, flip_over_mode;
 
@@ -885,10 +937,7 @@ static void actuator_task(void* parameters)
 
 		/* Multiply the actuators x desired matrix by the
 		 * desired x 1 column vector. */
-		matrix_mul_check(motor_mixer, desired_vect, motor_vect,
-				MAX_MIX_ACTUATORS,
-				MIXERSETTINGS_MIXER1VECTOR_NUMELEM,
-				1);
+		mixer_matrix_apply(&mixer, desired_vect, motor_vect);
 
 		/* At arming time, knock all 3d actuators into 3D mode.
 		 * Note we never "take them out" of 3d mode.
@@ -915,6 +964,9 @@ static void actuator_task(void* parameters)
 				dT, armed, spin_while_armed, stabilize_now,
 				flip_over_mode, &maxpoweradd_bucket);
 
+		loop_timing_output();
+		loop_timing_end(LOOP_TIMING_ACTUATOR);
+
 		/* If we got this far, everything is OK. */
 		AlarmsClear(SYSTEMALARMS_ALARM_ACTUATOR);
 	}
@@ -1037,15 +1089,13 @@ static float scale_channel(float value, int idx, bool active_cmd)
 		return scale_channel_dshot(value, idx, active_cmd);
 	}
 
-	float max = actuatorSettings.ChannelMax[idx];
-	float min = actuatorSettings.ChannelMin[idx];
+	const struct channel_scale *scale = &channel_scales[idx];
 	float neutral = actuatorSettings.ChannelNeutral[idx];
-	float deadband = actuatorSettings.ChannelDeadband[idx] / 2.0f;
 
 	float valueScaled;
 
 	if (!isfinite(value)) {
-		if (deadband) {
+		if (actuatorSettings.ChannelDeadband[idx]) {
 			/* 3D motor mode */
 			/* NaN signals us to not spin-- e.g. neutral value */
 
@@ -1053,29 +1103,20 @@ static float scale_channel(float value, int idx, bool active_cmd)
 		} else {
 			/* Non-3D motor mode. */
 			/* NaN signals us to not spin-- e.g. minimum value */
-			return min;
+			return actuatorSettings.ChannelMin[idx];
 		}
 	}
 
-	if (min > max) {
-		deadband = -deadband;
-	}
-
 	if (value >= 0.0f) {
-		valueScaled = value * (max - neutral - deadband)
-			+ neutral + deadband;
+		valueScaled = value * scale->pos_gain
+			+ neutral + scale->deadband;
 	} else {
-		valueScaled = value * (neutral - min - deadband)
-			+ neutral - deadband;
+		valueScaled = value * scale->neg_gain
+			+ neutral - scale->deadband;
 	}
 
-	if (max > min) {
-		if (valueScaled > max) valueScaled = max;
-		if (valueScaled < min) valueScaled = min;
-	} else {
-		if (valueScaled < max) valueScaled = max;
-		if (valueScaled > min) valueScaled = min;
-	}
+	if (valueScaled > scale->hi) valueScaled = scale->hi;
+	if (valueScaled < scale->lo) valueScaled = scale->lo;
 
 	return valueScaled;
 }
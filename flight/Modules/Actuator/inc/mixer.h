@@ -0,0 +1,85 @@
+/**
+ ******************************************************************************
+ * @addtogroup Modules Modules
+ * @{
+ * @addtogroup ActuatorModule Actuator Module
+ * @{
+ *
+ * @file       mixer.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2016
+ * @brief      Packed mixer matrix, desaturation and motor output curve
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef MIXER_H
+#define MIXER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//! Most outputs that can be mixed, ActuatorCommand channels
+#define MIXER_MAX_OUTPUTS      10
+//! Inputs to the mixer, in MixerSettings MixerNVector element order
+#define MIXER_NUM_INPUTS       8
+#define MIXER_INPUT_YAW        4
+
+//! Linear segments in the motor output curve table
+#define MIXER_CURVE_SEGMENTS   128
+
+/**
+ * Mixer matrix holding only the rows of outputs that are actually mixed,
+ * motors first, and only the columns that are non-zero in some row.
+ * Coefficients are stored column by column so that one input is applied to
+ * every output in a single contiguous pass.
+ */
+struct mixer_matrix {
+	uint8_t num_rows;
+	uint8_t num_motors;
+	uint8_t num_cols;
+	uint8_t channel[MIXER_MAX_OUTPUTS];   //!< Output channel of each row
+	uint8_t input[MIXER_NUM_INPUTS];      //!< Input index of each column
+	float coef[MIXER_NUM_INPUTS][MIXER_MAX_OUTPUTS];
+	float yaw[MIXER_MAX_OUTPUTS];         //!< Yaw coefficient of each row
+};
+
+//! Table of gain * x^exponent over [0, 1]
+struct mixer_curve {
+	float table[MIXER_CURVE_SEGMENTS + 1];
+};
+
+void mixer_matrix_clear(struct mixer_matrix *m);
+int mixer_matrix_add_row(struct mixer_matrix *m, uint8_t channel,
+		const float row[MIXER_NUM_INPUTS], bool motor);
+void mixer_matrix_apply(const struct mixer_matrix *m,
+		const float in[MIXER_NUM_INPUTS], float *out);
+
+void mixer_motor_range(const struct mixer_matrix *m, const float *out,
+		float *min_chan, float *max_chan, float *neg_clip);
+float mixer_desaturate_yaw(const struct mixer_matrix *m, float yaw_cmd,
+		float *out);
+
+void mixer_curve_build(struct mixer_curve *curve, float exponent, float gain);
+float mixer_curve_eval(const struct mixer_curve *curve, float x);
+
+#endif /* MIXER_H */
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,279 @@
+/**
+ ******************************************************************************
+ * @addtogroup Modules Modules
+ * @{
+ * @addtogroup ActuatorModule Actuator Module
+ * @{
+ *
+ * @file       mixer.c
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2016
+ * @brief      Packed mixer matrix, desaturation and motor output curve
+ *
+ * The mixer matrix is rebuilt from MixerSettings only when settings change,
+ * so everything that can be worked out up front is: unused outputs and
+ * unused inputs are dropped, and the motor curve is tabulated.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "mixer.h"
+
+//! Bisection steps when searching for how much yaw to keep
+#define DESATURATE_ITERATIONS 12
+
+void mixer_matrix_clear(struct mixer_matrix *m)
+{
+	memset(m, 0, sizeof(*m));
+}
+
+/**
+ * Add an output to the mixer. Motors are kept ahead of everything else.
+ *
+ * @param[in] m the mixer
+ * @param[in] channel output channel driven by this row
+ * @param[in] row one coefficient per input
+ * @param[in] motor whether the output is a motor
+ * @returns 0 on success, -1 if the mixer is full
+ */
+int mixer_matrix_add_row(struct mixer_matrix *m, uint8_t channel,
+		const float row[MIXER_NUM_INPUTS], bool motor)
+{
+	if (m->num_rows >= MIXER_MAX_OUTPUTS) {
+		return -1;
+	}
+
+	int pos = m->num_rows;
+
+	if (motor) {
+		/* Make room at the end of the motor rows */
+		pos = m->num_motors;
+
+		for (int r = m->num_rows; r > pos; r--) {
+			m->channel[r] = m->channel[r - 1];
+			m->yaw[r] = m->yaw[r - 1];
+
+			for (int k = 0; k < MIXER_NUM_INPUTS; k++) {
+				m->coef[k][r] = m->coef[k][r - 1];
+			}
+		}
+
+		m->num_motors++;
+	}
+
+	m->channel[pos] = channel;
+	m->yaw[pos] = row[MIXER_INPUT_YAW];
+
+	for (int k = 0; k < MIXER_NUM_INPUTS; k++) {
+		m->coef[k][pos] = row[k];
+	}
+
+	m->num_rows++;
+
+	/* Keep the used columns in input order, so each output accumulates
+	 * its terms in the same order as a full matrix multiply would.
+	 */
+	m->num_cols = 0;
+
+	for (int k = 0; k < MIXER_NUM_INPUTS; k++) {
+		for (int r = 0; r < m->num_rows; r++) {
+			if (m->coef[k][r] != 0.0f) {
+				m->input[m->num_cols++] = k;
+				break;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Mix the inputs to the outputs. Only channels with a row are written.
+ *
+ * Each output is summed in input order from zero, exactly as matrix_mul()
+ * does, so results are identical to multiplying the full matrix. Skipped
+ * columns are zero in every row and would only have added zero.
+ *
+ * @param[in] m the mixer
+ * @param[in] in mixer inputs
+ * @param[out] out outputs indexed by channel
+ */
+void mixer_matrix_apply(const struct mixer_matrix *m,
+		const float in[MIXER_NUM_INPUTS], float *out)
+{
+	float acc[MIXER_MAX_OUTPUTS];
+	const int rows = m->num_rows;
+
+	for (int r = 0; r < rows; r++) {
+		acc[r] = 0;
+	}
+
+	for (int c = 0; c < m->num_cols; c++) {
+		const float *col = m->coef[m->input[c]];
+		const float x = in[m->input[c]];
+
+		/* Contiguous over rows; vectorizes where the FPU allows */
+		for (int r = 0; r < rows; r++) {
+			acc[r] += col[r] * x;
+		}
+	}
+
+	for (int r = 0; r < rows; r++) {
+		out[m->channel[r]] = acc[r];
+	}
+}
+
+/**
+ * Find the span of the motor outputs.
+ *
+ * @param[in] m the mixer
+ * @param[in] out outputs indexed by channel
+ * @param[out] min_chan lowest motor output
+ * @param[out] max_chan highest motor output
+ * @param[out] neg_clip sum of the negative motor outputs
+ */
+void mixer_motor_range(const struct mixer_matrix *m, const float *out,
+		float *min_chan, float *max_chan, float *neg_clip)
+{
+	*min_chan = INFINITY;
+	*max_chan = -INFINITY;
+	*neg_clip = 0;
+
+	for (int r = 0; r < m->num_motors; r++) {
+		float val = out[m->channel[r]];
+
+		*min_chan = fminf(*min_chan, val);
+		*max_chan = fmaxf(*max_chan, val);
+
+		if (val < 0.0f) {
+			*neg_clip += val;
+		}
+	}
+}
+
+static float motor_spread(const struct mixer_matrix *m, const float *out,
+		float yaw_removed)
+{
+	float min_chan = INFINITY;
+	float max_chan = -INFINITY;
+
+	for (int r = 0; r < m->num_motors; r++) {
+		float val = out[m->channel[r]] - m->yaw[r] * yaw_removed;
+
+		min_chan = fminf(min_chan, val);
+		max_chan = fmaxf(max_chan, val);
+	}
+
+	return max_chan - min_chan;
+}
+
+/**
+ * Give up yaw authority until the motor outputs span no more than 1, so
+ * that roll and pitch do not have to be scaled back when motors clip.
+ *
+ * The spread of the outputs is convex in the amount of yaw kept, so the
+ * largest amount that still fits is found by bisection.
+ *
+ * @param[in] m the mixer
+ * @param[in] yaw_cmd yaw input the outputs were mixed with, negated if the
+ * outputs have been negated
+ * @param[in,out] out outputs indexed by channel, motors are adjusted
+ * @returns the fraction of yaw kept, in [0, 1]
+ */
+float mixer_desaturate_yaw(const struct mixer_matrix *m, float yaw_cmd,
+		float *out)
+{
+	float keep;
+
+	if (motor_spread(m, out, 0) <= 1.0f) {
+		return 1.0f;
+	}
+
+	if (motor_spread(m, out, yaw_cmd) >= 1.0f) {
+		/* Even without any yaw it doesn't fit */
+		keep = 0.0f;
+	} else {
+		float lo = 0.0f, hi = 1.0f;
+
+		for (int i = 0; i < DESATURATE_ITERATIONS; i++) {
+			float mid = (lo + hi) * 0.5f;
+
+			if (motor_spread(m, out, yaw_cmd * (1.0f - mid)) <= 1.0f) {
+				lo = mid;
+			} else {
+				hi = mid;
+			}
+		}
+
+		keep = lo;
+	}
+
+	float yaw_removed = yaw_cmd * (1.0f - keep);
+
+	for (int r = 0; r < m->num_motors; r++) {
+		out[m->channel[r]] -= m->yaw[r] * yaw_removed;
+	}
+
+	return keep;
+}
+
+/**
+ * Tabulate the motor input to output mapping, gain * x^exponent.
+ *
+ * @param[out] curve the table to fill
+ * @param[in] exponent MotorInputOutputCurveFit
+ * @param[in] gain MotorInputOutputGain
+ */
+void mixer_curve_build(struct mixer_curve *curve, float exponent, float gain)
+{
+	for (int i = 0; i <= MIXER_CURVE_SEGMENTS; i++) {
+		float x = (float) i / MIXER_CURVE_SEGMENTS;
+
+		curve->table[i] = powf(x, exponent) * gain;
+	}
+}
+
+/**
+ * Look up the motor output for an input in [0, 1], interpolating linearly
+ * between table entries. Inputs outside the range are clamped.
+ */
+float mixer_curve_eval(const struct mixer_curve *curve, float x)
+{
+	if (x <= 0.0f) {
+		return curve->table[0];
+	}
+
+	float pos = x * MIXER_CURVE_SEGMENTS;
+	int idx = pos;
+
+	if (idx >= MIXER_CURVE_SEGMENTS) {
+		return curve->table[MIXER_CURVE_SEGMENTS];
+	}
+
+	float frac = pos - idx;
+
+	return curve->table[idx] +
+		(curve->table[idx + 1] - curve->table[idx]) * frac;
+}
+
+/**
+ * @}
+ * @}
+ */
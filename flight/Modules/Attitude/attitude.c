@@ -55,6 +55,8 @@
 #include "coordinate_conversions.h"
 #include "WorldMagModel.h"
 #include "insgps.h"
+#include "loop_timing.h"
+#include "imu_increments.h"
 
 // UAVOs
 #include "accels.h"
@@ -83,6 +85,8 @@
 #define STACK_SIZE_BYTES 2504
 #define TASK_PRIORITY PIOS_THREAD_PRIO_HIGH
 #define FAILSAFE_TIMEOUT_MS 10
+#define MIN_PREDICTION_RATE 50
+#define MAX_PREDICTION_DT 0.05f
 
 // Private types
 
@@ -206,6 +210,9 @@ static void set_state_estimation_error(SystemAlarmsStateEstimationOptions error_
 //! Determine if it is safe to set the home location then do it
 static void check_home_location();
 
+//! Connect the gyro and accel queues only while something waits on them
+static void connect_imu_queues(bool connect);
+
 //! Scales used in NED transform (local tangent plane approx).
 static float T[3];
 
@@ -244,6 +251,14 @@ int32_t AttitudeInitialize(void)
 		return -1;		
 	}
 
+	if (loop_timing_initialize() == -1) {
+		return -1;
+	}
+
+	if (imu_increments_initialize() == -1) {
+		return -1;
+	}
+
 	INSSettingsConnectCallbackCtx(UAVObjCbSetFlag, &settings_flag);
 	AttitudeSettingsConnectCallbackCtx(UAVObjCbSetFlag, &settings_flag);
 	StateEstimationConnectCallbackCtx(UAVObjCbSetFlag, &settings_flag);
@@ -284,8 +299,6 @@ int32_t AttitudeStart(void)
 	gyrosBias.z = 0;
 	GyrosBiasSet(&gyrosBias);
 
-	GyrosConnectQueue(gyroQueue);
-	AccelsConnectQueue(accelQueue);
 	if (MagnetometerHandle())
 		MagnetometerConnectQueue(magQueue);
 	if (BaroAltitudeHandle())
@@ -424,8 +437,22 @@ static void AttitudeTask(void *parameters)
 		bool complementary = (stateEstimation.AttitudeFilter == STATEESTIMATION_ATTITUDEFILTER_COMPLEMENTARY) ||
 			(stateEstimation.AttitudeFilter == STATEESTIMATION_ATTITUDEFILTER_COMPLEMENTARYVELCOMPASS);
 
+		// Only the complementary filter on its own waits on every gyro
+		// and accel update; the INS takes the increments instead
+		connect_imu_queues(!ins);
+
 		// Update one or both filters
 		if (ins) {
+			// The complementary filter wants every gyro sample, so
+			// then the INS gets them one by one too
+			float period = 0;
+
+			if (!complementary && insSettings.PredictionRate) {
+				period = 1.0f / MAX(insSettings.PredictionRate, MIN_PREDICTION_RATE);
+			}
+
+			imu_increments_set_period(period);
+
 			ret_val = updateAttitudeINSGPS(first_run, outdoor);
 			if (complementary)
 				updateAttitudeComplementary(dT_expected,
@@ -475,6 +502,8 @@ static void AttitudeTask(void *parameters)
 
 		updateNedAccel();
 
+		loop_timing_end(LOOP_TIMING_ATTITUDE);
+
 		if(ret_val == 0)
 			first_run = false;
 
@@ -514,6 +543,8 @@ static int32_t updateAttitudeComplementary(float dT, bool first_run, bool second
 				return -1;
 			}
 		}
+
+		loop_timing_begin(LOOP_TIMING_ATTITUDE);
 	}
 
 	AccelsGet(&accelsData);
@@ -1066,8 +1097,7 @@ static void accumulate_gyro(GyrosData *gyrosData)
 static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 {
 	UAVObjEvent ev;
-	GyrosData gyrosData;
-	AccelsData accelsData;
+	struct imu_increment inc;
 	MagnetometerData magData;
 	GPSVelocityData gpsVelData;
 	GyrosBiasData gyrosBias;
@@ -1083,8 +1113,9 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 
 	static float baro_offset = 0;
 
-	static uint32_t ins_last_time = 0;
 	static uint32_t ins_init_time = 0;
+	static uint8_t covariance_count;
+	static float covariance_dT;
 
 	static enum {INS_INIT, INS_WARMUP, INS_RUNNING} ins_state;
 
@@ -1108,7 +1139,7 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 
 		home_location_updated = false;
 
-		ins_last_time = PIOS_DELAY_GetRaw();
+		imu_increments_flush();
 
 		return 0;
 	}
@@ -1118,16 +1149,29 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 	gps_updated = gps_updated || (PIOS_Queue_Receive(gpsQueue, &ev, 0) && outdoor_mode);
 	gps_vel_updated = gps_vel_updated || (PIOS_Queue_Receive(gpsVelQueue, &ev, 0) && outdoor_mode);
 
-	// Wait until the gyro and accel object is updated, if a timeout then go to failsafe
-	if (PIOS_Queue_Receive(gyroQueue, &ev, FAILSAFE_TIMEOUT_MS) != true ||
-		PIOS_Queue_Receive(accelQueue, &ev, 1) != true)
-	{
+	// Wait until the sensors have accumulated the next interval of gyro
+	// and accel samples, if a timeout then go to failsafe
+	uint32_t timeout_ms = FAILSAFE_TIMEOUT_MS;
+
+	if (insSettings.PredictionRate) {
+		timeout_ms += 1000 / MAX(insSettings.PredictionRate, MIN_PREDICTION_RATE);
+	}
+
+	if (!imu_increments_receive(&inc, timeout_ms) || inc.dt <= 0) {
 		return -1;
 	}
 
-	// Get most recent data
-	GyrosGet(&gyrosData);
-	AccelsGet(&accelsData);
+	loop_timing_begin(LOOP_TIMING_ATTITUDE);
+
+	// The average rates and specific force over the interval, which with
+	// the coning and sculling corrections applied advance the state just
+	// like the individual samples would
+	float gyros[3], accels[3];
+	for (int i = 0; i < 3; i++) {
+		gyros[i] = inc.delta_angle[i] / inc.dt;
+		accels[i] = inc.delta_velocity[i] / inc.dt;
+	}
+
 	GyrosBiasGet(&gyrosBias);
 
 	// Need to get these values before initializing
@@ -1198,8 +1242,8 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 		BaroAltitudeGet(&baroData);
 
 		float RPY[3], q[4];
-		RPY[0] = atan2f(-accelsData.y, -accelsData.z) * RAD2DEG;
-		RPY[1] = atan2f(accelsData.x, -accelsData.z) * RAD2DEG;
+		RPY[0] = atan2f(-accels[1], -accels[2]) * RAD2DEG;
+		RPY[1] = atan2f(accels[0], -accels[2]) * RAD2DEG;
 		RPY[2] = atan2f(-magData.y, magData.x) * RAD2DEG;
 		RPY2Quaternion(RPY,q);
 
@@ -1244,8 +1288,10 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 		// state to make sure filter converges
 		ins_state = INS_WARMUP;
 
-		ins_last_time = PIOS_DELAY_GetRaw();	
-		ins_init_time = ins_last_time;
+		ins_init_time = PIOS_DELAY_GetRaw();
+
+		covariance_count = 0;
+		covariance_dT = 0;
 
 		return 0;
 	} else if (ins_state == INS_INIT)
@@ -1264,14 +1310,11 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 	// Have a minimum requirement for gps usage a little more liberal than during initialization
 	gps_updated &= (gpsData.Satellites >= 6) && (gpsData.PDOP <= 4.0f) && (homeLocation.Set == HOMELOCATION_SET_TRUE);
 
-	dT = PIOS_DELAY_DiffuS(ins_last_time) / 1.0e6f;
-	ins_last_time = PIOS_DELAY_GetRaw();
+	dT = inc.dt;
 
 	// This should only happen at start up or at mode switches
-	if(dT > 0.01f)
-		dT = 0.01f;
-	else if(dT <= 0.0005f)
-		dT = 0.0005f;
+	if (dT > MAX_PREDICTION_DT)
+		dT = MAX_PREDICTION_DT;
 
 	// When the sensor settings are updated, reset the biases. Also
 	// while warming up, lock these at zero.
@@ -1284,22 +1327,25 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 	// Because the sensor module remove the bias we need to add it
 	// back in here so that the INS algorithm can track it correctly
 	// this effectively means the INS is observing the "raw" data.
-	float gyros[3];
 	if (attitudeSettings.BiasCorrectGyro == ATTITUDESETTINGS_BIASCORRECTGYRO_TRUE) {
-		gyros[0] = (gyrosData.x + gyrosBias.x) * DEG2RAD;
-		gyros[1] = (gyrosData.y + gyrosBias.y) * DEG2RAD;
-		gyros[2] = (gyrosData.z + gyrosBias.z) * DEG2RAD;
-	} else {
-		gyros[0] = gyrosData.x * DEG2RAD;
-		gyros[1] = gyrosData.y * DEG2RAD;
-		gyros[2] = gyrosData.z * DEG2RAD;
+		gyros[0] += gyrosBias.x * DEG2RAD;
+		gyros[1] += gyrosBias.y * DEG2RAD;
+		gyros[2] += gyrosBias.z * DEG2RAD;
 	}
 
 	// Advance the state estimate
-	INSStatePrediction(gyros, &accelsData.x, dT);
+	INSStatePrediction(gyros, accels, dT);
+
+	// Advance the covariance estimate, which changes slowly enough that
+	// it can be done less often
+	covariance_dT += dT;
 
-	// Advance the covariance estimate
-	INSCovariancePrediction(dT);
+	if (++covariance_count >= insSettings.CovariancePredictionDivider) {
+		INSCovariancePrediction(covariance_dT);
+
+		covariance_count = 0;
+		covariance_dT = 0;
+	}
 
 	if(mag_updated) {
 		sensors |= MAG_SENSORS;
@@ -1392,7 +1438,7 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 	if (insSettings.ComputeGyroBias == INSSETTINGS_COMPUTEGYROBIAS_FALSE)
 		INSSetGyroBias(zeros);
 
-	float accel_bias_corrected[3] = {accelsData.x - state.State[13], accelsData.y - state.State[14], accelsData.z - state.State[15]};
+	float accel_bias_corrected[3] = {accels[0] - state.State[13], accels[1] - state.State[14], accels[2] - state.State[15]};
 	calc_ned_accel(&state.State[6], accel_bias_corrected);
 
 	return 0;
@@ -1606,6 +1652,38 @@ static void set_state_estimation_error(SystemAlarmsStateEstimationOptions error_
 	AlarmsSet(SYSTEMALARMS_ALARM_ATTITUDE, (uint8_t) severity);
 }
 
+/**
+ * Connect or disconnect the gyro and accel queues.  Nothing empties them
+ * while the INS runs, so left connected every update would fail to queue
+ * and count as an event system error.  The INS takes the increments
+ * instead, so they're only accumulated while the queues are disconnected.
+ * @param[in] connect whether the queues should be connected
+ */
+static void connect_imu_queues(bool connect)
+{
+	static bool connected;
+
+	imu_increments_set_active(!connect);
+
+	if (connect == connected)
+		return;
+
+	if (connect) {
+		GyrosConnectQueue(gyroQueue);
+		AccelsConnectQueue(accelQueue);
+	} else {
+		UAVObjDisconnectQueue(GyrosHandle(), gyroQueue);
+		UAVObjDisconnectQueue(AccelsHandle(), accelQueue);
+
+		// Don't leave a stale update for when they're connected again
+		UAVObjEvent ev;
+		PIOS_Queue_Receive(gyroQueue, &ev, 0);
+		PIOS_Queue_Receive(accelQueue, &ev, 0);
+	}
+
+	connected = connect;
+}
+
 /**
  * @}
  * @}
@@ -51,6 +51,7 @@
 #include "systemsettings.h"
 
 #include "misc_math.h"
+#include "rls_ident.h"
 
 // Private constants
 #define AUTOTUNE_STATE_PERIOD_MS 100
@@ -59,6 +60,9 @@
 #define AUTOTUNE_AVERAGING_DECIMATION 1
 #endif
 
+// How long the on-board identification remembers samples for, s
+#define AUTOTUNE_IDENT_MEMORY 5.0f
+
 // Private types
 enum autotune_state { AT_INIT, AT_RUN };
 
@@ -80,6 +84,19 @@ struct at_measurement {
 
 static struct at_measurement *at_averages;
 
+/* Identified on-board as the samples arrive, by the stabilization task;
+ * the estimates are published once a wiggle cycle, under a sequence count
+ * that's odd while they're being written. */
+struct at_ident {
+	struct rls_ident axis[3];
+	struct rls_ident_estimate est[3];
+	bool valid;
+	volatile uint32_t seq;
+};
+
+static struct at_ident *at_ident;
+static float ident_dt;
+
 // Private variables
 static bool module_enabled;
 
@@ -173,6 +190,12 @@ static void at_new_actuators(const UAVObjEvent *ev,
 			if (!tune_running) {
 				update_counter = 0;
 				throttle_accumulator = 0;
+
+				for (int i = 0; i < 3; i++) {
+					rls_ident_init(&at_ident->axis[i],
+						ident_dt, 1.0f - ident_dt /
+						AUTOTUNE_IDENT_MEMORY);
+				}
 			}
 
 			tune_running = true;
@@ -196,17 +219,76 @@ static void at_new_actuators(const UAVObjEvent *ev,
 
 	update_counter++;
 	throttle_accumulator += 10000 * actuators.Thrust;
+
+	rls_ident_update(&at_ident->axis[0], g.x, actuators.Roll);
+	rls_ident_update(&at_ident->axis[1], g.y, actuators.Pitch);
+	rls_ident_update(&at_ident->axis[2], g.z, actuators.Yaw);
+
+	if (actuators.SystemIdentCycle == 0) {
+		struct rls_ident_estimate est[3];
+		bool valid = true;
+
+		for (int i = 0; i < 3; i++) {
+			valid &= rls_ident_estimate(&at_ident->axis[i],
+					&est[i]);
+		}
+
+		__atomic_store_n(&at_ident->seq, at_ident->seq + 1,
+				__ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+
+		memcpy(at_ident->est, est, sizeof(est));
+		at_ident->valid = valid;
+
+		__atomic_store_n(&at_ident->seq, at_ident->seq + 1,
+				__ATOMIC_RELEASE);
+	}
+}
+
+/**
+ * Take a consistent copy of the latest on-board estimates.
+ * \returns true if there's a model for every axis
+ */
+static bool at_get_estimates(struct rls_ident_estimate est[3])
+{
+	uint32_t seq;
+	bool valid;
+
+	do {
+		seq = __atomic_load_n(&at_ident->seq, __ATOMIC_ACQUIRE);
+
+		memcpy(est, at_ident->est, sizeof(at_ident->est));
+		valid = at_ident->valid;
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while ((seq & 1) ||
+			seq != __atomic_load_n(&at_ident->seq, __ATOMIC_RELAXED));
+
+	return valid;
 }
 
 static void UpdateSystemIdent(uint32_t predicts, float hover_throttle,
 		bool new_tune) {
 	SystemIdentData system_ident;
 
+	SystemIdentGet(&system_ident);
+
 	system_ident.NewTune = new_tune;
 	system_ident.NumAfPredicts = predicts;
 
 	system_ident.HoverThrottle = hover_throttle;
 
+	struct rls_ident_estimate est[3];
+
+	if (at_get_estimates(est)) {
+		for (int i = 0; i < 3; i++) {
+			system_ident.Tau[i] = est[i].tau;
+			system_ident.Beta[i] = est[i].beta;
+			system_ident.TauBound[i] = est[i].tau_bound;
+			system_ident.BetaBound[i] = est[i].beta_bound;
+		}
+	}
+
 	SystemIdentSet(&system_ident);
 }
 
@@ -277,14 +359,19 @@ static void autotune_step(const UAVObjEvent *ev,
 
 		uint16_t buf_size = sizeof(*at_averages) * decim_wiggle_points;
 		at_averages = PIOS_malloc(buf_size);
+		at_ident = PIOS_malloc(sizeof(*at_ident));
+
+		ident_dt = 1.0f / PIOS_SENSORS_GetSampleRate(PIOS_SENSOR_GYRO);
+
+		if (at_averages && at_ident) {
+			memset(at_ident, 0, sizeof(*at_ident));
 
-		if (at_averages) {
 			ActuatorDesiredConnectCallback(at_new_actuators);
 			PIOS_Modules_Enable(PIOS_MODULE_AUTOTUNE);
 		}
 	}
 
-	if (!at_averages) {
+	if (!at_averages || !at_ident) {
 		/* Do nothing because we couldn't get our buffer */
 		/* Assert alarm XXX? */
 		return;
@@ -75,6 +75,7 @@
 #define TASK_PRIORITY PIOS_THREAD_PRIO_LOW
 
 #define SPLASH_TIME_MS (5*1000)
+#define SNAPSHOT_PERIOD_MS 40	/* a frame or so */
 
 bool module_enabled;
 
@@ -233,30 +234,6 @@ static void update_availability(charosd_state_t state)
 
 }
 
-static void update_telemetry(charosd_state_t state)
-{
-	SystemStatsFlightTimeGet(&state->telemetry.system.flight_time);
-	AttitudeActualGet(&state->telemetry.attitude_actual);
-	PositionActualGet(&state->telemetry.position_actual);
-	StabilizationDesiredThrustGet(&state->telemetry.manual.thrust);
-	FlightStatusArmedGet(&state->telemetry.flight_status.arm_status);
-	FlightStatusFlightModeGet(&state->telemetry.flight_status.mode);
-
-	if (HAS_SENSOR(state->available, HAS_BATT)) {
-		FlightBatteryStateGet(&state->telemetry.battery);
-	}
-	if (HAS_SENSOR(state->available, HAS_GPS)) {
-		GPSPositionGet(&state->telemetry.gps_position);
-	}
-	if (HAS_SENSOR(state->available, HAS_RSSI)) {
-		ManualControlCommandRssiGet(&state->telemetry.manual.rssi);
-	}
-	if (HAS_SENSOR(state->available, HAS_ALT)
-	    || HAS_SENSOR(state->available, HAS_GPS)) {
-		VelocityActualGet(&state->telemetry.velocity_actual);
-	}
-}
-
 static void splash_screen(charosd_state_t state)
 {
 	PIOS_MAX7456_clear (state->dev);
@@ -287,7 +264,7 @@ static void CharOnScreenDisplayTask(void *parameters)
 
 	state->video_standard = 0xff;
 
-	bzero(&state->telemetry, sizeof(state->telemetry));
+	bzero(&state->snap, sizeof(state->snap));
 
 	CharOnScreenDisplaySettingsData page;
 	CharOnScreenDisplaySettingsGet(&page);
@@ -298,7 +275,7 @@ static void CharOnScreenDisplayTask(void *parameters)
 
 	while (1) {
 		update_availability(state);
-		update_telemetry(state);
+		state_snapshot_get(&state->snap);
 
 		CharOnScreenDisplaySettingsGet(&page);
 
@@ -342,6 +319,10 @@ int32_t CharOnScreenDisplayStart(void)
 	if (module_enabled) {
 		struct pios_thread *taskHandle;
 
+		if (state_snapshot_initialize(SNAPSHOT_PERIOD_MS) == -1) {
+			return -1;
+		}
+
 		taskHandle = PIOS_Thread_Create(CharOnScreenDisplayTask, "OnScreenDisplay", STACK_SIZE_BYTES, NULL, TASK_PRIORITY);
 		TaskMonitorAdd(TASKINFO_RUNNING_ONSCREENDISPLAY, taskHandle);
 
@@ -36,36 +36,12 @@
 #include "pios_max7456.h"
 #include "charonscreendisplaysettings.h"
 
-#include "attitudeactual.h"
-#include "flightbatterystate.h"
-#include "flightstatus.h"
-#include "gpsposition.h"
-#include "positionactual.h"
-#include "velocityactual.h"
-
-typedef struct {
-	FlightBatteryStateData battery;
-	AttitudeActualData attitude_actual;
-	PositionActualData position_actual;
-	VelocityActualData velocity_actual;
-	GPSPositionData gps_position;
-	struct {
-		int16_t rssi;
-		float thrust;
-	} manual;
-	struct {
-		FlightStatusArmedOptions arm_status;
-		SharedDefsFlightModeOptions mode;
-	} flight_status;
-	struct {
-		uint32_t flight_time;
-	} system;
-} telemetry_t;
+#include "state_snapshot.h"
 
 typedef struct {
 	max7456_dev_t dev;
 
-	telemetry_t telemetry;
+	struct state_snapshot snap;
 	char *custom_text;
 	uint8_t prev_font;
 	uint8_t video_standard;
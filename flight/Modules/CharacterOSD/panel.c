@@ -61,9 +61,6 @@
 
 #include "physical_constants.h"
 
-#include "airspeedactual.h"
-#include "flightstatus.h"
-#include "systemalarms.h"
 #include "modulesettings.h"
 
 static inline float pythag(float a, float b) {
@@ -131,14 +128,14 @@ static void draw_rect(charosd_state_t state, uint8_t l, uint8_t t, uint8_t w, ui
 
 
 /* Alt */
-STD_PANEL(ALTITUDE, 8, "\x85%d\x8d", (int16_t)round(-state->telemetry.position_actual.Down));
+STD_PANEL(ALTITUDE, 8, "\x85%d\x8d", (int16_t)round(-state->snap.position.Down));
 
 /* Climb */
 #define _PAN_CLIMB_SYMB 0x03
 
 static void CLIMB_update(charosd_state_t state, uint8_t x, uint8_t y)
 {
-	int8_t c = round(state->telemetry.velocity_actual.Down * -10);
+	int8_t c = round(state->snap.velocity.Down * -10);
 	uint8_t s;
 	char buffer[8];
 
@@ -149,7 +146,7 @@ static void CLIMB_update(charosd_state_t state, uint8_t x, uint8_t y)
 	else if (c <= -10) s = _PAN_CLIMB_SYMB + 1;
 	else s = _PAN_CLIMB_SYMB;
 	snprintf(buffer, sizeof (buffer), "%c%.1f\x8c", s,
-		 -(double)state->telemetry.velocity_actual.Down);
+		 -(double)state->snap.velocity.Down);
 	terminate_buffer();
 	PIOS_MAX7456_puts(state->dev, x, y, buffer, 0);
 }
@@ -160,7 +157,7 @@ static void FLIGHTMODE_update(charosd_state_t state, uint8_t x, uint8_t y)
 {
 	const char *mode = "INIT";
 
-	switch (state->telemetry.flight_status.mode) {
+	switch (state->snap.flight_status.FlightMode) {
 	case FLIGHTSTATUS_FLIGHTMODE_MANUAL:
 		mode = "MAN";
 		break;
@@ -234,14 +231,14 @@ static void FLIGHTMODE_update(charosd_state_t state, uint8_t x, uint8_t y)
 /* ArmedFlag */
 static void ARMEDFLAG_update(charosd_state_t state, uint8_t x, uint8_t y)
 {
-	uint8_t attr = state->telemetry.flight_status.arm_status == FLIGHTSTATUS_ARMED_ARMED ? 0 : MAX7456_ATTR_INVERT;
+	uint8_t attr = state->snap.flight_status.Armed == FLIGHTSTATUS_ARMED_ARMED ? 0 : MAX7456_ATTR_INVERT;
 	draw_rect(state, x, y, 3, 3, true, attr);
 	PIOS_MAX7456_put(state->dev, x + 1, y + 1, 0xe0, attr);
 }
 
 static void FLIGHTTIME_update(charosd_state_t state, uint8_t x, uint8_t y) {
        char buffer[10];
-       uint32_t time = state->telemetry.system.flight_time;
+       uint32_t time = state->snap.stats.FlightTime;
        int min, sec;
 
        uint16_t hours = (time / 3600000); // hours
@@ -261,10 +258,10 @@ static void FLIGHTTIME_update(charosd_state_t state, uint8_t x, uint8_t y) {
 }
 
 /* Roll */
-STD_PANEL(ROLL, 7, "\xb2%d\xb0", (int16_t) state->telemetry.attitude_actual.Roll);
+STD_PANEL(ROLL, 7, "\xb2%d\xb0", (int16_t) state->snap.attitude.Roll);
 
 /* Pitch */
-STD_PANEL(PITCH, 7, "\xb1%d\xb0", (int16_t) state->telemetry.attitude_actual.Pitch);
+STD_PANEL(PITCH, 7, "\xb1%d\xb0", (int16_t) state->snap.attitude.Pitch);
 
 /* GPS */
 
@@ -275,12 +272,12 @@ static void GPS_update(charosd_state_t state, uint8_t x, uint8_t y)
 {
 	char buffer[4];
 
-	snprintf(buffer, sizeof(buffer), "%d", state->telemetry.gps_position.Satellites);
+	snprintf(buffer, sizeof(buffer), "%d", state->snap.gps_position.Satellites);
 	terminate_buffer();
-	bool err = state->telemetry.gps_position.Status < GPSPOSITION_STATUS_FIX2D;
+	bool err = state->snap.gps_position.Status < GPSPOSITION_STATUS_FIX2D;
 	PIOS_MAX7456_puts(state->dev, x, y, "\x10\x11", err ? MAX7456_ATTR_INVERT : 0);
-	PIOS_MAX7456_put(state->dev, x + 2, y, state->telemetry.gps_position.Status < GPSPOSITION_STATUS_FIX3D ? _PAN_GPS_2D : _PAN_GPS_3D,
-		err ? MAX7456_ATTR_INVERT : (state->telemetry.gps_position.Status < GPSPOSITION_STATUS_FIX2D ? MAX7456_ATTR_BLINK : 0));
+	PIOS_MAX7456_put(state->dev, x + 2, y, state->snap.gps_position.Status < GPSPOSITION_STATUS_FIX3D ? _PAN_GPS_2D : _PAN_GPS_3D,
+		err ? MAX7456_ATTR_INVERT : (state->snap.gps_position.Status < GPSPOSITION_STATUS_FIX2D ? MAX7456_ATTR_BLINK : 0));
 	if (err) PIOS_MAX7456_puts (state->dev, x + 3, y, ERR_STR, MAX7456_ATTR_INVERT);
 	else PIOS_MAX7456_puts(state->dev, x + 3, y, buffer, 0);
 }
@@ -288,10 +285,10 @@ static void GPS_update(charosd_state_t state, uint8_t x, uint8_t y)
 // Would be nice to convert these to fixed point in the future.
 
 /* Lat */
-STD_PANEL(LATITUDE, 11, "\x83%02.6f", (double)state->telemetry.gps_position.Latitude / 10000000.0);
+STD_PANEL(LATITUDE, 11, "\x83%02.6f", (double)state->snap.gps_position.Latitude / 10000000.0);
 
 /* Lon */
-STD_PANEL(LONGITUDE, 11, "\x84%02.6f", (double)state->telemetry.gps_position.Longitude / 10000000.0);
+STD_PANEL(LONGITUDE, 11, "\x84%02.6f", (double)state->snap.gps_position.Longitude / 10000000.0);
 
 #define PANEL_HORIZON_WIDTH 14
 #define PANEL_HORIZON_HEIGHT 5
@@ -318,8 +315,8 @@ void HORIZON_update(charosd_state_t state, uint8_t x, uint8_t y)
 	}
 
 	// code below from minoposd
-	int16_t pitch_line = tanf(DEG2RAD * (-state->telemetry.attitude_actual.Pitch)) * _PAN_HORZ_LINES;
-	float roll = tanf(DEG2RAD * state->telemetry.attitude_actual.Roll);
+	int16_t pitch_line = tanf(DEG2RAD * (-state->snap.attitude.Pitch)) * _PAN_HORZ_LINES;
+	float roll = tanf(DEG2RAD * state->snap.attitude.Roll);
 	for (uint8_t col = 1; col <= _PAN_HORZ_INT_WIDTH; col ++) {
 		// center X point at middle of each column
 		float middle = col * _PAN_HORZ_INT_WIDTH - (_PAN_HORZ_INT_WIDTH * _PAN_HORZ_INT_WIDTH / 2) - _PAN_HORZ_INT_WIDTH / 2;
@@ -340,26 +337,26 @@ void HORIZON_update(charosd_state_t state, uint8_t x, uint8_t y)
 }
 
 /* Throttle */
-STD_PANEL(THROTTLE, 7, "\x87%d%%", (int)MAX(-99, state->telemetry.manual.thrust*100));
+STD_PANEL(THROTTLE, 7, "\x87%d%%", (int)MAX(-99, state->snap.stab_desired.Thrust*100));
 
 /* GroundSpeed */
 STD_PANEL(GROUNDSPEED, 7, "\x80%d\x81",
-		(int)roundf(pythag(state->telemetry.velocity_actual.North,
-				state->telemetry.velocity_actual.East) * 3.6f));
+		(int)roundf(pythag(state->snap.velocity.North,
+				state->snap.velocity.East) * 3.6f));
 // * 3.6 == m/s to km/hr
 
-STD_PANEL(BATTERYVOLT, 8, "%.2f\x8e", (double)state->telemetry.battery.Voltage);
+STD_PANEL(BATTERYVOLT, 8, "%.2f\x8e", (double)state->snap.battery.Voltage);
 
 /* BatCurrent */
-STD_PANEL(BATTERYCURRENT, 8, "%.2f\x8f", (double)state->telemetry.battery.Current);
+STD_PANEL(BATTERYCURRENT, 8, "%.2f\x8f", (double)state->snap.battery.Current);
 
 /* BatConsumed */
-STD_PANEL(BATTERYCONSUMED, 8, "%u\x82", (uint16_t) state->telemetry.battery.ConsumedEnergy);
+STD_PANEL(BATTERYCONSUMED, 8, "%u\x82", (uint16_t) state->snap.battery.ConsumedEnergy);
 
 /* RSSIFlag */
 static void RSSIFLAG_update (charosd_state_t state, uint8_t x, uint8_t y)
 {
-	if (state->telemetry.manual.rssi < 50) {
+	if (state->snap.manual_control.Rssi < 50) {
 		PIOS_MAX7456_put (state->dev, x, y, 0xb4, MAX7456_ATTR_BLINK);
 	}
 }
@@ -367,8 +364,8 @@ static void RSSIFLAG_update (charosd_state_t state, uint8_t x, uint8_t y)
 static void HOMEDISTANCE_update(charosd_state_t state, uint8_t x, uint8_t y)
 {
 	char buffer[8];
-	float dist = pythag(state->telemetry.position_actual.North,
-			    state->telemetry.position_actual.East);
+	float dist = pythag(state->snap.position.North,
+			    state->snap.position.East);
 	if (dist > 1000) {
 		snprintf(buffer, sizeof(buffer), "%.2f%c",
 			 (double)dist/1000, CHAROSD_CHAR_KM);
@@ -386,10 +383,10 @@ static void HOMEDISTANCE_update(charosd_state_t state, uint8_t x, uint8_t y)
 static void HOMEDIRECTION_update(charosd_state_t state, uint8_t x, uint8_t y)
 {
 	if (HAS_SENSOR(state->available, HAS_COMPASS)) {
-		float home_dir = (atan2f(state->telemetry.position_actual.East,
-					 state->telemetry.position_actual.North) * RAD2DEG) + 180;
+		float home_dir = (atan2f(state->snap.position.East,
+					 state->snap.position.North) * RAD2DEG) + 180;
 
-		home_dir -= state->telemetry.attitude_actual.Yaw;
+		home_dir -= state->snap.attitude.Yaw;
 
 		uint8_t chr = _ARROWS + (0xf & (((uint8_t) (home_dir / 360.0f * 16.0f)) * 2));
 		PIOS_MAX7456_put(state->dev, x, y, chr, 0);
@@ -397,7 +394,7 @@ static void HOMEDIRECTION_update(charosd_state_t state, uint8_t x, uint8_t y)
 	}
 }
 
-STD_PANEL(HEADING, 6, "%d%c", (int)(round(state->telemetry.attitude_actual.Yaw)+360) % 360, CHAROSD_CHAR_DEG);
+STD_PANEL(HEADING, 6, "%d%c", (int)(round(state->snap.attitude.Yaw)+360) % 360, CHAROSD_CHAR_DEG);
 
 /* Callsign */
 STD_PANEL(CALLSIGN, 11, "%s", state->custom_text);
@@ -417,9 +414,9 @@ static void RSSI_update(charosd_state_t state, uint8_t x, uint8_t y)
 
 	const char * const levels [] = { _l0, _l1, _l2, _l3, _l4, _l5 };
 
-	uint8_t level = (state->telemetry.manual.rssi + 10) / 20;
+	uint8_t level = (state->snap.manual_control.Rssi + 10) / 20;
 
-	if (level == 0 && state->telemetry.manual.rssi > 0) level = 1;
+	if (level == 0 && state->snap.manual_control.Rssi > 0) level = 1;
 	if (level > 5) level = 5;
 
 	PIOS_MAX7456_puts (state->dev, x, y, levels[level], 0);
@@ -437,7 +434,7 @@ static void COMPASS_update(charosd_state_t state, uint8_t x, uint8_t y)
 
 	const int8_t ruler_size = sizeof(ruler);
 
-	int16_t offset = (int16_t)round(state->telemetry.attitude_actual.Yaw * ruler_size
+	int16_t offset = (int16_t)round(state->snap.attitude.Yaw * ruler_size
 					/ 360.0f) - (sizeof(buffer) - 1) / 2;
 	if (offset < 0) offset += ruler_size;
 	for (uint8_t i = 0; i < sizeof (buffer) - 1; i ++) {
@@ -455,9 +452,8 @@ static void COMPASS_update(charosd_state_t state, uint8_t x, uint8_t y)
 static void AIRSPEED_update(charosd_state_t state, uint8_t x, uint8_t y)
 {
 	char buffer[7];
-	float airspeed;
-	AirspeedActualTrueAirspeedGet(&airspeed);
-	snprintf(buffer, sizeof(buffer), "\x88%d\x81", (int)(airspeed * 3.6f));
+	snprintf(buffer, sizeof(buffer), "\x88%d\x81",
+		 (int)(state->snap.airspeed.TrueAirspeed * 3.6f));
 	terminate_buffer();
 	PIOS_MAX7456_puts(state->dev, x, y + 1, buffer, 0);
 }
@@ -469,12 +465,10 @@ STD_PANEL(CROSSHAIR, 2, "%c", 0x0a);
 
 static void ALARMS_update(charosd_state_t state, uint8_t x, uint8_t y)
 {
-	SystemAlarmsData alarm;
-	SystemAlarmsGet(&alarm);
 	char buffer[MAX_ALARM_LEN+1];
 
 	uint8_t alarm_state;
-	AlarmString(&alarm, buffer, sizeof(buffer), false, &alarm_state);
+	AlarmString(&state->snap.alarms, buffer, sizeof(buffer), false, &alarm_state);
 	PIOS_MAX7456_puts(state->dev, x, y, buffer, 0);
 }
 
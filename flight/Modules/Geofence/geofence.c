@@ -10,6 +10,11 @@
  * @author     dRonin, http://dronin.org Copyright (C) 2015
  * @brief      Check the UAV is within the geofence boundaries
  *
+ * Besides the two radii around home, any number of polygon zones can be
+ * uploaded as GeoFenceZone and GeoFenceVertex instances.  They're indexed
+ * by polyfence whenever they change, and checked both where the aircraft is
+ * and along its velocity for the next LookaheadTime seconds.
+ *
  * @see        The GNU Public License (GPL) Version 3
  *
  *****************************************************************************/
@@ -33,16 +38,23 @@
 #include <eventdispatcher.h>
 #include "misc_math.h"
 #include "physical_constants.h"
+#include "pios_thread.h"
+
+#include "polyfence.h"
 
 #include "geofencesettings.h"
+#include "geofencevertex.h"
+#include "geofencezone.h"
 #include "positionactual.h"
+#include "velocityactual.h"
 #include "modulesettings.h"
 
 
 //
 // Configuration
 //
-#define SAMPLE_PERIOD_MS     250
+#define SAMPLE_PERIOD_MS     100
+#define REBUILD_HOLDOFF_MS   500	//!< Quiet time after zone changes before rebuilding
 
 // Private types
 
@@ -53,9 +65,24 @@ static void settingsUpdated(const UAVObjEvent *ev,
 		void *ctx, void *obj, int len);
 static void checkPosition(const UAVObjEvent *ev,
 		void *ctx, void *obj, int len);
+static void zonesUpdated(const UAVObjEvent *ev,
+		void *ctx, void *obj, int len);
+static void rebuildFence(void);
 
 // Private variables
 static GeoFenceSettingsData *geofenceSettings;
+static float warningRadius2;
+static float errorRadius2;
+
+static volatile bool zonesChanged = true;
+static volatile uint32_t zonesChangedTime;
+static bool fenceIncomplete;
+static struct polyfence_zone *zones;
+static struct polyfence *fence;
+static void *fenceMem;
+static size_t fenceMemSize;
+static float (*vertices)[2];
+static uint16_t verticesSize;
 
 /**
  * Initialise the module, called on startup
@@ -77,7 +104,9 @@ int32_t GeofenceInitialize(void)
 	}
 #endif
 
-	if (GeoFenceSettingsInitialize() == -1) {
+	if (GeoFenceSettingsInitialize() == -1 ||
+			GeoFenceZoneInitialize() == -1 ||
+			GeoFenceVertexInitialize() == -1) {
 		module_enabled = false;
 		return -1;
 	}
@@ -90,9 +119,19 @@ int32_t GeofenceInitialize(void)
 			return -1;
 		}
 
+		zones = PIOS_malloc(POLYFENCE_MAX_ZONES * sizeof(*zones));
+		if (zones == NULL) {
+			PIOS_free(geofenceSettings);
+			geofenceSettings = NULL;
+			return -1;
+		}
+
 		GeoFenceSettingsConnectCallback(settingsUpdated);
 		settingsUpdated(NULL, NULL, NULL, 0);
 
+		GeoFenceZoneConnectCallback(zonesUpdated);
+		GeoFenceVertexConnectCallback(zonesUpdated);
+
 		return 0;
 	}
 
@@ -127,16 +166,60 @@ static void checkPosition(const UAVObjEvent *ev,
 		void *ctx, void *obj, int len)
 {
 	(void) ev; (void) ctx; (void) obj; (void) len;
+
+	/* Zones and vertices come in one object at a time; wait for them to
+	 * settle rather than rebuilding after each.
+	 */
+	if (zonesChanged && PIOS_Thread_Period_Elapsed(zonesChangedTime,
+				REBUILD_HOLDOFF_MS)) {
+		zonesChanged = false;
+		rebuildFence();
+	}
+
 	if (PositionActualHandle()) {
 		PositionActualData positionActual;
 		PositionActualGet(&positionActual);
 
 		const float distance2 = powf(positionActual.North, 2) + powf(positionActual.East, 2);
 
-		// ErrorRadius is squared when it is fetched, so this is correct
-		if (distance2 > geofenceSettings->ErrorRadius) {
+		bool breached = distance2 > errorRadius2;
+		bool breachAhead = distance2 > warningRadius2;
+
+		if (fence && !breached) {
+			const float pos[3] = {
+				positionActual.North,
+				positionActual.East,
+				-positionActual.Down
+			};
+
+			struct polyfence_result result;
+			polyfence_check(fence, pos, &result);
+
+			breached = result.breached;
+
+			if (!breached && !breachAhead && VelocityActualHandle()) {
+				VelocityActualData velocityActual;
+				VelocityActualGet(&velocityActual);
+
+				const float vel[3] = {
+					velocityActual.North,
+					velocityActual.East,
+					-velocityActual.Down
+				};
+
+				float timeToBreach;
+				breachAhead = polyfence_predict(fence, pos, vel,
+						geofenceSettings->LookaheadTime,
+						&timeToBreach);
+			}
+		}
+
+		if (fenceIncomplete) {
+			/* Part of the fence can't be checked; fail closed */
+			AlarmsSet(SYSTEMALARMS_ALARM_GEOFENCE, SYSTEMALARMS_ALARM_CRITICAL);
+		} else if (breached) {
 			AlarmsSet(SYSTEMALARMS_ALARM_GEOFENCE, SYSTEMALARMS_ALARM_ERROR);
-		} else if (distance2 > geofenceSettings->WarningRadius) {
+		} else if (breachAhead) {
 			AlarmsSet(SYSTEMALARMS_ALARM_GEOFENCE, SYSTEMALARMS_ALARM_WARNING);
 		} else {
 			AlarmsClear(SYSTEMALARMS_ALARM_GEOFENCE);
@@ -144,6 +227,115 @@ static void checkPosition(const UAVObjEvent *ev,
 	}
 }
 
+/**
+ * Rebuild the polygon fence from the zone and vertex instances.  The
+ * buffers are kept and only grown, as zones tend to be uploaded in pieces.
+ * If some of the zones can't be checked, fenceIncomplete is set.
+ */
+static void rebuildFence(void)
+{
+	fence = NULL;
+	fenceIncomplete = false;
+
+	uint16_t numZones = GeoFenceZoneGetNumInstances();
+	uint16_t numVertices = GeoFenceVertexGetNumInstances();
+
+	if (numZones > POLYFENCE_MAX_ZONES) {
+		numZones = POLYFENCE_MAX_ZONES;
+		fenceIncomplete = true;
+	}
+
+	bool anyEnabled = false;
+
+	for (uint16_t i = 0; i < numZones; i++) {
+		GeoFenceZoneData zone;
+		GeoFenceZoneInstGet(i, &zone);
+
+		switch (zone.Type) {
+		case GEOFENCEZONE_TYPE_KEEPIN:
+			zones[i].type = POLYFENCE_KEEP_IN;
+			anyEnabled = true;
+			break;
+		case GEOFENCEZONE_TYPE_KEEPOUT:
+			zones[i].type = POLYFENCE_KEEP_OUT;
+			anyEnabled = true;
+			break;
+		default:
+			zones[i].type = POLYFENCE_DISABLED;
+			break;
+		}
+
+		zones[i].floor = zone.Floor;
+		zones[i].ceiling = zone.Ceiling;
+		zones[i].first_vertex = zone.FirstVertex;
+		zones[i].num_vertices = zone.VertexCount;
+	}
+
+	if (!anyEnabled) {
+		return;
+	}
+
+	if (numVertices > verticesSize) {
+		PIOS_free(vertices);
+		verticesSize = 0;
+
+		vertices = PIOS_malloc(numVertices * sizeof(vertices[0]));
+		if (vertices == NULL) {
+			fenceIncomplete = true;
+			return;
+		}
+
+		verticesSize = numVertices;
+	}
+
+	for (uint16_t i = 0; i < numVertices; i++) {
+		GeoFenceVertexData vertex;
+		GeoFenceVertexInstGet(i, &vertex);
+
+		vertices[i][0] = vertex.North;
+		vertices[i][1] = vertex.East;
+	}
+
+	/* Zones too short or past the vertices are left out of the fence */
+	if (polyfence_rejected_zones(zones, numZones, numVertices) > 0) {
+		fenceIncomplete = true;
+	}
+
+	size_t size = polyfence_size(zones, numZones, vertices, numVertices);
+
+	if (size > fenceMemSize) {
+		PIOS_free(fenceMem);
+		fenceMemSize = 0;
+
+		fenceMem = PIOS_malloc(size);
+		if (fenceMem == NULL) {
+			fenceIncomplete = true;
+			return;
+		}
+
+		fenceMemSize = size;
+	}
+
+	fence = polyfence_build(fenceMem, fenceMemSize, zones, numZones,
+			vertices, numVertices);
+
+	if (fence == NULL) {
+		fenceIncomplete = true;
+	}
+}
+
+/**
+ * Flag the fence to be rebuilt once the zones stop changing
+ */
+static void zonesUpdated(const UAVObjEvent *ev,
+		void *ctx, void *obj, int len)
+{
+	(void) ev; (void) ctx; (void) obj; (void) len;
+
+	zonesChangedTime = PIOS_Thread_Systime();
+	zonesChanged = true;
+}
+
 /**
  * Update the settings
  */
@@ -154,8 +346,8 @@ static void settingsUpdated(const UAVObjEvent *ev,
 	GeoFenceSettingsGet(geofenceSettings);
 
 	// Cache squared distances to save computations
-	geofenceSettings->WarningRadius = powf(geofenceSettings->WarningRadius, 2);
-	geofenceSettings->ErrorRadius = powf(geofenceSettings->ErrorRadius, 2);
+	warningRadius2 = powf(geofenceSettings->WarningRadius, 2);
+	errorRadius2 = powf(geofenceSettings->ErrorRadius, 2);
 }
 
 /**
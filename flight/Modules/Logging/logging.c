@@ -83,6 +83,9 @@ const char DIGITS[16] = "0123456789abcdef";
 
 #define LOGGING_PERIOD_MS 100
 
+//! Most trace packets written per logging period
+#define TRACE_CHUNKS_PER_PERIOD 32
+
 // Private types
 
 // Private variables
@@ -104,6 +107,10 @@ static void logAll(UAVObjHandle obj);
 static void logSettings(UAVObjHandle obj);
 static void writeHeader();
 static void updateSettings();
+#if defined(PIOS_INCLUDE_TRACE)
+static void updateTraceMask();
+static void logTrace(bool restart);
+#endif
 
 // Local variables
 static uintptr_t logging_com_id;
@@ -258,6 +265,10 @@ static void loggingTask(void *parameters)
 	{
 		LoggingStatsGet(&loggingData);
 
+#if defined(PIOS_INCLUDE_TRACE)
+		updateTraceMask();
+#endif
+
 		// Check for change in armed state if logging on armed
 
 		if (settings.LogBehavior == LOGGINGSETTINGS_LOGBEHAVIOR_LOGONARM) {
@@ -346,6 +357,10 @@ static void loggingTask(void *parameters)
 					break;
 			}
 
+#if defined(PIOS_INCLUDE_TRACE)
+			logTrace(true);
+#endif
+
 			// Empty the queue
 			LoggingStatsBytesLoggedSet(&written_bytes);
 			loggingData.Operation = LOGGINGSTATS_OPERATION_LOGGING;
@@ -356,6 +371,10 @@ static void loggingTask(void *parameters)
 				// Sleep between updating stats.
 				PIOS_Thread_Sleep_Until(&now, LOGGING_PERIOD_MS);
 
+#if defined(PIOS_INCLUDE_TRACE)
+				logTrace(false);
+#endif
+
 				LoggingStatsBytesLoggedSet(&written_bytes);
 
 				now = PIOS_Thread_Systime();
@@ -428,6 +447,69 @@ static void loggingTask(void *parameters)
 	}
 }
 
+#if defined(PIOS_INCLUDE_TRACE)
+/**
+ * Set which trace events are recorded from LoggingSettings
+ */
+static void updateTraceMask()
+{
+	static const uint32_t classes[LOGGINGSETTINGS_TRACE_NUMELEM] = {
+		[LOGGINGSETTINGS_TRACE_TASK] = PIOS_TRACE_MASK_TASK,
+		[LOGGINGSETTINGS_TRACE_QUEUE] = PIOS_TRACE_MASK_QUEUE,
+		[LOGGINGSETTINGS_TRACE_EVENT] = PIOS_TRACE_MASK_EVENT,
+		[LOGGINGSETTINGS_TRACE_ISR] = PIOS_TRACE_MASK_ISR,
+		[LOGGINGSETTINGS_TRACE_USER] = PIOS_TRACE_MASK_USER,
+	};
+
+	uint32_t mask = 0;
+
+	for (int i = 0; i < LOGGINGSETTINGS_TRACE_NUMELEM; i++) {
+		if (settings.Trace[i] == LOGGINGSETTINGS_TRACE_ENABLED) {
+			mask |= classes[i];
+		}
+	}
+
+	if (mask != pios_trace_mask) {
+		PIOS_Trace_SetMask(mask);
+	}
+}
+
+/**
+ * Write pending trace records into the log, as file data packets
+ * \param[in] restart true at the start of a log, to write the trace header
+ */
+static void logTrace(bool restart)
+{
+	static uint32_t offset;
+	static bool header_pending;
+	uint8_t buf[UAVTALK_MAX_FILEDATA_LENGTH];
+
+	if (restart) {
+		offset = 0;
+		header_pending = true;
+	}
+
+	/* Nothing goes in the log until tracing is enabled */
+	if (!pios_trace_mask) {
+		return;
+	}
+
+	for (int i = 0; i < TRACE_CHUNKS_PER_PERIOD; i++) {
+		int32_t len = PIOS_Trace_Read(buf, sizeof(buf), header_pending);
+
+		if (len <= 0) {
+			break;
+		}
+
+		header_pending = false;
+
+		UAVTalkSendFileData(uavTalkCon, PIOS_TRACE_FILE_ID, offset, 0,
+				buf, len);
+		offset += len;
+	}
+}
+#endif /* PIOS_INCLUDE_TRACE */
+
 /**
  * Log all objects' initial value.
  * \param[in] obj Object to log
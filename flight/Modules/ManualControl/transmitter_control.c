@@ -37,6 +37,7 @@
 #include "control.h"
 #include "transmitter_control.h"
 #include "pios_thread.h"
+#include "pios_rcvr.h"
 
 #include "altitudeholdsettings.h"
 #include "baroaltitude.h"
@@ -48,6 +49,7 @@
 #include "receiveractivity.h"
 #include "systemsettings.h"
 
+#include "control_latency.h"
 #include "misc_math.h"
 
 #if defined(PIOS_INCLUDE_OPENLRS_RCVR)
@@ -76,6 +78,10 @@
  * arming, etc. */
 #define MIN_MEANINGFUL_RANGE 40
 
+/* Channels read from each receiver a frame at a time; any configured
+ * beyond this are read on their own. */
+#define FRAME_CHANNELS 18
+
 struct rcvr_activity_fsm {
 	ManualControlSettingsChannelGroupsOptions group;
 	uint16_t prev[RCVR_ACTIVITY_MONITOR_CHANNELS_PER_GROUP];
@@ -93,6 +99,7 @@ static uint8_t                    connected_count = 0;
 static struct rcvr_activity_fsm   activity_fsm;
 static uint32_t                   lastActivityTime;
 static uint32_t                   lastSysTime;
+static uint32_t                   last_frame_count;
 static float                      flight_mode_value;
 static enum control_status        control_status;
 static bool                       settings_updated;
@@ -112,6 +119,7 @@ static uint32_t timeDifferenceMs(uint32_t start_time, uint32_t end_time);
 static void resetRcvrActivity(struct rcvr_activity_fsm * fsm);
 static bool updateRcvrActivity(struct rcvr_activity_fsm * fsm);
 static void set_loiter_command(ManualControlCommandData *cmd);
+static void read_channels(void);
 
 // Exposed from manualcontrol to prevent attempts to arm when unsafe
 extern bool ok_to_arm();
@@ -142,7 +150,8 @@ int32_t transmitter_control_initialize()
 			|| StabilizationDesiredInitialize() == -1
 			|| ReceiverActivityInitialize() == -1
 			|| LoiterCommandInitialize() == -1
-			|| ManualControlSettingsInitialize() == -1) {
+			|| ManualControlSettingsInitialize() == -1
+			|| control_latency_initialize() == -1) {
 		return -1;
 	}
 
@@ -367,19 +376,17 @@ int32_t transmitter_control_update()
 
 	bool valid_input_detected = true;
 
+	/* Note the frame being processed before reading it, so the latency
+	 * is never understated if another arrives meanwhile */
+	uint32_t frame_time;
+	uint32_t frame_count = PIOS_RCVR_GetFrameTime(&frame_time);
+
 	// Read channel values in us
+	read_channels();
+
 	for (uint8_t n = 0;
 	     n < MANUALCONTROLSETTINGS_CHANNELGROUPS_NUMELEM && n < MANUALCONTROLCOMMAND_CHANNEL_NUMELEM;
 	     ++n) {
-
-		if (settings.ChannelGroups[n] >= MANUALCONTROLSETTINGS_CHANNELGROUPS_NONE) {
-			cmd.Channel[n] = PIOS_RCVR_INVALID;
-			validChannel[n] = false;
-		} else {
-			cmd.Channel[n] = PIOS_RCVR_Read(pios_rcvr_group_map[settings.ChannelGroups[n]],
-							settings.ChannelNumber[n]);
-		}
-
 		// If a channel has timed out this is not valid data and we shouldn't update anything
 		// until we decide to go to failsafe
 		if(cmd.Channel[n] == (uint16_t) PIOS_RCVR_TIMEOUT) {
@@ -528,9 +535,62 @@ int32_t transmitter_control_update()
 	// Update cmd object
 	ManualControlCommandSet(&cmd);
 
+	if (frame_count != last_frame_count && valid_input_detected &&
+			cmd.Connected == MANUALCONTROLCOMMAND_CONNECTED_TRUE) {
+		control_latency_command(frame_time);
+	}
+
+	last_frame_count = frame_count;
+
 	return 0;
 }
 
+/**
+ * Read the configured channels into the ManualControlCommand. Each
+ * receiver in use is read a whole frame at once, so the sticks are all
+ * from the same frame.
+ */
+static void read_channels(void)
+{
+	for (int group = 0; group < MANUALCONTROLSETTINGS_CHANNELGROUPS_NONE; group++) {
+		uint8_t needed = 0;
+
+		for (int n = 0; n < MANUALCONTROLSETTINGS_CHANNELGROUPS_NUMELEM; n++) {
+			if (settings.ChannelGroups[n] == group &&
+					settings.ChannelNumber[n] <= FRAME_CHANNELS) {
+				needed = MAX(needed, settings.ChannelNumber[n]);
+			}
+		}
+
+		int16_t frame[FRAME_CHANNELS];
+
+		/* With nothing to read, the loop below still marks the
+		 * group's unassigned channels invalid */
+		if (needed) {
+			PIOS_RCVR_ReadFrame(pios_rcvr_group_map[group], frame, needed);
+		}
+
+		for (int n = 0; n < MANUALCONTROLSETTINGS_CHANNELGROUPS_NUMELEM; n++) {
+			if (settings.ChannelGroups[n] == group &&
+					settings.ChannelNumber[n] <= FRAME_CHANNELS) {
+				/* Channel numbers are offset, 0 means "none" */
+				cmd.Channel[n] = settings.ChannelNumber[n] ?
+					frame[settings.ChannelNumber[n] - 1] :
+					PIOS_RCVR_INVALID;
+			}
+		}
+	}
+
+	for (int n = 0; n < MANUALCONTROLSETTINGS_CHANNELGROUPS_NUMELEM; n++) {
+		if (settings.ChannelGroups[n] >= MANUALCONTROLSETTINGS_CHANNELGROUPS_NONE) {
+			cmd.Channel[n] = PIOS_RCVR_INVALID;
+		} else if (settings.ChannelNumber[n] > FRAME_CHANNELS) {
+			cmd.Channel[n] = PIOS_RCVR_Read(pios_rcvr_group_map[settings.ChannelGroups[n]],
+							settings.ChannelNumber[n]);
+		}
+	}
+}
+
 /**
  * Select and use transmitter control
  * @param [in] reset_controller True if previously another controller was used
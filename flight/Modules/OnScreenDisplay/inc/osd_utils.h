@@ -51,6 +51,9 @@
 // Edge cases.
 #define COMPUTE_HLINE_EDGE_L_MASK(b)      ((1 << (8 - (b))) - 1)
 #define COMPUTE_HLINE_EDGE_R_MASK(b)      (~((1 << (7 - (b))) - 1))
+// Span edges, both inclusive of the pixel at x.
+#define SPAN_EDGE_L_MASK(x)               (0xFF >> ((x) & 7))
+#define SPAN_EDGE_R_MASK(x)               ((uint8_t)(0xFF << (7 - ((x) & 7))))
 #else
 #if PIOS_VIDEO_BITS_PER_PIXEL != 2
 #error "Only 2 bits / pixel is currently supported"
@@ -66,6 +69,9 @@
 // Edge cases.
 #define COMPUTE_HLINE_EDGE_L_MASK(b)      ((1 << (7 - (b))) - 1)
 #define COMPUTE_HLINE_EDGE_R_MASK(b)      (~((1 << (6 - (b))) - 1))
+// Span edges, both inclusive of the pixel at x.
+#define SPAN_EDGE_L_MASK(x)               (0xFF >> (2 * ((x) & 3)))
+#define SPAN_EDGE_R_MASK(x)               ((uint8_t)(0xFF << (6 - 2 * ((x) & 3))))
 #endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
 
 // Macros for computing addresses and bit positions.
@@ -171,6 +177,7 @@ void ellipse(int centerX, int centerY, int horizontalRadius, int verticalRadius)
 void drawArrow(uint16_t x, uint16_t y, uint16_t angle, uint16_t size_quarter);
 void drawBox(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
 void write_pixel_lm(int x, int y, int mmode, int lmode);
+void write_span_lm(int x0, int x1, int y, int lmode, int mmode);
 void write_hline_lm(int x0, int x1, int y, int lmode, int mmode);
 void write_hline_outlined(int x0, int x1, int y, int endcap0, int endcap1, int mode, int mmode);
 void write_vline_lm(int x, int y0, int y1, int lmode, int mmode);
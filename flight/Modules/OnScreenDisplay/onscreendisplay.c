@@ -73,6 +73,7 @@
 #include "pios_video.h"
 
 #include "physical_constants.h"
+#include "state_snapshot.h"
 
 #include "accels.h"
 #include "airspeedactual.h"
@@ -124,6 +125,7 @@ static void onScreenDisplayTask(void *parameters);
 #define TASK_PRIORITY    PIOS_THREAD_PRIO_LOW
 #define BLINK_INTERVAL_FRAMES 12
 #define BOOT_DISPLAY_TIME_MS (10*1000)
+#define SNAPSHOT_PERIOD_MS 20	/* a video field */
 #define STATS_DELAY_MS 1500
 
 const char METRIC_DIST_UNIT_LONG[] = "km";
@@ -195,6 +197,7 @@ float home_baro_altitude = 0;
 static volatile bool osd_settings_updated = true;
 static volatile bool osd_page_updated = true;
 static OnScreenDisplaySettingsData osd_settings;
+static struct state_snapshot *snap;
 static bool blink;
 
 
@@ -635,7 +638,7 @@ void simple_artificial_horizon(float roll, float pitch, int16_t x, int16_t y,
 void draw_flight_mode(int x, int y, int xs, int ys, int va, int ha, int flags, int font)
 {
 	SharedDefsFlightModeOptions mode;
-	FlightStatusFlightModeGet(&mode);
+	mode = snap->flight_status.FlightMode;
 
 	switch (mode)
 	{
@@ -733,14 +736,12 @@ void draw_flight_mode(int x, int y, int xs, int ys, int va, int ha, int flags, i
 void draw_alarms(int x, int y, int xs, int ys, int va, int ha, int flags, int font)
 {
 	char buf[100]  = { 0 };
-	SystemAlarmsData alarm;
+	const SystemAlarmsData *alarm = &snap->alarms;
 	int pos = 0;
 
-	SystemAlarmsGet(&alarm);
-
 	// Boot alarm for a bit.
 	if (PIOS_Thread_Systime() < BOOT_DISPLAY_TIME_MS) {
-		const char *boot_reason = AlarmBootReason(alarm.RebootCause);
+		const char *boot_reason = AlarmBootReason(alarm->RebootCause);
 		strncpy((char*)buf, boot_reason, sizeof(buf));
 		buf[sizeof(buf) - 2] = '\0';
 		pos = strlen(buf);
@@ -752,7 +753,7 @@ void draw_alarms(int x, int y, int xs, int ys, int va, int ha, int flags, int fo
 	// With the above arrangement, can pass a length of 1 to this if
 	// there's an impossibly long boot reason.
 	// which then does the right thing and just fills it with a null.
-	int32_t len = AlarmString(&alarm, buf + pos, sizeof(buf) - pos,
+	int32_t len = AlarmString(alarm, buf + pos, sizeof(buf) - pos,
 			blink, &state);
 
 	if (len > 0) {
@@ -825,8 +826,8 @@ void draw_map_home_center(int width_px, int height_px, int width_m, int height_m
 	}
 
 	// draw UAV position and orientation
-	PositionActualNorthGet(&p_north);
-	PositionActualEastGet(&p_east);
+	p_north = snap->position.North;
+	p_east = snap->position.East;
 
 	// decide wether the UAV is outside of the map range and where to draw it
 	if ((2.0f * (float)fabs(p_north) > height_m) || (2.0f * (float)fabs(p_east) > width_m)) {
@@ -856,7 +857,7 @@ void draw_map_home_center(int width_px, int height_px, int width_m, int height_m
 	}
 
 	if (draw_uav) {
-		AttitudeActualYawGet(&yaw);
+		yaw = snap->attitude.Yaw;
 		if (yaw < 0)
 			yaw += 360;
 
@@ -892,9 +893,9 @@ void draw_map_uav_center(int width_px, int height_px, int width_m, int height_m,
 	aspect = (float)width_m / (float)height_m;
 
 	// Get UAV position an yaw
-	AttitudeActualYawGet(&yaw);
-	PositionActualNorthGet(&p_north);
-	PositionActualEastGet(&p_east);
+	yaw = snap->attitude.Yaw;
+	p_north = snap->position.North;
+	p_east = snap->position.East;
 	if (yaw < 0)
 		yaw += 360;
 	sin_yaw = sinf(yaw * (float)(M_PI / 180));
@@ -1100,8 +1101,8 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 
 	// Get home distance and direction (only makes sense if GPS is enabled
 	if (has_nav && (page->HomeDistance || page->CompassHomeDir) && PositionActualHandle() ) {
-		PositionActualNorthGet(&tmp);
-		PositionActualEastGet(&tmp1);
+		tmp = snap->position.North;
+		tmp1 = snap->position.East;
 
 		if (page->HomeDistance)
 			home_dist = (float)sqrt(tmp * tmp + tmp1 * tmp1) * convert_distance;
@@ -1138,12 +1139,12 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 		bool valid_altitude = false;
 		if (page->AltitudeScaleSource == ONSCREENDISPLAYPAGESETTINGS_ALTITUDESCALESOURCE_BARO) {
 			if (has_baro){
-				BaroAltitudeAltitudeGet(&tmp);
+				tmp = snap->baro.Altitude;
 				tmp -= home_baro_altitude;
 				valid_altitude = true;
 			}
 		} else if (PositionActualHandle()) {
-			PositionActualDownGet(&tmp);
+			tmp = snap->position.Down;
 			tmp *= -1.0f;
 			valid_altitude = true;
 		}
@@ -1162,12 +1163,12 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 		bool valid_altitude = false;
 		if (page->AltitudeNumericSource == ONSCREENDISPLAYPAGESETTINGS_ALTITUDENUMERICSOURCE_BARO) {
 			if (has_baro) {
-				BaroAltitudeAltitudeGet(&tmp);
+				tmp = snap->baro.Altitude;
 				tmp -= home_baro_altitude;
 				valid_altitude = true;
 			}
 		} else if (PositionActualHandle()) {
-			PositionActualDownGet(&tmp);
+			tmp = snap->position.Down;
 			tmp *= -1.0f;
 			valid_altitude = true;
 		}
@@ -1180,7 +1181,7 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 
 	// Arming Status
 	if (page->ArmStatus) {
-		FlightStatusArmedGet(&tmp_uint8);
+		tmp_uint8 = snap->flight_status.Armed;
 		if (tmp_uint8 == FLIGHTSTATUS_ARMED_ARMED)
 			write_string("ARMED", page->ArmStatusPosX, page->ArmStatusPosY, 0, 0, TEXT_VA_TOP, (int)page->ArmStatusAlign, 0,
 					page->ArmStatusFont);
@@ -1191,8 +1192,8 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 
 	// Artificial Horizon (and centermark)
 	if (page->ArtificialHorizon || page->CenterMark) {
-		AttitudeActualRollGet(&tmp);
-		AttitudeActualPitchGet(&tmp1);
+		tmp = snap->attitude.Roll;
+		tmp1 = snap->attitude.Pitch;
 		simple_artificial_horizon(tmp, tmp1, GRAPHICS_X_MIDDLE, GRAPHICS_Y_MIDDLE, GRAPHICS_BOTTOM * 0.8f, GRAPHICS_RIGHT * 0.8f,
 				page->ArtificialHorizonMaxPitch, page->ArtificialHorizonPitchSteps, page->ArtificialHorizon, page->CenterMark);
 	}
@@ -1200,26 +1201,26 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 	// Battery
 	if (has_battery && FlightBatteryStateHandle()) {
 		if (page->BatteryVolt) {
-			FlightBatteryStateVoltageGet(&tmp);
+			tmp = snap->battery.Voltage;
 			sprintf(tmp_str, "%0.1fV", (double)tmp);
 			write_string(tmp_str, page->BatteryVoltPosX, page->BatteryVoltPosY, 0, 0, TEXT_VA_TOP, (int)page->BatteryVoltAlign, 0,
 					page->BatteryVoltFont);
 		}
 		if (page->BatteryCurrent) {
-			FlightBatteryStateCurrentGet(&tmp);
+			tmp = snap->battery.Current;
 			sprintf(tmp_str, "%0.1fA", (double)tmp);
 			write_string(tmp_str, page->BatteryCurrentPosX, page->BatteryCurrentPosY, 0, 0, TEXT_VA_TOP,
 					(int)page->BatteryCurrentAlign, 0, page->BatteryCurrentFont);
 		}
 		if (page->BatteryConsumed) {
-			FlightBatteryStateConsumedEnergyGet(&tmp);
+			tmp = snap->battery.ConsumedEnergy;
 			sprintf(tmp_str, "%0.0fmAh", (double)tmp);
 			write_string(tmp_str, page->BatteryConsumedPosX, page->BatteryConsumedPosY, 0, 0, TEXT_VA_TOP,
 					(int)page->BatteryConsumedAlign, 0, page->BatteryConsumedFont);
 		}
 
 		if (page->BatteryChargeState) {
-			FlightBatteryStateConsumedEnergyGet(&tmp);
+			tmp = snap->battery.ConsumedEnergy;
 			FlightBatterySettingsCapacityGet(&tmp_uint32);
 			drawBattery(page->BatteryChargeStatePosX, page->BatteryChargeStatePosY, 100 - 100 * tmp / tmp_uint32, 24);
 		}
@@ -1227,7 +1228,7 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 
 	// Climb rate
 	if (page->ClimbRate && VelocityActualHandle() && has_baro) {
-		VelocityActualDownGet(&tmp);
+		tmp = snap->velocity.Down;
 		sprintf(tmp_str, "%0.1f", (double)(-1.f * convert_distance * tmp));
 		write_string(tmp_str, page->ClimbRatePosX, page->ClimbRatePosY, 0, 0, TEXT_VA_TOP, (int)page->ClimbRateAlign, 0,
 				page->ClimbRateFont);
@@ -1246,7 +1247,7 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 		}
 
 		if (do_compass) {
-			AttitudeActualYawGet(&tmp);
+			tmp = snap->attitude.Yaw;
 			if (tmp < 0)
 				tmp += 360;
 			if (page->CompassHomeDir) {
@@ -1268,7 +1269,7 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 	// Home arrow
 	if (has_nav && page->HomeArrow) {
 		if (!page->Compass) {
-			AttitudeActualYawGet(&tmp);
+			tmp = snap->attitude.Yaw;
 		}
 		tmp = fmodf(home_dir -tmp, 360.f);
 		draw_polygon(page->HomeArrowPosX, page->HomeArrowPosY, tmp, HOME_ARROW, NELEMENTS(HOME_ARROW), 0, 1);
@@ -1276,7 +1277,7 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 
 	// CPU utilization
 	if (page->Cpu) {
-		SystemStatsCPULoadGet(&tmp_uint8);
+		tmp_uint8 = snap->stats.CPULoad;
 		sprintf(tmp_str, "CPU:%2d", tmp_uint8);
 		write_string(tmp_str, page->CpuPosX, page->CpuPosY, 0, 0, TEXT_VA_TOP, (int)page->CpuAlign, 0, page->CpuFont);
 	}
@@ -1289,14 +1290,13 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 
 	// G Force
 	if (page->GForce) {
-		AccelsData accelsData;
-		AccelsGet(&accelsData);
+		const AccelsData *accelsData = &snap->accels;
 		// apply low pass filter to reduce noise bias
 		static AccelsData accelsDataAcc = { 0 };
 
-		accelsDataAcc.x = 0.8f * accelsDataAcc.x + 0.2f * accelsData.x;
-		accelsDataAcc.y = 0.8f * accelsDataAcc.y + 0.2f * accelsData.y;
-		accelsDataAcc.z = 0.8f * accelsDataAcc.z + 0.2f * accelsData.z;
+		accelsDataAcc.x = 0.8f * accelsDataAcc.x + 0.2f * accelsData->x;
+		accelsDataAcc.y = 0.8f * accelsDataAcc.y + 0.2f * accelsData->y;
+		accelsDataAcc.z = 0.8f * accelsDataAcc.z + 0.2f * accelsData->z;
 
 		tmp = sqrtf(powf(accelsDataAcc.x, 2.f) + powf(accelsDataAcc.y, 2.f) + powf(accelsDataAcc.z, 2.f)) / 9.81f;
 		sprintf(tmp_str, "%0.1fG", (double)tmp);
@@ -1306,28 +1306,27 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 
 	// GPS
 	if (has_gps && (page->GpsStatus || page->GpsLat || page->GpsLon || page->GpsMgrs)) {
-		GPSPositionData gps_data;
-		GPSPositionGet(&gps_data);
+		const GPSPositionData *gps_data = &snap->gps_position;
 
 		draw_image(page->GpsStatusPosX, page->GpsStatusPosY - image_gps.height / 2, &image_gps);
 
-		uint8_t pdop_1 = gps_data.PDOP;
-		uint8_t pdop_2 = roundf(10 * (gps_data.PDOP - pdop_1));
+		uint8_t pdop_1 = gps_data->PDOP;
+		uint8_t pdop_2 = roundf(10 * (gps_data->PDOP - pdop_1));
 
 		if (page->GpsStatus) {
-			switch (gps_data.Status)
+			switch (gps_data->Status)
 			{
 			case GPSPOSITION_STATUS_NOFIX:
 				sprintf(tmp_str, "NO");
 				break;
 			case GPSPOSITION_STATUS_FIX2D:
-				sprintf(tmp_str, "2D %d %d.%d", (int)gps_data.Satellites, (int)pdop_1, pdop_2);
+				sprintf(tmp_str, "2D %d %d.%d", (int)gps_data->Satellites, (int)pdop_1, pdop_2);
 				break;
 			case GPSPOSITION_STATUS_FIX3D:
-				sprintf(tmp_str, "3D %d %d.%d", (int)gps_data.Satellites, (int)pdop_1, pdop_2);
+				sprintf(tmp_str, "3D %d %d.%d", (int)gps_data->Satellites, (int)pdop_1, pdop_2);
 				break;
 			case GPSPOSITION_STATUS_DIFF3D:
-				sprintf(tmp_str, "3D %d %d.%d", (int)gps_data.Satellites, (int)pdop_1, pdop_2);
+				sprintf(tmp_str, "3D %d %d.%d", (int)gps_data->Satellites, (int)pdop_1, pdop_2);
 				break;
 			default:
 				sprintf(tmp_str, "NOGPS");
@@ -1337,13 +1336,13 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 		}
 
 		if (page->GpsLat) {
-			sprintf(tmp_str, "%0.5f", (double)gps_data.Latitude / 10000000.0);
+			sprintf(tmp_str, "%0.5f", (double)gps_data->Latitude / 10000000.0);
 			write_string(tmp_str, page->GpsLatPosX, page->GpsLatPosY, 0, 0, TEXT_VA_TOP, (int)page->GpsLatAlign, 0,
 					page->GpsLatFont);
 		}
 
 		if (page->GpsLon) {
-			sprintf(tmp_str, "%0.5f", (double)gps_data.Longitude / 10000000.0);
+			sprintf(tmp_str, "%0.5f", (double)gps_data->Longitude / 10000000.0);
 			write_string(tmp_str, page->GpsLonPosX, page->GpsLonPosY, 0, 0, TEXT_VA_TOP, (int)page->GpsLonAlign, 0,
 					page->GpsLonFont);
 		}
@@ -1354,8 +1353,8 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 
 			if (frame_counter % 5 == 0) {
 				// the conversion to MGRS is computationally expensive, so we update it a bit slower
-				tmp_int1 = Convert_Geodetic_To_MGRS((double)gps_data.Latitude * (double)DEG2RAD / 10000000.0,
-								(double)gps_data.Longitude * (double)DEG2RAD / 10000000.0, 5, mgrs_str);
+				tmp_int1 = Convert_Geodetic_To_MGRS((double)gps_data->Latitude * (double)DEG2RAD / 10000000.0,
+								(double)gps_data->Longitude * (double)DEG2RAD / 10000000.0, 5, mgrs_str);
 				if (tmp_int1 != 0)
 					sprintf(mgrs_str, "MGRS ERR: %d", tmp_int1);
 			}
@@ -1380,7 +1379,7 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 
 	// RSSI
 	if (page->Rssi) {
-		ManualControlCommandRssiGet(&tmp_int16);
+		tmp_int16 = snap->manual_control.Rssi;
 		if (tmp_int16 > osd_settings.RssiWarnThreshold || blink) {
 			sprintf(tmp_str, "%3d", tmp_int16);
 			if (page->RssiShowIcon) { // XXX rename
@@ -1399,8 +1398,8 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 		{
 			case ONSCREENDISPLAYPAGESETTINGS_SPEEDSCALESOURCE_NAV:
 				if (VelocityActualHandle()) {
-					VelocityActualNorthGet(&tmp);
-					VelocityActualEastGet(&tmp1);
+					tmp = snap->velocity.North;
+					tmp1 = snap->velocity.East;
 					tmp = sqrt(tmp * tmp + tmp1 * tmp1);
 					speed_valid = true;
 				}
@@ -1408,16 +1407,16 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 				break;
 			case ONSCREENDISPLAYPAGESETTINGS_SPEEDSCALESOURCE_GPS:
 				if (has_gps && GPSPositionHandle()) {
-					GPSPositionGroundspeedGet(&tmp);
+					tmp = snap->gps_position.Groundspeed;
 					uint8_t fix;
-					GPSPositionStatusGet(&fix);
+					fix = snap->gps_position.Status;
 					speed_valid = fix != GPSPOSITION_STATUS_NOFIX;
 				}
 				sprintf(tmp_str, "%s", "GND");
 				break;
 			case ONSCREENDISPLAYPAGESETTINGS_SPEEDSCALESOURCE_AIRSPEED:
 				if (AirspeedActualHandle()) {
-					AirspeedActualTrueAirspeedGet(&tmp);
+					tmp = snap->airspeed.TrueAirspeed;
 					speed_valid = true;
 				}
 				sprintf(tmp_str, "%s", "AIR");
@@ -1443,23 +1442,23 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 		{
 			case ONSCREENDISPLAYPAGESETTINGS_SPEEDNUMERICSOURCE_NAV:
 				if (VelocityActualHandle()) {
-					VelocityActualNorthGet(&tmp);
-					VelocityActualEastGet(&tmp1);
+					tmp = snap->velocity.North;
+					tmp1 = snap->velocity.East;
 					speed_valid = true;
 				}
 				tmp = sqrt(tmp * tmp + tmp1 * tmp1);
 				break;
 			case ONSCREENDISPLAYPAGESETTINGS_SPEEDNUMERICSOURCE_GPS:
 				if (GPSVelocityHandle()) {
-					GPSVelocityNorthGet(&tmp);
-					GPSVelocityEastGet(&tmp1);
+					tmp = snap->gps_velocity.North;
+					tmp1 = snap->gps_velocity.East;
 					tmp = sqrt(tmp * tmp + tmp1 * tmp1);
 					speed_valid = has_gps;
 				}
 				break;
 			case ONSCREENDISPLAYPAGESETTINGS_SPEEDNUMERICSOURCE_AIRSPEED:
 				if (AirspeedActualHandle()) {
-					AirspeedActualTrueAirspeedGet(&tmp);
+					tmp = snap->airspeed.TrueAirspeed;
 					speed_valid = true;
 				}
 		}
@@ -1473,7 +1472,7 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 	// Time
 	if (page->Time) {
 		uint32_t time;
-		SystemStatsFlightTimeGet(&time);
+		time = snap->stats.FlightTime;
 
 		tmp_int16 = (time / 3600000); // hours
 		if (tmp_int16 == 0) {
@@ -1490,7 +1489,7 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 
 	// Throttle
 	if (page->Throttle) {
-		StabilizationDesiredThrustGet(&tmp);
+		tmp = snap->stab_desired.Thrust;
 
 		int throttle = (100 * tmp + 0.5f);
 
@@ -1637,6 +1636,9 @@ int32_t OnScreenDisplayStart(void)
 		if (!onScreenDisplaySemaphore)
 			return -2;
 
+		if (state_snapshot_initialize(SNAPSHOT_PERIOD_MS))
+			return -4;
+
 		taskHandle = PIOS_Thread_Create(onScreenDisplayTask, "OnScreenDisplay", STACK_SIZE_BYTES, NULL, TASK_PRIORITY);
 		if (!taskHandle)
 			return -3;
@@ -1670,6 +1672,13 @@ int32_t OnScreenDisplayInitialize(void)
 		return 0;
 	}
 
+	snap = PIOS_malloc(sizeof(*snap));
+	if (!snap) {
+		module_enabled = false;
+		return -1;
+	}
+	memset(snap, 0, sizeof(*snap));
+
 	ModuleSettingsData module_settings;
 	ModuleSettingsGet(&module_settings);
 
@@ -1717,11 +1726,7 @@ static float get_accessorydesired(int idx) {
 		return 0;
 	}
 
-	float accessories[MANUALCONTROLCOMMAND_ACCESSORY_NUMELEM];
-
-	ManualControlCommandAccessoryGet(accessories);
-
-	return accessories[idx];
+	return snap->manual_control.Accessory[idx];
 }
 
 /**
@@ -1799,8 +1804,9 @@ static void onScreenDisplayTask(__attribute__((unused)) void *parameters)
 			}
 			frame_counter++;
 			// Accumulate baro altitude
-			if (BaroAltitudeHandle()) {
-				BaroAltitudeAltitudeGet(&tmp);
+			state_snapshot_get(snap);
+			if (state_snapshot_has(snap, STATE_SNAPSHOT_BAROALTITUDE)) {
+				tmp = snap->baro.Altitude;
 				home_baro_altitude += tmp;
 			}
 		} else {
@@ -1820,6 +1826,10 @@ static void onScreenDisplayTask(__attribute__((unused)) void *parameters)
 			out_time = in_ticks - out_ticks;
 #endif
 			video_system_act = PIOS_Video_GetSystem();
+
+			// one consistent copy of the flight state for the whole frame
+			state_snapshot_get(snap);
+
 			if (osd_settings_updated) {
 				OnScreenDisplaySettingsGet(&osd_settings);
 				set_ntsc_pal_settings(video_system_act);
@@ -1890,7 +1900,7 @@ static void onScreenDisplayTask(__attribute__((unused)) void *parameters)
 			}
 
 			// Show stats when we disarm
-			FlightStatusArmedGet(&arm_status);
+			arm_status = snap->flight_status.Armed;
 			if (arm_status == FLIGHTSTATUS_ARMED_DISARMED) {
 				if (last_arm_status != FLIGHTSTATUS_ARMED_DISARMED) {
 					switch (osd_settings.StatsDisplayDuration) {
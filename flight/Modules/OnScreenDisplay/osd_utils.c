@@ -56,21 +56,92 @@ extern uint8_t *draw_buffer;
 extern uint8_t *disp_buffer;
 #endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
 
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+#define DIRTY_ROWS_KEY draw_buffer_level
+#else
+#define DIRTY_ROWS_KEY draw_buffer
+#endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+
+// Band of rows written since a draw buffer was last cleared. The draw and
+// display buffers are swapped every frame, so one band is kept per buffer.
+struct dirty_rows {
+	const uint8_t *buffer;
+	int16_t top;
+	int16_t bottom;
+};
+
+static struct dirty_rows dirty_rows[2];
+static uint8_t dirty_rows_next;
+
+static inline struct dirty_rows *find_dirty_rows(void)
+{
+	if (dirty_rows[0].buffer == DIRTY_ROWS_KEY) {
+		return &dirty_rows[0];
+	}
+	if (dirty_rows[1].buffer == DIRTY_ROWS_KEY) {
+		return &dirty_rows[1];
+	}
+	return NULL;
+}
+
+/**
+ * mark_dirty_rows: record that rows y0 to y1 of the draw buffer were written,
+ * so that clearGraphics() clears them the next time around.
+ */
+static inline void mark_dirty_rows(int y0, int y1)
+{
+	struct dirty_rows *dirty = find_dirty_rows();
+
+	// A buffer we have no band for gets fully cleared anyway
+	if (dirty == NULL) {
+		return;
+	}
+	if (y0 < dirty->top) {
+		dirty->top = MAX(y0, 0);
+	}
+	if (y1 > dirty->bottom) {
+		dirty->bottom = MIN(y1, BUFFER_HEIGHT - 1);
+	}
+}
 
+/**
+ * clearGraphics: clear the draw buffer. Only the rows drawn into since this
+ * buffer was last cleared are touched; a buffer seen for the first time is
+ * cleared completely.
+ */
 void clearGraphics()
 {
+	struct dirty_rows *dirty = find_dirty_rows();
+	int top  = 0;
+	int rows = BUFFER_HEIGHT;
+
+	if (dirty == NULL) {
+		dirty = &dirty_rows[dirty_rows_next];
+		dirty_rows_next ^= 1;
+		dirty->buffer = DIRTY_ROWS_KEY;
+	} else {
+		top  = dirty->top;
+		rows = dirty->bottom - dirty->top + 1;
+	}
+
+	if (rows > 0) {
 #if defined(PIOS_VIDEO_SPLITBUFFER)
-	memset((uint8_t *)draw_buffer_mask, 0, BUFFER_HEIGHT * BUFFER_WIDTH);
-	memset((uint8_t *)draw_buffer_level, 0, BUFFER_HEIGHT * BUFFER_WIDTH);
+		memset((uint8_t *)draw_buffer_mask + top * BUFFER_WIDTH, 0, rows * BUFFER_WIDTH);
+		memset((uint8_t *)draw_buffer_level + top * BUFFER_WIDTH, 0, rows * BUFFER_WIDTH);
 #else
-	memset((uint8_t *)draw_buffer, 0, BUFFER_HEIGHT * BUFFER_WIDTH);
+		memset((uint8_t *)draw_buffer + top * BUFFER_WIDTH, 0, rows * BUFFER_WIDTH);
 #endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+	}
+
+	dirty->top    = BUFFER_HEIGHT;
+	dirty->bottom = -1;
 }
 
 void draw_image(uint16_t x, uint16_t y, const struct Image * image)
 {
 #if defined(PIOS_VIDEO_SPLITBUFFER)
 	CHECK_COORDS(x + image->width, y + image->height);
+	mark_dirty_rows(y, y + image->height - 1);
 	uint8_t byte_width = image->width / 8;
 	uint8_t pixel_offset = x % 8;
 	uint8_t mask1 = 0xFF;
@@ -97,6 +168,7 @@ void draw_image(uint16_t x, uint16_t y, const struct Image * image)
 	}
 #else
 	CHECK_COORDS(x + image->width, y + image->height);
+	mark_dirty_rows(y, y + image->height - 1);
 	uint8_t byte_width = image->width / 4;
 	uint8_t pixel_offset = 2 * (x % 4);
 	uint8_t mask1 = 0xFF;
@@ -231,6 +303,7 @@ void drawBox(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
 void write_pixel(uint8_t *buff, int x, int y, int mode)
 {
 	CHECK_COORDS(x, y);
+	mark_dirty_rows(y, y);
 	// Determine the bit in the word to be set and the word
 	// index to set it in.
 	int wordnum = CALC_BUFF_ADDR(x, y);
@@ -241,6 +314,7 @@ void write_pixel(uint8_t *buff, int x, int y, int mode)
 void write_pixel(int x, int y, uint8_t value)
 {
 	CHECK_COORDS(x, y);
+	mark_dirty_rows(y, y);
 	// Determine the bit in the word to be set and the word
 	// index to set it in.
 	int wordnum = CALC_BUFF_ADDR(x, y);
@@ -261,6 +335,7 @@ void write_pixel(int x, int y, uint8_t value)
 void write_pixel_lm(int x, int y, int mmode, int lmode)
 {
 	CHECK_COORDS(x, y);
+	mark_dirty_rows(y, y);
 	// Determine the bit in the word to be set and the word
 	// index to set it in.
 	int addr   = CALC_BUFF_ADDR(x, y);
@@ -274,6 +349,190 @@ void write_pixel_lm(int x, int y, int mmode, int lmode)
 #endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
 }
 
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+typedef uint32_t __attribute__((__may_alias__)) span_word_t;
+
+/**
+ * fill_span_bytes: apply a mode to a run of whole bytes. Set and clear go
+ * through memset, toggling is done a 32-bit word at a time once aligned.
+ *
+ * @param       p       first byte
+ * @param       n       number of bytes
+ * @param       mode    0 = clear, 1 = set, 2 = toggle
+ */
+static void fill_span_bytes(uint8_t *p, int n, int mode)
+{
+	switch (mode) {
+	case 0:
+		memset(p, 0x00, n);
+		break;
+	case 1:
+		memset(p, 0xff, n);
+		break;
+	case 2:
+		for (; n > 0 && ((uintptr_t)p & 3); n--) {
+			*p++ ^= 0xff;
+		}
+		for (; n >= 4; n -= 4, p += 4) {
+			*(span_word_t *)p ^= 0xffffffff;
+		}
+		for (; n > 0; n--) {
+			*p++ ^= 0xff;
+		}
+		break;
+	}
+}
+
+/**
+ * write_span: fill pixels x0 to x1, both inclusive, on one row. Only the
+ * two edge bytes are masked. Clipped to the graphics area.
+ *
+ * @param       buff    pointer to buffer to write in
+ * @param       x0      first x coordinate
+ * @param       x1      last x coordinate
+ * @param       y       y coordinate
+ * @param       mode    0 = clear, 1 = set, 2 = toggle
+ */
+static void write_span(uint8_t *buff, int x0, int x1, int y, int mode)
+{
+	CHECK_COORD_Y(y);
+	if (x0 > x1) {
+		SWAP(x0, x1);
+	}
+	if (x1 < GRAPHICS_LEFT || x0 > GRAPHICS_RIGHT) {
+		return;
+	}
+	CLIP_COORD_X(x0);
+	CLIP_COORD_X(x1);
+	mark_dirty_rows(y, y);
+
+	int addr0 = CALC_BUFF_ADDR(x0, y);
+	int addr1 = CALC_BUFF_ADDR(x1, y);
+	uint8_t mask_l = SPAN_EDGE_L_MASK(x0);
+	uint8_t mask_r = SPAN_EDGE_R_MASK(x1);
+
+	if (addr0 == addr1) {
+		mask_l &= mask_r;
+		WRITE_WORD_MODE(buff, addr0, mask_l, mode);
+	} else {
+		WRITE_WORD_MODE(buff, addr0, mask_l, mode);
+		WRITE_WORD_MODE(buff, addr1, mask_r, mode);
+		fill_span_bytes(&buff[addr0 + 1], addr1 - addr0 - 1, mode);
+	}
+}
+
+/**
+ * write_vspan: fill pixels y0 to y1, both inclusive, in one column.
+ * Clipped to the graphics area.
+ *
+ * @param       buff    pointer to buffer to write in
+ * @param       x       x coordinate
+ * @param       y0      first y coordinate
+ * @param       y1      last y coordinate
+ * @param       mode    0 = clear, 1 = set, 2 = toggle
+ */
+static void write_vspan(uint8_t *buff, int x, int y0, int y1, int mode)
+{
+	CHECK_COORD_X(x);
+	if (y0 > y1) {
+		SWAP(y0, y1);
+	}
+	if (y1 < GRAPHICS_TOP || y0 > GRAPHICS_BOTTOM) {
+		return;
+	}
+	CLIP_COORD_Y(y0);
+	CLIP_COORD_Y(y1);
+	mark_dirty_rows(y0, y1);
+
+	int addr1 = CALC_BUFF_ADDR(x, y1);
+	uint8_t mask = CALC_BIT_MASK(x);
+	for (int a = CALC_BUFF_ADDR(x, y0); a <= addr1; a += BUFFER_WIDTH) {
+		WRITE_WORD_MODE(buff, a, mask, mode);
+	}
+}
+#else
+static void write_span(int x0, int x1, int y, uint8_t value)
+{
+	CHECK_COORD_Y(y);
+	if (x0 > x1) {
+		SWAP(x0, x1);
+	}
+	if (x1 < GRAPHICS_LEFT || x0 > GRAPHICS_RIGHT) {
+		return;
+	}
+	CLIP_COORD_X(x0);
+	CLIP_COORD_X(x1);
+	mark_dirty_rows(y, y);
+
+	int addr0 = CALC_BUFF_ADDR(x0, y);
+	int addr1 = CALC_BUFF_ADDR(x1, y);
+	uint8_t mask_l = SPAN_EDGE_L_MASK(x0);
+	uint8_t mask_r = SPAN_EDGE_R_MASK(x1);
+
+	if (addr0 == addr1) {
+		mask_l &= mask_r;
+		WRITE_WORD(draw_buffer, addr0, mask_l, value);
+	} else {
+		WRITE_WORD(draw_buffer, addr0, mask_l, value);
+		WRITE_WORD(draw_buffer, addr1, mask_r, value);
+		// Every pixel of the inner bytes is replaced
+		memset(&draw_buffer[addr0 + 1], value, addr1 - addr0 - 1);
+	}
+}
+
+static void write_vspan(int x, int y0, int y1, uint8_t value)
+{
+	CHECK_COORD_X(x);
+	if (y0 > y1) {
+		SWAP(y0, y1);
+	}
+	if (y1 < GRAPHICS_TOP || y0 > GRAPHICS_BOTTOM) {
+		return;
+	}
+	CLIP_COORD_Y(y0);
+	CLIP_COORD_Y(y1);
+	mark_dirty_rows(y0, y1);
+
+	int addr1 = CALC_BUFF_ADDR(x, y1);
+	uint8_t mask = CALC_BIT_MASK(x);
+	for (int a = CALC_BUFF_ADDR(x, y0); a <= addr1; a += BUFFER_WIDTH) {
+		WRITE_WORD(draw_buffer, a, mask, value);
+	}
+}
+#endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+
+/**
+ * write_span_lm: fill pixels x0 to x1, both inclusive, on one row of both
+ * the level and the mask surfaces.
+ *
+ * @param       x0      first x coordinate
+ * @param       x1      last x coordinate
+ * @param       y       y coordinate
+ * @param       lmode   0 = clear, 1 = set, 2 = toggle
+ * @param       mmode   0 = clear, 1 = set, 2 = toggle
+ */
+void write_span_lm(int x0, int x1, int y, int lmode, int mmode)
+{
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+	write_span(draw_buffer_mask, x0, x1, y, mmode);
+	write_span(draw_buffer_level, x0, x1, y, lmode);
+#else
+	uint8_t value = PACK_BITS(mmode, lmode);
+	write_span(x0, x1, y, value);
+#endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+}
+
+static void write_vspan_lm(int x, int y0, int y1, int lmode, int mmode)
+{
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+	write_vspan(draw_buffer_mask, x, y0, y1, mmode);
+	write_vspan(draw_buffer_level, x, y0, y1, lmode);
+#else
+	uint8_t value = PACK_BITS(mmode, lmode);
+	write_vspan(x, y0, y1, value);
+#endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+}
+
 /**
  * write_hline: optimised horizontal line writing algorithm
  *
@@ -295,6 +554,7 @@ void write_hline(uint8_t *buff, int x0, int x1, int y, int mode)
 	if (x0 == x1) {
 		return;
 	}
+	mark_dirty_rows(y, y);
 	/* This is an optimised algorithm for writing horizontal lines.
 	 * We begin by finding the addresses of the x0 and x1 points. */
 	int addr0     = CALC_BUFF_ADDR(x0, y);
@@ -332,6 +592,7 @@ void write_hline(int x0, int x1, int y, uint8_t value)
 	if (x0 == x1) {
 		return;
 	}
+	mark_dirty_rows(y, y);
 	/* This is an optimised algorithm for writing horizontal lines.
 	 * We begin by finding the addresses of the x0 and x1 points. */
 	int addr0     = CALC_BUFF_ADDR(x0, y);
@@ -432,6 +693,7 @@ void write_vline(uint8_t *buff, int x, int y0, int y1, int mode)
 	if (y0 == y1) {
 		return;
 	}
+	mark_dirty_rows(y0, y1);
 	/* This is an optimised algorithm for writing vertical lines.
 	 * We begin by finding the addresses of the x,y0 and x,y1 points. */
 	int addr0  = CALC_BUFF_ADDR(x, y0);
@@ -456,6 +718,7 @@ void write_vline(int x, int y0, int y1, uint8_t value)
 	if (y0 == y1) {
 		return;
 	}
+	mark_dirty_rows(y0, y1);
 	/* This is an optimised algorithm for writing vertical lines.
 	 * We begin by finding the addresses of the x,y0 and x,y1 points. */
 	int addr0  = CALC_BUFF_ADDR(x, y0);
@@ -546,6 +809,7 @@ void write_filled_rectangle(uint8_t *buff, int x, int y, int width, int height,
 	if (width <= 0 || height <= 0) {
 		return;
 	}
+	mark_dirty_rows(y, y + height - 1);
 	// Calculate as if the rectangle was only a horizontal line. We then
 	// step these addresses through each row until we iterate `height` times.
 	int addr0     = CALC_BUFF_ADDR(x, y);
@@ -600,6 +864,7 @@ void write_filled_rectangle(int x, int y, int width, int height, uint8_t value)
 	if (width <= 0 || height <= 0) {
 		return;
 	}
+	mark_dirty_rows(y, y + height - 1);
 	// Calculate as if the rectangle was only a horizontal line. We then
 	// step these addresses through each row until we iterate `height` times.
 	int addr0     = CALC_BUFF_ADDR(x, y);
@@ -658,13 +923,15 @@ void write_filled_rectangle(int x, int y, int width, int height, uint8_t value)
  */
 void write_filled_rectangle_lm(int x, int y, int width, int height, int lmode, int mmode)
 {
-#if defined(PIOS_VIDEO_SPLITBUFFER)
-	write_filled_rectangle(draw_buffer_mask, x, y, width, height, mmode);
-	write_filled_rectangle(draw_buffer_level, x, y, width, height, lmode);
-#else
-	uint8_t value = PACK_BITS(mmode, lmode);
-	write_filled_rectangle(x, y, width, height, value);
-#endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+	CHECK_COORDS(x, y);
+	CHECK_COORDS(x + width, y + height);
+	if (width <= 0 || height <= 0) {
+		return;
+	}
+	// One pass over the rows, both surfaces written while the row is hot
+	for (int yy = y; yy < y + height; yy++) {
+		write_span_lm(x, x + width, yy, lmode, mmode);
+	}
 }
 
 /**
@@ -687,6 +954,101 @@ void write_rectangle_outlined(int x, int y, int width, int height, int mode, int
 }
 
 #if defined(PIOS_VIDEO_SPLITBUFFER)
+// Midpoint circle, walked over one octant a run of points sharing the same
+// x at a time rather than point by point.
+struct circle_runs {
+	int x;
+	int y;
+	int error;
+	int dashp;
+};
+
+#define CIRCLE_DASH_ON(dashp, y)     ((dashp) == 0 || ((y) % (dashp)) < ((dashp) / 2))
+
+static void circle_runs_init(struct circle_runs *cr, int r, int dashp)
+{
+	cr->error = -r;
+	cr->x     = r;
+	cr->y     = 0;
+	cr->dashp = dashp;
+}
+
+/**
+ * circle_runs_next: fetch the next drawn run of the octant from (r, 0) to
+ * the diagonal.
+ *
+ * @param       cr      iterator set up by circle_runs_init()
+ * @param       x       x coordinate of the run
+ * @param       y0      first y coordinate of the run
+ * @param       y1      last y coordinate of the run (inclusive)
+ * @returns     false once the octant is exhausted
+ *
+ * Runs end where x steps or the dash pattern turns on or off; the points
+ * dashed out are skipped.
+ */
+static bool circle_runs_next(struct circle_runs *cr, int *x, int *y0, int *y1)
+{
+	while (cr->x >= cr->y) {
+		bool on    = CIRCLE_DASH_ON(cr->dashp, cr->y);
+		bool step  = false;
+		int  start = cr->y;
+
+		*x = cr->x;
+		do {
+			cr->error += (cr->y * 2) + 1;
+			cr->y++;
+			if (cr->error >= 0) {
+				--cr->x;
+				cr->error -= cr->x * 2;
+				step = true;
+			}
+		} while (!step && cr->x >= cr->y &&
+				CIRCLE_DASH_ON(cr->dashp, cr->y) == on);
+
+		if (on) {
+			*y0 = start;
+			*y1 = cr->y - 1;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * circle_plot_run: draw the points (x, y) for y from y0 to y1 in all eight
+ * octants, the same pixels CIRCLE_PLOT_8 would. In four octants the run is a
+ * column, in the other four a row.
+ *
+ * @param       buff    pointer to buffer to write in
+ * @param       cx      origin x coordinate
+ * @param       cy      origin y coordinate
+ * @param       x       x coordinate of the run
+ * @param       y0      first y coordinate of the run
+ * @param       y1      last y coordinate of the run (inclusive)
+ * @param       mode    0 = clear, 1 = set, 2 = toggle
+ */
+static void circle_plot_run(uint8_t *buff, int cx, int cy, int x, int y0, int y1, int mode)
+{
+	write_vspan(buff, cx + x, cy + y0, cy + y1, mode);
+	write_vspan(buff, cx - x, cy + y0, cy + y1, mode);
+	write_vspan(buff, cx + x, cy - y0, cy - y1, mode);
+	write_vspan(buff, cx - x, cy - y0, cy - y1, mode);
+
+	// Mirrored about the diagonal, but the point on it only once
+	for (int part = 0; part < 2; part++) {
+		int a = part ? MAX(y0, x + 1) : y0;
+		int b = part ? y1 : MIN(y1, x - 1);
+
+		if (a > b) {
+			continue;
+		}
+		write_span(buff, cx + a, cx + b, cy + x, mode);
+		write_span(buff, cx - a, cx - b, cy + x, mode);
+		write_span(buff, cx + a, cx + b, cy - x, mode);
+		write_span(buff, cx - a, cx - b, cy - x, mode);
+	}
+}
+
 /**
  * write_circle: draw the outline of a circle on a given buffer,
  * with an optional dash pattern for the line instead of a normal line.
@@ -700,18 +1062,13 @@ void write_rectangle_outlined(int x, int y, int width, int height, int mode, int
  */
 void write_circle(uint8_t *buff, int cx, int cy, int r, int dashp, int mode)
 {
+	struct circle_runs cr;
+	int x, y0, y1;
+
 	CHECK_COORDS(cx, cy);
-	int error = -r, x = r, y = 0;
-	while (x >= y) {
-		if (dashp == 0 || (y % dashp) < (dashp / 2)) {
-			CIRCLE_PLOT_8(buff, cx, cy, x, y, mode);
-		}
-		error += (y * 2) + 1;
-		y++;
-		if (error >= 0) {
-			--x;
-			error -= x * 2;
-		}
+	circle_runs_init(&cr, r, dashp);
+	while (circle_runs_next(&cr, &x, &y0, &y1)) {
+		circle_plot_run(buff, cx, cy, x, y0, y1, mode);
 	}
 }
 
@@ -728,51 +1085,32 @@ void write_circle(uint8_t *buff, int cx, int cy, int r, int dashp, int mode)
  */
 void write_circle_outlined(int cx, int cy, int r, int dashp, int bmode, int mode, int mmode)
 {
-	int stroke, fill;
+	// Neighbours the outline is stamped at, the last two for bmode 1 only
+	static const int8_t border[6][2] = {
+		{ 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 }, { 1, 1 }, { -1, -1 },
+	};
+	int nborder = (bmode == 1) ? 6 : 4;
+	struct circle_runs cr;
+	int stroke, fill, x, y0, y1;
 
 	CHECK_COORDS(cx, cy);
 	SETUP_STROKE_FILL(stroke, fill, mode);
 	// This is a two step procedure. First, we draw the outline of the
 	// circle, then we draw the inner part.
-	int error = -r, x = r, y = 0;
-	while (x >= y) {
-		if (dashp == 0 || (y % dashp) < (dashp / 2)) {
-			CIRCLE_PLOT_8(draw_buffer_mask, cx, cy, x + 1, y, mmode);
-			CIRCLE_PLOT_8(draw_buffer_level, cx, cy, x + 1, y, stroke);
-			CIRCLE_PLOT_8(draw_buffer_mask, cx, cy, x, y + 1, mmode);
-			CIRCLE_PLOT_8(draw_buffer_level, cx, cy, x, y + 1, stroke);
-			CIRCLE_PLOT_8(draw_buffer_mask, cx, cy, x - 1, y, mmode);
-			CIRCLE_PLOT_8(draw_buffer_level, cx, cy, x - 1, y, stroke);
-			CIRCLE_PLOT_8(draw_buffer_mask, cx, cy, x, y - 1, mmode);
-			CIRCLE_PLOT_8(draw_buffer_level, cx, cy, x, y - 1, stroke);
-			if (bmode == 1) {
-				CIRCLE_PLOT_8(draw_buffer_mask, cx, cy, x + 1, y + 1, mmode);
-				CIRCLE_PLOT_8(draw_buffer_level, cx, cy, x + 1, y + 1, stroke);
-				CIRCLE_PLOT_8(draw_buffer_mask, cx, cy, x - 1, y - 1, mmode);
-				CIRCLE_PLOT_8(draw_buffer_level, cx, cy, x - 1, y - 1, stroke);
-			}
-		}
-		error += (y * 2) + 1;
-		y++;
-		if (error >= 0) {
-			--x;
-			error -= x * 2;
+	circle_runs_init(&cr, r, dashp);
+	while (circle_runs_next(&cr, &x, &y0, &y1)) {
+		for (int i = 0; i < nborder; i++) {
+			int bx = x + border[i][0];
+			int by = border[i][1];
+
+			circle_plot_run(draw_buffer_mask, cx, cy, bx, y0 + by, y1 + by, mmode);
+			circle_plot_run(draw_buffer_level, cx, cy, bx, y0 + by, y1 + by, stroke);
 		}
 	}
-	error = -r;
-	x     = r;
-	y     = 0;
-	while (x >= y) {
-		if (dashp == 0 || (y % dashp) < (dashp / 2)) {
-			CIRCLE_PLOT_8(draw_buffer_mask, cx, cy, x, y, mmode);
-			CIRCLE_PLOT_8(draw_buffer_level, cx, cy, x, y, fill);
-		}
-		error += (y * 2) + 1;
-		y++;
-		if (error >= 0) {
-			--x;
-			error -= x * 2;
-		}
+	circle_runs_init(&cr, r, dashp);
+	while (circle_runs_next(&cr, &x, &y0, &y1)) {
+		circle_plot_run(draw_buffer_mask, cx, cy, x, y0, y1, mmode);
+		circle_plot_run(draw_buffer_level, cx, cy, x, y0, y1, fill);
 	}
 }
 
@@ -790,19 +1128,19 @@ void write_circle_filled(uint8_t *buff, int cx, int cy, int r, int mode)
 	CHECK_COORDS(cx, cy);
 	int error = -r, x = r, y = 0, xch = 0;
 	// It turns out that filled circles can take advantage of the midpoint
-	// circle algorithm. We simply draw very fast horizontal lines across each
-	// pair of X,Y coordinates. In some cases, this can even be faster than
-	// drawing an outlined circle!
+	// circle algorithm. We simply draw spans across each pair of X,Y
+	// coordinates. In some cases, this can even be faster than drawing an
+	// outlined circle!
 	//
 	// Due to multiple writes to each set of pixels, we have a special exception
 	// for when using the toggling draw mode.
 	while (x >= y) {
 		if (y != 0) {
-			write_hline(buff, cx - x, cx + x, cy + y, mode);
-			write_hline(buff, cx - x, cx + x, cy - y, mode);
+			write_span(buff, cx - x, cx + x, cy + y, mode);
+			write_span(buff, cx - x, cx + x, cy - y, mode);
 			if (mode != 2 || (mode == 2 && xch && (cx - x) != (cx - y))) {
-				write_hline(buff, cx - y, cx + y, cy + x, mode);
-				write_hline(buff, cx - y, cx + y, cy - x, mode);
+				write_span(buff, cx - y, cx + y, cy + x, mode);
+				write_span(buff, cx - y, cx + y, cy - x, mode);
 				xch = 0;
 			}
 		}
@@ -816,11 +1154,76 @@ void write_circle_filled(uint8_t *buff, int cx, int cy, int r, int mode)
 	}
 	// Handle toggle mode.
 	if (mode == 2) {
-		write_hline(buff, cx - r, cx + r, cy, mode);
+		write_span(buff, cx - r, cx + r, cy, mode);
 	}
 }
 #endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
 
+// Bresenham line, walked one run of pixels sharing the same minor
+// coordinate at a time rather than pixel by pixel.
+struct line_runs {
+	int steep;
+	int deltax;
+	int deltay;
+	int error;
+	int ystep;
+	int x;
+	int x_end;
+	int y;
+};
+
+static void line_runs_init(struct line_runs *lr, int x0, int y0, int x1, int y1)
+{
+	// Based on http://en.wikipedia.org/wiki/Bresenham%27s_line_algorithm
+	lr->steep = abs(y1 - y0) > abs(x1 - x0);
+	if (lr->steep) {
+		SWAP(x0, y0);
+		SWAP(x1, y1);
+	}
+	if (x0 > x1) {
+		SWAP(x0, x1);
+		SWAP(y0, y1);
+	}
+	lr->deltax = x1 - x0;
+	lr->deltay = abs(y1 - y0);
+	lr->error  = lr->deltax / 2;
+	lr->ystep  = (y0 < y1) ? 1 : -1;
+	lr->x      = x0;
+	lr->x_end  = x1;
+	lr->y      = y0;
+}
+
+/**
+ * line_runs_next: fetch the next run of a line.
+ *
+ * @param       lr      iterator set up by line_runs_init()
+ * @param       start   first major axis coordinate of the run
+ * @param       end     last major axis coordinate of the run (inclusive)
+ * @param       minor   minor axis coordinate of the run
+ * @returns     false once the line is exhausted
+ *
+ * The major axis is x unless lr->steep is set, in which case it is y.
+ */
+static bool line_runs_next(struct line_runs *lr, int *start, int *end, int *minor)
+{
+	if (lr->x >= lr->x_end) {
+		return false;
+	}
+	*start = lr->x;
+	*minor = lr->y;
+	while (lr->x < lr->x_end) {
+		lr->x++;
+		lr->error -= lr->deltay;
+		if (lr->error < 0) {
+			lr->y     += lr->ystep;
+			lr->error += lr->deltax;
+			break;
+		}
+	}
+	*end = lr->x - 1;
+	return true;
+}
+
 /**
  * write_line: Draw a line of arbitrary angle.
  *
@@ -834,76 +1237,30 @@ void write_circle_filled(uint8_t *buff, int cx, int cy, int r, int mode)
 #if defined(PIOS_VIDEO_SPLITBUFFER)
 void write_line(uint8_t *buff, int x0, int y0, int x1, int y1, int mode)
 {
-	// Based on http://en.wikipedia.org/wiki/Bresenham%27s_line_algorithm
-	int steep = abs(y1 - y0) > abs(x1 - x0);
+	struct line_runs lr;
+	int start, end, minor;
 
-	if (steep) {
-		SWAP(x0, y0);
-		SWAP(x1, y1);
-	}
-	if (x0 > x1) {
-		SWAP(x0, x1);
-		SWAP(y0, y1);
-	}
-	int deltax     = x1 - x0;
-	int deltay = abs(y1 - y0);
-	int error      = deltax / 2;
-	int ystep;
-	int y = y0;
-	int x; // , lasty = y, stox = 0;
-	if (y0 < y1) {
-		ystep = 1;
-	} else {
-		ystep = -1;
-	}
-	for (x = x0; x < x1; x++) {
-		if (steep) {
-			write_pixel(buff, y, x, mode);
+	line_runs_init(&lr, x0, y0, x1, y1);
+	while (line_runs_next(&lr, &start, &end, &minor)) {
+		if (lr.steep) {
+			write_vspan(buff, minor, start, end, mode);
 		} else {
-			write_pixel(buff, x, y, mode);
-		}
-		error -= deltay;
-		if (error < 0) {
-			y     += ystep;
-			error += deltax;
+			write_span(buff, start, end, minor, mode);
 		}
 	}
 }
 #else
 void write_line(int x0, int y0, int x1, int y1, uint8_t value)
 {
-	// Based on http://en.wikipedia.org/wiki/Bresenham%27s_line_algorithm
-	int steep = abs(y1 - y0) > abs(x1 - x0);
+	struct line_runs lr;
+	int start, end, minor;
 
-	if (steep) {
-		SWAP(x0, y0);
-		SWAP(x1, y1);
-	}
-	if (x0 > x1) {
-		SWAP(x0, x1);
-		SWAP(y0, y1);
-	}
-	int deltax     = x1 - x0;
-	int deltay = abs(y1 - y0);
-	int error      = deltax / 2;
-	int ystep;
-	int y = y0;
-	int x; // , lasty = y, stox = 0;
-	if (y0 < y1) {
-		ystep = 1;
-	} else {
-		ystep = -1;
-	}
-	for (x = x0; x < x1; x++) {
-		if (steep) {
-			write_pixel(y, x, value);
+	line_runs_init(&lr, x0, y0, x1, y1);
+	while (line_runs_next(&lr, &start, &end, &minor)) {
+		if (lr.steep) {
+			write_vspan(minor, start, end, value);
 		} else {
-			write_pixel(x, y, value);
-		}
-		error -= deltay;
-		if (error < 0) {
-			y     += ystep;
-			error += deltax;
+			write_span(start, end, minor, value);
 		}
 	}
 }
@@ -946,8 +1303,8 @@ void write_line_outlined(int x0, int y0, int x1, int y1,
 						 __attribute__((unused)) int endcap0, __attribute__((unused)) int endcap1,
 						 int mode, int mmode)
 {
-	// Based on http://en.wikipedia.org/wiki/Bresenham%27s_line_algorithm
-	// This could be improved for speed.
+	struct line_runs lr;
+	int start, end, minor;
 	int omode, imode;
 
 	if (mode == 0) {
@@ -957,58 +1314,28 @@ void write_line_outlined(int x0, int y0, int x1, int y1,
 		omode = 1;
 		imode = 0;
 	}
-	int steep = abs(y1 - y0) > abs(x1 - x0);
-	if (steep) {
-		SWAP(x0, y0);
-		SWAP(x1, y1);
-	}
-	if (x0 > x1) {
-		SWAP(x0, x1);
-		SWAP(y0, y1);
-	}
-	int deltax     = x1 - x0;
-	int deltay = abs(y1 - y0);
-	int error      = deltax / 2;
-	int ystep;
-	int y = y0;
-	int x;
-	if (y0 < y1) {
-		ystep = 1;
-	} else {
-		ystep = -1;
-	}
-	// Draw the outline.
-	for (x = x0; x < x1; x++) {
-		if (steep) {
-			write_pixel_lm(y - 1, x, mmode, omode);
-			write_pixel_lm(y + 1, x, mmode, omode);
-			write_pixel_lm(y, x - 1, mmode, omode);
-			write_pixel_lm(y, x + 1, mmode, omode);
+	// Draw the outline. Per run this is the run widened by a pixel at each
+	// end plus the run shifted a pixel to either side, which is the union
+	// of the four neighbours of every pixel in it.
+	line_runs_init(&lr, x0, y0, x1, y1);
+	while (line_runs_next(&lr, &start, &end, &minor)) {
+		if (lr.steep) {
+			write_vspan_lm(minor - 1, start, end, omode, mmode);
+			write_vspan_lm(minor + 1, start, end, omode, mmode);
+			write_vspan_lm(minor, start - 1, end + 1, omode, mmode);
 		} else {
-			write_pixel_lm(x - 1, y, mmode, omode);
-			write_pixel_lm(x + 1, y, mmode, omode);
-			write_pixel_lm(x, y - 1, mmode, omode);
-			write_pixel_lm(x, y + 1, mmode, omode);
-		}
-		error -= deltay;
-		if (error < 0) {
-			y     += ystep;
-			error += deltax;
+			write_span_lm(start, end, minor - 1, omode, mmode);
+			write_span_lm(start, end, minor + 1, omode, mmode);
+			write_span_lm(start - 1, end + 1, minor, omode, mmode);
 		}
 	}
 	// Now draw the innards.
-	error = deltax / 2;
-	y     = y0;
-	for (x = x0; x < x1; x++) {
-		if (steep) {
-			write_pixel_lm(y, x, mmode, imode);
+	line_runs_init(&lr, x0, y0, x1, y1);
+	while (line_runs_next(&lr, &start, &end, &minor)) {
+		if (lr.steep) {
+			write_vspan_lm(minor, start, end, imode, mmode);
 		} else {
-			write_pixel_lm(x, y, mmode, imode);
-		}
-		error -= deltay;
-		if (error < 0) {
-			y     += ystep;
-			error += deltax;
+			write_span_lm(start, end, minor, imode, mmode);
 		}
 	}
 }
@@ -1223,6 +1550,7 @@ void write_char(uint8_t ch, int x, int y, const struct FontEntry *font_info)
 	if (partly_out && ((x + font_info->width < GRAPHICS_LEFT) || (x > GRAPHICS_RIGHT) || (y + font_info->height < GRAPHICS_TOP) || (y > GRAPHICS_BOTTOM))) {
 		return;
 	}
+	mark_dirty_rows(y, y + font_info->height - 1);
 
 	// Compute starting address of character
 	int addr = CALC_BUFF_ADDR(x, y);
@@ -96,12 +96,16 @@ static void radioRxTask(void *parameters);
 static int32_t UAVTalkSendHandler(void *ctx, uint8_t * buf, int32_t length);
 static int32_t RadioSendHandler(void *ctx, uint8_t * buf, int32_t length);
 
-static void ProcessLocalStream(UAVTalkConnection inConnectionHandle,
+static int32_t ProcessLocalStream(UAVTalkConnection inConnectionHandle,
 				   UAVTalkConnection outConnectionHandle,
-				   uint8_t rxbyte);
-static void ProcessRadioStream(UAVTalkConnection inConnectionHandle,
+				   const uint8_t *rxbytes, uint16_t numbytes);
+static int32_t ProcessRadioStream(UAVTalkConnection inConnectionHandle,
 			       UAVTalkConnection outConnectionHandle,
-			       uint8_t rxbyte);
+			       const uint8_t *rxbytes, uint16_t numbytes);
+static void ProcessLocalPacket(UAVTalkConnection inConnectionHandle,
+				   UAVTalkConnection outConnectionHandle);
+static void ProcessRadioPacket(UAVTalkConnection inConnectionHandle,
+			       UAVTalkConnection outConnectionHandle);
 
 // ****************
 // Private variables
@@ -314,20 +318,28 @@ static void radioRxTask( __attribute__ ((unused))
 #endif
 		if (PIOS_COM_RADIOBRIDGE &&
 				PIOS_COM_Available(PIOS_COM_RADIOBRIDGE)) {
-			uint8_t serial_data[32];
-			uint16_t bytes_to_process =
-			    PIOS_COM_ReceiveBuffer(PIOS_COM_RADIOBRIDGE,
-						   serial_data,
-						   sizeof(serial_data),
-						   MAX_PORT_DELAY);
-			if (bytes_to_process > 0) {
-				// Pass the data through the UAVTalk parser.
-				for (uint8_t i = 0;
-				     i < bytes_to_process; i++) {
-					ProcessRadioStream(data->radioUAVTalkCon,
-							   data->telemUAVTalkCon,
-							   serial_data[i]);
+			uint16_t bytes_to_process;
+			const uint8_t *serial_data =
+			    PIOS_COM_ReceivePeek(PIOS_COM_RADIOBRIDGE,
+						 &bytes_to_process,
+						 MAX_PORT_DELAY);
+			// Pass the data through the UAVTalk parser, handing
+			// each packet's bytes back once it's been relayed.
+			while (bytes_to_process > 0) {
+				int32_t used = ProcessRadioStream(
+						data->radioUAVTalkCon,
+						data->telemUAVTalkCon,
+						serial_data, bytes_to_process);
+
+				if (used <= 0) {
+					used = bytes_to_process;
 				}
+
+				PIOS_COM_ReceiveRelease(PIOS_COM_RADIOBRIDGE,
+							used);
+
+				serial_data += used;
+				bytes_to_process -= used;
 			}
 
 			/* periodically inject ComBridgeStats to downstream */
@@ -381,24 +393,31 @@ static void telemetryRxTask( __attribute__ ((unused))
 		}
 
 		if (inputPort) {
-			uint8_t serial_data[32];
-			uint16_t bytes_to_process =
-			    PIOS_COM_ReceiveBuffer(inputPort, serial_data,
-						   sizeof(serial_data),
-						   MAX_PORT_DELAY);
-
-			if (bytes_to_process > 0) {
-				if (inputPort == PIOS_COM_TELEM_USB) {
-					processUsbActivity(true);
-				}
+			uint16_t bytes_to_process;
+			const uint8_t *serial_data =
+			    PIOS_COM_ReceivePeek(inputPort, &bytes_to_process,
+						 MAX_PORT_DELAY);
+
+			if ((bytes_to_process > 0) &&
+					(inputPort == PIOS_COM_TELEM_USB)) {
+				processUsbActivity(true);
+			}
 
-				for (uint8_t i = 0; i < bytes_to_process;
-						i++) {
-					ProcessLocalStream(
+			// Hand each packet's bytes back once it's been relayed.
+			while (bytes_to_process > 0) {
+				int32_t used = ProcessLocalStream(
 						data->telemUAVTalkCon,
 						data->radioUAVTalkCon,
-						serial_data[i]);
+						serial_data, bytes_to_process);
+
+				if (used <= 0) {
+					used = bytes_to_process;
 				}
+
+				PIOS_COM_ReceiveRelease(inputPort, used);
+
+				serial_data += used;
+				bytes_to_process -= used;
 			}
 		} else {
 			PIOS_Thread_Sleep(5);
@@ -456,93 +475,131 @@ static int32_t RadioSendHandler(void *ctx, uint8_t * buf, int32_t length)
 
 #define MetaObjectId(x) (x+1)
 /**
- * @brief Process a byte of data received on the telemetry stream
+ * @brief Process data received on the telemetry stream, up to the end of
+ * the next complete packet.
  *
  * @param[in] inConnectionHandle  The UAVTalk connection handle on the telemetry port
  * @param[in] outConnectionHandle  The UAVTalk connection handle on the radio port.
- * @param[in] rxbyte  The received byte.
+ * @param[in] rxbytes  The received bytes.
+ * @param[in] numbytes  The number of received bytes.
+ * @return The number of bytes consumed, or -1 on failure
  */
-static void ProcessLocalStream(UAVTalkConnection inConnectionHandle,
+static int32_t ProcessLocalStream(UAVTalkConnection inConnectionHandle,
 				   UAVTalkConnection outConnectionHandle,
-				   uint8_t rxbyte)
+				   const uint8_t *rxbytes, uint16_t numbytes)
 {
-	// Keep reading until we receive a completed packet.
-	UAVTalkRxState state =
-	    UAVTalkProcessInputStreamQuiet(inConnectionHandle, rxbyte);
-
-	if (state == UAVTALK_STATE_COMPLETE) {
-		PIOS_ANNUNC_Toggle(PIOS_LED_RX);
-
-		uint32_t objId = UAVTalkGetPacketObjId(inConnectionHandle);
-		switch (objId) {
-			// Ignore object...
-			// These objects are shadowed and are not sent over the
-			// transmitted over the radio link.
-			// - HWTauLink : No reconfiguring remote HW over radio
-			// link
-			// - UAVTalkReceiver : We generate this ourselves on
-			// the RX side and shouldn't forward it.
-			case HWTAULINK_OBJID:
-			case MetaObjectId(HWTAULINK_OBJID):
-			case UAVTALKRECEIVER_OBJID:
-			case MetaObjectId(UAVTALKRECEIVER_OBJID):
-				return;
-			default:
-				break;
-		}
+	UAVTalkRxState state;
+
+	// Read up to the end of the next completed packet.
+	int32_t used = UAVTalkProcessInputBlock(inConnectionHandle,
+			rxbytes, numbytes, &state);
 
-		// all packets are transparently relayed to the remote modem
-		// Incidentally this means that we fail requests for the
-		// radio stats and only telemeter them, but I consider this
-		// okee-dokee.
-		UAVTalkRelayPacket(inConnectionHandle, outConnectionHandle);
+	if (used > 0 && state == UAVTALK_STATE_COMPLETE) {
+		ProcessLocalPacket(inConnectionHandle, outConnectionHandle);
+	}
+
+	return used;
+}
+
+/**
+ * @brief Relay a packet completed on the telemetry stream
+ *
+ * @param[in] inConnectionHandle  The UAVTalk connection handle on the telemetry port
+ * @param[in] outConnectionHandle  The UAVTalk connection handle on the radio port.
+ */
+static void ProcessLocalPacket(UAVTalkConnection inConnectionHandle,
+				   UAVTalkConnection outConnectionHandle)
+{
+	PIOS_ANNUNC_Toggle(PIOS_LED_RX);
+
+	uint32_t objId = UAVTalkGetPacketObjId(inConnectionHandle);
+	switch (objId) {
+		// Ignore object...
+		// These objects are shadowed and are not sent over the
+		// transmitted over the radio link.
+		// - HWTauLink : No reconfiguring remote HW over radio
+		// link
+		// - UAVTalkReceiver : We generate this ourselves on
+		// the RX side and shouldn't forward it.
+		case HWTAULINK_OBJID:
+		case MetaObjectId(HWTAULINK_OBJID):
+		case UAVTALKRECEIVER_OBJID:
+		case MetaObjectId(UAVTALKRECEIVER_OBJID):
+			return;
+		default:
+			break;
 	}
+
+	// all packets are transparently relayed to the remote modem
+	// Incidentally this means that we fail requests for the
+	// radio stats and only telemeter them, but I consider this
+	// okee-dokee.
+	UAVTalkRelayPacket(inConnectionHandle, outConnectionHandle);
 }
 
 /**
- * @brief Process a byte of data received on the radio data stream.
+ * @brief Process data received on the radio data stream, up to the end of
+ * the next complete packet.
  *
  * @param[in] inConnectionHandle  The UAVTalk connection handle on the radio port.
  * @param[in] outConnectionHandle  The UAVTalk connection handle on the telemetry port.
- * @param[in] rxbyte  The received byte.
+ * @param[in] rxbytes  The received bytes.
+ * @param[in] numbytes  The number of received bytes.
+ * @return The number of bytes consumed, or -1 on failure
  */
-static void ProcessRadioStream(UAVTalkConnection inConnectionHandle,
+static int32_t ProcessRadioStream(UAVTalkConnection inConnectionHandle,
 			       UAVTalkConnection outConnectionHandle,
-			       uint8_t rxbyte)
+			       const uint8_t *rxbytes, uint16_t numbytes)
 {
-	// Keep reading until we receive a completed packet.
-	UAVTalkRxState state =
-	    UAVTalkProcessInputStreamQuiet(inConnectionHandle, rxbyte);
-
-	if (state == UAVTALK_STATE_COMPLETE) {
-		if (!data->have_port) {
-			telemetry_set_inhibit(true);
-			data->have_port = true;
-		}
+	UAVTalkRxState state;
 
-		// We only want to unpack certain objects from the remote modem
-		// Similarly we only want to relay certain objects to the telemetry port
-		uint32_t objId = UAVTalkGetPacketObjId(inConnectionHandle);
-		switch (objId) {
-			case HWTAULINK_OBJID:
-			case MetaObjectId(HWTAULINK_OBJID):
-			case UAVTALKRECEIVER_OBJID:
-			case MetaObjectId(UAVTALKRECEIVER_OBJID):
-				break;
-			case FLIGHTBATTERYSTATE_OBJID:
-			case FLIGHTSTATUS_OBJID:
-			case POSITIONACTUAL_OBJID:
-			case VELOCITYACTUAL_OBJID:
-			case BAROALTITUDE_OBJID:
-				// process / store locally for relaying to taranis
-				UAVTalkReceiveObject(inConnectionHandle);
-				UAVTalkRelayPacket(inConnectionHandle, outConnectionHandle);
-				break;
-			default:
-				// all other packets are relayed to the telemetry port
-				UAVTalkRelayPacket(inConnectionHandle,
-						outConnectionHandle);
-				break;
-		}
+	// Read up to the end of the next completed packet.
+	int32_t used = UAVTalkProcessInputBlock(inConnectionHandle,
+			rxbytes, numbytes, &state);
+
+	if (used > 0 && state == UAVTALK_STATE_COMPLETE) {
+		ProcessRadioPacket(inConnectionHandle, outConnectionHandle);
+	}
+
+	return used;
+}
+
+/**
+ * @brief Handle a packet completed on the radio data stream.
+ *
+ * @param[in] inConnectionHandle  The UAVTalk connection handle on the radio port.
+ * @param[in] outConnectionHandle  The UAVTalk connection handle on the telemetry port.
+ */
+static void ProcessRadioPacket(UAVTalkConnection inConnectionHandle,
+			       UAVTalkConnection outConnectionHandle)
+{
+	if (!data->have_port) {
+		telemetry_set_inhibit(true);
+		data->have_port = true;
+	}
+
+	// We only want to unpack certain objects from the remote modem
+	// Similarly we only want to relay certain objects to the telemetry port
+	uint32_t objId = UAVTalkGetPacketObjId(inConnectionHandle);
+	switch (objId) {
+		case HWTAULINK_OBJID:
+		case MetaObjectId(HWTAULINK_OBJID):
+		case UAVTALKRECEIVER_OBJID:
+		case MetaObjectId(UAVTALKRECEIVER_OBJID):
+			break;
+		case FLIGHTBATTERYSTATE_OBJID:
+		case FLIGHTSTATUS_OBJID:
+		case POSITIONACTUAL_OBJID:
+		case VELOCITYACTUAL_OBJID:
+		case BAROALTITUDE_OBJID:
+			// process / store locally for relaying to taranis
+			UAVTalkReceiveObject(inConnectionHandle);
+			UAVTalkRelayPacket(inConnectionHandle, outConnectionHandle);
+			break;
+		default:
+			// all other packets are relayed to the telemetry port
+			UAVTalkRelayPacket(inConnectionHandle,
+					outConnectionHandle);
+			break;
 	}
 }
@@ -36,6 +36,8 @@
 #include "pios_queue.h"
 #include "misc_math.h"
 #include "lpfilter.h"
+#include "loop_timing.h"
+#include "imu_increments.h"
 #include "sensors.h"
 
 #if defined(PIOS_INCLUDE_PX4FLOW)
@@ -65,6 +67,7 @@ extern pios_i2c_t external_i2c_adapter_id;
 #define REQUIRED_GOOD_CYCLES 50
 #define MAX_TIME_BETWEEN_VALID_BARO_DATAS_US (100*1000)
 #define MAX_TIME_BETWEEN_VALID_MAG_DATAS_US (300*1000)
+#define MAX_GYRO_SAMPLE_INTERVAL 0.01f
 
 // Private types
 enum mag_calibration_algo {
@@ -74,7 +77,10 @@ enum mag_calibration_algo {
 
 // Private functions
 static void update_accels(struct pios_sensor_accel_data *accel);
-static void update_gyros(struct pios_sensor_gyro_data *gyro);
+static void update_gyros(struct pios_sensor_gyro_data *gyro,
+		const GyrosBiasData *bias);
+static void update_gyros_bias(struct pios_sensor_gyro_data *gyro,
+		GyrosBiasData *bias);
 static void update_mags(struct pios_sensor_mag_data *mag);
 static void update_baro(struct pios_sensor_baro_data *baro);
 
@@ -99,6 +105,7 @@ static void sensors_settings_update();
 // Private variables
 static INSSettingsData insSettings;
 static AccelsData accelsData;
+static GyrosData gyrosData;
 
 static volatile bool settings_updated = true;
 
@@ -155,6 +162,10 @@ int32_t sensors_init(void)
 		return -1;
 	}
 
+	if (imu_increments_initialize() == -1) {
+		return -1;
+	}
+
 #if defined (PIOS_INCLUDE_OPTICALFLOW)
 	if (OpticalFlowSettingsInitialize() == -1){
 		return -1;
@@ -214,6 +225,9 @@ bool sensors_step()
 {
 	static uint32_t good_runs = 0;
 	static uint32_t last_baro_update_time;
+	static uint32_t last_sample_raw;
+	static uint32_t last_sample_lag_us;
+	static struct pios_sensor_imu_batch batch;
 
 	bool ret = false;	/* Are gyros OK this time? */
 
@@ -221,8 +235,6 @@ bool sensors_step()
 		sensors_settings_update();
 	}
 
-	struct pios_sensor_gyro_data gyros;
-	struct pios_sensor_accel_data accels;
 	struct pios_sensor_mag_data mags;
 	struct pios_sensor_baro_data baro;
 
@@ -282,23 +294,74 @@ bool sensors_step()
 	}
 #endif /* PIOS_INCLUDE_RANGEFINDER */
 
-	//Block on gyro data but nothing else
-	if (PIOS_SENSORS_GetData(PIOS_SENSOR_GYRO, &gyros, MAX_SENSOR_PERIOD) == false) {
+	// Block on gyro data but nothing else.  A FIFO may give several
+	// samples at once, each with the accels taken alongside.
+	if (PIOS_SENSORS_GetBatch(PIOS_SENSOR_GYRO, &batch, MAX_SENSOR_PERIOD) == false) {
 		good_run = false;
 	} else {
+		loop_timing_begin(LOOP_TIMING_SENSORS);
 		ret = true;
-	}
 
-	if (PIOS_SENSORS_GetData(PIOS_SENSOR_ACCEL, &accels, 0) == false) {
-		// If no new accels data is ready, reuse the latest sample
+		// Everything after the first sample is evenly spaced; the
+		// first follows the last one of the previous batch.
+		// Raw times wrap at the counter's width rather than at a
+		// whole number of microseconds, so only their difference
+		// is meaningful.
+		int32_t span_us = (batch.count - 1) * batch.interval_us;
+		int32_t first_us = (int32_t) PIOS_DELAY_DiffuS2(last_sample_raw,
+				batch.timestamp) + last_sample_lag_us -
+			batch.lag_us - span_us;
+
+		if (first_us < 0) {
+			first_us = 0;
+		}
+
+		float first_dT = first_us * 1.0e-6f;
+		float interval_dT = batch.interval_us * 1.0e-6f;
+
+		last_sample_raw = batch.timestamp;
+		last_sample_lag_us = batch.lag_us;
+
+		GyrosBiasData gyrosBias;
+		update_gyros_bias(&batch.gyro[batch.count - 1], &gyrosBias);
+
+		for (int i = 0; i < batch.count; i++) {
+			// The rest of the code expects the accels to be
+			// available first
+			if (batch.has_accel) {
+				update_accels(&batch.accel[i]);
+			}
+
+			update_gyros(&batch.gyro[i], &gyrosBias);
+
+			if (!imu_increments_active()) {
+				continue;
+			}
+
+			// Accumulate the sample for the INS, which runs at
+			// its own rate
+			float gyro_dT = i ? interval_dT : first_dT;
+
+			if (gyro_dT > MAX_GYRO_SAMPLE_INTERVAL) {
+				gyro_dT = MAX_GYRO_SAMPLE_INTERVAL;
+			}
+
+			float rates[3] = {
+				gyrosData.x * DEG2RAD,
+				gyrosData.y * DEG2RAD,
+				gyrosData.z * DEG2RAD
+			};
+
+			imu_increments_add(rates, &accelsData.x, gyro_dT);
+		}
+
+		// Only the newest sample is published.  If no new accels
+		// data is ready, reuse the latest sample.
 		AccelsSet(&accelsData);
-	} else {
-		update_accels(&accels);
+		GyrosSet(&gyrosData);
 	}
 
-	// Update gyros after the accels since the rest of the code expects
-	// the accels to be available first
-	update_gyros(&gyros);
+	loop_timing_end(LOOP_TIMING_SENSORS);
 
 	// Check total time to get the sensors wasn't over the limit
 	uint32_t dT_us = PIOS_DELAY_DiffuS(timeval);
@@ -329,7 +392,8 @@ bool sensors_step()
 }
 
 /**
- * @brief Apply calibration and rotation to the raw accel data
+ * @brief Apply calibration and rotation to the raw accel data, into
+ * accelsData
  * @param[in] accels The raw accel data
  */
 static void update_accels(struct pios_sensor_accel_data *accels)
@@ -357,15 +421,43 @@ static void update_accels(struct pios_sensor_accel_data *accels)
 
 	accelsData.z += z_accel_offset;
 	accelsData.temperature = accels->temperature;
+}
 
-	AccelsSet(&accelsData);
+/**
+ * @brief Update the temperature and estimator gyro biases, once a batch
+ * @param[in] gyros The newest raw gyro data
+ * @param[out] bias The bias the state estimator found
+ */
+static void update_gyros_bias(struct pios_sensor_gyro_data *gyros,
+		GyrosBiasData *bias)
+{
+	gyrosData.temperature = gyros->temperature;
+
+	// Update the bias due to the temperature
+	updateTemperatureComp(gyrosData.temperature, gyro_temp_bias);
+
+	if (bias_correct_gyro) {
+		GyrosBiasGet(bias);
+
+		const float GYRO_BIAS_WARN = 10.0f;
+		if (fabsf(bias->x) > GYRO_BIAS_WARN ||
+			fabsf(bias->y) > GYRO_BIAS_WARN ||
+			fabsf(bias->z) > GYRO_BIAS_WARN) {
+			AlarmsSet(SYSTEMALARMS_ALARM_GYROBIAS, SYSTEMALARMS_ALARM_WARNING);
+		} else {
+			AlarmsClear(SYSTEMALARMS_ALARM_GYROBIAS);
+		}
+	}
 }
 
 /**
- * @brief Apply calibration and rotation to the raw gyro data
+ * @brief Apply calibration and rotation to the raw gyro data, into
+ * gyrosData
  * @param[in] gyros The raw gyro data
+ * @param[in] bias The bias from the state estimator
  */
-static void update_gyros(struct pios_sensor_gyro_data *gyros)
+static void update_gyros(struct pios_sensor_gyro_data *gyros,
+		const GyrosBiasData *bias)
 {
 	// Scale the gyros
 	float gyros_out[3] = {
@@ -376,12 +468,6 @@ static void update_gyros(struct pios_sensor_gyro_data *gyros)
 
 	lpfilter_run(gyro_filter, gyros_out);
 
-	GyrosData gyrosData;
-	gyrosData.temperature = gyros->temperature;
-
-	// Update the bias due to the temperature
-	updateTemperatureComp(gyrosData.temperature, gyro_temp_bias);
-
 	// Apply temperature bias correction before the rotation
 	if (bias_correct_gyro) {
 		gyros_out[0] -= gyro_temp_bias[0];
@@ -403,23 +489,10 @@ static void update_gyros(struct pios_sensor_gyro_data *gyros)
 
 	if (bias_correct_gyro) {
 		// Apply bias correction to the gyros from the state estimator
-		GyrosBiasData gyrosBias;
-		GyrosBiasGet(&gyrosBias);
-		gyrosData.x -= gyrosBias.x;
-		gyrosData.y -= gyrosBias.y;
-		gyrosData.z -= gyrosBias.z;
-
-		const float GYRO_BIAS_WARN = 10.0f;
-		if (fabsf(gyrosBias.x) > GYRO_BIAS_WARN ||
-			fabsf(gyrosBias.y) > GYRO_BIAS_WARN ||
-			fabsf(gyrosBias.z) > GYRO_BIAS_WARN) {
-			AlarmsSet(SYSTEMALARMS_ALARM_GYROBIAS, SYSTEMALARMS_ALARM_WARNING);
-		} else {
-			AlarmsClear(SYSTEMALARMS_ALARM_GYROBIAS);
-		}
+		gyrosData.x -= bias->x;
+		gyrosData.y -= bias->y;
+		gyrosData.z -= bias->z;
 	}
-
-	GyrosSet(&gyrosData);
 }
 
 /**
@@ -749,11 +822,53 @@ static void sensors_settings_update()
 		rotate = 1;
 	}
 
-	float gyro_dT = 1.0f / (float)PIOS_SENSORS_GetSampleRate(PIOS_SENSOR_GYRO);
-	float accel_dT = 1.0f / (float)PIOS_SENSORS_GetSampleRate(PIOS_SENSOR_ACCEL);
+	// The filters see every sample of every batch
+	float gyro_dT = 1.0f / (float)(PIOS_SENSORS_GetSampleRate(PIOS_SENSOR_GYRO) *
+			PIOS_SENSORS_GetBatchSize(PIOS_SENSOR_GYRO));
+	float accel_dT = 1.0f / (float)(PIOS_SENSORS_GetSampleRate(PIOS_SENSOR_ACCEL) *
+			PIOS_SENSORS_GetBatchSize(PIOS_SENSOR_ACCEL));
+	uint8_t gyro_order = sensorSettings.LowpassOrder;
+	uint8_t accel_order = sensorSettings.LowpassOrder;
+
+	// Samples replayed from a log were calibrated, rotated and filtered
+	// when they were recorded; doing it again would change them.
+	if (PIOS_SENSORS_GetCalibrated(PIOS_SENSOR_GYRO)) {
+		for (int i = 0; i < 3; i++) {
+			gyro_scale[i] = 1;
+		}
+
+		for (int i = 0; i < 4; i++) {
+			gyro_coeff_x[i] = 0;
+			gyro_coeff_y[i] = 0;
+			gyro_coeff_z[i] = 0;
+		}
+
+		gyro_order = 0;
+		rotate = 0;
+	}
+
+	if (PIOS_SENSORS_GetCalibrated(PIOS_SENSOR_ACCEL)) {
+		for (int i = 0; i < 3; i++) {
+			accel_scale[i] = 1;
+			accel_bias[i] = 0;
+		}
+
+		z_accel_offset = 0;
+		accel_order = 0;
+		rotate = 0;
+	}
+
+	if (PIOS_SENSORS_GetCalibrated(PIOS_SENSOR_MAG)) {
+		for (int i = 0; i < 3; i++) {
+			mag_scale[i] = 1;
+			mag_bias[i] = 0;
+		}
+
+		rotate = 0;
+	}
 
-	lpfilter_create(&gyro_filter, sensorSettings.LowpassCutoff, gyro_dT, sensorSettings.LowpassOrder, 3);
-	lpfilter_create(&accel_filter, sensorSettings.LowpassCutoff, accel_dT, sensorSettings.LowpassOrder, 3);
+	lpfilter_create(&gyro_filter, sensorSettings.LowpassCutoff, gyro_dT, gyro_order, 3);
+	lpfilter_create(&accel_filter, sensorSettings.LowpassCutoff, accel_dT, accel_order, 3);
 }
 /**
   * @}
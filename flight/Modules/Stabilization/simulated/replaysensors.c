@@ -0,0 +1,467 @@
+/**
+ ******************************************************************************
+ * @addtogroup Modules Modules
+ * @{
+ * @addtogroup Sensors Sensor acquisition module
+ * @{
+ *
+ * @file       replaysensors.c
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @brief      Feed a recorded sensor stream back through the flight stack
+ *
+ * Instead of synthesizing sensor data from a model, this reads a recorded
+ * stream of gyro, accel, mag, baro, GPS and receiver samples (see
+ * python/dronin/replay.py, which makes them from flight logs) and hands
+ * each one to the flight code once the virtual clock reaches its time.
+ * The stream drives the fake clock itself, so a replay takes the same
+ * samples at the same virtual times on every run, and runs as fast as the
+ * speed factor asks rather than in real time.
+ *
+ * Stream format, all little endian:
+ *   header: "DRSS", u16 version, u16 gyro rate, u16 mag rate,
+ *           u16 baro rate, u8 receiver channels, 3 reserved bytes
+ *   records: u32 time (us, wraps), u8 type, u8 length, length bytes
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ ******************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "pios.h"
+#include "openpilot.h"
+#include "pios_thread.h"
+
+#ifdef PIOS_INCLUDE_SIMSENSORS
+
+#include "pios_hal.h"
+#include "pios_rcvr_priv.h"
+
+#include "baroaltitude.h"
+#include "gpsposition.h"
+#include "gpsvelocity.h"
+#include "manualcontrolcommand.h"
+#include "manualcontrolsettings.h"
+
+#define REPLAY_MAGIC "DRSS"
+#define REPLAY_VERSION 1
+
+//! How long to keep the clock running after the stream ends, so logs drain
+#define REPLAY_DRAIN_MS 500
+
+enum replay_record_type {
+	REPLAY_GYRO = 1,	//!< pios_sensor_gyro_data
+	REPLAY_ACCEL = 2,	//!< pios_sensor_accel_data
+	REPLAY_MAG = 3,		//!< pios_sensor_mag_data
+	REPLAY_BARO = 4,	//!< pios_sensor_baro_data
+	REPLAY_GPSPOSITION = 5,	//!< struct replay_gps_position
+	REPLAY_GPSVELOCITY = 6,	//!< float north, east, down, accuracy
+	REPLAY_RECEIVER = 7,	//!< u16 per channel, ManualControlCommand order
+};
+
+struct replay_header {
+	char magic[4];
+	uint16_t version;
+	uint16_t gyro_rate;
+	uint16_t mag_rate;
+	uint16_t baro_rate;
+	uint8_t rcvr_channels;
+	uint8_t reserved[3];
+} __attribute__((packed));
+
+struct replay_record {
+	uint32_t time_us;
+	uint8_t type;
+	uint8_t length;
+} __attribute__((packed));
+
+struct replay_gps_position {
+	int32_t latitude;
+	int32_t longitude;
+	float altitude;
+	float geoid_separation;
+	float heading;
+	float groundspeed;
+	float accuracy;
+	float pdop;
+	uint8_t satellites;
+	uint8_t status;
+} __attribute__((packed));
+
+/* From the -R and -F options */
+extern const char *replay_path;
+extern float replay_speed;
+
+static FILE *replay_file;
+
+static uint64_t replay_elapsed_us;	/* stream time, from its first record */
+static uint32_t replay_last_us;
+static uint32_t replay_start_ms;	/* virtual clock at the first record */
+static uint32_t replay_records;
+static bool replay_started;
+
+static bool have_accel_data, have_mag_data, have_baro_data;
+
+static struct pios_sensor_accel_data accel_data;
+static struct pios_sensor_mag_data mag_data;
+static struct pios_sensor_baro_data baro_data;
+
+static uint8_t rcvr_channels;
+static volatile uint16_t rcvr_value[MANUALCONTROLCOMMAND_CHANNEL_NUMELEM];
+
+static int32_t replay_rcvr_get(uintptr_t id, uint8_t channel)
+{
+	(void) id;
+
+	if (channel >= rcvr_channels) {
+		return PIOS_RCVR_INVALID;
+	}
+
+	return rcvr_value[channel];
+}
+
+static const struct pios_rcvr_driver replay_rcvr_driver = {
+	.read = replay_rcvr_get,
+};
+
+/**
+ * Advance the virtual clock until it reaches the stream's time.  Each
+ * millisecond tick is given 1/speed of a millisecond of real time, for the
+ * tasks it wakes to run.
+ */
+static void replay_wait_until(uint64_t elapsed_us)
+{
+	uint32_t target_ms = elapsed_us / 1000;
+	useconds_t tick_us = 1000 / replay_speed;
+
+	while ((uint32_t) (PIOS_Thread_Systime() - replay_start_ms) < target_ms) {
+		if (tick_us) {
+			usleep(tick_us);
+		}
+
+		PIOS_Thread_FakeClock_Tick();
+	}
+}
+
+static void replay_finish(void)
+{
+	printf("Replay of %s finished: %u records, %u.%03u s\n",
+			replay_path, (unsigned) replay_records,
+			(unsigned) (replay_elapsed_us / 1000000),
+			(unsigned) (replay_elapsed_us / 1000 % 1000));
+
+	replay_wait_until(replay_elapsed_us + REPLAY_DRAIN_MS * 1000);
+
+	fclose(replay_file);
+
+	exit(0);
+}
+
+static void replay_gps_position(const struct replay_gps_position *rec)
+{
+	GPSPositionData gps_position;
+	GPSPositionGet(&gps_position);
+
+	gps_position.Latitude = rec->latitude;
+	gps_position.Longitude = rec->longitude;
+	gps_position.Altitude = rec->altitude;
+	gps_position.GeoidSeparation = rec->geoid_separation;
+	gps_position.Heading = rec->heading;
+	gps_position.Groundspeed = rec->groundspeed;
+	gps_position.Accuracy = rec->accuracy;
+	gps_position.PDOP = rec->pdop;
+	gps_position.Satellites = rec->satellites;
+	gps_position.Status = rec->status;
+
+	GPSPositionSet(&gps_position);
+}
+
+static void replay_gps_velocity(const float *rec)
+{
+	GPSVelocityData gps_velocity;
+
+	gps_velocity.North = rec[0];
+	gps_velocity.East = rec[1];
+	gps_velocity.Down = rec[2];
+	gps_velocity.Accuracy = rec[3];
+
+	GPSVelocitySet(&gps_velocity);
+}
+
+/**
+ * Hand out the records up to and including the next gyro sample, each at
+ * its own time.  Everything but the gyro is stashed for the other sensor
+ * callbacks or set straight into its object.
+ */
+static bool replay_callback_gyro(void *ctx, void *output,
+		int ms_to_wait, int *next_call)
+{
+	(void) ctx; (void) ms_to_wait;
+
+	*next_call = 0;
+
+	while (true) {
+		struct replay_record rec;
+		union {
+			struct pios_sensor_gyro_data gyro;
+			struct pios_sensor_accel_data accel;
+			struct pios_sensor_mag_data mag;
+			struct pios_sensor_baro_data baro;
+			struct replay_gps_position gps_position;
+			float gps_velocity[4];
+			uint16_t channels[MANUALCONTROLCOMMAND_CHANNEL_NUMELEM];
+			uint8_t raw[255];
+		} payload;
+
+		if (fread(&rec, sizeof(rec), 1, replay_file) != 1 ||
+				fread(&payload, 1, rec.length, replay_file) !=
+					rec.length) {
+			replay_finish();
+		}
+
+		if (!replay_started) {
+			replay_started = true;
+			replay_start_ms = PIOS_Thread_Systime();
+		} else {
+			replay_elapsed_us += (uint32_t) (rec.time_us - replay_last_us);
+		}
+
+		replay_last_us = rec.time_us;
+		replay_records++;
+
+		replay_wait_until(replay_elapsed_us);
+
+		switch (rec.type) {
+		case REPLAY_GYRO:
+			if (rec.length < sizeof(payload.gyro)) {
+				break;
+			}
+
+			memcpy(output, &payload.gyro, sizeof(payload.gyro));
+			return true;
+		case REPLAY_ACCEL:
+			if (rec.length >= sizeof(payload.accel)) {
+				accel_data = payload.accel;
+				have_accel_data = true;
+			}
+			break;
+		case REPLAY_MAG:
+			if (rec.length >= sizeof(payload.mag)) {
+				mag_data = payload.mag;
+				have_mag_data = true;
+			}
+			break;
+		case REPLAY_BARO:
+			if (rec.length >= sizeof(payload.baro)) {
+				baro_data = payload.baro;
+				have_baro_data = true;
+			}
+			break;
+		case REPLAY_GPSPOSITION:
+			if (rec.length >= sizeof(payload.gps_position)) {
+				replay_gps_position(&payload.gps_position);
+			}
+			break;
+		case REPLAY_GPSVELOCITY:
+			if (rec.length >= sizeof(payload.gps_velocity)) {
+				replay_gps_velocity(payload.gps_velocity);
+			}
+			break;
+		case REPLAY_RECEIVER:
+			for (int i = 0; i < rcvr_channels &&
+					i < rec.length / 2; i++) {
+				rcvr_value[i] = payload.channels[i];
+			}
+			break;
+		default:
+			/* Newer record types are skipped */
+			break;
+		}
+	}
+}
+
+static bool replay_callback_accel(void *ctx, void *output,
+		int ms_to_wait, int *next_call)
+{
+	(void) ctx; (void) ms_to_wait;
+
+	*next_call = 0;
+
+	if (have_accel_data) {
+		have_accel_data = false;
+
+		memcpy(output, &accel_data, sizeof(accel_data));
+
+		return true;
+	}
+
+	return false;
+}
+
+static bool replay_callback_mag(void *ctx, void *output,
+		int ms_to_wait, int *next_call)
+{
+	(void) ctx; (void) ms_to_wait;
+
+	*next_call = 0;
+
+	if (have_mag_data) {
+		have_mag_data = false;
+
+		memcpy(output, &mag_data, sizeof(mag_data));
+
+		return true;
+	}
+
+	return false;
+}
+
+static bool replay_callback_baro(void *ctx, void *output,
+		int ms_to_wait, int *next_call)
+{
+	(void) ctx; (void) ms_to_wait;
+
+	*next_call = 0;
+
+	if (have_baro_data) {
+		have_baro_data = false;
+
+		memcpy(output, &baro_data, sizeof(baro_data));
+
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Route the replayed channels to ManualControl.  They're recorded in
+ * ManualControlCommand order, so each group reads its own channel from a
+ * receiver pretending to be PWM; the calibration is left as configured.
+ * This is only changed in RAM, never saved.
+ */
+static void replay_rcvr_init(void)
+{
+	uintptr_t rcvr_id;
+
+	for (int i = 0; i < MANUALCONTROLCOMMAND_CHANNEL_NUMELEM; i++) {
+		rcvr_value[i] = PIOS_RCVR_TIMEOUT;
+	}
+
+	if (PIOS_RCVR_Init(&rcvr_id, &replay_rcvr_driver, 0)) {
+		PIOS_Assert(0);
+	}
+
+	PIOS_HAL_SetReceiver(MANUALCONTROLSETTINGS_CHANNELGROUPS_PWM, rcvr_id);
+
+	ManualControlSettingsData settings;
+	ManualControlSettingsGet(&settings);
+
+	for (int i = 0; i < MANUALCONTROLSETTINGS_CHANNELGROUPS_NUMELEM &&
+			i < rcvr_channels; i++) {
+		if (settings.ChannelGroups[i] !=
+				MANUALCONTROLSETTINGS_CHANNELGROUPS_NONE) {
+			settings.ChannelGroups[i] =
+				MANUALCONTROLSETTINGS_CHANNELGROUPS_PWM;
+			settings.ChannelNumber[i] = i + 1;
+		}
+	}
+
+	ManualControlSettingsSet(&settings);
+}
+
+/**
+ * Open the stream named with -R and register it in place of the simulated
+ * sensors.
+ * \returns 0 on success or -1 if the stream can't be used
+ */
+int32_t replaysensors_init(void)
+{
+	struct replay_header header;
+
+	replay_file = fopen(replay_path, "rb");
+
+	if (!replay_file) {
+		perror(replay_path);
+		return -1;
+	}
+
+	if (fread(&header, sizeof(header), 1, replay_file) != 1 ||
+			memcmp(header.magic, REPLAY_MAGIC, sizeof(header.magic)) ||
+			header.version != REPLAY_VERSION || !header.gyro_rate) {
+		printf("ReplaySensorsInitialize: %s isn't a sensor stream\n",
+				replay_path);
+		fclose(replay_file);
+		replay_file = NULL;
+		return -1;
+	}
+
+	printf("ReplaySensorsInitialize: Replaying %s at %gx\n",
+			replay_path, (double) replay_speed);
+
+	PIOS_SENSORS_RegisterCallback(PIOS_SENSOR_GYRO,
+			replay_callback_gyro, NULL);
+	PIOS_SENSORS_RegisterCallback(PIOS_SENSOR_ACCEL,
+			replay_callback_accel, NULL);
+	PIOS_SENSORS_SetSampleRate(PIOS_SENSOR_GYRO, header.gyro_rate);
+	PIOS_SENSORS_SetSampleRate(PIOS_SENSOR_ACCEL, header.gyro_rate);
+
+	/* Logged samples have been through calibration and filtering */
+	PIOS_SENSORS_SetCalibrated(PIOS_SENSOR_GYRO);
+	PIOS_SENSORS_SetCalibrated(PIOS_SENSOR_ACCEL);
+
+	if (header.mag_rate) {
+		PIOS_SENSORS_RegisterCallback(PIOS_SENSOR_MAG,
+				replay_callback_mag, NULL);
+		PIOS_SENSORS_SetSampleRate(PIOS_SENSOR_MAG, header.mag_rate);
+		PIOS_SENSORS_SetCalibrated(PIOS_SENSOR_MAG);
+	}
+
+	if (header.baro_rate) {
+		PIOS_SENSORS_RegisterCallback(PIOS_SENSOR_BARO,
+				replay_callback_baro, NULL);
+		PIOS_SENSORS_SetSampleRate(PIOS_SENSOR_BARO, header.baro_rate);
+	}
+
+	BaroAltitudeInitialize();
+	GPSPositionInitialize();
+	GPSVelocityInitialize();
+
+	rcvr_channels = header.rcvr_channels;
+
+	if (rcvr_channels > MANUALCONTROLCOMMAND_CHANNEL_NUMELEM) {
+		rcvr_channels = MANUALCONTROLCOMMAND_CHANNEL_NUMELEM;
+	}
+
+	if (rcvr_channels) {
+		replay_rcvr_init();
+	}
+
+	AlarmsClear(SYSTEMALARMS_ALARM_SENSORS);
+
+	PIOS_SENSORS_SetMaxGyro(2000);
+
+	return 0;
+}
+
+#endif /* PIOS_INCLUDE_SIMSENSORS */
+
+/**
+ * @}
+ * @}
+ */
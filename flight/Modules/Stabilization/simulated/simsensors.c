@@ -92,6 +92,9 @@ extern bool use_yasim;
 static void simulateYasim();
 #endif
 
+extern const char *replay_path;
+extern int32_t replaysensors_init(void);
+
 // Private functions
 static void simsensors_step();
 static void simulateModelQuadcopter();
@@ -175,6 +178,10 @@ int32_t simsensors_init(void)
 		return -1;
 	}
 
+	if (replay_path) {
+		return replaysensors_init();
+	}
+
 	printf("SimSensorsInitialize: Using simulated sensors.\n");
 
 	PIOS_SENSORS_RegisterCallback(PIOS_SENSOR_GYRO,
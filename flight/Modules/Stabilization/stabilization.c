@@ -76,6 +76,7 @@
 #include "misc_math.h"
 #include "smoothcontrol.h"
 #include "lqg.h"
+#include "loop_timing.h"
 
 // Sensors subsystem which runs in this task
 #include "sensors.h"
@@ -265,6 +266,10 @@ int32_t StabilizationInitialize()
 		return -1;
 	}
 
+	if (loop_timing_initialize() != 0) {
+		return -1;
+	}
+
 	return 0;
 }
 
@@ -810,6 +815,8 @@ static void stabilizationTask(void* parameters)
 			continue;
 		}
 
+		loop_timing_begin(LOOP_TIMING_STABILIZATION);
+
 		static bool frequency_wrong = false;
 
 		float dT = PIOS_DELAY_DiffuS(timeval) * 1.0e-6f;
@@ -1510,6 +1517,8 @@ static void stabilizationTask(void* parameters)
 
 		ActuatorDesiredSet(&actuatorDesired);
 
+		loop_timing_end(LOOP_TIMING_STABILIZATION);
+
 		if(flightStatus.Armed != FLIGHTSTATUS_ARMED_ARMED ||
 		   (lowThrottleZeroIntegral && get_throttle(&actuatorDesired, &airframe_type) == 0))
 		{
@@ -669,6 +669,33 @@ static void objectUpdatedCb(const UAVObjEvent *ev,
 
 			// Save selected instance
 			retval = UAVObjSave(obj, objper.InstanceID);
+		} else if (objper.Operation == OBJECTPERSISTENCE_OPERATION_SAVEBATCH) {
+			// Save the selected instance and the batch list after it,
+			// all in one go
+			UAVObjHandle objs[1 + OBJECTPERSISTENCE_BATCHOBJECTID_NUMELEM];
+			uint16_t inst_ids[1 + OBJECTPERSISTENCE_BATCHOBJECTID_NUMELEM];
+			uint16_t num_objs = 0;
+
+			objs[num_objs] = UAVObjGetByID(objper.ObjectID);
+			inst_ids[num_objs++] = objper.InstanceID;
+
+			for (int i = 0; i < OBJECTPERSISTENCE_BATCHOBJECTID_NUMELEM &&
+					objper.BatchObjectID[i]; i++) {
+				objs[num_objs] = UAVObjGetByID(objper.BatchObjectID[i]);
+				inst_ids[num_objs++] = objper.BatchInstanceID[i];
+			}
+
+			retval = 0;
+
+			for (int i = 0; i < num_objs; i++) {
+				if (objs[i] == 0) {
+					retval = -1;
+				}
+			}
+
+			if (retval == 0) {
+				retval = UAVObjSaveBatch(objs, inst_ids, num_objs);
+			}
 		} else if (objper.Operation == OBJECTPERSISTENCE_OPERATION_DELETE) {
 			// Delete selected instance
 			retval = UAVObjDeleteById(objper.ObjectID, objper.InstanceID);
@@ -736,12 +763,21 @@ static void updateStats()
 {
 	static uint32_t lastTickCount = 0;
 	SystemStatsData stats;
+	struct pios_heap_stats heap_stats;
 
 	// Get stats and update
 	SystemStatsGet(&stats);
 	stats.FlightTime = PIOS_Thread_Systime();
-	stats.HeapRemaining = PIOS_heap_get_free_size();
-	stats.FastHeapRemaining = PIOS_fastheap_get_free_size();
+
+	PIOS_heap_get_stats(&heap_stats);
+	stats.HeapRemaining = heap_stats.free_bytes;
+	stats.HeapMinRemaining = heap_stats.min_free_bytes;
+	stats.HeapLargestFree = heap_stats.largest_free;
+
+	PIOS_fastheap_get_stats(&heap_stats);
+	stats.FastHeapRemaining = heap_stats.free_bytes;
+	stats.FastHeapMinRemaining = heap_stats.min_free_bytes;
+	stats.FastHeapLargestFree = heap_stats.largest_free;
 
 	// Get Irq stack status
 	stats.IRQStackRemaining = (uint16_t)PIOS_SYS_IrqStackUnused();
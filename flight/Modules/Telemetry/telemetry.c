@@ -44,6 +44,7 @@
 #include "pios_hal.h"
 
 #include <uavtalk.h>
+#include "uavobjectsinit.h"
 
 #ifndef TELEM_QUEUE_SIZE
 /* 115200 = 11520 bytes/sec; if each transaction is 32 bytes,
@@ -90,6 +91,18 @@ struct pending_req {
 	char valid;
 };
 
+/* Where a reader of the state file has got to.  Each record is staged whole,
+ * so an object can't change halfway through being sent. */
+struct state_file_cursor {
+	uint32_t file_id;
+	uint32_t offset;	/* File offset of the staged record */
+	uint16_t index;		/* 2 * object index, + 1 for its metaobject */
+	uint16_t inst_id;	/* Next instance to stage */
+	uint16_t length;	/* Of the staged record; 0 if none */
+
+	uint8_t *record;
+};
+
 struct telemetry_state {
 	struct pios_queue *queue;
 
@@ -106,6 +119,8 @@ struct telemetry_state {
 	volatile bool request_inhibit, tx_inhibited, rx_inhibited;
 
 	UAVTalkConnection uavTalkCon;
+
+	struct state_file_cursor state_file;
 };
 
 static struct telemetry_state telem_state = { };
@@ -424,10 +439,141 @@ static void addAckPending(telem_t telem, UAVObjHandle obj, uint16_t inst_id)
 	}
 }
 
+/**
+ * Stage the next record of a state file, and move the cursor past it.
+ * \param[in] cur The state file cursor
+ * \returns true if a record was staged, false at the end of the file
+ */
+static bool stageStateRecord(struct state_file_cursor *cur)
+{
+	struct uavtalk_state_record *hdr =
+		(struct uavtalk_state_record *) cur->record;
+	uint8_t *data = cur->record + sizeof(*hdr);
+
+	uint16_t end = 2 * UAVObjCount();
+
+	while (cur->index < end) {
+		UAVObjHandle obj = UAVObjGetByID(UAVObjIDByIndex(cur->index / 2));
+
+		if (obj && (cur->index & 1)) {
+			obj = UAVObjGetLinkedObj(obj);
+		}
+
+		bool wanted = obj &&
+			(cur->inst_id < UAVObjGetNumInstances(obj));
+
+		if (wanted && (cur->file_id == UAVTALK_SETTINGS_CRC_FILE_ID)) {
+			uint32_t crc;
+
+			if (UAVObjIsSettings(obj) &&
+					!UAVObjGetInstanceCRC(obj, cur->inst_id, &crc)) {
+				memcpy(data, &crc, sizeof(crc));
+				hdr->length = sizeof(crc);
+			} else {
+				wanted = false;
+			}
+		} else if (wanted) {
+			if ((cur->file_id == UAVTALK_DYNAMIC_STATE_FILE_ID) &&
+					UAVObjIsSettings(obj)) {
+				wanted = false;
+			} else if (!UAVObjPack(obj, cur->inst_id, data)) {
+				hdr->length = UAVObjGetNumBytes(obj);
+			} else {
+				wanted = false;
+			}
+		}
+
+		if (wanted) {
+			hdr->obj_id = UAVObjGetID(obj);
+			hdr->inst_id = cur->inst_id++;
+
+			cur->length = sizeof(*hdr) + hdr->length;
+
+			return true;
+		}
+
+		cur->index++;
+		cur->inst_id = 0;
+	}
+
+	/* The settings CRC file ends with the CRC over all of them */
+	if ((cur->index == end) &&
+			(cur->file_id == UAVTALK_SETTINGS_CRC_FILE_ID)) {
+		uint32_t crc = UAVObjGetSettingsCRC();
+
+		memcpy(data, &crc, sizeof(crc));
+		hdr->obj_id = 0;
+		hdr->inst_id = 0;
+		hdr->length = sizeof(crc);
+
+		cur->index++;
+		cur->length = sizeof(*hdr) + hdr->length;
+
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Read a state file, each instance in it as a uavtalk_state_record followed
+ * by its data.  The whole state file holds every instance of every object,
+ * and every metaobject, so the GCS can fetch everything on connect in a
+ * stream of file packets instead of a request and reply per object.  The
+ * dynamic one leaves out settings objects, and the settings CRC file holds
+ * just their CRCs, so a GCS with them cached need only fetch what changed.
+ *
+ * Reads are expected to move forwards through the file; reading from 0, or
+ * from before the staged record, or another file, starts over.
+ */
+static int32_t readStateFile(telem_t telem, uint32_t file_id, uint8_t *buf,
+		uint32_t offset, uint32_t len)
+{
+	struct state_file_cursor *cur = &telem->state_file;
+
+	if (!cur->record) {
+		cur->record = PIOS_malloc_no_dma(
+				sizeof(struct uavtalk_state_record) +
+				UAVOBJECTS_LARGEST);
+
+		if (!cur->record) {
+			return -1;
+		}
+	}
+
+	if ((offset == 0) || (offset < cur->offset) ||
+			(file_id != cur->file_id)) {
+		cur->file_id = file_id;
+		cur->offset = 0;
+		cur->index = 0;
+		cur->inst_id = 0;
+		cur->length = 0;
+	}
+
+	while (offset >= cur->offset + cur->length) {
+		cur->offset += cur->length;
+		cur->length = 0;
+
+		if (!stageStateRecord(cur)) {
+			return 0;
+		}
+	}
+
+	uint32_t within = offset - cur->offset;
+
+	if (len > cur->length - within) {
+		len = cur->length - within;
+	}
+
+	memcpy(buf, cur->record + within, len);
+
+	return len;
+}
+
 /**
  * Callback for when we receive a request for data.  Converts a file
  * id to the actual unit of information, and returns/copies it.
- * Currently only operates on partitions.
+ * Operates on partitions, the execution trace, and the state files.
  *
  * \param[in] ctx Callback context (telemetry subsystem handle)
  * \param[in] file_id The requested file_id
@@ -439,6 +585,20 @@ static void addAckPending(telem_t telem, UAVObjHandle obj, uint16_t inst_id)
 static int32_t fileReqCallback(void *ctx, uint8_t *buf,
                 uint32_t file_id, uint32_t offset, uint32_t len)
 {
+#if defined(PIOS_INCLUDE_TRACE)
+	if (file_id == PIOS_TRACE_FILE_ID) {
+		/* Not seekable: each request continues where the last
+		 * one stopped, and reading from 0 starts over. */
+		return PIOS_Trace_Read(buf, len, offset == 0);
+	}
+#endif
+
+	if ((file_id == UAVTALK_STATE_FILE_ID) ||
+			(file_id == UAVTALK_DYNAMIC_STATE_FILE_ID) ||
+			(file_id == UAVTALK_SETTINGS_CRC_FILE_ID)) {
+		return readStateFile(ctx, file_id, buf, offset, len);
+	}
+
 	if (file_id < FLASH_PARTITION_NUM_LABELS) {
 		uintptr_t part_id;
 
@@ -709,17 +869,40 @@ static void telemetryRxTask(void *parameters)
 
 		if (inputPort && (!telem->request_inhibit)) {
 			// Block until data are available
-			uint8_t serial_data[16];
+			const uint8_t *serial_data;
 			uint16_t bytes_to_process;
 
 			telem->rx_inhibited = false;
 
-			bytes_to_process = PIOS_COM_ReceiveBuffer(inputPort,
-					serial_data, sizeof(serial_data), 100);
+			// Parse in place, whole packets aren't copied out
+			serial_data = PIOS_COM_ReceivePeek(inputPort,
+					&bytes_to_process, 100);
 
 			if (bytes_to_process > 0) {
-				UAVTalkProcessInputStream(telem->uavTalkCon,
-						serial_data, bytes_to_process);
+				/* Hand each packet's bytes back once it's been
+				 * handled, so replying to it doesn't leave the
+				 * port without room to receive */
+				while (bytes_to_process > 0) {
+					UAVTalkRxState state;
+
+					int32_t used = UAVTalkProcessInputBlock(
+							telem->uavTalkCon,
+							serial_data,
+							bytes_to_process,
+							&state);
+
+					if (used <= 0) {
+						used = bytes_to_process;
+					} else if (state == UAVTALK_STATE_COMPLETE) {
+						UAVTalkReceiveObject(
+							telem->uavTalkCon);
+					}
+
+					PIOS_COM_ReceiveRelease(inputPort, used);
+
+					serial_data += used;
+					bytes_to_process -= used;
+				}
 
 #if defined(PIOS_COM_TELEM_USB)
 				if (inputPort == PIOS_COM_TELEM_USB) {
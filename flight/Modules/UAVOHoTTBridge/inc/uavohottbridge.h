@@ -29,21 +29,12 @@
 #include "openpilot.h"
 #include "modulesettings.h"
 #include "hottsettings.h"
-#include "attitudeactual.h"
-#include "baroaltitude.h"
-#include "flightbatterystate.h"
-#include "flightstatus.h"
-#include "gyros.h"
-#include "gpsposition.h"
-#include "gpstime.h"
-#include "homelocation.h"
-#include "positionactual.h"
-#include "systemalarms.h"
-#include "velocityactual.h"
+#include "state_snapshot.h"
 
 // timing variables
 #define IDLE_TIME 10	// idle line delay to prevent data crashes on telemetry line.
 #define DATA_TIME 3		// time between 2 transmitted bytes
+#define SNAPSHOT_PERIOD_MS 100	// telemetry is requested every 200ms
 
 // sizes and lengths
 #define climbratesize 50			// defines size of ring buffer for climbrate calculation
@@ -183,17 +174,7 @@ typedef struct {
 // Private structures
 struct telemetrydata{
 	HoTTSettingsData Settings;
-	AttitudeActualData Attitude;
-	BaroAltitudeData Baro;
-	FlightBatteryStateData Battery;
-	FlightStatusData FlightStatus;
-	GPSPositionData GPS;
-	GPSTimeData GPStime;
-	GyrosData Gyro;
-	HomeLocationData Home;
-	PositionActualData Position;
-	SystemAlarmsData SysAlarms;
-	VelocityActualData Velocity;
+	struct state_snapshot snap;
 	int16_t climbratebuffer[climbratesize];
 	uint8_t climbrate_pointer;
 	float altitude;
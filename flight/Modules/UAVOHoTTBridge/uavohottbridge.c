@@ -74,6 +74,10 @@ static uword_t scale_float2uword(float value, float scale, float offset);
 static int32_t uavoHoTTBridgeStart(void)
 {
 	if (module_enabled) {
+		if (state_snapshot_initialize(SNAPSHOT_PERIOD_MS) == -1) {
+			return -1;
+		}
+
 		// Start task
 		uavoHoTTBridgeTaskHandle = PIOS_Thread_Create(
 				uavoHoTTBridgeTask, "uavoHoTTBridge",
@@ -257,7 +261,7 @@ uint16_t build_VARIO_message(struct hott_vario_message *msg) {
 	msg->climbrate10s = scale_float2uword(telestate->climbrate10s, M_TO_CM, OFFSET_CLIMBRATE);
 
 	// compass
-	msg->compass = scale_float2int8(telestate->Attitude.Yaw, DEG_TO_UINT, 0);
+	msg->compass = scale_float2int8(telestate->snap.attitude.Yaw, DEG_TO_UINT, 0);
 
 	// statusline
 	memcpy(msg->ascii, telestate->statusline, sizeof(msg->ascii));
@@ -289,26 +293,26 @@ uint16_t build_GPS_message(struct hott_gps_message *msg) {
 
 	// alarm inverse bits. invert display areas on limits
 	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXDISTANCE] < telestate->homedistance) ? GPS_INVERT_HDIST : 0;
-	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MINSPEED] > telestate->GPS.Groundspeed) ? GPS_INVERT_SPEED : 0;
-	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXSPEED] < telestate->GPS.Groundspeed) ? GPS_INVERT_SPEED : 0;
+	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MINSPEED] > telestate->snap.gps_position.Groundspeed) ? GPS_INVERT_SPEED : 0;
+	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXSPEED] < telestate->snap.gps_position.Groundspeed) ? GPS_INVERT_SPEED : 0;
 	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MINHEIGHT] > telestate->altitude) ? GPS_INVERT_ALT : 0;
 	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXHEIGHT] < telestate->altitude) ? GPS_INVERT_ALT : 0;
 	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_NEGDIFFERENCE1] > telestate->climbrate1s) ? GPS_INVERT_CR1S : 0;
 	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_POSDIFFERENCE1] < telestate->climbrate1s) ? GPS_INVERT_CR1S : 0;
 	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_NEGDIFFERENCE2] > telestate->climbrate3s) ? GPS_INVERT_CR3S : 0;
 	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_POSDIFFERENCE2] < telestate->climbrate3s) ? GPS_INVERT_CR3S : 0;
-	msg->alarm_inverse2 |= (telestate->SysAlarms.Alarm[SYSTEMALARMS_ALARM_GPS] != SYSTEMALARMS_ALARM_OK) ? GPS_INVERT2_POS : 0;
+	msg->alarm_inverse2 |= (telestate->snap.alarms.Alarm[SYSTEMALARMS_ALARM_GPS] != SYSTEMALARMS_ALARM_OK) ? GPS_INVERT2_POS : 0;
 
 	// gps direction, groundspeed and postition
-	msg->flight_direction = scale_float2uint8(telestate->GPS.Heading, DEG_TO_UINT, 0);
-	msg->gps_speed = scale_float2uword(telestate->GPS.Groundspeed, MS_TO_KMH, 0);
-	convert_long2gps(telestate->GPS.Latitude, &msg->latitude_ns, &msg->latitude_min, &msg->latitude_sec);
-	convert_long2gps(telestate->GPS.Longitude, &msg->longitude_ew, &msg->longitude_min, &msg->longitude_sec);
+	msg->flight_direction = scale_float2uint8(telestate->snap.gps_position.Heading, DEG_TO_UINT, 0);
+	msg->gps_speed = scale_float2uword(telestate->snap.gps_position.Groundspeed, MS_TO_KMH, 0);
+	convert_long2gps(telestate->snap.gps_position.Latitude, &msg->latitude_ns, &msg->latitude_min, &msg->latitude_sec);
+	convert_long2gps(telestate->snap.gps_position.Longitude, &msg->longitude_ew, &msg->longitude_min, &msg->longitude_sec);
 
 	// homelocation distance, course and state
 	msg->distance = scale_float2uword(telestate->homedistance, 1, 0);
 	msg->home_direction = scale_float2uint8(telestate->homecourse, DEG_TO_UINT, 0);
-	msg->ascii5 = (telestate->Home.Set ? 'H' : '-');
+	msg->ascii5 = (telestate->snap.home.Set ? 'H' : '-');
 
 	// altitude relative to ground and climb rate
 	msg->altitude = scale_float2uword(telestate->altitude, 1, OFFSET_ALTITUDE);
@@ -316,8 +320,8 @@ uint16_t build_GPS_message(struct hott_gps_message *msg) {
 	msg->climbrate3s = scale_float2uint8(telestate->climbrate3s, 1, OFFSET_CLIMBRATE3S);
 
 	// number of satellites,gps fix and state
-	msg->gps_num_sat = telestate->GPS.Satellites;
-	switch (telestate->GPS.Status) {
+	msg->gps_num_sat = telestate->snap.gps_position.Satellites;
+	switch (telestate->snap.gps_position.Status) {
 		case GPSPOSITION_STATUS_FIX2D:
 			msg->gps_fix_char = '2';
 			break;
@@ -328,11 +332,11 @@ uint16_t build_GPS_message(struct hott_gps_message *msg) {
 		default:
 			msg->gps_fix_char = 0;
 	}
-	switch (telestate->SysAlarms.Alarm[SYSTEMALARMS_ALARM_GPS]) {
+	switch (telestate->snap.alarms.Alarm[SYSTEMALARMS_ALARM_GPS]) {
 		case SYSTEMALARMS_ALARM_UNINITIALISED:
 			msg->ascii6 = 0;
 			// if there is no gps, show compass flight direction
-			msg->flight_direction = scale_float2int8((telestate->Attitude.Yaw > 0) ? telestate->Attitude.Yaw : 360 + telestate->Attitude.Yaw , DEG_TO_UINT, 0);
+			msg->flight_direction = scale_float2int8((telestate->snap.attitude.Yaw > 0) ? telestate->snap.attitude.Yaw : 360 + telestate->snap.attitude.Yaw , DEG_TO_UINT, 0);
 			break;
 		case SYSTEMALARMS_ALARM_OK:
 			msg->ascii6 = '.';
@@ -349,18 +353,18 @@ uint16_t build_GPS_message(struct hott_gps_message *msg) {
 	}
 
 	// model angles
-	msg->angle_roll = scale_float2int8(telestate->Attitude.Roll, DEG_TO_UINT, 0);
-	msg->angle_nick = scale_float2int8(telestate->Attitude.Pitch, DEG_TO_UINT, 0);
-	msg->angle_compass = scale_float2int8(telestate->Attitude.Yaw, DEG_TO_UINT, 0);
+	msg->angle_roll = scale_float2int8(telestate->snap.attitude.Roll, DEG_TO_UINT, 0);
+	msg->angle_nick = scale_float2int8(telestate->snap.attitude.Pitch, DEG_TO_UINT, 0);
+	msg->angle_compass = scale_float2int8(telestate->snap.attitude.Yaw, DEG_TO_UINT, 0);
 
 	// gps time
-	msg->gps_hour = telestate->GPStime.Hour;
-	msg->gps_min = telestate->GPStime.Minute;
-	msg->gps_sec = telestate->GPStime.Second;
+	msg->gps_hour = telestate->snap.gps_time.Hour;
+	msg->gps_min = telestate->snap.gps_time.Minute;
+	msg->gps_sec = telestate->snap.gps_time.Second;
 	msg->gps_msec = 0;
 
 	// gps MSL (NN) altitude MSL
-	msg->msl = scale_float2uword(telestate->GPS.Altitude, 1, 0);
+	msg->msl = scale_float2uword(telestate->snap.gps_position.Altitude, 1, 0);
 
 	// free display chararacter
 	msg->ascii4 = 0;
@@ -386,9 +390,9 @@ uint16_t build_GAM_message(struct hott_gam_message *msg) {
 	msg->sensor_text_id = HOTT_GAM_TEXT_ID;
 
 	// alarm inverse bits. invert display areas on limits
-	msg->alarm_inverse2 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXCURRENT] < telestate->Battery.Current) ? GAM_INVERT2_CURRENT : 0;
-	msg->alarm_inverse2 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MINPOWERVOLTAGE] > telestate->Battery.Voltage) ? GAM_INVERT2_VOLTAGE : 0;
-	msg->alarm_inverse2 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXPOWERVOLTAGE] < telestate->Battery.Voltage) ? GAM_INVERT2_VOLTAGE : 0;
+	msg->alarm_inverse2 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXCURRENT] < telestate->snap.battery.Current) ? GAM_INVERT2_CURRENT : 0;
+	msg->alarm_inverse2 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MINPOWERVOLTAGE] > telestate->snap.battery.Voltage) ? GAM_INVERT2_VOLTAGE : 0;
+	msg->alarm_inverse2 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXPOWERVOLTAGE] < telestate->snap.battery.Voltage) ? GAM_INVERT2_VOLTAGE : 0;
 	msg->alarm_inverse2 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MINHEIGHT] > telestate->altitude) ? GAM_INVERT2_ALT : 0;
 	msg->alarm_inverse2 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXHEIGHT] < telestate->altitude) ? GAM_INVERT2_ALT : 0;
 	msg->alarm_inverse2 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_NEGDIFFERENCE1] > telestate->climbrate1s) ? GAM_INVERT2_CR1S : 0;
@@ -397,8 +401,8 @@ uint16_t build_GAM_message(struct hott_gam_message *msg) {
 	msg->alarm_inverse2 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_POSDIFFERENCE2] < telestate->climbrate3s) ? GAM_INVERT2_CR3S : 0;
 
 	// temperatures
-	msg->temperature1 = scale_float2uint8(telestate->Gyro.temperature, 1, OFFSET_TEMPERATURE);
-	msg->temperature2 = scale_float2uint8(telestate->Baro.Temperature, 1, OFFSET_TEMPERATURE);
+	msg->temperature1 = scale_float2uint8(telestate->snap.gyros.temperature, 1, OFFSET_TEMPERATURE);
+	msg->temperature2 = scale_float2uint8(telestate->snap.baro.Temperature, 1, OFFSET_TEMPERATURE);
 
 	// altitude
 	msg->altitude = scale_float2uword(telestate->altitude, 1, OFFSET_ALTITUDE);
@@ -408,15 +412,15 @@ uint16_t build_GAM_message(struct hott_gam_message *msg) {
 	msg->climbrate3s = scale_float2uint8(telestate->climbrate3s, 1, OFFSET_CLIMBRATE3S);
 
 	// main battery
-	float voltage = (telestate->Battery.Voltage > 0) ? telestate->Battery.Voltage : 0;
-	float current = (telestate->Battery.Current > 0) ? telestate->Battery.Current : 0;
-	float energy = (telestate->Battery.ConsumedEnergy > 0) ? telestate->Battery.ConsumedEnergy : 0;
+	float voltage = (telestate->snap.battery.Voltage > 0) ? telestate->snap.battery.Voltage : 0;
+	float current = (telestate->snap.battery.Current > 0) ? telestate->snap.battery.Current : 0;
+	float energy = (telestate->snap.battery.ConsumedEnergy > 0) ? telestate->snap.battery.ConsumedEnergy : 0;
 	msg->voltage = scale_float2uword(voltage, 10, 0);
 	msg->current = scale_float2uword(current, 10, 0);
 	msg->capacity = scale_float2uword(energy, 0.1, 0);
 
 	// pressure kPa to 0.1Bar
-	msg->pressure = scale_float2uint8(telestate->Baro.Pressure, 0.1, 0);
+	msg->pressure = scale_float2uint8(telestate->snap.baro.Pressure, 0.1, 0);
 
 	msg->checksum = calc_checksum((uint8_t *)msg, sizeof(*msg));
 	return sizeof(*msg);
@@ -439,10 +443,10 @@ uint16_t build_EAM_message(struct hott_eam_message *msg) {
 	msg->sensor_text_id = HOTT_EAM_TEXT_ID;
 
 	// alarm inverse bits. invert display areas on limits
-	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXUSEDCAPACITY] < telestate->Battery.ConsumedEnergy) ? EAM_INVERT_CAPACITY : 0;
-	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXCURRENT] < telestate->Battery.Current) ? EAM_INVERT_CURRENT : 0;
-	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MINPOWERVOLTAGE] > telestate->Battery.Voltage) ? EAM_INVERT_VOLTAGE : 0;
-	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXPOWERVOLTAGE] < telestate->Battery.Voltage) ? EAM_INVERT_VOLTAGE : 0;
+	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXUSEDCAPACITY] < telestate->snap.battery.ConsumedEnergy) ? EAM_INVERT_CAPACITY : 0;
+	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXCURRENT] < telestate->snap.battery.Current) ? EAM_INVERT_CURRENT : 0;
+	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MINPOWERVOLTAGE] > telestate->snap.battery.Voltage) ? EAM_INVERT_VOLTAGE : 0;
+	msg->alarm_inverse1 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXPOWERVOLTAGE] < telestate->snap.battery.Voltage) ? EAM_INVERT_VOLTAGE : 0;
 	msg->alarm_inverse2 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MINHEIGHT] > telestate->altitude) ? EAM_INVERT2_ALT : 0;
 	msg->alarm_inverse2 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXHEIGHT] < telestate->altitude) ? EAM_INVERT2_ALT : 0;
 	msg->alarm_inverse2 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_NEGDIFFERENCE1] > telestate->climbrate1s) ? EAM_INVERT2_CR1S : 0;
@@ -451,16 +455,16 @@ uint16_t build_EAM_message(struct hott_eam_message *msg) {
 	msg->alarm_inverse2 |= (telestate->Settings.Limit[HOTTSETTINGS_LIMIT_POSDIFFERENCE2] < telestate->climbrate3s) ? EAM_INVERT2_CR3S : 0;
 
 	// main battery
-	float voltage = (telestate->Battery.Voltage > 0) ? telestate->Battery.Voltage : 0;
-	float current = (telestate->Battery.Current > 0) ? telestate->Battery.Current : 0;
-	float energy = (telestate->Battery.ConsumedEnergy > 0) ? telestate->Battery.ConsumedEnergy : 0;
+	float voltage = (telestate->snap.battery.Voltage > 0) ? telestate->snap.battery.Voltage : 0;
+	float current = (telestate->snap.battery.Current > 0) ? telestate->snap.battery.Current : 0;
+	float energy = (telestate->snap.battery.ConsumedEnergy > 0) ? telestate->snap.battery.ConsumedEnergy : 0;
 	msg->voltage = scale_float2uword(voltage, 10, 0);
 	msg->current = scale_float2uword(current, 10, 0);
 	msg->capacity = scale_float2uword(energy, 0.1, 0);
 
 	// temperatures
-	msg->temperature1 = scale_float2uint8(telestate->Gyro.temperature, 1, OFFSET_TEMPERATURE);
-	msg->temperature2 = scale_float2uint8(telestate->Baro.Temperature, 1, OFFSET_TEMPERATURE);
+	msg->temperature1 = scale_float2uint8(telestate->snap.gyros.temperature, 1, OFFSET_TEMPERATURE);
+	msg->temperature2 = scale_float2uint8(telestate->snap.baro.Temperature, 1, OFFSET_TEMPERATURE);
 
 	// altitude
 	msg->altitude = scale_float2uword(telestate->altitude, 1, OFFSET_ALTITUDE);
@@ -470,7 +474,7 @@ uint16_t build_EAM_message(struct hott_eam_message *msg) {
 	msg->climbrate3s = scale_float2uint8(telestate->climbrate3s, 1, OFFSET_CLIMBRATE3S);
 
 	// flight time
-	float flighttime = (telestate->Battery.EstimatedFlightTime <= 5999) ? telestate->Battery.EstimatedFlightTime : 5999;
+	float flighttime = (telestate->snap.battery.EstimatedFlightTime <= 5999) ? telestate->snap.battery.EstimatedFlightTime : 5999;
 	msg->electric_min = flighttime / 60;
 	msg->electric_sec = flighttime - 60 * msg->electric_min;
 
@@ -495,19 +499,19 @@ uint16_t build_ESC_message(struct hott_esc_message *msg) {
 	msg->sensor_text_id = HOTT_ESC_TEXT_ID;
 
 	// main batterie
-	float voltage = (telestate->Battery.Voltage > 0) ? telestate->Battery.Voltage : 0;
-	float current = (telestate->Battery.Current > 0) ? telestate->Battery.Current : 0;
-	float max_current = (telestate->Battery.PeakCurrent > 0) ? telestate->Battery.PeakCurrent : 0;
-	float energy = (telestate->Battery.ConsumedEnergy > 0) ? telestate->Battery.ConsumedEnergy : 0;
+	float voltage = (telestate->snap.battery.Voltage > 0) ? telestate->snap.battery.Voltage : 0;
+	float current = (telestate->snap.battery.Current > 0) ? telestate->snap.battery.Current : 0;
+	float max_current = (telestate->snap.battery.PeakCurrent > 0) ? telestate->snap.battery.PeakCurrent : 0;
+	float energy = (telestate->snap.battery.ConsumedEnergy > 0) ? telestate->snap.battery.ConsumedEnergy : 0;
 	msg->batt_voltage = scale_float2uword(voltage, 10, 0);
 	msg->current = scale_float2uword(current, 10, 0);
 	msg->max_current = scale_float2uword(max_current, 10, 0);
 	msg->batt_capacity = scale_float2uword(energy, 0.1, 0);
 
 	// temperatures
-	msg->temperatureESC = scale_float2uint8(telestate->Gyro.temperature, 1, OFFSET_TEMPERATURE);
+	msg->temperatureESC = scale_float2uint8(telestate->snap.gyros.temperature, 1, OFFSET_TEMPERATURE);
 	msg->max_temperatureESC = scale_float2uint8(0, 1, OFFSET_TEMPERATURE);
-	msg->temperatureMOT = scale_float2uint8(telestate->Baro.Temperature, 1, OFFSET_TEMPERATURE);
+	msg->temperatureMOT = scale_float2uint8(telestate->snap.baro.Temperature, 1, OFFSET_TEMPERATURE);
 	msg->max_temperatureMOT = scale_float2uint8(0, 1, OFFSET_TEMPERATURE);
 
 	msg->checksum = calc_checksum((uint8_t *)msg, sizeof(*msg));
@@ -539,32 +543,11 @@ void update_telemetrydata () {
 	// update all available data
 	if (HoTTSettingsHandle() != NULL)
 		HoTTSettingsGet(&telestate->Settings);
-	if (AttitudeActualHandle() != NULL)
-		AttitudeActualGet(&telestate->Attitude);
-	if (BaroAltitudeHandle() != NULL)
-		BaroAltitudeGet(&telestate->Baro);
-	if (FlightBatteryStateHandle() != NULL)
-		FlightBatteryStateGet(&telestate->Battery);
-	if (FlightStatusHandle() != NULL)
-		FlightStatusGet(&telestate->FlightStatus);
-	if (GPSPositionHandle() != NULL)
-		GPSPositionGet(&telestate->GPS);
-	if (GPSTimeHandle() != NULL)
-		GPSTimeGet(&telestate->GPStime);
-	if (GyrosHandle() != NULL)
-		GyrosGet(&telestate->Gyro);
-	if (HomeLocationHandle() != NULL)
-		HomeLocationGet(&telestate->Home);
-	if (PositionActualHandle() != NULL)
-		PositionActualGet(&telestate->Position);
-	if (SystemAlarmsHandle() != NULL)
-		SystemAlarmsGet(&telestate->SysAlarms);
-	if (VelocityActualHandle() != NULL)
-		VelocityActualGet(&telestate->Velocity);
+	state_snapshot_get(&telestate->snap);
 
 	// send actual climbrate value to ring buffer as mm per 0.2s values
 	uint8_t n = telestate->climbrate_pointer;
-	telestate->climbratebuffer[telestate->climbrate_pointer++] = -telestate->Velocity.Down * 200;
+	telestate->climbratebuffer[telestate->climbrate_pointer++] = -telestate->snap.velocity.Down * 200;
 	telestate->climbrate_pointer %= climbratesize;
 
 	// calculate avarage climbrates in meters per 1, 3 and 10 second(s) based on 200ms interval
@@ -583,17 +566,17 @@ void update_telemetrydata () {
 	telestate->climbrate10s = telestate->climbrate10s / 1000;
 
 	// set altitude offset and clear min/max values when arming
-	if ((telestate->FlightStatus.Armed == FLIGHTSTATUS_ARMED_ARMING) || ((telestate->last_armed != FLIGHTSTATUS_ARMED_ARMED) && (telestate->FlightStatus.Armed == FLIGHTSTATUS_ARMED_ARMED))) {
+	if ((telestate->snap.flight_status.Armed == FLIGHTSTATUS_ARMED_ARMING) || ((telestate->last_armed != FLIGHTSTATUS_ARMED_ARMED) && (telestate->snap.flight_status.Armed == FLIGHTSTATUS_ARMED_ARMED))) {
 		telestate->min_altitude = 0;
 		telestate->max_altitude = 0;
 	}
-	telestate->last_armed = telestate->FlightStatus.Armed;
+	telestate->last_armed = telestate->snap.flight_status.Armed;
 
 	// calculate altitude relative to start position
-	telestate->altitude = -telestate->Position.Down;
+	telestate->altitude = -telestate->snap.position.Down;
 
 	// check and set min/max values when armed.
-	if (telestate->FlightStatus.Armed == FLIGHTSTATUS_ARMED_ARMED) {
+	if (telestate->snap.flight_status.Armed == FLIGHTSTATUS_ARMED_ARMED) {
 		if (telestate->min_altitude > telestate->altitude)
 			telestate->min_altitude = telestate->altitude;
 		if (telestate->max_altitude < telestate->altitude)
@@ -601,9 +584,9 @@ void update_telemetrydata () {
 	}
 
 	// gps home position and course
-	telestate->homedistance = sqrtf(telestate->Position.North * telestate->Position.North + telestate->Position.East * telestate->Position.East);
-	telestate->homecourse = acosf(- telestate->Position.North / telestate->homedistance) / 3.14159265f * 180;
-	if (telestate->Position.East > 0)
+	telestate->homedistance = sqrtf(telestate->snap.position.North * telestate->snap.position.North + telestate->snap.position.East * telestate->snap.position.East);
+	telestate->homecourse = acosf(- telestate->snap.position.North / telestate->homedistance) / 3.14159265f * 180;
+	if (telestate->snap.position.East > 0)
 		telestate->homecourse = 360 - telestate->homecourse;
 
 	// statusline
@@ -627,7 +610,7 @@ void update_telemetrydata () {
 	const char *txt_armed = "Armed";
 
 	const char *txt_flightmode;
-	switch (telestate->FlightStatus.FlightMode) {
+	switch (telestate->snap.flight_status.FlightMode) {
 		case FLIGHTSTATUS_FLIGHTMODE_MANUAL:
 			txt_flightmode = txt_manual;
 			break;
@@ -675,7 +658,7 @@ void update_telemetrydata () {
 	}
 
 	const char *txt_armstate;
-	switch (telestate->FlightStatus.Armed) {
+	switch (telestate->snap.flight_status.Armed) {
 		case FLIGHTSTATUS_ARMED_DISARMED:
 			txt_armstate = txt_disarmed;
 			break;
@@ -698,7 +681,7 @@ void update_telemetrydata () {
 uint8_t generate_warning() {
 	// set warning tone with hardcoded priority
 	if ((telestate->Settings.Warning[HOTTSETTINGS_WARNING_MINSPEED] == HOTTSETTINGS_WARNING_ENABLED) &&
-		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MINSPEED] > telestate->GPS.Groundspeed * MS_TO_KMH))
+		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MINSPEED] > telestate->snap.gps_position.Groundspeed * MS_TO_KMH))
 		return HOTT_TONE_A; // maximum speed
 
 	if ((telestate->Settings.Warning[HOTTSETTINGS_WARNING_NEGDIFFERENCE2] == HOTTSETTINGS_WARNING_ENABLED) &&
@@ -714,23 +697,23 @@ uint8_t generate_warning() {
 		return HOTT_TONE_D; // maximum distance
 
 	if ((telestate->Settings.Warning[HOTTSETTINGS_WARNING_MINSENSOR1TEMP] == HOTTSETTINGS_WARNING_ENABLED) &&
-		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MINSENSOR1TEMP] > telestate->Gyro.temperature))
+		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MINSENSOR1TEMP] > telestate->snap.gyros.temperature))
 		return HOTT_TONE_F; // minimum temperature sensor 1
 
 	if ((telestate->Settings.Warning[HOTTSETTINGS_WARNING_MINSENSOR2TEMP] == HOTTSETTINGS_WARNING_ENABLED) &&
-		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MINSENSOR2TEMP] > telestate->Baro.Temperature))
+		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MINSENSOR2TEMP] > telestate->snap.baro.Temperature))
 		return HOTT_TONE_G; // minimum temperature sensor 2
 
 	if ((telestate->Settings.Warning[HOTTSETTINGS_WARNING_MAXSENSOR1TEMP] == HOTTSETTINGS_WARNING_ENABLED) &&
-		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXSENSOR1TEMP] < telestate->Gyro.temperature))
+		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXSENSOR1TEMP] < telestate->snap.gyros.temperature))
 		return HOTT_TONE_H; // maximum temperature sensor 1
 
 	if ((telestate->Settings.Warning[HOTTSETTINGS_WARNING_MAXSENSOR2TEMP] == HOTTSETTINGS_WARNING_ENABLED) &&
-		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXSENSOR2TEMP] < telestate->Baro.Temperature))
+		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXSENSOR2TEMP] < telestate->snap.baro.Temperature))
 		return HOTT_TONE_I; // maximum temperature sensor 2
 
 	if ((telestate->Settings.Warning[HOTTSETTINGS_WARNING_MAXSPEED] == HOTTSETTINGS_WARNING_ENABLED) &&
-		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXSPEED] < telestate->GPS.Groundspeed * MS_TO_KMH))
+		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXSPEED] < telestate->snap.gps_position.Groundspeed * MS_TO_KMH))
 		return HOTT_TONE_L; // maximum speed
 
 	if ((telestate->Settings.Warning[HOTTSETTINGS_WARNING_POSDIFFERENCE2] == HOTTSETTINGS_WARNING_ENABLED) &&
@@ -746,19 +729,19 @@ uint8_t generate_warning() {
 		return HOTT_TONE_O; // minimum height
 
 	if ((telestate->Settings.Warning[HOTTSETTINGS_WARNING_MINPOWERVOLTAGE] == HOTTSETTINGS_WARNING_ENABLED) &&
-		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MINPOWERVOLTAGE] > telestate->Battery.Voltage))
+		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MINPOWERVOLTAGE] > telestate->snap.battery.Voltage))
 		return HOTT_TONE_P; // minimum input voltage
 
 	if ((telestate->Settings.Warning[HOTTSETTINGS_WARNING_MAXUSEDCAPACITY] == HOTTSETTINGS_WARNING_ENABLED) &&
-		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXUSEDCAPACITY] < telestate->Battery.ConsumedEnergy))
+		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXUSEDCAPACITY] < telestate->snap.battery.ConsumedEnergy))
 		return HOTT_TONE_V; // capacity
 
 	if ((telestate->Settings.Warning[HOTTSETTINGS_WARNING_MAXCURRENT] == HOTTSETTINGS_WARNING_ENABLED) &&
-		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXCURRENT] < telestate->Battery.Current))
+		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXCURRENT] < telestate->snap.battery.Current))
 		return HOTT_TONE_W; // maximum current
 
 	if ((telestate->Settings.Warning[HOTTSETTINGS_WARNING_MAXPOWERVOLTAGE] == HOTTSETTINGS_WARNING_ENABLED) &&
-		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXPOWERVOLTAGE] < telestate->Battery.Voltage))
+		(telestate->Settings.Limit[HOTTSETTINGS_LIMIT_MAXPOWERVOLTAGE] < telestate->snap.battery.Voltage))
 		return HOTT_TONE_X; // maximum input voltage
 
 	if ((telestate->Settings.Warning[HOTTSETTINGS_WARNING_MAXHEIGHT] == HOTTSETTINGS_WARNING_ENABLED) &&
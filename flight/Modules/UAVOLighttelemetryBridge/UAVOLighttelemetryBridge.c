@@ -54,16 +54,8 @@
 #include "openpilot.h"
 #include "modulesettings.h"
 
-#include "accels.h"
-#include "airspeedactual.h"
-#include "attitudeactual.h"
-#include "baroaltitude.h"
-#include "flightstatus.h"
-#include "gpsposition.h"
 #include "flightbatterysettings.h"
-#include "flightbatterystate.h"
-#include "manualcontrolcommand.h"
-#include "positionactual.h"
+#include "state_snapshot.h"
 
 #include "pios_thread.h"
 #include "pios_modules.h"
@@ -81,6 +73,9 @@
  * Then the next one goes.
  */
 
+/* Attitude frames go out at most every other chunk */
+#define SNAPSHOT_PERIOD_MS (2 * CHUNK_TIME)
+
 #define LTM_GFRAME_SIZE 18
 #define LTM_AFRAME_SIZE 10
 #define LTM_SFRAME_SIZE 11
@@ -93,6 +88,7 @@ static struct pios_thread *taskHandle;
 static uint32_t lighttelemetryPort;
 static uint8_t ltm_scheduler;
 static uint8_t ltm_slowrate;
+static struct state_snapshot *snap;
 
 // Private functions
 static void uavoLighttelemetryBridgeTask(void *parameters);
@@ -113,9 +109,12 @@ int32_t uavoLighttelemetryBridgeInitialize()
 	lighttelemetryPort = PIOS_COM_LIGHTTELEMETRY;
 
 	if (lighttelemetryPort && PIOS_Modules_IsEnabled(PIOS_MODULE_UAVOLIGHTTELEMETRYBRIDGE)) {
-		// Update telemetry settings
-		module_enabled = true;
-		return 0;
+		snap = PIOS_malloc_no_dma(sizeof(*snap));
+
+		if (snap) {
+			module_enabled = true;
+			return 0;
+		}
 	}
 
 	return -1;
@@ -129,6 +128,10 @@ int32_t uavoLighttelemetryBridgeStart()
 {
 	if ( module_enabled )
 	{
+		if (state_snapshot_initialize(SNAPSHOT_PERIOD_MS) == -1) {
+			return -1;
+		}
+
 		taskHandle = PIOS_Thread_Create(uavoLighttelemetryBridgeTask, "uavoLighttelemetryBridge", STACK_SIZE_BYTES, NULL, TASK_PRIORITY);
 		TaskMonitorAdd(TASKINFO_RUNNING_UAVOLIGHTTELEMETRYBRIDGE, taskHandle);
 		return 0;
@@ -154,6 +157,8 @@ static void uavoLighttelemetryBridgeTask(void *parameters)
 	{
 		int ret = 0;
 
+		state_snapshot_get(snap);
+
 		if (!ret) {
 			switch (ltm_scheduler) {
 				case 0:
@@ -210,35 +215,27 @@ static void uavoLighttelemetryBridgeTask(void *parameters)
 //GPS packet
 static int send_LTM_Gframe()
 {
-	GPSPositionData pdata = { };	/* Set to all 0's */
+	/* All 0's when there's no GPS */
+	const GPSPositionData *pdata = &snap->gps_position;
 
-	bool have_gps = false;
-
-	if (GPSPositionHandle() != NULL) {
-		have_gps = true;
-		GPSPositionGet(&pdata);
-	}
+	bool have_gps = state_snapshot_has(snap, STATE_SNAPSHOT_GPSPOSITION);
 
-	int32_t lt_latitude = pdata.Latitude;
-	int32_t lt_longitude = pdata.Longitude;
-	uint8_t lt_groundspeed = (uint8_t)roundf(pdata.Groundspeed); //rounded m/s .
+	int32_t lt_latitude = pdata->Latitude;
+	int32_t lt_longitude = pdata->Longitude;
+	uint8_t lt_groundspeed = (uint8_t)roundf(pdata->Groundspeed); //rounded m/s .
 	int32_t lt_altitude = 0;
-	if (PositionActualHandle() != NULL) {
-		float altitude;
-		PositionActualDownGet(&altitude);
-		lt_altitude = (int32_t)roundf(altitude * -100.0f);
-	} else if (BaroAltitudeHandle() != NULL) {
-		float altitude;
-		BaroAltitudeAltitudeGet(&altitude);
-		lt_altitude = (int32_t)roundf(altitude * 100.0f); //Baro alt in cm.
+	if (state_snapshot_has(snap, STATE_SNAPSHOT_POSITIONACTUAL)) {
+		lt_altitude = (int32_t)roundf(snap->position.Down * -100.0f);
+	} else if (state_snapshot_has(snap, STATE_SNAPSHOT_BAROALTITUDE)) {
+		lt_altitude = (int32_t)roundf(snap->baro.Altitude * 100.0f); //Baro alt in cm.
 	} else if (have_gps) {
-		lt_altitude = (int32_t)roundf(pdata.Altitude * 100.0f); //GPS alt in cm.
+		lt_altitude = (int32_t)roundf(pdata->Altitude * 100.0f); //GPS alt in cm.
 	} else {
 		return 0;	/* Don't even bother, no data for this frame! */
 	}
 	
 	uint8_t lt_gpsfix;
-	switch (pdata.Status) {
+	switch (pdata->Status) {
 	case GPSPOSITION_STATUS_NOGPS:
 		lt_gpsfix = 0;
 		break;
@@ -256,7 +253,7 @@ static int send_LTM_Gframe()
 		break;
 	}
 	
-	uint8_t lt_gpssats = (int8_t)pdata.Satellites;
+	uint8_t lt_gpssats = (int8_t)pdata->Satellites;
 	//pack G frame	
 	uint8_t LTBuff[LTM_GFRAME_SIZE];
 	//G Frame: $T(2 bytes)G(1byte)LAT(cm,4 bytes)LON(cm,4bytes)SPEED(m/s,1bytes)ALT(cm,4bytes)SATS(6bits)FIX(2bits)CRC(xor,1byte)
@@ -288,11 +285,10 @@ static int send_LTM_Gframe()
 static int send_LTM_Aframe()
 {
 	//prepare data
-	AttitudeActualData adata;
-	AttitudeActualGet(&adata);
-	int16_t lt_pitch   = (int16_t)(roundf(adata.Pitch));	//-180/180°
-	int16_t lt_roll	   = (int16_t)(roundf(adata.Roll));		//-180/180°
-	int16_t lt_heading = (int16_t)(roundf(adata.Yaw));		//-180/180°
+	const AttitudeActualData *adata = &snap->attitude;
+	int16_t lt_pitch   = (int16_t)(roundf(adata->Pitch));	//-180/180°
+	int16_t lt_roll	   = (int16_t)(roundf(adata->Roll));		//-180/180°
+	int16_t lt_heading = (int16_t)(roundf(adata->Yaw));		//-180/180°
 	//pack A frame	
 	uint8_t LTBuff[LTM_AFRAME_SIZE];
 	
@@ -326,35 +322,26 @@ static int send_LTM_Sframe()
 	uint8_t	 lt_flightmode = 0;
 	
 	
-	if (FlightBatteryStateHandle() != NULL) {
-		FlightBatteryStateData sdata;
-		FlightBatteryStateGet(&sdata);
-		lt_vbat = (uint16_t)roundf(sdata.Voltage*1000);	  //Battery voltage in mv
-		lt_amp = (uint16_t)roundf(sdata.ConsumedEnergy);	  //mA consumed
+	if (state_snapshot_has(snap, STATE_SNAPSHOT_FLIGHTBATTERYSTATE)) {
+		lt_vbat = (uint16_t)roundf(snap->battery.Voltage*1000);	  //Battery voltage in mv
+		lt_amp = (uint16_t)roundf(snap->battery.ConsumedEnergy);	  //mA consumed
 	}
-	if (ManualControlCommandHandle() != NULL) {
-		ManualControlCommandData mdata;
-		ManualControlCommandGet(&mdata);
-		lt_rssi = (uint8_t)mdata.Rssi;					  //RSSI in %
+	if (state_snapshot_has(snap, STATE_SNAPSHOT_MANUALCONTROLCOMMAND)) {
+		lt_rssi = (uint8_t)snap->manual_control.Rssi;					  //RSSI in %
 	}
-	if (AirspeedActualHandle() != NULL) {
-		AirspeedActualData adata;
-		AirspeedActualGet (&adata);
-		lt_airspeed = (uint8_t)roundf(adata.TrueAirspeed);	  //Airspeed in m/s
-	} else if (GPSPositionHandle() != NULL) {
-		float groundspeed;
-		GPSPositionGroundspeedGet(&groundspeed);
-		lt_airspeed = (uint8_t)roundf(groundspeed);
+	if (state_snapshot_has(snap, STATE_SNAPSHOT_AIRSPEEDACTUAL)) {
+		lt_airspeed = (uint8_t)roundf(snap->airspeed.TrueAirspeed);	  //Airspeed in m/s
+	} else if (state_snapshot_has(snap, STATE_SNAPSHOT_GPSPOSITION)) {
+		lt_airspeed = (uint8_t)roundf(snap->gps_position.Groundspeed);
 	}
 
-	FlightStatusData fdata;
-	FlightStatusGet(&fdata);
-	lt_arm = fdata.Armed;									  //Armed status
+	const FlightStatusData *fdata = &snap->flight_status;
+	lt_arm = fdata->Armed;									  //Armed status
 	if (lt_arm == 1)		//arming , we don't use this one
 		lt_arm = 0;		
 	else if (lt_arm == 2)  // armed
 		lt_arm = 1;
-	if (fdata.ControlSource == FLIGHTSTATUS_CONTROLSOURCE_FAILSAFE)
+	if (fdata->ControlSource == FLIGHTSTATUS_CONTROLSOURCE_FAILSAFE)
 		lt_failsafe = 1;
 	else
 		lt_failsafe = 0;
@@ -363,7 +350,7 @@ static int send_LTM_Sframe()
 	// 8: Altitude Hold, 9: Loiter/GPS Hold, 10: Auto/Waypoints, 11: Heading Hold / headFree,
 	// 12: Circle, 13: RTH, 14: FollowMe, 15: LAND, 16:FlybyWireA, 17: FlybywireB, 18: Cruise, 19: Unknown
 
-	switch (fdata.FlightMode) {
+	switch (fdata->FlightMode) {
 	case FLIGHTSTATUS_FLIGHTMODE_MANUAL:
 		lt_flightmode = 0; break;
 	case FLIGHTSTATUS_FLIGHTMODE_STABILIZED1:
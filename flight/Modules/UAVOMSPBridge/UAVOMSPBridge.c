@@ -38,25 +38,14 @@
 #include "pios_thread.h"
 #include "pios_sensors.h"
 #include "pios_modules.h"
+#include "state_snapshot.h"
 #include <pios_hal.h>
 
 #include "actuatorsettings.h"
-#include "actuatordesired.h"
-#include "airspeedactual.h"
-#include "attitudeactual.h"
-#include "baroaltitude.h"
 #include "flightbatterysettings.h"
-#include "flightbatterystate.h"
-#include "flightstatus.h"
-#include "gpsposition.h"
-#include "homelocation.h"
-#include "manualcontrolcommand.h"
 #include "modulesettings.h"
-#include "positionactual.h"
 #include "stabilizationsettings.h"
-#include "systemalarms.h"
 #include "systemsettings.h"
-#include "systemstats.h"
 
 
 #if defined(PIOS_INCLUDE_MSP_BRIDGE)
@@ -208,6 +197,8 @@ struct msp_bridge {
 		// Specific packed data structures go here.
 		struct msp_cmddata_escserial escserial;
 	} cmd_data;
+
+	struct state_snapshot snap;
 };
 
 #if defined(PIOS_MSP_STACK_SIZE)
@@ -217,6 +208,9 @@ struct msp_bridge {
 #endif
 #define TASK_PRIORITY               PIOS_THREAD_PRIO_LOW
 
+// OSDs poll each message a few times a second
+#define SNAPSHOT_PERIOD_MS 50
+
 #define MAX_ALARM_LEN 30
 
 #define BOOT_DISPLAY_TIME_MS (10*1000)
@@ -515,15 +509,13 @@ static void msp_send_attitude(struct msp_bridge *m)
 			int16_t h;
 		} att;
 	} data;
-	AttitudeActualData attActual;
-
-	AttitudeActualGet(&attActual);
+	const AttitudeActualData *attActual = &m->snap.attitude;
 
 	// Roll and Pitch are in 10ths of a degree.
-	data.att.x = attActual.Roll * 10;
-	data.att.y = attActual.Pitch * -10;
+	data.att.x = attActual->Roll * 10;
+	data.att.y = attActual->Pitch * -10;
 	// Yaw is just -180 -> 180
-	data.att.h = attActual.Yaw;
+	data.att.h = attActual->Yaw;
 
 	msp_send(m, MSP_ATTITUDE, data.buf, sizeof(data));
 }
@@ -725,33 +717,28 @@ static void msp_send_status(struct msp_bridge *m)
 		} __attribute__((packed)) status;
 	} data;
 
-	float cycle_time;
-	ActuatorDesiredUpdateTimeGet(&cycle_time);
-	data.status.cycleTime = cycle_time * 1000;
+	data.status.cycleTime = m->snap.actuator_desired.UpdateTime * 1000;
 
 	data.status.i2cErrors = 0;
-	
-	GPSPositionData gpsData = {};
-	
-	if (GPSPositionHandle() != NULL)
-		GPSPositionGet(&gpsData);
+
+	const GPSPositionData *gpsData = &m->snap.gps_position;
 
 	data.status.sensors = (PIOS_SENSORS_IsRegistered(PIOS_SENSOR_ACCEL) ? MSP_SENSOR_ACC  : 0) |
 		(PIOS_SENSORS_IsRegistered(PIOS_SENSOR_BARO) ? MSP_SENSOR_BARO : 0) |
 		(PIOS_SENSORS_IsRegistered(PIOS_SENSOR_MAG) ? MSP_SENSOR_MAG : 0) |
-		(gpsData.Status != GPSPOSITION_STATUS_NOGPS ? MSP_SENSOR_GPS : 0);
+		(state_snapshot_has(&m->snap, STATE_SNAPSHOT_GPSPOSITION) &&
+			gpsData->Status != GPSPOSITION_STATUS_NOGPS ? MSP_SENSOR_GPS : 0);
 
 	data.status.flags = 0;
 	data.status.setting = 0;
 
-	if (FlightStatusHandle() != NULL) {
-		FlightStatusData flight_status;
-		FlightStatusGet(&flight_status);
+	if (state_snapshot_has(&m->snap, STATE_SNAPSHOT_FLIGHTSTATUS)) {
+		const FlightStatusData *flight_status = &m->snap.flight_status;
 
-		data.status.flags = flight_status.Armed == FLIGHTSTATUS_ARMED_ARMED;
+		data.status.flags = flight_status->Armed == FLIGHTSTATUS_ARMED_ARMED;
 
 		for (int i = 1; msp_boxes[i].mode != MSP_BOX_LAST; i++) {
-			if (flight_status.FlightMode == msp_boxes[i].tlmode) {
+			if (flight_status->FlightMode == msp_boxes[i].tlmode) {
 				data.status.flags |= (1 << i);
 			}
 		}
@@ -774,32 +761,29 @@ static void msp_send_analog(struct msp_bridge *m)
 	data.status.powerMeterSum = 0;
 
 	FlightBatterySettingsData batSettings = {};
-	FlightBatteryStateData batState = {};
+	const FlightBatteryStateData *batState = &m->snap.battery;
 
-	if (FlightBatteryStateHandle() != NULL)
-		FlightBatteryStateGet(&batState);
 	if (FlightBatterySettingsHandle() != NULL) {
 		FlightBatterySettingsGet(&batSettings);
 	}
 
 	if (batSettings.VoltagePin != FLIGHTBATTERYSETTINGS_VOLTAGEPIN_NONE)
-		data.status.vbat = (uint8_t)lroundf(batState.Voltage * 10);
+		data.status.vbat = (uint8_t)lroundf(batState->Voltage * 10);
 
 	if (batSettings.CurrentPin != FLIGHTBATTERYSETTINGS_CURRENTPIN_NONE) {
-		data.status.current = lroundf(batState.Current * 100);
-		data.status.powerMeterSum = lroundf(batState.ConsumedEnergy);
+		data.status.current = lroundf(batState->Current * 100);
+		data.status.powerMeterSum = lroundf(batState->ConsumedEnergy);
 	}
 
-	ManualControlCommandData manualState;
-	ManualControlCommandGet(&manualState);
+	int16_t rssi = m->snap.manual_control.Rssi;
 
 	// MSP RSSI's range is 0-1023
-	if (manualState.Rssi <= 0) {
+	if (rssi <= 0) {
 		data.status.rssi = 0;
-	} else if (manualState.Rssi >= 100) {
+	} else if (rssi >= 100) {
 		data.status.rssi = 1023;
 	} else {
-		data.status.rssi = manualState.Rssi * 10;
+		data.status.rssi = rssi * 10;
 	}
 
 	msp_send(m, MSP_ANALOG, data.buf, sizeof(data));
@@ -820,18 +804,17 @@ static void msp_send_raw_gps(struct msp_bridge *m)
 		} __attribute__((packed)) raw_gps;
 	} data;
 	
-	GPSPositionData gps_data = {};
+	const GPSPositionData *gps_data = &m->snap.gps_position;
 	
-	if (GPSPositionHandle() != NULL)
+	if (state_snapshot_has(&m->snap, STATE_SNAPSHOT_GPSPOSITION))
 	{
-		GPSPositionGet(&gps_data);
-		data.raw_gps.fix           = (gps_data.Status >= GPSPOSITION_STATUS_FIX2D ? 1 : 0);  // Data will display on OSD if 2D fix or better
-		data.raw_gps.num_sat       = gps_data.Satellites;
-		data.raw_gps.lat           = gps_data.Latitude;
-		data.raw_gps.lon           = gps_data.Longitude;
-		data.raw_gps.alt           = (uint16_t)gps_data.Altitude;
-		data.raw_gps.speed         = (uint16_t)(gps_data.Groundspeed * 100.0f);
-		data.raw_gps.ground_course = (int16_t)(gps_data.Heading * 10.0f);
+		data.raw_gps.fix           = (gps_data->Status >= GPSPOSITION_STATUS_FIX2D ? 1 : 0);  // Data will display on OSD if 2D fix or better
+		data.raw_gps.num_sat       = gps_data->Satellites;
+		data.raw_gps.lat           = gps_data->Latitude;
+		data.raw_gps.lon           = gps_data->Longitude;
+		data.raw_gps.alt           = (uint16_t)gps_data->Altitude;
+		data.raw_gps.speed         = (uint16_t)(gps_data->Groundspeed * 100.0f);
+		data.raw_gps.ground_course = (int16_t)(gps_data->Heading * 10.0f);
 	}
 	else
 	{
@@ -858,10 +841,11 @@ static void msp_send_comp_gps(struct msp_bridge *m)
 		} __attribute__((packed)) comp_gps;
 	} data;
 	
-	GPSPositionData gps_data   = {};
-	HomeLocationData home_data = {};
+	const GPSPositionData *gps_data   = &m->snap.gps_position;
+	const HomeLocationData *home_data = &m->snap.home;
 	
-	if ((GPSPositionHandle() == NULL) || (HomeLocationHandle() == NULL))
+	if (!state_snapshot_has(&m->snap, STATE_SNAPSHOT_GPSPOSITION) ||
+			!state_snapshot_has(&m->snap, STATE_SNAPSHOT_HOMELOCATION))
 	{
 		data.comp_gps.distance_to_home    = 0;
 		data.comp_gps.direction_to_home   = 0;
@@ -869,10 +853,7 @@ static void msp_send_comp_gps(struct msp_bridge *m)
 	}
 	else
 	{
-		GPSPositionGet(&gps_data);
-		HomeLocationGet(&home_data);
-		
-		if((gps_data.Status < GPSPOSITION_STATUS_FIX2D) || (home_data.Set == HOMELOCATION_SET_FALSE))
+		if((gps_data->Status < GPSPOSITION_STATUS_FIX2D) || (home_data->Set == HOMELOCATION_SET_FALSE))
 		{
 			data.comp_gps.distance_to_home    = 0;
 			data.comp_gps.direction_to_home   = 0;
@@ -882,13 +863,13 @@ static void msp_send_comp_gps(struct msp_bridge *m)
 		{
 			data.comp_gps.home_position_valid = 1;  // Home distance and direction will display on OSD
 			
-			int32_t delta_lon = (home_data.Longitude - gps_data.Longitude);  // degrees * 1e7
-			int32_t delta_lat = (home_data.Latitude  - gps_data.Latitude );  // degrees * 1e7
+			int32_t delta_lon = (home_data->Longitude - gps_data->Longitude);  // degrees * 1e7
+			int32_t delta_lat = (home_data->Latitude  - gps_data->Latitude );  // degrees * 1e7
 	
 			float delta_y = (float)delta_lon * WGS84_RADIUS_EARTH_KM * DEG2RAD;  // KM * 1e7
 			float delta_x = (float)delta_lat * WGS84_RADIUS_EARTH_KM * DEG2RAD;  // KM * 1e7
 	
-			delta_y *= cosf((float)home_data.Latitude * 1e-7f * (float)DEG2RAD);  // Latitude compression correction
+			delta_y *= cosf((float)home_data->Latitude * 1e-7f * (float)DEG2RAD);  // Latitude compression correction
 	
 			data.comp_gps.distance_to_home  = (uint16_t)(sqrtf(delta_x * delta_x + delta_y * delta_y) * 1e-4f);  // meters
 	
@@ -914,9 +895,8 @@ static void msp_send_altitude(struct msp_bridge *m)
 	
 	float tmp;
 
-	if (PositionActualHandle() != NULL) {
-		PositionActualDownGet(&tmp);
-		tmp = -tmp;
+	if (state_snapshot_has(&m->snap, STATE_SNAPSHOT_POSITIONACTUAL)) {
+		tmp = -m->snap.position.Down;
 	} else {
 		return;
 	}
@@ -944,21 +924,20 @@ static uint16_t msp_scale_rc_thr(float percent) {
 // MSP RC order is Roll/Pitch/Yaw/Throttle/AUX1/AUX2/AUX3/AUX4
 static void msp_send_channels(struct msp_bridge *m)
 {
-	ManualControlCommandData manualState;
-	ManualControlCommandGet(&manualState);
+	const ManualControlCommandData *manualState = &m->snap.manual_control;
 
 	union {
 		uint8_t buf[0];
 		uint16_t channels[8];
 	} data = {
 		.channels = {
-			msp_scale_rc(manualState.Roll),
-			msp_scale_rc(manualState.Pitch * -1), // MW pitch is backwards
-			msp_scale_rc(manualState.Yaw),
-			msp_scale_rc_thr(manualState.Throttle),
-			msp_scale_rc(manualState.Accessory[0]),
-			msp_scale_rc(manualState.Accessory[1]),
-			msp_scale_rc(manualState.Accessory[2]),
+			msp_scale_rc(manualState->Roll),
+			msp_scale_rc(manualState->Pitch * -1), // MW pitch is backwards
+			msp_scale_rc(manualState->Yaw),
+			msp_scale_rc_thr(manualState->Throttle),
+			msp_scale_rc(manualState->Accessory[0]),
+			msp_scale_rc(manualState->Accessory[1]),
+			msp_scale_rc(manualState->Accessory[2]),
 			1000, // no aux4
 		}
 	};
@@ -1032,13 +1011,12 @@ static void msp_send_alarms(struct msp_bridge *m) {
 		} __attribute__((packed)) alarm;
 	} data;
 
-	SystemAlarmsData alarm;
-	SystemAlarmsGet(&alarm);
+	const SystemAlarmsData *alarm = &m->snap.alarms;
 
 	// Special case early boot times -- just report boot reason
 	if (PIOS_Thread_Systime() < BOOT_DISPLAY_TIME_MS) {
 		data.alarm.state = ALARM_CRIT;
-		const char *boot_reason = AlarmBootReason(alarm.RebootCause);
+		const char *boot_reason = AlarmBootReason(alarm->RebootCause);
 		strncpy((char*)data.alarm.msg, boot_reason, MAX_ALARM_LEN);
 		data.alarm.msg[MAX_ALARM_LEN-1] = '\0';
 		msp_send(m, MSP_ALARMS, data.buf, strlen((char*)data.alarm.msg)+1);
@@ -1047,7 +1025,7 @@ static void msp_send_alarms(struct msp_bridge *m) {
 
 	uint8_t state;
 	data.alarm.state = ALARM_OK;
-	int32_t len = AlarmString(&alarm, data.alarm.msg,
+	int32_t len = AlarmString(alarm, data.alarm.msg,
 				  sizeof(data.alarm.msg), false, &state);
 	switch (state) {
 	case SYSTEMALARMS_ALARM_WARNING:
@@ -1068,6 +1046,8 @@ static msp_state msp_state_checksum(struct msp_bridge *m, uint8_t b)
 		return MSP_IDLE;
 	}
 
+	state_snapshot_get(&m->snap);
+
 	// Respond to interesting things.
 	switch (m->cmd_id) {
 	case MSP_API_VERSION:
@@ -1240,6 +1220,10 @@ static int32_t uavoMSPBridgeStart(void)
 		return -1;
 	}
 
+	if (state_snapshot_initialize(SNAPSHOT_PERIOD_MS) == -1) {
+		return -1;
+	}
+
 	struct pios_thread *task = PIOS_Thread_Create(
 		uavoMSPBridgeTask, "uavoMSPBridge",
 		STACK_SIZE_BYTES, NULL, TASK_PRIORITY);
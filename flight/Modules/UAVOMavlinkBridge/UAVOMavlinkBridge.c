@@ -37,19 +37,10 @@
 #include "physical_constants.h"
 #include "modulesettings.h"
 #include "flightbatterysettings.h"
-#include "flightbatterystate.h"
-#include "gpsposition.h"
-#include "manualcontrolcommand.h"
-#include "attitudeactual.h"
-#include "airspeedactual.h"
-#include "actuatordesired.h"
-#include "flightstatus.h"
-#include "systemstats.h"
-#include "homelocation.h"
-#include "baroaltitude.h"
 #include "mavlink.h"
 #include "pios_thread.h"
 #include "pios_modules.h"
+#include "state_snapshot.h"
 
 #include <pios_hal.h>
 
@@ -96,6 +87,8 @@ static uint8_t * stream_ticks;
 
 static mavlink_message_t *mav_msg;
 
+static struct state_snapshot *snap;
+
 static void updateSettings();
 
 /**
@@ -105,6 +98,10 @@ static void updateSettings();
  */
 static int32_t uavoMavlinkBridgeStart(void) {
 	if (module_enabled) {
+		if (state_snapshot_initialize(1000 / TASK_RATE_HZ) == -1) {
+			return -1;
+		}
+
 		// Start tasks
 		uavoMavlinkBridgeTaskHandle = PIOS_Thread_Create(
 				uavoMavlinkBridgeTask, "uavoMavlinkBridge", STACK_SIZE_BYTES, NULL, TASK_PRIORITY);
@@ -127,8 +124,9 @@ static int32_t uavoMavlinkBridgeInitialize(void) {
 
 		mav_msg = PIOS_malloc(sizeof(*mav_msg));
 		stream_ticks = PIOS_malloc_no_dma(MAXSTREAMS);
+		snap = PIOS_malloc_no_dma(sizeof(*snap));
 
-		if (mav_msg && stream_ticks) {
+		if (mav_msg && stream_ticks && snap) {
 			for (int x = 0; x < MAXSTREAMS; ++x) {
 				stream_ticks[x] = (TASK_RATE_HZ / mav_rates[x]);
 			}
@@ -165,33 +163,31 @@ static void uavoMavlinkBridgeTask(void *parameters) {
 	if (FlightBatterySettingsHandle() != NULL )
 		FlightBatterySettingsGet(&batSettings);
 
-	SystemStatsData systemStats;
+	const SystemStatsData *systemStats = &snap->stats;
 
 	while (1) {
 		PIOS_Thread_Sleep_Until(&lastSysTime, 1000 / TASK_RATE_HZ);
 
-		if (stream_trigger(MAV_DATA_STREAM_EXTENDED_STATUS)) {
-			FlightBatteryStateData batState = {};
-
-			if (FlightBatteryStateHandle() != NULL )
-				FlightBatteryStateGet(&batState);
+		// Everything sent this tick comes from the one snapshot
+		state_snapshot_get(snap);
 
-			SystemStatsGet(&systemStats);
+		if (stream_trigger(MAV_DATA_STREAM_EXTENDED_STATUS)) {
+			const FlightBatteryStateData *batState = &snap->battery;
 
 			int8_t battery_remaining = 0;
 			if (batSettings.Capacity != 0) {
-				if (batState.ConsumedEnergy < batSettings.Capacity) {
-					battery_remaining = 100 - lroundf(batState.ConsumedEnergy / batSettings.Capacity * 100);
+				if (batState->ConsumedEnergy < batSettings.Capacity) {
+					battery_remaining = 100 - lroundf(batState->ConsumedEnergy / batSettings.Capacity * 100);
 				}
 			}
 
 			uint16_t voltage = 0;
 			if (batSettings.VoltagePin != FLIGHTBATTERYSETTINGS_VOLTAGEPIN_NONE)
-				voltage = lroundf(batState.Voltage * 1000);
+				voltage = lroundf(batState->Voltage * 1000);
 
 			uint16_t current = 0;
 			if (batSettings.CurrentPin != FLIGHTBATTERYSETTINGS_CURRENTPIN_NONE)
-				current = lroundf(batState.Current * 100);
+				current = lroundf(batState->Current * 100);
 
 			mavlink_msg_sys_status_pack(0, 200, mav_msg,
 					// onboard_control_sensors_present Bitmask showing which onboard controllers and sensors are present. Value of 0: not present. Value of 1: present. Indices: 0: 3D gyro, 1: 3D acc, 2: 3D mag, 3: absolute pressure, 4: differential pressure, 5: GPS, 6: optical flow, 7: computer vision position, 8: laser based position, 9: external ground-truth (Vicon or Leica). Controllers: 10: 3D angular rate control 11: attitude stabilization, 12: yaw position, 13: z/altitude control, 14: x/y position control, 15: motor outputs / control
@@ -201,7 +197,7 @@ static void uavoMavlinkBridgeTask(void *parameters) {
 					// onboard_control_sensors_health Bitmask showing which onboard controllers and sensors are operational or have an error:  Value of 0: not enabled. Value of 1: enabled. Indices: 0: 3D gyro, 1: 3D acc, 2: 3D mag, 3: absolute pressure, 4: differential pressure, 5: GPS, 6: optical flow, 7: computer vision position, 8: laser based position, 9: external ground-truth (Vicon or Leica). Controllers: 10: 3D angular rate control 11: attitude stabilization, 12: yaw position, 13: z/altitude control, 14: x/y position control, 15: motor outputs / control
 					0,
 					// load Maximum usage in percent of the mainloop time, (0%: 0, 100%: 1000) should be always below 1000
-					(uint16_t)systemStats.CPULoad * 10,
+					(uint16_t)systemStats->CPULoad * 10,
 					// voltage_battery Battery voltage, in millivolts (1 = 1 millivolt)
 					voltage,
 					// current_battery Battery current, in 10*milliamperes (1 = 10 milliampere), -1: autopilot does not measure the current
@@ -225,54 +221,42 @@ static void uavoMavlinkBridgeTask(void *parameters) {
 		}
 
 		if (stream_trigger(MAV_DATA_STREAM_RC_CHANNELS)) {
-			ManualControlCommandData manualState;
-			FlightStatusData flightStatus;
-
-			ManualControlCommandGet(&manualState);
-			FlightStatusGet(&flightStatus);
-			SystemStatsGet(&systemStats);
+			const ManualControlCommandData *manualState = &snap->manual_control;
 
 			//TODO connect with RSSI object and pass in last argument
 			mavlink_msg_rc_channels_raw_pack(0, 200, mav_msg,
 					// time_boot_ms Timestamp (milliseconds since system boot)
-					systemStats.FlightTime,
+					systemStats->FlightTime,
 					// port Servo output port (set of 8 outputs = 1 port). Most MAVs will just use one, but this allows to encode more than 8 servos.
 					0,
 					// chan1_raw RC channel 1 value, in microseconds
-					manualState.Channel[0],
+					manualState->Channel[0],
 					// chan2_raw RC channel 2 value, in microseconds
-					manualState.Channel[1],
+					manualState->Channel[1],
 					// chan3_raw RC channel 3 value, in microseconds
-					manualState.Channel[2],
+					manualState->Channel[2],
 					// chan4_raw RC channel 4 value, in microseconds
-					manualState.Channel[3],
+					manualState->Channel[3],
 					// chan5_raw RC channel 5 value, in microseconds
-					manualState.Channel[4],
+					manualState->Channel[4],
 					// chan6_raw RC channel 6 value, in microseconds
-					manualState.Channel[5],
+					manualState->Channel[5],
 					// chan7_raw RC channel 7 value, in microseconds
-					manualState.Channel[6],
+					manualState->Channel[6],
 					// chan8_raw RC channel 8 value, in microseconds
-					manualState.Channel[7],
+					manualState->Channel[7],
 					// rssi Receive signal strength indicator, 0: 0%, 255: 100%
-					manualState.Rssi);
+					manualState->Rssi);
 
 			send_message();
 		}
 
 		if (stream_trigger(MAV_DATA_STREAM_POSITION)) {
-			GPSPositionData gpsPosData = {};
-			HomeLocationData homeLocation = {};
-			SystemStatsGet(&systemStats);
-
-			if (GPSPositionHandle() != NULL )
-				GPSPositionGet(&gpsPosData);
-			if (HomeLocationHandle() != NULL )
-				HomeLocationGet(&homeLocation);
-			SystemStatsGet(&systemStats);
+			const GPSPositionData *gpsPosData = &snap->gps_position;
+			const HomeLocationData *homeLocation = &snap->home;
 
 			uint8_t gps_fix_type;
-			switch (gpsPosData.Status)
+			switch (gpsPosData->Status)
 			{
 			case GPSPOSITION_STATUS_NOGPS:
 				gps_fix_type = 0;
@@ -294,35 +278,35 @@ static void uavoMavlinkBridgeTask(void *parameters) {
 
 			mavlink_msg_gps_raw_int_pack(0, 200, mav_msg,
 					// time_usec Timestamp (microseconds since UNIX epoch or microseconds since system boot)
-					(uint64_t)systemStats.FlightTime * 1000,
+					(uint64_t)systemStats->FlightTime * 1000,
 					// fix_type 0-1: no fix, 2: 2D fix, 3: 3D fix. Some applications will not use the value of this field unless it is at least two, so always correctly fill in the fix.
 					gps_fix_type,
 					// lat Latitude in 1E7 degrees
-					gpsPosData.Latitude,
+					gpsPosData->Latitude,
 					// lon Longitude in 1E7 degrees
-					gpsPosData.Longitude,
+					gpsPosData->Longitude,
 					// alt Altitude in 1E3 meters (millimeters) above MSL
-					gpsPosData.Altitude * 1000,
+					gpsPosData->Altitude * 1000,
 					// eph GPS HDOP horizontal dilution of position in cm (m*100). If unknown, set to: 65535
-					gpsPosData.HDOP * 100,
+					gpsPosData->HDOP * 100,
 					// epv GPS VDOP horizontal dilution of position in cm (m*100). If unknown, set to: 65535
-					gpsPosData.VDOP * 100,
+					gpsPosData->VDOP * 100,
 					// vel GPS ground speed (m/s * 100). If unknown, set to: 65535
-					gpsPosData.Groundspeed * 100,
+					gpsPosData->Groundspeed * 100,
 					// cog Course over ground (NOT heading, but direction of movement) in degrees * 100, 0.0..359.99 degrees. If unknown, set to: 65535
-					gpsPosData.Heading * 100,
+					gpsPosData->Heading * 100,
 					// satellites_visible Number of satellites visible. If unknown, set to 255
-					gpsPosData.Satellites);
+					gpsPosData->Satellites);
 
 			send_message();
 
 			mavlink_msg_gps_global_origin_pack(0, 200, mav_msg,
 					// latitude Latitude (WGS84), expressed as * 1E7
-					homeLocation.Latitude,
+					homeLocation->Latitude,
 					// longitude Longitude (WGS84), expressed as * 1E7
-					homeLocation.Longitude,
+					homeLocation->Longitude,
 					// altitude Altitude(WGS84), expressed as * 1000
-					homeLocation.Altitude * 1000);
+					homeLocation->Altitude * 1000);
 
 			send_message();
 
@@ -338,21 +322,17 @@ static void uavoMavlinkBridgeTask(void *parameters) {
 		}
 
 		if (stream_trigger(MAV_DATA_STREAM_EXTRA1)) {
-			AttitudeActualData attActual;
-			SystemStatsData systemStats;
-
-			AttitudeActualGet(&attActual);
-			SystemStatsGet(&systemStats);
+			const AttitudeActualData *attActual = &snap->attitude;
 
 			mavlink_msg_attitude_pack(0, 200, mav_msg,
 					// time_boot_ms Timestamp (milliseconds since system boot)
-					systemStats.FlightTime,
+					systemStats->FlightTime,
 					// roll Roll angle (rad)
-					attActual.Roll * DEG2RAD,
+					attActual->Roll * DEG2RAD,
 					// pitch Pitch angle (rad)
-					attActual.Pitch * DEG2RAD,
+					attActual->Pitch * DEG2RAD,
 					// yaw Yaw angle (rad)
-					attActual.Yaw * DEG2RAD,
+					attActual->Yaw * DEG2RAD,
 					// rollspeed Roll angular speed (rad/s)
 					0,
 					// pitchspeed Pitch angular speed (rad/s)
@@ -364,43 +344,32 @@ static void uavoMavlinkBridgeTask(void *parameters) {
 		}
 
 		if (stream_trigger(MAV_DATA_STREAM_EXTRA2)) {
-			ActuatorDesiredData actDesired;
-			AttitudeActualData attActual;
-			AirspeedActualData airspeedActual = {};
-			GPSPositionData gpsPosData = {};
-			BaroAltitudeData baroAltitude = {};
-			FlightStatusData flightStatus;
-
-			if (AirspeedActualHandle() != NULL )
-				AirspeedActualGet(&airspeedActual);
-			if (GPSPositionHandle() != NULL )
-				GPSPositionGet(&gpsPosData);
-			if (BaroAltitudeHandle() != NULL )
-				BaroAltitudeGet(&baroAltitude);
-			ActuatorDesiredGet(&actDesired);
-			AttitudeActualGet(&attActual);
-			FlightStatusGet(&flightStatus);
+			const ActuatorDesiredData *actDesired = &snap->actuator_desired;
+			const AttitudeActualData *attActual = &snap->attitude;
+			const AirspeedActualData *airspeedActual = &snap->airspeed;
+			const GPSPositionData *gpsPosData = &snap->gps_position;
+			const FlightStatusData *flightStatus = &snap->flight_status;
 
 			float altitude = 0;
-			if (BaroAltitudeHandle() != NULL)
-				altitude = baroAltitude.Altitude;
-			else if (GPSPositionHandle() != NULL)
-				altitude = gpsPosData.Altitude;
+			if (state_snapshot_has(snap, STATE_SNAPSHOT_BAROALTITUDE))
+				altitude = snap->baro.Altitude;
+			else if (state_snapshot_has(snap, STATE_SNAPSHOT_GPSPOSITION))
+				altitude = gpsPosData->Altitude;
 
-			// round attActual.Yaw to nearest int and transfer from (-180 ... 180) to (0 ... 360)
-			int16_t heading = lroundf(attActual.Yaw);
+			// round attActual->Yaw to nearest int and transfer from (-180 ... 180) to (0 ... 360)
+			int16_t heading = lroundf(attActual->Yaw);
 			if (heading < 0)
 				heading += 360;
 
 			mavlink_msg_vfr_hud_pack(0, 200, mav_msg,
 					// airspeed Current airspeed in m/s
-					airspeedActual.TrueAirspeed,
+					airspeedActual->TrueAirspeed,
 					// groundspeed Current ground speed in m/s
-					gpsPosData.Groundspeed,
+					gpsPosData->Groundspeed,
 					// heading Current heading in degrees, in compass units (0..360, 0=north)
 					heading,
 					// throttle Current throttle setting in integer percent, 0 to 100
-					actDesired.Thrust * 100,
+					actDesired->Thrust * 100,
 					// alt Current altitude (MSL), in meters
 					altitude,
 					// climb Current climb rate in meters/second
@@ -409,12 +378,12 @@ static void uavoMavlinkBridgeTask(void *parameters) {
 			send_message();
 
 			uint8_t armed_mode = 0;
-			if (flightStatus.Armed == FLIGHTSTATUS_ARMED_ARMED)
+			if (flightStatus->Armed == FLIGHTSTATUS_ARMED_ARMED)
 				armed_mode |= MAV_MODE_FLAG_SAFETY_ARMED;
 
 			uint8_t custom_mode = CUSTOM_MODE_STAB;
 
-			switch (flightStatus.FlightMode) {
+			switch (flightStatus->FlightMode) {
 				case FLIGHTSTATUS_FLIGHTMODE_MANUAL:
 				case FLIGHTSTATUS_FLIGHTMODE_VIRTUALBAR:
 				case FLIGHTSTATUS_FLIGHTMODE_HORIZON:
@@ -529,6 +529,42 @@ uint16_t PIOS_COM_GetNumReceiveBytesPending(uintptr_t com_id) {
 	return rx_pending;
 }
 
+/**
+ * Restart the receiver if it stalled for lack of room in the receive buffer,
+ * then wait for more data to arrive.
+ * \param[in] com_dev COM device
+ * \param[in,out] timeout_ms time left to wait, consumed by the wait
+ * \returns true if the receive buffer should be checked again
+ */
+static bool PIOS_COM_WaitForRx(struct pios_com_dev *com_dev, uint32_t *timeout_ms)
+{
+	/* Make sure the receiver is running while we wait */
+	if (com_dev->driver->rx_start) {
+		/* Notify the lower layer that there is now room in the rx buffer */
+		uint16_t rx_space_avail;
+
+		circ_queue_write_pos(com_dev->rx, NULL,
+				&rx_space_avail);
+		(com_dev->driver->rx_start)(com_dev->lower_id,
+					    rx_space_avail);
+	}
+	if (*timeout_ms > 0) {
+#if defined(PIOS_INCLUDE_RTOS)
+		if (PIOS_Semaphore_Take(com_dev->rx_sem, *timeout_ms) == true) {
+			/* Make sure we don't come back here again */
+			*timeout_ms = 0;
+			return true;
+		}
+#else
+		PIOS_DELAY_WaitmS(1);
+		(*timeout_ms)--;
+		return true;
+#endif
+	}
+
+	return false;
+}
+
 /**
 * Transfer bytes from port buffers into another buffer
 * \param[in] port COM port
@@ -553,38 +589,72 @@ uint16_t PIOS_COM_ReceiveBuffer(uintptr_t com_id, uint8_t * buf, uint16_t buf_le
 		PIOS_Semaphore_Take(com_dev->rx_sem, 0);
 	}
 
-check_again:
-	bytes_from_fifo = circ_queue_read_data(com_dev->rx, buf, buf_len);
+	do {
+		bytes_from_fifo = circ_queue_read_data(com_dev->rx, buf, buf_len);
+		/* No more bytes in receive buffer, wait for some */
+	} while (bytes_from_fifo == 0 &&
+			PIOS_COM_WaitForRx(com_dev, &timeout_ms));
 
-	if (bytes_from_fifo == 0) {
-		/* No more bytes in receive buffer */
-		/* Make sure the receiver is running while we wait */
-		if (com_dev->driver->rx_start) {
-			/* Notify the lower layer that there is now room in the rx buffer */
-			uint16_t rx_space_avail;
+	/* Return received byte */
+	return (bytes_from_fifo);
+}
 
-			circ_queue_write_pos(com_dev->rx, NULL,
-					&rx_space_avail);
-			(com_dev->driver->rx_start)(com_dev->lower_id,
-						    rx_space_avail);
-		}
-		if (timeout_ms > 0) {
-#if defined(PIOS_INCLUDE_RTOS)
-			if (PIOS_Semaphore_Take(com_dev->rx_sem, timeout_ms) == true) {
-				/* Make sure we don't come back here again */
-				timeout_ms = 0;
-				goto check_again;
-			}
-#else
-			PIOS_DELAY_WaitmS(1);
-			timeout_ms--;
-			goto check_again;
-#endif
-		}
+/**
+ * Look at received bytes where they sit in the port buffer, instead of
+ * copying them out. They stay in the buffer until released with
+ * PIOS_COM_ReceiveRelease(), and the same bytes are returned until then.
+ * \param[in] com_id COM port
+ * \param[out] len number of bytes that can be read at the returned pointer
+ * \param[in] timeout_ms how long to wait for data if there is none
+ * \returns the received bytes, or NULL if none arrived in time
+ */
+const uint8_t *PIOS_COM_ReceivePeek(uintptr_t com_id, uint16_t *len, uint32_t timeout_ms)
+{
+	PIOS_Assert(len);
+	const uint8_t *data;
+
+	struct pios_com_dev *com_dev = (struct pios_com_dev *)com_id;
+
+	if (!PIOS_COM_validate(com_dev)) {
+		/* Undefined COM port for this board (see pios_board.c) */
+		PIOS_Assert(0);
 	}
+	PIOS_Assert(com_dev->rx);
 
-	/* Return received byte */
-	return (bytes_from_fifo);
+	/* Clear any pending RX wakeup */
+	if (com_dev->rx_sem) {
+		PIOS_Semaphore_Take(com_dev->rx_sem, 0);
+	}
+
+	do {
+		data = circ_queue_read_pos(com_dev->rx, len, NULL);
+	} while (data == NULL &&
+			PIOS_COM_WaitForRx(com_dev, &timeout_ms));
+
+	if (data == NULL) {
+		*len = 0;
+	}
+
+	return data;
+}
+
+/**
+ * Hand back bytes obtained from PIOS_COM_ReceivePeek() once they have been
+ * processed, making room for more to be received.
+ * \param[in] com_id COM port
+ * \param[in] len number of bytes consumed, no more than were returned
+ */
+void PIOS_COM_ReceiveRelease(uintptr_t com_id, uint16_t len)
+{
+	struct pios_com_dev *com_dev = (struct pios_com_dev *)com_id;
+
+	if (!PIOS_COM_validate(com_dev)) {
+		/* Undefined COM port for this board (see pios_board.c) */
+		PIOS_Assert(0);
+	}
+	PIOS_Assert(com_dev->rx);
+
+	circ_queue_read_completed_multi(com_dev->rx, len);
 }
 
 /**
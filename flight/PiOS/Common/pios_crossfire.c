@@ -94,6 +94,14 @@ static bool PIOS_Crossfire_Validate(const struct pios_crossfire_dev *dev);
  * @retval raw channel value, or error value (see pios_rcvr.h)
  */
 static int32_t PIOS_Crossfire_Read(uintptr_t id, uint8_t channel);
+/**
+ * @brief Read the first channels of the last received frame at once
+ * @param[in] id Driver instance
+ * @param[out] channels raw channel values, or error values
+ * @param[in] num_channels number of channels wanted
+ * @retval number of channels provided, or error value (see pios_rcvr.h)
+ */
+static int32_t PIOS_Crossfire_ReadFrame(uintptr_t id, int16_t *channels, uint8_t num_channels);
 /**
  * @brief Set all channels in the last frame buffer to a given value
  * @param[in] dev Driver instance
@@ -130,6 +138,7 @@ static void PIOS_Crossfire_Supervisor(uintptr_t context);
 // public
 const struct pios_rcvr_driver pios_crossfire_rcvr_driver = {
 	.read = PIOS_Crossfire_Read,
+	.read_frame = PIOS_Crossfire_ReadFrame,
 };
 
 
@@ -190,16 +199,33 @@ int PIOS_Crossfire_InitTelemetry(uintptr_t crsf_id)
 
 static int32_t PIOS_Crossfire_Read(uintptr_t context, uint8_t channel)
 {
-	if (channel > PIOS_CROSSFIRE_CHANNELS)
+	if (channel >= PIOS_CROSSFIRE_CHANNELS)
 		return PIOS_RCVR_INVALID;
 
 	struct pios_crossfire_dev *dev = (struct pios_crossfire_dev *)context;
 	if (!PIOS_Crossfire_Validate(dev))
-		return PIOS_RCVR_NODRIVER;
+		return PIOS_RCVR_INVALID;
 
 	return dev->channel_data[channel];
 }
 
+static int32_t PIOS_Crossfire_ReadFrame(uintptr_t context, int16_t *channels, uint8_t num_channels)
+{
+	struct pios_crossfire_dev *dev = (struct pios_crossfire_dev *)context;
+	if (!PIOS_Crossfire_Validate(dev))
+		return PIOS_RCVR_INVALID;
+
+	if (num_channels > PIOS_CROSSFIRE_CHANNELS)
+		num_channels = PIOS_CROSSFIRE_CHANNELS;
+
+	PIOS_IRQ_Disable();
+	for (int i = 0; i < num_channels; i++)
+		channels[i] = dev->channel_data[i];
+	PIOS_IRQ_Enable();
+
+	return num_channels;
+}
+
 static void PIOS_Crossfire_SetAllChannels(struct pios_crossfire_dev *dev, uint16_t value)
 {
 	for (int i = 0; i < PIOS_CROSSFIRE_CHANNELS; i++)
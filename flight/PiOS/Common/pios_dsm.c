@@ -47,9 +47,11 @@ static void PIOS_DSM_Supervisor(uintptr_t dsm_id);
 
 #if defined(PIOS_INCLUDE_RCVR)
 static int32_t PIOS_DSM_Get(uintptr_t rcvr_id, uint8_t channel);
+static int32_t PIOS_DSM_GetFrame(uintptr_t rcvr_id, int16_t *channels, uint8_t num_channels);
 
 const struct pios_rcvr_driver pios_dsm_rcvr_driver = {
 	.read = PIOS_DSM_Get,
+	.read_frame = PIOS_DSM_GetFrame,
 };
 #endif
 
@@ -423,6 +425,31 @@ static int32_t PIOS_DSM_Get(uintptr_t rcvr_id, uint8_t channel)
 	/* may also be PIOS_RCVR_TIMEOUT set by other function */
 	return dsm_dev->state.channel_data[channel];
 }
+
+/**
+ * Get the first channels of the last frame, all from the same frame
+ * \param[out] channels channel values, as PIOS_DSM_Get() would return
+ * \param[in] num_channels number of channels wanted
+ * \output PIOS_RCVR_INVALID invalid device
+ * \output >=0 number of channels provided
+ */
+static int32_t PIOS_DSM_GetFrame(uintptr_t rcvr_id, int16_t *channels, uint8_t num_channels)
+{
+	struct pios_dsm_dev *dsm_dev = (struct pios_dsm_dev *)rcvr_id;
+
+	if (!PIOS_DSM_Validate(dsm_dev))
+		return PIOS_RCVR_INVALID;
+
+	if (num_channels > PIOS_DSM_NUM_INPUTS)
+		num_channels = PIOS_DSM_NUM_INPUTS;
+
+	PIOS_IRQ_Disable();
+	for (int i = 0; i < num_channels; i++)
+		channels[i] = dsm_dev->state.channel_data[i];
+	PIOS_IRQ_Enable();
+
+	return num_channels;
+}
 #endif
 
 /**
@@ -27,6 +27,7 @@
 #include "pios.h"
 
 #include "pios_flash.h"		     /* PIOS_FLASH_* */
+#include "pios_flashfs.h"	     /* API for flash filesystem */
 #include "pios_flashfs_logfs_priv.h" /* Internal API */
 
 #include <stdbool.h>
@@ -736,6 +737,57 @@ out_exit:
 	return rc;
 }
 
+/* NOTE: Must be called while holding the flash transaction lock.  Finds the active copies of a batch's objects before end_slot in one pass, and obsoletes them unless count_only */
+static int8_t logfs_obsolete_batch (struct logfs_state *logfs, const struct pios_flashfs_obj *objs, uint16_t num_objs, uint16_t end_slot, bool count_only, uint16_t *num_found)
+{
+	*num_found = 0;
+
+	/* First slot in the arena is reserved for arena header, skip it. */
+	for (uint16_t slot_id = 1; slot_id < end_slot; slot_id++) {
+		struct slot_header slot_hdr;
+		uintptr_t slot_addr = logfs_get_addr (logfs, logfs->active_arena_id, slot_id);
+
+		if (PIOS_FLASH_read_data(logfs->partition_id,
+						slot_addr,
+						(uint8_t *)&slot_hdr,
+						sizeof (slot_hdr)) != 0) {
+			return -1;
+		}
+		if (slot_hdr.state == SLOT_STATE_EMPTY) {
+			/* We hit the end of the log */
+			break;
+		}
+		if (slot_hdr.state != SLOT_STATE_ACTIVE) {
+			continue;
+		}
+
+		for (uint16_t i = 0; i < num_objs; i++) {
+			if (slot_hdr.obj_id      != objs[i].obj_id ||
+				slot_hdr.obj_inst_id != objs[i].obj_inst_id) {
+				continue;
+			}
+
+			(*num_found)++;
+
+			if (!count_only) {
+				slot_hdr.state = SLOT_STATE_OBSOLETE;
+
+				if (PIOS_FLASH_write_data(logfs->partition_id,
+								slot_addr,
+								(uint8_t *)&slot_hdr,
+								sizeof(slot_hdr)) != 0) {
+					return -2;
+				}
+				/* Object has been successfully obsoleted and is no longer active */
+				logfs->num_active_slots--;
+			}
+			break;
+		}
+	}
+
+	return 0;
+}
+
 /* NOTE: Must be called while holding the flash transaction lock */
 static int8_t logfs_reserve_free_slot (struct logfs_state *logfs, uint16_t *slot_id, struct slot_header *slot_hdr, uint32_t obj_id, uint16_t obj_inst_id, uint16_t obj_size)
 {
@@ -840,7 +892,6 @@ static int8_t logfs_append_to_log (struct logfs_state *logfs, uint32_t obj_id, u
  * Provide a PIOS_FLASHFS_* driver
  *
  *********************************/
-#include "pios_flashfs.h"	/* API for flash filesystem */
 
 /**
  * @brief Saves one object instance to the filesystem
@@ -930,6 +981,127 @@ out_exit:
 	return rc;
 }
 
+/**
+ * @brief Saves a batch of object instances to the filesystem, in one
+ * transaction
+ * @param[in] fs_id The filesystem to use for this action
+ * @param[in] objs The object instances to save, each at most once
+ * @param[in] num_objs How many object instances are in the batch
+ * @return 0 if success or error code
+ * @retval -1 if fs_id is not a valid filesystem instance
+ * @retval -2 if failed to start transaction
+ * @retval -3 if failure to find or delete previous versions of the objects
+ * @retval -4 if the filesystem can't hold the batch even after garbage collection
+ * @retval -5 if garbage collection failed
+ * @retval -6 if the log is full even after garbage collection should have freed space
+ * @retval -7 if writing the new objects to the filesystem failed
+ * @retval -8 if the batch names the same object instance more than once
+ *
+ * Saving objects one at a time scans the log once per object to obsolete
+ * the old copies, and may garbage collect several times in a row as the
+ * log fills.  A batch scans it once and decides on garbage collection once,
+ * up front: if the log has room for the whole batch the new copies are
+ * appended before the old ones are obsoleted, so an interrupted save leaves
+ * the old copies in place.  Otherwise the old copies are obsoleted, the
+ * arena collected, and the batch appended to the fresh log.  A batch that
+ * won't fit even after garbage collection is refused before anything is
+ * written.
+ */
+int32_t PIOS_FLASHFS_ObjSaveBatch(uintptr_t fs_id, const struct pios_flashfs_obj *objs, uint16_t num_objs)
+{
+	int8_t rc;
+
+	struct logfs_state *logfs = (struct logfs_state *)fs_id;
+
+	if (!PIOS_FLASHFS_Logfs_validate(logfs)) {
+		rc = -1;
+		goto out_exit;
+	}
+
+	for (uint16_t i = 0; i < num_objs; i++) {
+		PIOS_Assert(objs[i].obj_size <= (logfs->cfg->slot_size - sizeof(struct slot_header)));
+
+		for (uint16_t j = 0; j < i; j++) {
+			if (objs[i].obj_id      == objs[j].obj_id &&
+				objs[i].obj_inst_id == objs[j].obj_inst_id) {
+				rc = -8;
+				goto out_exit;
+			}
+		}
+	}
+
+	if (PIOS_FLASH_start_transaction(logfs->partition_id) != 0) {
+		rc = -2;
+		goto out_exit;
+	}
+
+	uint16_t num_slots = logfs->cfg->arena_size / logfs->cfg->slot_size;
+	uint16_t num_old;
+
+	if (logfs->num_free_slots >= num_objs) {
+		/* The whole batch fits in the log as it is.  Append it first... */
+		uint16_t first_new_slot = num_slots - logfs->num_free_slots;
+
+		for (uint16_t i = 0; i < num_objs; i++) {
+			if (logfs_append_to_log(logfs, objs[i].obj_id, objs[i].obj_inst_id, objs[i].obj_data, objs[i].obj_size) != 0) {
+				rc = -7;
+				goto out_end_trans;
+			}
+		}
+
+		/* ...then obsolete the old copies, which all come before it */
+		if (logfs_obsolete_batch(logfs, objs, num_objs, first_new_slot, false, &num_old) != 0) {
+			rc = -3;
+			goto out_end_trans;
+		}
+	} else {
+		/* Garbage collection is required.  Will the batch fit after it? */
+		if (logfs_obsolete_batch(logfs, objs, num_objs, num_slots, true, &num_old) != 0) {
+			rc = -3;
+			goto out_end_trans;
+		}
+
+		if (logfs->num_active_slots - num_old + num_objs > num_slots - 1) {
+			/* Full of *active* records so gc won't make enough room */
+			rc = -4;
+			goto out_end_trans;
+		}
+
+		if (logfs_obsolete_batch(logfs, objs, num_objs, num_slots, false, &num_old) != 0) {
+			rc = -3;
+			goto out_end_trans;
+		}
+
+		if (logfs_garbage_collect(logfs) != 0) {
+			rc = -5;
+			goto out_end_trans;
+		}
+
+		/* Check one more time just to be sure we actually free'd enough space */
+		if (logfs->num_free_slots < num_objs) {
+			PIOS_DEBUG_Assert(0);
+			rc = -6;
+			goto out_end_trans;
+		}
+
+		for (uint16_t i = 0; i < num_objs; i++) {
+			if (logfs_append_to_log(logfs, objs[i].obj_id, objs[i].obj_inst_id, objs[i].obj_data, objs[i].obj_size) != 0) {
+				rc = -7;
+				goto out_end_trans;
+			}
+		}
+	}
+
+	/* Batch successfully written to the log */
+	rc = 0;
+
+out_end_trans:
+	PIOS_FLASH_end_transaction(logfs->partition_id);
+
+out_exit:
+	return rc;
+}
+
 /**
  * @brief Load one object instance from the filesystem
  * @param[in] fs_id The filesystem to use for this action
@@ -27,10 +27,14 @@
 #include "pios.h"		/* PIOS_INCLUDE_* */
 
 #include "pios_heap.h"		/* External API declaration */
+#if !defined(PIOS_HEAP_SIMPLE)
+#include "pios_tlsf.h"		/* Allocator behind the heaps */
+#endif	/* PIOS_HEAP_SIMPLE */
 
 #include <stdio.h>		/* NULL */
 #include <stdint.h>		/* uintptr_t */
 #include <stdbool.h>		/* bool */
+#include <string.h>		/* memset */
 
 #define DEBUG_MALLOC_FAILURES 0
 static volatile bool malloc_failed_flag = false;
@@ -56,58 +60,165 @@ bool PIOS_heap_malloc_failed_p(void)
 struct pios_heap {
 	const uintptr_t start_addr;
 	uintptr_t end_addr;
+#if defined(PIOS_HEAP_SIMPLE)
 	uintptr_t free_addr;
+#else
+	struct pios_tlsf *tlsf;
+#endif	/* PIOS_HEAP_SIMPLE */
 };
 
 static bool is_ptr_in_heap_p(const struct pios_heap *heap, void *buf)
 {
 	uintptr_t buf_addr = (uintptr_t)buf;
 
-	return ((buf_addr >= heap->start_addr) && (buf_addr <= heap->end_addr));
+	return ((buf_addr >= heap->start_addr) && (buf_addr < heap->end_addr));
+}
+
+static void heap_lock(void)
+{
+#if defined(PIOS_INCLUDE_RTOS)
+	PIOS_Thread_Scheduler_Suspend();
+#endif	/* PIOS_INCLUDE_RTOS */
 }
 
-static void * simple_malloc(struct pios_heap *heap, size_t size)
+static void heap_unlock(void)
 {
-	if (heap == NULL)
-		return NULL;
+#if defined(PIOS_INCLUDE_RTOS)
+	PIOS_Thread_Scheduler_Resume();
+#endif	/* PIOS_INCLUDE_RTOS */
+}
+
+#if defined(PIOS_HEAP_SIMPLE)
 
+/*
+ * Bump allocator, which can't free.  For the bootloaders, which allocate
+ * a few things once and have no room for anything bigger.
+ */
+
+/* Called with the heap locked */
+static bool heap_ready(struct pios_heap *heap)
+{
+	if (heap->free_addr == 0)
+		heap->free_addr = heap->start_addr;
+
+	return true;
+}
+
+static void * heap_malloc(struct pios_heap *heap, size_t size)
+{
 	void * buf = NULL;
 	uint32_t align_pad = (sizeof(uintptr_t) - (size & (sizeof(uintptr_t) - 1))) % sizeof(uintptr_t);
 
-#if defined(PIOS_INCLUDE_RTOS) 
-	PIOS_Thread_Scheduler_Suspend();
-#endif	/* PIOS_INCLUDE_RTOS */
+	heap_lock();
+
+	heap_ready(heap);
 
 	if (heap->free_addr + size <= heap->end_addr) {
 		buf = (void *)heap->free_addr;
 		heap->free_addr += size + align_pad;
 	}
 
-#if defined(PIOS_INCLUDE_RTOS)
-	PIOS_Thread_Scheduler_Resume();
-#endif	/* PIOS_INCLUDE_RTOS */
+	heap_unlock();
 
 	return buf;
 }
 
-static void simple_free(struct pios_heap *heap, void *buf)
+static void heap_free(struct pios_heap *heap, void *buf)
 {
 	/* This allocator doesn't support free */
 }
 
-static size_t simple_get_free_bytes(struct pios_heap *heap)
+static void heap_get_stats(struct pios_heap *heap, struct pios_heap_stats *stats)
 {
-	if (heap->free_addr > heap->end_addr)
-		return 0;
+	heap_lock();
+
+	heap_ready(heap);
+
+	size_t free_bytes = 0;
+
+	if (heap->free_addr < heap->end_addr)
+		free_bytes = heap->end_addr - heap->free_addr;
 
-	return heap->end_addr - heap->free_addr;
+	heap_unlock();
+
+	/* Nothing comes back, so the least free is what's free now */
+	stats->free_bytes = free_bytes;
+	stats->min_free_bytes = free_bytes;
+	stats->largest_free = free_bytes;
 }
 
-static void simple_extend_heap(struct pios_heap *heap, size_t bytes)
+/* Called with the heap locked */
+static void heap_extend(struct pios_heap *heap, size_t bytes)
 {
 	heap->end_addr += bytes;
 }
 
+#else	/* PIOS_HEAP_SIMPLE */
+
+/* Called with the heap locked.  Sets up the allocator on first use. */
+static bool heap_ready(struct pios_heap *heap)
+{
+	if (heap->tlsf == NULL) {
+		heap->tlsf = PIOS_TLSF_Create((void *)heap->start_addr,
+				heap->end_addr - heap->start_addr);
+	}
+
+	return heap->tlsf != NULL;
+}
+
+static void * heap_malloc(struct pios_heap *heap, size_t size)
+{
+	void * buf = NULL;
+
+	heap_lock();
+
+	if (heap_ready(heap))
+		buf = PIOS_TLSF_Malloc(heap->tlsf, size);
+
+	heap_unlock();
+
+	return buf;
+}
+
+static void heap_free(struct pios_heap *heap, void *buf)
+{
+	heap_lock();
+
+	if (heap->tlsf)
+		PIOS_TLSF_Free(heap->tlsf, buf);
+
+	heap_unlock();
+}
+
+static void heap_get_stats(struct pios_heap *heap, struct pios_heap_stats *stats)
+{
+	struct pios_tlsf_stats tlsf_stats;
+
+	memset(&tlsf_stats, 0, sizeof(tlsf_stats));
+
+	heap_lock();
+
+	if (heap_ready(heap))
+		PIOS_TLSF_GetStats(heap->tlsf, &tlsf_stats);
+
+	heap_unlock();
+
+	stats->free_bytes = tlsf_stats.free_bytes;
+	stats->min_free_bytes = tlsf_stats.min_free_bytes;
+	stats->largest_free = tlsf_stats.largest_free;
+}
+
+/* Called with the heap locked */
+static void heap_extend(struct pios_heap *heap, size_t bytes)
+{
+	/* The new memory is a pool of its own, unless nothing's been allocated */
+	if (heap->tlsf == NULL ||
+			PIOS_TLSF_AddPool(heap->tlsf, (void *)heap->end_addr, bytes))
+		heap->end_addr += bytes;
+}
+
+#endif	/* PIOS_HEAP_SIMPLE */
+
 /*
  * Standard heap.  All memory in this heap is DMA-safe.
  */
@@ -117,14 +228,13 @@ extern const void * _sheap;	/* defined in linker script */
 static struct pios_heap pios_standard_heap = {
 	.start_addr = (const uintptr_t)&_sheap,
 	.end_addr   = (const uintptr_t)&_eheap,
-	.free_addr  = (uintptr_t)&_sheap,
 };
 
 
 void * pvPortMalloc(size_t size) __attribute__((alias ("PIOS_malloc"), weak));
 void * PIOS_malloc(size_t size)
 {
-	void *buf = simple_malloc(&pios_standard_heap, size);
+	void *buf = heap_malloc(&pios_standard_heap, size);
 
 	if (buf == NULL)
 		malloc_failed_hook();
@@ -145,11 +255,10 @@ extern const void * _sfastheap;	/* defined in linker script */
 static struct pios_heap pios_nodma_heap = {
 	.start_addr = (const uintptr_t)&_sfastheap,
 	.end_addr   = (const uintptr_t)&_efastheap,
-	.free_addr  = (uintptr_t)&_sfastheap,
 };
 void * PIOS_malloc_no_dma(size_t size)
 {
-	void * buf = simple_malloc(&pios_nodma_heap, size);
+	void * buf = heap_malloc(&pios_nodma_heap, size);
 
 	if (buf == NULL)
 		buf = PIOS_malloc(size);
@@ -175,45 +284,42 @@ void PIOS_free(void * buf)
 {
 #if defined(PIOS_INCLUDE_FASTHEAP)
 	if (is_ptr_in_heap_p(&pios_nodma_heap, buf))
-		return simple_free(&pios_nodma_heap, buf);
+		return heap_free(&pios_nodma_heap, buf);
 #endif	/* PIOS_INCLUDE_FASTHEAP */
 
 	if (is_ptr_in_heap_p(&pios_standard_heap, buf))
-		return simple_free(&pios_standard_heap, buf);
+		return heap_free(&pios_standard_heap, buf);
 }
 
 size_t xPortGetFreeHeapSize(void) __attribute__((alias ("PIOS_heap_get_free_size")));
 size_t PIOS_heap_get_free_size(void)
 {
-#if defined(PIOS_INCLUDE_RTOS)
-	PIOS_Thread_Scheduler_Suspend();
-#endif	/* PIOS_INCLUDE_RTOS */
-
-	size_t free_bytes = simple_get_free_bytes(&pios_standard_heap);
+	struct pios_heap_stats stats;
 
-#if defined(PIOS_INCLUDE_RTOS)
-	PIOS_Thread_Scheduler_Resume();
-#endif	/* PIOS_INCLUDE_RTOS */
+	heap_get_stats(&pios_standard_heap, &stats);
 
-	return free_bytes;
+	return stats.free_bytes;
 }
 
+void PIOS_heap_get_stats(struct pios_heap_stats *stats)
+{
+	heap_get_stats(&pios_standard_heap, stats);
+}
 
 #if defined(PIOS_INCLUDE_FASTHEAP)
 
 size_t PIOS_fastheap_get_free_size(void)
 {
-#if defined(PIOS_INCLUDE_RTOS)
-	PIOS_Thread_Scheduler_Suspend();
-#endif	/* PIOS_INCLUDE_RTOS */
+	struct pios_heap_stats stats;
 
-	size_t free_bytes = simple_get_free_bytes(&pios_nodma_heap);
+	heap_get_stats(&pios_nodma_heap, &stats);
 
-#if defined(PIOS_INCLUDE_RTOS)
-	PIOS_Thread_Scheduler_Resume();
-#endif	/* PIOS_INCLUDE_RTOS */
+	return stats.free_bytes;
+}
 
-	return free_bytes;
+void PIOS_fastheap_get_stats(struct pios_heap_stats *stats)
+{
+	heap_get_stats(&pios_nodma_heap, stats);
 }
 
 #else
@@ -223,24 +329,32 @@ size_t PIOS_fastheap_get_free_size(void)
 	return 0;
 }
 
+void PIOS_fastheap_get_stats(struct pios_heap_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+
 #endif // PIOS_INCLUDE_FASTHEAP
 
 void PIOS_heap_initialize_blocks(void)
 {
-	/* NOP for the simple allocator */
+	heap_lock();
+
+	heap_ready(&pios_standard_heap);
+#if defined(PIOS_INCLUDE_FASTHEAP)
+	heap_ready(&pios_nodma_heap);
+#endif	/* PIOS_INCLUDE_FASTHEAP */
+
+	heap_unlock();
 }
 
 void PIOS_heap_increase_size(size_t bytes)
 {
-#if defined(PIOS_INCLUDE_RTOS)
-	PIOS_Thread_Scheduler_Suspend();
-#endif	/* PIOS_INCLUDE_RTOS */
+	heap_lock();
 
-	simple_extend_heap(&pios_standard_heap, bytes);
+	heap_extend(&pios_standard_heap, bytes);
 
-#if defined(PIOS_INCLUDE_RTOS)
-	PIOS_Thread_Scheduler_Resume();
-#endif	/* PIOS_INCLUDE_RTOS */
+	heap_unlock();
 }
 
 
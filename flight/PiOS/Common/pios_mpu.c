@@ -43,6 +43,10 @@
 #endif // PIOS_MPU_SPI_HIGH_SPEED
 #define PIOS_MPU_SPI_LOW_SPEED               300000
 
+#ifndef MIN
+#define MIN(x,y) ((x) < (y) ? (x) : (y))
+#endif
+
 
 /**
  * WHOAMI ids of each device, must be same length as pios_mpu_type
@@ -105,11 +109,24 @@ struct pios_mpu_dev {
 #endif // PIOS_INCLUDE_MPU_MAG
 	volatile uint32_t interrupt_count;
 	volatile uint8_t sensor_ready;
+	uint16_t internal_rate;                     /**< Rate the sensors are sampled at, before the divisor */
+	uint16_t sample_rate;                       /**< Rate last asked of PIOS_MPU_SetSampleRate */
+	uint8_t user_ctrl;                          /**< USER_CTRL, less the FIFO bits */
+	uint8_t fifo_batch;                         /**< Samples per FIFO read, 0 if the FIFO is unused */
+	volatile uint8_t fifo_pending;              /**< Samples queued since the reader was last woken */
+	uint8_t *fifo_buf;
+	uint32_t fifo_interval_us;                  /**< Time between samples in the FIFO */
+	volatile uint32_t last_sample_raw;          /**< PIOS_DELAY_GetRaw() of the last data ready interrupt */
 };
 
 #define SENSOR_ACCEL			(1 << 0)
 #define SENSOR_MAG			(1 << 1)
 
+//! Bytes per sample in the FIFO: accel, temperature and gyro
+#define FIFO_RECORD_SIZE		14
+//! The smallest FIFO of the supported parts
+#define FIFO_MIN_SIZE			512
+
 //! Global structure for this device device
 static struct pios_mpu_dev *mpu_dev;
 
@@ -175,6 +192,9 @@ static int32_t PIOS_MPU_I2C_Probe(enum pios_mpu_type *detected_device);
 #endif // defined(PIOS_INCLUDE_I2C) || defined(__DOXYGEN__)
 
 static int PIOS_MPU_parse_data(struct pios_mpu_dev *p);
+static int PIOS_MPU_read_fifo(struct pios_mpu_dev *p,
+		struct pios_sensor_imu_batch *batch);
+static int32_t PIOS_MPU_ResetFIFO(void);
 
 static bool PIOS_MPU_callback_gyro(void *ctx, void *output,
 		int ms_to_wait, int *next_call)
@@ -199,6 +219,27 @@ static bool PIOS_MPU_callback_gyro(void *ctx, void *output,
 	return true;
 }
 
+static bool PIOS_MPU_callback_batch(void *ctx, void *output,
+		int ms_to_wait, int *next_call)
+{
+	struct pios_mpu_dev *dev = (struct pios_mpu_dev *)ctx;
+
+	PIOS_Assert(dev);
+	PIOS_Assert(output);
+
+	*next_call = 0;
+
+	if (PIOS_Semaphore_Take(dev->data_ready_sema, ms_to_wait) != true) {
+		return false;
+	}
+
+	if (PIOS_MPU_read_fifo(dev, output)) {
+		return false;
+	}
+
+	return true;
+}
+
 static bool PIOS_MPU_callback_accel(void *ctx, void *output,
 		int ms_to_wait, int *next_call)
 {
@@ -251,7 +292,8 @@ static struct pios_mpu_dev *PIOS_MPU_Alloc(const struct pios_mpu_cfg *cfg)
 		return NULL;
 
 	*dev = (struct pios_mpu_dev) {
-		.magic = PIOS_MPU_DEV_MAGIC
+		.magic = PIOS_MPU_DEV_MAGIC,
+		.internal_rate = 1000,
 	};
 
 	dev->data_ready_sema = PIOS_Semaphore_Create();
@@ -304,13 +346,13 @@ static int32_t PIOS_MPU_Reset()
 		return -PIOS_MPU_ERROR_WRITEFAILED;
 
 	// user control
-	if (mpu_dev->com_driver_type == PIOS_MPU_COM_SPI) {
-		if (PIOS_MPU_WriteReg(PIOS_MPU_USER_CTRL_REG, PIOS_MPU_USERCTL_DIS_I2C | PIOS_MPU_USERCTL_I2C_MST_EN) != 0)
-			return -PIOS_MPU_ERROR_WRITEFAILED;
-	} else {
-		if (PIOS_MPU_WriteReg(PIOS_MPU_USER_CTRL_REG, PIOS_MPU_USERCTL_I2C_MST_EN) != 0)
-			return -PIOS_MPU_ERROR_WRITEFAILED;
-	}
+	if (mpu_dev->com_driver_type == PIOS_MPU_COM_SPI)
+		mpu_dev->user_ctrl = PIOS_MPU_USERCTL_DIS_I2C | PIOS_MPU_USERCTL_I2C_MST_EN;
+	else
+		mpu_dev->user_ctrl = PIOS_MPU_USERCTL_I2C_MST_EN;
+
+	if (PIOS_MPU_WriteReg(PIOS_MPU_USER_CTRL_REG, mpu_dev->user_ctrl) != 0)
+		return -PIOS_MPU_ERROR_WRITEFAILED;
 
 	return 0;
 }
@@ -338,9 +380,35 @@ static int32_t PIOS_MPU_Config(struct pios_mpu_cfg const *cfg)
 	// Interrupt enable
 	PIOS_MPU_WriteReg(PIOS_MPU_INT_EN_REG, PIOS_MPU_INTEN_DATA_RDY);
 
+	if (mpu_dev->fifo_batch) {
+		// Queue each sample in the same order as the data registers
+		PIOS_MPU_WriteReg(PIOS_MPU_FIFO_EN_REG, PIOS_MPU_ACCEL_OUT |
+				PIOS_MPU_FIFO_TEMP_OUT | PIOS_MPU_FIFO_GYRO_X_OUT |
+				PIOS_MPU_FIFO_GYRO_Y_OUT | PIOS_MPU_FIFO_GYRO_Z_OUT);
+
+		if (PIOS_MPU_ResetFIFO() != 0)
+			return -PIOS_MPU_ERROR_WRITEFAILED;
+	}
+
 	return 0;
 }
 
+/**
+ * @brief Empties the FIFO and starts filling it again
+ * @return 0 if successful
+ */
+static int32_t PIOS_MPU_ResetFIFO(void)
+{
+	mpu_dev->fifo_pending = 0;
+
+	if (PIOS_MPU_WriteReg(PIOS_MPU_USER_CTRL_REG,
+			mpu_dev->user_ctrl | PIOS_MPU_USERCTL_FIFO_RST) != 0)
+		return -1;
+
+	return PIOS_MPU_WriteReg(PIOS_MPU_USER_CTRL_REG,
+			mpu_dev->user_ctrl | PIOS_MPU_USERCTL_FIFO_EN);
+}
+
 #ifdef PIOS_INCLUDE_MPU_MAG
 /**
  * @brief Writes one byte to the AK8xxx register using MPU I2C master
@@ -495,12 +563,31 @@ static int32_t PIOS_MPU_Common_Init(void)
 	}
 #endif // PIOS_INCLUDE_MPU_MAG
 
+	mpu_dev->fifo_batch = MIN(mpu_dev->cfg->fifo_batch,
+			PIOS_SENSORS_BATCH_MAX);
+
+#ifdef PIOS_INCLUDE_MPU_MAG
+	/* The mag is read along with the data registers */
+	if (mpu_dev->use_mag)
+		mpu_dev->fifo_batch = 0;
+#endif // PIOS_INCLUDE_MPU_MAG
+
+	if (mpu_dev->fifo_batch && !mpu_dev->fifo_buf) {
+		mpu_dev->fifo_buf = PIOS_malloc(PIOS_SENSORS_BATCH_MAX *
+				FIFO_RECORD_SIZE);
+
+		if (!mpu_dev->fifo_buf)
+			return -PIOS_MPU_ERROR_NOCONFIG;
+	}
+
 	/* Configure the MPU Sensor */
 	if (PIOS_MPU_Config(mpu_dev->cfg) != 0)
 		return -PIOS_MPU_ERROR_NOCONFIG;
 
+#ifndef FLIGHT_POSIX
 	/* Set up EXTI line */
 	PIOS_EXTI_Init(mpu_dev->cfg->exti_cfg);
+#endif
 
 	/* Wait 20 ms for data ready interrupt and make sure it happens twice */
 	if (!mpu_dev->cfg->skip_startup_irq_check) {
@@ -510,7 +597,9 @@ static int32_t PIOS_MPU_Common_Init(void)
 
 			while (mpu_dev->interrupt_count == ref_val) {
 				if (PIOS_DELAY_DiffuS(raw_start) > 20000) {
+#ifndef FLIGHT_POSIX
 					PIOS_EXTI_DeInit(mpu_dev->cfg->exti_cfg);
+#endif
 					return -PIOS_MPU_ERROR_NOIRQ;
 				}
 			}
@@ -520,8 +609,15 @@ static int32_t PIOS_MPU_Common_Init(void)
 	mpu_dev->accel_range = PIOS_MPU_SCALE_8G;
 	mpu_dev->gyro_range = PIOS_MPU_SCALE_1000_DEG;
 
-	int ret = PIOS_SENSORS_RegisterCallback(PIOS_SENSOR_GYRO,
-			PIOS_MPU_callback_gyro, mpu_dev);
+	int ret;
+
+	if (mpu_dev->fifo_batch) {
+		ret = PIOS_SENSORS_RegisterBatchCallback(PIOS_SENSOR_GYRO,
+				PIOS_MPU_callback_batch, mpu_dev);
+	} else {
+		ret = PIOS_SENSORS_RegisterCallback(PIOS_SENSOR_GYRO,
+				PIOS_MPU_callback_gyro, mpu_dev);
+	}
 
 	PIOS_Assert(!ret);
 
@@ -627,8 +723,22 @@ static float PIOS_MPU_GetAccelScale(void)
 void PIOS_MPU_SetGyroBandwidth(uint16_t bandwidth)
 {
 	uint8_t filter;
-	// TODO: investigate 250/256 Hz (Fs=8 kHz, aliasing?)
-	if (mpu_dev->mpu_type == PIOS_MPU6500 || mpu_dev->mpu_type == PIOS_MPU9250) {
+	uint16_t internal_rate = 1000;
+
+	if (mpu_dev->fifo_batch && bandwidth >= 250) {
+		/* The widest filters sample at 8 kHz.  Only worth it when
+		 * the FIFO batches the samples up; otherwise there'd be an
+		 * interrupt and a transfer for each. */
+		if (mpu_dev->mpu_type == PIOS_MPU6500 || mpu_dev->mpu_type == PIOS_MPU9250)
+			filter = PIOS_MPU6500_GYRO_LOWPASS_250_HZ;
+		else if ((mpu_dev->mpu_type == PIOS_MPU60X0) ||
+				(mpu_dev->mpu_type == PIOS_MPU9150))
+			filter = PIOS_MPU60X0_GYRO_LOWPASS_256_HZ;
+		else
+			filter = PIOS_ICM20608G_GYRO_LOWPASS_250_HZ;
+
+		internal_rate = 8000;
+	} else if (mpu_dev->mpu_type == PIOS_MPU6500 || mpu_dev->mpu_type == PIOS_MPU9250) {
 		if (bandwidth <= 5)
 			filter = PIOS_MPU6500_GYRO_LOWPASS_5_HZ;
 		else if (bandwidth <= 10)
@@ -678,6 +788,14 @@ void PIOS_MPU_SetGyroBandwidth(uint16_t bandwidth)
 	}
 
 	PIOS_MPU_WriteReg(PIOS_MPU_DLPF_CFG_REG, filter);
+
+	if (internal_rate != mpu_dev->internal_rate) {
+		mpu_dev->internal_rate = internal_rate;
+
+		/* The divisor is relative to the internal rate */
+		if (mpu_dev->sample_rate)
+			PIOS_MPU_SetSampleRate(mpu_dev->sample_rate);
+	}
 }
 
 void PIOS_MPU_SetAccelBandwidth(uint16_t bandwidth)
@@ -723,15 +841,20 @@ void PIOS_MPU_SetAccelBandwidth(uint16_t bandwidth)
 
 int32_t PIOS_MPU_SetSampleRate(uint16_t samplerate_hz)
 {
-	// TODO: think about supporting >1 khz, aliasing/noise issues though..
-	uint16_t internal_rate = 1000;
+	mpu_dev->sample_rate = samplerate_hz;
+
+	uint16_t internal_rate = mpu_dev->internal_rate;
+
+	// With the FIFO, sample a batch's worth faster and read it at once
+	uint8_t batch = mpu_dev->fifo_batch ? mpu_dev->fifo_batch : 1;
+	uint32_t chip_rate = (uint32_t)samplerate_hz * batch;
 
 	// limit samplerate to filter frequency
-	if (samplerate_hz > internal_rate)
-		samplerate_hz = internal_rate;
+	if (chip_rate > internal_rate)
+		chip_rate = internal_rate;
 
 	// calculate divisor, round to nearest integer
-	int32_t divisor = (int32_t)(((float)internal_rate / samplerate_hz) + 0.5f) - 1;
+	int32_t divisor = (int32_t)(((float)internal_rate / chip_rate) + 0.5f) - 1;
 
 	// limit resulting divisor to register value range
 	if (divisor < 0)
@@ -740,14 +863,24 @@ int32_t PIOS_MPU_SetSampleRate(uint16_t samplerate_hz)
 	if (divisor > 0xff)
 		divisor = 0xff;
 
+	// the MPU-6500 family ignores the divisor with the filter bypassed
+	if (internal_rate > 1000 && mpu_dev->mpu_type != PIOS_MPU60X0 &&
+			mpu_dev->mpu_type != PIOS_MPU9150)
+		divisor = 0;
+
 	// calculate true sample rate
-	samplerate_hz = internal_rate / (1 + divisor);
+	chip_rate = internal_rate / (1 + divisor);
+	samplerate_hz = chip_rate / batch;
 
 	int32_t retval = PIOS_MPU_WriteReg(PIOS_MPU_SMPLRT_DIV_REG, (uint8_t)divisor);
 
 	if (retval == 0) {
+		mpu_dev->fifo_interval_us = 1000000 / chip_rate;
+
 		PIOS_SENSORS_SetSampleRate(PIOS_SENSOR_ACCEL, samplerate_hz);
 		PIOS_SENSORS_SetSampleRate(PIOS_SENSOR_GYRO, samplerate_hz);
+		PIOS_SENSORS_SetBatchSize(PIOS_SENSOR_ACCEL, batch);
+		PIOS_SENSORS_SetBatchSize(PIOS_SENSOR_GYRO, batch);
 #ifdef PIOS_INCLUDE_MPU_MAG
 		if (mpu_dev->use_mag) {
 			if (mpu_dev->mpu_type == PIOS_MPU9150) {
@@ -974,6 +1107,40 @@ static int32_t PIOS_MPU_ReadReg(uint8_t reg)
 		return data;
 }
 
+/**
+ * @brief Reads consecutive registers, or len bytes of the FIFO, at once
+ * @return 0 if successful
+ */
+static int32_t PIOS_MPU_ReadBurst(uint8_t reg, uint8_t *buffer, uint16_t len)
+{
+#if defined(PIOS_INCLUDE_I2C)
+	if (mpu_dev->com_driver_type == PIOS_MPU_COM_I2C) {
+		if (len > 0xff)
+			return -1;
+
+		return (PIOS_MPU_I2C_Read(reg, buffer, len) < 0) ? -1 : 0;
+	}
+#endif // defined(PIOS_INCLUDE_I2C)
+#if defined(PIOS_INCLUDE_SPI)
+	if (mpu_dev->com_driver_type == PIOS_MPU_COM_SPI) {
+		// claim bus in high speed mode
+		if (PIOS_MPU_ClaimBus(false) != 0)
+			return -1;
+
+		PIOS_SPI_TransferByte(mpu_dev->spi_driver_id, 0x80 | reg);
+
+		int32_t retval = PIOS_SPI_TransferBlock(mpu_dev->spi_driver_id,
+				NULL, buffer, len);
+
+		PIOS_MPU_ReleaseBus(false);
+
+		return (retval < 0) ? -1 : 0;
+	}
+#endif // defined(PIOS_INCLUDE_SPI)
+
+	return -1;
+}
+
 bool PIOS_MPU_IRQHandler(void)
 {
 	if (PIOS_MPU_Validate(mpu_dev) != 0)
@@ -983,11 +1150,120 @@ bool PIOS_MPU_IRQHandler(void)
 
 	mpu_dev->interrupt_count++;
 
+	if (mpu_dev->fifo_batch) {
+		mpu_dev->last_sample_raw = PIOS_DELAY_GetRaw();
+
+		/* Only wake the reader once a batch is waiting */
+		if (++mpu_dev->fifo_pending < mpu_dev->fifo_batch)
+			return false;
+
+		mpu_dev->fifo_pending = 0;
+	}
+
 	PIOS_Semaphore_Give_FromISR(mpu_dev->data_ready_sema, &woken);
 
 	return woken;
 }
 
+/**
+ * @brief Scales and rotates one sample, laid out as in the data registers
+ * and in each FIFO record: accel, temperature then gyro, big-endian.
+ */
+static void PIOS_MPU_convert(const uint8_t *raw, float accel_scale,
+		float gyro_scale, struct pios_sensor_accel_data *accel_data,
+		struct pios_sensor_gyro_data *gyro_data)
+{
+	float accel_x = (int16_t)(raw[0] << 8 | raw[1]) * accel_scale;
+	float accel_y = (int16_t)(raw[2] << 8 | raw[3]) * accel_scale;
+	float accel_z = (int16_t)(raw[4] << 8 | raw[5]) * accel_scale;
+	int16_t raw_temp = (int16_t)(raw[6] << 8 | raw[7]);
+	float gyro_x  = (int16_t)(raw[8] << 8 | raw[9]) * gyro_scale;
+	float gyro_y  = (int16_t)(raw[10] << 8 | raw[11]) * gyro_scale;
+	float gyro_z  = (int16_t)(raw[12] << 8 | raw[13]) * gyro_scale;
+
+	/*
+	 * Rotate the sensor to our convention (x forward, y right, z down).
+	 * Sensor orientation for all supported Invensense variants is
+	 * x right, y forward, z up.
+	 * See flight/Doc/imu_orientation.md for further detail
+	 */
+	switch (mpu_dev->cfg->orientation) {
+	case PIOS_MPU_TOP_0DEG:
+		accel_data->x =  accel_y;
+		accel_data->y =  accel_x;
+		accel_data->z = -accel_z;
+		gyro_data->x  =  gyro_y;
+		gyro_data->y  =  gyro_x;
+		gyro_data->z  = -gyro_z;
+		break;
+	case PIOS_MPU_TOP_90DEG:
+		accel_data->x = -accel_x;
+		accel_data->y =  accel_y;
+		accel_data->z = -accel_z;
+		gyro_data->x  = -gyro_x;
+		gyro_data->y  =  gyro_y;
+		gyro_data->z  = -gyro_z;
+		break;
+	case PIOS_MPU_TOP_180DEG:
+		accel_data->x = -accel_y;
+		accel_data->y = -accel_x;
+		accel_data->z = -accel_z;
+		gyro_data->x  = -gyro_y;
+		gyro_data->y  = -gyro_x;
+		gyro_data->z  = -gyro_z;
+		break;
+	case PIOS_MPU_TOP_270DEG:
+		accel_data->x =  accel_x;
+		accel_data->y = -accel_y;
+		accel_data->z = -accel_z;
+		gyro_data->x  =  gyro_x;
+		gyro_data->y  = -gyro_y;
+		gyro_data->z  = -gyro_z;
+		break;
+	case PIOS_MPU_BOTTOM_0DEG:
+		accel_data->x =  accel_y;
+		accel_data->y = -accel_x;
+		accel_data->z =  accel_z;
+		gyro_data->x  =  gyro_y;
+		gyro_data->y  = -gyro_x;
+		gyro_data->z  =  gyro_z;
+		break;
+	case PIOS_MPU_BOTTOM_90DEG:
+		accel_data->x =  accel_x;
+		accel_data->y =  accel_y;
+		accel_data->z =  accel_z;
+		gyro_data->x  =  gyro_x;
+		gyro_data->y  =  gyro_y;
+		gyro_data->z  =  gyro_z;
+		break;
+	case PIOS_MPU_BOTTOM_180DEG:
+		accel_data->x = -accel_y;
+		accel_data->y =  accel_x;
+		accel_data->z =  accel_z;
+		gyro_data->x  = -gyro_y;
+		gyro_data->y  =  gyro_x;
+		gyro_data->z  =  gyro_z;
+		break;
+	case PIOS_MPU_BOTTOM_270DEG:
+		accel_data->x = -accel_x;
+		accel_data->y = -accel_y;
+		accel_data->z =  accel_z;
+		gyro_data->x  = -gyro_x;
+		gyro_data->y  = -gyro_y;
+		gyro_data->z  =  gyro_z;
+		break;
+	}
+
+	float temperature;
+	if (mpu_dev->mpu_type == PIOS_MPU6500 || mpu_dev->mpu_type == PIOS_MPU9250)
+		temperature = 21.0f + ((float)raw_temp) / 333.87f;
+	else
+		temperature = 35.0f + ((float)raw_temp + 512.0f) / 340.0f;
+
+	gyro_data->temperature = temperature;
+	accel_data->temperature = temperature;
+}
+
 /**
  * @brief Tries to read out the IMU.
  *
@@ -1077,162 +1353,63 @@ static int PIOS_MPU_parse_data(struct pios_mpu_dev *p)
 	}
 #endif // defined(PIOS_INCLUDE_I2C)
 
-	float accel_x = (int16_t)(mpu_rec_buf[IDX_ACCEL_XOUT_H] << 8 | mpu_rec_buf[IDX_ACCEL_XOUT_L]);
-	float accel_y = (int16_t)(mpu_rec_buf[IDX_ACCEL_YOUT_H] << 8 | mpu_rec_buf[IDX_ACCEL_YOUT_L]);
-	float accel_z = (int16_t)(mpu_rec_buf[IDX_ACCEL_ZOUT_H] << 8 | mpu_rec_buf[IDX_ACCEL_ZOUT_L]);
-	float gyro_x  = (int16_t)(mpu_rec_buf[IDX_GYRO_XOUT_H]  << 8 | mpu_rec_buf[IDX_GYRO_XOUT_L]);
-	float gyro_y  = (int16_t)(mpu_rec_buf[IDX_GYRO_YOUT_H]  << 8 | mpu_rec_buf[IDX_GYRO_YOUT_L]);
-	float gyro_z  = (int16_t)(mpu_rec_buf[IDX_GYRO_ZOUT_H]  << 8 | mpu_rec_buf[IDX_GYRO_ZOUT_L]);
-
-	// Apply sensor scaling
-	float accel_scale = PIOS_MPU_GetAccelScale();
-	float gyro_scale = PIOS_MPU_GetGyroScale();
-
-	accel_x *= accel_scale;
-	accel_y *= accel_scale;
-	accel_z *= accel_scale;
-
-	gyro_x *= gyro_scale;
-	gyro_y *= gyro_scale;
-	gyro_z *= gyro_scale;
-
-#ifdef PIOS_INCLUDE_MPU_MAG
-	float mag_x = (int16_t)(mpu_rec_buf[IDX_MAG_XOUT_H] << 8 | mpu_rec_buf[IDX_MAG_XOUT_L]);
-	float mag_y = (int16_t)(mpu_rec_buf[IDX_MAG_YOUT_H] << 8 | mpu_rec_buf[IDX_MAG_YOUT_L]);
-	float mag_z = (int16_t)(mpu_rec_buf[IDX_MAG_ZOUT_H] << 8 | mpu_rec_buf[IDX_MAG_ZOUT_L]);
-
-	struct pios_sensor_mag_data *mag_data = &mpu_dev->mag_data;
-#endif // PIOS_INCLUDE_MPU_MAG
-
-	struct pios_sensor_gyro_data *gyro_data = &mpu_dev->gyro_data;
-	struct pios_sensor_accel_data *accel_data = &mpu_dev->accel_data;
-
-	/*
-	 * Rotate the sensor to our convention (x forward, y right, z down).
-	 * Sensor orientation for all supported Invensense variants is
-	 * x right, y forward, z up.
-	 * The embedded AK8xxx magnetometer in MPU9x50 variants matches our convention.
-	 * See flight/Doc/imu_orientation.md for further detail
-	 */
-	switch (mpu_dev->cfg->orientation) {
-	case PIOS_MPU_TOP_0DEG:
-		accel_data->x =  accel_y;
-		accel_data->y =  accel_x;
-		accel_data->z = -accel_z;
-		gyro_data->x  =  gyro_y;
-		gyro_data->y  =  gyro_x;
-		gyro_data->z  = -gyro_z;
-#ifdef PIOS_INCLUDE_MPU_MAG
-		mag_data->x   =  mag_x;
-		mag_data->y   =  mag_y;
-		mag_data->z   =  mag_z;
-#endif // PIOS_INCLUDE_MPU_MAG
-		break;
-	case PIOS_MPU_TOP_90DEG:
-		accel_data->x = -accel_x;
-		accel_data->y =  accel_y;
-		accel_data->z = -accel_z;
-		gyro_data->x  = -gyro_x;
-		gyro_data->y  =  gyro_y;
-		gyro_data->z  = -gyro_z;
-#ifdef PIOS_INCLUDE_MPU_MAG
-		mag_data->x   = -mag_y;
-		mag_data->y   =  mag_x;
-		mag_data->z   =  mag_z;
-#endif // PIOS_INCLUDE_MPU_MAG
-		break;
-	case PIOS_MPU_TOP_180DEG:
-		accel_data->x = -accel_y;
-		accel_data->y = -accel_x;
-		accel_data->z = -accel_z;
-		gyro_data->x  = -gyro_y;
-		gyro_data->y  = -gyro_x;
-		gyro_data->z  = -gyro_z;
-#ifdef PIOS_INCLUDE_MPU_MAG
-		mag_data->x   = -mag_x;
-		mag_data->y   = -mag_y;
-		mag_data->z   =  mag_z;
-#endif // PIOS_INCLUDE_MPU_MAG
-		break;
-	case PIOS_MPU_TOP_270DEG:
-		accel_data->x =  accel_x;
-		accel_data->y = -accel_y;
-		accel_data->z = -accel_z;
-		gyro_data->x  =  gyro_x;
-		gyro_data->y  = -gyro_y;
-		gyro_data->z  = -gyro_z;
-#ifdef PIOS_INCLUDE_MPU_MAG
-		mag_data->x   =  mag_y;
-		mag_data->y   = -mag_x;
-		mag_data->z   =  mag_z;
-#endif // PIOS_INCLUDE_MPU_MAG
-		break;
-	case PIOS_MPU_BOTTOM_0DEG:
-		accel_data->x =  accel_y;
-		accel_data->y = -accel_x;
-		accel_data->z =  accel_z;
-		gyro_data->x  =  gyro_y;
-		gyro_data->y  = -gyro_x;
-		gyro_data->z  =  gyro_z;
-#ifdef PIOS_INCLUDE_MPU_MAG
-		mag_data->x   =  mag_x;
-		mag_data->y   = -mag_y;
-		mag_data->z   = -mag_z;
-#endif // PIOS_INCLUDE_MPU_MAG
-		break;
-
-	case PIOS_MPU_BOTTOM_90DEG:
-		accel_data->x =  accel_x;
-		accel_data->y =  accel_y;
-		accel_data->z =  accel_z;
-		gyro_data->x  =  gyro_x;
-		gyro_data->y  =  gyro_y;
-		gyro_data->z  =  gyro_z;
-#ifdef PIOS_INCLUDE_MPU_MAG
-		mag_data->x   =  mag_y;
-		mag_data->y   =  mag_x;
-		mag_data->z   = -mag_z;
-#endif // PIOS_INCLUDE_MPU_MAG
-		break;
-
-	case PIOS_MPU_BOTTOM_180DEG:
-		accel_data->x = -accel_y;
-		accel_data->y =  accel_x;
-		accel_data->z =  accel_z;
-		gyro_data->x  = -gyro_y;
-		gyro_data->y  =  gyro_x;
-		gyro_data->z  =  gyro_z;
-#ifdef PIOS_INCLUDE_MPU_MAG
-		mag_data->x   = -mag_x;
-		mag_data->y   =  mag_y;
-		mag_data->z   = -mag_z;
-#endif // PIOS_INCLUDE_MPU_MAG
-		break;
+	PIOS_MPU_convert(&mpu_rec_buf[IDX_ACCEL_XOUT_H],
+			PIOS_MPU_GetAccelScale(), PIOS_MPU_GetGyroScale(),
+			&mpu_dev->accel_data, &mpu_dev->gyro_data);
 
-	case PIOS_MPU_BOTTOM_270DEG:
-		accel_data->x = -accel_x;
-		accel_data->y = -accel_y;
-		accel_data->z =  accel_z;
-		gyro_data->x  = -gyro_x;
-		gyro_data->y  = -gyro_y;
-		gyro_data->z  =  gyro_z;
 #ifdef PIOS_INCLUDE_MPU_MAG
-		mag_data->x   = -mag_y;
-		mag_data->y   = -mag_x;
-		mag_data->z   = -mag_z;
-#endif // PIOS_INCLUDE_MPU_MAG
-		break;
+	if (mpu_dev->use_mag) {
+		float mag_x = (int16_t)(mpu_rec_buf[IDX_MAG_XOUT_H] << 8 | mpu_rec_buf[IDX_MAG_XOUT_L]);
+		float mag_y = (int16_t)(mpu_rec_buf[IDX_MAG_YOUT_H] << 8 | mpu_rec_buf[IDX_MAG_YOUT_L]);
+		float mag_z = (int16_t)(mpu_rec_buf[IDX_MAG_ZOUT_H] << 8 | mpu_rec_buf[IDX_MAG_ZOUT_L]);
+
+		struct pios_sensor_mag_data *mag_data = &mpu_dev->mag_data;
+
+		/* The embedded AK8xxx magnetometer in MPU9x50 variants matches our convention. */
+		switch (mpu_dev->cfg->orientation) {
+		case PIOS_MPU_TOP_0DEG:
+			mag_data->x   =  mag_x;
+			mag_data->y   =  mag_y;
+			mag_data->z   =  mag_z;
+			break;
+		case PIOS_MPU_TOP_90DEG:
+			mag_data->x   = -mag_y;
+			mag_data->y   =  mag_x;
+			mag_data->z   =  mag_z;
+			break;
+		case PIOS_MPU_TOP_180DEG:
+			mag_data->x   = -mag_x;
+			mag_data->y   = -mag_y;
+			mag_data->z   =  mag_z;
+			break;
+		case PIOS_MPU_TOP_270DEG:
+			mag_data->x   =  mag_y;
+			mag_data->y   = -mag_x;
+			mag_data->z   =  mag_z;
+			break;
+		case PIOS_MPU_BOTTOM_0DEG:
+			mag_data->x   =  mag_x;
+			mag_data->y   = -mag_y;
+			mag_data->z   = -mag_z;
+			break;
+		case PIOS_MPU_BOTTOM_90DEG:
+			mag_data->x   =  mag_y;
+			mag_data->y   =  mag_x;
+			mag_data->z   = -mag_z;
+			break;
+		case PIOS_MPU_BOTTOM_180DEG:
+			mag_data->x   = -mag_x;
+			mag_data->y   =  mag_y;
+			mag_data->z   = -mag_z;
+			break;
+		case PIOS_MPU_BOTTOM_270DEG:
+			mag_data->x   = -mag_y;
+			mag_data->y   = -mag_x;
+			mag_data->z   = -mag_z;
+			break;
+		}
 	}
-
-	int16_t raw_temp = (int16_t)(mpu_rec_buf[IDX_TEMP_OUT_H] << 8 | mpu_rec_buf[IDX_TEMP_OUT_L]);
-	float temperature;
-	if (mpu_dev->mpu_type == PIOS_MPU6500 || mpu_dev->mpu_type == PIOS_MPU9250)
-		temperature = 21.0f + ((float)raw_temp) / 333.87f;
-	else
-		temperature = 35.0f + ((float)raw_temp + 512.0f) / 340.0f;
-
-	gyro_data->temperature = temperature;
-	accel_data->temperature = temperature;
+#endif // PIOS_INCLUDE_MPU_MAG
 
 	mpu_dev->sensor_ready |= SENSOR_ACCEL;
 
@@ -1277,6 +1454,69 @@ static int PIOS_MPU_parse_data(struct pios_mpu_dev *p)
 	return 0;
 }
 
+/**
+ * @brief Drains up to a batch of samples from the FIFO.
+ *
+ * @return Zero on success.
+ */
+static int PIOS_MPU_read_fifo(struct pios_mpu_dev *p,
+		struct pios_sensor_imu_batch *batch)
+{
+	uint8_t count_buf[2];
+
+	if (PIOS_MPU_ReadBurst(PIOS_MPU_FIFO_CNT_MSB, count_buf,
+				sizeof(count_buf)) != 0)
+		return -1;
+
+	uint32_t last_sample_raw = p->last_sample_raw;
+	uint16_t fifo_bytes = count_buf[0] << 8 | count_buf[1];
+
+	/* Once the FIFO has overflowed the oldest record has been partly
+	 * overwritten and nothing after it is aligned; start over.
+	 */
+	if ((fifo_bytes % FIFO_RECORD_SIZE) || (fifo_bytes >= FIFO_MIN_SIZE)) {
+		PIOS_MPU_ResetFIFO();
+		return -1;
+	}
+
+	uint16_t available = fifo_bytes / FIFO_RECORD_SIZE;
+	uint8_t count = MIN(available, PIOS_SENSORS_BATCH_MAX);
+
+	if (!count)
+		return -1;
+
+	if (PIOS_MPU_ReadBurst(PIOS_MPU_FIFO_REG, p->fifo_buf,
+				count * FIFO_RECORD_SIZE) != 0)
+		return -1;
+
+	float accel_scale = PIOS_MPU_GetAccelScale();
+	float gyro_scale = PIOS_MPU_GetGyroScale();
+
+	for (int i = 0; i < count; i++) {
+		PIOS_MPU_convert(&p->fifo_buf[i * FIFO_RECORD_SIZE],
+				accel_scale, gyro_scale,
+				&batch->accel[i], &batch->gyro[i]);
+	}
+
+	batch->count = count;
+	batch->has_accel = true;
+	batch->interval_us = p->fifo_interval_us;
+
+	/* Whatever is left in the FIFO came after the last one read */
+	batch->timestamp = last_sample_raw;
+	batch->lag_us = (available - count) * p->fifo_interval_us;
+
+	p->gyro_data = batch->gyro[count - 1];
+	p->accel_data = batch->accel[count - 1];
+	p->sensor_ready |= SENSOR_ACCEL;
+
+	/* Come straight back for the rest */
+	if (available > count)
+		PIOS_Semaphore_Give(p->data_ready_sema);
+
+	return 0;
+}
+
 #endif // PIOS_INCLUDE_MPU
 
 /**
@@ -122,6 +122,9 @@ bool PIOS_Queue_Send(struct pios_queue *queuep, const void *itemp, uint32_t time
 		return false;
 	}
 
+	PIOS_TRACE(PIOS_TRACE_MASK_QUEUE, PIOS_TRACE_QUEUE_SEND,
+			(uintptr_t) queuep);
+
 	return true;
 }
 
@@ -159,6 +162,9 @@ bool PIOS_Queue_Send_FromISR(struct pios_queue *queuep, const void *itemp, bool
 
 	chSysUnlockFromIsr();
 
+	PIOS_TRACE(PIOS_TRACE_MASK_QUEUE, PIOS_TRACE_QUEUE_SEND,
+			(uintptr_t) queuep);
+
 	return true;
 }
 
@@ -194,6 +200,9 @@ bool PIOS_Queue_Receive(struct pios_queue *queuep, void *itemp, uint32_t timeout
 
 	chPoolFree(&queuep->mp, (void*)buf);
 
+	PIOS_TRACE(PIOS_TRACE_MASK_QUEUE, PIOS_TRACE_QUEUE_RECEIVE,
+			(uintptr_t) queuep);
+
 	return true;
 }
 
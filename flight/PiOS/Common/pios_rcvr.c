@@ -37,6 +37,10 @@ static struct pios_rcvr_dev * PIOS_RCVR_alloc(void)
 static struct pios_semaphore *rcvr_activity;
 static uint32_t rcvr_last_wake;
 
+/* Arrival of the most recent complete frame, from any receiver */
+static volatile uint32_t rcvr_frame_time;
+static volatile uint32_t rcvr_frame_count;
+
 /**
   * Initialises RCVR layer
   * \param[out] handle
@@ -118,17 +122,102 @@ int32_t PIOS_RCVR_Read(uintptr_t rcvr_id, uint8_t channel)
   return rcvr_dev->driver->read(rcvr_dev->lower_id, channel);
 }
 
+/**
+ * @brief Reads the first channels of the last frame from a driver at once
+ * @param[in] rcvr_id driver to read from
+ * @param[out] channels values of channels 1 to num_channels; anything the
+ * driver does not have is PIOS_RCVR_INVALID, and on error every channel
+ * holds the error code
+ * @param[in] num_channels how many channels to read
+ * @returns number of channels the driver provided, or a negative error code
+ *
+ * Drivers which can copy out a whole frame do so in one go, so the values
+ * are all from the same frame.  Otherwise the channels are read one by one.
+ */
+int32_t PIOS_RCVR_ReadFrame(uintptr_t rcvr_id, int16_t *channels, uint8_t num_channels)
+{
+  if (rcvr_id == 0) {
+    for (int i = 0; i < num_channels; i++)
+      channels[i] = PIOS_RCVR_NODRIVER;
+
+    return PIOS_RCVR_NODRIVER;
+  }
+
+  struct pios_rcvr_dev * rcvr_dev = (struct pios_rcvr_dev *)rcvr_id;
+
+  if (!PIOS_RCVR_validate(rcvr_dev)) {
+    /* Undefined RCVR port for this board (see pios_board.c) */
+    PIOS_Assert(0);
+  }
+
+  int32_t got;
+
+  if (rcvr_dev->driver->read_frame) {
+    got = rcvr_dev->driver->read_frame(rcvr_dev->lower_id, channels, num_channels);
+
+    if (got < 0) {
+      /* As each channel would have read */
+      for (int i = 0; i < num_channels; i++)
+        channels[i] = got;
+
+      return got;
+    }
+  } else {
+    got = num_channels;
+
+    for (int i = 0; i < num_channels; i++)
+      channels[i] = rcvr_dev->driver->read(rcvr_dev->lower_id, i);
+  }
+
+  for (int i = got; i < num_channels; i++)
+    channels[i] = PIOS_RCVR_INVALID;
+
+  return got;
+}
+
+/**
+ * @brief Gets when the most recent complete frame arrived
+ * @param[out] frame_raw arrival time, in PIOS_DELAY_GetRaw() units
+ * @returns number of frames signalled so far, to tell whether there is a
+ * new one since last time
+ */
+uint32_t PIOS_RCVR_GetFrameTime(uint32_t *frame_raw)
+{
+  PIOS_IRQ_Disable();
+  uint32_t count = rcvr_frame_count;
+  *frame_raw = rcvr_frame_time;
+  PIOS_IRQ_Enable();
+
+  return count;
+}
+
 #define MIN_WAKE_INTERVAL_uS 4000	/* 250Hz ought to be enough for anyone*/
 
+/**
+ * @brief Waits for a receiver to signal a complete frame
+ * @param[in] timeout_ms longest to wait
+ * @returns true if woken by a frame, false on timeout
+ *
+ * Frames arriving more often than MIN_WAKE_INTERVAL_uS are coalesced: the
+ * wake is held back until the interval has passed, rather than dropped
+ * until the timeout, and the newest frame is read then.
+ */
 bool PIOS_RCVR_WaitActivity(uint32_t timeout_ms) {
   if (rcvr_activity) {
     bool result = PIOS_Semaphore_Take(rcvr_activity, timeout_ms);
-    if(!result) {
-      // If the semaphore times out, update last wake, to try to avoid
-      // resonance due to jitter, when the update rate of the receiver
-      // matches the timeout.
-      rcvr_last_wake = PIOS_DELAY_GetRaw();
+
+    if (result) {
+      uint32_t since = PIOS_DELAY_DiffuS(rcvr_last_wake);
+
+      if (since < MIN_WAKE_INTERVAL_uS) {
+        PIOS_Thread_Sleep((MIN_WAKE_INTERVAL_uS - since + 999) / 1000);
+      }
     }
+
+    // Updated on timeouts too, so a frame arriving just after one is
+    // held back, rather than being processed twice in a row.
+    rcvr_last_wake = PIOS_DELAY_GetRaw();
+
     return result;
   } else {
     PIOS_Thread_Sleep(timeout_ms);
@@ -137,12 +226,17 @@ bool PIOS_RCVR_WaitActivity(uint32_t timeout_ms) {
   }
 }
 
+/**
+ * @brief Signals that a receiver has a complete new frame, from task context
+ */
 void PIOS_RCVR_Active() {
-  if (PIOS_DELAY_DiffuS(rcvr_last_wake) >= MIN_WAKE_INTERVAL_uS) {
-    if (rcvr_activity) {
-      rcvr_last_wake = PIOS_DELAY_GetRaw();
-      PIOS_Semaphore_Give(rcvr_activity);
-    }
+  PIOS_IRQ_Disable();
+  rcvr_frame_time = PIOS_DELAY_GetRaw();
+  rcvr_frame_count++;
+  PIOS_IRQ_Enable();
+
+  if (rcvr_activity) {
+    PIOS_Semaphore_Give(rcvr_activity);
   }
 #ifdef FLIGHT_POSIX
   if (PIOS_Thread_FakeClock_IsActive()) {
@@ -151,14 +245,17 @@ void PIOS_RCVR_Active() {
 #endif
 }
 
+/**
+ * @brief Signals that a receiver has a complete new frame, from an ISR
+ */
 void PIOS_RCVR_ActiveFromISR() {
-  if (PIOS_DELAY_DiffuS(rcvr_last_wake) >= MIN_WAKE_INTERVAL_uS) {
+  rcvr_frame_time = PIOS_DELAY_GetRaw();
+  rcvr_frame_count++;
+
+  if (rcvr_activity) {
     bool dont_care;
 
-    if (rcvr_activity) {
-      rcvr_last_wake = PIOS_DELAY_GetRaw();
-      PIOS_Semaphore_Give_FromISR(rcvr_activity, &dont_care);
-    }
+    PIOS_Semaphore_Give_FromISR(rcvr_activity, &dont_care);
   }
 }
 
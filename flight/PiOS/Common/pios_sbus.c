@@ -36,6 +36,7 @@
 
 /* Forward Declarations */
 static int32_t PIOS_SBus_Get(uintptr_t rcvr_id, uint8_t channel);
+static int32_t PIOS_SBus_GetFrame(uintptr_t rcvr_id, int16_t *channels, uint8_t num_channels);
 static uint16_t PIOS_SBus_RxInCallback(uintptr_t context,
 				       uint8_t *buf,
 				       uint16_t buf_len,
@@ -47,6 +48,7 @@ static void PIOS_SBus_Supervisor(uintptr_t sbus_id);
 /* Local Variables */
 const struct pios_rcvr_driver pios_sbus_rcvr_driver = {
 	.read = PIOS_SBus_Get,
+	.read_frame = PIOS_SBus_GetFrame,
 };
 
 enum pios_sbus_dev_magic {
@@ -150,6 +152,31 @@ static int32_t PIOS_SBus_Get(uintptr_t rcvr_id, uint8_t channel)
 	return sbus_dev->state.channel_data[channel];
 }
 
+/**
+ * Get the first channels of the last frame, all from the same frame
+ * \param[out] channels channel values, as PIOS_SBus_Get() would return
+ * \param[in] num_channels number of channels wanted
+ * \output PIOS_RCVR_INVALID invalid device
+ * \output >=0 number of channels provided
+ */
+static int32_t PIOS_SBus_GetFrame(uintptr_t rcvr_id, int16_t *channels, uint8_t num_channels)
+{
+	struct pios_sbus_dev *sbus_dev = (struct pios_sbus_dev *)rcvr_id;
+
+	if (!PIOS_SBus_Validate(sbus_dev))
+		return PIOS_RCVR_INVALID;
+
+	if (num_channels > PIOS_SBUS_NUM_INPUTS)
+		num_channels = PIOS_SBUS_NUM_INPUTS;
+
+	PIOS_IRQ_Disable();
+	for (int i = 0; i < num_channels; i++)
+		channels[i] = sbus_dev->state.channel_data[i];
+	PIOS_IRQ_Enable();
+
+	return num_channels;
+}
+
 /**
  * Compute channel_data[] from received_data[].
  * For efficiency it unrolls first 8 channels without loops and does the
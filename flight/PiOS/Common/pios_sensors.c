@@ -42,8 +42,14 @@ static struct PIOS_Sensor {
 
 	uint32_t next_time;
 
+	/* Where GetData unpacks a batch to pick out the newest sample */
+	struct pios_sensor_imu_batch *batch_buf;
+
 	uint16_t sample_rate;
-	uint16_t missing : 1;
+	uint8_t batch_size;
+	uint8_t missing : 1;
+	uint8_t batched : 1;	/* getdata_cb fills a pios_sensor_imu_batch */
+	uint8_t calibrated : 1;	/* samples are already scaled, filtered, rotated */
 } sensors[PIOS_SENSOR_NUM];
 
 static int32_t max_gyro_rate;
@@ -75,6 +81,8 @@ int32_t PIOS_SENSORS_RegisterCallback(enum pios_sensor_type type,
 	sensor->getdata_ctx = ctx;
 	sensor->getdata_cb = callback;
 	sensor->missing = 0;
+	sensor->batched = 0;
+	sensor->calibrated = 0;
 
 	return 0;
 }
@@ -85,22 +93,36 @@ int32_t PIOS_SENSORS_Register(enum pios_sensor_type type, struct pios_queue *que
 			PIOS_SENSORS_QueueCallback, queue);
 }
 
-bool PIOS_SENSORS_IsRegistered(enum pios_sensor_type type)
+int32_t PIOS_SENSORS_RegisterBatchCallback(enum pios_sensor_type type,
+		PIOS_SENSOR_Callback_t callback, void *ctx)
 {
-	if (type >= PIOS_SENSOR_NUM) {
-		return false;
-	}
+	/* Batches carry gyro samples, with the accels alongside */
+	PIOS_Assert(type == PIOS_SENSOR_GYRO);
 
 	struct PIOS_Sensor *sensor = &sensors[type];
 
-	if (sensor->missing) {
-		return false;
+	if (!sensor->batch_buf) {
+		sensor->batch_buf = PIOS_malloc(sizeof(*sensor->batch_buf));
+
+		if (!sensor->batch_buf) {
+			return -1;
+		}
 	}
 
-	return sensor->getdata_cb != NULL;
+	int32_t ret = PIOS_SENSORS_RegisterCallback(type, callback, ctx);
+
+	sensor->batched = 1;
+
+	return ret;
 }
 
-bool PIOS_SENSORS_GetData(enum pios_sensor_type type, void *buf, int ms_to_wait)
+int32_t PIOS_SENSORS_RegisterBatch(enum pios_sensor_type type, struct pios_queue *queue)
+{
+	return PIOS_SENSORS_RegisterBatchCallback(type,
+			PIOS_SENSORS_QueueCallback, queue);
+}
+
+bool PIOS_SENSORS_IsRegistered(enum pios_sensor_type type)
 {
 	if (type >= PIOS_SENSOR_NUM) {
 		return false;
@@ -108,10 +130,16 @@ bool PIOS_SENSORS_GetData(enum pios_sensor_type type, void *buf, int ms_to_wait)
 
 	struct PIOS_Sensor *sensor = &sensors[type];
 
-	if (!sensor->getdata_cb) {
+	if (sensor->missing) {
 		return false;
 	}
 
+	return sensor->getdata_cb != NULL;
+}
+
+static bool PIOS_SENSORS_Fetch(struct PIOS_Sensor *sensor, void *buf,
+		int ms_to_wait)
+{
 	if (sensor->next_time) {
 		uint32_t now = PIOS_Thread_Systime();
 		int32_t time_until = sensor->next_time - now;
@@ -159,6 +187,78 @@ bool PIOS_SENSORS_GetData(enum pios_sensor_type type, void *buf, int ms_to_wait)
 	return ret;
 }
 
+bool PIOS_SENSORS_GetData(enum pios_sensor_type type, void *buf, int ms_to_wait)
+{
+	if (type >= PIOS_SENSOR_NUM) {
+		return false;
+	}
+
+	struct PIOS_Sensor *sensor = &sensors[type];
+
+	if (!sensor->getdata_cb) {
+		return false;
+	}
+
+	if (sensor->batched) {
+		/* Only the newest sample is wanted; the rest are dropped */
+		struct pios_sensor_imu_batch *batch = sensor->batch_buf;
+
+		if (!PIOS_SENSORS_Fetch(sensor, batch, ms_to_wait) ||
+				!batch->count) {
+			return false;
+		}
+
+		memcpy(buf, &batch->gyro[batch->count - 1],
+				sizeof(batch->gyro[0]));
+
+		return true;
+	}
+
+	return PIOS_SENSORS_Fetch(sensor, buf, ms_to_wait);
+}
+
+/**
+ * Get the next batch of gyro samples.  Gyros that deliver one sample at a
+ * time give batches of one, timestamped on arrival, with the latest accel
+ * sample if there is a new one.
+ *
+ * @param[in] type must be PIOS_SENSOR_GYRO
+ * @param[out] batch where to put the samples
+ * @param[in] ms_to_wait how long to block for them
+ * @returns true if batch holds at least one sample
+ */
+bool PIOS_SENSORS_GetBatch(enum pios_sensor_type type,
+		struct pios_sensor_imu_batch *batch, int ms_to_wait)
+{
+	if (type != PIOS_SENSOR_GYRO) {
+		return false;
+	}
+
+	struct PIOS_Sensor *sensor = &sensors[type];
+
+	if (!sensor->getdata_cb) {
+		return false;
+	}
+
+	if (sensor->batched) {
+		return PIOS_SENSORS_Fetch(sensor, batch, ms_to_wait) &&
+			batch->count;
+	}
+
+	if (!PIOS_SENSORS_Fetch(sensor, &batch->gyro[0], ms_to_wait)) {
+		return false;
+	}
+
+	batch->timestamp = PIOS_DELAY_GetRaw();
+	batch->lag_us = 0;
+	batch->interval_us = 0;
+	batch->count = 1;
+	batch->has_accel = PIOS_SENSORS_GetData(PIOS_SENSOR_ACCEL,
+			&batch->accel[0], 0);
+
+	return true;
+}
+
 void PIOS_SENSORS_SetMaxGyro(int32_t rate)
 {
 	max_gyro_rate = rate;
@@ -188,6 +288,29 @@ uint32_t PIOS_SENSORS_GetSampleRate(enum pios_sensor_type type)
 	return sensor->sample_rate;
 }
 
+void PIOS_SENSORS_SetBatchSize(enum pios_sensor_type type, uint8_t samples)
+{
+	PIOS_Assert(type < PIOS_SENSOR_NUM);
+	PIOS_Assert(samples <= PIOS_SENSORS_BATCH_MAX);
+
+	struct PIOS_Sensor *sensor = &sensors[type];
+
+	sensor->batch_size = samples;
+}
+
+uint8_t PIOS_SENSORS_GetBatchSize(enum pios_sensor_type type)
+{
+	if (type >= PIOS_SENSOR_NUM)
+		return 1;
+
+	struct PIOS_Sensor *sensor = &sensors[type];
+
+	if (!sensor->batch_size)
+		return 1;
+
+	return sensor->batch_size;
+}
+
 void PIOS_SENSORS_SetMissing(enum pios_sensor_type type)
 {
 	PIOS_Assert(type < PIOS_SENSOR_NUM);
@@ -205,3 +328,21 @@ bool PIOS_SENSORS_GetMissing(enum pios_sensor_type type)
 
 	return sensor->missing;
 }
+
+void PIOS_SENSORS_SetCalibrated(enum pios_sensor_type type)
+{
+	PIOS_Assert(type < PIOS_SENSOR_NUM);
+
+	struct PIOS_Sensor *sensor = &sensors[type];
+
+	sensor->calibrated = true;
+}
+
+bool PIOS_SENSORS_GetCalibrated(enum pios_sensor_type type)
+{
+	PIOS_Assert(type < PIOS_SENSOR_NUM);
+
+	struct PIOS_Sensor *sensor = &sensors[type];
+
+	return sensor->calibrated;
+}
@@ -92,6 +92,9 @@ struct pios_thread *PIOS_Thread_WrapCurrentThread(const char *namep)
 #if CH_USE_REGISTRY
 		thread->threadp->p_name = namep;
 #endif /* CH_USE_REGISTRY */
+#if defined(PIOS_INCLUDE_TRACE)
+		PIOS_Trace_AddTask((uintptr_t) thread->threadp, namep);
+#endif
 	}
 
 	return thread;
@@ -146,6 +149,9 @@ struct pios_thread *PIOS_Thread_Create(void (*fp)(void *), const char *namep, si
 #if CH_USE_REGISTRY
 	thread->threadp->p_name = namep;
 #endif /* CH_USE_REGISTRY */
+#if defined(PIOS_INCLUDE_TRACE)
+	PIOS_Trace_AddTask((uintptr_t) thread->threadp, namep);
+#endif
 
 	return thread;
 }
@@ -316,4 +322,20 @@ void PIOS_Thread_Scheduler_Resume(void)
 	chSysUnlock();
 }
 
+/**
+ *
+ * @brief   Called by the kernel just before switching threads.
+ *
+ * @param[in] thread       the ChibiOS thread being switched to
+ *
+ */
+void PIOS_Thread_Switch_Hook(const void *thread)
+{
+#if defined(PIOS_INCLUDE_TRACE)
+	PIOS_Trace_Switch(thread);
+#else
+	(void) thread;
+#endif
+}
+
 #endif /* defined(PIOS_INCLUDE_CHIBIOS) */
@@ -0,0 +1,675 @@
+/**
+ ******************************************************************************
+ * @file       pios_tlsf.c
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup PIOS PIOS Core hardware abstraction layer
+ * @{
+ * @addtogroup PIOS_HEAP Heap Allocation Abstraction
+ * @{
+ * @brief Two-level segregated fit allocator, behind the PiOS heaps
+ *
+ * Free blocks are kept in lists by size: the first level is the power of two
+ * below the size, and the second splits each power of two into
+ * SL_INDEX_COUNT equal ranges.  A bitmap per level says which lists have
+ * anything in them, so finding a block big enough is a couple of find first
+ * set operations, and malloc and free take the same time however full or
+ * fragmented the heap is.  This is the allocator of Masmano et al, laid out
+ * as in Matthew Conte's implementation.
+ *
+ * Each block starts with its size, whose low bits say whether it and the
+ * block before it are free.  A free block also holds its free list links,
+ * and the last word of its payload points back at its start, so that freeing
+ * the block after it can merge the two.  An allocated block only costs its
+ * size word.  Blocks below SMALL_BLOCK_SIZE all land in the first level, one
+ * list per word of size, so small allocations get exact size classes.
+ *
+ * The code is the same on the boards and on posix, where flightd and the
+ * unit tests run it over a static arena.
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "pios_tlsf.h"
+
+#include <string.h>		/* memset */
+
+/* Blocks are word aligned, as the bump allocator this replaced did */
+#if UINTPTR_MAX > 0xffffffff
+#define ALIGN_SIZE_LOG2 3
+#define FL_INDEX_MAX 30		/* pools to 1GB */
+#else
+#define ALIGN_SIZE_LOG2 2
+#define FL_INDEX_MAX 20		/* pools to 1MB, more than any board's RAM */
+#endif
+
+#define ALIGN_SIZE (1 << ALIGN_SIZE_LOG2)
+
+#define SL_INDEX_COUNT_LOG2 3
+#define SL_INDEX_COUNT (1 << SL_INDEX_COUNT_LOG2)
+
+#define FL_INDEX_SHIFT (SL_INDEX_COUNT_LOG2 + ALIGN_SIZE_LOG2)
+#define FL_INDEX_COUNT (FL_INDEX_MAX - FL_INDEX_SHIFT + 1)
+
+#define SMALL_BLOCK_SIZE (1 << FL_INDEX_SHIFT)
+
+struct block {
+	struct block *prev_phys;	/* Only valid if the previous block is free */
+	size_t size;			/* Of the payload; low bits are flags */
+
+	/* Only valid if this block is free */
+	struct block *next_free;
+	struct block *prev_free;
+};
+
+#define BLOCK_FREE_BIT		((size_t) 1 << 0)
+#define BLOCK_PREV_FREE_BIT	((size_t) 1 << 1)
+#define BLOCK_FLAGS		(BLOCK_FREE_BIT | BLOCK_PREV_FREE_BIT)
+
+/* An allocated block costs its size; prev_phys lives in the previous block */
+#define BLOCK_OVERHEAD		sizeof(size_t)
+#define BLOCK_START_OFFSET	(offsetof(struct block, size) + sizeof(size_t))
+
+/* A free block has to hold its links, and the next block's prev_phys */
+#define BLOCK_SIZE_MIN		(sizeof(struct block) - sizeof(struct block *))
+#define BLOCK_SIZE_MAX		((size_t) 1 << FL_INDEX_MAX)
+
+struct pios_tlsf {
+	struct block null_block;	/* Free lists end here, not at NULL */
+
+	uint32_t fl_bitmap;
+	uint32_t sl_bitmap[FL_INDEX_COUNT];
+
+	struct block *blocks[FL_INDEX_COUNT][SL_INDEX_COUNT];
+
+	struct block *pools[PIOS_TLSF_MAX_POOLS];
+	uint8_t num_pools;
+
+	size_t total_bytes;
+	size_t free_bytes;
+	size_t min_free_bytes;
+	uint32_t used_blocks;
+	uint32_t free_blocks;
+};
+
+#ifndef DONT_BUILD_IF
+#define DONT_BUILD_IF(COND,MSG) typedef char static_assertion_##MSG[(COND)?-1:1]
+#endif
+
+DONT_BUILD_IF(FL_INDEX_COUNT > 32, tlsfFirstLevelBitmap);
+DONT_BUILD_IF(SL_INDEX_COUNT > 32, tlsfSecondLevelBitmap);
+DONT_BUILD_IF(BLOCK_SIZE_MIN & (ALIGN_SIZE - 1), tlsfMinimumBlockAlignment);
+
+static int fls_size(size_t x)
+{
+	return 63 - __builtin_clzll(x);
+}
+
+static int ffs_u32(uint32_t x)
+{
+	return __builtin_ffs(x) - 1;
+}
+
+static int fls_u32(uint32_t x)
+{
+	return 31 - __builtin_clz(x);
+}
+
+static size_t align_up(size_t x, size_t align)
+{
+	return (x + (align - 1)) & ~(align - 1);
+}
+
+static size_t align_down(size_t x, size_t align)
+{
+	return x & ~(align - 1);
+}
+
+static size_t block_size(const struct block *block)
+{
+	return block->size & ~BLOCK_FLAGS;
+}
+
+static void block_set_size(struct block *block, size_t size)
+{
+	block->size = size | (block->size & BLOCK_FLAGS);
+}
+
+static bool block_is_last(const struct block *block)
+{
+	return block_size(block) == 0;
+}
+
+static bool block_is_free(const struct block *block)
+{
+	return block->size & BLOCK_FREE_BIT;
+}
+
+static bool block_is_prev_free(const struct block *block)
+{
+	return block->size & BLOCK_PREV_FREE_BIT;
+}
+
+static struct block *block_from_ptr(const void *ptr)
+{
+	return (struct block *) ((uintptr_t) ptr - BLOCK_START_OFFSET);
+}
+
+static void *block_to_ptr(const struct block *block)
+{
+	return (void *) ((uintptr_t) block + BLOCK_START_OFFSET);
+}
+
+static struct block *offset_to_block(const void *ptr, ptrdiff_t offset)
+{
+	return (struct block *) ((uintptr_t) ptr + offset);
+}
+
+static struct block *block_next(const struct block *block)
+{
+	return offset_to_block(block_to_ptr(block),
+			block_size(block) - BLOCK_OVERHEAD);
+}
+
+static struct block *block_link_next(struct block *block)
+{
+	struct block *next = block_next(block);
+	next->prev_phys = block;
+
+	return next;
+}
+
+static void block_mark_as_free(struct block *block)
+{
+	struct block *next = block_link_next(block);
+
+	next->size |= BLOCK_PREV_FREE_BIT;
+	block->size |= BLOCK_FREE_BIT;
+}
+
+static void block_mark_as_used(struct block *block)
+{
+	struct block *next = block_next(block);
+
+	next->size &= ~BLOCK_PREV_FREE_BIT;
+	block->size &= ~BLOCK_FREE_BIT;
+}
+
+/* Size of the block that will hold a request; 0 if none can */
+static size_t adjust_request_size(size_t size)
+{
+	if (size >= BLOCK_SIZE_MAX) {
+		return 0;
+	}
+
+	size = align_up(size, ALIGN_SIZE);
+
+	return size < BLOCK_SIZE_MIN ? BLOCK_SIZE_MIN : size;
+}
+
+/* Which list a block of this size belongs in */
+static void mapping_insert(size_t size, int *fli, int *sli)
+{
+	if (size < SMALL_BLOCK_SIZE) {
+		*fli = 0;
+		*sli = size / (SMALL_BLOCK_SIZE / SL_INDEX_COUNT);
+	} else {
+		int fl = fls_size(size);
+
+		*sli = (size >> (fl - SL_INDEX_COUNT_LOG2)) ^ SL_INDEX_COUNT;
+		*fli = fl - (FL_INDEX_SHIFT - 1);
+	}
+}
+
+/* The first list whose blocks are all at least this size */
+static void mapping_search(size_t size, int *fli, int *sli)
+{
+	if (size >= SMALL_BLOCK_SIZE) {
+		size += ((size_t) 1 << (fls_size(size) - SL_INDEX_COUNT_LOG2)) - 1;
+	}
+
+	mapping_insert(size, fli, sli);
+}
+
+static struct block *search_suitable_block(struct pios_tlsf *tlsf,
+		int *fli, int *sli)
+{
+	int fl = *fli;
+	uint32_t sl_map = tlsf->sl_bitmap[fl] & (~0U << *sli);
+
+	if (!sl_map) {
+		uint32_t fl_map = tlsf->fl_bitmap & (~0U << (fl + 1));
+
+		if (!fl_map) {
+			return NULL;
+		}
+
+		fl = ffs_u32(fl_map);
+		*fli = fl;
+		sl_map = tlsf->sl_bitmap[fl];
+	}
+
+	*sli = ffs_u32(sl_map);
+
+	return tlsf->blocks[fl][*sli];
+}
+
+static void remove_free_block(struct pios_tlsf *tlsf, struct block *block,
+		int fl, int sl)
+{
+	struct block *prev = block->prev_free;
+	struct block *next = block->next_free;
+
+	next->prev_free = prev;
+	prev->next_free = next;
+
+	if (tlsf->blocks[fl][sl] == block) {
+		tlsf->blocks[fl][sl] = next;
+
+		if (next == &tlsf->null_block) {
+			tlsf->sl_bitmap[fl] &= ~(1U << sl);
+
+			if (!tlsf->sl_bitmap[fl]) {
+				tlsf->fl_bitmap &= ~(1U << fl);
+			}
+		}
+	}
+
+	tlsf->free_bytes -= block_size(block);
+	tlsf->free_blocks--;
+}
+
+static void insert_free_block(struct pios_tlsf *tlsf, struct block *block,
+		int fl, int sl)
+{
+	struct block *current = tlsf->blocks[fl][sl];
+
+	block->next_free = current;
+	block->prev_free = &tlsf->null_block;
+	current->prev_free = block;
+
+	tlsf->blocks[fl][sl] = block;
+	tlsf->fl_bitmap |= 1U << fl;
+	tlsf->sl_bitmap[fl] |= 1U << sl;
+
+	tlsf->free_bytes += block_size(block);
+	tlsf->free_blocks++;
+}
+
+static void block_remove(struct pios_tlsf *tlsf, struct block *block)
+{
+	int fl, sl;
+
+	mapping_insert(block_size(block), &fl, &sl);
+	remove_free_block(tlsf, block, fl, sl);
+}
+
+static void block_insert(struct pios_tlsf *tlsf, struct block *block)
+{
+	int fl, sl;
+
+	mapping_insert(block_size(block), &fl, &sl);
+	insert_free_block(tlsf, block, fl, sl);
+}
+
+/* Takes the one block into two, the second of them free but not listed */
+static struct block *block_split(struct block *block, size_t size)
+{
+	struct block *remaining =
+		offset_to_block(block_to_ptr(block), size - BLOCK_OVERHEAD);
+
+	remaining->size = block_size(block) - (size + BLOCK_OVERHEAD);
+	block_set_size(block, size);
+
+	block_mark_as_free(remaining);
+
+	return remaining;
+}
+
+static struct block *block_absorb(struct block *prev, struct block *block)
+{
+	prev->size += block_size(block) + BLOCK_OVERHEAD;
+	block_link_next(prev);
+
+	return prev;
+}
+
+static struct block *block_merge_prev(struct pios_tlsf *tlsf,
+		struct block *block)
+{
+	if (block_is_prev_free(block)) {
+		struct block *prev = block->prev_phys;
+
+		block_remove(tlsf, prev);
+		block = block_absorb(prev, block);
+	}
+
+	return block;
+}
+
+static struct block *block_merge_next(struct pios_tlsf *tlsf,
+		struct block *block)
+{
+	struct block *next = block_next(block);
+
+	if (block_is_free(next)) {
+		block_remove(tlsf, next);
+		block = block_absorb(block, next);
+	}
+
+	return block;
+}
+
+/* Gives back what the allocation doesn't need, if that's enough for a block */
+static void block_trim_free(struct pios_tlsf *tlsf, struct block *block,
+		size_t size)
+{
+	if (block_size(block) >= sizeof(struct block) + size) {
+		struct block *remaining = block_split(block, size);
+
+		block_link_next(block);
+		remaining->size |= BLOCK_PREV_FREE_BIT;
+
+		block_insert(tlsf, remaining);
+	}
+}
+
+/**
+ * Set up an allocator.  Its own bookkeeping goes at the start of the memory,
+ * and the rest is the first pool.
+ *
+ * @param[in] mem the memory to manage
+ * @param[in] bytes how much of it there is
+ * @returns the allocator, or NULL if the memory is too small
+ */
+struct pios_tlsf *PIOS_TLSF_Create(void *mem, size_t bytes)
+{
+	uintptr_t start = align_up((uintptr_t) mem, ALIGN_SIZE);
+	size_t control_size = align_up(sizeof(struct pios_tlsf), ALIGN_SIZE);
+
+	if (bytes < (start - (uintptr_t) mem) + control_size) {
+		return NULL;
+	}
+
+	bytes -= start - (uintptr_t) mem;
+
+	struct pios_tlsf *tlsf = (struct pios_tlsf *) start;
+
+	memset(tlsf, 0, sizeof(*tlsf));
+
+	tlsf->null_block.next_free = &tlsf->null_block;
+	tlsf->null_block.prev_free = &tlsf->null_block;
+
+	for (int i = 0; i < FL_INDEX_COUNT; i++) {
+		for (int j = 0; j < SL_INDEX_COUNT; j++) {
+			tlsf->blocks[i][j] = &tlsf->null_block;
+		}
+	}
+
+	if (!PIOS_TLSF_AddPool(tlsf, (void *) (start + control_size),
+				bytes - control_size)) {
+		return NULL;
+	}
+
+	return tlsf;
+}
+
+/**
+ * Give an allocator more memory.  Blocks aren't merged across pools, so
+ * memory right after an existing pool is best added by the heap growing.
+ *
+ * @param[in] tlsf the allocator
+ * @param[in] mem the memory to add
+ * @param[in] bytes how much of it there is
+ * @returns false if it's too small to use or there are too many pools
+ */
+bool PIOS_TLSF_AddPool(struct pios_tlsf *tlsf, void *mem, size_t bytes)
+{
+	uintptr_t start = align_up((uintptr_t) mem, ALIGN_SIZE);
+
+	if (tlsf->num_pools >= PIOS_TLSF_MAX_POOLS) {
+		return false;
+	}
+
+	/* Room for the first block's size, and the sentinel after it */
+	if (bytes < (start - (uintptr_t) mem) + 2 * BLOCK_OVERHEAD + BLOCK_SIZE_MIN) {
+		return false;
+	}
+
+	size_t pool_bytes = align_down(bytes - (start - (uintptr_t) mem)
+			- 2 * BLOCK_OVERHEAD, ALIGN_SIZE);
+
+	if (pool_bytes >= BLOCK_SIZE_MAX) {
+		pool_bytes = BLOCK_SIZE_MAX - ALIGN_SIZE;
+	}
+
+	/*
+	 * The first block's prev_phys would sit before the pool, but is never
+	 * touched because nothing before it is free.
+	 */
+	struct block *block = offset_to_block((void *) start,
+			-(ptrdiff_t) BLOCK_OVERHEAD);
+
+	block->size = pool_bytes | BLOCK_FREE_BIT;
+	block_insert(tlsf, block);
+
+	struct block *sentinel = block_link_next(block);
+	sentinel->size = BLOCK_PREV_FREE_BIT;
+
+	tlsf->pools[tlsf->num_pools++] = block;
+
+	tlsf->total_bytes += pool_bytes;
+	tlsf->min_free_bytes += pool_bytes;
+
+	return true;
+}
+
+/**
+ * Allocate memory, word aligned.
+ *
+ * @param[in] tlsf the allocator
+ * @param[in] size bytes wanted
+ * @returns the memory, or NULL if there's no free block big enough
+ */
+void *PIOS_TLSF_Malloc(struct pios_tlsf *tlsf, size_t size)
+{
+	size_t adjusted = adjust_request_size(size);
+
+	if (!adjusted) {
+		return NULL;
+	}
+
+	int fl, sl;
+
+	mapping_search(adjusted, &fl, &sl);
+
+	if (fl >= FL_INDEX_COUNT) {
+		return NULL;
+	}
+
+	struct block *block = search_suitable_block(tlsf, &fl, &sl);
+
+	if (!block) {
+		return NULL;
+	}
+
+	remove_free_block(tlsf, block, fl, sl);
+	block_trim_free(tlsf, block, adjusted);
+	block_mark_as_used(block);
+
+	tlsf->used_blocks++;
+
+	if (tlsf->free_bytes < tlsf->min_free_bytes) {
+		tlsf->min_free_bytes = tlsf->free_bytes;
+	}
+
+	return block_to_ptr(block);
+}
+
+/**
+ * Free memory from PIOS_TLSF_Malloc, merging it with its free neighbours.
+ *
+ * @param[in] tlsf the allocator
+ * @param[in] ptr the memory; NULL is ignored
+ */
+void PIOS_TLSF_Free(struct pios_tlsf *tlsf, void *ptr)
+{
+	if (!ptr) {
+		return;
+	}
+
+	struct block *block = block_from_ptr(ptr);
+
+	/* Freeing it again would put it on the lists twice */
+	if (block_is_free(block)) {
+		return;
+	}
+
+	tlsf->used_blocks--;
+
+	block_mark_as_free(block);
+	block = block_merge_prev(tlsf, block);
+	block = block_merge_next(tlsf, block);
+	block_insert(tlsf, block);
+}
+
+/**
+ * How full, and how fragmented, the allocator is.  Finding the largest free
+ * block walks one free list; the rest is kept as it goes.
+ *
+ * @param[in] tlsf the allocator
+ * @param[out] stats the statistics
+ */
+void PIOS_TLSF_GetStats(const struct pios_tlsf *tlsf,
+		struct pios_tlsf_stats *stats)
+{
+	stats->total_bytes = tlsf->total_bytes;
+	stats->free_bytes = tlsf->free_bytes;
+	stats->min_free_bytes = tlsf->min_free_bytes;
+	stats->used_blocks = tlsf->used_blocks;
+	stats->free_blocks = tlsf->free_blocks;
+	stats->largest_free = 0;
+
+	if (tlsf->fl_bitmap) {
+		int fl = fls_u32(tlsf->fl_bitmap);
+		int sl = fls_u32(tlsf->sl_bitmap[fl]);
+
+		for (const struct block *block = tlsf->blocks[fl][sl];
+				block != &tlsf->null_block;
+				block = block->next_free) {
+			if (block_size(block) > stats->largest_free) {
+				stats->largest_free = block_size(block);
+			}
+		}
+	}
+}
+
+/**
+ * Walk every block and free list, checking they agree.  Slow; for tests.
+ *
+ * @param[in] tlsf the allocator
+ * @returns true if everything is consistent
+ */
+bool PIOS_TLSF_Check(const struct pios_tlsf *tlsf)
+{
+	size_t free_bytes = 0;
+	uint32_t free_blocks = 0, used_blocks = 0;
+
+	for (int i = 0; i < tlsf->num_pools; i++) {
+		const struct block *block = tlsf->pools[i];
+		bool prev_free = false;
+
+		while (true) {
+			if (block_is_prev_free(block) != prev_free) {
+				return false;
+			}
+
+			if (block_is_last(block)) {
+				break;
+			}
+
+			if (block_size(block) < BLOCK_SIZE_MIN ||
+					(block_size(block) & (ALIGN_SIZE - 1))) {
+				return false;
+			}
+
+			if (block_is_free(block)) {
+				/* Free neighbours should have been merged */
+				if (prev_free) {
+					return false;
+				}
+
+				if (block_next(block)->prev_phys != block) {
+					return false;
+				}
+
+				free_bytes += block_size(block);
+				free_blocks++;
+			} else {
+				used_blocks++;
+			}
+
+			prev_free = block_is_free(block);
+			block = block_next(block);
+		}
+	}
+
+	if (free_bytes != tlsf->free_bytes || free_blocks != tlsf->free_blocks ||
+			used_blocks != tlsf->used_blocks) {
+		return false;
+	}
+
+	uint32_t listed = 0;
+
+	for (int fl = 0; fl < FL_INDEX_COUNT; fl++) {
+		bool fl_set = tlsf->fl_bitmap & (1U << fl);
+
+		if (fl_set != (tlsf->sl_bitmap[fl] != 0)) {
+			return false;
+		}
+
+		for (int sl = 0; sl < SL_INDEX_COUNT; sl++) {
+			const struct block *head = tlsf->blocks[fl][sl];
+			bool sl_set = tlsf->sl_bitmap[fl] & (1U << sl);
+
+			if (sl_set != (head != &tlsf->null_block)) {
+				return false;
+			}
+
+			for (const struct block *block = head;
+					block != &tlsf->null_block;
+					block = block->next_free) {
+				int bfl, bsl;
+
+				mapping_insert(block_size(block), &bfl, &bsl);
+
+				if (!block_is_free(block) || bfl != fl || bsl != sl) {
+					return false;
+				}
+
+				if (++listed > free_blocks) {
+					return false;
+				}
+			}
+		}
+	}
+
+	return listed == free_blocks;
+}
+
+/**
+ * @}
+ * @}
+ */
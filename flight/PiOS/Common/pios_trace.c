@@ -0,0 +1,388 @@
+/**
+ ******************************************************************************
+ * @file       pios_trace.c
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup PIOS PIOS Core hardware abstraction layer
+ * @{
+ * @addtogroup PIOS_Trace Execution tracing
+ * @{
+ * @brief Low overhead recording of scheduling and dispatch events
+ *
+ * Records are written into a ring per CPU without taking any lock: a writer
+ * claims a slot by advancing the ring head with compare-and-swap, fills it
+ * and then publishes it by storing its sequence number.  This makes it safe
+ * to record from interrupts and from the context switch hook.  When a ring
+ * is full new records are counted as dropped rather than overwriting ones
+ * not yet drained.
+ *
+ * A single reader drains the rings, see PIOS_Trace_Read().  The drained
+ * stream starts with a header and the names of the known tasks, so that it
+ * can be decoded on its own by python/dronin-trace.
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "pios.h"
+#include "pios_trace.h"
+
+#if defined(PIOS_INCLUDE_TRACE)
+
+#if defined(FLIGHT_POSIX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifndef PIOS_TRACE_RING_LEN
+#define PIOS_TRACE_RING_LEN 512
+#endif
+
+#ifndef PIOS_TRACE_MAX_TASKS
+#define PIOS_TRACE_MAX_TASKS 24
+#endif
+
+#if defined(FLIGHT_POSIX)
+#define NUM_RINGS 4
+#else
+#define NUM_RINGS 1
+#endif
+
+DONT_BUILD_IF((PIOS_TRACE_RING_LEN & (PIOS_TRACE_RING_LEN - 1)) != 0,
+		TraceRingPowerOfTwo);
+DONT_BUILD_IF(sizeof(struct pios_trace_record) != 12, TraceRecordSize);
+
+struct trace_slot {
+	volatile uint32_t seq;		/* Claimed index + 1 once written */
+	struct pios_trace_record rec;
+};
+
+struct trace_ring {
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	volatile uint32_t dropped;
+	uint32_t dropped_reported;
+	struct trace_slot slots[PIOS_TRACE_RING_LEN];
+};
+
+struct trace_task {
+	volatile uintptr_t key;		/* Set last, 0 while unused */
+	char name[PIOS_TRACE_NAME_LEN];
+};
+
+volatile uint32_t pios_trace_mask = PIOS_TRACE_DEFAULT_MASK;
+
+static struct trace_ring rings[NUM_RINGS];
+static struct trace_task tasks[PIOS_TRACE_MAX_TASKS];
+static volatile uint32_t tasks_claimed;
+
+static volatile uint8_t draining;
+static int32_t drain_preamble;
+static uint16_t drain_ring;
+
+#if defined(PIOS_INCLUDE_CHIBIOS)
+static volatile uint8_t running_task = PIOS_TRACE_NO_TASK;
+#elif defined(FLIGHT_POSIX)
+static __thread uint8_t running_task = PIOS_TRACE_NO_TASK;
+#endif
+
+static uint8_t find_task(uintptr_t key)
+{
+	for (int i = 0; i < PIOS_TRACE_MAX_TASKS; i++) {
+		if (tasks[i].key == key) {
+			return i;
+		}
+	}
+
+	return PIOS_TRACE_NO_TASK;
+}
+
+static uint8_t current_task(void)
+{
+#if defined(PIOS_INCLUDE_CHIBIOS)
+	return running_task;
+#elif defined(FLIGHT_POSIX)
+	if (running_task == PIOS_TRACE_NO_TASK) {
+		/* Threads are registered by their creator, so the
+		 * thread may get here first; look again next time. */
+		running_task = find_task((uintptr_t) pthread_self());
+	}
+
+	return running_task;
+#else
+	return PIOS_TRACE_NO_TASK;
+#endif
+}
+
+static uint16_t current_cpu(void)
+{
+#if defined(FLIGHT_POSIX) && defined(__linux__)
+	int cpu = sched_getcpu();
+
+	return (cpu < 0) ? 0 : (cpu % NUM_RINGS);
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Choose which classes of events are recorded.  Classes left out of
+ * PIOS_TRACE_COMPILE_MASK are never recorded.
+ *
+ * @param[in] mask PIOS_TRACE_MASK_* bits
+ */
+void PIOS_Trace_SetMask(uint32_t mask)
+{
+#if defined(PIOS_INCLUDE_CHIBIOS)
+	/* Switches aren't followed while nothing is traced, so until the
+	 * next one it's not known which task is running */
+	if (!pios_trace_mask) {
+		running_task = PIOS_TRACE_NO_TASK;
+	}
+#endif
+
+	pios_trace_mask = mask & PIOS_TRACE_COMPILE_MASK;
+}
+
+/**
+ * Record an event.  Callable from any context, including interrupts.
+ * Normally invoked through the PIOS_TRACE() macro, which checks the masks.
+ *
+ * @param[in] type what happened
+ * @param[in] arg type specific argument
+ */
+void PIOS_Trace_Record(enum pios_trace_type type, uint32_t arg)
+{
+	uint32_t now = PIOS_DELAY_GetRaw();
+	uint16_t cpu = current_cpu();
+	struct trace_ring *ring = &rings[cpu];
+
+	uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+
+	do {
+		uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+		if (head - tail >= PIOS_TRACE_RING_LEN) {
+			__atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+			return;
+		}
+	} while (!__atomic_compare_exchange_n(&ring->head, &head, head + 1,
+				true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+	struct trace_slot *slot = &ring->slots[head & (PIOS_TRACE_RING_LEN - 1)];
+
+	slot->rec.time = now;
+	slot->rec.type = type;
+	slot->rec.task = current_task();
+	slot->rec.cpu = cpu;
+	slot->rec.arg = arg;
+
+	__atomic_store_n(&slot->seq, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Name a task so its records can be attributed.  Called when threads are
+ * created.
+ *
+ * @param[in] key the underlying thread: the ChibiOS Thread, or pthread_t
+ * @param[in] name task name, truncated to PIOS_TRACE_NAME_LEN
+ */
+void PIOS_Trace_AddTask(uintptr_t key, const char *name)
+{
+	uint32_t idx = __atomic_fetch_add(&tasks_claimed, 1, __ATOMIC_RELAXED);
+
+	if (idx >= PIOS_TRACE_MAX_TASKS) {
+		return;
+	}
+
+	strncpy(tasks[idx].name, name, PIOS_TRACE_NAME_LEN);
+
+	__atomic_store_n(&tasks[idx].key, key, __ATOMIC_RELEASE);
+}
+
+/**
+ * Note a context switch.  Called from the kernel context switch hook with
+ * the thread about to run.
+ */
+void PIOS_Trace_Switch(const void *thread)
+{
+#if defined(PIOS_INCLUDE_CHIBIOS)
+	/* This runs on every switch; don't look the task up for nothing */
+	if (!(PIOS_TRACE_COMPILE_MASK & pios_trace_mask)) {
+		return;
+	}
+
+	running_task = find_task((uintptr_t) thread);
+
+	PIOS_TRACE(PIOS_TRACE_MASK_TASK, PIOS_TRACE_TASK_SWITCH, 0);
+#else
+	(void) thread;
+#endif
+}
+
+/**
+ * Note interrupt entry or exit, from PIOS_IRQ_Prologue/Epilogue.
+ */
+void PIOS_Trace_ISR(bool enter)
+{
+	if (!(PIOS_TRACE_COMPILE_MASK & pios_trace_mask & PIOS_TRACE_MASK_ISR)) {
+		return;
+	}
+
+	uint32_t exception = 0;
+
+#if defined(__arm__) && !defined(FLIGHT_POSIX)
+	__asm__ volatile ("mrs %0, ipsr" : "=r" (exception));
+#endif
+
+	PIOS_Trace_Record(enter ? PIOS_TRACE_ISR_ENTER : PIOS_TRACE_ISR_EXIT,
+			exception);
+}
+
+static uint32_t put_record(uint8_t *buf, uint8_t type, uint8_t task,
+		uint16_t cpu, uint32_t arg)
+{
+	struct pios_trace_record rec = {
+		.time = PIOS_DELAY_GetRaw(),
+		.type = type,
+		.task = task,
+		.cpu = cpu,
+		.arg = arg,
+	};
+
+	memcpy(buf, &rec, sizeof(rec));
+
+	return sizeof(rec);
+}
+
+/* Header and task names, as many as fit */
+static uint32_t read_preamble(uint8_t *buf, uint32_t len)
+{
+	uint32_t pos = 0;
+
+	if (drain_preamble < 0) {
+		if (len < sizeof(struct pios_trace_record)) {
+			return 0;
+		}
+
+		pos += put_record(buf, PIOS_TRACE_HEADER, PIOS_TRACE_NO_TASK,
+				NUM_RINGS, PIOS_DELAY_DiffuS2(0, 1 << 28));
+
+		drain_preamble = 0;
+	}
+
+	while (drain_preamble < PIOS_TRACE_MAX_TASKS) {
+		struct trace_task *task = &tasks[drain_preamble];
+
+		if (!__atomic_load_n(&task->key, __ATOMIC_ACQUIRE)) {
+			drain_preamble++;
+			continue;
+		}
+
+		if (len - pos < sizeof(struct pios_trace_record) +
+				PIOS_TRACE_NAME_LEN) {
+			break;
+		}
+
+		pos += put_record(buf + pos, PIOS_TRACE_TASK_NAME,
+				drain_preamble, 0, 0);
+		memcpy(buf + pos, task->name, PIOS_TRACE_NAME_LEN);
+		pos += PIOS_TRACE_NAME_LEN;
+
+		drain_preamble++;
+	}
+
+	return pos;
+}
+
+/* Records from one ring, as many as fit */
+static uint32_t read_ring(uint16_t cpu, uint8_t *buf, uint32_t len)
+{
+	struct trace_ring *ring = &rings[cpu];
+	uint32_t pos = 0;
+
+	uint32_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+
+	if (dropped != ring->dropped_reported) {
+		if (len < sizeof(struct pios_trace_record)) {
+			return 0;
+		}
+
+		pos += put_record(buf, PIOS_TRACE_DROPPED, PIOS_TRACE_NO_TASK,
+				cpu, dropped - ring->dropped_reported);
+		ring->dropped_reported = dropped;
+	}
+
+	uint32_t tail = ring->tail;
+
+	while (len - pos >= sizeof(struct pios_trace_record)) {
+		struct trace_slot *slot =
+			&ring->slots[tail & (PIOS_TRACE_RING_LEN - 1)];
+
+		/* Stop at the first slot not completely written yet */
+		if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != tail + 1) {
+			break;
+		}
+
+		memcpy(buf + pos, &slot->rec, sizeof(slot->rec));
+		pos += sizeof(slot->rec);
+
+		tail++;
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+	}
+
+	return pos;
+}
+
+/**
+ * Drain recorded events.  Only one caller may drain at a time.
+ *
+ * @param[out] buf where to put the records
+ * @param[in] len room in buf; at least 28 bytes so a task name fits
+ * @param[in] restart start a new stream, beginning with the header and
+ * task names
+ * @returns number of bytes put in buf, 0 if there is nothing pending,
+ * negative if another caller is draining
+ */
+int32_t PIOS_Trace_Read(uint8_t *buf, uint32_t len, bool restart)
+{
+	if (__atomic_test_and_set(&draining, __ATOMIC_ACQUIRE)) {
+		return -1;
+	}
+
+	if (restart) {
+		drain_preamble = -1;
+	}
+
+	uint32_t pos = read_preamble(buf, len);
+
+	if (drain_preamble >= PIOS_TRACE_MAX_TASKS) {
+		/* Take turns between the rings, so none starves */
+		for (int i = 0; i < NUM_RINGS; i++) {
+			pos += read_ring(drain_ring, buf + pos, len - pos);
+
+			drain_ring = (drain_ring + 1) % NUM_RINGS;
+		}
+	}
+
+	__atomic_clear(&draining, __ATOMIC_RELEASE);
+
+	return pos;
+}
+
+#endif /* PIOS_INCLUDE_TRACE */
+
+/**
+ * @}
+ * @}
+ */
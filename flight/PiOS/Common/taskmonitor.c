@@ -56,6 +56,8 @@ int32_t TaskMonitorInitialize(void)
 #if defined(DIAG_TASKS)
 #if defined(PIOS_INCLUDE_CHIBIOS)
 	lastMonitorTime = halGetCounterValue();
+#elif defined(FLIGHT_POSIX)
+	lastMonitorTime = PIOS_DELAY_GetRaw();
 #endif /* defined(PIOS_INCLUDE_CHIBIOS) */
 #endif
 	return 0;
@@ -132,6 +134,9 @@ void TaskMonitorUpdateAll(void)
 	 */
 #if defined(PIOS_INCLUDE_CHIBIOS)
 	currentTime = hal_lld_get_counter_value();
+#elif defined(FLIGHT_POSIX)
+	/* Thread runtimes are in microseconds, as are raw delays */
+	currentTime = PIOS_DELAY_GetRaw();
 #endif /* defined(PIOS_INCLUDE_CHIBIOS) */
 	deltaTime = ((currentTime - lastMonitorTime) / 100) ? : 1; /* avoid divide-by-zero if the interval is too small */
 	lastMonitorTime = currentTime;
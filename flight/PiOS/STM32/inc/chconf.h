@@ -528,7 +528,8 @@ typedef uint32_t halrtcnt_t;
 #define THREAD_CONTEXT_SWITCH_HOOK(ntp, otp) {                              \
   ntp->ticks_switched_in = halGetCounterValue();                            \
   otp->ticks_total += ntp->ticks_switched_in - otp->ticks_switched_in;      \
-  /* System halt code here.*/                                               \
+  extern void PIOS_Thread_Switch_Hook(const void *thread);                  \
+  PIOS_Thread_Switch_Hook(ntp);                                             \
 }
 #endif
 
@@ -28,8 +28,17 @@
 
 #include <stdint.h>
 
+//! One object instance of a batch to save
+struct pios_flashfs_obj {
+	uint32_t obj_id;
+	uint16_t obj_inst_id;
+	uint16_t obj_size;
+	uint8_t *obj_data;
+};
+
 int32_t PIOS_FLASHFS_Format(uintptr_t fs_id);
 int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id, uint8_t * obj_data, uint16_t obj_size);
+int32_t PIOS_FLASHFS_ObjSaveBatch(uintptr_t fs_id, const struct pios_flashfs_obj *objs, uint16_t num_objs);
 int32_t PIOS_FLASHFS_ObjLoad(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id, uint8_t * obj_data, uint16_t obj_size);
 int32_t PIOS_FLASHFS_ObjDelete(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id);
 
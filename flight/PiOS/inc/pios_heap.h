@@ -30,6 +30,12 @@
 #include <stdlib.h>		/* size_t */
 #include <stdbool.h>		/* bool */
 
+struct pios_heap_stats {
+	size_t free_bytes;	//!< Free now
+	size_t min_free_bytes;	//!< The least there has been free since boot
+	size_t largest_free;	//!< Largest free block
+};
+
 extern bool PIOS_heap_malloc_failed_p(void);
 
 extern void * PIOS_malloc_no_dma(size_t size);
@@ -39,6 +45,8 @@ extern void PIOS_free(void * buf);
 
 extern size_t PIOS_heap_get_free_size(void);
 extern size_t PIOS_fastheap_get_free_size(void);
+extern void PIOS_heap_get_stats(struct pios_heap_stats *stats);
+extern void PIOS_fastheap_get_stats(struct pios_heap_stats *stats);
 extern void PIOS_heap_initialize_blocks(void);
 extern void PIOS_heap_increase_size(size_t bytes);
 
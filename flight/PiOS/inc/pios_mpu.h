@@ -140,6 +140,7 @@ struct pios_mpu_cfg {
 	uint16_t default_samplerate;
 	enum pios_mpu_orientation orientation;
 	bool skip_startup_irq_check;
+	uint8_t fifo_batch;		/* Samples to read from the FIFO at once; 0 reads the data registers on every interrupt */
 #ifdef PIOS_INCLUDE_MPU_MAG
 	bool use_internal_mag;		/* Flag to indicate whether or not to use the internal mag on MPU9x50 devices */
 #endif // PIOS_INCLUDE_MPU_MAG
@@ -164,7 +165,8 @@ int32_t PIOS_MPU_SetGyroRange(enum pios_mpu_gyro_range range);
 int32_t PIOS_MPU_SetAccelRange(enum pios_mpu_accel_range range);
 
 /**
- * Set the sample rate in Hz by determining the nearest divisor
+ * Set the sample rate in Hz by determining the nearest divisor.  With
+ * fifo_batch set this is the rate batches are read at.
  * @param[in] sample rate in Hz
  */
 int32_t PIOS_MPU_SetSampleRate(uint16_t samplerate_hz);
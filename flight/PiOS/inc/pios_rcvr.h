@@ -33,10 +33,14 @@
 struct pios_rcvr_driver {
 	void    (*init)(uintptr_t id);
 	int32_t (*read)(uintptr_t id, uint8_t channel);
+	/* Optional: copy out the first channels of the last frame at once */
+	int32_t (*read_frame)(uintptr_t id, int16_t *channels, uint8_t num_channels);
 };
 
 /* Public Functions */
 int32_t PIOS_RCVR_Read(uintptr_t rcvr_id, uint8_t channel);
+int32_t PIOS_RCVR_ReadFrame(uintptr_t rcvr_id, int16_t *channels, uint8_t num_channels);
+uint32_t PIOS_RCVR_GetFrameTime(uint32_t *frame_raw);
 bool PIOS_RCVR_WaitActivity(uint32_t timeout_ms);
 void PIOS_RCVR_Active();
 void PIOS_RCVR_ActiveFromISR();
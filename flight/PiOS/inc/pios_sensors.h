@@ -81,6 +81,24 @@ struct pios_sensor_baro_data {
 	float altitude;
 };
 
+//! Most samples one batch can carry
+#define PIOS_SENSORS_BATCH_MAX 16
+
+/**
+ * Gyro samples read out together, e.g. drained from an IMU's FIFO in one
+ * transfer, along with the accel samples taken at the same instants.
+ * Oldest sample first.
+ */
+struct pios_sensor_imu_batch {
+	uint32_t timestamp;	//!< PIOS_DELAY_GetRaw() time the batch was taken
+	uint32_t lag_us;	//!< How long before timestamp the last sample was
+	uint32_t interval_us;	//!< Time between samples, 0 if unknown
+	uint8_t count;		//!< Samples in the batch
+	bool has_accel;		//!< Whether accel[] is filled in too
+	struct pios_sensor_gyro_data gyro[PIOS_SENSORS_BATCH_MAX];
+	struct pios_sensor_accel_data accel[PIOS_SENSORS_BATCH_MAX];
+};
+
 //! The types of sensors this module supports
 enum pios_sensor_type
 {
@@ -107,12 +125,23 @@ int32_t PIOS_SENSORS_Register(enum pios_sensor_type type, struct pios_queue *que
 int32_t PIOS_SENSORS_RegisterCallback(enum pios_sensor_type type,
 		PIOS_SENSOR_Callback_t callback, void *ctx);
 
+//! Register a gyro whose queue items are struct pios_sensor_imu_batch
+int32_t PIOS_SENSORS_RegisterBatch(enum pios_sensor_type type, struct pios_queue *queue);
+
+//! Register a gyro whose callback fills a struct pios_sensor_imu_batch
+int32_t PIOS_SENSORS_RegisterBatchCallback(enum pios_sensor_type type,
+		PIOS_SENSOR_Callback_t callback, void *ctx);
+
 //! Checks if a sensor type is registered with the PIOS_SENSORS interface
 bool PIOS_SENSORS_IsRegistered(enum pios_sensor_type type);
 
 //! Get the data for a sensor type
 bool PIOS_SENSORS_GetData(enum pios_sensor_type type, void *buf, int ms_to_wait);
 
+//! Get the next batch of gyro samples, from any gyro driver
+bool PIOS_SENSORS_GetBatch(enum pios_sensor_type type,
+		struct pios_sensor_imu_batch *batch, int ms_to_wait);
+
 //! Set the maximum gyro rate in deg/s
 void PIOS_SENSORS_SetMaxGyro(int32_t rate);
 
@@ -125,10 +154,22 @@ void PIOS_SENSORS_SetSampleRate(enum pios_sensor_type type, uint32_t sample_rate
 //! Get the sample rate of a sensor (Hz)
 uint32_t PIOS_SENSORS_GetSampleRate(enum pios_sensor_type type);
 
+//! Set how many samples each batch of a sensor carries
+void PIOS_SENSORS_SetBatchSize(enum pios_sensor_type type, uint8_t samples);
+
+//! Get how many samples each batch carries; the sample rate is batches/s
+uint8_t PIOS_SENSORS_GetBatchSize(enum pios_sensor_type type);
+
 //! Assert that an optional (non-accel/gyro), but expected sensor is missing
 void PIOS_SENSORS_SetMissing(enum pios_sensor_type type);
 
 //! Determine if an optional but expected sensor is missing.
 bool PIOS_SENSORS_GetMissing(enum pios_sensor_type type);
 
+//! Declare that a sensor's samples are already calibrated, filtered and rotated
+void PIOS_SENSORS_SetCalibrated(enum pios_sensor_type type);
+
+//! Determine if a sensor's samples need no further calibration
+bool PIOS_SENSORS_GetCalibrated(enum pios_sensor_type type);
+
 #endif /* PIOS_SENSOR_H */
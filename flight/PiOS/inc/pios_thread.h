@@ -77,6 +77,7 @@ uint32_t PIOS_Thread_Get_Stack_Usage(struct pios_thread *threadp);
 uint32_t PIOS_Thread_Get_Runtime(struct pios_thread *threadp);
 void PIOS_Thread_Scheduler_Suspend(void);
 void PIOS_Thread_Scheduler_Resume(void);
+void PIOS_Thread_Switch_Hook(const void *thread);
 
 /*
  * The following functions are provided to assist with common thread timing uses
@@ -0,0 +1,66 @@
+/**
+ ******************************************************************************
+ * @file       pios_tlsf.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup PIOS PIOS Core hardware abstraction layer
+ * @{
+ * @addtogroup PIOS_HEAP Heap Allocation Abstraction
+ * @{
+ * @brief Two-level segregated fit allocator, behind the PiOS heaps
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef PIOS_TLSF_H
+#define PIOS_TLSF_H
+
+#include <stdbool.h>		/* bool */
+#include <stddef.h>		/* size_t */
+#include <stdint.h>		/* uint32_t */
+
+//! The most separate regions one allocator can hand out
+#define PIOS_TLSF_MAX_POOLS 4
+
+struct pios_tlsf;
+
+struct pios_tlsf_stats {
+	size_t total_bytes;	//!< Usable bytes in all pools, free or not
+	size_t free_bytes;	//!< Bytes in free blocks
+	size_t min_free_bytes;	//!< The least free_bytes has been
+	size_t largest_free;	//!< Largest free block
+	uint32_t used_blocks;
+	uint32_t free_blocks;
+};
+
+/*
+ * None of these lock; the caller must keep them from running concurrently
+ * on the same allocator.
+ */
+extern struct pios_tlsf *PIOS_TLSF_Create(void *mem, size_t bytes);
+extern bool PIOS_TLSF_AddPool(struct pios_tlsf *tlsf, void *mem, size_t bytes);
+
+extern void *PIOS_TLSF_Malloc(struct pios_tlsf *tlsf, size_t size);
+extern void PIOS_TLSF_Free(struct pios_tlsf *tlsf, void *ptr);
+
+extern void PIOS_TLSF_GetStats(const struct pios_tlsf *tlsf,
+		struct pios_tlsf_stats *stats);
+extern bool PIOS_TLSF_Check(const struct pios_tlsf *tlsf);
+
+#endif	/* PIOS_TLSF_H */
+
+/**
+ * @}
+ * @}
+ */
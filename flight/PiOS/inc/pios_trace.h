@@ -0,0 +1,115 @@
+/**
+ ******************************************************************************
+ * @file       pios_trace.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup PIOS PIOS Core hardware abstraction layer
+ * @{
+ * @addtogroup PIOS_Trace Execution tracing
+ * @{
+ * @brief Low overhead recording of scheduling and dispatch events
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef PIOS_TRACE_H
+#define PIOS_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Classes of events, as used in the enable masks */
+#define PIOS_TRACE_MASK_TASK   0x01	/* Task switches */
+#define PIOS_TRACE_MASK_QUEUE  0x02	/* Queue send and receive */
+#define PIOS_TRACE_MASK_EVENT  0x04	/* UAVO event dispatch */
+#define PIOS_TRACE_MASK_ISR    0x08	/* Interrupt entry and exit */
+#define PIOS_TRACE_MASK_USER   0x10	/* Spans marked in the code */
+#define PIOS_TRACE_MASK_ALL    0x1f
+
+/* Classes that are compiled in at all; the rest cost nothing */
+#ifndef PIOS_TRACE_COMPILE_MASK
+#define PIOS_TRACE_COMPILE_MASK PIOS_TRACE_MASK_ALL
+#endif
+
+/* Classes recorded from boot, until PIOS_Trace_SetMask() */
+#ifndef PIOS_TRACE_DEFAULT_MASK
+#define PIOS_TRACE_DEFAULT_MASK 0
+#endif
+
+/* File id under which the trace is served over UAVTalk and logged */
+#define PIOS_TRACE_FILE_ID 0x100
+
+enum pios_trace_type {
+	PIOS_TRACE_HEADER = 0,		/* arg: us per 2^28 raw ticks */
+	PIOS_TRACE_TASK_NAME,		/* followed by the name */
+	PIOS_TRACE_DROPPED,		/* arg: records lost on cpu */
+	PIOS_TRACE_TASK_SWITCH,		/* task: switched in */
+	PIOS_TRACE_QUEUE_SEND,		/* arg: queue */
+	PIOS_TRACE_QUEUE_RECEIVE,	/* arg: queue */
+	PIOS_TRACE_EVENT_BEGIN,		/* arg: object id */
+	PIOS_TRACE_EVENT_END,		/* arg: object id */
+	PIOS_TRACE_ISR_ENTER,		/* arg: exception number */
+	PIOS_TRACE_ISR_EXIT,		/* arg: exception number */
+	PIOS_TRACE_SPAN_BEGIN,		/* arg: span id */
+	PIOS_TRACE_SPAN_END,		/* arg: span id */
+};
+
+#define PIOS_TRACE_NAME_LEN 16
+#define PIOS_TRACE_NO_TASK 0xff
+
+/* A record as drained, little endian.  TASK_NAME records are followed by
+ * PIOS_TRACE_NAME_LEN bytes of name. */
+struct pios_trace_record {
+	uint32_t time;		/* PIOS_DELAY_GetRaw() */
+	uint8_t type;		/* enum pios_trace_type */
+	uint8_t task;		/* Task index, PIOS_TRACE_NO_TASK if unknown */
+	uint16_t cpu;		/* Ring the record was taken from */
+	uint32_t arg;
+} __attribute__((packed));
+
+#if defined(PIOS_INCLUDE_TRACE)
+
+extern volatile uint32_t pios_trace_mask;
+
+void PIOS_Trace_SetMask(uint32_t mask);
+void PIOS_Trace_Record(enum pios_trace_type type, uint32_t arg);
+void PIOS_Trace_AddTask(uintptr_t key, const char *name);
+void PIOS_Trace_Switch(const void *thread);
+void PIOS_Trace_ISR(bool enter);
+int32_t PIOS_Trace_Read(uint8_t *buf, uint32_t len, bool restart);
+
+#define PIOS_TRACE(cls, type, arg) do { \
+	if ((PIOS_TRACE_COMPILE_MASK & (cls)) && (pios_trace_mask & (cls))) { \
+		PIOS_Trace_Record((type), (uint32_t) (arg)); \
+	} \
+} while (0)
+
+#else
+
+#define PIOS_TRACE(cls, type, arg) do { } while (0)
+
+#endif /* PIOS_INCLUDE_TRACE */
+
+/* Mark a span of code for the trace; ids are up to the user */
+#define PIOS_TRACE_BEGIN(id) \
+	PIOS_TRACE(PIOS_TRACE_MASK_USER, PIOS_TRACE_SPAN_BEGIN, (id))
+#define PIOS_TRACE_END(id) \
+	PIOS_TRACE(PIOS_TRACE_MASK_USER, PIOS_TRACE_SPAN_END, (id))
+
+#endif /* PIOS_TRACE_H */
+
+/**
+ * @}
+ * @}
+ */
@@ -115,6 +115,7 @@
 /* PIOS Hardware Includes (Common) */
 #include <pios_debug.h>
 #include <pios_heap.h>
+#include <pios_trace.h>
 #include <pios_com.h>
 #if defined(PIOS_INCLUDE_MPXV7002)
 #include <pios_mpxv7002.h>
@@ -5,10 +5,21 @@ struct pios_flash_posix_cfg {
 	uint32_t size_of_sector;
 };
 
+//! How many operations a flash has seen since it was initialized
+struct pios_flash_posix_stats {
+	uint32_t transactions;
+	uint32_t reads;
+	uint32_t writes;
+	uint32_t bytes_written;
+	uint32_t erases;		//!< Sectors erased
+};
+
 int32_t PIOS_Flash_Posix_Init(uintptr_t * chip_id,
 		const struct pios_flash_posix_cfg * cfg,
 		bool force_recreate);
 void PIOS_Flash_Posix_Destroy(uintptr_t chip_id);
 void PIOS_Flash_Posix_SetFName(const char *name);
+void PIOS_Flash_Posix_GetStats(uintptr_t chip_id,
+		struct pios_flash_posix_stats *stats);
 
 extern const struct pios_flash_driver pios_posix_flash_driver;
@@ -12,4 +12,10 @@ struct pios_spi_cfg {
 	char base_path[PATH_MAX];
 };
 
+//! Base path of a simulated MPU-6000 with its FIFO, as slave 0
+#define PIOS_SPI_SIM_MPU_PATH "sim:mpu6000"
+
+int32_t PIOS_SPI_SimMPU_Sample(pios_spi_t spi_dev, const int16_t accel[3],
+		int16_t temperature, const int16_t gyro[3]);
+
 #endif /* PIOS_SPI_POSIX_PRIV_H */
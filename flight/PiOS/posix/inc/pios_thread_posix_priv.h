@@ -0,0 +1,41 @@
+/**
+ ******************************************************************************
+ * @file       pios_thread_posix_priv.h
+ * @author     dRonin, http://dRonin.org, Copyright (C) 2017
+ * @addtogroup PIOS PIOS Core hardware abstraction layer
+ * @{
+ * @addtogroup PIOS_Thread Thread Abstraction
+ * @{
+ * @brief Blocking on a word, for the posix queues and semaphores
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef PIOS_THREAD_POSIX_PRIV_H
+#define PIOS_THREAD_POSIX_PRIV_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+bool PIOS_Thread_WaitWord(volatile uint32_t *word, uint32_t val,
+		uint32_t start, uint32_t timeout_ms);
+void PIOS_Thread_WakeWord(volatile uint32_t *word, bool all);
+
+#endif /* PIOS_THREAD_POSIX_PRIV_H */
+
+/**
+ * @}
+ * @}
+ */
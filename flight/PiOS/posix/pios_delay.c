@@ -30,6 +30,7 @@
 
 /* Project Includes */
 #include "pios.h"
+#include "pios_thread.h"
 #include "time.h"
 
 #include <time.h>
@@ -152,6 +153,14 @@ int32_t PIOS_DELAY_WaitmS(uint32_t mS)
 
 uint32_t PIOS_DELAY_GetRaw()
 {
+	/* While the fake clock runs, e.g. for a replay, time only moves
+	 * when it ticks, so that runs don't depend on the host's timing.
+	 * That leaves a millisecond resolution.
+	 */
+	if (PIOS_Thread_FakeClock_IsActive()) {
+		return PIOS_Thread_Systime() * 1000 - base_time;
+	}
+
 	uint32_t raw_us = get_monotonic_us_time() - base_time;
 	return raw_us;
 }
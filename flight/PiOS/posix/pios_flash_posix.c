@@ -19,6 +19,8 @@ struct flash_posix_dev {
 	FILE * flash_file;
 
 	struct pios_semaphore *transaction_lock;
+
+	struct pios_flash_posix_stats stats;
 };
 
 static struct flash_posix_dev * PIOS_Flash_Posix_Alloc(void)
@@ -57,6 +59,7 @@ int32_t PIOS_Flash_Posix_Init(uintptr_t * chip_id,
 	assert(flash_dev);
 
 	flash_dev->cfg = cfg;
+	memset(&flash_dev->stats, 0, sizeof(flash_dev->stats));
 
 	if (!force_recreate) {
 		flash_dev->flash_file = fopen(PIOS_Flash_Posix_GetFName(), "r+");
@@ -102,6 +105,22 @@ void PIOS_Flash_Posix_Destroy(uintptr_t chip_id)
 	PIOS_free(flash_dev);
 }
 
+/**
+ * @brief Gets how many operations the flash has seen, to measure the
+ * filesystem above it
+ * @param[in] chip_id The flash to read the counters of
+ * @param[out] stats Where to put the counters
+ */
+void PIOS_Flash_Posix_GetStats(uintptr_t chip_id,
+		struct pios_flash_posix_stats *stats)
+{
+	struct flash_posix_dev * flash_dev = (struct flash_posix_dev *)chip_id;
+
+	assert(stats);
+
+	*stats = flash_dev->stats;
+}
+
 /**********************************
  *
  * Provide a PIOS flash driver API
@@ -118,6 +137,8 @@ static int32_t PIOS_Flash_Posix_StartTransaction(uintptr_t chip_id)
 		return -2;
 	}
 
+	flash_dev->stats.transactions++;
+
 	return 0;
 }
 
@@ -153,6 +174,8 @@ static int32_t PIOS_Flash_Posix_EraseSector(uintptr_t chip_id, uint32_t chip_sec
 
 	fflush(flash_dev->flash_file);
 
+	flash_dev->stats.erases++;
+
 	return 0;
 }
 
@@ -176,6 +199,9 @@ static int32_t PIOS_Flash_Posix_WriteData(uintptr_t chip_id, uint32_t chip_offse
 
 	fflush(flash_dev->flash_file);
 
+	flash_dev->stats.writes++;
+	flash_dev->stats.bytes_written += len;
+
 	return 0;
 }
 
@@ -197,6 +223,8 @@ static int32_t PIOS_Flash_Posix_ReadData(uintptr_t chip_id, uint32_t chip_offset
 
 	assert (s == len);
 
+	flash_dev->stats.reads++;
+
 	return 0;
 }
 
@@ -28,7 +28,12 @@
 #include "pios.h"		/* PIOS_INCLUDE_* */
 
 #include "pios_heap.h"		/* External API declaration */
+#include "pios_tlsf.h"		/* Allocator behind the heap */
+
+#include <pthread.h>		/* pthread_mutex_t */
 #include <stdbool.h>		/* bool */
+#include <stdint.h>		/* uintptr_t */
+#include <string.h>		/* memset */
 
 #define DEBUG_MALLOC_FAILURES 0
 static volatile bool malloc_failed_flag = false;
@@ -47,9 +52,39 @@ bool PIOS_heap_malloc_failed_p(void)
 	return malloc_failed_flag;
 }
 
+/*
+ * The same allocator as on the boards, over a static arena, so that flightd
+ * and the unit tests see the same behaviour.  The arena is untouched until
+ * used, so its size costs nothing.
+ */
+#ifndef PIOS_POSIX_HEAP_SIZE
+#define PIOS_POSIX_HEAP_SIZE (64 * 1024 * 1024)
+#endif
+
+static uintptr_t heap_arena[PIOS_POSIX_HEAP_SIZE / sizeof(uintptr_t)];
+static struct pios_tlsf *heap;
+static pthread_mutex_t heap_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Called with the heap locked.  Sets up the allocator on first use. */
+static bool heap_ready(void)
+{
+	if (heap == NULL) {
+		heap = PIOS_TLSF_Create(heap_arena, sizeof(heap_arena));
+	}
+
+	return heap != NULL;
+}
+
 void * PIOS_malloc(size_t size)
 {
-	void *buf = malloc(size);
+	void *buf = NULL;
+
+	pthread_mutex_lock(&heap_mutex);
+
+	if (heap_ready())
+		buf = PIOS_TLSF_Malloc(heap, size);
+
+	pthread_mutex_unlock(&heap_mutex);
 
 	if (buf == NULL)
 		malloc_failed_hook();
@@ -64,16 +99,59 @@ void * PIOS_malloc_no_dma(size_t size)
 
 void PIOS_free(void * buf)
 {
-	free(buf);
+	uintptr_t addr = (uintptr_t)buf;
+
+	if (addr < (uintptr_t)heap_arena ||
+			addr >= (uintptr_t)heap_arena + sizeof(heap_arena))
+		return;
+
+	pthread_mutex_lock(&heap_mutex);
+	PIOS_TLSF_Free(heap, buf);
+	pthread_mutex_unlock(&heap_mutex);
 }
 
 void PIOS_heap_initialize_blocks(void)
 {
+	pthread_mutex_lock(&heap_mutex);
+	heap_ready();
+	pthread_mutex_unlock(&heap_mutex);
+}
+
+void PIOS_heap_increase_size(size_t bytes)
+{
+	/* The arena is fixed */
+}
+
+void PIOS_heap_get_stats(struct pios_heap_stats *stats)
+{
+	struct pios_tlsf_stats tlsf_stats;
+
+	memset(&tlsf_stats, 0, sizeof(tlsf_stats));
+
+	pthread_mutex_lock(&heap_mutex);
+
+	if (heap_ready())
+		PIOS_TLSF_GetStats(heap, &tlsf_stats);
+
+	pthread_mutex_unlock(&heap_mutex);
+
+	stats->free_bytes = tlsf_stats.free_bytes;
+	stats->min_free_bytes = tlsf_stats.min_free_bytes;
+	stats->largest_free = tlsf_stats.largest_free;
 }
 
 size_t PIOS_heap_get_free_size(void)
 {
-	return 4096;
+	struct pios_heap_stats stats;
+
+	PIOS_heap_get_stats(&stats);
+
+	return stats.free_bytes;
+}
+
+void PIOS_fastheap_get_stats(struct pios_heap_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
 }
 
 size_t PIOS_fastheap_get_free_size(void)
@@ -1,6 +1,6 @@
 /**
  ******************************************************************************
- * @file       pios_queue.h
+ * @file       pios_queue.c
  * @author     dRonin, http://dronin.org Copyright (C) 2017
  * @addtogroup PIOS PIOS Core hardware abstraction layer
  * @{
@@ -23,27 +23,58 @@
  * with this program; if not, see <http://www.gnu.org/licenses/>
  */
 
-#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
 
-#include <circqueue.h>
-
+#include <pios.h>
 #include <pios_queue.h>
 #include <pios_thread.h>
+#include <pios_thread_posix_priv.h>
+
+/*
+ * A bounded lock-free queue, after Dmitry Vyukov's MPMC design.  Each cell
+ * carries a sequence number saying whether it is ready to be written or
+ * read for a given lap of the ring, so producers and consumers only contend
+ * on their own position.
+ *
+ * Blocking goes through a counter per direction, bumped after every send
+ * or receive.  A thread that finds the queue full or empty announces itself
+ * in the waiter count and sleeps on the counter; the other side only makes
+ * a system call when someone is waiting, and then wakes a single thread.
+ */
+
+struct queue_cell {
+	volatile uint32_t seq;
+	uint8_t data[];
+};
 
 struct pios_queue {
 #define QUEUE_MAGIC 75657551	/* 'Queu' */
 	uint32_t magic;
 
-	pthread_mutex_t mutex;
-	pthread_cond_t cond;
-
 	uint16_t item_size;
 	uint16_t q_len;
 
-	circ_queue_t queue;
+	uint32_t mask;
+	uint32_t stride;
+	uint8_t *cells;
+
+	/* Kept apart, each is written by one side */
+	volatile uint32_t send_pos __attribute__((aligned(64)));
+	volatile uint32_t sent;		/* Bumped after every send */
+	volatile uint32_t send_waiters;
+
+	volatile uint32_t recv_pos __attribute__((aligned(64)));
+	volatile uint32_t received;	/* Bumped after every receive */
+	volatile uint32_t recv_waiters;
 };
 
+static inline struct queue_cell *queue_cell(struct pios_queue *q,
+		uint32_t pos)
+{
+	return (struct queue_cell *) (q->cells + (pos & q->mask) * q->stride);
+}
+
 struct pios_queue *PIOS_Queue_Create(size_t queue_length, size_t item_size)
 {
 	struct pios_queue *q = PIOS_malloc(sizeof(*q));
@@ -52,35 +83,31 @@ struct pios_queue *PIOS_Queue_Create(size_t queue_length, size_t item_size)
 		return NULL;
 	}
 
-        pthread_mutexattr_t attr;
-
-        if (pthread_mutexattr_init(&attr)) {
-                abort();
-        }
+	memset(q, 0, sizeof(*q));
 
-        pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
-
-	if (pthread_mutex_init(&q->mutex, &attr)) {
-		abort();
-	}
+	/* Cells are a power of two; q_len still bounds what is queued */
+	uint32_t num_cells = 1;
 
-	if (pthread_cond_init(&q->cond, NULL)) {
-		abort();
+	while (num_cells < queue_length) {
+		num_cells <<= 1;
 	}
 
 	q->item_size = item_size;
 	q->q_len = queue_length;
+	q->mask = num_cells - 1;
+	q->stride = (sizeof(struct queue_cell) + item_size + 7) & ~7;
 
-	q->queue = circ_queue_new(item_size, queue_length+1);
-
-	if (!q->queue) {
-		pthread_mutex_destroy(&q->mutex);
-		pthread_cond_destroy(&q->cond);
+	q->cells = PIOS_malloc(num_cells * q->stride);
 
+	if (!q->cells) {
 		PIOS_free(q);
 		return NULL;
 	}
 
+	for (uint32_t i = 0; i < num_cells; i++) {
+		queue_cell(q, i)->seq = i;
+	}
+
 	q->magic = QUEUE_MAGIC;
 
 	return q;
@@ -90,146 +117,176 @@ void PIOS_Queue_Delete(struct pios_queue *queuep)
 {
 	PIOS_Assert(queuep->magic == QUEUE_MAGIC);
 
-	pthread_mutex_destroy(&queuep->mutex);
-	pthread_cond_destroy(&queuep->cond);
+	queuep->magic = 0;
 
-	/* XXX free up the queue buf */
-
-	free(queuep);
+	PIOS_free(queuep->cells);
+	PIOS_free(queuep);
 }
 
-static bool PIOS_Queue_Send_Impl(struct pios_queue *queuep,
-		const void *itemp, uint32_t timeout_ms)
+static bool queue_try_send(struct pios_queue *q, const void *itemp)
 {
-	PIOS_Assert(queuep->magic == QUEUE_MAGIC);
-
-	struct timespec abstime;
+	uint32_t pos = __atomic_load_n(&q->send_pos, __ATOMIC_RELAXED);
 
-	if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
-		clock_gettime(CLOCK_REALTIME, &abstime);
+	while (true) {
+		struct queue_cell *cell = queue_cell(q, pos);
+		uint32_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+		int32_t dif = (int32_t) (seq - pos);
 
-		abstime.tv_nsec += (timeout_ms % 1000) * 1000000;
-		abstime.tv_sec += timeout_ms / 1000;
+		if (dif == 0) {
+			uint32_t recv_pos = __atomic_load_n(&q->recv_pos,
+					__ATOMIC_ACQUIRE);
 
-		if (abstime.tv_nsec > 1000000000) {
-			abstime.tv_nsec -= 1000000000;
-			abstime.tv_sec += 1;
-		}
-	}
+			if (pos - recv_pos >= q->q_len) {
+				return false;
+			}
 
-	pthread_mutex_lock(&queuep->mutex);
+			if (__atomic_compare_exchange_n(&q->send_pos, &pos,
+						pos + 1, true, __ATOMIC_RELAXED,
+						__ATOMIC_RELAXED)) {
+				memcpy(cell->data, itemp, q->item_size);
+				__atomic_store_n(&cell->seq, pos + 1,
+						__ATOMIC_RELEASE);
 
-	while (!circ_queue_write_data(queuep->queue, itemp, 1)) {
-		if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
-			if (pthread_cond_timedwait(&queuep->cond,
-					&queuep->mutex, &abstime)) {
-				pthread_mutex_unlock(&queuep->mutex);
-				return false;
+				return true;
 			}
+		} else if (dif < 0) {
+			/* Not yet read on the previous lap: full */
+			return false;
 		} else {
-			pthread_cond_wait(&queuep->cond, &queuep->mutex);
+			pos = __atomic_load_n(&q->send_pos, __ATOMIC_RELAXED);
 		}
 	}
-
-	pthread_cond_broadcast(&queuep->cond);
-
-	pthread_mutex_unlock(&queuep->mutex);
-
-	return true;
 }
 
-bool PIOS_Queue_Send(struct pios_queue *queuep,
-		const void *itemp, uint32_t timeout_ms)
+static bool queue_try_receive(struct pios_queue *q, void *itemp)
 {
-	PIOS_Assert(queuep->magic == QUEUE_MAGIC);
+	uint32_t pos = __atomic_load_n(&q->recv_pos, __ATOMIC_RELAXED);
+
+	while (true) {
+		struct queue_cell *cell = queue_cell(q, pos);
+		uint32_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+		int32_t dif = (int32_t) (seq - (pos + 1));
 
-	if (PIOS_Thread_FakeClock_IsActive()) {
-		uint32_t start = PIOS_Thread_Systime();
+		if (dif == 0) {
+			if (__atomic_compare_exchange_n(&q->recv_pos, &pos,
+						pos + 1, true, __ATOMIC_RELAXED,
+						__ATOMIC_RELAXED)) {
+				memcpy(itemp, cell->data, q->item_size);
+				__atomic_store_n(&cell->seq, pos + q->mask + 1,
+						__ATOMIC_RELEASE);
 
-		do {
-			if (PIOS_Queue_Send_Impl(queuep, itemp, 1)) {
 				return true;
 			}
-		} while ((timeout_ms == PIOS_QUEUE_TIMEOUT_MAX) ||
-				(!PIOS_Thread_Period_Elapsed(start,
-							     timeout_ms)));
-
-		return false;
+		} else if (dif < 0) {
+			/* Not yet written: empty */
+			return false;
+		} else {
+			pos = __atomic_load_n(&q->recv_pos, __ATOMIC_RELAXED);
+		}
 	}
-
-	return PIOS_Queue_Send_Impl(queuep, itemp, timeout_ms);
 }
 
-bool PIOS_Queue_Send_FromISR(struct pios_queue *queuep,
-		const void *itemp, bool *wokenp)
+/* Let the other side know, waking one of its waiters if there are any */
+static void queue_notify(volatile uint32_t *counter, volatile uint32_t *waiters)
 {
-	bool ret = PIOS_Queue_Send(queuep, itemp, 0);
+	__atomic_fetch_add(counter, 1, __ATOMIC_SEQ_CST);
 
-	if (ret && (wokenp)) {
-		*wokenp = true;
+	if (__atomic_load_n(waiters, __ATOMIC_SEQ_CST)) {
+		PIOS_Thread_WakeWord(counter, false);
 	}
-
-	return ret;
 }
 
-static bool PIOS_Queue_Receive_Impl(struct pios_queue *queuep,
-		void *itemp, uint32_t timeout_ms)
+/* Retry an operation until it works or the timeout elapses */
+static bool queue_wait(struct pios_queue *q,
+		bool (*try_op)(struct pios_queue *, void *), void *itemp,
+		volatile uint32_t *counter, volatile uint32_t *waiters,
+		uint32_t timeout_ms)
 {
-	struct timespec abstime;
+	uint32_t start = PIOS_Thread_Systime();
+
+	while (true) {
+		uint32_t val = __atomic_load_n(counter, __ATOMIC_SEQ_CST);
+
+		__atomic_fetch_add(waiters, 1, __ATOMIC_SEQ_CST);
+
+		/* Check again now the other side will see us waiting */
+		if (try_op(q, itemp)) {
+			__atomic_fetch_sub(waiters, 1, __ATOMIC_SEQ_CST);
+			return true;
+		}
 
-	if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
-		clock_gettime(CLOCK_REALTIME, &abstime);
+		bool waited = PIOS_Thread_WaitWord(counter, val, start,
+				timeout_ms);
 
-		abstime.tv_nsec += (timeout_ms % 1000) * 1000000;
-		abstime.tv_sec += timeout_ms / 1000;
+		__atomic_fetch_sub(waiters, 1, __ATOMIC_SEQ_CST);
 
-		if (abstime.tv_nsec > 1000000000) {
-			abstime.tv_nsec -= 1000000000;
-			abstime.tv_sec += 1;
+		if (try_op(q, itemp)) {
+			return true;
+		}
+
+		if (!waited) {
+			return false;
 		}
 	}
+}
 
-	pthread_mutex_lock(&queuep->mutex);
+static bool queue_try_send_op(struct pios_queue *q, void *itemp)
+{
+	return queue_try_send(q, itemp);
+}
 
-	while (!circ_queue_read_data(queuep->queue, itemp, 1)) {
-		if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
-			if (pthread_cond_timedwait(&queuep->cond,
-					&queuep->mutex, &abstime)) {
-				pthread_mutex_unlock(&queuep->mutex);
-				return false;
-			}
-		} else {
-			pthread_cond_wait(&queuep->cond, &queuep->mutex);
+bool PIOS_Queue_Send(struct pios_queue *queuep,
+		const void *itemp, uint32_t timeout_ms)
+{
+	PIOS_Assert(queuep->magic == QUEUE_MAGIC);
+
+	if (!queue_try_send(queuep, itemp)) {
+		if (!timeout_ms || !queue_wait(queuep, queue_try_send_op,
+					(void *) itemp, &queuep->received,
+					&queuep->send_waiters, timeout_ms)) {
+			return false;
 		}
 	}
 
-	pthread_cond_broadcast(&queuep->cond);
+	queue_notify(&queuep->sent, &queuep->recv_waiters);
 
-	pthread_mutex_unlock(&queuep->mutex);
+	PIOS_TRACE(PIOS_TRACE_MASK_QUEUE, PIOS_TRACE_QUEUE_SEND,
+			(uintptr_t) queuep);
 
 	return true;
 }
 
+bool PIOS_Queue_Send_FromISR(struct pios_queue *queuep,
+		const void *itemp, bool *wokenp)
+{
+	bool ret = PIOS_Queue_Send(queuep, itemp, 0);
+
+	if (ret && (wokenp)) {
+		*wokenp = true;
+	}
+
+	return ret;
+}
+
 bool PIOS_Queue_Receive(struct pios_queue *queuep,
 		void *itemp, uint32_t timeout_ms)
 {
 	PIOS_Assert(queuep->magic == QUEUE_MAGIC);
 
-	if (PIOS_Thread_FakeClock_IsActive()) {
-		uint32_t start = PIOS_Thread_Systime();
+	if (!queue_try_receive(queuep, itemp)) {
+		if (!timeout_ms || !queue_wait(queuep, queue_try_receive,
+					itemp, &queuep->sent,
+					&queuep->recv_waiters, timeout_ms)) {
+			return false;
+		}
+	}
 
-		do {
-			if (PIOS_Queue_Receive_Impl(queuep, itemp, 1)) {
-				return true;
-			}
-		} while ((timeout_ms == PIOS_QUEUE_TIMEOUT_MAX) ||
-				(!PIOS_Thread_Period_Elapsed(start,
-							     timeout_ms)));
+	queue_notify(&queuep->received, &queuep->send_waiters);
 
-		return false;
-	}
+	PIOS_TRACE(PIOS_TRACE_MASK_QUEUE, PIOS_TRACE_QUEUE_RECEIVE,
+			(uintptr_t) queuep);
 
-	return PIOS_Queue_Receive_Impl(queuep, itemp, timeout_ms);
+	return true;
 }
 
 size_t PIOS_Queue_GetItemSize(struct pios_queue *queuep)
@@ -23,19 +23,24 @@
  * with this program; if not, see <http://www.gnu.org/licenses/>
  */
 
-#include <pthread.h>
 #include <stdlib.h>
 
 #include <pios.h>
+#include <pios_thread.h>
+#include <pios_thread_posix_priv.h>
 
+/*
+ * A binary semaphore is a flag taken with compare-and-swap.  Takers that
+ * find it taken sleep on a counter bumped by each give, which only makes a
+ * system call if someone is waiting.
+ */
 struct pios_semaphore {
 #define SEMAPHORE_MAGIC 0x616d6553	/* 'Sema' */
 	uint32_t magic;
 
-	pthread_mutex_t mutex;
-	pthread_cond_t cond;
-
-	bool given;
+	volatile uint32_t given;
+	volatile uint32_t gives;	/* Bumped after every give */
+	volatile uint32_t waiters;
 };
 
 struct pios_semaphore *PIOS_Semaphore_Create(void)
@@ -46,83 +51,74 @@ struct pios_semaphore *PIOS_Semaphore_Create(void)
 		return NULL;
 	}
 
-	pthread_mutexattr_t attr;
-
-	if (pthread_mutexattr_init(&attr)) {
-		abort();
-	}
-
-	pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
-
-	if (pthread_mutex_init(&s->mutex, &attr)) {
-		abort();
-	}
-
-	if (pthread_cond_init(&s->cond, NULL)) {
-		abort();
-	}
-
-	s->given = true;
+	s->given = 1;
+	s->gives = 0;
+	s->waiters = 0;
 
 	s->magic = SEMAPHORE_MAGIC;
 
 	return s;
 }
 
+static bool semaphore_try_take(struct pios_semaphore *sema)
+{
+	uint32_t expected = 1;
+
+	return __atomic_compare_exchange_n(&sema->given, &expected, 0, false,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
 bool PIOS_Semaphore_Take(struct pios_semaphore *sema, uint32_t timeout_ms)
 {
 	PIOS_Assert(sema->magic == SEMAPHORE_MAGIC);
 
-        struct timespec abstime;
+	if (semaphore_try_take(sema)) {
+		return true;
+	}
 
-        if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
-                clock_gettime(CLOCK_REALTIME, &abstime);
+	if (!timeout_ms) {
+		return false;
+	}
 
-                abstime.tv_nsec += (timeout_ms % 1000) * 1000000;
-                abstime.tv_sec += timeout_ms / 1000;
+	uint32_t start = PIOS_Thread_Systime();
 
-                if (abstime.tv_nsec > 1000000000) {
-                        abstime.tv_nsec -= 1000000000;
-                        abstime.tv_sec += 1;
-                }
-        }
+	while (true) {
+		uint32_t val = __atomic_load_n(&sema->gives, __ATOMIC_SEQ_CST);
 
-        pthread_mutex_lock(&sema->mutex);
+		__atomic_fetch_add(&sema->waiters, 1, __ATOMIC_SEQ_CST);
 
-        while (!sema->given) {
-                if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
-                        if (pthread_cond_timedwait(&sema->cond,
-                                        &sema->mutex, &abstime)) {
-                                pthread_mutex_unlock(&sema->mutex);
-                                return false;
-                        }
-                } else {
-                        pthread_cond_wait(&sema->cond, &sema->mutex);
-                }
-        }
+		/* Check again now a giver will see us waiting */
+		if (semaphore_try_take(sema)) {
+			__atomic_fetch_sub(&sema->waiters, 1, __ATOMIC_SEQ_CST);
+			return true;
+		}
 
-	sema->given = false;
+		bool waited = PIOS_Thread_WaitWord(&sema->gives, val, start,
+				timeout_ms);
 
-	pthread_mutex_unlock(&sema->mutex);
+		__atomic_fetch_sub(&sema->waiters, 1, __ATOMIC_SEQ_CST);
 
-	return true;
+		if (semaphore_try_take(sema)) {
+			return true;
+		}
+
+		if (!waited) {
+			return false;
+		}
+	}
 }
 
 bool PIOS_Semaphore_Give(struct pios_semaphore *sema)
 {
-	bool old;
-
 	PIOS_Assert(sema->magic == SEMAPHORE_MAGIC);
 
-	pthread_mutex_lock(&sema->mutex);
+	uint32_t old = __atomic_exchange_n(&sema->given, 1, __ATOMIC_RELEASE);
 
-	old = sema->given;
+	__atomic_fetch_add(&sema->gives, 1, __ATOMIC_SEQ_CST);
 
-	sema->given = true;
-
-	pthread_cond_signal(&sema->cond);
-	
-	pthread_mutex_unlock(&sema->mutex);
+	if (__atomic_load_n(&sema->waiters, __ATOMIC_SEQ_CST)) {
+		PIOS_Thread_WakeWord(&sema->gives, false);
+	}
 
 	return !old;
 }
@@ -8,7 +8,7 @@
  *
  * @file       pios_spi.c
  * @author     dRonin, http://dronin.org, Copyright (C) 2016
- * @brief      Driver for Linux spidev interface
+ * @brief      Driver for Linux spidev interface, and a simulated MPU-6000
  * @see        The GNU Public License (GPL) Version 3
  * @notes
  *
@@ -33,11 +33,35 @@
 #include <stdio.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <sys/ioctl.h>
 #include <linux/types.h>
 #include <linux/spi/spidev.h>
 
 #include <pios_spi_posix_priv.h>
+#include <pios_mpu_priv.h>
+
+#define SIM_MPU_WHOAMI 0x68
+#define SIM_MPU_FIFO_SIZE 1024
+
+/**
+ * Enough of an MPU-6000 to exercise the driver: the register file, the
+ * data registers, and a FIFO that overflows like the real one does.
+ */
+struct sim_mpu {
+	pthread_mutex_t lock;
+
+	uint8_t regs[128];
+
+	uint8_t fifo[SIM_MPU_FIFO_SIZE];
+	uint16_t fifo_head;
+	uint16_t fifo_count;
+
+	/* State of the transaction in progress */
+	uint8_t addr;
+	bool reading;
+	bool addressed;
+};
 
 struct pios_spi_dev {
 	const struct pios_spi_cfg *cfg;
@@ -48,8 +72,206 @@ struct pios_spi_dev {
 	int fd[SPI_MAX_SUBDEV];
 
 	int selected;
+
+	struct sim_mpu *sim;
 };
 
+static void sim_mpu_reset(struct sim_mpu *sim)
+{
+	memset(sim->regs, 0, sizeof(sim->regs));
+
+	sim->regs[PIOS_MPU_WHOAMI] = SIM_MPU_WHOAMI;
+	sim->regs[PIOS_MPU_PWR_MGMT_REG] = 0x40;	/* Asleep */
+
+	sim->fifo_head = 0;
+	sim->fifo_count = 0;
+}
+
+static void sim_mpu_fifo_push(struct sim_mpu *sim, const uint8_t *data,
+		int len)
+{
+	for (int i = 0; i < len; i++) {
+		if (sim->fifo_count == SIM_MPU_FIFO_SIZE) {
+			/* Full; the oldest byte is lost */
+			sim->fifo_head = (sim->fifo_head + 1) % SIM_MPU_FIFO_SIZE;
+			sim->fifo_count--;
+
+			sim->regs[PIOS_MPU_INT_STATUS_REG] |=
+				PIOS_MPU_INT_STATUS_OVERFLOW;
+		}
+
+		sim->fifo[(sim->fifo_head + sim->fifo_count) %
+			SIM_MPU_FIFO_SIZE] = data[i];
+		sim->fifo_count++;
+	}
+}
+
+static uint8_t sim_mpu_read(struct sim_mpu *sim, uint8_t reg)
+{
+	uint8_t val;
+
+	switch (reg) {
+	case PIOS_MPU_FIFO_CNT_MSB:
+		return sim->fifo_count >> 8;
+	case PIOS_MPU_FIFO_CNT_LSB:
+		return sim->fifo_count & 0xff;
+	case PIOS_MPU_FIFO_REG:
+		if (!sim->fifo_count) {
+			return 0;
+		}
+
+		val = sim->fifo[sim->fifo_head];
+		sim->fifo_head = (sim->fifo_head + 1) % SIM_MPU_FIFO_SIZE;
+		sim->fifo_count--;
+
+		return val;
+	case PIOS_MPU_INT_STATUS_REG:
+		/* Cleared by reading */
+		val = sim->regs[reg];
+		sim->regs[reg] = 0;
+
+		return val;
+	default:
+		return sim->regs[reg & 0x7f];
+	}
+}
+
+static void sim_mpu_write(struct sim_mpu *sim, uint8_t reg, uint8_t val)
+{
+	switch (reg) {
+	case PIOS_MPU_PWR_MGMT_REG:
+		if (val & PIOS_MPU_PWRMGMT_IMU_RST) {
+			sim_mpu_reset(sim);
+			return;
+		}
+		break;
+	case PIOS_MPU_USER_CTRL_REG:
+		if (val & PIOS_MPU_USERCTL_FIFO_RST) {
+			sim->fifo_head = 0;
+			sim->fifo_count = 0;
+		}
+
+		val &= ~(PIOS_MPU_USERCTL_FIFO_RST | PIOS_MPU_USERCTL_GYRO_RST);
+		break;
+	case PIOS_MPU_WHOAMI:
+		return;
+	}
+
+	sim->regs[reg & 0x7f] = val;
+}
+
+static void sim_mpu_transfer(struct sim_mpu *sim, const uint8_t *send,
+		uint8_t *receive, uint16_t len)
+{
+	pthread_mutex_lock(&sim->lock);
+
+	for (int i = 0; i < len; i++) {
+		uint8_t b = send ? send[i] : 0xff;
+		uint8_t out = 0;
+
+		if (!sim->addressed) {
+			sim->addr = b & 0x7f;
+			sim->reading = b & 0x80;
+			sim->addressed = true;
+		} else if (sim->reading) {
+			out = sim_mpu_read(sim, sim->addr);
+
+			/* Bursts walk the registers, but not off the FIFO */
+			if (sim->addr != PIOS_MPU_FIFO_REG) {
+				sim->addr++;
+			}
+		} else {
+			sim_mpu_write(sim, sim->addr, b);
+			sim->addr++;
+		}
+
+		if (receive) {
+			receive[i] = out;
+		}
+	}
+
+	pthread_mutex_unlock(&sim->lock);
+}
+
+/**
+ * Takes a sample on the simulated MPU: updates the data registers, queues
+ * it in the FIFO if that's enabled, and raises the data ready interrupt.
+ *
+ * @param[in] spi_dev a bus set up on PIOS_SPI_SIM_MPU_PATH
+ * @param[in] accel raw accel x, y, z, in the sensor's frame
+ * @param[in] temperature raw temperature
+ * @param[in] gyro raw gyro x, y, z, in the sensor's frame
+ * @returns 0 on success, -1 if the bus isn't simulated
+ */
+int32_t PIOS_SPI_SimMPU_Sample(pios_spi_t spi_dev, const int16_t accel[3],
+		int16_t temperature, const int16_t gyro[3])
+{
+	struct sim_mpu *sim = spi_dev->sim;
+
+	if (!sim) {
+		return -1;
+	}
+
+	const int16_t sample[7] = {
+		accel[0], accel[1], accel[2],
+		temperature,
+		gyro[0], gyro[1], gyro[2]
+	};
+
+	uint8_t raw[sizeof(sample)];
+
+	for (int i = 0; i < NELEMENTS(sample); i++) {
+		raw[2 * i] = (uint16_t) sample[i] >> 8;
+		raw[2 * i + 1] = sample[i] & 0xff;
+	}
+
+	pthread_mutex_lock(&sim->lock);
+
+	memcpy(&sim->regs[PIOS_MPU_ACCEL_X_OUT_MSB], raw, sizeof(raw));
+
+	if (sim->regs[PIOS_MPU_USER_CTRL_REG] & PIOS_MPU_USERCTL_FIFO_EN) {
+		uint8_t fifo_en = sim->regs[PIOS_MPU_FIFO_EN_REG];
+
+		/* Queued in register order */
+		if (fifo_en & PIOS_MPU_ACCEL_OUT) {
+			sim_mpu_fifo_push(sim, &raw[0], 6);
+		}
+
+		if (fifo_en & PIOS_MPU_FIFO_TEMP_OUT) {
+			sim_mpu_fifo_push(sim, &raw[6], 2);
+		}
+
+		if (fifo_en & PIOS_MPU_FIFO_GYRO_X_OUT) {
+			sim_mpu_fifo_push(sim, &raw[8], 2);
+		}
+
+		if (fifo_en & PIOS_MPU_FIFO_GYRO_Y_OUT) {
+			sim_mpu_fifo_push(sim, &raw[10], 2);
+		}
+
+		if (fifo_en & PIOS_MPU_FIFO_GYRO_Z_OUT) {
+			sim_mpu_fifo_push(sim, &raw[12], 2);
+		}
+	}
+
+	sim->regs[PIOS_MPU_INT_STATUS_REG] |= PIOS_MPU_INT_STATUS_DATA_RDY;
+
+	bool interrupt = sim->regs[PIOS_MPU_INT_EN_REG] &
+		PIOS_MPU_INTEN_DATA_RDY;
+
+	pthread_mutex_unlock(&sim->lock);
+
+#ifdef PIOS_INCLUDE_MPU
+	if (interrupt) {
+		PIOS_MPU_IRQHandler();
+	}
+#else
+	(void) interrupt;
+#endif
+
+	return 0;
+}
+
 static bool PIOS_SPI_validate(struct pios_spi_dev *com_dev)
 {
 	return true;
@@ -75,6 +297,22 @@ int32_t PIOS_SPI_Init(pios_spi_t *spi_id, const struct pios_spi_cfg *cfg)
 
 	spi_dev->busy = PIOS_Semaphore_Create();
 	spi_dev->slave_count = 0;
+	spi_dev->sim = NULL;
+
+	if (!strcmp(cfg->base_path, PIOS_SPI_SIM_MPU_PATH)) {
+		spi_dev->sim = PIOS_malloc(sizeof(*spi_dev->sim));
+		if (!spi_dev->sim) goto out_fail;
+
+		pthread_mutex_init(&spi_dev->sim->lock, NULL);
+		sim_mpu_reset(spi_dev->sim);
+
+		spi_dev->slave_count = 1;
+		spi_dev->selected = -1;
+
+		*spi_id = spi_dev;
+
+		return 0;
+	}
 
 	for (int i = 0; i < SPI_MAX_SUBDEV; i++) {
 		char path[PATH_MAX + 2];
@@ -152,6 +390,14 @@ int32_t PIOS_SPI_RC_PinSet(pios_spi_t spi_dev, uint32_t slave_id, bool pin_value
 	PIOS_Assert(valid);
 	PIOS_Assert(slave_id < spi_dev->slave_count);
 
+	if (spi_dev->sim) {
+		/* Each selection starts a new transaction */
+		spi_dev->sim->addressed = false;
+		spi_dev->selected = pin_value ? -1 : slave_id;
+
+		return 0;
+	}
+
         struct spi_ioc_transfer xfer = {
 		.delay_usecs = 1,
 	};
@@ -197,6 +443,12 @@ int32_t PIOS_SPI_TransferBlock(pios_spi_t spi_dev, const uint8_t *send_buffer, u
 	PIOS_Assert(slave_id < spi_dev->slave_count);
 	PIOS_Assert(slave_id >= 0);
 
+	if (spi_dev->sim) {
+		sim_mpu_transfer(spi_dev->sim, send_buffer, receive_buffer, len);
+
+		return 0;
+	}
+
         struct spi_ioc_transfer xfer = {
 		.rx_buf = (uintptr_t) receive_buffer,
 		.tx_buf = (uintptr_t) send_buffer,
@@ -107,7 +107,7 @@ int orig_stdout;
 static void Usage(char *cmdName) {
 	printf( "usage: %s [-f] [-r] [-m orientation] [-p proto] [-s spibase]\n"
 		"\t\t[-d drvname:bus:id] [-l logfile] [-I i2cdev] [-i drvname:bus]\n"
-		"\t\t[-g port] [-c confflash] [-x time] -!\n"
+		"\t\t[-g port] [-c confflash] [-x time] [-R stream] [-F speed] -!\n"
 		"\n"
 #if !(defined(_WIN32) || defined(WIN32) || defined(__MINGW32__))
 		"\t-f\t\t\tEnables floating point exception trapping mode\n"
@@ -121,6 +121,10 @@ static void Usage(char *cmdName) {
 #ifdef PIOS_INCLUDE_SIMSENSORS_YASIM
 		"\t-y\t\t\tUse an external simulator (drhil yasim)\n"
 #endif
+#ifdef PIOS_INCLUDE_SIMSENSORS
+		"\t-R stream\t\tReplay a recorded sensor stream, on a fake clock\n"
+		"\t-F speed\t\tReplay speed, relative to real time\n"
+#endif
 #if !(defined(_WIN32) || defined(WIN32) || defined(__MINGW32__))
 		"\t-x time\t\t\tExit after time seconds\n"
 #endif
@@ -488,6 +492,11 @@ static char **saved_argv;
 bool use_yasim;
 #endif
 
+#ifdef PIOS_INCLUDE_SIMSENSORS
+const char *replay_path;
+float replay_speed = 1;
+#endif
+
 void PIOS_SYS_Args(int argc, char *argv[]) {
 	saved_argc = argc;
 	saved_argv = argv;
@@ -496,7 +505,7 @@ void PIOS_SYS_Args(int argc, char *argv[]) {
 
 	bool hw_argseen = true;
 
-	while ((opt = getopt(argc, argv, "!yfrx:g:l:s:d:S:I:i:m:c:p:")) != -1) {
+	while ((opt = getopt(argc, argv, "!yfrx:g:l:s:d:S:I:i:m:c:p:R:F:")) != -1) {
 		switch (opt) {
 #ifdef PIOS_INCLUDE_SIMSENSORS_YASIM
 			case 'y':
@@ -506,6 +515,21 @@ void PIOS_SYS_Args(int argc, char *argv[]) {
 			case '!':
 				PIOS_Thread_FakeClock_Tick();
 				break;
+#ifdef PIOS_INCLUDE_SIMSENSORS
+			case 'R':
+				/* The replay advances the fake clock itself */
+				replay_path = optarg;
+				PIOS_Thread_FakeClock_Tick();
+				break;
+			case 'F':
+				replay_speed = atof(optarg);
+
+				if (!(replay_speed > 0)) {
+					printf("Replay speed must be positive\n");
+					exit(1);
+				}
+				break;
+#endif
 			case 'c':
 				PIOS_Flash_Posix_SetFName(optarg);
 				break;
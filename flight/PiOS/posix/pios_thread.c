@@ -27,10 +27,18 @@
 #include <pthread.h>
 #include <unistd.h>
 
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
 #include <pios.h>
 #include <pios_thread.h>
+#include <pios_thread_posix_priv.h>
 
+#ifdef PIOS_INCLUDE_FAKETICK
 #include <hwsimulation.h>
+#endif
 
 bool __attribute__((weak)) are_realtime;
 
@@ -39,6 +47,8 @@ struct pios_thread
 	pthread_t thread;
 
 	const char *name;
+
+	uint64_t runtime_us;	/* CPU time consumed as of the last query */
 };
 
 /**
@@ -59,6 +69,7 @@ struct pios_thread *PIOS_Thread_WrapCurrentThread(const char *namep)
 	thread->thread = pthread_self();
 
 	thread->name = namep;
+	thread->runtime_us = 0;
 
 	if (are_realtime) {
 		struct sched_param param = {
@@ -72,6 +83,10 @@ struct pios_thread *PIOS_Thread_WrapCurrentThread(const char *namep)
 	pthread_setname_np(thread->thread, thread->name);
 #endif
 
+#if defined(PIOS_INCLUDE_TRACE)
+	PIOS_Trace_AddTask((uintptr_t) thread->thread, thread->name);
+#endif
+
 	return thread;
 }
 
@@ -108,6 +123,7 @@ struct pios_thread *PIOS_Thread_Create(void (*fp)(void *), const char *namep, si
 	}
 
 	thread->name = namep;
+	thread->runtime_us = 0;
 
 	void *(*thr_func)(void *) = (void *) fp;
 
@@ -124,6 +140,10 @@ struct pios_thread *PIOS_Thread_Create(void (*fp)(void *), const char *namep, si
 	pthread_setname_np(thread->thread, thread->name);
 #endif
 
+#if defined(PIOS_INCLUDE_TRACE)
+	PIOS_Trace_AddTask((uintptr_t) thread->thread, thread->name);
+#endif
+
 	printf("Started thread (%s) p=%p\n", namep, &thread->thread);
 
 	return thread;
@@ -157,6 +177,163 @@ static inline uint32_t PIOS_Thread_GetClock_Impl()
 	return monotime.tv_sec * 1000 + monotime.tv_nsec / 1000000;
 }
 
+/* Waiters with a timeout while the fake clock runs.  Their deadline is in
+ * fake time, so the tick wakes them once it passes.  Protected by
+ * fake_clock_mutex.
+ */
+struct fake_waiter {
+	volatile uint32_t *word;
+	uint32_t start;
+	uint32_t timeout_ms;
+
+	struct fake_waiter *next;
+};
+
+static struct fake_waiter *fake_waiters;
+
+#ifdef __linux__
+static void word_wait(volatile uint32_t *word, uint32_t val,
+		const struct timespec *timeout)
+{
+	syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, val, timeout, NULL, 0);
+}
+
+static void word_wake(volatile uint32_t *word, bool all)
+{
+	syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, all ? INT32_MAX : 1,
+			NULL, NULL, 0);
+}
+#else
+/* No futexes; one condition variable stands in for all the words */
+static pthread_mutex_t word_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t word_cond = PTHREAD_COND_INITIALIZER;
+
+static void word_wait(volatile uint32_t *word, uint32_t val,
+		const struct timespec *timeout)
+{
+	struct timespec abstime;
+
+	if (timeout) {
+		clock_gettime(CLOCK_REALTIME, &abstime);
+
+		abstime.tv_sec += timeout->tv_sec;
+		abstime.tv_nsec += timeout->tv_nsec;
+
+		if (abstime.tv_nsec >= 1000000000) {
+			abstime.tv_nsec -= 1000000000;
+			abstime.tv_sec += 1;
+		}
+	}
+
+	pthread_mutex_lock(&word_mutex);
+
+	if (*word == val) {
+		if (timeout) {
+			pthread_cond_timedwait(&word_cond, &word_mutex,
+					&abstime);
+		} else {
+			pthread_cond_wait(&word_cond, &word_mutex);
+		}
+	}
+
+	pthread_mutex_unlock(&word_mutex);
+}
+
+static void word_wake(volatile uint32_t *word, bool all)
+{
+	(void) word;
+	(void) all;
+
+	/* Taking the mutex orders this against a waiter checking the word */
+	pthread_mutex_lock(&word_mutex);
+	pthread_cond_broadcast(&word_cond);
+	pthread_mutex_unlock(&word_mutex);
+}
+#endif
+
+/**
+ * @brief Blocks while a word holds a value, like a futex wait.
+ *
+ * The word is changed and PIOS_Thread_WakeWord() called to wake waiters.
+ * Wakeups can be spurious, so callers check their condition again and
+ * call this in a loop with the same start and timeout.
+ *
+ * @param[in] word the word to wait on
+ * @param[in] val the value it held when the caller last checked
+ * @param[in] start PIOS_Thread_Systime() when the caller began waiting
+ * @param[in] timeout_ms how long to wait in all, may be
+ * PIOS_THREAD_TIMEOUT_MAX
+ *
+ * @returns false if the timeout had already elapsed, true otherwise
+ */
+bool PIOS_Thread_WaitWord(volatile uint32_t *word, uint32_t val,
+		uint32_t start, uint32_t timeout_ms)
+{
+	if (timeout_ms == PIOS_THREAD_TIMEOUT_MAX) {
+		word_wait(word, val, NULL);
+
+		return true;
+	}
+
+	if (PIOS_Thread_Period_Elapsed(start, timeout_ms)) {
+		return false;
+	}
+
+	if (fake_clock) {
+		struct fake_waiter waiter = {
+			.word = word,
+			.start = start,
+			.timeout_ms = timeout_ms,
+		};
+
+		pthread_mutex_lock(&fake_clock_mutex);
+		waiter.next = fake_waiters;
+		fake_waiters = &waiter;
+		pthread_mutex_unlock(&fake_clock_mutex);
+
+		/* The tick changes the word when the deadline passes, so
+		 * this cannot sleep through it.
+		 */
+		word_wait(word, val, NULL);
+
+		pthread_mutex_lock(&fake_clock_mutex);
+
+		struct fake_waiter **w = &fake_waiters;
+
+		while (*w != &waiter) {
+			w = &(*w)->next;
+		}
+
+		*w = waiter.next;
+
+		pthread_mutex_unlock(&fake_clock_mutex);
+
+		return true;
+	}
+
+	uint32_t remaining = timeout_ms - (PIOS_Thread_Systime() - start);
+
+	struct timespec timeout = {
+		.tv_sec = remaining / 1000,
+		.tv_nsec = (remaining % 1000) * 1000000,
+	};
+
+	word_wait(word, val, &timeout);
+
+	return true;
+}
+
+/**
+ * @brief Wakes threads waiting on a word, after it has been changed.
+ *
+ * @param[in] word the word
+ * @param[in] all wake every waiter rather than one
+ */
+void PIOS_Thread_WakeWord(volatile uint32_t *word, bool all)
+{
+	word_wake(word, all);
+}
+
 #ifdef PIOS_INCLUDE_FAKETICK
 static volatile uint32_t fake_tick_barrier;
 
@@ -200,6 +377,13 @@ void PIOS_Thread_FakeClock_Tick(void)
 
 	pthread_cond_broadcast(&fake_clock_cond);
 
+	for (struct fake_waiter *w = fake_waiters; w; w = w->next) {
+		if (PIOS_Thread_Period_Elapsed(w->start, w->timeout_ms)) {
+			__atomic_fetch_add(w->word, 1, __ATOMIC_SEQ_CST);
+			word_wake(w->word, true);
+		}
+	}
+
 	pthread_mutex_unlock(&fake_clock_mutex);
 }
 #endif
@@ -273,9 +457,36 @@ uint32_t PIOS_Thread_Get_Stack_Usage(struct pios_thread *threadp)
 	return 0;	/* XXX */
 }
 
+/**
+ * @brief Returns the CPU time a thread has used since the last call.
+ *
+ * @param[in] threadp the thread
+ *
+ * @returns CPU time in microseconds, in the same units as
+ * PIOS_DELAY_GetRaw() so TaskMonitor can scale it to a percentage
+ */
 uint32_t PIOS_Thread_Get_Runtime(struct pios_thread *threadp)
 {
+#ifdef __linux__
+	clockid_t cid;
+	struct timespec cputime;
+
+	if (pthread_getcpuclockid(threadp->thread, &cid) ||
+			clock_gettime(cid, &cputime)) {
+		return 0;
+	}
+
+	uint64_t now_us = cputime.tv_sec * 1000000ULL + cputime.tv_nsec / 1000;
+	uint32_t result = now_us - threadp->runtime_us;
+
+	threadp->runtime_us = now_us;
+
+	return result;
+#else
+	(void) threadp;
+
 	return 0;	/* XXX */
+#endif
 }
 
 bool PIOS_Thread_Period_Elapsed(const uint32_t prev_systime,
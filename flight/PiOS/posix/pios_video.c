@@ -0,0 +1,190 @@
+/**
+ ******************************************************************************
+ * @addtogroup PIOS PIOS Core hardware abstraction layer
+ * @{
+ * @addtogroup PIOS_VIDEO Code for OSD video generator
+ * @brief Headless video framebuffer for running the OSD on a host
+ * @{
+ *
+ * @file       pios_video.c
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2016
+ * @brief      Double buffered framebuffer, with vsync driven by the caller
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "pios_config.h"
+
+#if defined(PIOS_INCLUDE_VIDEO)
+
+#include "pios.h"
+#include "pios_video.h"
+#include "pios_semaphore.h"
+
+extern struct pios_semaphore * onScreenDisplaySemaphore;
+
+static const struct pios_video_type_boundary pios_video_type_boundary_ntsc = {
+	.graphics_right  = 351,         // must be: graphics_width_real - 1
+	.graphics_bottom = 239,         // must be: graphics_height_real - 1
+};
+
+static const struct pios_video_type_boundary pios_video_type_boundary_pal = {
+	.graphics_right  = 359,         // must be: graphics_width_real - 1
+	.graphics_bottom = 265,         // must be: graphics_height_real - 1
+};
+
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+static uint8_t buffer0_level[BUFFER_HEIGHT * BUFFER_WIDTH] __attribute__((aligned(4)));
+static uint8_t buffer0_mask[BUFFER_HEIGHT * BUFFER_WIDTH] __attribute__((aligned(4)));
+static uint8_t buffer1_level[BUFFER_HEIGHT * BUFFER_WIDTH] __attribute__((aligned(4)));
+static uint8_t buffer1_mask[BUFFER_HEIGHT * BUFFER_WIDTH] __attribute__((aligned(4)));
+
+// Pointers to each of these buffers.
+uint8_t *draw_buffer_level;
+uint8_t *draw_buffer_mask;
+uint8_t *disp_buffer_level;
+uint8_t *disp_buffer_mask;
+#else
+static uint8_t buffer0[BUFFER_HEIGHT * BUFFER_WIDTH] __attribute__((aligned(4)));
+static uint8_t buffer1[BUFFER_HEIGHT * BUFFER_WIDTH] __attribute__((aligned(4)));
+
+// Pointers to each of these buffers.
+uint8_t *draw_buffer;
+uint8_t *disp_buffer;
+#endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+
+const struct pios_video_type_boundary *pios_video_type_boundary_act = &pios_video_type_boundary_pal;
+
+static enum pios_video_system video_system_act = PIOS_VIDEO_SYSTEM_NONE;
+
+/**
+ * @brief Vsync "interrupt": there is no video signal, so whoever drives the
+ * framebuffer calls this once per frame. Swaps the buffers and wakes the OSD
+ * task just like the hardware drivers do.
+ */
+bool PIOS_Vsync_ISR()
+{
+	uint8_t *tmp;
+
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+	SWAP_BUFFS(tmp, disp_buffer_mask, draw_buffer_mask);
+	SWAP_BUFFS(tmp, disp_buffer_level, draw_buffer_level);
+#else
+	SWAP_BUFFS(tmp, disp_buffer, draw_buffer);
+#endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+
+	bool woken = false;
+	if (onScreenDisplaySemaphore != NULL) {
+		PIOS_Semaphore_Give_FromISR(onScreenDisplaySemaphore, &woken);
+	}
+
+	return woken;
+}
+
+/**
+ * Init
+ */
+void PIOS_Video_Init(const struct pios_video_cfg *cfg)
+{
+	video_system_act = cfg->system;
+
+	if (video_system_act == PIOS_VIDEO_SYSTEM_NTSC) {
+		pios_video_type_boundary_act = &pios_video_type_boundary_ntsc;
+	} else {
+		pios_video_type_boundary_act = &pios_video_type_boundary_pal;
+	}
+
+#if defined(PIOS_VIDEO_SPLITBUFFER)
+	draw_buffer_level = buffer0_level;
+	draw_buffer_mask  = buffer0_mask;
+	disp_buffer_level = buffer1_level;
+	disp_buffer_mask  = buffer1_mask;
+
+	memset(draw_buffer_mask, 0, BUFFER_HEIGHT * BUFFER_WIDTH);
+	memset(draw_buffer_level, 0, BUFFER_HEIGHT * BUFFER_WIDTH);
+	memset(disp_buffer_mask, 0, BUFFER_HEIGHT * BUFFER_WIDTH);
+	memset(disp_buffer_level, 0, BUFFER_HEIGHT * BUFFER_WIDTH);
+#else
+	draw_buffer = buffer0;
+	disp_buffer = buffer1;
+
+	memset(draw_buffer, 0, BUFFER_HEIGHT * BUFFER_WIDTH);
+	memset(disp_buffer, 0, BUFFER_HEIGHT * BUFFER_WIDTH);
+#endif /* defined(PIOS_VIDEO_SPLITBUFFER) */
+}
+
+/**
+ * Number of visible lines of the pretend video system
+ */
+uint16_t PIOS_Video_GetLines(void)
+{
+	return pios_video_type_boundary_act->graphics_bottom + 1;
+}
+
+/**
+ *
+ */
+enum pios_video_system PIOS_Video_GetSystem(void)
+{
+	return video_system_act;
+}
+
+/**
+*  Set the black and white levels
+*/
+void PIOS_Video_SetLevels(uint8_t black, uint8_t white)
+{
+	// Not supported by this driver
+}
+
+/**
+*  Set the offset in x direction
+*/
+void PIOS_Video_SetXOffset(int8_t x_offset_in)
+{
+	// Not supported by this driver
+}
+
+/**
+*  Set the offset in y direction
+*/
+void PIOS_Video_SetYOffset(int8_t y_offset_in)
+{
+	// Not supported by this driver
+}
+
+/**
+*  Set the x scale
+*/
+void PIOS_Video_SetXScale(uint8_t x_scale)
+{
+	// Not supported by this driver
+}
+
+/**
+*  Set the 3D mode configuration
+*/
+void PIOS_Video_Set3DConfig(enum pios_video_3d_mode mode, uint8_t right_eye_x_shift)
+{
+	// Not supported by this driver
+}
+#endif /* PIOS_INCLUDE_VIDEO */
+
+/**
+ * @}
+ * @}
+ */
@@ -164,7 +164,11 @@ bool UAVObjIsMetaobject(UAVObjHandle obj);
 bool UAVObjIsSettings(UAVObjHandle obj);
 int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId, const uint8_t* dataIn);
 int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t* dataOut);
+int32_t UAVObjGetInstanceCRC(UAVObjHandle obj_handle, uint16_t instId, uint32_t *crc);
+uint32_t UAVObjGetSettingsCRC();
 int32_t UAVObjSave(UAVObjHandle obj_handle, uint16_t instId);
+int32_t UAVObjSaveBatch(const UAVObjHandle *obj_handles,
+		const uint16_t *inst_ids, uint16_t num_objs);
 int32_t UAVObjLoad(UAVObjHandle obj_handle, uint16_t instId);
 int32_t UAVObjDeleteById(uint32_t obj_id, uint16_t inst_id);
 #if defined(PIOS_INCLUDE_SDCARD)
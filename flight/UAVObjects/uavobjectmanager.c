@@ -716,6 +716,102 @@ unlock_exit:
 	return rc;
 }
 
+/**
+ * Get the CRC of an instance's data, so a copy held elsewhere (e.g. by the
+ * GCS) can be checked against it without sending the data.
+ * \param[in] obj The object handle
+ * \param[in] instId The instance ID
+ * \param[out] crc The CRC32 of the packed instance data
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjGetInstanceCRC(UAVObjHandle obj_handle, uint16_t instId,
+		uint32_t *crc)
+{
+	PIOS_Assert(obj_handle);
+
+	// Lock
+	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+
+	int32_t rc = -1;
+
+	if (UAVObjIsMetaobject(obj_handle)) {
+		if (instId != 0) {
+			goto unlock_exit;
+		}
+		*crc = PIOS_CRC32_updateCRC(0,
+				(uint8_t *) MetaDataPtr((struct UAVOMeta *)obj_handle),
+				MetaNumBytes);
+	} else {
+		struct UAVOData *obj;
+		InstanceHandle instEntry;
+
+		// Cast handle to object
+		obj = (struct UAVOData *) obj_handle;
+
+		// Get the instance
+		instEntry = getInstance(obj, instId);
+		if (instEntry == NULL) {
+			goto unlock_exit;
+		}
+		*crc = PIOS_CRC32_updateCRC(0, InstanceData(instEntry),
+				obj->instance_size);
+	}
+
+	rc = 0;
+
+unlock_exit:
+	PIOS_Recursive_Mutex_Unlock(mutex);
+	return rc;
+}
+
+/**
+ * Get one CRC over all the settings: over the object ID, instance ID and
+ * instance CRC of every settings object instance, in registration order.
+ * It changes whenever any setting does.
+ * \return The aggregate CRC
+ */
+uint32_t UAVObjGetSettingsCRC()
+{
+	struct UAVOData *obj;
+	uint32_t crc = 0;
+
+	// Get lock
+	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+
+	LL_FOREACH(uavo_list, obj) {
+		if (!UAVObjIsSettings(&obj->base)) {
+			continue;
+		}
+
+		uint16_t num_instances = UAVObjGetNumInstances(&obj->base);
+
+		for (uint16_t inst_id = 0; inst_id < num_instances; inst_id++) {
+			uint32_t inst_crc;
+
+			if (UAVObjGetInstanceCRC(&obj->base, inst_id, &inst_crc)) {
+				continue;
+			}
+
+			struct {
+				uint32_t obj_id;
+				uint16_t inst_id;
+				uint32_t crc;
+			} __attribute__((packed)) entry = {
+				.obj_id = obj->id,
+				.inst_id = inst_id,
+				.crc = inst_crc,
+			};
+
+			crc = PIOS_CRC32_updateCRC(crc, (uint8_t *) &entry,
+					sizeof(entry));
+		}
+	}
+
+	// Release lock
+	PIOS_Recursive_Mutex_Unlock(mutex);
+	return crc;
+}
+
 #if defined(PIOS_INCLUDE_FASTHEAP)
 /**
  * Trampoline buffer used for loads from the underlying filesystem.
@@ -802,6 +898,79 @@ int32_t UAVObjSave(UAVObjHandle obj_handle, uint16_t instId)
 	return 0;
 }
 
+/**
+ * Save several object instances to the file system, in one flash
+ * transaction.  Their data is snapshotted into one buffer from the (DMA
+ * capable) heap first, so the batch is consistent and doesn't need the
+ * save trampoline.
+ * @param[in] obj_handles The object handles
+ * @param[in] inst_ids The instance ID of each object
+ * @param[in] num_objs How many objects to save; each instance at most once
+ * @return 0 if success or -1 if failure
+ */
+int32_t UAVObjSaveBatch(const UAVObjHandle *obj_handles,
+		const uint16_t *inst_ids, uint16_t num_objs)
+{
+	size_t data_size = 0;
+
+	for (uint16_t i = 0; i < num_objs; i++) {
+		PIOS_Assert(obj_handles[i]);
+
+		data_size += UAVObjGetNumBytes(obj_handles[i]);
+	}
+
+	struct pios_flashfs_obj *objs =
+		PIOS_malloc(num_objs * sizeof(*objs) + data_size);
+
+	if (!objs) {
+		return -1;
+	}
+
+	uint8_t *data = (uint8_t *) &objs[num_objs];
+	int32_t rc = -1;
+
+	for (uint16_t i = 0; i < num_objs; i++) {
+		UAVObjHandle obj_handle = obj_handles[i];
+		const void *src;
+
+		if (UAVObjIsMetaobject(obj_handle)) {
+			if (inst_ids[i] != 0)
+				goto out_free;
+
+			src = MetaDataPtr((struct UAVOMeta *)obj_handle);
+		} else {
+			InstanceHandle instEntry = getInstance(
+					(struct UAVOData *)obj_handle, inst_ids[i]);
+
+			if (instEntry == NULL)
+				goto out_free;
+
+			src = InstanceData(instEntry);
+
+			if (src == NULL)
+				goto out_free;
+		}
+
+		objs[i].obj_id = UAVObjGetID(obj_handle);
+		objs[i].obj_inst_id = inst_ids[i];
+		objs[i].obj_size = UAVObjGetNumBytes(obj_handle);
+		objs[i].obj_data = data;
+
+		memcpy(data, src, objs[i].obj_size);
+		data += objs[i].obj_size;
+	}
+
+	if (PIOS_FLASHFS_ObjSaveBatch(pios_uavo_settings_fs_id, objs,
+				num_objs) == 0) {
+		rc = 0;
+	}
+
+out_free:
+	PIOS_free(objs);
+
+	return rc;
+}
+
 #if defined(PIOS_INCLUDE_FASTHEAP)
 /**
  * Trampoline buffer used for loads from the underlying filesystem.
@@ -1723,6 +1892,9 @@ static void invokeCallback(const struct ObjectEventEntry *event,
 #endif
 
 static int32_t pumpOneEvent(UAVObjEvent *msg, void *obj_data, int len) {
+	PIOS_TRACE(PIOS_TRACE_MASK_EVENT, PIOS_TRACE_EVENT_BEGIN,
+			UAVObjGetID(msg->obj));
+
 	// Go through each object and push the event message in the queue (if event is activated for the queue)
 	struct ObjectEventEntry *event;
 	LL_FOREACH(msg->obj->next_event, event) {
@@ -1778,6 +1950,9 @@ static int32_t pumpOneEvent(UAVObjEvent *msg, void *obj_data, int len) {
 		}
 	}
 
+	PIOS_TRACE(PIOS_TRACE_MASK_EVENT, PIOS_TRACE_EVENT_END,
+			UAVObjGetID(msg->obj));
+
 	return 0;
 }
 
@@ -57,6 +57,7 @@
 #define PIOS_INCLUDE_RANGEFINDER
 #define PIOS_INCLUDE_INITCALL           /* Include init call structures */
 #define PIOS_INCLUDE_RTC
+#define PIOS_INCLUDE_TRACE              /* Execution tracing, see LoggingSettings.Trace */
 
 #define PIOS_RCVR_MAX_CHANNELS			12
 
@@ -3,4 +3,6 @@
 
 #define PIOS_INCLUDE_DSM
 #define PIOS_INCLUDE_RTC
+#define PIOS_INCLUDE_RCVR
+#define PIOS_INCLUDE_FAKETICK
 #define PIOS_DSM_NUM_INPUTS 12
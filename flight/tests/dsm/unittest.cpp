@@ -36,9 +36,17 @@
 #include <stdlib.h>		/* abort */
 #include <string.h>		/* memset */
 #include <stdint.h>		/* uint*_t */
+#include <pthread.h>		/* pthread_create */
+#include <time.h>		/* clock_nanosleep */
+
+#include <algorithm>
+#include <string>
+#include <vector>
 
 extern "C" {
 #include "pios_dsm_priv.h"
+#include "pios_rcvr_priv.h"
+#include "timing_histogram.h"
 #include "../../PiOS/Common/pios_dsm.c"
 
 int PIOS_DSM_Reset(struct pios_dsm_dev *dsm_dev)
@@ -77,6 +85,12 @@ protected:
  void pack_channels_11bit(uint16_t channels[DSM_CHANNELS_PER_FRAME], struct pios_dsm_state *state, bool frame);
  int validate_file(const char *fn, int resolution, int channels, bool skip);
  int get_packet(FILE *fid, uint8_t *buf);
+ void load_capture(const char *fn);
+ uintptr_t attach_receiver();
+ bool replay_until(double t);
+ std::vector<std::pair<double, uint8_t> > capture;
+ size_t replay_pos;
+ double next_tick;
  struct pios_dsm_state *state;
  struct pios_dsm_dev dev;
 };
@@ -346,3 +360,249 @@ TEST_F(DsmTest, DX7_DSM2_10BIT) {
 
   fclose(fid);
 }
+
+TEST(TimingHistogram, Percentiles) {
+  struct timing_histogram h;
+  timing_histogram_clear(&h);
+
+  EXPECT_EQ(0u, timing_histogram_percentile(&h, 0.5f));
+
+  std::vector<uint32_t> durations;
+  srand(1);
+  for (int i = 0; i < 5000; i++) {
+    // Mostly a few ms, with a long tail
+    uint32_t d = 500 + rand() % 4000;
+    if (i % 50 == 0)
+      d *= 1 + rand() % 30;
+    durations.push_back(d);
+    timing_histogram_add(&h, d);
+  }
+
+  std::sort(durations.begin(), durations.end());
+
+  const float fractions[] = { 0.5f, 0.9f, 0.99f };
+  for (unsigned int i = 0; i < NELEMENTS(fractions); i++) {
+    uint32_t exact = durations[(size_t) (fractions[i] * durations.size()) - 1];
+    uint32_t approx = timing_histogram_percentile(&h, fractions[i]);
+
+    // Never under, and within the width of one bin over
+    EXPECT_GE(approx, exact);
+    EXPECT_LE(approx, exact + exact / 8 + 8);
+  }
+
+  EXPECT_EQ(durations.back(), timing_histogram_percentile(&h, 1.0f));
+  EXPECT_EQ(durations.back(), h.max);
+}
+
+TEST(TimingHistogram, FadesInsteadOfWrapping) {
+  struct timing_histogram h;
+  timing_histogram_clear(&h);
+
+  for (int i = 0; i < 100000; i++)
+    timing_histogram_add(&h, 100);
+
+  EXPECT_GT(h.count, 30000u);
+  EXPECT_LE(h.count, 65535u);
+
+  // Something new shows up once it is the majority
+  for (int i = 0; i < 70000; i++)
+    timing_histogram_add(&h, 5000);
+
+  EXPECT_GE(timing_histogram_percentile(&h, 0.5f), 5000u);
+  EXPECT_LE(timing_histogram_percentile(&h, 0.01f), 111u);
+}
+
+//! Load a logic analyser capture of the receiver's serial stream
+void DsmTest::load_capture(const char *fn)
+{
+  FILE *fid = fopen(fn, "r");
+  ASSERT_TRUE(fid != NULL);
+
+  char *line = NULL;
+  size_t len = 0;
+
+  // throwaway intro line
+  getline(&line, &len, fid);
+  free(line);
+
+  double t;
+  uint8_t val;
+
+  capture.clear();
+  while (fscanf(fid, "%lf,%hhx,,", &t, &val) == 2)
+    capture.push_back(std::make_pair(t, val));
+
+  fclose(fid);
+
+  replay_pos = 0;
+  next_tick = capture.empty() ? 0 : capture[0].first;
+}
+
+//! Hook the decoder up to the receiver layer, as the board code does
+uintptr_t DsmTest::attach_receiver()
+{
+  memset(&dev, 0, sizeof(dev));
+  dev.magic = PIOS_DSM_DEV_MAGIC;
+  PIOS_DSM_Reset(&dev);
+
+  uintptr_t rcvr_id = 0;
+  EXPECT_EQ(0, PIOS_RCVR_Init(&rcvr_id, &pios_dsm_rcvr_driver, (uintptr_t) &dev));
+
+  return rcvr_id;
+}
+
+/**
+ * Feed the capture into the driver up to a point in time, running the
+ * supervisor at the RTC rate in between, as the USART and RTC would.
+ * Returns false once the capture is exhausted.
+ */
+bool DsmTest::replay_until(double t)
+{
+  while (replay_pos < capture.size() && capture[replay_pos].first <= t) {
+    const double RTC_PERIOD = 1.0 / 625;
+
+    while (next_tick <= capture[replay_pos].first) {
+      PIOS_DSM_Supervisor((uintptr_t) &dev);
+      next_tick += RTC_PERIOD;
+    }
+
+    bool need_yield;
+    PIOS_DSM_RxInCallback((uintptr_t) &dev, &capture[replay_pos].second, 1, NULL, &need_yield);
+    replay_pos++;
+  }
+
+  return replay_pos < capture.size();
+}
+
+static const char *captures[] = {
+  "DX7_11msDSM2.txt", "DX7_22msDSM2.txt", "DX7_11msDSMX.txt", "DX7_22msDSMX.txt",
+  "DX18_11msDSM2_2048res.txt", "DX18_22msDSM2_1024res.txt",
+  "DX18_22msDSM2_XPlus_1024res.txt", "DX18_11msDSMX.txt",
+  "DX18_22msDSMX.txt", "DX18_22msDSMX_XPlus.txt",
+};
+
+TEST_F(DsmTest, ReplayPublishesWholeFrames) {
+  for (unsigned int f = 0; f < NELEMENTS(captures); f++) {
+    load_capture(captures[f]);
+    uintptr_t rcvr_id = attach_receiver();
+
+    uint32_t frame_raw;
+    uint32_t last_count = PIOS_RCVR_GetFrameTime(&frame_raw);
+    int frames = 0;
+
+    for (size_t i = 0; i < capture.size(); i++) {
+      replay_until(capture[i].first);
+
+      uint32_t count = PIOS_RCVR_GetFrameTime(&frame_raw);
+      if (count == last_count)
+        continue;
+
+      EXPECT_EQ(1u, count - last_count) << captures[f];
+      last_count = count;
+      frames++;
+
+      // A frame read matches the channels read one at a time
+      int16_t channels[PIOS_DSM_NUM_INPUTS + 2];
+      EXPECT_EQ(PIOS_DSM_NUM_INPUTS,
+          PIOS_RCVR_ReadFrame(rcvr_id, channels, NELEMENTS(channels)));
+      for (int c = 0; c < PIOS_DSM_NUM_INPUTS; c++)
+        EXPECT_EQ((int16_t) PIOS_RCVR_Read(rcvr_id, c + 1), channels[c]);
+      EXPECT_EQ(PIOS_RCVR_INVALID, channels[PIOS_DSM_NUM_INPUTS]);
+    }
+
+    // Every complete frame is published, bar the odd one at the start
+    // while the decoder finds the frame boundaries
+    EXPECT_GE(frames, (int) (capture.size() / DSM_FRAME_LENGTH) - 4) << captures[f];
+  }
+}
+
+struct frame_consumer {
+  uintptr_t rcvr_id;
+  volatile bool stop;
+  uint32_t frames;
+  struct timing_histogram latency;
+};
+
+// What ManualControl does: wake on a frame, note its age, read it
+static void *consume_frames(void *ctx)
+{
+  struct frame_consumer *c = (struct frame_consumer *) ctx;
+  uint32_t frame_raw;
+  uint32_t last_count = PIOS_RCVR_GetFrameTime(&frame_raw);
+
+  while (!c->stop) {
+    PIOS_RCVR_WaitActivity(20);
+
+    uint32_t count = PIOS_RCVR_GetFrameTime(&frame_raw);
+    int16_t channels[PIOS_DSM_NUM_INPUTS];
+    PIOS_RCVR_ReadFrame(c->rcvr_id, channels, NELEMENTS(channels));
+
+    if (count != last_count) {
+      timing_histogram_add(&c->latency, PIOS_DELAY_DiffuS(frame_raw));
+      c->frames += count - last_count;
+      last_count = count;
+    }
+  }
+
+  return NULL;
+}
+
+static double now_seconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+TEST_F(DsmTest, ReplayFrameLatency) {
+  const char *timed[] = { "DX7_11msDSMX.txt", "DX18_22msDSMX.txt" };
+  const double REPLAY_SECONDS = 2.0;
+
+  for (unsigned int f = 0; f < NELEMENTS(timed); f++) {
+    load_capture(timed[f]);
+
+    struct frame_consumer c;
+    memset(&c, 0, sizeof(c));
+    c.rcvr_id = attach_receiver();
+    timing_histogram_clear(&c.latency);
+
+    uint32_t frame_raw;
+    uint32_t first_count = PIOS_RCVR_GetFrameTime(&frame_raw);
+
+    pthread_t consumer;
+    ASSERT_EQ(0, pthread_create(&consumer, NULL, consume_frames, &c));
+
+    // Play the capture back in real time, a millisecond at a time
+    double offset = capture[0].first - now_seconds();
+    double end = capture[0].first + REPLAY_SECONDS;
+
+    for (double t = capture[0].first; t < end && replay_until(t); t += 0.001) {
+      double wake = t - offset;
+      struct timespec ts;
+      ts.tv_sec = (time_t) wake;
+      ts.tv_nsec = (long) ((wake - ts.tv_sec) * 1e9);
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+
+    c.stop = true;
+    pthread_join(consumer, NULL);
+
+    uint32_t published = PIOS_RCVR_GetFrameTime(&frame_raw) - first_count;
+
+    // Kept in the XML report rather than printed
+    std::string prop = std::string(timed[f]) + "_latency_";
+    RecordProperty(prop + "p50_us",
+        (int) timing_histogram_percentile(&c.latency, 0.5f));
+    RecordProperty(prop + "p99_us",
+        (int) timing_histogram_percentile(&c.latency, 0.99f));
+    RecordProperty(prop + "max_us", (int) c.latency.max);
+
+    // Frames are further apart than the wake limit, so none are coalesced
+    EXPECT_GT(published, 50u);
+    EXPECT_EQ(published, c.frames);
+    EXPECT_EQ(c.frames, c.latency.count);
+
+    // Picked up on arrival rather than at the next 20ms poll
+    EXPECT_LT(timing_histogram_percentile(&c.latency, 0.5f), 5000u);
+  }
+}
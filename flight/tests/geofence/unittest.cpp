@@ -0,0 +1,539 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test of the polygon geofence
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* rand */
+#include <math.h>		/* sinf */
+#include <time.h>		/* clock_gettime */
+
+#include <vector>
+
+extern "C" {
+#include "polyfence.h"
+}
+
+static double now_seconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static float frand(float lo, float hi)
+{
+  return lo + (hi - lo) * (rand() / (float) RAND_MAX);
+}
+
+struct fence_def {
+  std::vector<struct polyfence_zone> zones;
+  std::vector<float> verts;
+
+  void add(uint8_t type, float floor, float ceiling,
+      const std::vector<float> &pts) {
+    struct polyfence_zone z;
+    z.type = type;
+    z.floor = floor;
+    z.ceiling = ceiling;
+    z.first_vertex = verts.size() / 2;
+    z.num_vertices = pts.size() / 2;
+    zones.push_back(z);
+    verts.insert(verts.end(), pts.begin(), pts.end());
+  }
+
+  const float (*vertices() const)[2] {
+    return (const float (*)[2]) verts.data();
+  }
+
+  uint16_t num_vertices() const {
+    return verts.size() / 2;
+  }
+};
+
+// To use a test fixture, derive a class from testing::Test.
+class GeofenceTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    mem = NULL;
+  }
+
+  virtual void TearDown() {
+    free(mem);
+  }
+
+  struct polyfence *build(const struct fence_def &def) {
+    size_t len = polyfence_size(def.zones.data(), def.zones.size(),
+        def.vertices(), def.num_vertices());
+
+    free(mem);
+    mem = malloc(len);
+
+    /* Too little memory is refused */
+    EXPECT_TRUE(polyfence_build(mem, len - 1, def.zones.data(),
+        def.zones.size(), def.vertices(), def.num_vertices()) == NULL);
+
+    return polyfence_build(mem, len, def.zones.data(), def.zones.size(),
+        def.vertices(), def.num_vertices());
+  }
+
+  bool breached(const struct polyfence *f, float n, float e, float alt) {
+    const float pos[3] = { n, e, alt };
+    struct polyfence_result res;
+
+    polyfence_check(f, pos, &res);
+
+    return res.breached;
+  }
+
+  void *mem;
+};
+
+static std::vector<float> square(float n0, float e0, float n1, float e1)
+{
+  return { n0, e0, n1, e0, n1, e1, n0, e1 };
+}
+
+TEST_F(GeofenceTest, KeepInWithHole) {
+  struct fence_def def;
+  def.add(POLYFENCE_KEEP_IN, -1000, 120, square(-100, -100, 100, 100));
+  def.add(POLYFENCE_KEEP_OUT, -1000, 1000, square(20, 20, 40, 40));
+
+  struct polyfence *f = build(def);
+  ASSERT_TRUE(f != NULL);
+
+  EXPECT_FALSE(breached(f, 0, 0, 10));
+  EXPECT_FALSE(breached(f, -99, 99, 10));
+  EXPECT_TRUE(breached(f, 101, 0, 10));
+  EXPECT_TRUE(breached(f, 0, -5000, 10));
+  EXPECT_TRUE(breached(f, 30, 30, 10));
+  EXPECT_FALSE(breached(f, 30, 41, 10));
+
+  /* Above the keep-in ceiling */
+  EXPECT_TRUE(breached(f, 0, 0, 121));
+
+  const float pos[3] = { 10, 30, 50 };
+  struct polyfence_result res;
+  polyfence_check(f, pos, &res);
+
+  /* Nearest is the hole, 10 m away */
+  EXPECT_NEAR(10.0f, res.margin, 1e-3f);
+  EXPECT_EQ(1, res.zone);
+
+  /* Near the ceiling, it's nearest */
+  const float high[3] = { 0, 0, 115 };
+  polyfence_check(f, high, &res);
+  EXPECT_NEAR(5.0f, res.margin, 1e-3f);
+  EXPECT_EQ(0, res.zone);
+}
+
+TEST_F(GeofenceTest, AltitudeBands) {
+  struct fence_def def;
+
+  /* No keep-in zones: anywhere is fine but the keep-out band */
+  def.add(POLYFENCE_KEEP_OUT, 50, 100, square(-10, -10, 10, 10));
+
+  /* Too few vertices and disabled zones are ignored */
+  def.add(POLYFENCE_KEEP_OUT, 0, 1000, { 0, 0, 1, 1 });
+  def.add(POLYFENCE_DISABLED, 0, 1000, square(-500, -500, 500, 500));
+
+  struct polyfence *f = build(def);
+  ASSERT_TRUE(f != NULL);
+
+  EXPECT_FALSE(breached(f, 0, 0, 49));
+  EXPECT_TRUE(breached(f, 0, 0, 75));
+  EXPECT_FALSE(breached(f, 0, 0, 101));
+  EXPECT_FALSE(breached(f, 20, 0, 75));
+  EXPECT_FALSE(breached(f, 0, 600, 75));
+
+  /* Below the band: the margin is to its floor */
+  const float pos[3] = { 0, 0, 40 };
+  struct polyfence_result res;
+  polyfence_check(f, pos, &res);
+  EXPECT_NEAR(10.0f, res.margin, 1e-3f);
+
+  /* Beside and below: to the nearest corner of the box */
+  const float beside[3] = { 0, 13, 46 };
+  polyfence_check(f, beside, &res);
+  EXPECT_NEAR(5.0f, res.margin, 1e-3f);
+}
+
+TEST_F(GeofenceTest, EmptyFence) {
+  struct fence_def def;
+  def.add(POLYFENCE_DISABLED, 0, 100, square(-10, -10, 10, 10));
+
+  struct polyfence *f = build(def);
+  ASSERT_TRUE(f != NULL);
+
+  EXPECT_FALSE(breached(f, 0, 0, 0));
+
+  const float pos[3] = { 0, 0, 0 }, vel[3] = { 10, 0, 0 };
+  float t;
+  EXPECT_FALSE(polyfence_predict(f, pos, vel, 10, &t));
+}
+
+TEST_F(GeofenceTest, RejectedZones) {
+  struct fence_def def;
+  def.add(POLYFENCE_KEEP_IN, 0, 100, square(-50, -50, 50, 50));
+  def.add(POLYFENCE_DISABLED, 0, 100, { 0, 0, 1, 1 });
+
+  EXPECT_EQ(0, polyfence_rejected_zones(def.zones.data(), def.zones.size(),
+      def.num_vertices()));
+
+  /* A line isn't a zone */
+  def.add(POLYFENCE_KEEP_OUT, 0, 100, { 0, 0, 1, 1 });
+  /* Nor is one running past the vertices */
+  def.add(POLYFENCE_KEEP_OUT, 0, 100, square(-5, -5, 5, 5));
+  def.zones.back().num_vertices++;
+
+  EXPECT_EQ(2, polyfence_rejected_zones(def.zones.data(), def.zones.size(),
+      def.num_vertices()));
+
+  /* The rest still make a fence */
+  struct polyfence *f = build(def);
+  ASSERT_TRUE(f != NULL);
+
+  EXPECT_FALSE(breached(f, 0, 0, 0));
+  EXPECT_TRUE(breached(f, 60, 0, 0));
+}
+
+TEST_F(GeofenceTest, Predict) {
+  struct fence_def def;
+  def.add(POLYFENCE_KEEP_IN, -1000, 120, square(-100, -100, 100, 100));
+  def.add(POLYFENCE_KEEP_OUT, -1000, 1000, square(20, -1, 21, 1));
+
+  struct polyfence *f = build(def);
+  ASSERT_TRUE(f != NULL);
+
+  const float pos[3] = { 0, 0, 10 };
+  float t;
+
+  /* Straight at the thin keep-out, 1 m deep, 20 m ahead */
+  const float north[3] = { 10, 0, 0 };
+  EXPECT_TRUE(polyfence_predict(f, pos, north, 5, &t));
+  EXPECT_NEAR(2.0f, t, 0.06f);
+
+  /* Not within the horizon */
+  EXPECT_FALSE(polyfence_predict(f, pos, north, 1.5f, &t));
+
+  /* Out of the side */
+  const float east[3] = { 0, 20, 0 };
+  EXPECT_TRUE(polyfence_predict(f, pos, east, 10, &t));
+  EXPECT_NEAR(5.0f, t, 0.03f);
+
+  /* Climbing through the ceiling */
+  const float up[3] = { 0, 0, 5 };
+  EXPECT_TRUE(polyfence_predict(f, pos, up, 30, &t));
+  EXPECT_NEAR(22.0f, t, 0.11f);
+
+  /* Hovering, or already out */
+  const float still[3] = { 0, 0, 0 };
+  EXPECT_FALSE(polyfence_predict(f, pos, still, 10, &t));
+
+  const float out[3] = { 0, 200, 10 };
+  EXPECT_TRUE(polyfence_predict(f, out, still, 10, &t));
+  EXPECT_EQ(0.0f, t);
+}
+
+/* A jagged star of n edges around the origin, as a stand in for a
+ * boundary traced from a map */
+static std::vector<float> star(int n, float inner, float outer)
+{
+  std::vector<float> pts;
+
+  for (int i = 0; i < n; i++) {
+    float a = 2 * M_PI * i / n;
+    float r = (i & 1) ? inner : outer;
+    r *= frand(0.9f, 1.1f);
+
+    pts.push_back(r * cosf(a));
+    pts.push_back(r * sinf(a));
+  }
+
+  return pts;
+}
+
+static bool brute_inside(const struct fence_def &def, int z, float n, float e)
+{
+  const struct polyfence_zone &zone = def.zones[z];
+  const float (*v)[2] = def.vertices() + zone.first_vertex;
+  bool inside = false;
+
+  for (int i = 0, j = zone.num_vertices - 1; i < zone.num_vertices; j = i++) {
+    if ((v[i][1] > e) != (v[j][1] > e) &&
+        n < (v[j][0] - v[i][0]) * (e - v[i][1]) / (v[j][1] - v[i][1]) + v[i][0]) {
+      inside = !inside;
+    }
+  }
+
+  return inside;
+}
+
+static float seg_dist(const float *a, const float *b, float n, float e)
+{
+  double dx = b[0] - a[0], dy = b[1] - a[1];
+  double t = ((n - a[0]) * dx + (e - a[1]) * dy) / (dx * dx + dy * dy);
+
+  t = t < 0 ? 0 : (t > 1 ? 1 : t);
+
+  return hypot(n - a[0] - t * dx, e - a[1] - t * dy);
+}
+
+/* Everything polyfence_check works out, the slow way.  Returns the
+ * horizontal distance to the nearest edge, to skip points on a boundary */
+static float brute_check(const struct fence_def &def, const float pos[3],
+    struct polyfence_result *res)
+{
+  bool any_keep_in = false, in_keep_in = false, in_keep_out = false;
+  float nearest_edge = INFINITY;
+
+  res->margin = INFINITY;
+  res->zone = -1;
+
+  for (size_t z = 0; z < def.zones.size(); z++) {
+    const struct polyfence_zone &zone = def.zones[z];
+    const float (*v)[2] = def.vertices() + zone.first_vertex;
+
+    bool active = pos[2] >= zone.floor && pos[2] <= zone.ceiling;
+    float gap = active ? 0 : fminf(fabsf(pos[2] - zone.floor),
+        fabsf(pos[2] - zone.ceiling));
+    bool inside = brute_inside(def, z, pos[0], pos[1]);
+
+    if (zone.type == POLYFENCE_KEEP_IN) {
+      any_keep_in = true;
+      in_keep_in |= inside && active;
+    } else {
+      in_keep_out |= inside && active;
+    }
+
+    for (int i = 0; i < zone.num_vertices; i++) {
+      float d = seg_dist(v[i], v[(i + 1) % zone.num_vertices], pos[0], pos[1]);
+
+      nearest_edge = fminf(nearest_edge, d);
+      d = hypotf(d, gap);
+
+      if (d < res->margin) {
+        res->margin = d;
+        res->zone = z;
+      }
+    }
+
+    if (inside) {
+      float d = active ? fminf(pos[2] - zone.floor, zone.ceiling - pos[2]) : gap;
+
+      if (d < res->margin) {
+        res->margin = d;
+        res->zone = z;
+      }
+    }
+  }
+
+  res->breached = (any_keep_in && !in_keep_in) || in_keep_out;
+
+  return nearest_edge;
+}
+
+static void big_fence(struct fence_def *def)
+{
+  srand(1234);
+
+  /* 10000 edges between the keep-in and the keep-outs */
+  def->add(POLYFENCE_KEEP_IN, -100, 400, star(8000, 4000, 5000));
+  def->add(POLYFENCE_KEEP_OUT, 0, 150, star(1000, 300, 600));
+
+  for (int i = 0; i < 10; i++) {
+    std::vector<float> pts = star(100, 100, 200);
+
+    for (size_t k = 0; k < pts.size(); k += 2) {
+      pts[k] += 2500 * cosf(i * 0.6f);
+      pts[k + 1] += 2500 * sinf(i * 0.6f);
+    }
+
+    def->add(POLYFENCE_KEEP_OUT, 50 * i, 50 * i + 100, pts);
+  }
+}
+
+TEST_F(GeofenceTest, MatchesBruteForce) {
+  struct fence_def def;
+  big_fence(&def);
+
+  struct polyfence *f = build(def);
+  ASSERT_TRUE(f != NULL);
+
+  int checked = 0, breaches = 0;
+
+  for (int i = 0; i < 5000; i++) {
+    const float pos[3] = {
+      frand(-5600, 5600), frand(-5600, 5600), frand(-150, 450)
+    };
+
+    struct polyfence_result expected, res;
+    float edge = brute_check(def, pos, &expected);
+    polyfence_check(f, pos, &res);
+
+    ASSERT_NEAR(expected.margin, res.margin, 1e-3f + 1e-5f * expected.margin);
+
+    /* Right on an edge either answer will do */
+    if (edge < 0.01f) {
+      continue;
+    }
+
+    ASSERT_EQ(expected.breached, res.breached)
+      << "at " << pos[0] << ", " << pos[1] << ", " << pos[2];
+
+    checked++;
+    breaches += res.breached;
+  }
+
+  /* Both outcomes were covered */
+  EXPECT_LT(500, breaches);
+  EXPECT_LT(500, checked - breaches);
+}
+
+TEST_F(GeofenceTest, PredictNeverSkipsAZone) {
+  struct fence_def def;
+  big_fence(&def);
+
+  struct polyfence *f = build(def);
+  ASSERT_TRUE(f != NULL);
+
+  for (int i = 0; i < 200; i++) {
+    const float pos[3] = { frand(-3000, 3000), frand(-3000, 3000),
+      frand(0, 300) };
+    const float vel[3] = { frand(-30, 30), frand(-30, 30), frand(-5, 5) };
+    const float horizon = 20;
+
+    float t;
+    bool predicted = polyfence_predict(f, pos, vel, horizon, &t);
+
+    float speed = sqrtf(vel[0] * vel[0] + vel[1] * vel[1] + vel[2] * vel[2]);
+
+    /* Sample the path finely for the first breach at least half a meter
+     * long; the steps are allowed to skip slivers thinner than that */
+    float first = -1, start = -1;
+
+    for (float s = 0; s <= horizon; s += 0.005f) {
+      const float p[3] = {
+        pos[0] + vel[0] * s, pos[1] + vel[1] * s, pos[2] + vel[2] * s
+      };
+
+      struct polyfence_result res;
+      polyfence_check(f, p, &res);
+
+      if (!res.breached) {
+        start = -1;
+      } else if (start < 0) {
+        start = s;
+      } else if ((s - start) * speed >= 0.5f) {
+        first = start;
+        break;
+      }
+    }
+
+    if (first < 0) {
+      if (predicted) {
+        /* Only a sliver */
+        EXPECT_GT(horizon, t);
+      }
+    } else if (first < horizon - 0.1f) {
+      ASSERT_TRUE(predicted);
+
+      /* Within a minimum step of the breach, or at an earlier sliver */
+      EXPECT_LE(t, first + 0.5f / speed + 0.01f);
+
+      const float p[3] = {
+        pos[0] + vel[0] * t, pos[1] + vel[1] * t, pos[2] + vel[2] * t
+      };
+
+      struct polyfence_result res;
+      polyfence_check(f, p, &res);
+      EXPECT_TRUE(res.breached);
+    }
+  }
+}
+
+TEST_F(GeofenceTest, Benchmark) {
+  struct fence_def def;
+  big_fence(&def);
+
+  double start = now_seconds();
+  struct polyfence *f = build(def);
+  double build_time = now_seconds() - start;
+  ASSERT_TRUE(f != NULL);
+
+  const int queries = 200000;
+  std::vector<float> pts(queries * 3);
+
+  for (int i = 0; i < queries * 3; i += 3) {
+    pts[i] = frand(-5600, 5600);
+    pts[i + 1] = frand(-5600, 5600);
+    pts[i + 2] = frand(-150, 450);
+  }
+
+  int breaches = 0;
+  start = now_seconds();
+
+  for (int i = 0; i < queries * 3; i += 3) {
+    struct polyfence_result res;
+    polyfence_check(f, &pts[i], &res);
+    breaches += res.breached;
+  }
+
+  double indexed = (now_seconds() - start) / queries;
+
+  /* The naive way: every edge for containment and distance */
+  const int naive_queries = 2000;
+  int naive_breaches = 0;
+  start = now_seconds();
+
+  for (int i = 0; i < naive_queries * 3; i += 3) {
+    struct polyfence_result res;
+    brute_check(def, &pts[i], &res);
+    naive_breaches += res.breached;
+  }
+
+  double naive = (now_seconds() - start) / naive_queries;
+
+  printf("%-36s %7d\n", "Fence edges:", def.num_vertices());
+  printf("%-36s %7.2f ms\n", "Index build:", build_time * 1e3);
+  printf("%-36s %7.2f us/check\n", "Indexed check:", indexed * 1e6);
+  printf("%-36s %7.2f us/check\n", "Naive check:", naive * 1e6);
+
+  /* Keep the loops from being optimised away */
+  EXPECT_LT(0, breaches + naive_breaches);
+  EXPECT_LT(indexed * 20, naive);
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,5 @@
+/* Stand-in for alarms.h, which needs the generated UAVOs */
+#ifndef ALARMS_H
+#define ALARMS_H
+
+#endif /* ALARMS_H */
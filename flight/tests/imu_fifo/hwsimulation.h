@@ -0,0 +1,13 @@
+/* Stand-in for the generated hwsimulation.h, needed by pios_thread.c */
+#ifndef HWSIMULATION_H
+#define HWSIMULATION_H
+
+#include <stdint.h>
+
+static inline int32_t HwSimulationFakeTickBlockedSet(uint8_t *val)
+{
+	(void) val;
+	return 0;
+}
+
+#endif /* HWSIMULATION_H */
@@ -0,0 +1,7 @@
+#define FLIGHT_POSIX
+#define PIOS_NO_HW
+
+#define PIOS_INCLUDE_RTOS
+#define PIOS_INCLUDE_FAKETICK
+#define PIOS_INCLUDE_SPI
+#define PIOS_INCLUDE_MPU
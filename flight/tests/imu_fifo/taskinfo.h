@@ -0,0 +1,7 @@
+/* Stand-in for the generated taskinfo.h, needed by pios_thread.h */
+#ifndef TASKINFO_H
+#define TASKINFO_H
+
+typedef int TaskInfoRunningElem;
+
+#endif /* TASKINFO_H */
@@ -0,0 +1,230 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test of batched IMU FIFO reads, against a simulated MPU-6000
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+
+#include <string.h>		/* strcpy */
+
+extern "C" {
+#include "pios.h"
+#include "pios_spi_posix_priv.h"
+#include "physical_constants.h"
+}
+
+#define INTERVAL_US 125		/* 8 kHz */
+
+static pios_mpu_dev_t mpu;	/* The driver keeps one device */
+
+// To use a test fixture, derive a class from testing::Test.
+class ImuFifoTest : public testing::Test {
+protected:
+  void Init(uint8_t fifo_batch) {
+    strcpy(spi_cfg.base_path, PIOS_SPI_SIM_MPU_PATH);
+    ASSERT_EQ(0, PIOS_SPI_Init(&spi, &spi_cfg));
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.default_samplerate = 1000;
+    cfg.orientation = PIOS_MPU_BOTTOM_90DEG;	/* Leaves x, y, z be */
+    cfg.skip_startup_irq_check = true;
+    cfg.fifo_batch = fifo_batch;
+
+    ASSERT_EQ(0, PIOS_MPU_SPI_Init(&mpu, spi, 0, &cfg));
+
+    /* Past the widest filter, so sampled at 8 kHz */
+    PIOS_MPU_SetGyroBandwidth(250);
+
+    /* Nothing left over from the last test */
+    struct pios_sensor_imu_batch batch;
+    while (PIOS_SENSORS_GetBatch(PIOS_SENSOR_GYRO, &batch, 0));
+  }
+
+  void Sample(int n) {
+    const int16_t accel[3] = { (int16_t) n, (int16_t) (2 * n), 4096 };
+    const int16_t gyro[3] = { (int16_t) (10 * n), (int16_t) (-10 * n),
+      (int16_t) (100 + n) };
+
+    ASSERT_EQ(0, PIOS_SPI_SimMPU_Sample(spi, accel, 0, gyro));
+  }
+
+  void ExpectSample(const struct pios_sensor_imu_batch &batch, int i, int n) {
+    const float gyro_scale = 1.0f / 32.8f;	/* 1000 deg/s */
+    const float accel_scale = GRAVITY / 4096.0f;	/* 8 G */
+
+    EXPECT_FLOAT_EQ((10 * n) * gyro_scale, batch.gyro[i].x);
+    EXPECT_FLOAT_EQ((-10 * n) * gyro_scale, batch.gyro[i].y);
+    EXPECT_FLOAT_EQ((100 + n) * gyro_scale, batch.gyro[i].z);
+
+    EXPECT_FLOAT_EQ(n * accel_scale, batch.accel[i].x);
+    EXPECT_FLOAT_EQ((2 * n) * accel_scale, batch.accel[i].y);
+    EXPECT_FLOAT_EQ(GRAVITY, batch.accel[i].z);
+  }
+
+  struct pios_spi_cfg spi_cfg;
+  pios_spi_t spi;
+  struct pios_mpu_cfg cfg;
+};
+
+TEST_F(ImuFifoTest, DeliversWholeBatches) {
+  Init(8);
+
+  /* Batches come at the loop rate, each of 8 samples at 8 kHz */
+  EXPECT_EQ(1000U, PIOS_SENSORS_GetSampleRate(PIOS_SENSOR_GYRO));
+  EXPECT_EQ(8, PIOS_SENSORS_GetBatchSize(PIOS_SENSOR_GYRO));
+
+  struct pios_sensor_imu_batch batch;
+
+  for (int n = 1; n < 8; n++) {
+    Sample(n);
+  }
+
+  /* Not woken until the whole batch is in */
+  EXPECT_FALSE(PIOS_SENSORS_GetBatch(PIOS_SENSOR_GYRO, &batch, 0));
+
+  uint32_t before = PIOS_DELAY_GetRaw();
+  Sample(8);
+  uint32_t after = PIOS_DELAY_GetRaw();
+
+  ASSERT_TRUE(PIOS_SENSORS_GetBatch(PIOS_SENSOR_GYRO, &batch, 0));
+
+  EXPECT_EQ(8, batch.count);
+  EXPECT_TRUE(batch.has_accel);
+  EXPECT_EQ((uint32_t) INTERVAL_US, batch.interval_us);
+  EXPECT_LE(PIOS_DELAY_DiffuS2(before, batch.timestamp),
+      PIOS_DELAY_DiffuS2(before, after));
+  EXPECT_EQ(0U, batch.lag_us);
+
+  for (int i = 0; i < 8; i++) {
+    ExpectSample(batch, i, i + 1);
+  }
+
+  EXPECT_FALSE(PIOS_SENSORS_GetBatch(PIOS_SENSOR_GYRO, &batch, 0));
+}
+
+TEST_F(ImuFifoTest, CatchesUpWhenBehind) {
+  Init(8);
+
+  for (int n = 0; n < 24; n++) {
+    Sample(n);
+  }
+
+  uint32_t last = PIOS_DELAY_GetRaw();
+
+  struct pios_sensor_imu_batch batch;
+
+  /* As much as fits, stamped as older than what's still queued */
+  ASSERT_TRUE(PIOS_SENSORS_GetBatch(PIOS_SENSOR_GYRO, &batch, 0));
+  EXPECT_EQ(PIOS_SENSORS_BATCH_MAX, batch.count);
+  EXPECT_LE(PIOS_DELAY_DiffuS2(batch.timestamp, last), 1000U);
+  EXPECT_EQ((24U - PIOS_SENSORS_BATCH_MAX) * INTERVAL_US, batch.lag_us);
+
+  for (int i = 0; i < batch.count; i++) {
+    ExpectSample(batch, i, i);
+  }
+
+  /* And the rest straight away, without another interrupt */
+  ASSERT_TRUE(PIOS_SENSORS_GetBatch(PIOS_SENSOR_GYRO, &batch, 0));
+  EXPECT_EQ(24 - PIOS_SENSORS_BATCH_MAX, batch.count);
+
+  for (int i = 0; i < batch.count; i++) {
+    ExpectSample(batch, i, i + PIOS_SENSORS_BATCH_MAX);
+  }
+
+  EXPECT_FALSE(PIOS_SENSORS_GetBatch(PIOS_SENSOR_GYRO, &batch, 0));
+}
+
+TEST_F(ImuFifoTest, RecoversFromOverflow) {
+  Init(8);
+
+  /* Far more than the FIFO holds; what's left is misaligned */
+  for (int n = 0; n < 100; n++) {
+    Sample(n);
+  }
+
+  struct pios_sensor_imu_batch batch;
+
+  EXPECT_FALSE(PIOS_SENSORS_GetBatch(PIOS_SENSOR_GYRO, &batch, 0));
+
+  for (int n = 200; n < 208; n++) {
+    Sample(n);
+  }
+
+  ASSERT_TRUE(PIOS_SENSORS_GetBatch(PIOS_SENSOR_GYRO, &batch, 0));
+  EXPECT_EQ(8, batch.count);
+
+  for (int i = 0; i < batch.count; i++) {
+    ExpectSample(batch, i, 200 + i);
+  }
+}
+
+TEST_F(ImuFifoTest, SingleSamplesGiveNewest) {
+  Init(8);
+
+  for (int n = 0; n < 8; n++) {
+    Sample(n);
+  }
+
+  /* Readers that want one sample get the latest */
+  struct pios_sensor_gyro_data gyro;
+
+  ASSERT_TRUE(PIOS_SENSORS_GetData(PIOS_SENSOR_GYRO, &gyro, 0));
+  EXPECT_FLOAT_EQ(70 / 32.8f, gyro.x);
+
+  struct pios_sensor_accel_data accel;
+
+  ASSERT_TRUE(PIOS_SENSORS_GetData(PIOS_SENSOR_ACCEL, &accel, 0));
+  EXPECT_FLOAT_EQ(7 * GRAVITY / 4096.0f, accel.x);
+}
+
+TEST_F(ImuFifoTest, WithoutFifoBatchesOfOne) {
+  Init(0);
+
+  EXPECT_EQ(1, PIOS_SENSORS_GetBatchSize(PIOS_SENSOR_GYRO));
+
+  struct pios_sensor_imu_batch batch;
+
+  for (int n = 1; n < 4; n++) {
+    Sample(n);
+
+    ASSERT_TRUE(PIOS_SENSORS_GetBatch(PIOS_SENSOR_GYRO, &batch, 0));
+    EXPECT_EQ(1, batch.count);
+    EXPECT_EQ(0U, batch.interval_us);
+    EXPECT_TRUE(batch.has_accel);
+
+    ExpectSample(batch, 0, n);
+  }
+}
+
+/**
+ * @}
+ * @}
+ */
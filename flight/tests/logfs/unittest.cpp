@@ -326,6 +326,207 @@ TEST_F(LogfsTestCooked, WriteManyVerify) {
   EXPECT_EQ(0, memcmp(obj3, obj3_check, sizeof(obj3)));
 }
 
+TEST_F(LogfsTestCooked, WriteVerifyBatch) {
+  struct pios_flashfs_obj batch[] = {
+    { OBJ0_ID, 0, 0, NULL },
+    { OBJ1_ID, 0, sizeof(obj1), obj1 },
+    { OBJ1_ID, 123, sizeof(obj1_alt), obj1_alt },
+    { OBJ2_ID, 0, sizeof(obj2), obj2 },
+    { OBJ3_ID, 0, sizeof(obj3), obj3 },
+  };
+
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSaveBatch(fs_id, batch, sizeof(batch) / sizeof(batch[0])));
+
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ0_ID, 0, NULL, 0));
+
+  unsigned char obj1_check[OBJ1_SIZE];
+  memset(obj1_check, 0, sizeof(obj1_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+  EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+
+  memset(obj1_check, 0, sizeof(obj1_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 123, obj1_check, sizeof(obj1_check)));
+  EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+
+  unsigned char obj2_check[OBJ2_SIZE];
+  memset(obj2_check, 0, sizeof(obj2_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, 0, obj2_check, sizeof(obj2_check)));
+  EXPECT_EQ(0, memcmp(obj2, obj2_check, sizeof(obj2)));
+
+  unsigned char obj3_check[OBJ3_SIZE];
+  memset(obj3_check, 0, sizeof(obj3_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ3_ID, 0, obj3_check, sizeof(obj3_check)));
+  EXPECT_EQ(0, memcmp(obj3, obj3_check, sizeof(obj3)));
+}
+
+TEST_F(LogfsTestCooked, BatchReplacesOldVersions) {
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1, sizeof(obj1)));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ2_ID, 0, obj2, sizeof(obj2)));
+
+  /* Replace obj1 in a batch, leaving obj2 alone */
+  struct pios_flashfs_obj batch[] = {
+    { OBJ1_ID, 0, sizeof(obj1_alt), obj1_alt },
+    { OBJ3_ID, 0, sizeof(obj3), obj3 },
+  };
+
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSaveBatch(fs_id, batch, sizeof(batch) / sizeof(batch[0])));
+
+  unsigned char obj1_check[OBJ1_SIZE];
+  memset(obj1_check, 0, sizeof(obj1_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+  EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+
+  unsigned char obj2_check[OBJ2_SIZE];
+  memset(obj2_check, 0, sizeof(obj2_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, 0, obj2_check, sizeof(obj2_check)));
+  EXPECT_EQ(0, memcmp(obj2, obj2_check, sizeof(obj2)));
+
+  /* Deleting the new version must not uncover the old one */
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ1_ID, 0));
+  EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+}
+
+TEST_F(LogfsTestCooked, BatchDuplicateRefused) {
+  struct pios_flashfs_obj batch[] = {
+    { OBJ1_ID, 0, sizeof(obj1), obj1 },
+    { OBJ2_ID, 0, sizeof(obj2), obj2 },
+    { OBJ1_ID, 0, sizeof(obj1_alt), obj1_alt },
+  };
+
+  EXPECT_EQ(-8, PIOS_FLASHFS_ObjSaveBatch(fs_id, batch, sizeof(batch) / sizeof(batch[0])));
+
+  unsigned char obj2_check[OBJ2_SIZE];
+  EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, 0, obj2_check, sizeof(obj2_check)));
+}
+
+TEST_F(LogfsTestCooked, BatchTooBigRefused) {
+  uint16_t num_slots = flashfs_config_settings.arena_size / flashfs_config_settings.slot_size;
+
+  /* Leave room for 5 more objects */
+  for (uint16_t i = 0; i < num_slots - 1 - 5; i++) {
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i, obj1, sizeof(obj1)));
+  }
+
+  /* Dirty the log, so the batch has to garbage collect */
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1, sizeof(obj1)));
+
+  /* 2 replacements and 6 new objects is one too many */
+  struct pios_flashfs_obj batch[8];
+  for (uint16_t i = 0; i < 8; i++) {
+    batch[i].obj_id = OBJ1_ID;
+    batch[i].obj_inst_id = (i < 2) ? i : 1000 + i;
+    batch[i].obj_size = sizeof(obj1_alt);
+    batch[i].obj_data = obj1_alt;
+  }
+
+  struct pios_flash_posix_stats before, after;
+  PIOS_Flash_Posix_GetStats(pios_posix_flash_id, &before);
+
+  EXPECT_EQ(-4, PIOS_FLASHFS_ObjSaveBatch(fs_id, batch, 8));
+
+  /* Nothing was written */
+  PIOS_Flash_Posix_GetStats(pios_posix_flash_id, &after);
+  EXPECT_EQ(before.writes, after.writes);
+  EXPECT_EQ(before.erases, after.erases);
+
+  unsigned char obj1_check[OBJ1_SIZE];
+  memset(obj1_check, 0, sizeof(obj1_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 1, obj1_check, sizeof(obj1_check)));
+  EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+
+  /* One object fewer fits */
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSaveBatch(fs_id, batch, 7));
+
+  memset(obj1_check, 0, sizeof(obj1_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 1, obj1_check, sizeof(obj1_check)));
+  EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+}
+
+#define BATCH_SIZE 24
+#define BATCH_ROUNDS 100
+
+/*
+ * Saves the same set of objects over and over, one at a time and as a
+ * batch, and compares what it cost the flash.  Each batch may garbage
+ * collect at most once, erasing one arena.
+ */
+TEST_F(LogfsTestCooked, BatchCostsLessThanSingles) {
+  struct pios_flashfs_obj batch[BATCH_SIZE];
+  for (uint16_t i = 0; i < BATCH_SIZE; i++) {
+    batch[i].obj_id = OBJ2_ID;
+    batch[i].obj_inst_id = i;
+    batch[i].obj_size = sizeof(obj2);
+    batch[i].obj_data = obj2;
+  }
+
+  /* Some other settings that stay put, for the scans to step over */
+  for (uint16_t i = 0; i < 64; i++) {
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i, obj1, sizeof(obj1)));
+  }
+
+  uint32_t arena_erases = flashfs_config_settings.arena_size / flash_config.size_of_sector;
+
+  struct pios_flash_posix_stats start, before, after;
+
+  PIOS_Flash_Posix_GetStats(pios_posix_flash_id, &start);
+  for (uint32_t round = 0; round < BATCH_ROUNDS; round++) {
+    for (uint16_t i = 0; i < BATCH_SIZE; i++) {
+      EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, batch[i].obj_id, batch[i].obj_inst_id, batch[i].obj_data, batch[i].obj_size));
+    }
+  }
+  PIOS_Flash_Posix_GetStats(pios_posix_flash_id, &after);
+
+  struct pios_flash_posix_stats singles = {
+    after.transactions - start.transactions,
+    after.reads - start.reads,
+    after.writes - start.writes,
+    after.bytes_written - start.bytes_written,
+    after.erases - start.erases,
+  };
+
+  PIOS_Flash_Posix_GetStats(pios_posix_flash_id, &start);
+  for (uint32_t round = 0; round < BATCH_ROUNDS; round++) {
+    PIOS_Flash_Posix_GetStats(pios_posix_flash_id, &before);
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSaveBatch(fs_id, batch, BATCH_SIZE));
+    PIOS_Flash_Posix_GetStats(pios_posix_flash_id, &after);
+
+    EXPECT_EQ(1U, after.transactions - before.transactions);
+    EXPECT_GE(arena_erases, after.erases - before.erases);
+  }
+
+  struct pios_flash_posix_stats batched = {
+    after.transactions - start.transactions,
+    after.reads - start.reads,
+    after.writes - start.writes,
+    after.bytes_written - start.bytes_written,
+    after.erases - start.erases,
+  };
+
+  printf("%u saves of %u objects, per save:\n", BATCH_ROUNDS, BATCH_SIZE);
+  printf("  singles: %7.1f transactions %7.1f reads %7.1f writes %7.1f erases\n",
+      (double)singles.transactions / BATCH_ROUNDS, (double)singles.reads / BATCH_ROUNDS,
+      (double)singles.writes / BATCH_ROUNDS, (double)singles.erases / BATCH_ROUNDS);
+  printf("  batch:   %7.1f transactions %7.1f reads %7.1f writes %7.1f erases\n",
+      (double)batched.transactions / BATCH_ROUNDS, (double)batched.reads / BATCH_ROUNDS,
+      (double)batched.writes / BATCH_ROUNDS, (double)batched.erases / BATCH_ROUNDS);
+
+  EXPECT_GT(singles.reads, 4 * batched.reads);
+  EXPECT_GE(singles.writes, batched.writes);
+  EXPECT_GE(singles.erases, batched.erases);
+
+  unsigned char obj2_check[OBJ2_SIZE];
+  for (uint16_t i = 0; i < BATCH_SIZE; i++) {
+    memset(obj2_check, 0, sizeof(obj2_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, i, obj2_check, sizeof(obj2_check)));
+    EXPECT_EQ(0, memcmp(obj2, obj2_check, sizeof(obj2)));
+  }
+
+  unsigned char obj1_check[OBJ1_SIZE];
+  memset(obj1_check, 0, sizeof(obj1_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 63, obj1_check, sizeof(obj1_check)));
+  EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+}
+
 class LogfsTestCookedMultiPart : public LogfsTestRaw {
 protected:
   virtual void SetUp() {
@@ -0,0 +1,296 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+
+extern "C" {
+#define restrict		/* neuter restrict keyword since it's not in C++ */
+
+#include "mixer.h"
+#include "misc_math.h"
+}
+
+#define ROLL     1
+#define PITCH    2
+#define YAW      MIXER_INPUT_YAW
+#define THROTTLE 0
+
+// To use a test fixture, derive a class from testing::Test.
+class MixerTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    mixer_matrix_clear(&m);
+    memset(full, 0, sizeof(full));
+  }
+
+  virtual void TearDown() {
+  }
+
+  // Add a row both to the packed mixer and to the full matrix the actuator
+  // module used to multiply by
+  void add_row(int channel, const float row[MIXER_NUM_INPUTS], bool motor) {
+    ASSERT_EQ(0, mixer_matrix_add_row(&m, channel, row, motor));
+    memcpy(&full[channel * MIXER_NUM_INPUTS], row, sizeof(float) * MIXER_NUM_INPUTS);
+  }
+
+  // Quad X, throttle on input 0
+  void add_quad_x() {
+    const float rows[4][MIXER_NUM_INPUTS] = {
+      { 1,  1,  1, 0, -1 },
+      { 1, -1,  1, 0,  1 },
+      { 1, -1, -1, 0, -1 },
+      { 1,  1, -1, 0,  1 },
+    };
+
+    for (int i = 0; i < 4; i++)
+      add_row(i, rows[i], true);
+  }
+
+  float motor_spread(const float *out) {
+    float min_chan, max_chan, neg_clip;
+    mixer_motor_range(&m, out, &min_chan, &max_chan, &neg_clip);
+    return max_chan - min_chan;
+  }
+
+  struct mixer_matrix m;
+  float full[MIXER_MAX_OUTPUTS * MIXER_NUM_INPUTS];
+};
+
+static float rand_coef()
+{
+  // Plenty of exact zeros, like real mixers have
+  if (rand() % 3 == 0)
+    return 0;
+
+  return (rand() % 2001 - 1000) / 500.0f;
+}
+
+TEST_F(MixerTest, MatchesFullMatrix) {
+  srand(1);
+
+  for (int trial = 0; trial < 200; trial++) {
+    SetUp();
+
+    // Motors, servos and unmixed channels in any order
+    for (int ch = 0; ch < MIXER_MAX_OUTPUTS; ch++) {
+      int type = rand() % 3;
+      if (type == 2)
+        continue;
+
+      float row[MIXER_NUM_INPUTS];
+      for (int k = 0; k < MIXER_NUM_INPUTS; k++)
+        row[k] = rand_coef();
+
+      // Some inputs are never used by anything
+      row[5] = row[7] = 0;
+
+      add_row(ch, row, type == 0);
+    }
+
+    EXPECT_GE(MIXER_NUM_INPUTS - 2, m.num_cols);
+
+    // Motors come first, still in channel order
+    for (int r = 1; r < m.num_motors; r++)
+      EXPECT_LT(m.channel[r - 1], m.channel[r]);
+
+    for (int i = 0; i < 20; i++) {
+      float in[MIXER_NUM_INPUTS];
+      for (int k = 0; k < MIXER_NUM_INPUTS; k++)
+        in[k] = (rand() % 20001 - 10000) / 10000.0f;
+
+      float expected[MIXER_MAX_OUTPUTS];
+      float out[MIXER_MAX_OUTPUTS] = { 0 };
+
+      matrix_mul(full, in, expected, MIXER_MAX_OUTPUTS, MIXER_NUM_INPUTS, 1);
+      mixer_matrix_apply(&m, in, out);
+
+      // Bit for bit, so nothing about flight behaviour changes
+      for (int ch = 0; ch < MIXER_MAX_OUTPUTS; ch++)
+        ASSERT_EQ(0, memcmp(&expected[ch], &out[ch], sizeof(float)))
+          << "trial " << trial << " channel " << ch
+          << ": " << expected[ch] << " vs " << out[ch];
+    }
+  }
+}
+
+TEST_F(MixerTest, FullMixerRejected) {
+  const float row[MIXER_NUM_INPUTS] = { 1 };
+
+  for (int i = 0; i < MIXER_MAX_OUTPUTS; i++)
+    EXPECT_EQ(0, mixer_matrix_add_row(&m, i, row, true));
+
+  EXPECT_EQ(-1, mixer_matrix_add_row(&m, 0, row, false));
+}
+
+TEST_F(MixerTest, DesaturateGivesUpYawFirst) {
+  add_quad_x();
+
+  float in[MIXER_NUM_INPUTS] = { 0 };
+  in[THROTTLE] = 0.5f;
+  in[ROLL] = 0.2f;
+  in[PITCH] = 0.1f;
+  in[YAW] = 0.5f;
+
+  float out[MIXER_MAX_OUTPUTS] = { 0 };
+  mixer_matrix_apply(&m, in, out);
+  ASSERT_GT(motor_spread(out), 1.0f);
+
+  float keep = mixer_desaturate_yaw(&m, in[YAW], out);
+
+  EXPECT_GT(keep, 0.0f);
+  EXPECT_LT(keep, 1.0f);
+  EXPECT_LE(motor_spread(out), 1.0f);
+  // Close to the limit, only as much yaw as needed was taken away
+  EXPECT_GT(motor_spread(out), 0.99f);
+
+  // Roll, pitch and throttle are untouched
+  float expect_in[MIXER_NUM_INPUTS];
+  memcpy(expect_in, in, sizeof(in));
+  expect_in[YAW] *= keep;
+
+  float expected[MIXER_MAX_OUTPUTS] = { 0 };
+  mixer_matrix_apply(&m, expect_in, expected);
+
+  for (int i = 0; i < 4; i++)
+    EXPECT_NEAR(expected[i], out[i], 1e-6f);
+}
+
+TEST_F(MixerTest, DesaturateLeavesUnsaturatedAlone) {
+  add_quad_x();
+
+  float in[MIXER_NUM_INPUTS] = { 0 };
+  in[THROTTLE] = 0.5f;
+  in[ROLL] = 0.1f;
+  in[YAW] = 0.2f;
+
+  float out[MIXER_MAX_OUTPUTS] = { 0 };
+  mixer_matrix_apply(&m, in, out);
+
+  float before[MIXER_MAX_OUTPUTS];
+  memcpy(before, out, sizeof(out));
+
+  EXPECT_EQ(1.0f, mixer_desaturate_yaw(&m, in[YAW], out));
+  EXPECT_EQ(0, memcmp(before, out, sizeof(out)));
+}
+
+TEST_F(MixerTest, DesaturateDropsAllYawWhenRollPitchSaturate) {
+  add_quad_x();
+
+  float in[MIXER_NUM_INPUTS] = { 0 };
+  in[THROTTLE] = 0.5f;
+  in[ROLL] = 0.4f;
+  in[PITCH] = 0.3f;
+  in[YAW] = 0.3f;
+
+  float out[MIXER_MAX_OUTPUTS] = { 0 };
+  mixer_matrix_apply(&m, in, out);
+
+  EXPECT_EQ(0.0f, mixer_desaturate_yaw(&m, in[YAW], out));
+
+  // What's left is pure roll and pitch, for the actuator to scale
+  EXPECT_NEAR(1.4f, motor_spread(out), 1e-6f);
+}
+
+TEST_F(MixerTest, CurveMatchesPow) {
+  const float exponents[] = { 0.7f, 0.9f, 1.0f, 1.3f, 2.0f };
+  struct mixer_curve curve;
+
+  for (unsigned int i = 0; i < sizeof(exponents) / sizeof(exponents[0]); i++) {
+    mixer_curve_build(&curve, exponents[i], 0.8f);
+
+    float worst = 0;
+    for (int j = 0; j <= 10000; j++) {
+      float x = j / 10000.0f;
+      float err = fabsf(mixer_curve_eval(&curve, x) - powf(x, exponents[i]) * 0.8f);
+      worst = fmaxf(worst, err);
+    }
+
+    // Worst in the first segment for exponents below 1, where motors idle
+    EXPECT_LT(worst, 0.005f) << "exponent " << exponents[i];
+  }
+
+  // Clamped outside of [0, 1]
+  EXPECT_EQ(0.0f, mixer_curve_eval(&curve, -0.5f));
+  EXPECT_EQ(0.8f, mixer_curve_eval(&curve, 1.5f));
+}
+
+static double now_seconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+TEST_F(MixerTest, BenchmarkMixAndCurve) {
+  add_quad_x();
+
+  const int iterations = 1000000;
+  float in[MIXER_NUM_INPUTS] = { 0.5f, 0.1f, -0.1f, 0, 0.05f };
+  float out[MIXER_MAX_OUTPUTS] = { 0 };
+  struct mixer_curve curve;
+  volatile float sink = 0;
+
+  mixer_curve_build(&curve, 0.9f, 1.0f);
+
+  double start = now_seconds();
+  for (int i = 0; i < iterations; i++) {
+    in[ROLL] = (i & 255) / 1024.0f;
+    matrix_mul(full, in, out, MIXER_MAX_OUTPUTS, MIXER_NUM_INPUTS, 1);
+    for (int ch = 0; ch < 4; ch++)
+      sink = sink + powf(out[ch], 0.9f);
+  }
+  double full_time = now_seconds() - start;
+
+  start = now_seconds();
+  for (int i = 0; i < iterations; i++) {
+    in[ROLL] = (i & 255) / 1024.0f;
+    mixer_matrix_apply(&m, in, out);
+    for (int ch = 0; ch < 4; ch++)
+      sink = sink + mixer_curve_eval(&curve, out[ch]);
+  }
+  double packed_time = now_seconds() - start;
+
+  printf("Full matrix and powf: %.1f ns/update\n", full_time * 1e9 / iterations);
+  printf("Packed mixer and curve table: %.1f ns/update\n", packed_time * 1e9 / iterations);
+}
+
+/**
+ * @}
+ * @}
+ */
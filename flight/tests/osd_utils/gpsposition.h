@@ -0,0 +1,13 @@
+/* Stand-in for the generated UAVO header, only the fields osd_utils uses */
+#ifndef GPSPOSITION_H
+#define GPSPOSITION_H
+
+#include <stdint.h>
+
+typedef struct {
+	float GeoidSeparation;
+} GPSPositionData;
+
+int32_t GPSPositionGet(GPSPositionData *dataOut);
+
+#endif /* GPSPOSITION_H */
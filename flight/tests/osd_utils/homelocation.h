@@ -0,0 +1,15 @@
+/* Stand-in for the generated UAVO header, only the fields osd_utils uses */
+#ifndef HOMELOCATION_H
+#define HOMELOCATION_H
+
+#include <stdint.h>
+
+typedef struct {
+	int32_t Latitude;
+	int32_t Longitude;
+	float Altitude;
+} HomeLocationData;
+
+int32_t HomeLocationGet(HomeLocationData *dataOut);
+
+#endif /* HOMELOCATION_H */
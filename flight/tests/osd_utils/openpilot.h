@@ -0,0 +1,7 @@
+/* Stand-in for PiOS/openpilot.h: the OSD drawing code only needs PiOS */
+#ifndef OPENPILOT_H
+#define OPENPILOT_H
+
+#include <pios.h>
+
+#endif /* OPENPILOT_H */
@@ -0,0 +1,6 @@
+#define PIOS_NO_HW
+#define FLIGHT_POSIX
+
+#define PIOS_INCLUDE_RTC
+#define PIOS_INCLUDE_VIDEO
+#define PIOS_VIDEO_SPLITBUFFER
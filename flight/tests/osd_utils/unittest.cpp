@@ -0,0 +1,427 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+
+extern "C" {
+#define restrict		/* neuter restrict keyword since it's not in C++ */
+
+#include "osd_utils.h"
+#include "physical_constants.h"
+
+extern uint8_t *draw_buffer_level;
+extern uint8_t *draw_buffer_mask;
+
+void write_circle(uint8_t *buff, int cx, int cy, int r, int dashp, int mode);
+void write_circle_filled(uint8_t *buff, int cx, int cy, int r, int mode);
+}
+
+#define PLANE_SIZE (BUFFER_HEIGHT * BUFFER_WIDTH)
+
+// To use a test fixture, derive a class from testing::Test.
+class OsdUtilsTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    struct pios_video_cfg cfg = { PIOS_VIDEO_SYSTEM_PAL };
+    PIOS_Video_Init(&cfg);
+    clearGraphics();
+    memset(ref_level, 0, sizeof(ref_level));
+    memset(ref_mask, 0, sizeof(ref_mask));
+  }
+
+  virtual void TearDown() {
+  }
+
+  // Per pixel reference implementations of what the span renderer draws
+  void ref_pixel(int x, int y, int lmode, int mmode);
+  void ref_line(int x0, int y0, int x1, int y1, int lmode, int mmode);
+  void ref_line_outlined(int x0, int y0, int x1, int y1, int mode, int mmode);
+  void ref_circle(uint8_t *buff, int cx, int cy, int r, int dashp, int ox,
+      int oy, int mode);
+  void ref_circle_filled(uint8_t *buff, int cx, int cy, int r, int mode);
+  void expect_matches_reference();
+
+  uint8_t ref_level[PLANE_SIZE];
+  uint8_t ref_mask[PLANE_SIZE];
+};
+
+static void ref_write(uint8_t *buff, int addr, uint8_t mask, int mode)
+{
+  switch (mode) {
+  case 0: buff[addr] &= ~mask; break;
+  case 1: buff[addr] |= mask; break;
+  case 2: buff[addr] ^= mask; break;
+  }
+}
+
+void OsdUtilsTest::ref_pixel(int x, int y, int lmode, int mmode)
+{
+  if (x < GRAPHICS_LEFT || x > GRAPHICS_RIGHT || y < GRAPHICS_TOP || y > GRAPHICS_BOTTOM)
+    return;
+
+  int addr = CALC_BUFF_ADDR(x, y);
+  uint8_t mask = CALC_BIT_MASK(x);
+  ref_write(ref_mask, addr, mask, mmode);
+  ref_write(ref_level, addr, mask, lmode);
+}
+
+// Pixel by pixel Bresenham, as osd_utils used to draw lines
+void OsdUtilsTest::ref_line(int x0, int y0, int x1, int y1, int lmode, int mmode)
+{
+  int steep = abs(y1 - y0) > abs(x1 - x0);
+  if (steep) {
+    std::swap(x0, y0);
+    std::swap(x1, y1);
+  }
+  if (x0 > x1) {
+    std::swap(x0, x1);
+    std::swap(y0, y1);
+  }
+  int deltax = x1 - x0;
+  int deltay = abs(y1 - y0);
+  int error = deltax / 2;
+  int ystep = (y0 < y1) ? 1 : -1;
+  int y = y0;
+  for (int x = x0; x < x1; x++) {
+    if (steep)
+      ref_pixel(y, x, lmode, mmode);
+    else
+      ref_pixel(x, y, lmode, mmode);
+    error -= deltay;
+    if (error < 0) {
+      y += ystep;
+      error += deltax;
+    }
+  }
+}
+
+void OsdUtilsTest::ref_line_outlined(int x0, int y0, int x1, int y1, int mode, int mmode)
+{
+  int omode = mode == 0 ? 0 : 1;
+  int imode = mode == 0 ? 1 : 0;
+
+  // The outline is the line stamped with its four neighbours...
+  ref_line(x0 - 1, y0, x1 - 1, y1, omode, mmode);
+  ref_line(x0 + 1, y0, x1 + 1, y1, omode, mmode);
+  ref_line(x0, y0 - 1, x1, y1 - 1, omode, mmode);
+  ref_line(x0, y0 + 1, x1, y1 + 1, omode, mmode);
+  // ...and the innards are drawn over it.
+  ref_line(x0, y0, x1, y1, imode, mmode);
+}
+
+static void ref_plane_pixel(uint8_t *buff, int x, int y, int mode)
+{
+  if (x < GRAPHICS_LEFT || x > GRAPHICS_RIGHT || y < GRAPHICS_TOP || y > GRAPHICS_BOTTOM)
+    return;
+
+  ref_write(buff, CALC_BUFF_ADDR(x, y), CALC_BIT_MASK(x), mode);
+}
+
+// Point by point midpoint circle, as osd_utils used to draw circles, with
+// every point moved by ox, oy before it's mirrored
+void OsdUtilsTest::ref_circle(uint8_t *buff, int cx, int cy, int r, int dashp,
+    int ox, int oy, int mode)
+{
+  int error = -r, x = r, y = 0;
+  while (x >= y) {
+    if (dashp == 0 || (y % dashp) < (dashp / 2)) {
+      int px = x + ox, py = y + oy;
+      for (int swap = 0; swap < 2; swap++) {
+        if (swap && px == py)
+          break;
+        int a = swap ? py : px, b = swap ? px : py;
+        ref_plane_pixel(buff, cx + a, cy + b, mode);
+        ref_plane_pixel(buff, cx - a, cy + b, mode);
+        ref_plane_pixel(buff, cx + a, cy - b, mode);
+        ref_plane_pixel(buff, cx - a, cy - b, mode);
+      }
+    }
+    error += (y * 2) + 1;
+    y++;
+    if (error >= 0) {
+      --x;
+      error -= x * 2;
+    }
+  }
+}
+
+void OsdUtilsTest::ref_circle_filled(uint8_t *buff, int cx, int cy, int r, int mode)
+{
+  int error = -r, x = r, y = 0, xch = 0;
+  while (x >= y) {
+    if (y != 0) {
+      for (int i = cx - x; i <= cx + x; i++) {
+        ref_plane_pixel(buff, i, cy + y, mode);
+        ref_plane_pixel(buff, i, cy - y, mode);
+      }
+      if (mode != 2 || (xch && (cx - x) != (cx - y))) {
+        for (int i = cx - y; i <= cx + y; i++) {
+          ref_plane_pixel(buff, i, cy + x, mode);
+          ref_plane_pixel(buff, i, cy - x, mode);
+        }
+        xch = 0;
+      }
+    }
+    error += (y * 2) + 1;
+    y++;
+    if (error >= 0) {
+      --x;
+      xch = 1;
+      error -= x * 2;
+    }
+  }
+  if (mode == 2)
+    for (int i = cx - r; i <= cx + r; i++)
+      ref_plane_pixel(buff, i, cy, mode);
+}
+
+void OsdUtilsTest::expect_matches_reference()
+{
+  for (int i = 0; i < PLANE_SIZE; i++) {
+    ASSERT_EQ(ref_mask[i], draw_buffer_mask[i]) << "mask byte " << i;
+    ASSERT_EQ(ref_level[i], draw_buffer_level[i]) << "level byte " << i;
+  }
+}
+
+TEST_F(OsdUtilsTest, SpanEdges) {
+  // Within one byte, across a byte boundary, spanning whole words, and
+  // hanging off both sides of the screen
+  const int spans[][2] = {
+    {3, 3}, {0, 7}, {5, 9}, {7, 8}, {1, 70}, {33, 31},
+    {-20, 12}, {300, 500}, {-5, 400},
+  };
+
+  for (unsigned int i = 0; i < NELEMENTS(spans); i++) {
+    int y = 10 + 3 * i;
+    write_span_lm(spans[i][0], spans[i][1], y, 1, 1);
+
+    int x0 = std::min(spans[i][0], spans[i][1]);
+    int x1 = std::max(spans[i][0], spans[i][1]);
+    for (int x = x0; x <= x1; x++)
+      ref_pixel(x, y, 1, 1);
+  }
+
+  // Toggling goes through the word loop rather than memset
+  write_span_lm(2, 300, 200, 2, 2);
+  for (int x = 2; x <= 300; x++)
+    ref_pixel(x, 200, 2, 2);
+
+  expect_matches_reference();
+}
+
+TEST_F(OsdUtilsTest, LinesMatchBresenham) {
+  srand(42);
+
+  for (int i = 0; i < 500; i++) {
+    int x0 = rand() % 420 - 30;
+    int y0 = rand() % 320 - 30;
+    int x1 = rand() % 420 - 30;
+    int y1 = rand() % 320 - 30;
+
+    write_line_lm(x0, y0, x1, y1, 1, 2);
+    ref_line(x0, y0, x1, y1, 2, 1);
+  }
+
+  expect_matches_reference();
+}
+
+TEST_F(OsdUtilsTest, OutlinedLinesMatchPerPixel) {
+  srand(7);
+
+  for (int i = 0; i < 200; i++) {
+    int x0 = rand() % 420 - 30;
+    int y0 = rand() % 320 - 30;
+    int x1 = rand() % 420 - 30;
+    int y1 = rand() % 320 - 30;
+
+    // Compare a line at a time, overlaps with earlier lines are legitimate
+    SetUp();
+    write_line_outlined(x0, y0, x1, y1, 2, 2, i & 1, 1);
+    ref_line_outlined(x0, y0, x1, y1, i & 1, 1);
+    expect_matches_reference();
+  }
+}
+
+TEST_F(OsdUtilsTest, CirclesMatchPerPixel) {
+  srand(11);
+
+  for (int i = 0; i < 200; i++) {
+    int cx = rand() % 380;
+    int cy = rand() % 280;
+    int r = rand() % 150;
+    int dashp = (i & 1) ? rand() % 9 : 0;
+    int mode = i % 3;
+    int bmode = (i >> 1) & 1;
+
+    // Toggles show up every pixel written twice or missed
+    SetUp();
+    write_circle(draw_buffer_mask, cx, cy, r, dashp, mode);
+    write_circle_filled(draw_buffer_level, cx, cy, r, mode);
+    if (cx >= GRAPHICS_LEFT && cx <= GRAPHICS_RIGHT &&
+        cy >= GRAPHICS_TOP && cy <= GRAPHICS_BOTTOM) {
+      ref_circle(ref_mask, cx, cy, r, dashp, 0, 0, mode);
+      ref_circle_filled(ref_level, cx, cy, r, mode);
+    }
+    expect_matches_reference();
+
+    SetUp();
+    write_circle_outlined(cx, cy, r, dashp, bmode, mode & 1, 2);
+    if (cx >= GRAPHICS_LEFT && cx <= GRAPHICS_RIGHT &&
+        cy >= GRAPHICS_TOP && cy <= GRAPHICS_BOTTOM) {
+      static const int border[6][2] = {
+        { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 }, { 1, 1 }, { -1, -1 },
+      };
+      int stroke = (mode & 1) ? 1 : 0;
+      for (int b = 0; b < (bmode ? 6 : 4); b++) {
+        ref_circle(ref_mask, cx, cy, r, dashp, border[b][0], border[b][1], 2);
+        ref_circle(ref_level, cx, cy, r, dashp, border[b][0], border[b][1], stroke);
+      }
+      ref_circle(ref_mask, cx, cy, r, dashp, 0, 0, 2);
+      ref_circle(ref_level, cx, cy, r, dashp, 0, 0, !stroke);
+    }
+    expect_matches_reference();
+  }
+}
+
+TEST_F(OsdUtilsTest, FilledRectangle) {
+  write_filled_rectangle_lm(10, 20, 50, 30, 1, 1);
+  write_filled_rectangle_lm(17, 60, 3, 5, 0, 1);
+
+  for (int y = 20; y < 50; y++)
+    for (int x = 10; x <= 60; x++)
+      ref_pixel(x, y, 1, 1);
+  for (int y = 60; y < 65; y++)
+    for (int x = 17; x <= 20; x++)
+      ref_pixel(x, y, 0, 1);
+
+  expect_matches_reference();
+}
+
+TEST_F(OsdUtilsTest, ClearOnlyDirtyRows) {
+  uint8_t *buffer0 = draw_buffer_mask;
+
+  // First time around each buffer gets a full clear
+  write_pixel_lm(5, 10, 1, 1);
+  PIOS_Vsync_ISR();
+  clearGraphics();
+  write_span_lm(0, 100, 200, 1, 1);
+  PIOS_Vsync_ISR();
+  ASSERT_EQ(buffer0, draw_buffer_mask);
+
+  // Something written behind osd_utils' back outside of the dirty band
+  // must survive, proving only rows 10 and 11 are cleared.
+  write_line_lm(0, 11, 50, 11, 1, 1);
+  draw_buffer_mask[100 * BUFFER_WIDTH] = 0xa5;
+  clearGraphics();
+
+  for (int i = 0; i < PLANE_SIZE; i++) {
+    if (i == 100 * BUFFER_WIDTH)
+      EXPECT_EQ(0xa5, draw_buffer_mask[i]);
+    else
+      ASSERT_EQ(0, draw_buffer_mask[i]) << "mask byte " << i;
+    ASSERT_EQ(0, draw_buffer_level[i]) << "level byte " << i;
+  }
+
+  // The other buffer still has its span
+  PIOS_Vsync_ISR();
+  EXPECT_NE(0, draw_buffer_mask[200 * BUFFER_WIDTH]);
+  clearGraphics();
+  EXPECT_EQ(0, draw_buffer_mask[200 * BUFFER_WIDTH]);
+}
+
+static double now_seconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// A rough HUD: artificial horizon with pitch ladder, heading tape, side
+// scales and some text, driven by a synthetic attitude and telemetry trace.
+static void render_hud_frame(int frame)
+{
+  float roll = 35.0f * sinf(frame * 0.031f);
+  float pitch = 20.0f * sinf(frame * 0.017f);
+  float yaw = fmodf(frame * 0.7f, 360.0f);
+  float cr = cosf(roll * DEG2RAD), sr = sinf(roll * DEG2RAD);
+  char buf[32];
+
+  for (int p = -30; p <= 30; p += 5) {
+    int cy = GRAPHICS_Y_MIDDLE + (p - pitch) * 4;
+    int half = p == 0 ? 150 : 30;
+    int dx = half * cr, dy = half * sr;
+    write_line_outlined(GRAPHICS_X_MIDDLE - dx, cy - dy, GRAPHICS_X_MIDDLE + dx, cy + dy,
+                        2, 2, 0, 1);
+  }
+
+  for (int i = 0; i < 10; i++) {
+    int x = 40 + ((int)(i * 30 - yaw * 3) % 300 + 300) % 300;
+    write_vline_lm(x, 10, 16, 1, 1);
+    sprintf(buf, "%d", i * 36);
+    write_string(buf, x, 20, 0, 0, TEXT_VA_TOP, TEXT_HA_CENTER, 0, 1);
+  }
+
+  write_filled_rectangle_lm(5, 60, 40, 150, 0, 1);
+  write_filled_rectangle_lm(GRAPHICS_RIGHT - 45, 60, 40, 150, 0, 1);
+  write_rectangle_outlined(5, 60, 40, 150, 0, 1);
+  write_rectangle_outlined(GRAPHICS_RIGHT - 45, 60, 40, 150, 0, 1);
+
+  sprintf(buf, "%5.1fV %4.1fA", 12.0f + sinf(frame * 0.01f), 10.0f);
+  write_string(buf, 10, GRAPHICS_BOTTOM - 20, 0, 0, TEXT_VA_TOP, TEXT_HA_LEFT, 0, 2);
+  sprintf(buf, "ALT %4d", frame % 1000);
+  write_string(buf, GRAPHICS_RIGHT - 10, GRAPHICS_BOTTOM - 20, 0, 0, TEXT_VA_TOP, TEXT_HA_RIGHT, 0, 2);
+}
+
+TEST_F(OsdUtilsTest, BenchmarkFramesPerSecond) {
+  const int frames = 2000;
+
+  double start = now_seconds();
+  for (int i = 0; i < frames; i++) {
+    clearGraphics();
+    render_hud_frame(i);
+    PIOS_Vsync_ISR();
+  }
+  double elapsed = now_seconds() - start;
+
+  printf("OSD renderer: %d frames in %.3f s, %.0f frames/s\n", frames, elapsed, frames / elapsed);
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,19 @@
+#include <string.h>
+
+#include "gpsposition.h"
+#include "homelocation.h"
+
+// Normally provided by the OnScreenDisplay module, never created here
+struct pios_semaphore *onScreenDisplaySemaphore = NULL;
+
+int32_t GPSPositionGet(GPSPositionData *dataOut)
+{
+	memset(dataOut, 0, sizeof(*dataOut));
+	return 0;
+}
+
+int32_t HomeLocationGet(HomeLocationData *dataOut)
+{
+	memset(dataOut, 0, sizeof(*dataOut));
+	return 0;
+}
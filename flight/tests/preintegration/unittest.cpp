@@ -0,0 +1,278 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test of the IMU preintegration
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <math.h>		/* sinf */
+#include <string.h>		/* memset */
+#include <time.h>		/* clock_gettime */
+
+extern "C" {
+#include "preintegration.h"
+#include "insgps.h"
+}
+
+static double now_seconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Angle between two attitude quaternions, rad */
+static float quat_error(const float a[4], const float b[4])
+{
+  float dot = fabsf(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]);
+
+  if (dot > 1.0f) {
+    dot = 1.0f;
+  }
+
+  return 2.0f * acosf(dot);
+}
+
+/* Body rates and specific force of a vehicle vibrating in ways that make
+ * summed samples go wrong: the rate vector cones about z, and the roll rate
+ * is in phase with a lateral acceleration, which sculls. */
+static const float VIB_HZ = 40.0f;
+static const float CONE_RATE = 2.0f;	/* rad/s */
+static const float SCULL_ACCEL = 5.0f;	/* m/s^2 */
+
+static void motion(double t, float gyro[3], float accel[3])
+{
+  float w = 2 * M_PI * VIB_HZ * t;
+
+  gyro[0] = CONE_RATE * cosf(w);
+  gyro[1] = CONE_RATE * sinf(w);
+  gyro[2] = 0.3f;
+
+  accel[0] = 0.5f;
+  accel[1] = SCULL_ACCEL * cosf(w);
+  accel[2] = -9.81f;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class PreintegrationTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    preintegration_init(&p);
+  }
+
+  virtual void TearDown() {
+  }
+
+  struct preintegration p;
+};
+
+TEST_F(PreintegrationTest, ConstantRate) {
+  const float gyro[3] = { 0.1f, -0.2f, 0.3f };
+  const float accel[3] = { 1.0f, 2.0f, -9.81f };
+
+  for (int i = 0; i < 16; i++) {
+    preintegration_add(&p, gyro, accel, 0.000125f);
+  }
+
+  struct imu_increment inc;
+  preintegration_get(&p, &inc);
+
+  /* A fixed axis needs no coning correction, and the sculling from a
+   * constant force in a steadily turning frame is all in the frame */
+  for (int i = 0; i < 3; i++) {
+    EXPECT_NEAR(gyro[i] * 0.002f, inc.delta_angle[i], 1e-7f);
+    EXPECT_NEAR(accel[i] * 0.002f, inc.delta_velocity[i], 1e-6f);
+  }
+
+  EXPECT_NEAR(0.002f, inc.dt, 1e-7f);
+  EXPECT_EQ(16, inc.samples);
+
+  preintegration_restart(&p);
+  preintegration_get(&p, &inc);
+
+  EXPECT_EQ(0.0f, inc.dt);
+  EXPECT_EQ(0, inc.samples);
+  EXPECT_EQ(0.0f, inc.delta_angle[0]);
+}
+
+/* Replays the same motion through the INS three ways and compares each to
+ * a reference propagated at eight times the sample rate. */
+struct replay_result {
+  float att_error;	/* rad */
+  float vel_error;	/* m/s */
+  double cpu;		/* s */
+};
+
+static const float SAMPLE_RATE = 8000;
+static const float DURATION = 5;
+
+enum replay_mode {
+  REPLAY_EVERY_SAMPLE,	/* The INS step per sample, as before */
+  REPLAY_PREINTEGRATED,	/* Corrected increments at a lower rate */
+  REPLAY_SUMMED,	/* Plain sums at a lower rate */
+};
+
+static void ins_start()
+{
+  const float zeros[3] = { 0, 0, 0 };
+  const float q[4] = { 1, 0, 0, 0 };
+
+  INSGPSInit();
+  INSSetState(zeros, zeros, q, zeros, zeros);
+  INSSetArmed(true);
+}
+
+static void run_reference(float q[4], float vel[3])
+{
+  const int sub = 8;
+  const float dt = 1.0f / (SAMPLE_RATE * sub);
+  const int steps = DURATION * SAMPLE_RATE * sub;
+
+  ins_start();
+
+  for (int i = 0; i < steps; i++) {
+    float gyro[3], accel[3];
+    motion((i + 0.5) * dt, gyro, accel);
+
+    INSStatePrediction(gyro, accel, dt);
+  }
+
+  INSGetState(NULL, vel, q, NULL, NULL);
+}
+
+static struct replay_result replay(enum replay_mode mode, int decimation,
+    int cov_divider, const float q_ref[4], const float vel_ref[3])
+{
+  const float dt = 1.0f / SAMPLE_RATE;
+  const int samples = DURATION * SAMPLE_RATE;
+
+  struct preintegration acc;
+  preintegration_init(&acc);
+
+  int steps = 0;
+  float cov_dt = 0;
+
+  ins_start();
+
+  double start = now_seconds();
+
+  for (int i = 0; i < samples; i++) {
+    float gyro[3], accel[3];
+    motion((i + 0.5) * dt, gyro, accel);
+
+    struct imu_increment inc;
+
+    if (mode == REPLAY_EVERY_SAMPLE) {
+      memcpy(inc.delta_angle, gyro, sizeof(gyro));
+      memcpy(inc.delta_velocity, accel, sizeof(accel));
+      inc.dt = dt;
+    } else {
+      if (mode == REPLAY_PREINTEGRATED) {
+        preintegration_add(&acc, gyro, accel, dt);
+      } else {
+        for (int j = 0; j < 3; j++) {
+          acc.alpha[j] += gyro[j] * dt;
+          acc.nu[j] += accel[j] * dt;
+        }
+
+        acc.dt += dt;
+      }
+
+      if ((i + 1) % decimation) {
+        continue;
+      }
+
+      preintegration_get(&acc, &inc);
+      preintegration_restart(&acc);
+
+      for (int j = 0; j < 3; j++) {
+        inc.delta_angle[j] /= inc.dt;
+        inc.delta_velocity[j] /= inc.dt;
+      }
+    }
+
+    INSStatePrediction(inc.delta_angle, inc.delta_velocity, inc.dt);
+
+    cov_dt += inc.dt;
+
+    if (++steps % cov_divider == 0) {
+      INSCovariancePrediction(cov_dt);
+      cov_dt = 0;
+    }
+  }
+
+  struct replay_result res;
+  res.cpu = now_seconds() - start;
+
+  float q[4], vel[3];
+  INSGetState(NULL, vel, q, NULL, NULL);
+
+  res.att_error = quat_error(q, q_ref);
+  res.vel_error = sqrtf(powf(vel[0] - vel_ref[0], 2) +
+      powf(vel[1] - vel_ref[1], 2) + powf(vel[2] - vel_ref[2], 2));
+
+  return res;
+}
+
+TEST_F(PreintegrationTest, ReplayAgainstEverySample) {
+  float q_ref[4], vel_ref[3];
+  run_reference(q_ref, vel_ref);
+
+  struct replay_result every = replay(REPLAY_EVERY_SAMPLE, 1, 1,
+      q_ref, vel_ref);
+  struct replay_result preint = replay(REPLAY_PREINTEGRATED, 16, 2,
+      q_ref, vel_ref);
+  struct replay_result summed = replay(REPLAY_SUMMED, 16, 2,
+      q_ref, vel_ref);
+
+  printf("%-36s %8.5f deg %6.4f m/s %5.3f s\n", "Every sample, 8 kHz:",
+      every.att_error * 180 / M_PI, every.vel_error, every.cpu);
+  printf("%-36s %8.5f deg %6.4f m/s %5.3f s\n", "Preintegrated, 500 Hz:",
+      preint.att_error * 180 / M_PI, preint.vel_error, preint.cpu);
+  printf("%-36s %8.5f deg %6.4f m/s %5.3f s\n", "Summed, 500 Hz:",
+      summed.att_error * 180 / M_PI, summed.vel_error, summed.cpu);
+
+  /* As accurate as running on every sample... */
+  EXPECT_GT(0.1f * M_PI / 180, preint.att_error);
+  EXPECT_GT(0.05f, preint.vel_error);
+
+  /* ...where leaving out the corrections is not */
+  EXPECT_LT(10 * preint.att_error, summed.att_error);
+
+  /* ...for a fraction of the work */
+  EXPECT_GT(every.cpu / 4, preint.cpu);
+}
+
+/**
+ * @}
+ * @}
+ */
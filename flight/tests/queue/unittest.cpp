@@ -0,0 +1,391 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test of the posix queues and semaphores
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <pthread.h>		/* pthread_create */
+#include <time.h>		/* clock_gettime */
+#include <unistd.h>		/* usleep */
+
+extern "C" {
+#include "pios.h"
+#include "pios_queue.h"
+#include "pios_semaphore.h"
+#include "pios_thread.h"
+}
+
+/* The same size as a UAVObjEvent, the most common item */
+struct item {
+  uint32_t producer;
+  uint32_t seq;
+  uint32_t pad[2];
+};
+
+static double now_seconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static pthread_t start_thread(void *(*fn)(void *), void *arg)
+{
+  pthread_t t;
+
+  if (pthread_create(&t, NULL, fn, arg)) {
+    abort();
+  }
+
+  return t;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class QueueTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+  }
+
+  virtual void TearDown() {
+  }
+};
+
+TEST_F(QueueTest, FifoOrder) {
+  struct pios_queue *q = PIOS_Queue_Create(8, sizeof(uint32_t));
+  ASSERT_TRUE(q != NULL);
+
+  for (uint32_t lap = 0; lap < 5; lap++) {
+    for (uint32_t i = 0; i < 8; i++) {
+      uint32_t val = lap * 100 + i;
+      EXPECT_TRUE(PIOS_Queue_Send(q, &val, 0));
+    }
+
+    for (uint32_t i = 0; i < 8; i++) {
+      uint32_t val;
+      EXPECT_TRUE(PIOS_Queue_Receive(q, &val, 0));
+      EXPECT_EQ(lap * 100 + i, val);
+    }
+  }
+
+  EXPECT_EQ(sizeof(uint32_t), PIOS_Queue_GetItemSize(q));
+
+  PIOS_Queue_Delete(q);
+}
+
+TEST_F(QueueTest, LengthIsExact) {
+  /* Not a power of two, so the ring has spare cells */
+  struct pios_queue *q = PIOS_Queue_Create(3, sizeof(struct item));
+  ASSERT_TRUE(q != NULL);
+
+  struct item it = { 0, 0, { 0, 0 } };
+
+  for (int lap = 0; lap < 4; lap++) {
+    EXPECT_TRUE(PIOS_Queue_Send(q, &it, 0));
+    EXPECT_TRUE(PIOS_Queue_Send(q, &it, 0));
+    EXPECT_TRUE(PIOS_Queue_Send(q, &it, 0));
+    EXPECT_FALSE(PIOS_Queue_Send(q, &it, 0));
+
+    EXPECT_TRUE(PIOS_Queue_Receive(q, &it, 0));
+    EXPECT_TRUE(PIOS_Queue_Send(q, &it, 0));
+    EXPECT_FALSE(PIOS_Queue_Send(q, &it, 0));
+
+    for (int i = 0; i < 3; i++) {
+      EXPECT_TRUE(PIOS_Queue_Receive(q, &it, 0));
+    }
+
+    EXPECT_FALSE(PIOS_Queue_Receive(q, &it, 0));
+  }
+
+  PIOS_Queue_Delete(q);
+}
+
+TEST_F(QueueTest, ReceiveTimesOut) {
+  struct pios_queue *q = PIOS_Queue_Create(1, sizeof(uint32_t));
+  ASSERT_TRUE(q != NULL);
+
+  uint32_t val;
+  double start = now_seconds();
+  EXPECT_FALSE(PIOS_Queue_Receive(q, &val, 30));
+  double elapsed = now_seconds() - start;
+
+  EXPECT_LE(0.029, elapsed);
+  EXPECT_GT(0.5, elapsed);
+
+  /* And a full queue makes a sender wait */
+  EXPECT_TRUE(PIOS_Queue_Send(q, &val, 0));
+  start = now_seconds();
+  EXPECT_FALSE(PIOS_Queue_Send(q, &val, 30));
+  elapsed = now_seconds() - start;
+
+  EXPECT_LE(0.029, elapsed);
+  EXPECT_GT(0.5, elapsed);
+
+  PIOS_Queue_Delete(q);
+}
+
+static void *send_later(void *arg)
+{
+  struct pios_queue *q = (struct pios_queue *) arg;
+  uint32_t val = 1234;
+
+  usleep(20000);
+  PIOS_Queue_Send(q, &val, PIOS_QUEUE_TIMEOUT_MAX);
+
+  return NULL;
+}
+
+TEST_F(QueueTest, BlockedReceiverIsWoken) {
+  struct pios_queue *q = PIOS_Queue_Create(1, sizeof(uint32_t));
+  ASSERT_TRUE(q != NULL);
+
+  pthread_t t = start_thread(send_later, q);
+
+  uint32_t val = 0;
+  EXPECT_TRUE(PIOS_Queue_Receive(q, &val, 1000));
+  EXPECT_EQ(1234u, val);
+
+  pthread_join(t, NULL);
+
+  PIOS_Queue_Delete(q);
+}
+
+struct producer_args {
+  struct pios_queue *q;
+  uint32_t id;
+  uint32_t count;
+};
+
+static void *produce(void *arg)
+{
+  struct producer_args *args = (struct producer_args *) arg;
+
+  for (uint32_t i = 0; i < args->count; i++) {
+    struct item it = { args->id, i, { 0, 0 } };
+
+    if (!PIOS_Queue_Send(args->q, &it, PIOS_QUEUE_TIMEOUT_MAX)) {
+      abort();
+    }
+  }
+
+  return NULL;
+}
+
+TEST_F(QueueTest, ManyProducers) {
+  const uint32_t producers = 4;
+  const uint32_t count = 50000;
+
+  struct pios_queue *q = PIOS_Queue_Create(5, sizeof(struct item));
+  ASSERT_TRUE(q != NULL);
+
+  struct producer_args args[producers];
+  pthread_t threads[producers];
+
+  for (uint32_t i = 0; i < producers; i++) {
+    args[i].q = q;
+    args[i].id = i;
+    args[i].count = count;
+    threads[i] = start_thread(produce, &args[i]);
+  }
+
+  uint32_t next[producers] = { 0 };
+
+  for (uint32_t i = 0; i < producers * count; i++) {
+    struct item it;
+    ASSERT_TRUE(PIOS_Queue_Receive(q, &it, 5000));
+    ASSERT_GT(producers, it.producer);
+
+    /* Each producer's items arrive in order */
+    ASSERT_EQ(next[it.producer], it.seq);
+    next[it.producer]++;
+  }
+
+  for (uint32_t i = 0; i < producers; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  struct item it;
+  EXPECT_FALSE(PIOS_Queue_Receive(q, &it, 0));
+
+  PIOS_Queue_Delete(q);
+}
+
+TEST_F(QueueTest, Semaphore) {
+  struct pios_semaphore *s = PIOS_Semaphore_Create();
+  ASSERT_TRUE(s != NULL);
+
+  /* Created given */
+  EXPECT_TRUE(PIOS_Semaphore_Take(s, 0));
+  EXPECT_FALSE(PIOS_Semaphore_Take(s, 0));
+
+  double start = now_seconds();
+  EXPECT_FALSE(PIOS_Semaphore_Take(s, 30));
+  EXPECT_LE(0.029, now_seconds() - start);
+
+  EXPECT_TRUE(PIOS_Semaphore_Give(s));
+  EXPECT_FALSE(PIOS_Semaphore_Give(s));
+  EXPECT_TRUE(PIOS_Semaphore_Take(s, 0));
+}
+
+struct pingpong_args {
+  struct pios_queue *ping;
+  struct pios_queue *pong;
+  uint32_t count;
+};
+
+static void *echo(void *arg)
+{
+  struct pingpong_args *args = (struct pingpong_args *) arg;
+  struct item it;
+
+  for (uint32_t i = 0; i < args->count; i++) {
+    PIOS_Queue_Receive(args->ping, &it, PIOS_QUEUE_TIMEOUT_MAX);
+    PIOS_Queue_Send(args->pong, &it, PIOS_QUEUE_TIMEOUT_MAX);
+  }
+
+  return NULL;
+}
+
+TEST_F(QueueTest, BenchmarkThroughput) {
+  const uint32_t count = 500000;
+
+  /* One producer streaming through a short queue, as the event system does */
+  struct pios_queue *q = PIOS_Queue_Create(16, sizeof(struct item));
+  ASSERT_TRUE(q != NULL);
+
+  struct producer_args args = { q, 0, count };
+
+  double start = now_seconds();
+  pthread_t t = start_thread(produce, &args);
+
+  for (uint32_t i = 0; i < count; i++) {
+    struct item it;
+    ASSERT_TRUE(PIOS_Queue_Receive(q, &it, PIOS_QUEUE_TIMEOUT_MAX));
+  }
+
+  double elapsed = now_seconds() - start;
+  pthread_join(t, NULL);
+
+  printf("%-36s %7.2f M items/s\n", "Queue, one producer:",
+      count / elapsed / 1e6);
+
+  /* Round trips between two threads, each blocking in turn */
+  const uint32_t trips = 20000;
+
+  struct pios_queue *pong = PIOS_Queue_Create(1, sizeof(struct item));
+  ASSERT_TRUE(pong != NULL);
+
+  struct pingpong_args pp = { q, pong, trips };
+
+  start = now_seconds();
+  t = start_thread(echo, &pp);
+
+  for (uint32_t i = 0; i < trips; i++) {
+    struct item it = { 0, i, { 0, 0 } };
+
+    PIOS_Queue_Send(q, &it, PIOS_QUEUE_TIMEOUT_MAX);
+    ASSERT_TRUE(PIOS_Queue_Receive(pong, &it, PIOS_QUEUE_TIMEOUT_MAX));
+    ASSERT_EQ(i, it.seq);
+  }
+
+  elapsed = now_seconds() - start;
+  pthread_join(t, NULL);
+
+  printf("%-36s %7.2f us/round trip\n", "Queue, ping-pong:",
+      elapsed * 1e6 / trips);
+
+  PIOS_Queue_Delete(pong);
+  PIOS_Queue_Delete(q);
+}
+
+static void *receive_with_timeout(void *arg)
+{
+  struct pios_queue *q = (struct pios_queue *) arg;
+  uint32_t val;
+
+  return (void *) (uintptr_t) PIOS_Queue_Receive(q, &val, 5);
+}
+
+/* Once started the fake clock stays in charge, so this runs last */
+TEST_F(QueueTest, TimeoutFollowsFakeClock) {
+  struct pios_queue *q = PIOS_Queue_Create(1, sizeof(uint32_t));
+  ASSERT_TRUE(q != NULL);
+
+  PIOS_Thread_FakeClock_Tick();
+  ASSERT_TRUE(PIOS_Thread_FakeClock_IsActive());
+
+  pthread_t t = start_thread(receive_with_timeout, q);
+
+  /* Real time passing doesn't end the wait... */
+  usleep(50000);
+
+  void *ret;
+  EXPECT_NE(0, pthread_tryjoin_np(t, &ret));
+
+  /* ...but the virtual clock passing the deadline does */
+  for (int i = 0; i < 6; i++) {
+    PIOS_Thread_FakeClock_Tick();
+    usleep(1000);
+  }
+
+  pthread_join(t, &ret);
+  EXPECT_EQ(0u, (uintptr_t) ret);
+
+  PIOS_Queue_Delete(q);
+}
+
+/* Like the test above, leaves the fake clock running */
+TEST_F(QueueTest, DelayFollowsFakeClock) {
+  PIOS_Thread_FakeClock_Tick();
+  ASSERT_TRUE(PIOS_Thread_FakeClock_IsActive());
+
+  uint32_t start = PIOS_DELAY_GetRaw();
+
+  /* Stands still in real time... */
+  usleep(5000);
+  EXPECT_EQ(0u, PIOS_DELAY_DiffuS(start));
+
+  /* ...and moves a millisecond per tick */
+  for (int i = 0; i < 3; i++) {
+    PIOS_Thread_FakeClock_Tick();
+  }
+
+  EXPECT_EQ(3000u, PIOS_DELAY_DiffuS(start));
+  EXPECT_EQ(3000u, PIOS_DELAY_GetuSSince(PIOS_DELAY_GetuS() - 3000));
+}
+
+/**
+ * @}
+ * @}
+ */
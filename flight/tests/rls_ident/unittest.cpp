@@ -0,0 +1,583 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test of the on-board autotune identification
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* getenv */
+#include <string.h>		/* memcpy */
+#include <math.h>		/* expf */
+#include <time.h>		/* clock_gettime */
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ffft/FFTReal.h"
+
+extern "C" {
+#include "rls_ident.h"
+}
+
+/* As the Autotune module and the wizard lay out the autotune partition */
+#define ATFLASH_MAGIC 0x656e755480008041ULL
+
+struct at_flash_header {
+  uint64_t magic;
+  uint16_t wiggle_points;
+  uint16_t aux_data_len;
+  uint16_t sample_rate;
+  uint16_t resv;
+};
+
+struct at_measurement {
+  float y[3];
+  float u[3];
+};
+
+/* As the Autotune module sets it up, remembering about 5s */
+static float ident_lambda(int rate)
+{
+  return 1.0f - 1.0f / (rate * 5.0f);
+}
+
+static double now_seconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct axis_model {
+  double tau;		/* Actuator lag, s */
+  double beta;		/* ln(deg/s^2 per unit) */
+  double delay;		/* Dead time before the lag, s */
+  double bias;		/* deg/s^2 */
+};
+
+/* A multirotor in the autotune flight mode: each axis held by a rate P loop
+ * while the stabilization module's square wiggles are added on top */
+class Flight {
+public:
+  Flight(const axis_model model[3], int rate, double noise) :
+    rate(rate), gen(1234), noise(0, noise) {
+    for (int i = 0; i < 3; i++) {
+      this->model[i] = model[i];
+      w[i] = a[i] = u[i] = 0;
+      delayed[i].assign((int) (model[i].delay * rate + 0.5), 0);
+    }
+
+    /* Wiggle cycles of 512ms at 500Hz, as stabilization picks */
+    shift = rate >= 1000 ? 6 : 5;
+    wiggle_points = 1 << (shift + 3);
+    iteration = 0;
+  }
+
+  /* Step one sample; returns the gyro measurement and the actuator
+   * command worked out from it, as ActuatorDesired reports them */
+  void step(float gyro[3], float actuator[3], uint16_t *cycle) {
+    const double dt = 1.0 / rate;
+    const int substeps = 10;
+
+    for (int i = 0; i < 3; i++) {
+      /* Apply the last command, after the dead time */
+      delayed[i].push_back(u[i]);
+      double cmd = delayed[i].front();
+      delayed[i].erase(delayed[i].begin());
+
+      double g = exp(model[i].beta);
+
+      for (int s = 0; s < substeps; s++) {
+        double h = dt / substeps;
+        a[i] += (cmd - a[i]) * h / model[i].tau;
+        w[i] += (g * a[i] + model[i].bias) * h;
+      }
+
+      gyro[i] = w[i] + noise(gen);
+    }
+
+    static const float kp[3] = { 0.002f, 0.002f, 0.008f };
+    static const float effort[3] = { 0.065f, 0.065f, 0.09f };
+    static const int wiggle_axis[8] = { 2, 0, 2, 0, 2, 1, 2, 1 };
+    static const float wiggle_sign[8] = { 1, 1, -1, -1, 1, 1, -1, -1 };
+
+    int phase = (iteration >> shift) & 7;
+
+    for (int i = 0; i < 3; i++) {
+      u[i] = -kp[i] * gyro[i];
+
+      if (wiggle_axis[phase] == i) {
+        u[i] += wiggle_sign[phase] * effort[i];
+      }
+
+      actuator[i] = u[i];
+    }
+
+    *cycle = iteration & (wiggle_points - 1);
+    iteration++;
+  }
+
+  int rate;
+  int shift;
+  int wiggle_points;
+
+private:
+  axis_model model[3];
+  double w[3], a[3], u[3];
+  std::vector<double> delayed[3];
+  uint32_t iteration;
+  std::mt19937 gen;
+  std::normal_distribution<double> noise;
+};
+
+/* Flies the autotune for the given time, identifying on the way like the
+ * module does, and recording the partition it would save */
+static std::vector<uint8_t> fly(Flight &flight, double seconds,
+    struct rls_ident ident[3])
+{
+  std::vector<at_measurement> avg(flight.wiggle_points);
+  int samples = seconds * flight.rate;
+
+  for (int i = 0; i < 3; i++) {
+    rls_ident_init(&ident[i], 1.0f / flight.rate, ident_lambda(flight.rate));
+  }
+
+  for (int k = 0; k < samples; k++) {
+    float gyro[3], act[3];
+    uint16_t cycle;
+
+    flight.step(gyro, act, &cycle);
+
+    for (int i = 0; i < 3; i++) {
+      rls_ident_update(&ident[i], gyro[i], act[i]);
+      avg[cycle].y[i] += gyro[i];
+      avg[cycle].u[i] += act[i];
+    }
+  }
+
+  at_flash_header hdr = { ATFLASH_MAGIC, (uint16_t) flight.wiggle_points, 0,
+    (uint16_t) flight.rate, 0 };
+
+  std::vector<uint8_t> part(sizeof(hdr) + avg.size() * sizeof(avg[0]));
+  memcpy(part.data(), &hdr, sizeof(hdr));
+  memcpy(part.data() + sizeof(hdr), avg.data(), avg.size() * sizeof(avg[0]));
+
+  return part;
+}
+
+/* The autotune wizard's identification, from configautotunewidget.cpp */
+static void wizard_biquad(float cutoff, int pts, std::vector<float> &data)
+{
+  float f = 1.0f / tan(M_PI * cutoff);
+  float q = 1.4142f;
+
+  float y2 = 0, y1 = 0, x2 = 0, x1 = 0;
+
+  float b0 = 1.0f / (1.0f + q * f + f * f);
+  float a1 = 2.0f * (f * f - 1.0f) * b0;
+  float a2 = -(1.0f - q * f + f * f) * b0;
+
+  for (int i = 0; i < pts; i++) {
+    float y = b0 * (data[i] + 2.0f * x1 + x2) + a1 * y1 + a2 * y2;
+
+    y2 = y1;
+    y1 = y;
+
+    x2 = x1;
+    x1 = data[i];
+  }
+
+  for (int i = 0; i < pts; i++) {
+    float y = b0 * (data[i] + 2.0f * x1 + x2) + a1 * y1 + a2 * y2;
+
+    y2 = y1;
+    y1 = y;
+
+    x2 = x1;
+    x1 = data[i];
+
+    data[i] = y;
+  }
+}
+
+static float wizard_sample_delay(int pts, const std::vector<float> &delayed,
+    const std::vector<float> &orig, int seriesCutoff)
+{
+  ffft::FFTReal<float> fft(pts);
+
+  std::vector<float> delayed_fft(pts);
+  fft.do_fft(delayed_fft.data(), delayed.data());
+
+  std::vector<float> orig_fft(pts);
+  fft.do_fft(orig_fft.data(), orig.data());
+
+  std::vector<float> product(pts);
+
+  int fpts = pts / 2;
+
+  for (int i = 0; i < fpts; i++) {
+    float x = delayed_fft[i];
+    float y = delayed_fft[i + fpts];
+    float u = orig_fft[i];
+    float v = orig_fft[i + fpts];
+
+    product[i] = -(u * x) - (v * y);
+    product[i + fpts] = (v * x) - (u * y);
+  }
+
+  std::vector<float> prod_time(pts);
+  fft.do_ifft(product.data(), prod_time.data());
+
+  int max_idx = 0;
+  float max_val = 0;
+
+  for (int i = 0; i < fpts / seriesCutoff; i++) {
+    float real = prod_time[i];
+    float imag = prod_time[i + fpts];
+    float mag = sqrt(real * real + imag * imag);
+
+    if (mag > max_val) {
+      max_val = mag;
+      max_idx = i;
+    }
+  }
+
+  return max_idx;
+}
+
+static bool wizard_identify(const std::vector<uint8_t> &part, float tau[3],
+    float beta[3])
+{
+  at_flash_header hdr;
+
+  if (part.size() < sizeof(hdr)) {
+    return false;
+  }
+
+  memcpy(&hdr, part.data(), sizeof(hdr));
+
+  if (hdr.magic != ATFLASH_MAGIC ||
+      part.size() < sizeof(hdr) + hdr.wiggle_points * sizeof(at_measurement)) {
+    return false;
+  }
+
+  const at_measurement *data = (const at_measurement *) (part.data() + sizeof(hdr));
+  int pts = hdr.wiggle_points;
+
+  for (int axis = 0; axis < 3; axis++) {
+    std::vector<float> gyro_deriv(pts);
+    std::vector<float> actu_desired(pts);
+
+    for (int i = 0; i < pts; i++) {
+      actu_desired[i] = data[i].u[axis];
+    }
+
+    for (int i = 1; i < pts; i++) {
+      gyro_deriv[i] = data[i].y[axis] - data[i - 1].y[axis];
+    }
+
+    gyro_deriv[0] = data[0].y[axis] - data[pts - 1].y[axis];
+
+    float sample_tau = wizard_sample_delay(pts, gyro_deriv, actu_desired,
+        (axis == 2) ? 8 : 4);
+
+    tau[axis] = sample_tau / hdr.sample_rate;
+
+    wizard_biquad(1 / (sample_tau * M_PI * 1.414), pts, actu_desired);
+
+    std::vector<float> gyro_sorted = gyro_deriv;
+    std::vector<float> actu_sorted = actu_desired;
+
+    std::sort(gyro_sorted.begin(), gyro_sorted.end());
+    std::sort(actu_sorted.begin(), actu_sorted.end());
+
+    int low_idx = pts * 0.05 + 0.5;
+    int high_idx = pts - 1 - low_idx;
+
+    float gyro_span = gyro_sorted[high_idx] - gyro_sorted[low_idx];
+    float actu_span = actu_sorted[high_idx] - actu_sorted[low_idx];
+
+    beta[axis] = log(gyro_span / actu_span * hdr.sample_rate);
+  }
+
+  return true;
+}
+
+/* Runs the identifier over a partition's averaged wiggle cycle, repeated
+ * to make up the length of an autotune flight */
+static bool replay_identify(const std::vector<uint8_t> &part,
+    struct rls_ident_estimate est[3])
+{
+  at_flash_header hdr;
+  memcpy(&hdr, part.data(), sizeof(hdr));
+
+  const at_measurement *data = (const at_measurement *) (part.data() + sizeof(hdr));
+  int cycles = 60 * hdr.sample_rate / hdr.wiggle_points;
+
+  for (int axis = 0; axis < 3; axis++) {
+    struct rls_ident ident;
+    rls_ident_init(&ident, 1.0f / hdr.sample_rate,
+        ident_lambda(hdr.sample_rate));
+
+    for (int c = 0; c < cycles; c++) {
+      for (int i = 0; i < hdr.wiggle_points; i++) {
+        rls_ident_update(&ident, data[i].y[axis], data[i].u[axis]);
+      }
+    }
+
+    if (!rls_ident_estimate(&ident, &est[axis])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class RlsIdentTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+  }
+
+  virtual void TearDown() {
+  }
+};
+
+TEST_F(RlsIdentTest, ConvergesToModel) {
+  const axis_model model[3] = {
+    { 0.020, 10.0, 0, 20 },
+    { 0.028, 10.3, 0, -50 },
+    { 0.045, 8.0, 0, 0 },
+  };
+
+  Flight flight(model, 500, 1.0);
+  struct rls_ident ident[3];
+  fly(flight, 60, ident);
+
+  for (int i = 0; i < 3; i++) {
+    struct rls_ident_estimate est;
+    ASSERT_TRUE(rls_ident_estimate(&ident[i], &est));
+
+    printf("Axis %d: tau %.4f +- %.4f (%.4f), beta %.3f +- %.3f (%.3f)\n",
+        i, est.tau, est.tau_bound, model[i].tau, est.beta, est.beta_bound,
+        model[i].beta);
+
+    EXPECT_NEAR(model[i].tau, est.tau, model[i].tau * 0.1);
+    EXPECT_NEAR(model[i].beta, est.beta, 0.1);
+
+    /* The bounds are meaningful: small, but not vanishingly */
+    EXPECT_LT(0, est.tau_bound);
+    EXPECT_GT(model[i].tau * 0.2, est.tau_bound);
+    EXPECT_LT(0, est.beta_bound);
+    EXPECT_GT(0.2, est.beta_bound);
+  }
+}
+
+TEST_F(RlsIdentTest, ConvergesWithinFlight) {
+  const axis_model model[3] = {
+    { 0.020, 10.0, 0, 0 },
+    { 0.020, 10.0, 0, 0 },
+    { 0.040, 8.5, 0, 0 },
+  };
+
+  Flight flight(model, 1000, 2.0);
+  struct rls_ident ident[3];
+
+  /* A few wiggle cycles on each axis is enough to be close */
+  fly(flight, 5, ident);
+
+  for (int i = 0; i < 3; i++) {
+    struct rls_ident_estimate est;
+    ASSERT_TRUE(rls_ident_estimate(&ident[i], &est));
+
+    EXPECT_NEAR(model[i].tau, est.tau, model[i].tau * 0.2);
+    EXPECT_NEAR(model[i].beta, est.beta, 0.2);
+  }
+}
+
+TEST_F(RlsIdentTest, NoExcitationGivesNoModel) {
+  struct rls_ident ident;
+  struct rls_ident_estimate est;
+
+  rls_ident_init(&ident, 0.002f, ident_lambda(500));
+  EXPECT_FALSE(rls_ident_estimate(&ident, &est));
+
+  /* Sitting still doesn't wind the covariance up without bound */
+  for (int i = 0; i < 100000; i++) {
+    rls_ident_update(&ident, 0, 0);
+  }
+
+  EXPECT_GT(2e4f, ident.P[0][0] + ident.P[1][1] + ident.P[2][2]);
+}
+
+TEST_F(RlsIdentTest, UpdateBeforeInitIsDropped) {
+  struct rls_ident ident;
+  struct rls_ident_estimate est;
+
+  /* As autotune allocates it, before the first wiggle cycle starts */
+  memset(&ident, 0, sizeof(ident));
+
+  for (int i = 0; i < 1000; i++) {
+    rls_ident_update(&ident, sinf(i * 0.1f), cosf(i * 0.1f));
+  }
+
+  EXPECT_EQ(0u, ident.samples);
+  EXPECT_EQ(0.0f, ident.P[0][0]);
+  EXPECT_FALSE(rls_ident_estimate(&ident, &est));
+}
+
+/* Compares with the wizard on recorded partitions, named in
+ * AUTOTUNE_PARTITIONS separated by colons, or on simulated flights with a
+ * little dead time on top of the lag.  The on-board figures are a first
+ * order fit, where the wizard's tau is the delay to the peak correlation;
+ * long dead times push them apart, so recorded flights are only shown. */
+TEST_F(RlsIdentTest, MatchesWizard) {
+  std::vector<std::vector<uint8_t> > parts;
+  std::vector<std::string> names;
+  bool simulated = false;
+
+  const char *env = getenv("AUTOTUNE_PARTITIONS");
+
+  if (env && *env) {
+    std::string list(env);
+    size_t pos = 0;
+
+    while (pos <= list.size()) {
+      size_t end = list.find(':', pos);
+      if (end == std::string::npos) {
+        end = list.size();
+      }
+
+      std::string name = list.substr(pos, end - pos);
+      FILE *f = fopen(name.c_str(), "rb");
+      ASSERT_TRUE(f != NULL) << name;
+
+      std::vector<uint8_t> part;
+      uint8_t buf[4096];
+      size_t n;
+
+      while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        part.insert(part.end(), buf, buf + n);
+      }
+
+      fclose(f);
+
+      parts.push_back(part);
+      names.push_back(name);
+      pos = end + 1;
+    }
+  } else {
+    simulated = true;
+
+    const double delays[] = { 0, 0.002, 0.006 };
+
+    for (double delay : delays) {
+      const axis_model model[3] = {
+        { 0.015, 10.0, delay, 0 },
+        { 0.015, 10.2, delay, 0 },
+        { 0.030, 8.5, delay, 0 },
+      };
+
+      Flight flight(model, 500, 1.0);
+      struct rls_ident ident[3];
+      parts.push_back(fly(flight, 60, ident));
+      names.push_back("simulated, " + std::to_string((int) (delay * 1000)) +
+          "ms dead time");
+    }
+  }
+
+  for (size_t p = 0; p < parts.size(); p++) {
+    float tau[3], beta[3];
+    struct rls_ident_estimate est[3];
+
+    ASSERT_TRUE(wizard_identify(parts[p], tau, beta)) << names[p];
+    ASSERT_TRUE(replay_identify(parts[p], est)) << names[p];
+
+    printf("%s\n", names[p].c_str());
+
+    for (int i = 0; i < 3; i++) {
+      printf("  Axis %d: wizard tau %.4f beta %.3f, on-board tau %.4f +- %.4f beta %.3f +- %.3f\n",
+          i, tau[i], beta[i], est[i].tau, est[i].tau_bound,
+          est[i].beta, est[i].beta_bound);
+
+      /* Roll and pitch are what the tune is worked out from */
+      if (simulated && i < 2) {
+        EXPECT_NEAR(tau[i], est[i].tau, 0.35 * tau[i]);
+        EXPECT_NEAR(beta[i], est[i].beta, 0.35);
+      }
+    }
+  }
+}
+
+TEST_F(RlsIdentTest, Benchmark) {
+  const int samples = 1000000;
+  std::vector<float> gyro(samples), act(samples);
+
+  for (int i = 0; i < samples; i++) {
+    gyro[i] = sinf(i * 0.01f) * 100;
+    act[i] = cosf(i * 0.013f) * 0.1f;
+  }
+
+  struct rls_ident ident;
+  rls_ident_init(&ident, 0.002f, ident_lambda(500));
+
+  double start = now_seconds();
+
+  for (int i = 0; i < samples; i++) {
+    rls_ident_update(&ident, gyro[i], act[i]);
+  }
+
+  double elapsed = now_seconds() - start;
+
+  struct rls_ident_estimate est;
+  int reps = 100000;
+  start = now_seconds();
+
+  for (int i = 0; i < reps; i++) {
+    ident.theta[1] += 1e-9f;
+    rls_ident_estimate(&ident, &est);
+  }
+
+  double estimate = now_seconds() - start;
+
+  printf("%-36s %7.1f ns/sample\n", "RLS update, one axis:",
+      elapsed * 1e9 / samples);
+  printf("%-36s %7.1f ns\n", "Estimate with bounds:",
+      estimate * 1e9 / reps);
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,296 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test of the TLSF heap allocator
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdint.h>		/* uintptr_t */
+#include <stdlib.h>		/* rand */
+#include <string.h>		/* memset */
+
+#include <vector>
+
+extern "C" {
+#include "pios_tlsf.h"
+}
+
+#define ARENA_BYTES (256U * 1024)
+
+// To use a test fixture, derive a class from testing::Test.
+class TlsfTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    arena.assign(ARENA_BYTES / sizeof(uintptr_t), 0);
+    tlsf = PIOS_TLSF_Create(arena.data(), ARENA_BYTES);
+    ASSERT_TRUE(tlsf != NULL);
+
+    PIOS_TLSF_GetStats(tlsf, &initial);
+  }
+
+  struct pios_tlsf_stats stats() {
+    struct pios_tlsf_stats s;
+    PIOS_TLSF_GetStats(tlsf, &s);
+    return s;
+  }
+
+  std::vector<uintptr_t> arena;
+  struct pios_tlsf *tlsf;
+  struct pios_tlsf_stats initial;
+};
+
+TEST_F(TlsfTest, StartsAsOneFreeBlock) {
+  EXPECT_EQ(1U, initial.free_blocks);
+  EXPECT_EQ(0U, initial.used_blocks);
+  EXPECT_EQ(initial.total_bytes, initial.free_bytes);
+  EXPECT_EQ(initial.free_bytes, initial.largest_free);
+  EXPECT_EQ(initial.free_bytes, initial.min_free_bytes);
+
+  /* The bookkeeping shouldn't eat much of the arena */
+  EXPECT_GT(initial.total_bytes, ARENA_BYTES - 2048);
+
+  EXPECT_TRUE(PIOS_TLSF_Check(tlsf));
+}
+
+TEST_F(TlsfTest, RefusesTinyMemory) {
+  uintptr_t small[4];
+
+  EXPECT_TRUE(PIOS_TLSF_Create(small, sizeof(small)) == NULL);
+}
+
+TEST_F(TlsfTest, WordAligned) {
+  for (size_t size = 0; size < 100; size++) {
+    void *p = PIOS_TLSF_Malloc(tlsf, size);
+
+    ASSERT_TRUE(p != NULL);
+    EXPECT_EQ(0U, (uintptr_t) p % sizeof(uintptr_t));
+  }
+
+  EXPECT_TRUE(PIOS_TLSF_Check(tlsf));
+}
+
+TEST_F(TlsfTest, FreeingEverythingMergesBack) {
+  std::vector<void *> ptrs;
+
+  for (int i = 0; i < 200; i++) {
+    void *p = PIOS_TLSF_Malloc(tlsf, 1 + (i * 37) % 500);
+    ASSERT_TRUE(p != NULL);
+    ptrs.push_back(p);
+  }
+
+  EXPECT_EQ(200U, stats().used_blocks);
+  EXPECT_LT(stats().free_bytes, initial.free_bytes);
+
+  /* Every other one first, so the rest have to merge both ways */
+  for (size_t i = 0; i < ptrs.size(); i += 2) {
+    PIOS_TLSF_Free(tlsf, ptrs[i]);
+  }
+
+  EXPECT_TRUE(PIOS_TLSF_Check(tlsf));
+
+  for (size_t i = 1; i < ptrs.size(); i += 2) {
+    PIOS_TLSF_Free(tlsf, ptrs[i]);
+  }
+
+  EXPECT_TRUE(PIOS_TLSF_Check(tlsf));
+
+  struct pios_tlsf_stats after = stats();
+
+  EXPECT_EQ(1U, after.free_blocks);
+  EXPECT_EQ(0U, after.used_blocks);
+  EXPECT_EQ(initial.free_bytes, after.free_bytes);
+  EXPECT_EQ(initial.largest_free, after.largest_free);
+}
+
+TEST_F(TlsfTest, ReusesFreedMemory) {
+  /* A bump allocator would run out long before this */
+  for (int i = 0; i < 10000; i++) {
+    void *p = PIOS_TLSF_Malloc(tlsf, 4096);
+    ASSERT_TRUE(p != NULL);
+    PIOS_TLSF_Free(tlsf, p);
+  }
+
+  EXPECT_EQ(initial.free_bytes, stats().free_bytes);
+}
+
+TEST_F(TlsfTest, FailsCleanlyWhenFull) {
+  std::vector<void *> ptrs;
+  void *p;
+
+  while ((p = PIOS_TLSF_Malloc(tlsf, 1000)) != NULL) {
+    ptrs.push_back(p);
+  }
+
+  EXPECT_GT(ptrs.size(), ARENA_BYTES / 1000 - 10);
+  EXPECT_LT(stats().largest_free, 1000U);
+  EXPECT_TRUE(PIOS_TLSF_Malloc(tlsf, ARENA_BYTES) == NULL);
+  EXPECT_TRUE(PIOS_TLSF_Check(tlsf));
+
+  PIOS_TLSF_Free(tlsf, ptrs.back());
+  ptrs.pop_back();
+
+  EXPECT_TRUE(PIOS_TLSF_Malloc(tlsf, 1000) != NULL);
+}
+
+TEST_F(TlsfTest, TracksLowWater) {
+  void *big = PIOS_TLSF_Malloc(tlsf, 100000);
+  ASSERT_TRUE(big != NULL);
+
+  size_t low = stats().free_bytes;
+
+  PIOS_TLSF_Free(tlsf, big);
+
+  EXPECT_EQ(initial.free_bytes, stats().free_bytes);
+  EXPECT_EQ(low, stats().min_free_bytes);
+}
+
+TEST_F(TlsfTest, ReportsFragmentation) {
+  std::vector<void *> ptrs;
+  void *p;
+
+  while ((p = PIOS_TLSF_Malloc(tlsf, 2000)) != NULL) {
+    ptrs.push_back(p);
+  }
+
+  /* Free every other block; plenty is free, but only in small pieces */
+  for (size_t i = 0; i < ptrs.size(); i += 2) {
+    PIOS_TLSF_Free(tlsf, ptrs[i]);
+  }
+
+  struct pios_tlsf_stats s = stats();
+
+  EXPECT_GT(s.free_bytes, ARENA_BYTES / 3);
+  EXPECT_LT(s.largest_free, 4000U);
+  EXPECT_TRUE(PIOS_TLSF_Malloc(tlsf, 4000) == NULL);
+  EXPECT_TRUE(PIOS_TLSF_Malloc(tlsf, 2000) != NULL);
+}
+
+TEST_F(TlsfTest, IgnoresDoubleFreeAndNull) {
+  void *p = PIOS_TLSF_Malloc(tlsf, 64);
+
+  PIOS_TLSF_Free(tlsf, p);
+  PIOS_TLSF_Free(tlsf, p);
+  PIOS_TLSF_Free(tlsf, NULL);
+
+  EXPECT_TRUE(PIOS_TLSF_Check(tlsf));
+  EXPECT_EQ(initial.free_bytes, stats().free_bytes);
+}
+
+TEST_F(TlsfTest, AddsPools) {
+  std::vector<uintptr_t> more(ARENA_BYTES / sizeof(uintptr_t));
+
+  ASSERT_TRUE(PIOS_TLSF_AddPool(tlsf, more.data(), ARENA_BYTES));
+
+  struct pios_tlsf_stats s = stats();
+
+  EXPECT_EQ(2U, s.free_blocks);
+  EXPECT_GT(s.total_bytes, 2 * (ARENA_BYTES - 2048));
+
+  /* Enough that it can only come from both pools together */
+  std::vector<void *> ptrs;
+
+  for (int i = 0; i < 400; i++) {
+    void *p = PIOS_TLSF_Malloc(tlsf, 1000);
+    ASSERT_TRUE(p != NULL);
+    ptrs.push_back(p);
+  }
+
+  EXPECT_TRUE(PIOS_TLSF_Check(tlsf));
+
+  for (void *p : ptrs) {
+    PIOS_TLSF_Free(tlsf, p);
+  }
+
+  EXPECT_EQ(s.free_bytes, stats().free_bytes);
+  EXPECT_TRUE(PIOS_TLSF_Check(tlsf));
+}
+
+/*
+ * Random mallocs and frees, each allocation filled with its own pattern, so
+ * that overlapping blocks or list corruption show up.
+ */
+TEST_F(TlsfTest, RandomWorkload) {
+  struct allocation {
+    uint8_t *p;
+    size_t size;
+    uint8_t fill;
+  };
+
+  std::vector<struct allocation> live;
+
+  srand(1234);
+
+  for (int i = 0; i < 200000; i++) {
+    if (live.empty() || rand() % 100 < 55) {
+      size_t size = (rand() % 8) ? rand() % 128 : rand() % 8192;
+      uint8_t *p = (uint8_t *) PIOS_TLSF_Malloc(tlsf, size);
+
+      if (p == NULL) {
+        /* Only allowed to fail when nothing a size class up is free */
+        ASSERT_LT(stats().largest_free, size + size / 4 + 64);
+        continue;
+      }
+
+      struct allocation a = { p, size, (uint8_t) rand() };
+      memset(p, a.fill, size);
+      live.push_back(a);
+    } else {
+      size_t idx = rand() % live.size();
+      struct allocation a = live[idx];
+
+      for (size_t j = 0; j < a.size; j++) {
+        ASSERT_EQ(a.fill, a.p[j]);
+      }
+
+      PIOS_TLSF_Free(tlsf, a.p);
+
+      live[idx] = live.back();
+      live.pop_back();
+    }
+
+    if (i % 5000 == 0) {
+      ASSERT_TRUE(PIOS_TLSF_Check(tlsf));
+      ASSERT_EQ(live.size(), stats().used_blocks);
+    }
+  }
+
+  for (const struct allocation &a : live) {
+    PIOS_TLSF_Free(tlsf, a.p);
+  }
+
+  EXPECT_TRUE(PIOS_TLSF_Check(tlsf));
+  EXPECT_EQ(1U, stats().free_blocks);
+  EXPECT_EQ(initial.free_bytes, stats().free_bytes);
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,10 @@
+/* Stand-in for PiOS/openpilot.h: UAVTalk only needs PiOS and the object
+ * manager, whose objects are faked in unittest_init.c */
+#ifndef OPENPILOT_H
+#define OPENPILOT_H
+
+#include <pios.h>
+
+#include "uavobjectmanager.h"
+
+#endif /* OPENPILOT_H */
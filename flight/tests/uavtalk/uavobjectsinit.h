@@ -0,0 +1,7 @@
+/* Stand-in for the generated uavobjectsinit.h */
+#ifndef UAVOBJECTSINIT_H
+#define UAVOBJECTSINIT_H
+
+#define UAVOBJECTS_LARGEST 300
+
+#endif /* UAVOBJECTSINIT_H */
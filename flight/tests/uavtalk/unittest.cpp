@@ -0,0 +1,315 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+
+#include <vector>
+
+extern "C" {
+#include "openpilot.h"
+#include "uavtalk.h"
+#include "uavtalk_priv.h"
+#include "pios_crc.h"
+
+#include "unittest_uavobjects.h"
+}
+
+typedef std::vector<uint8_t> bytes;
+
+static int32_t collect_output(void *ctx, uint8_t *data, int32_t length)
+{
+  bytes *out = (bytes *) ctx;
+
+  out->insert(out->end(), data, data + length);
+
+  return length;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class UAVTalkTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    fake_objs_init();
+    srand(1);
+  }
+
+  virtual void TearDown() {
+  }
+
+  // Append one object packet for fake object i
+  void add_packet(bytes &stream, int i, uint16_t inst, uint8_t type = UAVTALK_TYPE_OBJ) {
+    size_t start = stream.size();
+    uint32_t id = fake_obj_id(i);
+    uint16_t len = fake_obj_size(i);
+    uint16_t size = 8 + (fake_obj_single(i) ? 0 : 2) + len;
+
+    stream.push_back(UAVTALK_SYNC_VAL);
+    stream.push_back(type);
+    stream.push_back(size & 0xff);
+    stream.push_back(size >> 8);
+    for (int b = 0; b < 4; b++)
+      stream.push_back(id >> (8 * b));
+    if (!fake_obj_single(i)) {
+      stream.push_back(inst & 0xff);
+      stream.push_back(inst >> 8);
+    }
+    for (int b = 0; b < len; b++)
+      stream.push_back(rand());
+
+    stream.push_back(PIOS_CRC_updateCRC(0, &stream[start], size));
+  }
+
+  // A telemetry-like stream of random objects, optionally damaged
+  bytes make_stream(int packets, bool damage) {
+    bytes stream;
+
+    for (int p = 0; p < packets; p++) {
+      size_t start = stream.size();
+
+      add_packet(stream, rand() % FAKE_OBJ_COUNT, rand() % 3);
+
+      if (damage) {
+        switch (rand() % 10) {
+        case 0:
+          // Flip a bit anywhere in the packet
+          stream[start + rand() % (stream.size() - start)] ^= 1 << (rand() % 8);
+          break;
+        case 1:
+          // Lose the end of the packet
+          stream.resize(stream.size() - 1 - rand() % 4);
+          break;
+        case 2:
+          // Line noise between packets, sometimes looking like a sync
+          for (int n = rand() % 20; n > 0; n--)
+            stream.push_back(rand() % 4 ? rand() : UAVTALK_SYNC_VAL);
+          break;
+        }
+      }
+    }
+
+    return stream;
+  }
+
+  UAVTalkConnection connect(bytes *out = NULL) {
+    UAVTalkConnection con = UAVTalkInitialize(out, collect_output, NULL, NULL, NULL);
+    EXPECT_TRUE(con != NULL);
+    return con;
+  }
+
+  // How packets were parsed before: a byte at a time
+  void receive_bytewise(UAVTalkConnection con, const bytes &stream, UAVTalkConnection relay = NULL) {
+    for (size_t i = 0; i < stream.size(); i++) {
+      if (UAVTalkProcessInputStreamQuiet(con, stream[i]) == UAVTALK_STATE_COMPLETE) {
+        if (relay)
+          UAVTalkRelayPacket(con, relay);
+        else
+          UAVTalkReceiveObject(con);
+      }
+    }
+  }
+
+  // In blocks of the given size, or random sizes if 0
+  void receive_blocks(UAVTalkConnection con, const bytes &stream, size_t block, UAVTalkConnection relay = NULL) {
+    for (size_t i = 0; i < stream.size(); ) {
+      size_t n = block ? block : 1 + rand() % 600;
+      n = std::min(n, stream.size() - i);
+
+      if (relay) {
+        const uint8_t *p = &stream[i];
+        size_t left = n;
+        while (left > 0) {
+          UAVTalkRxState state;
+          int32_t used = UAVTalkProcessInputBlock(con, p, left, &state);
+          ASSERT_GT(used, 0);
+          if (state == UAVTALK_STATE_COMPLETE)
+            UAVTalkRelayPacket(con, relay);
+          p += used;
+          left -= used;
+        }
+      } else {
+        UAVTalkProcessInputStream(con, &stream[i], n);
+      }
+
+      i += n;
+    }
+  }
+};
+
+TEST_F(UAVTalkTest, CrcMatchesBytewise) {
+  bytes data;
+  for (int i = 0; i < 1000; i++)
+    data.push_back(rand());
+
+  for (int len = 0; len < 40; len++) {
+    uint8_t crc = 0x5a;
+    for (int i = 0; i < len; i++)
+      crc = PIOS_CRC_updateByte(crc, data[i]);
+
+    EXPECT_EQ(crc, PIOS_CRC_updateCRC(0x5a, &data[0], len)) << "length " << len;
+  }
+
+  uint8_t crc = 0;
+  for (size_t i = 0; i < data.size(); i++)
+    crc = PIOS_CRC_updateByte(crc, data[i]);
+  EXPECT_EQ(crc, PIOS_CRC_updateCRC(0, &data[0], data.size()));
+}
+
+TEST_F(UAVTalkTest, WholeStream) {
+  bytes stream = make_stream(500, false);
+  UAVTalkConnection con = connect();
+
+  UAVTalkProcessInputStream(con, &stream[0], stream.size());
+
+  EXPECT_EQ(500u, fake_unpack_count);
+
+  UAVTalkStats stats;
+  UAVTalkGetStats(con, &stats);
+  EXPECT_EQ(stream.size(), stats.rxBytes);
+  EXPECT_EQ(500u, stats.rxObjects);
+  EXPECT_EQ(0u, stats.rxErrors);
+  EXPECT_EQ(0u, stats.rxCRC);
+}
+
+TEST_F(UAVTalkTest, MatchesBytewiseParser) {
+  for (int damage = 0; damage < 2; damage++) {
+    bytes stream = make_stream(2000, damage);
+
+    UAVTalkConnection ref = connect();
+    fake_objs_init();
+    receive_bytewise(ref, stream);
+    uint32_t ref_count = fake_unpack_count;
+    uint32_t ref_hash = fake_unpack_hash;
+
+    UAVTalkConnection con = connect();
+    fake_objs_init();
+    receive_blocks(con, stream, 0);
+
+    EXPECT_EQ(ref_count, fake_unpack_count);
+    EXPECT_EQ(ref_hash, fake_unpack_hash);
+
+    // Same errors noticed and same bytes counted
+    UAVTalkStats ref_stats, stats;
+    UAVTalkGetStats(ref, &ref_stats);
+    UAVTalkGetStats(con, &stats);
+    EXPECT_EQ(ref_stats.rxBytes, stats.rxBytes);
+    EXPECT_EQ(ref_stats.rxObjects, stats.rxObjects);
+    EXPECT_EQ(ref_stats.rxObjectBytes, stats.rxObjectBytes);
+    EXPECT_EQ(ref_stats.rxErrors, stats.rxErrors);
+    EXPECT_EQ(ref_stats.rxCRC, stats.rxCRC);
+
+    if (damage) {
+      EXPECT_LT(ref_count, 2000u);
+      EXPECT_GT(ref_stats.rxCRC, 0u);
+    } else {
+      EXPECT_EQ(2000u, ref_count);
+    }
+  }
+}
+
+TEST_F(UAVTalkTest, RelayIsTransparent) {
+  bytes stream = make_stream(1000, false);
+
+  // Parsed in place, or reassembled when split across blocks
+  for (size_t block = 0; block <= 64; block += 64) {
+    bytes relayed;
+    UAVTalkConnection in = connect();
+    UAVTalkConnection out = connect(&relayed);
+
+    receive_blocks(in, stream, block, out);
+
+    EXPECT_TRUE(stream == relayed) << "block size " << block;
+  }
+
+  bytes relayed;
+  UAVTalkConnection in = connect();
+  UAVTalkConnection out = connect(&relayed);
+
+  receive_bytewise(in, stream, out);
+
+  EXPECT_TRUE(stream == relayed);
+}
+
+static double now_seconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *what, double elapsed, size_t len, int packets)
+{
+  printf("%-36s %7.1f MB/s %7.1f ns/packet\n", what,
+      len / elapsed / 1e6, elapsed * 1e9 / packets);
+}
+
+TEST_F(UAVTalkTest, BenchmarkThroughput) {
+  const int packets = 20000;
+  bytes stream = make_stream(packets, false);
+  bytes relayed;
+  relayed.reserve(stream.size() * 4);
+
+  UAVTalkConnection con = connect();
+  UAVTalkConnection out = connect(&relayed);
+
+  double start = now_seconds();
+  for (size_t i = 0; i < stream.size(); i += 16)
+    UAVTalkProcessInputStream(con, &stream[i], std::min<size_t>(16, stream.size() - i));
+  report("Telemetry, 16 byte copies:", now_seconds() - start, stream.size(), packets);
+
+  start = now_seconds();
+  receive_bytewise(con, stream);
+  report("Telemetry, byte at a time:", now_seconds() - start, stream.size(), packets);
+
+  start = now_seconds();
+  receive_blocks(con, stream, 512);
+  report("Telemetry, 512 byte blocks in place:", now_seconds() - start, stream.size(), packets);
+
+  start = now_seconds();
+  receive_bytewise(con, stream, out);
+  report("Relay, byte at a time:", now_seconds() - start, stream.size(), packets);
+
+  start = now_seconds();
+  receive_blocks(con, stream, 512, out);
+  report("Relay, 512 byte blocks in place:", now_seconds() - start, stream.size(), packets);
+}
+
+/**
+ * @}
+ * @}
+ */
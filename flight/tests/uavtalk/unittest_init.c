@@ -0,0 +1,85 @@
+#include <string.h>
+
+#include "openpilot.h"
+#include "unittest_uavobjects.h"
+
+/* A handful of made up objects of various sizes, standing in for the
+ * object manager. Unpacking records what arrived rather than storing it. */
+struct UAVOBase {
+	uint32_t id;
+	uint16_t size;
+	bool single;
+};
+
+static struct UAVOBase fake_objs[FAKE_OBJ_COUNT];
+
+uint32_t fake_unpack_count;
+uint32_t fake_unpack_hash;
+
+void fake_objs_init(void)
+{
+	for (int i = 0; i < FAKE_OBJ_COUNT; i++) {
+		fake_objs[i].id = fake_obj_id(i);
+		fake_objs[i].size = fake_obj_size(i);
+		fake_objs[i].single = fake_obj_single(i);
+	}
+
+	fake_unpack_count = 0;
+	fake_unpack_hash = 0;
+}
+
+UAVObjHandle UAVObjGetByID(uint32_t id)
+{
+	for (int i = 0; i < FAKE_OBJ_COUNT; i++) {
+		if (fake_objs[i].id == id) {
+			return &fake_objs[i];
+		}
+	}
+
+	return NULL;
+}
+
+uint32_t UAVObjGetID(UAVObjHandle obj)
+{
+	return obj->id;
+}
+
+uint32_t UAVObjGetNumBytes(UAVObjHandle obj)
+{
+	return obj->size;
+}
+
+uint16_t UAVObjGetNumInstances(UAVObjHandle obj)
+{
+	return 1;
+}
+
+bool UAVObjIsSingleInstance(UAVObjHandle obj)
+{
+	return obj->single;
+}
+
+int32_t UAVObjUnpack(UAVObjHandle obj, uint16_t instId, const uint8_t *dataIn)
+{
+	uint32_t hash = fake_unpack_hash ^ obj->id ^ instId;
+
+	for (int i = 0; i < obj->size; i++) {
+		hash = hash * 31 + dataIn[i];
+	}
+
+	fake_unpack_hash = hash;
+	fake_unpack_count++;
+
+	return 0;
+}
+
+int32_t UAVObjPack(UAVObjHandle obj, uint16_t instId, uint8_t *dataOut)
+{
+	memset(dataOut, 0, obj->size);
+	return 0;
+}
+
+uint32_t PIOS_Thread_Systime(void)
+{
+	return 0;
+}
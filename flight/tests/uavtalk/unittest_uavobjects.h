@@ -0,0 +1,15 @@
+#ifndef UNITTEST_UAVOBJECTS_H
+#define UNITTEST_UAVOBJECTS_H
+
+#define FAKE_OBJ_COUNT 16
+
+#define fake_obj_id(i)     (0x1000 + 0x100 * (i))
+#define fake_obj_size(i)   (4 + ((i) * 37) % 250)
+#define fake_obj_single(i) ((i) % 4 != 3)
+
+extern uint32_t fake_unpack_count;
+extern uint32_t fake_unpack_hash;
+
+void fake_objs_init(void);
+
+#endif /* UNITTEST_UAVOBJECTS_H */
@@ -0,0 +1,23 @@
+include(../../gcs.pri)
+
+QT = core
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = dronin-autotune
+DESTDIR = $$GCS_APP_PATH
+macx {
+DESTDIR = $$GCS_BIN_PATH
+}
+
+include(../rpath.pri)
+include(../libs/autotune/autotune.pri)
+
+SOURCES += main.cpp
+
+!macx {
+    target.path = /bin
+    INSTALLS += target
+}
@@ -0,0 +1,315 @@
+/**
+ ******************************************************************************
+ * @file       main.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup autotunecli
+ * @{
+ * @addtogroup
+ * @{
+ * @brief Works out tunes from a batch of autotune partition dumps
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <autotune/autotuneengine.h>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+static const char *const axisNames[3] = { "roll", "pitch", "yaw" };
+
+/* Parses a comma separated list of numbers, for sweeping a parameter */
+static bool parseList(const QString &text, QList<double> *values)
+{
+    for (const QString &item : text.split(',', QString::SkipEmptyParts)) {
+        bool ok;
+        double value = item.trimmed().toDouble(&ok);
+
+        if (!ok) {
+            return false;
+        }
+
+        values->append(value);
+    }
+
+    return !values->isEmpty();
+}
+
+static QJsonArray toJson(const std::vector<std::string> &strings)
+{
+    QJsonArray array;
+
+    for (const std::string &s : strings) {
+        array.append(QString::fromStdString(s));
+    }
+
+    return array;
+}
+
+/* Laid out as the wizard shares results */
+static QJsonObject identificationJson(const AutotuneMeasurement &m)
+{
+    QJsonObject identification;
+
+    for (int i = 0; i < 3; i++) {
+        QJsonObject axis;
+        axis["gain"] = m.axis[i].beta;
+        axis["bias"] = m.axis[i].bias;
+        axis["noise"] = m.axis[i].noise;
+        axis["tau"] = m.axis[i].tau;
+        axis["fit"] = m.axis[i].fit;
+        identification[axisNames[i]] = axis;
+    }
+
+    identification["tau"] = m.axis[0].tau;
+
+    return identification;
+}
+
+static QJsonObject tuningJson(const AutotuneParameters &params, const AutotuneTuning &t)
+{
+    QJsonObject tuning, parameters, computed, gains;
+
+    parameters["damping"] = params.damping;
+    parameters["noiseSensitivity"] = params.noiseSens;
+    parameters["yaw"] = params.tuneYaw;
+    parameters["outerKi"] = params.outerKi;
+    tuning["parameters"] = parameters;
+
+    computed["naturalFrequency"] = t.naturalFreq;
+    computed["derivativeCutoff"] = t.derivativeCutoff;
+    computed["converged"] = t.converged;
+    computed["iterations"] = t.iterations;
+
+    for (int i = 0; i < 3; i++) {
+        QJsonObject gain;
+        gain["kp"] = t.kp[i];
+        gain["ki"] = t.ki[i];
+        gain["kd"] = t.kd[i];
+        gains[axisNames[i]] = gain;
+    }
+
+    QJsonObject outer;
+    outer["kp"] = t.outerKp;
+    outer["ki"] = t.outerKi;
+    gains["outer"] = outer;
+
+    computed["gains"] = gains;
+    tuning["computed"] = computed;
+
+    return tuning;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("dronin-autotune");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Identifies autotune partition dumps and works out PIDs for them, as the "
+        "autotune wizard does, writing the results as JSON.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("paths", "Partition dumps, or directories of them.",
+                                 "paths...");
+
+    QCommandLineOption dampingOpt("damping",
+                                  "Damping to tune for; a comma separated list sweeps it.",
+                                  "values", "1.05");
+    QCommandLineOption noiseOpt("noise-sensitivity",
+                                "High frequency gain to allow, as a fraction; a comma "
+                                "separated list sweeps it.",
+                                "values", "0.01");
+    QCommandLineOption noYawOpt("no-yaw", "Don't tune yaw.");
+    QCommandLineOption outerKiOpt("outer-ki", "Add integral to the attitude loop.");
+    QCommandLineOption threadsOpt("threads", "Threads to identify on; 0 for one per CPU.",
+                                  "n", "0");
+    QCommandLineOption patternOpt("pattern", "Which files in a directory to read.",
+                                  "glob", "*.bin");
+    QCommandLineOption outputOpt(QStringList() << "o" << "output",
+                                 "Write the JSON here instead of to stdout.", "file");
+
+    parser.addOption(dampingOpt);
+    parser.addOption(noiseOpt);
+    parser.addOption(noYawOpt);
+    parser.addOption(outerKiOpt);
+    parser.addOption(threadsOpt);
+    parser.addOption(patternOpt);
+    parser.addOption(outputOpt);
+
+    parser.process(app);
+
+    QTextStream err(stderr);
+
+    QList<double> dampings, noiseSens;
+
+    if (!parseList(parser.value(dampingOpt), &dampings)
+        || !parseList(parser.value(noiseOpt), &noiseSens)) {
+        err << "Bad damping or noise sensitivity list\n";
+        return 1;
+    }
+
+    QStringList files;
+
+    for (const QString &path : parser.positionalArguments()) {
+        QFileInfo info(path);
+
+        if (info.isDir()) {
+            QDir dir(path);
+
+            for (const QString &name :
+                 dir.entryList(QStringList() << parser.value(patternOpt),
+                               QDir::Files, QDir::Name)) {
+                files.append(dir.filePath(name));
+            }
+        } else {
+            files.append(path);
+        }
+    }
+
+    if (files.isEmpty()) {
+        parser.showHelp(1);
+    }
+
+    /* Read everything first, so the whole batch is identified at once */
+    std::vector<AutotuneCapture> captures;
+    QList<int> captureOf;
+    QStringList errors;
+
+    for (const QString &name : files) {
+        QFile file(name);
+        std::string error;
+        AutotuneCapture capture;
+
+        if (!file.open(QIODevice::ReadOnly)) {
+            error = file.errorString().toStdString();
+        } else {
+            QByteArray data = file.readAll();
+
+            if (AutotuneCapture::parse(data.constData(), data.size(), &capture, &error)) {
+                captureOf.append(captures.size());
+                errors.append(QString());
+                captures.push_back(std::move(capture));
+                continue;
+            }
+        }
+
+        captureOf.append(-1);
+        errors.append(QString::fromStdString(error));
+    }
+
+    AutotuneEngine engine(parser.value(threadsOpt).toInt());
+    std::vector<AutotuneMeasurement> measurements = engine.identify(captures);
+
+    QJsonArray results;
+    int failed = 0;
+
+    for (int i = 0; i < files.size(); i++) {
+        QJsonObject result;
+        result["file"] = files[i];
+
+        if (captureOf[i] < 0) {
+            result["error"] = errors[i];
+            results.append(result);
+            failed++;
+            continue;
+        }
+
+        const AutotuneCapture &capture = captures[captureOf[i]];
+        const AutotuneMeasurement &m = measurements[captureOf[i]];
+
+        result["sampleRate"] = capture.sampleRate;
+        result["wigglePoints"] = capture.points;
+        result["identification"] = identificationJson(m);
+
+        std::vector<std::string> warnings, problems;
+        bool usable = m.check(&warnings, &problems);
+
+        result["usable"] = usable;
+        result["warnings"] = toJson(warnings);
+        result["errors"] = toJson(problems);
+
+        if (!usable) {
+            results.append(result);
+            failed++;
+            continue;
+        }
+
+        float tau[3], beta[3];
+
+        for (int axis = 0; axis < 3; axis++) {
+            tau[axis] = m.axis[axis].tau;
+            beta[axis] = m.axis[axis].beta;
+        }
+
+        QJsonArray tunings;
+
+        for (double damping : dampings) {
+            for (double noise : noiseSens) {
+                AutotuneParameters params;
+                params.damping = damping;
+                params.noiseSens = noise;
+                params.tuneYaw =
+                    !parser.isSet(noYawOpt) && beta[2] >= AutotuneEngine::MIN_YAW_BETA;
+                params.outerKi = parser.isSet(outerKiOpt);
+
+                tunings.append(tuningJson(params,
+                                          AutotuneEngine::computeTuning(tau, beta, params)));
+            }
+        }
+
+        result["tunings"] = tunings;
+        results.append(result);
+    }
+
+    QJsonObject json;
+    json["dataVersion"] = 1;
+    json["results"] = results;
+
+    QByteArray out = QJsonDocument(json).toJson();
+
+    if (parser.isSet(outputOpt)) {
+        QFile file(parser.value(outputOpt));
+
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err << "Couldn't write " << file.fileName() << ": " << file.errorString() << "\n";
+            return 1;
+        }
+
+        file.write(out);
+    } else {
+        QFile file;
+        file.open(stdout, QIODevice::WriteOnly);
+        file.write(out);
+    }
+
+    if (failed) {
+        err << failed << " of " << files.size() << " captures couldn't be tuned\n";
+    }
+
+    return failed ? 2 : 0;
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1 @@
+LIBS *= -l$$qtLibraryName(Autotune)
@@ -0,0 +1,17 @@
+TEMPLATE = lib
+TARGET = Autotune
+
+# The engine is plain C++, so it can run anywhere; Qt is only used for
+# the export macros.
+QT = core
+
+DEFINES += AUTOTUNE_LIB
+
+include(../../gcslibrary.pri)
+
+SOURCES += \
+    autotuneengine.cpp
+
+HEADERS += \
+    autotune_global.h \
+    autotuneengine.h
@@ -0,0 +1,567 @@
+/**
+ ******************************************************************************
+ * @file       autotuneengine.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup libs GCS Libraries
+ * @{
+ * @addtogroup autotune Autotune
+ * @{
+ * @brief Identification and tuning from autotune flights, without a GUI
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#define _USE_MATH_DEFINES
+
+#include "autotuneengine.h"
+
+#include "ffft/FFTReal.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <numeric>
+#include <thread>
+
+const double AutotuneEngine::MIN_YAW_BETA = 6.8;
+
+namespace {
+
+const uint64_t ATFLASH_MAGIC = 0x656e755480008041ULL;
+
+struct at_flash_header
+{
+    uint64_t magic;
+    uint16_t wiggle_points;
+    uint16_t aux_data_len;
+    uint16_t sample_rate;
+
+    // Consider total number of averages here
+    uint16_t resv;
+};
+
+struct at_measurement
+{
+    float y[3]; /* Gyro measurements */
+    float u[3]; /* Actuator desired */
+};
+
+/* Run a Butterworth biquad filter on a circular buffer.  First go around once
+ * to "prime" the filter, then actually filter in place.  This is derived from
+ * @glowtape's excellent flight implementation
+ */
+void biquadFilter(float cutoff, std::vector<float> &data)
+{
+    float f = 1.0f / tan(M_PI * cutoff);
+    float q = 1.4142f;
+
+    float y2 = 0, y1 = 0, x2 = 0, x1 = 0;
+
+    float b0 = 1.0f / (1.0f + q * f + f * f);
+    float a1 = 2.0f * (f * f - 1.0f) * b0;
+    float a2 = -(1.0f - q * f + f * f) * b0;
+
+    for (size_t i = 0; i < data.size(); i++) {
+        float y = b0 * (data[i] + 2.0f * x1 + x2) + a1 * y1 + a2 * y2;
+
+        y2 = y1;
+        y1 = y;
+
+        x2 = x1;
+        x1 = data[i];
+    }
+
+    for (size_t i = 0; i < data.size(); i++) {
+        float y = b0 * (data[i] + 2.0f * x1 + x2) + a1 * y1 + a2 * y2;
+
+        y2 = y1;
+        y1 = y;
+
+        x2 = x1;
+        x1 = data[i];
+
+        data[i] = y;
+    }
+}
+
+} // namespace
+
+/* What each thread keeps between captures: an FFT plan per length, and
+ * the buffers the identification works in */
+struct AutotuneEngine::Worker
+{
+    std::map<int, std::unique_ptr<ffft::FFTReal<float> > > plans;
+
+    std::vector<float> delayedFft;
+    std::vector<float> origFft;
+    std::vector<float> product;
+    std::vector<float> prodTime;
+    std::vector<float> sorted;
+
+    ffft::FFTReal<float> &plan(int pts)
+    {
+        std::unique_ptr<ffft::FFTReal<float> > &p = plans[pts];
+
+        if (!p) {
+            p.reset(new ffft::FFTReal<float>(pts));
+        }
+
+        return *p;
+    }
+
+    float getSampleDelay(const std::vector<float> &delayed, const std::vector<float> &orig,
+                         int seriesCutoff);
+
+    float span(const std::vector<float> &data);
+};
+
+/* Returns number of samples of delay between series */
+float AutotuneEngine::Worker::getSampleDelay(const std::vector<float> &delayed,
+                                             const std::vector<float> &orig, int seriesCutoff)
+{
+    int pts = delayed.size();
+    ffft::FFTReal<float> &fft = plan(pts);
+
+    delayedFft.resize(pts);
+    origFft.resize(pts);
+    product.resize(pts);
+    prodTime.resize(pts);
+
+    /* Convert to frequency domain */
+    fft.do_fft(delayedFft.data(), delayed.data());
+    fft.do_fft(origFft.data(), orig.data());
+
+    /* Now perform a correlation by multiplying -orig_fft* by delayed_fft.
+     * The types are all floats here, so we need to do the heavy lifting
+     * ourselves.   gfft = x+yi, dfft = u+vi, dfft* = u-vi,
+     * -dfft* = -u + vi
+     *
+     * -dfft* x gfft = (-ux - vy) + (vx - uy)i
+     */
+    int fpts = pts / 2;
+
+    // Memory layout here is annoyin'.  All reals, then all imaginaries
+    for (int i = 0; i < fpts; i++) {
+        float x = delayedFft[i];
+        float y = delayedFft[i + fpts];
+        float u = origFft[i];
+        float v = origFft[i + fpts];
+
+        product[i] = -(u * x) - (v * y);
+        product[i + fpts] = (v * x) - (u * y);
+    }
+
+    /* Inverse FFT converts this to the time domain */
+    fft.do_ifft(product.data(), prodTime.data());
+
+    /* And we take magnitudes to find tau. */
+    int max_idx = 0;
+    float max_val = 0;
+
+    for (int i = 0; i < fpts / seriesCutoff; i++) {
+        float real = prodTime[i];
+        float imag = prodTime[i + fpts];
+        float mag = sqrt(real * real + imag * imag);
+
+        if (mag > max_val) {
+            max_val = mag;
+            max_idx = i;
+        }
+    }
+
+    // TODO / optional: interpolate/find a better peak around max_idx.
+
+    return max_idx;
+}
+
+/* The spread of the middle 90% of the values */
+float AutotuneEngine::Worker::span(const std::vector<float> &data)
+{
+    int pts = data.size();
+
+    sorted = data;
+    std::sort(sorted.begin(), sorted.end());
+
+    int low_idx = pts * 0.05 + 0.5;
+    int high_idx = pts - 1 - low_idx;
+
+    return sorted[high_idx] - sorted[low_idx];
+}
+
+bool AutotuneCapture::parse(const void *data, size_t len, AutotuneCapture *capture,
+                            std::string *error)
+{
+    at_flash_header hdr;
+
+    if (len < sizeof(hdr)) {
+        if (error) {
+            *error = "too short for an autotune partition";
+        }
+
+        return false;
+    }
+
+    memcpy(&hdr, data, sizeof(hdr));
+
+    if (hdr.magic != ATFLASH_MAGIC) {
+        if (error) {
+            *error = "not an autotune partition";
+        }
+
+        return false;
+    }
+
+    size_t size_expected =
+        sizeof(hdr) + sizeof(at_measurement) * hdr.wiggle_points + hdr.aux_data_len;
+
+    if (len < size_expected) {
+        if (error) {
+            *error = "autotune partition is truncated";
+        }
+
+        return false;
+    }
+
+    float duration = hdr.sample_rate ? (float)hdr.wiggle_points / hdr.sample_rate : 0;
+
+    if ((duration < 0.25f) || (duration > 5.0f)) {
+        if (error) {
+            *error = "implausible wiggle duration";
+        }
+
+        return false;
+    }
+
+    /* The FFT only handles powers of two; the flight side always uses one */
+    if (hdr.wiggle_points & (hdr.wiggle_points - 1)) {
+        if (error) {
+            *error = "wiggle points not a power of two";
+        }
+
+        return false;
+    }
+
+    capture->sampleRate = hdr.sample_rate;
+    capture->points = hdr.wiggle_points;
+
+    const uint8_t *points = static_cast<const uint8_t *>(data) + sizeof(hdr);
+
+    for (int axis = 0; axis < 3; axis++) {
+        capture->gyro[axis].resize(hdr.wiggle_points);
+        capture->actuator[axis].resize(hdr.wiggle_points);
+    }
+
+    for (int i = 0; i < hdr.wiggle_points; i++) {
+        at_measurement m;
+        memcpy(&m, points + i * sizeof(m), sizeof(m));
+
+        for (int axis = 0; axis < 3; axis++) {
+            capture->gyro[axis][i] = m.y[axis];
+            capture->actuator[axis][i] = m.u[axis];
+        }
+    }
+
+    return true;
+}
+
+bool AutotuneMeasurement::check(std::vector<std::string> *warnings,
+                                std::vector<std::string> *errors) const
+{
+    bool ok = true;
+
+    const AutotuneAxis &roll = axis[0];
+    const AutotuneAxis &pitch = axis[1];
+
+    if (!valid || roll.tau == 0) {
+        errors->push_back("No autotune was successfully completed and saved.");
+        return false;
+    }
+
+    if (roll.tau < 0.005) {
+        // Too low of tau to be plausible. (5ms)
+        errors->push_back("Autotune did not measure valid values for this craft (low tau).");
+        ok = false;
+    } else if (roll.tau < 0.0074) {
+        // Probably too low to be real-- 7.4ms-- warn!
+        warnings->push_back("The tau value measured for this craft is very low.");
+    } else if (roll.tau > .240) {
+        // Too high of a tau to be plausible / accurate (240ms)-- warn!
+        warnings->push_back("The tau value measured for this craft is very high.");
+    }
+
+    // Lowest valid gains seen have been 7.9, with most values in the range 9..11
+    if (roll.beta < 7.25) {
+        errors->push_back("Autotune did not measure valid values for this craft (low roll gain).");
+        ok = false;
+    }
+
+    if (pitch.beta < 7.25) {
+        errors->push_back("Autotune did not measure valid values for this craft (low pitch gain).");
+        ok = false;
+    }
+
+    if (axis[2].beta < AutotuneEngine::MIN_YAW_BETA) {
+        warnings->push_back("Unable to auto-calculate yaw gains for this craft.");
+    }
+
+    return ok;
+}
+
+AutotuneEngine::AutotuneEngine(int threads)
+{
+    if (threads <= 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+
+    if (threads <= 0) {
+        threads = 1;
+    }
+
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back(new Worker);
+    }
+}
+
+AutotuneEngine::~AutotuneEngine()
+{
+}
+
+void AutotuneEngine::identifyAxis(Worker *worker, const AutotuneCapture &capture, int axis,
+                                  AutotuneAxis *result)
+{
+    int pts = capture.points;
+    float sample_rate = capture.sampleRate;
+
+    const std::vector<float> &gyro = capture.gyro[axis];
+    std::vector<float> actu_desired = capture.actuator[axis];
+    std::vector<float> gyro_deriv(pts);
+
+    // Differentiate the gyro data
+    for (int i = 1; i < pts; i++) {
+        gyro_deriv[i] = gyro[i] - gyro[i - 1];
+    }
+
+    gyro_deriv[0] = gyro[0] - gyro[pts - 1];
+
+    float sample_tau = worker->getSampleDelay(gyro_deriv, actu_desired, (axis == 2) ? 8 : 4);
+
+    float tau = sample_tau / sample_rate;
+
+    biquadFilter(1 / (sample_tau * M_PI * 1.414), actu_desired);
+
+    float gyro_span = worker->span(gyro_deriv);
+    float actu_span = worker->span(actu_desired);
+
+    float gain = gyro_span / actu_span * sample_rate;
+
+    float avg = std::accumulate(gyro_deriv.begin(), gyro_deriv.end(), 0.0f) / pts;
+
+    for (int i = 0; i < pts; i++) {
+        gyro_deriv[i] = gyro_deriv[i] - avg;
+    }
+
+    float avg_act = std::accumulate(actu_desired.begin(), actu_desired.end(), 0.0f) / pts;
+
+    for (int i = 0; i < pts; i++) {
+        actu_desired[i] = (actu_desired[i] - avg_act) * (gain / sample_rate);
+    }
+
+    float bias = avg - avg_act * (gain / sample_rate);
+
+    double noise = 0;
+    double variance = 0;
+
+    for (int i = 0; i < pts; i++) {
+        noise += (actu_desired[i] - gyro_deriv[i]) * (actu_desired[i] - gyro_deriv[i]);
+        variance += gyro_deriv[i] * gyro_deriv[i];
+    }
+
+    result->tau = tau;
+    result->beta = log(gain);
+    result->bias = bias;
+    result->noise = sqrt(noise / pts);
+    result->fit = (variance > 0) ? 1 - noise / variance : 0;
+
+    result->model = std::move(actu_desired);
+    result->actual = std::move(gyro_deriv);
+}
+
+AutotuneMeasurement AutotuneEngine::identify(const AutotuneCapture &capture)
+{
+    return identify(std::vector<AutotuneCapture>(1, capture)).front();
+}
+
+std::vector<AutotuneMeasurement>
+AutotuneEngine::identify(const std::vector<AutotuneCapture> &captures)
+{
+    std::vector<AutotuneMeasurement> results(captures.size());
+
+    /* Every axis of every capture is independent; hand them out to the
+     * threads one at a time, so a slow one doesn't hold up the rest */
+    size_t jobs = captures.size() * 3;
+    std::atomic<size_t> next(0);
+
+    auto run = [&](Worker *worker) {
+        size_t job;
+
+        while ((job = next++) < jobs) {
+            size_t idx = job / 3;
+            int axis = job % 3;
+
+            identifyAxis(worker, captures[idx], axis, &results[idx].axis[axis]);
+        }
+    };
+
+    size_t nthreads = std::min(workers.size(), jobs);
+    std::vector<std::thread> threads;
+
+    for (size_t i = 1; i < nthreads; i++) {
+        threads.emplace_back(run, workers[i].get());
+    }
+
+    run(workers[0].get());
+
+    for (std::thread &t : threads) {
+        t.join();
+    }
+
+    for (AutotuneMeasurement &m : results) {
+        m.valid = true;
+    }
+
+    return results;
+}
+
+AutotuneTuning AutotuneEngine::computeTuning(const float tau_axis[3], const float beta_axis[3],
+                                             const AutotuneParameters &params)
+{
+    AutotuneTuning tuning;
+
+    // These three parameters define the desired response properties
+    // - rate scale in the fraction of the natural speed of the system
+    //   to strive for.
+    // - damp is the amount of damping in the system. higher values
+    //   make oscillations less likely
+    // - ghf is the amount of high frequency gain and limits the influence
+    //   of noise
+    const double ghf = params.noiseSens;
+    const double damp = params.damping;
+
+    /* Average roll and pitch tau for now. */
+    double tau = (tau_axis[0] + tau_axis[1]) / 2.0;
+    double beta_roll = beta_axis[0];
+    double beta_pitch = beta_axis[1];
+
+    double wn = 1 / tau, wn_last = 1 / tau + 10;
+    double tau_d = 0, tau_d_last = 1000;
+
+    const int iteration_limit = 100, stability_limit = 5;
+    bool converged = false;
+    int iterations = 0;
+    int stable_iterations = 0;
+
+    while (!converged && (++iterations <= iteration_limit)) {
+        double tau_d_roll =
+            (2 * damp * tau * wn - 1) / (4 * tau * damp * damp * wn * wn - 2 * damp * wn
+                                         - tau * wn * wn + exp(beta_roll) * ghf);
+        double tau_d_pitch =
+            (2 * damp * tau * wn - 1) / (4 * tau * damp * damp * wn * wn - 2 * damp * wn
+                                         - tau * wn * wn + exp(beta_pitch) * ghf);
+
+        // Select the slowest filter property
+        tau_d = (tau_d_roll > tau_d_pitch) ? tau_d_roll : tau_d_pitch;
+        wn = (tau + tau_d) / (tau * tau_d) / (2 * damp + 2);
+
+        // check for convergence
+        if (fabs(tau_d - tau_d_last) <= 0.00001 && fabs(wn - wn_last) <= 0.00001) {
+            if (++stable_iterations >= stability_limit)
+                converged = true;
+        } else {
+            stable_iterations = 0;
+        }
+        tau_d_last = tau_d;
+        wn_last = wn;
+    }
+
+    tuning.iterations = iterations;
+    tuning.converged = converged;
+
+    tuning.derivativeCutoff = 1 / (2 * M_PI * tau_d);
+    tuning.naturalFreq = wn / 2 / M_PI;
+
+    // Set the real pole position. The first pole is quite slow, which
+    // prevents the integral being too snappy and driving too much
+    // overshoot.
+    const double a = ((tau + tau_d) / tau / tau_d - 2 * damp * wn) / 25.0;
+    const double b = ((tau + tau_d) / tau / tau_d - 2 * damp * wn - a);
+
+    // Calculate the gain for the outer loop by approximating the
+    // inner loop as a single order lpf. Set the outer loop to be
+    // critically damped;
+    const double zeta_o = 1.3;
+    tuning.outerKp = 1 / 4.0 / (zeta_o * zeta_o) / (1 / wn);
+
+    // Except, if this is very high, we may be slew rate limited and pick
+    // up oscillation that way.  Fix it with very soft clamping.
+    //
+    // When we come up with outer KP's of less than 10, things seem safe
+    // no matter what.  So beyond 7, start to fade our response.
+    //
+    // Chosen to have derivative of 1 at 7, and .5 at 10, and never to have
+    // derivative change sign.
+    if (tuning.outerKp > 7.0) {
+        tuning.outerKp = 3 * log(tuning.outerKp - 4) + 7.0 - 3 * log(3);
+    }
+
+    if (params.outerKi) {
+        tuning.outerKp *= 0.95f; // Pick up some margin.
+        // Add a zero at 1/15th the innermost bandwidth.
+        tuning.outerKi = 0.75 * tuning.outerKp / (2 * M_PI * tau * 15.0);
+    } else {
+        tuning.outerKi = 0;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        double beta = exp(beta_axis[i]);
+
+        double ki;
+        double kp;
+        double kd;
+
+        ki = a * b * wn * wn * tau * tau_d / beta;
+        kp = tau * tau_d * ((a + b) * wn * wn + 2 * a * b * damp * wn) / beta - ki * tau_d;
+        kd = (tau * tau_d * (a * b + wn * wn + (a + b) * 2 * damp * wn) - 1) / beta - kp * tau_d;
+
+        tuning.kp[i] = kp;
+        tuning.ki[i] = ki;
+        tuning.kd[i] = kd;
+    }
+
+    if (!params.tuneYaw) {
+        tuning.kp[2] = -1;
+        tuning.ki[2] = -1;
+        tuning.kd[2] = -1;
+    }
+
+    return tuning;
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,154 @@
+/**
+ ******************************************************************************
+ * @file       autotuneengine.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup libs GCS Libraries
+ * @{
+ * @addtogroup autotune Autotune
+ * @{
+ * @brief Identification and tuning from autotune flights, without a GUI
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef AUTOTUNEENGINE_H
+#define AUTOTUNEENGINE_H
+
+#include "autotune_global.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * The averaged wiggle cycle of an autotune flight, as the Autotune module
+ * saves it in its flash partition.
+ */
+struct AUTOTUNE_EXPORT AutotuneCapture
+{
+    int sampleRate = 0;
+    int points = 0;
+
+    std::vector<float> gyro[3]; //!< Summed gyro rates, per point of the cycle
+    std::vector<float> actuator[3]; //!< Summed actuator desired
+
+    /**
+     * Reads a partition image.
+     * @param[out] error why it couldn't be read, if it couldn't
+     * @returns true on success
+     */
+    static bool parse(const void *data, size_t len, AutotuneCapture *capture,
+                      std::string *error = nullptr);
+};
+
+//! How an axis was found to respond
+struct AUTOTUNE_EXPORT AutotuneAxis
+{
+    float tau = 0; //!< Response delay, s
+    float beta = 0; //!< Log of the gain, ln(deg/s^2 per unit actuator)
+    float bias = 0; //!< Angular acceleration with no input, per sample
+    float noise = 0; //!< RMS of the difference between model and flight
+    float fit = 0; //!< Share of the measured variance the model explains
+
+    std::vector<float> model; //!< Predicted change in rate, per point
+    std::vector<float> actual; //!< Measured change in rate, per point
+};
+
+struct AUTOTUNE_EXPORT AutotuneMeasurement
+{
+    bool valid = false;
+    AutotuneAxis axis[3];
+
+    /**
+     * Checks the measurement is plausible, as the wizard does before
+     * going on.
+     * @returns false if it can't be tuned from
+     */
+    bool check(std::vector<std::string> *warnings,
+               std::vector<std::string> *errors) const;
+};
+
+//! How the wizard's sliders and checkboxes are set
+struct AUTOTUNE_EXPORT AutotuneParameters
+{
+    double damping = 1.05;
+    double noiseSens = 0.010;
+    bool tuneYaw = true;
+    bool outerKi = false;
+};
+
+struct AUTOTUNE_EXPORT AutotuneTuning
+{
+    bool converged = false;
+    int iterations = 0;
+
+    //! -1 means "not calculated"
+    float kp[3] = { -1, -1, -1 };
+    float ki[3] = { -1, -1, -1 };
+    float kd[3] = { -1, -1, -1 };
+
+    float derivativeCutoff = 0;
+    float naturalFreq = 0;
+
+    float outerKp = 0;
+    float outerKi = 0;
+};
+
+/**
+ * Works out the model of each axis from autotune captures, and PIDs from
+ * the model.
+ *
+ * The FFT plans and scratch buffers are kept between calls, one set per
+ * thread, so an engine is best kept around for a batch.  An engine is not
+ * itself safe to use from several threads at once.
+ */
+class AUTOTUNE_EXPORT AutotuneEngine
+{
+public:
+    //! Below this yaw can't be tuned automatically
+    static const double MIN_YAW_BETA;
+
+    /**
+     * @param[in] threads how many threads to identify on, 0 for one per CPU
+     */
+    explicit AutotuneEngine(int threads = 0);
+    ~AutotuneEngine();
+
+    AutotuneMeasurement identify(const AutotuneCapture &capture);
+
+    //! Identifies a batch, the axes of every capture in parallel
+    std::vector<AutotuneMeasurement> identify(const std::vector<AutotuneCapture> &captures);
+
+    static AutotuneTuning computeTuning(const float tau[3], const float beta[3],
+                                        const AutotuneParameters &params);
+
+    int threads() const { return workers.size(); }
+
+private:
+    struct Worker;
+
+    std::vector<std::unique_ptr<Worker> > workers;
+
+    static void identifyAxis(Worker *worker, const AutotuneCapture &capture, int axis,
+                             AutotuneAxis *result);
+};
+
+#endif // AUTOTUNEENGINE_H
+
+/**
+ * @}
+ * @}
+ */
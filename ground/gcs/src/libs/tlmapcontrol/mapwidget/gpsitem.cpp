@@ -48,10 +48,8 @@ namespace mapcontrol
         localposition=map->FromLatLngToLocal(mapwidget->CurrentPosition());
         this->setPos(localposition.X(),localposition.Y());
         this->setZValue(4);
-        trail=new QGraphicsItemGroup(this);
-        trail->setParentItem(map);
-        trailLine=new QGraphicsItemGroup(this);
-        trailLine->setParentItem(map);
+        trail=new TrailPathItem(map,Qt::green,Qt::red);
+        connect(this,SIGNAL(setChildPosition()),trail,SLOT(RefreshPos()));
         this->setFlag(QGraphicsItem::ItemIgnoresTransformations,true);
         mapfollowtype=UAVMapFollowType::None;
         trailtype=UAVTrailType::ByDistance;
@@ -61,7 +59,7 @@ namespace mapcontrol
     }
     GPSItem::~GPSItem()
     {
-
+        delete trail;
     }
 
     void GPSItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
@@ -85,16 +83,7 @@ namespace mapcontrol
             {
                 if(timer.elapsed()>trailtime*1000)
                 {
-                    TrailItem * ob=new TrailItem(position,altitude,Qt::green,map);
-                    trail->addToGroup(ob);
-                    connect(this,SIGNAL(setChildPosition()),ob,SLOT(setPosSLOT()));
-                    if(!lasttrailline.IsEmpty())
-                    {
-                        TrailLineItem * obj=new TrailLineItem(lasttrailline,position,Qt::red,map);
-                        trailLine->addToGroup(obj);
-                        connect(this,SIGNAL(setChildLine()),obj,SLOT(setLineSlot()));
-                    }
-                    lasttrailline=position;
+                    trail->AddPoint(position);
                     timer.restart();
                 }
 
@@ -103,16 +92,7 @@ namespace mapcontrol
             {
                 if(qAbs(internals::PureProjection::DistanceBetweenLatLng(lastcoord,position)*1000)>traildistance)
                 {
-                    TrailItem * ob=new TrailItem(position,altitude,Qt::green,map);
-                    trail->addToGroup(ob);
-                    connect(this,SIGNAL(setChildPosition()),ob,SLOT(setPosSLOT()));
-                    if(!lasttrailline.IsEmpty())
-                    {
-                        TrailLineItem * obj=new TrailLineItem(lasttrailline,position,Qt::red,map);
-                        trailLine->addToGroup(obj);
-                        connect(this,SIGNAL(setChildLine()),obj,SLOT(setLineSlot()));
-                    }
-                    lasttrailline=position;
+                    trail->AddPoint(position);
                     lastcoord=position;
                 }
             }
@@ -167,20 +147,17 @@ namespace mapcontrol
     void GPSItem::SetShowTrail(const bool &value)
     {
         showtrail=value;
-        trail->setVisible(value);
+        trail->SetShowDots(value);
 
     }
     void GPSItem::SetShowTrailLine(const bool &value)
     {
         showtrailline=value;
-        trailLine->setVisible(value);
+        trail->SetShowLine(value);
     }
     void GPSItem::DeleteTrail()const
     {
-        foreach(QGraphicsItem* i,trail->childItems())
-            delete i;
-        foreach(QGraphicsItem* i,trailLine->childItems())
-            delete i;
+        trail->Clear();
     }
     double GPSItem::Distance3D(const internals::PointLatLng &coord, const int &altitude)
     {
@@ -32,8 +32,8 @@
 #include "uavmapfollowtype.h"
 #include "uavtrailtype.h"
 #include <QtSvg/QSvgRenderer>
-#include "trailitem.h"
-#include "traillineitem.h"
+#include "trailpathitem.h"
+#include <QPointer>
 #include "../core/corecommon.h"
 
 namespace mapcontrol
@@ -157,6 +157,18 @@ namespace mapcontrol
         */
         void DeleteTrail()const;
         /**
+        * @brief Sets how many trail points are kept, the oldest being dropped
+        *
+        * @param value
+        */
+        void SetTrailMaxPoints(int const& value){trail->SetMaxPoints(value);}
+        /**
+        * @brief Returns how many trail points are kept
+        *
+        * @return int
+        */
+        int TrailMaxPoints()const{return trail->MaxPoints();}
+        /**
         * @brief Returns true if the UAV automaticaly sets WP reached value (changing its color)
         *
         * @return bool
@@ -191,9 +203,9 @@ namespace mapcontrol
         QPixmap pic;
         core::Point localposition;
         TLMapWidget* mapwidget;
-        QGraphicsItemGroup* trail;
-        QGraphicsItemGroup * trailLine;
-        internals::PointLatLng lasttrailline;
+        // A child of the map, not of this item, as it's drawn in map
+        // coordinates; the map may delete it first
+        QPointer<TrailPathItem> trail;
         QTime timer;
         bool showtrail;
         bool showtrailline;
@@ -477,6 +477,17 @@ namespace mapcontrol
     {
         return zoomReal;
     }
+    QTransform MapGraphicItem::FromPixelToLocal()
+    {
+        core::Point offset = core->GetrenderOffset();
+        qreal width = boundingRect().width();
+        qreal height = boundingRect().height();
+
+        // The same as FromLatLngToLocal, less the rounding
+        return QTransform(MapRenderTransform, 0, 0, MapRenderTransform,
+                          offset.X() * MapRenderTransform - (width * MapRenderTransform - width) / 2,
+                          offset.Y() * MapRenderTransform - (height * MapRenderTransform - height) / 2);
+    }
     double MapGraphicItem::ZoomDigi()
     {
         return zoomDigi;
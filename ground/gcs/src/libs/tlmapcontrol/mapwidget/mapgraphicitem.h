@@ -99,6 +99,15 @@ namespace mapcontrol
         double Zoom();
         double ZoomDigi();
         double ZoomTotal();
+        /**
+        * @brief Returns the transform from projection pixels at the current
+        *        tile zoom to local coordinates, which FromLatLngToLocal
+        *        applies to single points
+        *
+        * @return QTransform
+        */
+        QTransform FromPixelToLocal();
+        int PixelZoom()const{return core->Zoom();}
         void setOverlayOpacity(qreal value);
     protected:
         void mouseMoveEvent ( QGraphicsSceneMouseEvent * event );
@@ -0,0 +1,269 @@
+/**
+******************************************************************************
+*
+* @file       trailpathitem.cpp
+* @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+* @brief      A graphicsItem drawing a whole trail as one polyline
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   TLMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, see <http://www.gnu.org/licenses/>
+*/
+#include "trailpathitem.h"
+
+#include <QPair>
+
+namespace mapcontrol
+{
+    //! Points projected and simplified at once
+    static const int CHUNK = 64;
+    //! Furthest a simplified path strays from the points, in pixels
+    static const qreal TOLERANCE = 0.5;
+    //! Zoom levels kept projected
+    static const int MAX_LEVELS = 4;
+    //! Size of the dots, in pixels
+    static const qreal DOT_SIZE = 4;
+
+    TrailPathItem::TrailPathItem(MapGraphicItem *map, QColor dotColor, QColor lineColor) :
+        QGraphicsItem(map),
+        map(map),
+        dotColor(dotColor),
+        lineColor(lineColor),
+        showdots(true),
+        showline(true),
+        maxpoints(20000),
+        useCount(0)
+    {
+    }
+
+    /**
+    * @brief Squared distance from p to the segment from a to b
+    */
+    static qreal segmentDistance2(QPointF const& p, QPointF const& a, QPointF const& b)
+    {
+        QPointF d = b - a;
+        QPointF v = p - a;
+        qreal len2 = QPointF::dotProduct(d, d);
+        qreal t = len2 > 0 ? QPointF::dotProduct(v, d) / len2 : 0;
+
+        t = qBound<qreal>(0, t, 1);
+        v -= t * d;
+
+        return QPointF::dotProduct(v, v);
+    }
+
+    /**
+    * @brief Douglas-Peucker, marking the points to keep.  The ends are
+    *        always kept.
+    */
+    static void simplify(QPolygonF const& in, QVector<bool> &keep)
+    {
+        const qreal tol2 = TOLERANCE * TOLERANCE;
+        QVector<QPair<int, int> > stack;
+
+        keep.fill(false, in.size());
+        keep[0] = keep[in.size() - 1] = true;
+        stack.append(qMakePair(0, in.size() - 1));
+
+        while (!stack.isEmpty()) {
+            QPair<int, int> span = stack.takeLast();
+            qreal worst = tol2;
+            int worstIdx = -1;
+
+            for (int i = span.first + 1; i < span.second; i++) {
+                qreal d2 = segmentDistance2(in[i], in[span.first], in[span.second]);
+
+                if (d2 > worst) {
+                    worst = d2;
+                    worstIdx = i;
+                }
+            }
+
+            if (worstIdx >= 0) {
+                keep[worstIdx] = true;
+                stack.append(qMakePair(span.first, worstIdx));
+                stack.append(qMakePair(worstIdx, span.second));
+            }
+        }
+    }
+
+    QPointF TrailPathItem::project(internals::PointLatLng const& coord, int zoom) const
+    {
+        core::Point p = map->Projection()->FromLatLngToPixel(coord, zoom);
+        return QPointF(p.X(), p.Y());
+    }
+
+    TrailPathItem::Level &TrailPathItem::levelAt(int zoom)
+    {
+        if (!levels.contains(zoom) && levels.size() >= MAX_LEVELS) {
+            // Forget the level used longest ago
+            QHash<int, Level>::iterator oldest = levels.begin();
+
+            for (QHash<int, Level>::iterator i = levels.begin(); i != levels.end(); ++i) {
+                if (i.value().lastUsed < oldest.value().lastUsed)
+                    oldest = i;
+            }
+
+            levels.erase(oldest);
+        }
+
+        Level &level = levels[zoom];
+        level.lastUsed = ++useCount;
+
+        return level;
+    }
+
+    /**
+    * @brief Simplify whole chunks of the points after the level's last
+    *        committed one onto its path
+    */
+    void TrailPathItem::extendLevel(Level &level, int zoom)
+    {
+        while (points.size() - 1 - qMax(level.committed, 0) >= CHUNK) {
+            int first = qMax(level.committed, 0);
+            int last = first + CHUNK;
+
+            QPolygonF chunk;
+            chunk.reserve(CHUNK + 1);
+
+            for (int i = first; i <= last; i++)
+                chunk.append(project(points[i], zoom));
+
+            QVector<bool> keep;
+            simplify(chunk, keep);
+
+            // The first point is already on the path, but for the first chunk
+            for (int i = level.committed < 0 ? 0 : 1; i < chunk.size(); i++) {
+                if (keep[i])
+                    level.path.append(chunk[i]);
+            }
+
+            level.bounds |= chunk.boundingRect();
+            level.committed = last;
+        }
+    }
+
+    void TrailPathItem::updateGeometry()
+    {
+        prepareGeometryChange();
+
+        int zoom = map->PixelZoom();
+        Level &level = levelAt(zoom);
+
+        extendLevel(level, zoom);
+
+        current = level.path;
+        tail.clear();
+
+        for (int i = qMax(level.committed, 0); i < points.size(); i++)
+            tail.append(project(points[i], zoom));
+
+        bounds = level.bounds | tail.boundingRect();
+
+        setTransform(map->FromPixelToLocal());
+        update();
+    }
+
+    void TrailPathItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+    {
+        Q_UNUSED(option);
+        Q_UNUSED(widget);
+
+        if (showline) {
+            QPen pen(lineColor);
+            pen.setWidth(1);
+            pen.setCosmetic(true);
+            painter->setPen(pen);
+            painter->drawPolyline(current);
+            painter->drawPolyline(tail);
+        }
+
+        if (showdots) {
+            QPen pen(dotColor);
+            pen.setWidthF(DOT_SIZE);
+            pen.setCapStyle(Qt::RoundCap);
+            pen.setCosmetic(true);
+            painter->setPen(pen);
+            painter->drawPoints(current);
+            painter->drawPoints(tail);
+        }
+    }
+
+    QRectF TrailPathItem::boundingRect() const
+    {
+        // The dots and lines are sized in pixels on screen, so allow for
+        // their size at the map's largest digital zoom out
+        qreal margin = DOT_SIZE * 4;
+        return bounds.adjusted(-margin, -margin, margin, margin);
+    }
+
+    int TrailPathItem::type() const
+    {
+        return Type;
+    }
+
+    void TrailPathItem::AddPoint(internals::PointLatLng const& coord)
+    {
+        points.append(coord);
+
+        if (points.size() > maxpoints) {
+            // Drop an eighth more than needed, so this is only done now
+            // and then; the simplified paths start over
+            points.remove(0, points.size() - maxpoints + maxpoints / 8);
+            levels.clear();
+        }
+
+        updateGeometry();
+    }
+
+    void TrailPathItem::Clear()
+    {
+        points.clear();
+        levels.clear();
+        updateGeometry();
+    }
+
+    void TrailPathItem::SetShowDots(bool const& value)
+    {
+        showdots = value;
+        setVisible(showdots || showline);
+        update();
+    }
+
+    void TrailPathItem::SetShowLine(bool const& value)
+    {
+        showline = value;
+        setVisible(showdots || showline);
+        update();
+    }
+
+    void TrailPathItem::SetMaxPoints(int const& value)
+    {
+        maxpoints = qMax(value, 2);
+
+        if (points.size() > maxpoints) {
+            points.remove(0, points.size() - maxpoints);
+            levels.clear();
+            updateGeometry();
+        }
+    }
+
+    void TrailPathItem::RefreshPos()
+    {
+        updateGeometry();
+    }
+}
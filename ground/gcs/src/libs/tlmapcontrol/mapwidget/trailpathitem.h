@@ -0,0 +1,124 @@
+/**
+******************************************************************************
+*
+* @file       trailpathitem.h
+* @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+* @brief      A graphicsItem drawing a whole trail as one polyline
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   TLMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, see <http://www.gnu.org/licenses/>
+*/
+#ifndef TRAILPATHITEM_H
+#define TRAILPATHITEM_H
+
+#include <QGraphicsItem>
+#include <QHash>
+#include <QObject>
+#include <QPainter>
+#include <QVector>
+#include "../internals/pointlatlng.h"
+#include "mapgraphicitem.h"
+#include "../core/corecommon.h"
+
+namespace mapcontrol
+{
+    /**
+    * @brief A UAV or GPS trail: the points it has been through, and lines
+    *        between them
+    *
+    * The points are kept in one buffer, up to MaxPoints() of them.  For each
+    * zoom level the trail is shown at, they're projected to pixels once and
+    * simplified to within half a pixel with Douglas-Peucker, a chunk at a
+    * time as they arrive.  Painting then costs about the same whatever the
+    * length of the flight; dots are drawn at the simplified points.
+    *
+    * @class TrailPathItem trailpathitem.h "mapwidget/trailpathitem.h"
+    */
+    class TLMAPWIDGET_EXPORT TrailPathItem:public QObject,public QGraphicsItem
+    {
+        Q_OBJECT
+        Q_INTERFACES(QGraphicsItem)
+    public:
+        enum { Type = UserType + 10 };
+        TrailPathItem(MapGraphicItem *map, QColor dotColor, QColor lineColor);
+        void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+                    QWidget *widget);
+        QRectF boundingRect() const;
+        int type() const;
+
+        /**
+        * @brief Adds a point to the end of the trail, dropping the oldest
+        *        points if there are more than MaxPoints()
+        *
+        * @param coord
+        */
+        void AddPoint(internals::PointLatLng const& coord);
+        /**
+        * @brief Deletes all the points
+        */
+        void Clear();
+        int PointCount()const{return points.size();}
+
+        void SetShowDots(bool const& value);
+        void SetShowLine(bool const& value);
+
+        /**
+        * @brief Sets how many points are kept
+        *
+        * @param value
+        */
+        void SetMaxPoints(int const& value);
+        int MaxPoints()const{return maxpoints;}
+    public slots:
+        void RefreshPos();
+    private:
+        /**
+        * @brief The trail at one zoom level: the simplified path, up to the
+        *        committed point, in projection pixels
+        */
+        struct Level {
+            Level() : committed(-1), lastUsed(0) {}
+            QPolygonF path;
+            int committed;
+            QRectF bounds;
+            quint64 lastUsed;
+        };
+
+        Level &levelAt(int zoom);
+        void extendLevel(Level &level, int zoom);
+        QPointF project(internals::PointLatLng const& coord, int zoom) const;
+        void updateGeometry();
+
+        MapGraphicItem *map;
+        QColor dotColor;
+        QColor lineColor;
+        bool showdots;
+        bool showline;
+        int maxpoints;
+
+        QVector<internals::PointLatLng> points;
+        QHash<int, Level> levels;
+        quint64 useCount;
+
+        //! The current level's path, and the points since, from its last
+        QPolygonF current;
+        QPolygonF tail;
+        QRectF bounds;
+    };
+}
+#endif // TRAILPATHITEM_H
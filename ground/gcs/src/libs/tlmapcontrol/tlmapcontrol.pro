@@ -9,11 +9,10 @@ SOURCES += mapwidget/mapgraphicitem.cpp \
     mapwidget/waypointitem.cpp \
     mapwidget/uavitem.cpp \
     mapwidget/gpsitem.cpp \
-    mapwidget/trailitem.cpp \
     mapwidget/homeitem.cpp \
     mapwidget/mapripform.cpp \
     mapwidget/mapripper.cpp \
-    mapwidget/traillineitem.cpp \
+    mapwidget/trailpathitem.cpp \
     mapwidget/mapline.cpp \
     mapwidget/mapcircle.cpp \
     mapwidget/waypointcurve.cpp \
@@ -61,11 +60,10 @@ HEADERS += mapwidget/mapgraphicitem.h \
     mapwidget/gpsitem.h \
     mapwidget/uavmapfollowtype.h \
     mapwidget/uavtrailtype.h \
-    mapwidget/trailitem.h \
     mapwidget/homeitem.h \
     mapwidget/mapripform.h \
     mapwidget/mapripper.h \
-    mapwidget/traillineitem.h \
+    mapwidget/trailpathitem.h \
     mapwidget/mapline.h \
     mapwidget/mapcircle.h \
     mapwidget/waypointcurve.h \
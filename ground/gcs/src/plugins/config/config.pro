@@ -12,6 +12,7 @@ include(../../gcsplugin.pri)
 include(../../libs/eigen/eigen.pri)
 include(../../libs/qwt/qwt.pri)
 include(../../libs/utils/utils.pri)
+include(../../libs/autotune/autotune.pri)
 
 include(../../plugins/coreplugin/coreplugin.pri)
 include(../../plugins/uavobjects/uavobjects.pri)
@@ -28,13 +28,11 @@
 #define _USE_MATH_DEFINES
 
 #include <cmath>
-#include <algorithm>
-#include <numeric>
-
-#include "ffft/FFTReal.h"
 
 #include "configautotunewidget.h"
 
+#include <autotune/autotuneengine.h>
+
 #include <uavobjectutil/devicedescriptorstruct.h>
 #include <uavobjectutil/uavobjectutilmanager.h>
 
@@ -677,119 +675,41 @@ void AutotuneSlidersPage::compute()
     tuneState->damping = damp;
     tuneState->noiseSens = ghf;
 
-    /* Average roll and pitch tau for now. */
-    double tau = (tuneState->tau[0] + tuneState->tau[1]) / 2.0;
-    double beta_roll = tuneState->beta[0];
-    double beta_pitch = tuneState->beta[1];
-    double beta_yaw = tuneState->beta[2];
-
     // First clear out warnings..
     lblWarnings->setText("");
 
-    if (beta_yaw < 6.8) {
+    if (tuneState->beta[2] < AutotuneEngine::MIN_YAW_BETA) {
         lblWarnings->setText(tr("Unable to auto-calculate yaw gains for this craft."));
         cbUseYaw->setChecked(false);
         cbUseYaw->setEnabled(false);
     }
 
-    bool doYaw = cbUseYaw->isChecked();
-    bool doOuterKi = cbUseOuterKi->isChecked();
-
-    double wn = 1 / tau, wn_last = 1 / tau + 10;
-    double tau_d = 0, tau_d_last = 1000;
-
-    const int iteration_limit = 100, stability_limit = 5;
-    bool converged = false;
-    int iterations = 0;
-    int stable_iterations = 0;
-
-    while (!converged && (++iterations <= iteration_limit)) {
-        double tau_d_roll =
-            (2 * damp * tau * wn - 1) / (4 * tau * damp * damp * wn * wn - 2 * damp * wn
-                                         - tau * wn * wn + exp(beta_roll) * ghf);
-        double tau_d_pitch =
-            (2 * damp * tau * wn - 1) / (4 * tau * damp * damp * wn * wn - 2 * damp * wn
-                                         - tau * wn * wn + exp(beta_pitch) * ghf);
-
-        // Select the slowest filter property
-        tau_d = (tau_d_roll > tau_d_pitch) ? tau_d_roll : tau_d_pitch;
-        wn = (tau + tau_d) / (tau * tau_d) / (2 * damp + 2);
-
-        // check for convergence
-        if (fabs(tau_d - tau_d_last) <= 0.00001 && fabs(wn - wn_last) <= 0.00001) {
-            if (++stable_iterations >= stability_limit)
-                converged = true;
-        } else {
-            stable_iterations = 0;
-        }
-        tau_d_last = tau_d;
-        wn_last = wn;
-    }
-
-    tuneState->iterations = iterations;
-    tuneState->converged = converged;
-
-    tuneState->derivativeCutoff = 1 / (2 * M_PI * tau_d);
-    tuneState->naturalFreq = wn / 2 / M_PI;
-
-    // Set the real pole position. The first pole is quite slow, which
-    // prevents the integral being too snappy and driving too much
-    // overshoot.
-    const double a = ((tau + tau_d) / tau / tau_d - 2 * damp * wn) / 25.0;
-    const double b = ((tau + tau_d) / tau / tau_d - 2 * damp * wn - a);
-
-    CONF_ATUNE_QXTLOG_DEBUG("ghf: ", ghf);
-    CONF_ATUNE_QXTLOG_DEBUG("wn: ", wn, "tau_d: ", tau_d);
-    CONF_ATUNE_QXTLOG_DEBUG("a: ", a, " b: ", b);
-
-    // Calculate the gain for the outer loop by approximating the
-    // inner loop as a single order lpf. Set the outer loop to be
-    // critically damped;
-    const double zeta_o = 1.3;
-    tuneState->outerKp = 1 / 4.0 / (zeta_o * zeta_o) / (1 / wn);
-
-    // Except, if this is very high, we may be slew rate limited and pick
-    // up oscillation that way.  Fix it with very soft clamping.
-    //
-    // When we come up with outer KP's of less than 10, things seem safe
-    // no matter what.  So beyond 7, start to fade our response.
-    //
-    // Chosen to have derivative of 1 at 7, and .5 at 10, and never to have
-    // derivative change sign.
-    if (tuneState->outerKp > 7.0) {
-        tuneState->outerKp = 3 * log(tuneState->outerKp - 4) +
-            7.0 - 3 * log(3);
-    }
+    AutotuneParameters params;
+    params.damping = damp;
+    params.noiseSens = ghf;
+    params.tuneYaw = cbUseYaw->isChecked();
+    params.outerKi = cbUseOuterKi->isChecked();
 
-    if (doOuterKi) {
-        tuneState->outerKp *= 0.95f; // Pick up some margin.
-        // Add a zero at 1/15th the innermost bandwidth.
-        tuneState->outerKi = 0.75 * tuneState->outerKp / (2 * M_PI * tau * 15.0);
-    } else {
-        tuneState->outerKi = 0;
-    }
+    AutotuneTuning tuning = AutotuneEngine::computeTuning(tuneState->tau, tuneState->beta, params);
 
-    for (int i = 0; i < 3; i++) {
-        double beta = exp(tuneState->beta[i]);
+    tuneState->iterations = tuning.iterations;
+    tuneState->converged = tuning.converged;
 
-        double ki;
-        double kp;
-        double kd;
+    tuneState->derivativeCutoff = tuning.derivativeCutoff;
+    tuneState->naturalFreq = tuning.naturalFreq;
 
-        ki = a * b * wn * wn * tau * tau_d / beta;
-        kp = tau * tau_d * ((a + b) * wn * wn + 2 * a * b * damp * wn) / beta - ki * tau_d;
-        kd = (tau * tau_d * (a * b + wn * wn + (a + b) * 2 * damp * wn) - 1) / beta - kp * tau_d;
+    tuneState->outerKp = tuning.outerKp;
+    tuneState->outerKi = tuning.outerKi;
 
-        tuneState->kp[i] = kp;
-        tuneState->ki[i] = ki;
-        tuneState->kd[i] = kd;
+    for (int i = 0; i < 3; i++) {
+        tuneState->kp[i] = tuning.kp[i];
+        tuneState->ki[i] = tuning.ki[i];
+        tuneState->kd[i] = tuning.kd[i];
     }
 
-    if (!doYaw) {
-        tuneState->kp[2] = -1;
-        tuneState->ki[2] = -1;
-        tuneState->kd[2] = -1;
-    }
+    CONF_ATUNE_QXTLOG_DEBUG("wn: ", tuning.naturalFreq, "cutoff: ", tuning.derivativeCutoff);
+
+    bool converged = tuning.converged;
 
     // handle non-convergence case.  Takes precedence over all else.
     if (!converged) {
@@ -829,6 +749,17 @@ AutotuneFinalPage::AutotuneFinalPage(QWidget *parent)
 #endif
 }
 
+/**
+ * The engine keeps its FFT plans and scratch buffers between runs, so
+ * there's one for the life of the GCS.
+ */
+static AutotuneEngine &autotuneEngine()
+{
+    static AutotuneEngine engine;
+
+    return engine;
+}
+
 AutotuneBeginningPage::AutotuneBeginningPage(QWidget *parent,
         bool autoOpened, AutotunedValues *autoValues)
     : QWizardPage(parent)
@@ -841,48 +772,35 @@ AutotuneBeginningPage::AutotuneBeginningPage(QWidget *parent,
 
 QString AutotuneBeginningPage::tuneValid(bool *okToContinue) const
 {
-    if ((!tuneState->valid) || (tuneState->tau[0] == 0)) {
-        // Invalid / no tune.
+    AutotuneMeasurement measurement;
 
-        *okToContinue = false;
-        return tr("<span style=\"color: red\">It doesn't appear an autotune was successfully "
-                  "completed and saved; we are unable to continue.</span>");
+    measurement.valid = tuneState->valid;
+
+    for (int i = 0; i < 3; i++) {
+        measurement.axis[i].tau = tuneState->tau[i];
+        measurement.axis[i].beta = tuneState->beta[i];
     }
 
-    QString retVal;
+    std::vector<std::string> warnings, errors;
 
-    *okToContinue = true;
+    *okToContinue = measurement.check(&warnings, &errors);
 
-    if (tuneState->tau[0] < 0.005) {
-        // Too low of tau to be plausible. (5ms)
-        retVal.append(tr("Error: Autotune did not measure valid values for this craft (low tau).  "
-                         "Consider slightly lowering the starting roll/pitch rate P values or "
-                         "slightly decreasing Motor Input/Output Curve Fit on the output pane."));
-        retVal.append("<br/>");
-        *okToContinue = false;
-    } else if (tuneState->tau[0] < 0.0074) {
-        // Probably too low to be real-- 7.4ms-- warn!
-        retVal.append(tr("Warning: The tau value measured for this craft is very low."));
-        retVal.append("<br/>");
-    } else if (tuneState->tau[0] > .240) {
-        // Too high of a tau to be plausible / accurate (240ms)-- warn!
-        retVal.append(tr("Warning: The tau value measured for this craft is very high."));
-        retVal.append("<br/>");
+    if (!measurement.valid || measurement.axis[0].tau == 0) {
+        // Invalid / no tune.
+        return tr("<span style=\"color: red\">It doesn't appear an autotune was successfully "
+                  "completed and saved; we are unable to continue.</span>");
     }
 
-    // Lowest valid gains seen have been 7.9, with most values in the range 9..11
-    if (tuneState->beta[0] < 7.25) {
-        retVal.append(
-            tr("Error: Autotune did not measure valid values for this craft (low roll gain)."));
+    QString retVal;
+
+    for (const std::string &error : errors) {
+        retVal.append(tr("Error: %1").arg(QString::fromStdString(error)));
         retVal.append("<br/>");
-        *okToContinue = false;
     }
 
-    if (tuneState->beta[0] < 7.25) {
-        retVal.append(
-            tr("Error: Autotune did not measure valid values for this craft (low pitch gain)."));
+    for (const std::string &warning : warnings) {
+        retVal.append(tr("Warning: %1").arg(QString::fromStdString(warning)));
         retVal.append("<br/>");
-        *okToContinue = false;
     }
 
     retVal.replace(QRegExp("(\\w+:)"), "<span style=\"color: red\"><b>\\1</b></span>");
@@ -965,216 +883,41 @@ bool AutotuneBeginningPage::isComplete() const
     return tuneState->valid && dataValid;
 }
 
-/* Run a Butterworth biquad filter on a circular buffer.  First go around once
- * to "prime" the filter, then actually filter in place.  This is derived from
- * @glowtape's excellent flight implementation
- */
-void AutotuneBeginningPage::biquadFilter(float cutoff, int pts,
-        QVector<float> &data)
-{
-    float f = 1.0f / tan(M_PI * cutoff);
-    float q = 1.4142f;
-
-    float y2 = 0, y1 = 0, x2 = 0, x1 = 0;
-
-    float b0 = 1.0f / (1.0f + q * f + f * f);
-    float a1 = 2.0f * (f * f - 1.0f) * b0;
-    float a2 = -(1.0f - q * f + f * f) * b0;
-
-    for (int i = 0; i < pts; i++) {
-        float y = b0 * (data[i] + 2.0f * x1 + x2) + a1 * y1 + a2 * y2;
-
-        y2 = y1;
-        y1 = y;
-
-        x2 = x1;
-        x1 = data[i];
-    }
-
-    for (int i = 0; i < pts; i++) {
-        float y = b0 * (data[i] + 2.0f * x1 + x2) + a1 * y1 + a2 * y2;
-
-        y2 = y1;
-        y1 = y;
-
-        x2 = x1;
-        x1 = data[i];
-
-        data[i] = y;
-    }
-}
-
-/* Returns number of samples of delay between series */
-float AutotuneBeginningPage::getSampleDelay(int pts,
-        const QVector<float> &delayed, const QVector<float> &orig,
-        int seriesCutoff)
-{
-    ffft::FFTReal<float> fft(pts);
-
-    /* Convert to frequency domain */
-    QVector<float> delayed_fft(pts);
-    fft.do_fft(delayed_fft.data(), delayed.data());
-
-    QVector<float> orig_fft(pts);
-    fft.do_fft(orig_fft.data(), orig.data());
-
-    /* Now perform a correlation by multiplying -orig_fft* by delayed_fft.
-     * The types are all floats here, so we need to do the heavy lifting
-     * ourselves.   gfft = x+yi, dfft = u+vi, dfft* = u-vi,
-     * -dfft* = -u + vi
-     *
-     * -dfft* x gfft = (-ux - vy) + (vx - uy)i
-     */
-
-    QVector<float> product(pts);
-
-    int fpts = pts / 2;
-
-    // Memory layout here is annoyin'.  All reals, then all imaginaries
-    for (int i = 0; i < fpts; i++) {
-        float x = delayed_fft[i];
-        float y = delayed_fft[i + fpts];
-        float u = orig_fft[i];
-        float v = orig_fft[i + fpts];
-
-        product[i] = -(u * x) - (v * y);
-        product[i + fpts] = (v * x) - (u * y);
-    }
-
-    /* Inverse FFT converts this to the time domain */
-    QVector<float> prod_time(pts);
-
-    fft.do_ifft(product.data(), prod_time.data());
-
-    /* And we take magnitudes to find tau. */
-    QVector<float> mags(fpts);
-
-    int max_idx = 0;
-    float max_val = 0;
-
-    for (int i = 0; i < fpts / seriesCutoff; i++) {
-        float real = prod_time[i];
-        float imag = prod_time[i + fpts];
-        mags[i] = sqrt(real * real + imag * imag);
-
-        if (mags[i] > max_val) {
-            max_val = mags[i];
-            max_idx = i;
-        }
-
-        // cout << i << "\t" << mags[i] << "\n";
-    }
-
-    // cout << "Maximum mags[" << max_idx << "] = " << max_val << "\n";
-
-    // TODO / optional: interpolate/find a better peak around max_idx.
-
-    return max_idx;
-}
-
 bool AutotuneBeginningPage::processAutotuneData()
 {
-    QByteArray &loadedFile = tuneState->data;
-
-    const at_flash *flash_data = reinterpret_cast<const at_flash *>((const void *)loadedFile);
-
-    unsigned int size = loadedFile.size();
-
-    /* Determine whether we have a sane amount of data, etc. */
-    if ((size < sizeof(at_flash)) || (flash_data->hdr.magic != ATFLASH_MAGIC)) {
-        return false;
-    }
-
-    unsigned int size_expected = sizeof(at_flash)
-        + sizeof(at_measurement) * flash_data->hdr.wiggle_points + flash_data->hdr.aux_data_len;
+    const QByteArray &loadedFile = tuneState->data;
 
-    if (size < size_expected) {
-        return false;
-    }
+    AutotuneCapture capture;
+    std::string error;
 
-    float duration = (float)flash_data->hdr.wiggle_points / flash_data->hdr.sample_rate;
-
-    if ((duration < 0.25f) || (duration > 5.0f)) {
+    if (!AutotuneCapture::parse(loadedFile.constData(), loadedFile.size(), &capture, &error)) {
+        qDebug() << "Autotune data unusable:" << QString::fromStdString(error);
         return false;
     }
 
-    int pts = flash_data->hdr.wiggle_points;
+    AutotuneMeasurement measurement = autotuneEngine().identify(capture);
 
     for (int axis = 0; axis < 3; axis++) {
-        QVector<float> gyro_deriv(pts);
-        QVector<float> actu_desired(pts);
-
-        for (int i = 0; i < pts; i++) {
-            actu_desired[i] = flash_data->data[i].u[axis];
-        }
-
-        // Differentiate the gyro data
-        for (int i = 1; i < pts; i++) {
-            gyro_deriv[i] = flash_data->data[i].y[axis] - flash_data->data[i - 1].y[axis];
-        }
-
-        gyro_deriv[0] = flash_data->data[0].y[axis] - flash_data->data[pts - 1].y[axis];
-
-        float sample_tau = getSampleDelay(pts, gyro_deriv, actu_desired,
-                (axis == 2) ? 8 : 4);
-
-        float tau = sample_tau / flash_data->hdr.sample_rate;
-
-        biquadFilter(1 / (sample_tau * M_PI * 1.414), pts, actu_desired);
-
-        QVector<float> gyro_sorted = gyro_deriv;
-        QVector<float> actu_sorted = actu_desired;
-
-        std::sort(gyro_sorted.begin(), gyro_sorted.end());
-        std::sort(actu_sorted.begin(), actu_sorted.end());
-
-        int low_idx = pts * 0.05 + 0.5;
-        int high_idx = pts - 1 - low_idx;
-
-        float gyro_span = gyro_sorted[high_idx] - gyro_sorted[low_idx];
-        float actu_span = actu_sorted[high_idx] - actu_sorted[low_idx];
-
-        float gain = gyro_span / actu_span * flash_data->hdr.sample_rate;
-
-        float avg = std::accumulate(gyro_deriv.begin(), gyro_deriv.end(), 0.0f) / pts;
-
-        for (int i = 0; i < pts; i++) {
-            gyro_deriv[i] = gyro_deriv[i] - avg;
-        }
-
-        float avg_act = std::accumulate(actu_desired.begin(), actu_desired.end(), 0.0f) / pts;
-
-        for (int i = 0; i < pts; i++) {
-            actu_desired[i] = (actu_desired[i] - avg_act) * (gain / flash_data->hdr.sample_rate);
-        }
+        const AutotuneAxis &result = measurement.axis[axis];
 
         tuneState->model[axis] = new QLineSeries(this);
         tuneState->actual[axis] = new QLineSeries(this);
 
-        for (int i = 0; i < pts; i++) {
-            int tm = (i * 1000) / flash_data->hdr.sample_rate;
-
-            tuneState->model[axis]->append(tm, actu_desired[i]);
-            tuneState->actual[axis]->append(tm, gyro_deriv[i]);
-        }
-
-        float bias = avg - avg_act * (gain / flash_data->hdr.sample_rate);
-
-        double noise = 0;
+        for (int i = 0; i < capture.points; i++) {
+            int tm = (i * 1000) / capture.sampleRate;
 
-        for (int i = 0; i < pts; i++) {
-            noise += (actu_desired[i] - gyro_deriv[i]) * (actu_desired[i] - gyro_deriv[i]);
+            tuneState->model[axis]->append(tm, result.model[i]);
+            tuneState->actual[axis]->append(tm, result.actual[i]);
         }
 
-        noise = sqrt(noise / pts);
-
-        qDebug() << "Series " << axis << ": tau=" << tau << "; gain=" << gain << " (" << log(gain)
-                 << "); bias=" << bias << " noise=" << noise << "";
+        qDebug() << "Series " << axis << ": tau=" << result.tau << "; gain=" << exp(result.beta)
+                 << " (" << result.beta << "); bias=" << result.bias
+                 << " noise=" << result.noise << "";
 
-        tuneState->tau[axis] = tau;
-        tuneState->beta[axis] = log(gain);
-        tuneState->bias[axis] = bias;
-        tuneState->noise[axis] = noise;
+        tuneState->tau[axis] = result.tau;
+        tuneState->beta[axis] = result.beta;
+        tuneState->bias[axis] = result.bias;
+        tuneState->noise[axis] = result.noise;
     }
 
     tuneState->valid = true;
@@ -110,40 +110,7 @@ private:
     bool autoOpened;
     bool dataValid;
 
-    /* Need a better place for all of these implementation things.  But
-     * for now this is at least encapsulated and won't get tainted
-     * elsewhere
-     */
-    const uint64_t ATFLASH_MAGIC = 0x656e755480008041;
-
-    struct at_flash_header
-    {
-        uint64_t magic;
-        uint16_t wiggle_points;
-        uint16_t aux_data_len;
-        uint16_t sample_rate;
-
-        // Consider total number of averages here
-        uint16_t resv;
-    };
-
-    struct at_measurement
-    {
-        float y[3]; /* Gyro measurements */
-        float u[3]; /* Actuator desired */
-    };
-
-    struct at_flash
-    {
-        struct at_flash_header hdr;
-
-        struct at_measurement data[];
-    };
-
     bool processAutotuneData();
-    void biquadFilter(float cutoff, int pts, QVector<float> &data);
-    float getSampleDelay(int pts, const QVector<float> &delayed,
-            const QVector<float> &orig, int seriesCutoff = 4);
 
 private slots:
     void doDownloadAndProcess();
@@ -47,6 +47,9 @@
 
 #include <QApplication>
 
+//! Minimum interval between two flushes of the updated objects, ~60 Hz
+static const int FLUSH_INTERVAL_MS = 16;
+
 UAVObjectTreeModel::UAVObjectTreeModel(QObject *parent, bool useScientificNotation)
     : QAbstractItemModel(parent)
     , m_rootItem(NULL)
@@ -67,6 +70,10 @@ UAVObjectTreeModel::UAVObjectTreeModel(QObject *parent, bool useScientificNotati
     m_defaultValueFont = font;
     font.setWeight(QFont::Bold);
     m_nonDefaultValueFont = font;
+
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FLUSH_INTERVAL_MS);
+    connect(&m_flushTimer, &QTimer::timeout, this, &UAVObjectTreeModel::flushDirtyObjects);
 }
 
 UAVObjectTreeModel::~UAVObjectTreeModel()
@@ -97,6 +104,10 @@ void UAVObjectTreeModel::setupModelData(UAVObjectManager *objManager,
             &UAVObjectTreeModel::updateHighlight);
 
         delete m_highlightManager;
+        m_flushTimer.stop();
+        m_dirtyItems.clear();
+        m_staleItems.clear();
+        m_expandedItems.clear();
         int count = m_rootItem->childCount();
         beginRemoveRows(index(m_rootItem), 0, count);
         delete m_rootItem;
@@ -162,6 +173,7 @@ void UAVObjectTreeModel::instanceRemove(UAVObject *obj)
             if (inst && inst->object() == obj) {
                 printf("removing an instance\n");
 
+                forgetItem(inst);
                 beginRemoveRows(index(inst->parent()), itemIdx, itemIdx);
                 inst->parent()->removeChild(inst);
                 inst->deleteLater();
@@ -172,6 +184,24 @@ void UAVObjectTreeModel::instanceRemove(UAVObject *obj)
     }
 }
 
+/**
+ * @brief Drops an item about to be deleted, and the items below it, from the
+ * expanded, dirty and stale sets so no pending flush or expansion uses them
+ */
+void UAVObjectTreeModel::forgetItem(TreeItem *item)
+{
+    foreach (TreeItem *child, item->treeChildren())
+        forgetItem(child);
+
+    m_expandedItems.remove(item);
+
+    ObjectTreeItem *objItem = dynamic_cast<ObjectTreeItem *>(item);
+    if (objItem) {
+        m_dirtyItems.remove(objItem);
+        m_staleItems.remove(objItem);
+    }
+}
+
 void UAVObjectTreeModel::addDataObject(UAVDataObject *obj)
 {
     // Determine if the root tree is the settings or dynamic data tree
@@ -498,20 +528,119 @@ QVariant UAVObjectTreeModel::headerData(int section, Qt::Orientation orientation
     return QVariant();
 }
 
+/**
+ * @brief Marks an updated object as dirty. The tree items are refreshed
+ * later by flushDirtyObjects(), so a burst of updates for the same object
+ * costs a single set insertion each.
+ */
 void UAVObjectTreeModel::highlightUpdatedObject(UAVObject *obj)
 {
     Q_ASSERT(obj);
     ObjectTreeItem *item = findObjectTreeItem(obj);
     Q_ASSERT(item);
-    if (!m_onlyHighlightChangedValues) {
-        item->setHighlight();
+    m_dirtyItems.insert(item);
+    if (!m_flushTimer.isActive())
+        m_flushTimer.start();
+}
+
+/**
+ * @brief Refreshes every object updated since the last flush, emitting at
+ * most one dataChanged range for the object row and one for its children.
+ */
+void UAVObjectTreeModel::flushDirtyObjects()
+{
+    QSet<ObjectTreeItem *> dirty;
+    dirty.swap(m_dirtyItems);
+
+    foreach (ObjectTreeItem *item, dirty) {
+        // Nothing on screen shows this object, defer all work until expanded
+        if (!isRowVisible(item)) {
+            m_staleItems.insert(item);
+            continue;
+        }
+
+        refreshObjectItem(item, m_expandedItems.contains(item));
+    }
+}
+
+/**
+ * @brief Updates the highlight and values of an object tree item
+ * @param item the object item to refresh
+ * @param fieldsVisible true if the field items of the object are shown,
+ * otherwise only the object row is touched and field decoding is skipped
+ */
+void UAVObjectTreeModel::refreshObjectItem(ObjectTreeItem *item, bool fieldsVisible)
+{
+    UAVDataObject *dobj = qobject_cast<UAVDataObject *>(item->object());
+    // Settings are rare and drive the default value font of the collapsed row
+    bool decode = fieldsVisible || !dobj || dobj->isSettings();
+
+    if (decode) {
+        m_staleItems.remove(item);
+        item->update();
+    } else {
+        m_staleItems.insert(item);
     }
-    item->update();
-    if (!m_onlyHighlightChangedValues) {
-        QModelIndex itemIndex = index(item);
-        Q_ASSERT(itemIndex != QModelIndex());
-        emit dataChanged(itemIndex, itemIndex);
+
+    if (m_onlyHighlightChangedValues)
+        return;
+
+    item->setHighlight();
+
+    QModelIndex itemIndex = index(item);
+    Q_ASSERT(itemIndex != QModelIndex());
+    emit dataChanged(itemIndex, itemIndex.sibling(itemIndex.row(), TreeItem::dataColumn));
+
+    if (fieldsVisible && item->childCount() > 0) {
+        emit dataChanged(index(0, 0, itemIndex),
+                         index(item->childCount() - 1, TreeItem::dataColumn, itemIndex));
+    }
+}
+
+/**
+ * @brief Checks whether all the ancestors of an item are expanded, i.e. if
+ * the item row can be seen in the view
+ */
+bool UAVObjectTreeModel::isRowVisible(TreeItem *item) const
+{
+    for (TreeItem *p = item->parent(); p && p != m_rootItem; p = p->parent()) {
+        if (!m_expandedItems.contains(p))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Tracks the expanded state of the view so updates to hidden items can
+ * skip field decoding. Items that went stale while hidden are refreshed here.
+ * @param index source model index of the item
+ * @param expanded new expanded state
+ */
+void UAVObjectTreeModel::setItemExpanded(const QModelIndex &index, bool expanded)
+{
+    if (!index.isValid())
+        return;
+
+    TreeItem *item = static_cast<TreeItem *>(index.internalPointer());
+    if (!expanded) {
+        m_expandedItems.remove(item);
+        return;
+    }
+
+    m_expandedItems.insert(item);
+
+    // Refresh stale objects that just became visible, either this item or
+    // the object rows anywhere below it (e.g. instances under an object)
+    QList<ObjectTreeItem *> stale;
+    foreach (ObjectTreeItem *objItem, m_staleItems) {
+        bool below = false;
+        for (TreeItem *p = objItem; p && !below; p = p->parent())
+            below = (p == item);
+        if (below && isRowVisible(objItem))
+            stale.append(objItem);
     }
+    foreach (ObjectTreeItem *objItem, stale)
+        refreshObjectItem(objItem, m_expandedItems.contains(objItem));
 }
 
 ObjectTreeItem *UAVObjectTreeModel::findObjectTreeItem(UAVObject *object)
@@ -39,6 +39,8 @@
 #include <QAbstractItemModel>
 #include <QtCore/QMap>
 #include <QtCore/QList>
+#include <QtCore/QSet>
+#include <QtCore/QTimer>
 #include <QColor>
 #include <QFont>
 
@@ -85,6 +87,8 @@ public:
         return createIndex(indexRow, indexCol, topTreeItem);
     }
 
+    void setItemExpanded(const QModelIndex &index, bool expanded);
+
 signals:
     void presentOnHardwareChanged();
 public slots:
@@ -93,6 +97,7 @@ public slots:
     void instanceRemove(UAVObject *);
 private slots:
     void highlightUpdatedObject(UAVObject *obj);
+    void flushDirtyObjects();
     void updateHighlight(TreeItem *);
     void presentOnHardwareChangedCB(UAVDataObject *);
 
@@ -110,6 +115,9 @@ private:
     ObjectTreeItem *findObjectTreeItem(UAVObject *obj);
     DataObjectTreeItem *findDataObjectTreeItem(UAVDataObject *obj);
     MetaObjectTreeItem *findMetaObjectTreeItem(UAVMetaObject *obj);
+    bool isRowVisible(TreeItem *item) const;
+    void refreshObjectItem(ObjectTreeItem *item, bool fieldsVisible);
+    void forgetItem(TreeItem *item);
 
     TreeItem *m_rootItem;
     TopTreeItem *m_settingsTree;
@@ -128,6 +136,14 @@ private:
     // Highlight manager to handle highlighting of tree items.
     HighLightManager *m_highlightManager;
     bool isInitialized;
+
+    // Objects updated since the last flush; consumed by flushDirtyObjects()
+    QSet<ObjectTreeItem *> m_dirtyItems;
+    // Objects whose field items were not decoded because they were hidden
+    QSet<ObjectTreeItem *> m_staleItems;
+    // Items currently expanded in the view (source model items)
+    QSet<TreeItem *> m_expandedItems;
+    QTimer m_flushTimer;
 };
 
 #endif // UAVOBJECTTREEMODEL_H
@@ -51,6 +51,8 @@
 // Macros
 #define SET_BITS(var, shift, value, mask) var = (var & ~(mask << shift)) | (value << shift);
 
+bool UAVObject::generatedPacking = true;
+
 /**
  * Constructor
  * @param objID The object ID
@@ -254,6 +256,9 @@ UAVObjectField *UAVObject::getField(const QString &name)
  */
 qint32 UAVObject::pack(quint8 *dataOut)
 {
+    if (generatedPacking && packData(dataOut))
+        return numBytes;
+
     qint32 offset = 0;
     for (QList<UAVObjectField *>::iterator iter = fields.begin(); iter != fields.end(); ++iter) {
         UAVObjectField *field = *iter;
@@ -269,11 +274,14 @@ qint32 UAVObject::pack(quint8 *dataOut)
  */
 qint32 UAVObject::unpack(const quint8 *dataIn)
 {
-    qint32 offset = 0;
-    for (QList<UAVObjectField *>::iterator iter = fields.begin(); iter != fields.end(); ++iter) {
-        UAVObjectField *field = *iter;
-        field->unpack(&dataIn[offset]);
-        offset += field->getNumBytes();
+    if (!generatedPacking || !unpackData(dataIn)) {
+        qint32 offset = 0;
+        for (QList<UAVObjectField *>::iterator iter = fields.begin(); iter != fields.end();
+             ++iter) {
+            UAVObjectField *field = *iter;
+            field->unpack(&dataIn[offset]);
+            offset += field->getNumBytes();
+        }
     }
     emit objectUnpacked(this); // trigger object updated event
     emit objectUpdated(this);
@@ -281,6 +289,44 @@ qint32 UAVObject::unpack(const quint8 *dataIn)
     return numBytes;
 }
 
+/**
+ * Object specific packing, generated per object
+ * @returns false if the object has none, and the generic per-field
+ * path must be used instead
+ */
+bool UAVObject::packData(quint8 *dataOut)
+{
+    Q_UNUSED(dataOut);
+    return false;
+}
+
+/**
+ * Object specific unpacking, generated per object
+ * @returns false if the object has none, and the generic per-field
+ * path must be used instead
+ */
+bool UAVObject::unpackData(const quint8 *dataIn)
+{
+    Q_UNUSED(dataIn);
+    return false;
+}
+
+/**
+ * Choose whether pack() and unpack() use the generated per-object routines
+ * or always go through the generic per-field path.  The generated routines
+ * are used by default; this exists for benchmarking and for tracking down
+ * suspected packing problems.
+ */
+void UAVObject::setGeneratedPacking(bool enable)
+{
+    generatedPacking = enable;
+}
+
+bool UAVObject::getGeneratedPacking()
+{
+    return generatedPacking;
+}
+
 /**
  * Return a string with the object information
  */
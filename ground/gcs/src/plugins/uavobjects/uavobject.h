@@ -157,6 +157,9 @@ public:
     static UpdateMode GetGcsTelemetryUpdateMode(const Metadata &meta);
     static void SetGcsTelemetryUpdateMode(Metadata &meta, UpdateMode val);
 
+    static void setGeneratedPacking(bool enable);
+    static bool getGeneratedPacking();
+
 public slots:
     void requestUpdate();
     void requestUpdateAllInstances();
@@ -253,6 +256,11 @@ protected:
     QList<UAVObjectField *> fields;
     void initializeFields(QList<UAVObjectField *> &fields, quint8 *data, quint32 numBytes);
     void setDescription(const QString &description);
+    virtual bool packData(quint8 *dataOut);
+    virtual bool unpackData(const quint8 *dataIn);
+
+private:
+    static bool generatedPacking;
 };
 
 #endif // UAVOBJECT_H
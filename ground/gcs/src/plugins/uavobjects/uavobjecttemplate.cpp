@@ -37,6 +37,8 @@
 
 #include "$(NAMELC).h"
 #include "uavobjects/uavobjectfield.h"
+#include <QtEndian>
+#include <cstring>
 
 const QString $(NAME)::NAME = QString("$(NAME)");
 const QString $(NAME)::DESCRIPTION = QString("$(DESCRIPTION)");
@@ -113,6 +115,45 @@ void $(NAME)::setData(const DataFields& data)
     }
 }
 
+/**
+ * Pack the object data into wire format.  DataFields is laid out exactly
+ * like the wire format, so on little endian hosts this is a single copy.
+ */
+bool $(NAME)::packData(quint8 *dataOut)
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    memcpy(dataOut, &data, NUMBYTES);
+#else
+    const quint8 *src = reinterpret_cast<const quint8 *>(&data);
+    quint16 word16;
+    quint32 word32;
+    Q_UNUSED(src);
+    Q_UNUSED(word16);
+    Q_UNUSED(word32);
+$(PACKFIELDS)
+#endif
+    return true;
+}
+
+/**
+ * Unpack the object data from wire format, see packData()
+ */
+bool $(NAME)::unpackData(const quint8 *dataIn)
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    memcpy(&data, dataIn, NUMBYTES);
+#else
+    quint8 *dst = reinterpret_cast<quint8 *>(&data);
+    quint16 word16;
+    quint32 word32;
+    Q_UNUSED(dst);
+    Q_UNUSED(word16);
+    Q_UNUSED(word32);
+$(UNPACKFIELDS)
+#endif
+    return true;
+}
+
 void $(NAME)::emitNotifications()
 {
     $(NOTIFY_PROPERTIES_CHANGED)
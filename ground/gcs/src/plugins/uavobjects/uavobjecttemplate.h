@@ -91,6 +91,10 @@ $(PROPERTY_SETTERS)
 signals:
 $(PROPERTY_NOTIFICATIONS)
 
+protected:
+    bool packData(quint8 *dataOut);
+    bool unpackData(const quint8 *dataIn);
+
 private slots:
     void emitNotifications();
 	
@@ -57,6 +57,8 @@
 UAVObjectUtilManager::UAVObjectUtilManager()
 {
     saveState = IDLE;
+    savesInFlight = 0;
+    singleSaves = 0;
     failureTimer.stop();
     failureTimer.setSingleShot(true);
     failureTimer.setInterval(1000);
@@ -107,6 +109,9 @@ UAVObjectManager *UAVObjectUtilManager::getObjectManager()
  *    once the operation is completed. We need therefore to listen to updates on the
  * objectPersistence
  *    object, and check the "Operation" field, which should be set to "completed", or "error".
+ *
+ * When several objects are queued, they're sent as one "SaveBatch" request instead: the board
+ * saves them all in one flash transaction and answers once for the lot.
  */
 void UAVObjectUtilManager::saveObjectToFlash(UAVObject *obj)
 {
@@ -114,10 +119,11 @@ void UAVObjectUtilManager::saveObjectToFlash(UAVObject *obj)
     queue.enqueue(obj);
     UAVOBJECTUTIL_QXTLOG_DEBUG(QString("Enqueue object:%0").arg(obj->getName()));
 
-    // If queue length is one, then start sending (call sendNextObject)
+    // If queue length is one, then start sending (call sendNextObject) once
+    // the caller is done queueing, so a burst of saves goes as one batch.
     // Otherwise, do nothing, because we are already sending.
     if (queue.length() == 1)
-        saveNextObject();
+        QTimer::singleShot(0, this, &UAVObjectUtilManager::saveNextObject);
 }
 
 /**
@@ -127,12 +133,10 @@ void UAVObjectUtilManager::saveObjectToFlash(UAVObject *obj)
  */
 void UAVObjectUtilManager::saveNextObject()
 {
-    if (queue.isEmpty()) {
+    if (queue.isEmpty() || saveState != IDLE) {
         return;
     }
 
-    Q_ASSERT(saveState == IDLE);
-
     // Get next object from the queue (don't dequeue yet)
     UAVObject *obj = queue.head();
     Q_ASSERT(obj);
@@ -161,9 +165,34 @@ void UAVObjectUtilManager::saveNextObject()
     UAVOBJECTUTIL_QXTLOG_DEBUG(QString("[saveObjectToFlash] Moving on to AWAITING_ACK"));
 
     ObjectPersistence::DataFields data;
+    memset(&data, 0, sizeof(data));
     data.Operation = ObjectPersistence::OPERATION_SAVE;
     data.ObjectID = obj->getObjID();
     data.InstanceID = obj->getInstID();
+
+    savesInFlight = 1;
+
+    if (singleSaves > 0) {
+        singleSaves--;
+    } else {
+        // Batch up what else is queued behind it
+        while (savesInFlight < queue.length()
+               && savesInFlight <= (int)ObjectPersistence::BATCHOBJECTID_NUMELEM) {
+            UAVObject *next = queue.at(savesInFlight);
+
+            // The board takes each instance at most once per batch
+            if (queue.mid(0, savesInFlight).contains(next))
+                break;
+
+            data.BatchObjectID[savesInFlight - 1] = next->getObjID();
+            data.BatchInstanceID[savesInFlight - 1] = next->getInstID();
+            savesInFlight++;
+        }
+
+        if (savesInFlight > 1)
+            data.Operation = ObjectPersistence::OPERATION_SAVEBATCH;
+    }
+
     objectPersistence->setData(data);
     objectPersistence->updated();
     // Now: we are going to get the following:
@@ -215,12 +244,7 @@ void UAVObjectUtilManager::objectPersistenceTransactionCompleted(UAVObject *obj,
         Q_ASSERT(objectPersistence);
 
         objectPersistence->disconnect(this);
-        queue.dequeue(); // We can now remove the object, it failed anyway.
-        saveState = IDLE;
-        // Careful below: objectPersistence contains a field 'ObjectID' that corresponds to
-        // the objectID we wanted to save. Don't confuse with the OBJID of the Objectpersistence
-        // UAVO itself!
-        emit saveCompleted(objectPersistence->getObjectID(), false);
+        finishSaves(false); // We can now remove the objects, they failed anyway.
         saveNextObject();
     }
 }
@@ -236,13 +260,17 @@ void UAVObjectUtilManager::objectPersistenceOperationFailed()
         ObjectPersistence *objectPersistence = ObjectPersistence::GetInstance(getObjectManager());
         Q_ASSERT(objectPersistence);
 
-        UAVObject *obj = queue.dequeue(); // We can now remove the object, it failed anyway.
-        Q_ASSERT(obj);
-
         objectPersistence->disconnect(this);
 
-        saveState = IDLE;
-        emit saveCompleted(obj->getObjID(), false);
+        if (savesInFlight > 1) {
+            // Don't give up on the whole batch: retry its objects one at a time,
+            // so only those the board really can't save fail.
+            saveState = IDLE;
+            singleSaves = savesInFlight;
+            savesInFlight = 0;
+        } else {
+            finishSaves(false); // We can now remove the object, it failed anyway.
+        }
 
         saveNextObject();
     }
@@ -279,14 +307,31 @@ void UAVObjectUtilManager::objectPersistenceUpdated(UAVObject *obj)
         }
 
         obj->disconnect(this);
-        queue.dequeue(); // We can now remove the object, it's done.
-        saveState = IDLE;
         UAVOBJECTUTIL_QXTLOG_DEBUG(QString("[saveObjectToFlash] Object save succeeded"));
-        emit saveCompleted(objectPersistence.ObjectID, true);
+        finishSaves(true); // We can now remove the objects, they're done.
         saveNextObject();
     }
 }
 
+/**
+ * @brief Removes the objects the last request covered from the queue, and reports how it went
+ * @param[in] success Whether the board saved them
+ */
+void UAVObjectUtilManager::finishSaves(bool success)
+{
+    int done = savesInFlight;
+
+    savesInFlight = 0;
+    saveState = IDLE;
+
+    for (int i = 0; i < done && !queue.isEmpty(); i++) {
+        UAVObject *obj = queue.dequeue();
+        Q_ASSERT(obj);
+
+        emit saveCompleted(obj->getObjID(), success);
+    }
+}
+
 /**
  * @brief UAVObjectUtilManager::readAllNonSettingsMetadata Convenience function for calling
  * readMetadata
@@ -89,7 +89,10 @@ signals:
 private:
     QQueue<UAVObject *> queue;
     enum { IDLE, AWAITING_ACK, AWAITING_COMPLETED } saveState;
+    int savesInFlight; //!< How many objects at the head of the queue the request covers
+    int singleSaves; //!< How many objects to save one at a time, after a batch failed
     void saveNextObject();
+    void finishSaves(bool success);
     QTimer failureTimer;
     ExtensionSystem::PluginManager *pm;
     UAVObjectManager *obm;
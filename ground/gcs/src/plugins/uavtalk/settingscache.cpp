@@ -0,0 +1,170 @@
+/**
+ ******************************************************************************
+ *
+ * @file       settingscache.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ *
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief On-disk copy of a board's settings, so reconnects fetch only changes
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "settingscache.h"
+#include "utils/pathutils.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+SettingsCache::SettingsCache()
+    : aggregateCRC(0)
+{
+}
+
+/**
+ * Load the cache of the board with this ID (its CPU serial).  Starts empty
+ * if there isn't one, or it can't be read.
+ */
+bool SettingsCache::load(const QByteArray &boardId)
+{
+    clear();
+
+    path = Utils::PathUtils().GetStoragePath() + "settingscache/"
+        + boardId.toHex() + ".bin";
+
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, count;
+
+    in >> magic >> aggregateCRC >> count;
+
+    if (magic != FILE_MAGIC) {
+        clear();
+        return false;
+    }
+
+    for (quint32 i = 0; i < count; i++) {
+        quint32 objId;
+        quint16 instId;
+        Entry entry;
+
+        in >> objId >> instId >> entry.crc >> entry.data;
+
+        if (in.status() != QDataStream::Ok) {
+            qWarning() << "Settings cache" << path << "is damaged; ignoring it";
+            clear();
+            return false;
+        }
+
+        entries.insert(key(objId, instId), entry);
+    }
+
+    return true;
+}
+
+/**
+ * Write the cache back where it was loaded from.
+ */
+bool SettingsCache::save() const
+{
+    if (path.isEmpty()) {
+        return false;
+    }
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    /* Written aside and renamed, so a crash can't leave half a cache */
+    QSaveFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+
+    out << FILE_MAGIC << aggregateCRC << (quint32)entries.size();
+
+    for (auto i = entries.constBegin(); i != entries.constEnd(); ++i) {
+        out << (quint32)(i.key() >> 16) << (quint16)(i.key() & 0xffff)
+            << i.value().crc << i.value().data;
+    }
+
+    return file.commit();
+}
+
+void SettingsCache::clear()
+{
+    aggregateCRC = 0;
+    entries.clear();
+}
+
+/**
+ * The cached data of an instance, if it has the CRC the board reports now.
+ */
+const QByteArray *SettingsCache::find(quint32 objId, quint16 instId,
+        quint32 crc) const
+{
+    auto i = entries.constFind(key(objId, instId));
+
+    if ((i == entries.constEnd()) || (i.value().crc != crc)) {
+        return nullptr;
+    }
+
+    return &i.value().data;
+}
+
+void SettingsCache::insert(quint32 objId, quint16 instId, quint32 crc,
+        const QByteArray &data)
+{
+    Entry entry;
+    entry.crc = crc;
+    entry.data = data;
+
+    entries.insert(key(objId, instId), entry);
+}
+
+quint32 SettingsCache::crc32(const quint8 *data, int len)
+{
+    quint32 crc = 0;
+
+    for (int i = 0; i < len; i++) {
+        crc ^= (quint32)data[i] << 24;
+
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,82 @@
+/**
+ ******************************************************************************
+ *
+ * @file       settingscache.h
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ *
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief On-disk copy of a board's settings, so reconnects fetch only changes
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef SETTINGSCACHE_H
+#define SETTINGSCACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+
+/**
+ * The settings objects last seen on one board, each with the CRC the board
+ * reported for it.  Entries are only trusted when that CRC still matches.
+ */
+class SettingsCache
+{
+public:
+    SettingsCache();
+
+    bool load(const QByteArray &boardId);
+    bool save() const;
+    void clear();
+
+    quint32 getAggregateCRC() const { return aggregateCRC; }
+    void setAggregateCRC(quint32 crc) { aggregateCRC = crc; }
+
+    const QByteArray *find(quint32 objId, quint16 instId, quint32 crc) const;
+    void insert(quint32 objId, quint16 instId, quint32 crc,
+            const QByteArray &data);
+
+    /* The CRC the flight side uses, PIOS_CRC32_updateCRC() from 0 */
+    static quint32 crc32(const quint8 *data, int len);
+
+private:
+    struct Entry
+    {
+        quint32 crc;
+        QByteArray data;
+    };
+
+    static const quint32 FILE_MAGIC = 0x53434331; // "SCC1"
+
+    static quint64 key(quint32 objId, quint16 instId)
+    {
+        return ((quint64)objId << 16) | instId;
+    }
+
+    QString path;
+    quint32 aggregateCRC;
+    QHash<quint64, Entry> entries;
+};
+
+#endif // SETTINGSCACHE_H
+
+/**
+ * @}
+ * @}
+ */
@@ -40,6 +40,7 @@
 #include <QtGlobal>
 #include <stdlib.h>
 #include <QDebug>
+#include <memory>
 
 #ifdef TELEMETRY_DEBUG
 #define TELEMETRY_QXTLOG_DEBUG(...) qDebug() << (__VA_ARGS__)
@@ -495,6 +496,104 @@ QByteArray *Telemetry::downloadFile(quint32 fileId, quint32 maxSize,
     return result;
 }
 
+/* The asynchronous variant: returns at once, and later calls doneCb from
+ * the event loop with the file, or NULL if the transfer failed.  doneCb
+ * owns the result.  If the link goes away first, doneCb is never called.
+ */
+void Telemetry::downloadFileAsync(quint32 fileId, quint32 maxSize,
+        std::function<void(QByteArray *)>doneCb)
+{
+    struct Transfer {
+        QByteArray *result = new QByteArray();
+        quint32 curOffset = 0;
+        int inactivityCount = 0;
+        int failCount = 0;
+
+        ~Transfer() { delete result; }
+    };
+
+    auto xfer = std::make_shared<Transfer>();
+
+    QTimer *timeStep = new QTimer(this);
+
+    auto request = [this, xfer, fileId]() {
+        utalk->requestFile(fileId, xfer->curOffset);
+
+        xfer->inactivityCount = 0;
+    };
+
+    /* Deleting the timer drops the connections below, and with them the
+     * transfer state. */
+    auto finish = [xfer, timeStep, doneCb](bool ok) {
+        QByteArray *result = xfer->result;
+        xfer->result = NULL;
+
+        timeStep->stop();
+        timeStep->deleteLater();
+
+        if (!ok) {
+            qDebug() << "Aborting file transfer";
+            delete result;
+            result = NULL;
+        }
+
+        doneCb(result);
+    };
+
+    connect(timeStep, &QTimer::timeout, timeStep,
+            [xfer, request, finish]() {
+                if (!xfer->result) {
+                    return;
+                }
+
+                if ((xfer->inactivityCount++) > 10) {
+                    qDebug() << "Retrying file transfer because of inactivity";
+
+                    if ((++xfer->failCount) > 5) {
+                        finish(false);
+                    } else {
+                        request();
+                    }
+                }
+            }
+        );
+
+    connect(utalk, &UAVTalk::fileDataReceived, timeStep,
+            [xfer, fileId, maxSize, request, finish](quint32 recvFileId,
+                quint32 offset, quint8 *data, quint32 dataLen, bool eof,
+                bool lastInSeq) {
+                    if ((recvFileId != fileId) || (!xfer->result)) {
+                        return;
+                    }
+
+                    if (offset != xfer->curOffset) {
+                        if (lastInSeq) {
+                            request();
+                        }
+
+                        return;
+                    }
+
+                    xfer->result->append((const char *) data, dataLen);
+
+                    xfer->curOffset += dataLen;
+                    xfer->inactivityCount = 0;
+                    xfer->failCount = 0;
+
+                    if (eof || (xfer->curOffset >= maxSize)) {
+                        finish(true);
+                    } else if (lastInSeq) {
+                        request();
+                    }
+                }
+            );
+
+    timeStep->setSingleShot(false);
+    timeStep->start(150);
+
+    request();
+}
+
 /**
  * Start an object transaction with UAVTalk, all information is stored in transInfo.
  */
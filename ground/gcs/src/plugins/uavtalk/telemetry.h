@@ -86,6 +86,8 @@ public:
     TelemetryStats getStats();
     QByteArray *downloadFile(quint32 fileId, quint32 maxSize,
             std::function<void(quint32)>progressCb = nullptr);
+    void downloadFileAsync(quint32 fileId, quint32 maxSize,
+            std::function<void(QByteArray *)>doneCb);
 
     void transactionTimeout(ObjectTransactionInfo *info);
 
@@ -35,9 +35,21 @@
 #include "coreplugin/icore.h"
 #include "firmwareiapobj.h"
 
+#include <QPointer>
+#include <QtEndian>
+#include <functional>
+
 // Timeout for the object fetching phase, the system will stop fetching objects and emit connected
 // after this
 #define OBJECT_RETRIEVE_TIMEOUT 20000
+// Files of the board's object instances; UAVTALK_*_FILE_ID in
+// flight/Libraries/inc/uavtalk.h
+#define STATE_FILE_ID 0x101
+#define SETTINGS_CRC_FILE_ID 0x102
+#define DYNAMIC_STATE_FILE_ID 0x103
+#define STATE_FILE_MAX_SIZE (256 * 1024)
+// Each record in it: u32 object id, u16 instance id, u16 length, then data
+#define STATE_RECORD_HEADER_LEN 8
 // IAP object is very important, retry if not able to get it the first time
 #define IAP_OBJECT_RETRIES 3
 
@@ -99,6 +111,11 @@ TelemetryMonitor::TelemetryMonitor(UAVObjectManager *objMngr, Telemetry *tel)
     , tel(tel)
     , queue(decltype(queue)(queueCompare))
     , requestsInFlight(0)
+    , dumpGeneration(0)
+    , settingsAggregateCRC(0)
+    , haveSettingsCRCs(false)
+    , cachedObjects(0)
+    , requestedObjects(0)
 {
     this->connectionTimer = new QTime();
     // Get stats objects
@@ -145,7 +162,42 @@ TelemetryMonitor::~TelemetryMonitor()
 }
 
 /**
- * Initiate object retrieval, initialize queue with objects to be retrieved.
+ * Walk the records of a state file, calling cb with each.
+ * \return whether the file was whole: not empty, and no record cut short
+ */
+static bool parseStateFile(const QByteArray *file,
+        std::function<void(quint32, quint16, const quint8 *, quint16)> cb)
+{
+    if ((file == NULL) || file->isEmpty()) {
+        return false;
+    }
+
+    int pos = 0;
+
+    while (file->size() - pos >= STATE_RECORD_HEADER_LEN) {
+        const quint8 *rec = (const quint8 *) file->constData() + pos;
+
+        quint32 objId = qFromLittleEndian<quint32>(rec);
+        quint16 instId = qFromLittleEndian<quint16>(rec + 4);
+        quint16 length = qFromLittleEndian<quint16>(rec + 6);
+
+        if (file->size() - pos - STATE_RECORD_HEADER_LEN < length) {
+            return false;
+        }
+
+        pos += STATE_RECORD_HEADER_LEN + length;
+
+        cb(objId, instId, rec + STATE_RECORD_HEADER_LEN, length);
+    }
+
+    return (pos == file->size());
+}
+
+/**
+ * Initiate object retrieval.  Settings the board reports the same CRC for
+ * as the last time we saw it come from the settings cache; everything else
+ * comes in a state dump, and whatever that didn't cover is requested one
+ * object at a time.
  */
 void TelemetryMonitor::startRetrievingObjects()
 {
@@ -155,8 +207,281 @@ void TelemetryMonitor::startRetrievingObjects()
 
     /* Clear the queue */
     queue = decltype(queue)(queueCompare);
+    dumpedObjects.clear();
+    cachedObjects = 0;
+    requestedObjects = 0;
+    retrieveTime.start();
 
     objectRetrieveTimeout->start(OBJECT_RETRIEVE_TIMEOUT);
+
+    requestStateFile(SETTINGS_CRC_FILE_ID, &TelemetryMonitor::settingsCRCsReceived);
+}
+
+/**
+ * Download a state file, and hand it to handler if it's still wanted when
+ * it arrives.
+ */
+void TelemetryMonitor::requestStateFile(quint32 fileId,
+        void (TelemetryMonitor::*handler)(QByteArray *))
+{
+    /* A file from an earlier connection may still turn up; ignore it */
+    quint32 generation = ++dumpGeneration;
+    QPointer<TelemetryMonitor> self(this);
+
+    tel->downloadFileAsync(fileId, STATE_FILE_MAX_SIZE,
+            [self, generation, handler](QByteArray *file) {
+                if (self && (self->dumpGeneration == generation)
+                    && (self->connectionStatus == CON_RETRIEVING_OBJECTS)) {
+                    (self.data()->*handler)(file);
+                }
+
+                delete file;
+            }
+        );
+}
+
+/**
+ * Note the CRC of each settings instance on the board, then fetch the rest
+ * of the state.  Firmware without settings CRCs answers with an empty file;
+ * then all of it is fetched.
+ */
+void TelemetryMonitor::settingsCRCsReceived(QByteArray *file)
+{
+    bool haveAggregate = false;
+
+    settingsCRCs.clear();
+
+    bool complete = parseStateFile(file,
+            [&](quint32 objId, quint16 instId, const quint8 *data, quint16 length) {
+                if (length != sizeof(quint32)) {
+                    return;
+                }
+
+                quint32 crc = qFromLittleEndian<quint32>(data);
+
+                if (objId == 0) {
+                    settingsAggregateCRC = crc;
+                    haveAggregate = true;
+                } else {
+                    settingsCRCs.insert(((quint64)objId << 16) | instId, crc);
+                }
+            }
+        );
+
+    haveSettingsCRCs = complete && haveAggregate;
+
+    if (!haveSettingsCRCs) {
+        settingsCRCs.clear();
+    }
+
+    requestStateFile(haveSettingsCRCs ? DYNAMIC_STATE_FILE_ID : STATE_FILE_ID,
+            &TelemetryMonitor::stateDumpReceived);
+}
+
+/**
+ * Unpack the state dump into the objects.  Firmware without it answers
+ * with an empty file, and then every object is requested as before.
+ */
+void TelemetryMonitor::stateDumpReceived(QByteArray *dump)
+{
+    QHash<quint32, quint32> numInstances;
+
+    /* The settings left out of the dump are there if they have CRCs */
+    for (auto i = settingsCRCs.constBegin(); i != settingsCRCs.constEnd(); ++i) {
+        quint32 objId = i.key() >> 16;
+        quint32 instId = i.key() & 0xffff;
+
+        if (instId >= numInstances.value(objId)) {
+            numInstances[objId] = instId + 1;
+        }
+    }
+
+    bool complete = parseStateFile(dump,
+            [&](quint32 objId, quint16 instId, const quint8 *data, quint16 length) {
+                UAVObject *obj = getOrCreateInstance(objId, instId);
+
+                /* Not known here, or a different definition of the object;
+                 * leave it to be requested and fail the usual way */
+                if ((obj == nullptr) || (obj->getNumBytes() != length)) {
+                    return;
+                }
+
+                obj->unpack(data);
+                dumpedObjects.insert(obj);
+
+                UAVDataObject *dobj = dynamic_cast<UAVDataObject *>(obj);
+
+                if (dobj) {
+                    dobj->setReceived();
+
+                    if (instId >= numInstances.value(objId)) {
+                        numInstances[objId] = instId + 1;
+                    }
+                }
+            }
+        );
+
+    TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 state dump had %1 objects%2")
+                                      .arg(Q_FUNC_INFO)
+                                      .arg(dumpedObjects.size())
+                                      .arg(complete ? "" : ", incomplete"));
+
+    /* The board identifies itself in the dump, so only now can we tell
+     * which cache is its */
+    if (!complete) {
+        haveSettingsCRCs = false;
+    } else if (haveSettingsCRCs) {
+        restoreCachedSettings();
+    }
+
+    /* The dump has everything the board has, so anything missing from a
+     * whole one isn't there */
+    if (complete) {
+        foreach (UAVObjectManager::ObjectMap map, objMngr->getObjects().values()) {
+            UAVDataObject *dobj = dynamic_cast<UAVDataObject *>(map.first());
+
+            if (!dobj) {
+                continue;
+            }
+
+            quint32 objId = dobj->getObjID();
+            quint32 count = numInstances.value(objId);
+
+            if (!count) {
+                dobj->setIsPresentOnHardware(false);
+                continue;
+            }
+
+            for (quint32 idx = objMngr->getNumInstances(objId); idx > count; ) {
+                idx--;
+
+                UAVDataObject *dobjR = dynamic_cast<UAVDataObject *>(
+                        objMngr->getObject(objId, idx));
+
+                if (dobjR) {
+                    objMngr->unRegisterObject(dobjR);
+                }
+            }
+        }
+    }
+
+    retrieveRemainingObjects();
+}
+
+/**
+ * Find an object instance, creating it if it's one we haven't seen, like
+ * UAVTalk does when it receives one.
+ */
+UAVObject *TelemetryMonitor::getOrCreateInstance(quint32 objId, quint16 instId)
+{
+    UAVObject *obj = objMngr->getObject(objId, instId);
+
+    if (obj != nullptr) {
+        return obj;
+    }
+
+    UAVDataObject *tobj = dynamic_cast<UAVDataObject *>(objMngr->getObject(objId));
+
+    if (tobj == nullptr) {
+        return nullptr;
+    }
+
+    UAVDataObject *instObj = tobj->clone(instId);
+
+    if (!objMngr->registerObject(instObj)) {
+        return nullptr;
+    }
+
+    return instObj;
+}
+
+/**
+ * Fill in the settings whose CRC on the board matches the cached copy's.
+ */
+void TelemetryMonitor::restoreCachedSettings()
+{
+    FirmwareIAPObj::DataFields iapData = FirmwareIAPObj::GetInstance(objMngr)->getData();
+    QByteArray boardId;
+
+    for (unsigned int i = 0; i < FirmwareIAPObj::CPUSERIAL_NUMELEM; i++) {
+        boardId.append(iapData.CPUSerial[i]);
+    }
+
+    settingsCache.load(boardId);
+
+    for (auto i = settingsCRCs.constBegin(); i != settingsCRCs.constEnd(); ++i) {
+        quint32 objId = i.key() >> 16;
+        quint16 instId = i.key() & 0xffff;
+
+        const QByteArray *data = settingsCache.find(objId, instId, i.value());
+
+        if (data == nullptr) {
+            continue;
+        }
+
+        UAVObject *obj = getOrCreateInstance(objId, instId);
+
+        if ((obj == nullptr) || (obj->getNumBytes() != (quint32)data->size())) {
+            continue;
+        }
+
+        obj->unpack((const quint8 *) data->constData());
+        dumpedObjects.insert(obj);
+        cachedObjects++;
+
+        UAVDataObject *dobj = dynamic_cast<UAVDataObject *>(obj);
+
+        if (dobj) {
+            dobj->setReceived();
+        }
+    }
+}
+
+/**
+ * Once everything has been fetched, remember the board's settings for next
+ * time.  Each is only cached if it still has the CRC the board reported, so
+ * one that changed while we fetched it is fetched again next time.
+ */
+void TelemetryMonitor::updateSettingsCache()
+{
+    if (!haveSettingsCRCs || (settingsCache.getAggregateCRC() == settingsAggregateCRC)) {
+        return;
+    }
+
+    bool allCurrent = true;
+
+    for (auto i = settingsCRCs.constBegin(); i != settingsCRCs.constEnd(); ++i) {
+        UAVObject *obj = objMngr->getObject(i.key() >> 16, i.key() & 0xffff);
+
+        if (obj == nullptr) {
+            allCurrent = false;
+            continue;
+        }
+
+        QByteArray data(obj->getNumBytes(), 0);
+        obj->pack((quint8 *) data.data());
+
+        if (SettingsCache::crc32((const quint8 *) data.constData(), data.size())
+            != i.value()) {
+            allCurrent = false;
+            continue;
+        }
+
+        settingsCache.insert(obj->getObjID(), obj->getInstID(), i.value(), data);
+    }
+
+    settingsCache.setAggregateCRC(allCurrent ? settingsAggregateCRC : 0);
+
+    if (!settingsCache.save()) {
+        qWarning() << "Couldn't save the settings cache";
+    }
+}
+
+/**
+ * Queue every object, and request those the state dump didn't cover.
+ */
+void TelemetryMonitor::retrieveRemainingObjects()
+{
     foreach (UAVObjectManager::ObjectMap map, objMngr->getObjects().values()) {
         UAVObject *obj = map.first();
 
@@ -185,6 +510,13 @@ void TelemetryMonitor::retrieveNextObject()
                 .arg(Q_FUNC_INFO)
                 .arg(connectionStatus));
         connectionStatus = CON_CONNECTED_MANAGED;
+        updateSettingsCache();
+        qInfo() << QString("Retrieved objects in %1 ms: %2 from the state dump, "
+                           "%3 from the settings cache, %4 requested")
+                       .arg(retrieveTime.elapsed())
+                       .arg(dumpedObjects.size() - cachedObjects)
+                       .arg(cachedObjects)
+                       .arg(requestedObjects);
         emit connected();
         objectRetrieveTimeout->stop();
         return;
@@ -202,6 +534,11 @@ void TelemetryMonitor::retrieveNextObject()
         UAVObject *obj = queue.top();
         queue.pop();
 
+        if (dumpedObjects.contains(obj)) {
+            /* All of its instances came in the state dump or the cache */
+            continue;
+        }
+
         UAVDataObject *dobj = dynamic_cast<UAVDataObject *>(obj);
 
         if (dobj) {
@@ -239,6 +576,7 @@ void TelemetryMonitor::retrieveNextObject()
                                           .arg(obj->getInstID()));
 
         requestsInFlight++;
+        requestedObjects++;
 
         connect(obj, QOverload<UAVObject *, bool, bool>::of(&UAVObject::transactionCompleted), this,
                 &TelemetryMonitor::transactionCompleted);
@@ -37,7 +37,10 @@
 
 #include <queue>
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
+#include <QSet>
 #include <QTimer>
 #include <QTime>
 #include "uavobjects/uavobjectmanager.h"
@@ -45,6 +48,7 @@
 #include "flighttelemetrystats.h"
 #include "systemstats.h"
 #include "telemetry.h"
+#include "settingscache.h"
 #include <coreplugin/generalsettings.h>
 #include <extensionsystem/pluginmanager.h>
 
@@ -99,8 +103,25 @@ private:
     QTime *connectionTimer;
     QTimer *objectRetrieveTimeout;
     int requestsInFlight;
+    QSet<UAVObject *> dumpedObjects;
+    quint32 dumpGeneration;
+    QHash<quint64, quint32> settingsCRCs;
+    quint32 settingsAggregateCRC;
+    bool haveSettingsCRCs;
+    SettingsCache settingsCache;
+    int cachedObjects;
+    int requestedObjects;
+    QElapsedTimer retrieveTime;
 
     void startRetrievingObjects();
+    void requestStateFile(quint32 fileId,
+            void (TelemetryMonitor::*handler)(QByteArray *));
+    void settingsCRCsReceived(QByteArray *file);
+    void stateDumpReceived(QByteArray *dump);
+    UAVObject *getOrCreateInstance(quint32 objId, quint16 instId);
+    void restoreCachedSettings();
+    void updateSettingsCache();
+    void retrieveRemainingObjects();
     void retrieveNextObject();
 };
 
@@ -45,8 +45,6 @@
 #define UAVTALK_QXTLOG_DEBUG(...)
 #endif // UAVTALK_DEBUG
 
-#define SYNC_VAL 0x3C
-
 const quint8 UAVTalk::crc_table[256] = {
     0x00, 0x07, 0x0e, 0x09, 0x1c, 0x1b, 0x12, 0x15, 0x38, 0x3f, 0x36, 0x31, 0x24, 0x23, 0x2a, 0x2d,
     0x70, 0x77, 0x7e, 0x79, 0x6c, 0x6b, 0x62, 0x65, 0x48, 0x4f, 0x46, 0x41, 0x54, 0x53, 0x5a, 0x5d,
@@ -70,16 +68,22 @@ const quint8 UAVTalk::crc_table[256] = {
  * Constructor
  */
 UAVTalk::UAVTalk(QIODevice *iodev, UAVObjectManager *objMngr)
+    : decoder(new UAVTalkDecoder)
+    , coalesceUpdates(false)
+    , processingFrames(false)
 {
     io = iodev;
 
     this->objMngr = objMngr;
 
-    startOffset = 0;
-    filledBytes = 0;
-
     memset(&stats, 0, sizeof(ComStats));
 
+    decoder->moveToThread(&decoderThread);
+    connect(this, &UAVTalk::bytesReceived, decoder, &UAVTalkDecoder::processBytes);
+    connect(decoder, &UAVTalkDecoder::framesReady, this, &UAVTalk::processDecodedFrames);
+    decoderThread.setObjectName("UAVTalkDecoder");
+    decoderThread.start();
+
     connect(io.data(), &QIODevice::readyRead, this, &UAVTalk::processInputStream);
 }
 
@@ -88,6 +92,11 @@ UAVTalk::~UAVTalk()
     // According to Qt, it is not necessary to disconnect upon
     // object deletion.
     // disconnect(io, SIGNAL(readyRead()), this, SLOT(processInputStream()));
+
+    decoderThread.quit();
+    decoderThread.wait();
+
+    delete decoder;
 }
 
 /**
@@ -95,6 +104,8 @@ UAVTalk::~UAVTalk()
  */
 UAVTalk::ComStats UAVTalk::getStats()
 {
+    stats.rxErrors += decoder->takeErrors();
+
     UAVTalk::ComStats ret = stats;
 
     memset(&stats, 0, sizeof(ComStats));
@@ -103,33 +114,100 @@ UAVTalk::ComStats UAVTalk::getStats()
 }
 
 /**
- * Called each time there are data in the input buffer
+ * Called each time there are data in the input buffer.  The bytes are
+ * only read here; framing and CRC checks happen on the decoder thread.
  */
 void UAVTalk::processInputStream()
 {
     while (io && io->isReadable()) {
-        if (startOffset > (sizeof(rxBuffer) - MAX_PACKET_LENGTH)) {
-            /* If we're not sure there's room for a frame, shift things left in
-             * the buffer so that we can do a bigger read.
-             */
-            memmove(rxBuffer, rxBuffer + startOffset, filledBytes - startOffset);
-
-            filledBytes -= startOffset;
-            startOffset = 0;
+        QByteArray bytes = io->read(MAX_PACKET_LENGTH * 12);
+
+        if (bytes.isEmpty()) {
+            return;
         }
 
-        int bytes = io->read(reinterpret_cast<char *>(rxBuffer + filledBytes),
-                             sizeof(rxBuffer) - filledBytes);
+        stats.rxBytes += bytes.size();
 
-        if (bytes <= 0) {
-            return;
+        emit bytesReceived(bytes);
+    }
+}
+
+/**
+ * Applies the frames decoded so far to the objects, at most
+ * MAX_FRAMES_PER_BATCH at a time.  With coalescing enabled, only the newest
+ * update of each object instance within the batch is unpacked.
+ */
+void UAVTalk::processDecodedFrames()
+{
+    // A handler further down may spin the event loop; the outer call will
+    // take care of the remaining frames.
+    if (processingFrames) {
+        return;
+    }
+
+    processingFrames = true;
+
+    decoder->rearmNotify();
+
+    int count = qMin(decoder->framesAvailable(), MAX_FRAMES_PER_BATCH);
+
+    QVector<bool> superseded(count, false);
+
+    if (coalesceUpdates) {
+        QHash<quint64, int> newest;
+
+        for (int i = 0; i < count; i++) {
+            UAVTalkDecoder::Frame *frame = decoder->frameAt(i);
+
+            if (frame->type != TYPE_OBJ) {
+                continue;
+            }
+
+            quint64 key = frameKey(frame);
+
+            if (newest.contains(key)) {
+                superseded[newest.value(key)] = true;
+            }
+
+            newest.insert(key, i);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        UAVTalkDecoder::Frame *frame = decoder->frameAt(0);
+
+        if (superseded[i]) {
+            // Received and valid, just overwritten by a newer update
+            stats.rxObjectBytes += frame->length;
+            stats.rxObjects++;
+        } else {
+            processFrame(frame);
         }
 
-        filledBytes += bytes;
-        stats.rxBytes += bytes;
+        decoder->popFrame();
+    }
+
+    processingFrames = false;
+
+    if (decoder->framesAvailable() > 0) {
+        QMetaObject::invokeMethod(this, "processDecodedFrames", Qt::QueuedConnection);
+    }
+}
+
+/**
+ * Key identifying the object instance a frame refers to
+ */
+quint64 UAVTalk::frameKey(const UAVTalkDecoder::Frame *frame)
+{
+    quint64 key = static_cast<quint64>(frame->objId) << 16;
+
+    UAVObject *obj = objMngr->getObject(frame->objId);
 
-        while (processInput());
+    if (obj && !obj->isSingleInstance() && frame->length >= 2) {
+        key |= frame->data[0] | (frame->data[1] << 8);
     }
+
+    return key;
 }
 
 /**
@@ -206,80 +284,21 @@ bool UAVTalk::receiveFileChunk(quint32 fileId, quint8 *data, quint32 length)
 }
 
 /**
- * Process a frame from input, if available.
- * \return False if there was insufficient data for a frame, true if trying
- * again is worthwhile.
+ * Process a frame which passed the framing and CRC checks.
+ * \param frame the decoded frame
+ * \return True if the frame was handled successfully
  */
-bool UAVTalk::processInput()
+bool UAVTalk::processFrame(UAVTalkDecoder::Frame *frame)
 {
-    unsigned int bytesAvail = filledBytes - startOffset;
-
-    if (bytesAvail < sizeof(UAVTalkHeader)) {
-        return false;
-    }
-
-    UAVTalkHeader *hdr = reinterpret_cast<UAVTalkHeader *>(rxBuffer + startOffset);
-
-    /* Basic framing checks.  If these fail, skip forward one byte and retry
-     * to capture stream sync.
-     */
-    if (hdr->sync != SYNC_VAL) {
-        startOffset++;
-        stats.rxErrors++;
-
-        return true;
-    }
-
-    if ((hdr->type & VER_MASK) != TYPE_VER) {
-        startOffset++;
-        stats.rxErrors++;
-
-        return true;
-    }
-
-    if (hdr->size < sizeof(UAVTalkHeader)) {
-        startOffset++;
-        stats.rxErrors++;
-
-        return true;
-    }
-
-    /* OK, let's ensure we have enough bytes for the whole frame.
-     * Size doesn't include CRC, so add one.
-     */
-
-    if ((hdr->size + 1u) > bytesAvail) {
-        return false;
-    }
-
-    quint8 ourCrc = updateCRC(0, rxBuffer + startOffset, hdr->size);
-    quint8 *theirCrc = rxBuffer + startOffset + hdr->size;
-
-    if (ourCrc != *theirCrc) {
-        /* Since we can't trust hdr->size for sure, we should just skip
-         * forward one byte.
-         */
-
-        startOffset++;
-        stats.rxErrors++;
-
-        return true;
-    }
-
-    quint8 *payload = rxBuffer + startOffset + sizeof(*hdr);
-    unsigned int payloadBytes = hdr->size - sizeof(*hdr);
-
-    /* At this point, we'll advance startOffset for the entire length of
-     * frame, and not touch startOffset again this function!
-     */
-    startOffset += hdr->size + 1;
+    quint8 *payload = frame->data;
+    unsigned int payloadBytes = frame->length;
 
     /* OK, we have a complete frame as encoded on the wire.  Time to do things
      * with it.
      */
-    quint8 rxType = hdr->type & TYPE_MASK;
+    quint8 rxType = frame->type;
 
-    quint32 rxObjId = qFromLittleEndian(hdr->objId);
+    quint32 rxObjId = frame->objId;
 
     if (rxType == TYPE_FILEDATA) {
         return receiveFileChunk(rxObjId, payload, payloadBytes);
@@ -41,6 +41,7 @@
 #include <QSemaphore>
 #include "uavobjects/uavobjectmanager.h"
 #include "uavtalk_global.h"
+#include "uavtalkdecoder.h"
 #include <QtNetwork/QUdpSocket>
 
 class UAVTALK_EXPORT UAVTalk : public QObject
@@ -68,7 +69,7 @@ public:
 
     ComStats getStats();
 
-    bool processInput();
+    void setCoalesceUpdates(bool coalesce) { coalesceUpdates = coalesce; }
 
 signals:
     // The only signals we send to the upper level are when we
@@ -80,11 +81,16 @@ signals:
     void fileDataReceived(quint32 fileId, quint32 offset, quint8 *data,
             quint32 dataLen, bool eof, bool lastInSeq);
 
+    // Hands the raw link bytes to the decoder thread
+    void bytesReceived(const QByteArray &bytes);
+
 private slots:
     void processInputStream(void);
+    void processDecodedFrames(void);
 
 protected:
     // Constants
+    static const quint8 SYNC_VAL = 0x3C;
     static const int VER_MASK = 0x70;
     static const int TYPE_MASK = 0x0f;
 
@@ -110,6 +116,11 @@ protected:
     static const quint16 OBJID_NOTFOUND = 0x0000;
 
     static const int TX_BACKLOG_SIZE = 2 * 1024;
+
+    // Maximum frames applied per event loop iteration, so a backlog of
+    // decoded frames can't starve the GUI
+    static const int MAX_FRAMES_PER_BATCH = 512;
+
     static const quint8 crc_table[256];
 
 #pragma pack(push)
@@ -135,19 +146,20 @@ protected:
     QPointer<QIODevice> io;
     UAVObjectManager *objMngr;
 
-    // This is a tradeoff between the frequency of the need to
-    // compact/copy left and buffer size.
-    quint8 rxBuffer[MAX_PACKET_LENGTH * 12];
     quint8 txBuffer[MAX_PACKET_LENGTH];
 
-    // Variables used by the receive state machine
-
-    quint32 startOffset;
-    quint32 filledBytes;
+    // Framing and CRC checks run on decoderThread; decoded frames are
+    // applied to the objects on our thread in batches
+    QThread decoderThread;
+    UAVTalkDecoder *decoder;
+    bool coalesceUpdates;
+    bool processingFrames;
 
     ComStats stats;
 
     // Methods
+    bool processFrame(UAVTalkDecoder::Frame *frame);
+    quint64 frameKey(const UAVTalkDecoder::Frame *frame);
     bool objectTransaction(UAVObject *obj, quint8 type, bool allInstances);
     bool receiveObject(quint8 type, quint32 objId, quint16 instId,
             quint8 *data, quint32 length);
@@ -156,8 +168,10 @@ protected:
     bool transmitNack(quint32 objId);
     bool transmitObject(UAVObject *obj, quint8 type, bool allInstances);
     bool transmitSingleObject(UAVObject *obj, quint8 type, bool allInstances);
-    quint8 updateCRC(quint8 crc, const quint8 *data, qint32 length);
+    static quint8 updateCRC(quint8 crc, const quint8 *data, qint32 length);
     bool transmitFrame(quint32 length, bool incrTxObj = true);
+
+    friend class UAVTalkDecoder;
 };
 
 #endif // UAVTALK_H
@@ -12,16 +12,24 @@ include(../../plugins/coreplugin/coreplugin.pri)
 include(../../plugins/uavobjects/uavobjects.pri)
 
 HEADERS += uavtalk.h \
+    uavtalkdecoder.h \
     uavtalkplugin.h \
     telemetrymonitor.h \
     telemetrymanager.h \
     uavtalk_global.h \
-    telemetry.h
+    telemetry.h \
+    settingscache.h
 
 SOURCES += uavtalk.cpp \
+    uavtalkdecoder.cpp \
     uavtalkplugin.cpp \
     telemetrymonitor.cpp \
     telemetrymanager.cpp \
-    telemetry.cpp
+    telemetry.cpp \
+    settingscache.cpp
+
+contains(DEFINES, WITH_TESTS) {
+    SOURCES += uavtalktests.cpp
+}
 
 OTHER_FILES += UAVTalk.pluginspec
@@ -0,0 +1,168 @@
+/**
+ ******************************************************************************
+ * @file       uavtalkdecoder.cpp
+ *
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2016
+ *
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Framing and CRC checking of the UAVTalk stream, run off the GUI
+ * thread
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * Additional note on redistribution: The copyright and license notices above
+ * must be maintained in each individual source file that is a derivative work
+ * of this source file; otherwise redistribution is prohibited.
+ */
+
+#include "uavtalkdecoder.h"
+#include "uavtalk.h"
+#include <QThread>
+#include <QtEndian>
+
+UAVTalkDecoder::UAVTalkDecoder(QObject *parent)
+    : QObject(parent)
+    , startOffset(0)
+    , filledBytes(0)
+    , rxErrors(0)
+    , notifyPending(0)
+{
+    clock.start();
+}
+
+/**
+ * Called (on the decoder thread) with each chunk read from the link.
+ * Complete frames are pushed to the frame ring; partial frames are kept
+ * until the rest of their bytes arrive.
+ */
+void UAVTalkDecoder::processBytes(const QByteArray &bytes)
+{
+    const char *src = bytes.constData();
+    int remaining = bytes.size();
+
+    while (remaining > 0) {
+        if (startOffset > (sizeof(rxBuffer) - UAVTalk::MAX_PACKET_LENGTH)
+            || (filledBytes == sizeof(rxBuffer))) {
+            /* Shift things left in the buffer so that there is room for a
+             * full frame.
+             */
+            memmove(rxBuffer, rxBuffer + startOffset, filledBytes - startOffset);
+
+            filledBytes -= startOffset;
+            startOffset = 0;
+        }
+
+        int chunk = qMin<int>(remaining, sizeof(rxBuffer) - filledBytes);
+        memcpy(rxBuffer + filledBytes, src, chunk);
+        filledBytes += chunk;
+        src += chunk;
+        remaining -= chunk;
+
+        while (decodeFrame())
+            ;
+    }
+
+    notifyConsumer();
+}
+
+/**
+ * Lets the GUI thread know there are frames to apply.  Only one notification
+ * is in flight at a time so a burst of packets costs a single queued event.
+ */
+void UAVTalkDecoder::notifyConsumer()
+{
+    if (frames.count() > 0 && notifyPending.testAndSetOrdered(0, 1)) {
+        emit framesReady();
+    }
+}
+
+/**
+ * Decode a frame from rxBuffer, if available.
+ * \return False if there was insufficient data for a frame, true if trying
+ * again is worthwhile.
+ */
+bool UAVTalkDecoder::decodeFrame()
+{
+    unsigned int bytesAvail = filledBytes - startOffset;
+
+    if (bytesAvail < sizeof(UAVTalk::UAVTalkHeader)) {
+        return false;
+    }
+
+    UAVTalk::UAVTalkHeader *hdr =
+        reinterpret_cast<UAVTalk::UAVTalkHeader *>(rxBuffer + startOffset);
+
+    /* Basic framing checks.  If these fail, skip forward one byte and retry
+     * to capture stream sync.
+     */
+    if ((hdr->sync != UAVTalk::SYNC_VAL) || ((hdr->type & UAVTalk::VER_MASK) != UAVTalk::TYPE_VER)
+        || (hdr->size < sizeof(UAVTalk::UAVTalkHeader))) {
+        startOffset++;
+        rxErrors.ref();
+
+        return true;
+    }
+
+    /* OK, let's ensure we have enough bytes for the whole frame.
+     * Size doesn't include CRC, so add one.
+     */
+    if ((hdr->size + 1u) > bytesAvail) {
+        return false;
+    }
+
+    quint8 ourCrc = UAVTalk::updateCRC(0, rxBuffer + startOffset, hdr->size);
+    quint8 theirCrc = rxBuffer[startOffset + hdr->size];
+
+    if (ourCrc != theirCrc) {
+        /* Since we can't trust hdr->size for sure, we should just skip
+         * forward one byte.
+         */
+        startOffset++;
+        rxErrors.ref();
+
+        return true;
+    }
+
+    Frame *frame = frames.beginPush();
+
+    while (frame == nullptr) {
+        /* The GUI thread is behind.  Make sure it knows there is work and
+         * hold off; new link data queues up as events on our thread.
+         */
+        notifyConsumer();
+        QThread::usleep(200);
+        frame = frames.beginPush();
+    }
+
+    frame->timestamp = clock.nsecsElapsed();
+    frame->objId = qFromLittleEndian(hdr->objId);
+    frame->type = hdr->type & UAVTalk::TYPE_MASK;
+    frame->length = hdr->size - sizeof(*hdr);
+    memcpy(frame->data, rxBuffer + startOffset + sizeof(*hdr), frame->length);
+
+    frames.endPush();
+
+    startOffset += hdr->size + 1;
+
+    return true;
+}
+
+/**
+ * @}
+ * @}
+ */
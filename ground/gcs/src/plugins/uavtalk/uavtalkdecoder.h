@@ -0,0 +1,146 @@
+/**
+ ******************************************************************************
+ * @file       uavtalkdecoder.h
+ *
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2016
+ *
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Framing and CRC checking of the UAVTalk stream, run off the GUI
+ * thread
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * Additional note on redistribution: The copyright and license notices above
+ * must be maintained in each individual source file that is a derivative work
+ * of this source file; otherwise redistribution is prohibited.
+ */
+
+#ifndef UAVTALKDECODER_H
+#define UAVTALKDECODER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include "uavtalk_global.h"
+
+/**
+ * Single producer, single consumer ring of fixed size items. The producer
+ * only ever writes head and the consumer only ever writes tail, so no lock
+ * is needed.
+ */
+template <typename T, int N>
+class UAVTalkRing
+{
+    Q_STATIC_ASSERT((N & (N - 1)) == 0);
+
+public:
+    UAVTalkRing()
+        : head(0)
+        , tail(0)
+    {
+    }
+
+    //! Producer side: returns a slot to fill, or NULL if the ring is full
+    T *beginPush()
+    {
+        int h = head.load();
+        if (h - tail.loadAcquire() >= N)
+            return nullptr;
+        return &items[h & (N - 1)];
+    }
+
+    //! Producer side: publishes the slot returned by beginPush()
+    void endPush() { head.storeRelease(head.load() + 1); }
+
+    //! Consumer side: number of items ready to be read
+    int count() { return head.loadAcquire() - tail.load(); }
+
+    //! Consumer side: returns the i-th oldest item, i must be below count()
+    T *at(int i) { return &items[(tail.load() + i) & (N - 1)]; }
+
+    //! Consumer side: releases the oldest item
+    void pop() { tail.storeRelease(tail.load() + 1); }
+
+private:
+    QAtomicInt head;
+    QAtomicInt tail;
+    T items[N];
+};
+
+class UAVTALK_EXPORT UAVTalkDecoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int MAX_FRAME_PAYLOAD = 256;
+
+    //! A frame which passed the sync, header and CRC checks
+    struct Frame
+    {
+        qint64 timestamp; //!< Receive time, ns since the decoder was created
+        quint32 objId;
+        quint8 type; //!< Message type, version bits masked off
+        quint8 length; //!< Payload bytes in data, instance id included
+        quint8 data[MAX_FRAME_PAYLOAD];
+    };
+
+    explicit UAVTalkDecoder(QObject *parent = nullptr);
+
+    //! Consumer side: number of decoded frames waiting
+    int framesAvailable() { return frames.count(); }
+    //! Consumer side: i-th oldest decoded frame
+    Frame *frameAt(int i) { return frames.at(i); }
+    //! Consumer side: releases the oldest decoded frame
+    void popFrame() { frames.pop(); }
+
+    quint32 takeErrors() { return rxErrors.fetchAndStoreRelaxed(0); }
+
+    //! Consumer side: must be called before draining so no wakeup is lost
+    void rearmNotify() { notifyPending.storeRelease(0); }
+
+public slots:
+    void processBytes(const QByteArray &bytes);
+
+signals:
+    //! Emitted when frames become available; re-armed by rearmNotify()
+    void framesReady();
+
+private:
+    static const int RX_BUFFER_SIZE = 256 * 12;
+    static const int FRAME_QUEUE_DEPTH = 1024;
+
+    bool decodeFrame();
+    void notifyConsumer();
+
+    quint8 rxBuffer[RX_BUFFER_SIZE];
+    quint32 startOffset;
+    quint32 filledBytes;
+
+    QElapsedTimer clock;
+    QAtomicInt rxErrors;
+    QAtomicInt notifyPending;
+    UAVTalkRing<Frame, FRAME_QUEUE_DEPTH> frames;
+};
+
+#endif // UAVTALKDECODER_H
+
+/**
+ * @}
+ * @}
+ */
@@ -52,6 +52,15 @@ protected slots:
     void onDeviceConnect(QIODevice *dev);
     void onDeviceDisconnect();
 
+#ifdef WITH_TESTS
+private Q_SLOTS:
+    void benchmarkDecodeThroughput();
+    void benchmarkDecodeThroughput_data();
+    void benchmarkDecoder();
+    void benchmarkLogReplay();
+    void benchmarkLogReplay_data();
+#endif
+
 private:
     UAVObjectManager *objMngr;
     TelemetryManager *telMngr;
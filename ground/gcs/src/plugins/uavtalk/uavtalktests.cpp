@@ -0,0 +1,273 @@
+/**
+ ******************************************************************************
+ * @file       uavtalktests.cpp
+ * @author     dRonin, http://dRonin.org/, Copyright (C) 2017
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief The UAVTalk protocol plugin
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ *
+ * Additional note on redistribution: The copyright and license notices above
+ * must be maintained in each individual source file that is a derivative work
+ * of this source file; otherwise redistribution is prohibited.
+ */
+
+#include "uavtalkplugin.h"
+#include "uavtalkdecoder.h"
+
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QTest>
+#include <QVector>
+#include <QtEndian>
+
+// One second worth of a 20k packets/s link
+static const int NUM_PACKETS = 20000;
+
+static quint8 crc8(const QByteArray &data)
+{
+    quint8 crc = 0;
+
+    for (char c : data) {
+        crc ^= static_cast<quint8>(c);
+        for (int i = 0; i < 8; i++)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+    }
+
+    return crc;
+}
+
+/**
+ * A plain update frame of a single instance object, checksum included.
+ * Empty if the object can't be packed.
+ */
+static QByteArray objectFrame(UAVObject *obj)
+{
+    QByteArray frame(8 + obj->getNumBytes(), 0);
+    frame[0] = 0x3C;
+    frame[1] = 0x20;
+    frame[2] = frame.size();
+    qToLittleEndian<quint32>(obj->getObjID(), reinterpret_cast<uchar *>(frame.data()) + 4);
+    if (!obj->pack(reinterpret_cast<quint8 *>(frame.data()) + 8))
+        return QByteArray();
+    frame.append(crc8(frame));
+
+    return frame;
+}
+
+void UAVTalkPlugin::benchmarkDecodeThroughput_data()
+{
+    QTest::addColumn<bool>("coalesce");
+
+    QTest::newRow("every update") << false;
+    QTest::newRow("coalesced") << true;
+}
+
+/**
+ * Feeds a synthetic stream of AttitudeActual updates through UAVTalk and
+ * reports how quickly they are decoded and applied.
+ */
+void UAVTalkPlugin::benchmarkDecodeThroughput()
+{
+    QFETCH(bool, coalesce);
+
+    UAVObject *obj = objMngr->getObject(QStringLiteral("AttitudeActual"));
+    QVERIFY(obj != nullptr);
+    QVERIFY(obj->isSingleInstance());
+
+    QByteArray frame = objectFrame(obj);
+    QVERIFY(!frame.isEmpty());
+
+    QByteArray stream;
+    stream.reserve(frame.size() * NUM_PACKETS);
+    for (int i = 0; i < NUM_PACKETS; i++)
+        stream.append(frame);
+
+    QBuffer link(&stream);
+    QVERIFY(link.open(QIODevice::ReadOnly));
+
+    UAVTalk talk(&link, objMngr);
+    talk.setCoalesceUpdates(coalesce);
+
+    int unpacked = 0;
+    QMetaObject::Connection conn =
+        connect(obj, &UAVObject::objectUnpacked, [&unpacked]() { unpacked++; });
+
+    QElapsedTimer timer;
+    timer.start();
+
+    emit link.readyRead();
+
+    quint32 received = 0;
+    while (received < NUM_PACKETS && timer.elapsed() < 10000) {
+        QCoreApplication::processEvents();
+        received += talk.getStats().rxObjects;
+    }
+
+    qint64 elapsedNs = timer.nsecsElapsed();
+    disconnect(conn);
+
+    QCOMPARE(received, static_cast<quint32>(NUM_PACKETS));
+
+    if (coalesce)
+        QVERIFY(unpacked <= NUM_PACKETS);
+    else
+        QCOMPARE(unpacked, NUM_PACKETS);
+
+    qDebug() << "UAVTalk decode:" << NUM_PACKETS << "packets in" << elapsedNs / 1000000.0 << "ms,"
+             << NUM_PACKETS * 1e9 / elapsedNs << "packets/s," << unpacked << "unpacks";
+}
+
+/**
+ * Times the decoder thread's share of the work, framing and CRC checks, and
+ * the GUI thread's share of taking the decoded frames off the ring.  Both run
+ * here on one thread, so neither includes any hand over between threads.
+ */
+void UAVTalkPlugin::benchmarkDecoder()
+{
+    UAVObject *obj = objMngr->getObject(QStringLiteral("AttitudeActual"));
+    QVERIFY(obj != nullptr);
+
+    QByteArray frame = objectFrame(obj);
+    QVERIFY(!frame.isEmpty());
+
+    // Link reads of 4 kB
+    QVector<QByteArray> chunks;
+    QByteArray stream;
+    for (int i = 0; i < NUM_PACKETS; i++)
+        stream.append(frame);
+    for (int i = 0; i < stream.size(); i += 4096)
+        chunks.append(stream.mid(i, 4096));
+
+    UAVTalkDecoder decoder;
+    int decoded = 0;
+    qint64 decodeNs = 0;
+    qint64 drainNs = 0;
+    QElapsedTimer timer;
+
+    for (const QByteArray &chunk : chunks) {
+        timer.start();
+        decoder.processBytes(chunk);
+        decodeNs += timer.nsecsElapsed();
+
+        timer.start();
+        decoder.rearmNotify();
+        for (int n = decoder.framesAvailable(); n > 0; n--) {
+            decoded += decoder.frameAt(0)->objId == obj->getObjID();
+            decoder.popFrame();
+        }
+        drainNs += timer.nsecsElapsed();
+    }
+
+    QCOMPARE(decoded, NUM_PACKETS);
+    QCOMPARE(decoder.takeErrors(), 0u);
+
+    qDebug() << "UAVTalk decoder:" << frame.size() << "byte frames," << decodeNs / double(decoded)
+             << "ns/frame to decode," << drainNs / double(decoded) << "ns/frame to drain,"
+             << decoded * 1e9 / decodeNs << "frames/s";
+}
+
+void UAVTalkPlugin::benchmarkLogReplay_data()
+{
+    QTest::addColumn<bool>("generated");
+
+    QTest::newRow("generic fields") << false;
+    QTest::newRow("generated") << true;
+}
+
+/**
+ * Replays a synthetic log holding every data object through UAVTalk, with
+ * either the generic per-field unpacking or the generated per-object code.
+ */
+void UAVTalkPlugin::benchmarkLogReplay()
+{
+    QFETCH(bool, generated);
+
+    QByteArray log;
+    int numFrames = 0;
+
+    for (const QVector<UAVDataObject *> &instances : objMngr->getDataObjectsVector()) {
+        UAVDataObject *obj = instances.first();
+        const int headerLength = obj->isSingleInstance() ? 8 : 10;
+
+        // Whole packet, checksum included, must fit in 256 bytes
+        if (headerLength + obj->getNumBytes() + 1 > 256)
+            continue;
+
+        QByteArray frame(headerLength + obj->getNumBytes(), 0);
+        frame[0] = 0x3C;
+        frame[1] = 0x20;
+        qToLittleEndian<quint16>(frame.size(), reinterpret_cast<uchar *>(frame.data()) + 2);
+        qToLittleEndian<quint32>(obj->getObjID(), reinterpret_cast<uchar *>(frame.data()) + 4);
+
+        quint8 *payload = reinterpret_cast<quint8 *>(frame.data()) + headerLength;
+
+        // Both paths must agree on the wire format
+        QByteArray generic(obj->getNumBytes(), 0);
+        UAVObject::setGeneratedPacking(false);
+        obj->pack(reinterpret_cast<quint8 *>(generic.data()));
+        UAVObject::setGeneratedPacking(true);
+        obj->pack(payload);
+        QCOMPARE(frame.mid(headerLength), generic);
+
+        frame.append(crc8(frame));
+        log.append(frame);
+        numFrames++;
+    }
+
+    QVERIFY(numFrames > 0);
+
+    const int repeats = (NUM_PACKETS + numFrames - 1) / numFrames;
+    const int numPackets = repeats * numFrames;
+
+    QByteArray stream;
+    stream.reserve(log.size() * repeats);
+    for (int i = 0; i < repeats; i++)
+        stream.append(log);
+
+    QBuffer link(&stream);
+    QVERIFY(link.open(QIODevice::ReadOnly));
+
+    UAVTalk talk(&link, objMngr);
+    UAVObject::setGeneratedPacking(generated);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    emit link.readyRead();
+
+    quint32 received = 0;
+    while (received < static_cast<quint32>(numPackets) && timer.elapsed() < 10000) {
+        QCoreApplication::processEvents();
+        received += talk.getStats().rxObjects;
+    }
+
+    qint64 elapsedNs = timer.nsecsElapsed();
+    UAVObject::setGeneratedPacking(true);
+
+    QCOMPARE(received, static_cast<quint32>(numPackets));
+
+    qDebug() << "UAVTalk log replay (" << (generated ? "generated" : "generic") << "):"
+             << numPackets << "packets," << stream.size() << "bytes in" << elapsedNs / 1000000.0
+             << "ms," << numPackets * 1e9 / elapsedNs << "packets/s";
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -502,6 +502,47 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
 
     outCode.replace(QString("$(INITFIELDS)"), initfields);
 
+    // Replace the $(PACKFIELDS) and $(UNPACKFIELDS) tags, used on hosts
+    // where a copy of the whole structure would not give the wire format.
+    // Fields are laid out back to back in the same order on the wire.
+    QString packfields;
+    QString unpackfields;
+    int offset = 0;
+
+    for (int n = 0; n < info->fields.length(); ++n)
+    {
+        FieldInfo *field = info->fields[n];
+        int size = field->numBytes;
+        int length = size * field->numElements;
+
+        if (size == 1) {
+            packfields.append( QString("    memcpy(&dataOut[%1], &src[%1], %2);\n")
+                               .arg(offset).arg(length) );
+            unpackfields.append( QString("    memcpy(&dst[%1], &dataIn[%1], %2);\n")
+                                 .arg(offset).arg(length) );
+        } else {
+            QString wordType = (size == 2) ? "quint16" : "quint32";
+
+            for (int idx = 0; idx < field->numElements; ++idx) {
+                int pos = offset + size * idx;
+
+                packfields.append( QString("    memcpy(&%1, &src[%2], %3);\n"
+                                           "    qToLittleEndian<%4>(%1, &dataOut[%2]);\n")
+                                   .arg(size == 2 ? "word16" : "word32")
+                                   .arg(pos).arg(size).arg(wordType) );
+                unpackfields.append( QString("    %1 = qFromLittleEndian<%4>(&dataIn[%2]);\n"
+                                             "    memcpy(&dst[%2], &%1, %3);\n")
+                                     .arg(size == 2 ? "word16" : "word32")
+                                     .arg(pos).arg(size).arg(wordType) );
+            }
+        }
+
+        offset += length;
+    }
+
+    outCode.replace(QString("$(PACKFIELDS)"), packfields);
+    outCode.replace(QString("$(UNPACKFIELDS)"), unpackfields);
+
     // Write the GCS code
     bool res = writeFileIfDiffrent( gcsOutputPath.absolutePath() + "/" + info->namelc + ".cpp", outCode );
     if (!res) {
@@ -0,0 +1,896 @@
+/*
+ * Native columnar decoder for UAVTalk logs.
+ *
+ * Copyright (C) 2017 dRonin, http://dronin.org
+ *
+ * Licensed under the GNU LGPL version 2.1 or any later version (see
+ * COPYING.LESSER)
+ *
+ * This walks a log exactly like uavtalk.process_stream() does, but instead of
+ * building a namedtuple per packet it writes every field element of every
+ * object straight into its own contiguous numpy column.  Object layouts come
+ * from the UAVO classes (and therefore from the same XML definitions); see
+ * logdecode.py for the python side.
+ *
+ * Decoding happens in two passes over the buffer.  The first pass only frames
+ * packets and counts instances of each object, which is cheap, and notes the
+ * parser state every so often.  The columns are then allocated at their final
+ * size and the second pass fills them, each thread starting from one of the
+ * noted states and writing at the row offsets counted up to it.  No
+ * intermediate copies are made, so memory is just the output columns.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include "numpy/arrayobject.h"
+
+#define SYNC_VAL            0x3C
+#define TYPE_MASK           0x70
+#define TYPE_VER            0x20
+#define TYPE_OBJ            0x00
+#define TYPE_OBJ_ACK        0x02
+#define TYPE_OBJ_REQ        0x01
+#define TYPE_ACK            0x03
+#define TYPE_NACK           0x04
+#define TIMESTAMPED         0x80
+
+#define HEADER_LENGTH       8
+#define LOGHEADER_LENGTH    12
+#define MIN_HEADER_LENGTH   8
+#define MAX_HEADER_LENGTH   12
+#define MAX_PAYLOAD_LENGTH  (256 - 12)
+
+//! Don't bother splitting up logs smaller than this
+#define MIN_CHUNK_BYTES     (1 << 20)
+#define MAX_THREADS         16
+
+struct field_layout {
+	int offset;		//!< Of the first element, within the object data
+	int size;		//!< Of one element
+	int elements;
+	int type_num;		//!< numpy type of the column
+};
+
+struct obj_layout {
+	uint32_t id;
+	bool single;
+	int data_len;		//!< Including the instance id if multi-instance
+	int num_fields;
+	struct field_layout *fields;
+
+	/* Output, valid once the columns are allocated */
+	npy_intp count;
+	double *time;
+	uint16_t *inst_id;
+	char **columns;		//!< num_fields column bases
+};
+
+struct walk_state {
+	Py_ssize_t pos;
+	uint32_t timestamp_base;
+	uint16_t last_timestamp;
+};
+
+//! Where a chunk begins, and how many rows of each object precede it
+struct checkpoint {
+	struct walk_state state;
+	npy_intp *rows;
+};
+
+struct decoder {
+	const uint8_t *buf;
+	Py_ssize_t len;
+	bool gcs_timestamps;
+
+	int num_objs;
+	struct obj_layout *objs;
+
+	/* Open addressed object id -> layout index */
+	uint32_t hash_mask;
+	int *hash;
+
+	int num_chunks;
+	struct checkpoint *chunks;
+};
+
+static const uint8_t crc_table[256] = {
+	0x00, 0x07, 0x0e, 0x09, 0x1c, 0x1b, 0x12, 0x15, 0x38, 0x3f, 0x36, 0x31, 0x24, 0x23, 0x2a, 0x2d,
+	0x70, 0x77, 0x7e, 0x79, 0x6c, 0x6b, 0x62, 0x65, 0x48, 0x4f, 0x46, 0x41, 0x54, 0x53, 0x5a, 0x5d,
+	0xe0, 0xe7, 0xee, 0xe9, 0xfc, 0xfb, 0xf2, 0xf5, 0xd8, 0xdf, 0xd6, 0xd1, 0xc4, 0xc3, 0xca, 0xcd,
+	0x90, 0x97, 0x9e, 0x99, 0x8c, 0x8b, 0x82, 0x85, 0xa8, 0xaf, 0xa6, 0xa1, 0xb4, 0xb3, 0xba, 0xbd,
+	0xc7, 0xc0, 0xc9, 0xce, 0xdb, 0xdc, 0xd5, 0xd2, 0xff, 0xf8, 0xf1, 0xf6, 0xe3, 0xe4, 0xed, 0xea,
+	0xb7, 0xb0, 0xb9, 0xbe, 0xab, 0xac, 0xa5, 0xa2, 0x8f, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9d, 0x9a,
+	0x27, 0x20, 0x29, 0x2e, 0x3b, 0x3c, 0x35, 0x32, 0x1f, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0d, 0x0a,
+	0x57, 0x50, 0x59, 0x5e, 0x4b, 0x4c, 0x45, 0x42, 0x6f, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7d, 0x7a,
+	0x89, 0x8e, 0x87, 0x80, 0x95, 0x92, 0x9b, 0x9c, 0xb1, 0xb6, 0xbf, 0xb8, 0xad, 0xaa, 0xa3, 0xa4,
+	0xf9, 0xfe, 0xf7, 0xf0, 0xe5, 0xe2, 0xeb, 0xec, 0xc1, 0xc6, 0xcf, 0xc8, 0xdd, 0xda, 0xd3, 0xd4,
+	0x69, 0x6e, 0x67, 0x60, 0x75, 0x72, 0x7b, 0x7c, 0x51, 0x56, 0x5f, 0x58, 0x4d, 0x4a, 0x43, 0x44,
+	0x19, 0x1e, 0x17, 0x10, 0x05, 0x02, 0x0b, 0x0c, 0x21, 0x26, 0x2f, 0x28, 0x3d, 0x3a, 0x33, 0x34,
+	0x4e, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5c, 0x5b, 0x76, 0x71, 0x78, 0x7f, 0x6a, 0x6d, 0x64, 0x63,
+	0x3e, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2c, 0x2b, 0x06, 0x01, 0x08, 0x0f, 0x1a, 0x1d, 0x14, 0x13,
+	0xae, 0xa9, 0xa0, 0xa7, 0xb2, 0xb5, 0xbc, 0xbb, 0x96, 0x91, 0x98, 0x9f, 0x8a, 0x8d, 0x84, 0x83,
+	0xde, 0xd9, 0xd0, 0xd7, 0xc2, 0xc5, 0xcc, 0xcb, 0xe6, 0xe1, 0xe8, 0xef, 0xfa, 0xfd, 0xf4, 0xf3
+};
+
+static uint8_t calc_crc(const uint8_t *data, int len)
+{
+	uint8_t crc = 0;
+
+	for (int i = 0; i < len; i++) {
+		crc = crc_table[crc ^ data[i]];
+	}
+
+	return crc;
+}
+
+static inline uint16_t get_u16(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline uint32_t hash_id(uint32_t id)
+{
+	/* Object ids are already hashes, just stir in the high bits */
+	return id ^ (id >> 16);
+}
+
+static struct obj_layout *find_obj(const struct decoder *dec, uint32_t id)
+{
+	uint32_t slot = hash_id(id) & dec->hash_mask;
+
+	while (dec->hash[slot] >= 0) {
+		struct obj_layout *obj = &dec->objs[dec->hash[slot]];
+
+		if (obj->id == id) {
+			return obj;
+		}
+
+		slot = (slot + 1) & dec->hash_mask;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * Find the next packet carrying object data, framing the stream the same way
+ * process_stream() does.
+ *
+ * @param[in] dec the decoder
+ * @param[in,out] st parser state, advanced past the packet
+ * @param[out] inst_id instance id of the object, 0 if single instance
+ * @param[out] data start of the object's fields
+ * @param[out] time_ms timestamp of the packet
+ * @returns the object, or NULL at the end of the buffer
+ */
+static struct obj_layout *next_object(const struct decoder *dec,
+		struct walk_state *st, uint16_t *inst_id, const uint8_t **data,
+		double *time_ms)
+{
+	const uint8_t *buf = dec->buf;
+	const Py_ssize_t len = dec->len;
+
+	while (true) {
+		uint32_t override_ts = 0;
+		Py_ssize_t pos = st->pos;
+
+		if (dec->gcs_timestamps) {
+			if (pos + LOGHEADER_LENGTH + HEADER_LENGTH > len) {
+				return NULL;
+			}
+
+			override_ts = get_u32(buf + pos);
+			pos += LOGHEADER_LENGTH;
+		}
+
+		if (pos + HEADER_LENGTH > len) {
+			return NULL;
+		}
+
+		if (buf[pos] != SYNC_VAL) {
+			const uint8_t *sync = memchr(buf + pos, SYNC_VAL, len - pos);
+
+			if (!sync) {
+				return NULL;
+			}
+
+			pos = sync - buf;
+
+			if (pos + HEADER_LENGTH > len) {
+				return NULL;
+			}
+		}
+
+		const uint8_t *pkt = buf + pos;
+
+		/* Anything that doesn't work out resyncs one byte later */
+		st->pos = pos + 1;
+
+		uint8_t type = pkt[1];
+		uint16_t pack_len = get_u16(pkt + 2);
+
+		if ((type & TYPE_MASK) != TYPE_VER) {
+			continue;
+		}
+
+		type &= ~TYPE_MASK;
+
+		if (pack_len < MIN_HEADER_LENGTH ||
+				pack_len > MAX_HEADER_LENGTH + MAX_PAYLOAD_LENGTH) {
+			continue;
+		}
+
+		struct obj_layout *obj = find_obj(dec, get_u32(pkt + 4));
+		int ts_len = 0;
+		int calc_size;
+
+		if (type == TYPE_OBJ_REQ || type == TYPE_ACK || type == TYPE_NACK) {
+			calc_size = HEADER_LENGTH + ((obj && !obj->single) ? 2 : 0);
+			obj = NULL;
+		} else if (obj) {
+			ts_len = (type & TIMESTAMPED) ? 2 : 0;
+			calc_size = HEADER_LENGTH + ts_len + obj->data_len;
+
+			type &= ~TIMESTAMPED;
+
+			if (type != TYPE_OBJ && type != TYPE_OBJ_ACK) {
+				obj = NULL;
+			}
+		} else {
+			/* Unknown object, take its word for the length */
+			calc_size = pack_len;
+		}
+
+		if (calc_size != pack_len) {
+			continue;
+		}
+
+		if (pos + calc_size + 1 > len) {
+			return NULL;
+		}
+
+		if (calc_crc(pkt, calc_size) != pkt[calc_size]) {
+			continue;
+		}
+
+		st->pos = pos + calc_size + 1;
+
+		/* As the firmware lays it out: instance id, timestamp, fields */
+		const uint8_t *p = pkt + HEADER_LENGTH;
+
+		*inst_id = 0;
+
+		if (obj && !obj->single) {
+			*inst_id = get_u16(p);
+			p += 2;
+		}
+
+		if (ts_len) {
+			uint16_t timestamp = get_u16(p);
+
+			if (timestamp < st->last_timestamp) {
+				st->timestamp_base += 65536;
+			}
+
+			st->last_timestamp = timestamp;
+			p += ts_len;
+		}
+
+		if (!obj || p == pkt + calc_size) {
+			continue;
+		}
+
+		if (dec->gcs_timestamps) {
+			*time_ms = override_ts;
+		} else {
+			*time_ms = (double) st->timestamp_base + st->last_timestamp;
+		}
+
+		*data = p;
+
+		return obj;
+	}
+}
+
+static void store_object(struct obj_layout *obj, npy_intp row,
+		uint16_t inst_id, const uint8_t *data, double time_ms)
+{
+	obj->time[row] = time_ms / 1000.0;
+
+	if (!obj->single) {
+		obj->inst_id[row] = inst_id;
+	}
+
+	for (int i = 0; i < obj->num_fields; i++) {
+		const struct field_layout *f = &obj->fields[i];
+		const uint8_t *src = data + f->offset;
+		char *dst = obj->columns[i] + row * f->size;
+		const npy_intp stride = obj->count * f->size;
+
+		/* Fixed size copies so these become plain loads and stores */
+		switch (f->size) {
+		case 1:
+			for (int e = 0; e < f->elements; e++, src += 1, dst += stride) {
+				*dst = *src;
+			}
+			break;
+		case 2:
+			for (int e = 0; e < f->elements; e++, src += 2, dst += stride) {
+				memcpy(dst, src, 2);
+			}
+			break;
+		case 4:
+			for (int e = 0; e < f->elements; e++, src += 4, dst += stride) {
+				memcpy(dst, src, 4);
+			}
+			break;
+		}
+	}
+}
+
+/**
+ * First pass: count the instances of each object, and note the parser state
+ * and row counts as each chunk boundary is crossed.
+ */
+static void count_objects(struct decoder *dec, Py_ssize_t start)
+{
+	struct walk_state st = { .pos = start };
+	Py_ssize_t chunk_len = (dec->len - start) / dec->num_chunks;
+	int next_chunk = 0;
+
+	uint16_t inst_id;
+	const uint8_t *data;
+	double time_ms;
+
+	while (true) {
+		while (next_chunk < dec->num_chunks &&
+				st.pos >= start + next_chunk * chunk_len) {
+			struct checkpoint *cp = &dec->chunks[next_chunk++];
+
+			cp->state = st;
+
+			for (int i = 0; i < dec->num_objs; i++) {
+				cp->rows[i] = dec->objs[i].count;
+			}
+		}
+
+		struct obj_layout *obj = next_object(dec, &st, &inst_id, &data,
+				&time_ms);
+
+		if (!obj) {
+			break;
+		}
+
+		obj->count++;
+	}
+
+	/* Chunks that begin past the last object have nothing to do */
+	while (next_chunk < dec->num_chunks) {
+		struct checkpoint *cp = &dec->chunks[next_chunk++];
+
+		cp->state.pos = dec->len;
+
+		for (int i = 0; i < dec->num_objs; i++) {
+			cp->rows[i] = dec->objs[i].count;
+		}
+	}
+}
+
+/**
+ * Second pass over one chunk.  Starting from the state noted in the first
+ * pass, the same packets are found again, so each object lands in exactly
+ * the rows counted for it.
+ */
+static void decode_chunk(struct decoder *dec, int chunk, npy_intp *rows)
+{
+	struct walk_state st = dec->chunks[chunk].state;
+	Py_ssize_t end = dec->len;
+
+	if (chunk + 1 < dec->num_chunks) {
+		end = dec->chunks[chunk + 1].state.pos;
+	}
+
+	memcpy(rows, dec->chunks[chunk].rows, dec->num_objs * sizeof(*rows));
+
+	uint16_t inst_id;
+	const uint8_t *data;
+	double time_ms;
+
+	while (st.pos < end) {
+		struct obj_layout *obj = next_object(dec, &st, &inst_id, &data,
+				&time_ms);
+
+		if (!obj) {
+			break;
+		}
+
+		int idx = obj - dec->objs;
+
+		store_object(obj, rows[idx]++, inst_id, data, time_ms);
+	}
+}
+
+#ifndef _WIN32
+struct chunk_worker {
+	pthread_t thread;
+	struct decoder *dec;
+	int first_chunk;
+	int stride;
+	npy_intp *rows;
+};
+
+static void *chunk_worker_main(void *ctx)
+{
+	struct chunk_worker *w = ctx;
+
+	for (int c = w->first_chunk; c < w->dec->num_chunks; c += w->stride) {
+		decode_chunk(w->dec, c, w->rows);
+	}
+
+	return NULL;
+}
+
+static int default_threads(void)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return cpus > 0 ? cpus : 1;
+}
+#else
+static int default_threads(void)
+{
+	return 1;
+}
+#endif /* _WIN32 */
+
+/**
+ * Second pass over all chunks.
+ *
+ * @returns 0 on success, -1 if out of memory
+ */
+static int decode_objects(struct decoder *dec, int threads)
+{
+	if (threads > dec->num_chunks) {
+		threads = dec->num_chunks;
+	}
+
+	npy_intp *rows = malloc(threads * dec->num_objs * sizeof(*rows) + 1);
+
+	if (!rows) {
+		return -1;
+	}
+
+#ifndef _WIN32
+	struct chunk_worker workers[MAX_THREADS];
+	int started = 1;
+
+	for (int t = 1; t < threads; t++) {
+		struct chunk_worker *w = &workers[t];
+
+		w->dec = dec;
+		w->first_chunk = t;
+		w->stride = threads;
+		w->rows = rows + t * dec->num_objs;
+
+		if (pthread_create(&w->thread, NULL, chunk_worker_main, w)) {
+			break;
+		}
+
+		started++;
+	}
+
+	/* This thread takes the first chunk, and any a worker didn't start for */
+	for (int c = 0; c < dec->num_chunks; c++) {
+		if (c % threads == 0 || c % threads >= started) {
+			decode_chunk(dec, c, rows);
+		}
+	}
+
+	for (int t = 1; t < started; t++) {
+		pthread_join(workers[t].thread, NULL);
+	}
+#else
+	for (int c = 0; c < dec->num_chunks; c++) {
+		decode_chunk(dec, c, rows);
+	}
+#endif /* _WIN32 */
+
+	free(rows);
+
+	return 0;
+}
+
+/**
+ * Work out whether the log has the GCS' per-packet timestamp and length
+ * headers, with the same heuristic as process_stream().
+ *
+ * @param[out] start where the first packet or log header is
+ */
+static bool detect_gcs_timestamps(const uint8_t *buf, Py_ssize_t len,
+		Py_ssize_t *start)
+{
+	for (Py_ssize_t pos = 0; pos + LOGHEADER_LENGTH + HEADER_LENGTH <= len;
+			pos++) {
+		uint32_t timestamp = get_u32(buf + pos);
+		uint32_t hdr_len_lo = get_u32(buf + pos + 4);
+		uint32_t hdr_len_hi = get_u32(buf + pos + 8);
+
+		if (hdr_len_hi || hdr_len_lo > 1000 || timestamp > 100000000) {
+			if (buf[pos] == SYNC_VAL) {
+				*start = pos;
+				return false;
+			}
+		} else if (buf[pos + LOGHEADER_LENGTH] == SYNC_VAL) {
+			*start = pos;
+			return true;
+		}
+	}
+
+	*start = 0;
+	return false;
+}
+
+static int field_type_num(char code, int *size)
+{
+	switch (code) {
+	case 'b': *size = 1; return NPY_INT8;
+	case 'B': *size = 1; return NPY_UINT8;
+	case 'h': *size = 2; return NPY_INT16;
+	case 'H': *size = 2; return NPY_UINT16;
+	case 'i': *size = 4; return NPY_INT32;
+	case 'I': *size = 4; return NPY_UINT32;
+	case 'f': *size = 4; return NPY_FLOAT32;
+	}
+
+	return -1;
+}
+
+static void free_decoder(struct decoder *dec)
+{
+	if (dec->objs) {
+		for (int i = 0; i < dec->num_objs; i++) {
+			free(dec->objs[i].fields);
+			free(dec->objs[i].columns);
+		}
+	}
+
+	if (dec->chunks) {
+		for (int i = 0; i < dec->num_chunks; i++) {
+			free(dec->chunks[i].rows);
+		}
+	}
+
+	free(dec->objs);
+	free(dec->hash);
+	free(dec->chunks);
+}
+
+/**
+ * Fill in the decoder's object table from the python description of each
+ * object: (id, single, data_len, ((offset, code, elements), ...)).
+ */
+static int parse_layouts(struct decoder *dec, PyObject *layouts)
+{
+	PyObject *seq = PySequence_Fast(layouts, "layouts must be a sequence");
+
+	if (!seq) {
+		return -1;
+	}
+
+	dec->num_objs = PySequence_Fast_GET_SIZE(seq);
+	dec->objs = calloc(dec->num_objs + 1, sizeof(*dec->objs));
+
+	uint32_t hash_size = 16;
+
+	while (hash_size < 2 * (uint32_t) dec->num_objs) {
+		hash_size <<= 1;
+	}
+
+	dec->hash_mask = hash_size - 1;
+	dec->hash = malloc(hash_size * sizeof(*dec->hash));
+
+	if (!dec->objs || !dec->hash) {
+		PyErr_NoMemory();
+		goto fail;
+	}
+
+	memset(dec->hash, 0xff, hash_size * sizeof(*dec->hash));
+
+	for (int i = 0; i < dec->num_objs; i++) {
+		struct obj_layout *obj = &dec->objs[i];
+		PyObject *fields;
+		unsigned long id;
+		int single;
+
+		if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(seq, i), "kpiO",
+					&id, &single, &obj->data_len, &fields)) {
+			goto fail;
+		}
+
+		obj->id = id;
+		obj->single = single;
+
+		if (find_obj(dec, obj->id)) {
+			PyErr_Format(PyExc_ValueError, "Duplicate object id 0x%08lx", id);
+			goto fail;
+		}
+
+		uint32_t slot = hash_id(obj->id) & dec->hash_mask;
+
+		while (dec->hash[slot] >= 0) {
+			slot = (slot + 1) & dec->hash_mask;
+		}
+
+		dec->hash[slot] = i;
+
+		PyObject *fseq = PySequence_Fast(fields, "fields must be a sequence");
+
+		if (!fseq) {
+			goto fail;
+		}
+
+		obj->num_fields = PySequence_Fast_GET_SIZE(fseq);
+		obj->fields = calloc(obj->num_fields + 1, sizeof(*obj->fields));
+		obj->columns = calloc(obj->num_fields + 1, sizeof(*obj->columns));
+
+		if (!obj->fields || !obj->columns) {
+			Py_DECREF(fseq);
+			PyErr_NoMemory();
+			goto fail;
+		}
+
+		int end = 0;
+
+		for (int j = 0; j < obj->num_fields; j++) {
+			struct field_layout *f = &obj->fields[j];
+			char code;
+
+			if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(fseq, j), "iCi",
+						&f->offset, &code, &f->elements)) {
+				Py_DECREF(fseq);
+				goto fail;
+			}
+
+			f->type_num = field_type_num(code, &f->size);
+
+			if (f->type_num < 0 || f->offset < 0 || f->elements < 1) {
+				Py_DECREF(fseq);
+				PyErr_Format(PyExc_ValueError,
+						"Bad field %d of object 0x%08lx", j, id);
+				goto fail;
+			}
+
+			if (f->offset + f->size * f->elements > end) {
+				end = f->offset + f->size * f->elements;
+			}
+		}
+
+		Py_DECREF(fseq);
+
+		/* Field offsets are relative to after the instance id */
+		if (end + (obj->single ? 0 : 2) > obj->data_len ||
+				obj->data_len > MAX_PAYLOAD_LENGTH) {
+			PyErr_Format(PyExc_ValueError,
+					"Fields overrun object 0x%08lx", id);
+			goto fail;
+		}
+	}
+
+	Py_DECREF(seq);
+	return 0;
+
+fail:
+	Py_DECREF(seq);
+	return -1;
+}
+
+/**
+ * Allocate the output columns of each object at their final size.
+ *
+ * @returns a list of (time, inst_id, (field columns...)) per object
+ */
+static PyObject *alloc_columns(struct decoder *dec)
+{
+	PyObject *result = PyList_New(dec->num_objs);
+
+	if (!result) {
+		return NULL;
+	}
+
+	for (int i = 0; i < dec->num_objs; i++) {
+		struct obj_layout *obj = &dec->objs[i];
+		npy_intp dims[2] = { obj->count, 0 };
+
+		PyObject *time = PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+		PyObject *inst_id = NULL;
+		PyObject *columns = PyTuple_New(obj->num_fields);
+
+		if (!obj->single) {
+			inst_id = PyArray_SimpleNew(1, dims, NPY_UINT16);
+		} else {
+			Py_INCREF(Py_None);
+			inst_id = Py_None;
+		}
+
+		if (!time || !inst_id || !columns) {
+			Py_XDECREF(time);
+			Py_XDECREF(inst_id);
+			Py_XDECREF(columns);
+			goto fail;
+		}
+
+		PyList_SET_ITEM(result, i, Py_BuildValue("NNN", time, inst_id,
+					columns));
+
+		if (!PyList_GET_ITEM(result, i)) {
+			goto fail;
+		}
+
+		obj->time = PyArray_DATA((PyArrayObject *) time);
+
+		if (!obj->single) {
+			obj->inst_id = PyArray_DATA((PyArrayObject *) inst_id);
+		}
+
+		for (int j = 0; j < obj->num_fields; j++) {
+			const struct field_layout *f = &obj->fields[j];
+
+			/* Fortran order, so each element is its own contiguous
+			 * column.
+			 */
+			dims[1] = f->elements;
+
+			PyObject *col = PyArray_New(&PyArray_Type,
+					f->elements == 1 ? 1 : 2, dims, f->type_num,
+					NULL, NULL, 0, NPY_ARRAY_F_CONTIGUOUS, NULL);
+
+			if (!col) {
+				goto fail;
+			}
+
+			PyTuple_SET_ITEM(columns, j, col);
+			obj->columns[j] = PyArray_DATA((PyArrayObject *) col);
+		}
+	}
+
+	return result;
+
+fail:
+	Py_DECREF(result);
+	return NULL;
+}
+
+static PyObject*
+decode(PyObject* self, PyObject* args, PyObject *kwarg)
+{
+	static char *kwlist[] = {"buf", "layouts", "gcs_timestamps", "threads", NULL};
+
+	Py_buffer view;
+	PyObject *layouts;
+	PyObject *gcs_arg = Py_None;
+	int threads = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwarg, "y*O|Oi", kwlist,
+				&view, &layouts, &gcs_arg, &threads)) {
+		return NULL;
+	}
+
+	struct decoder dec = {
+		.buf = view.buf,
+		.len = view.len,
+	};
+
+	PyObject *result = NULL;
+	Py_ssize_t start = 0;
+
+	if (parse_layouts(&dec, layouts)) {
+		goto out;
+	}
+
+	if (gcs_arg == Py_None) {
+		dec.gcs_timestamps = detect_gcs_timestamps(dec.buf, dec.len, &start);
+	} else {
+		dec.gcs_timestamps = PyObject_IsTrue(gcs_arg);
+	}
+
+	if (threads <= 0) {
+		threads = default_threads();
+	}
+
+	if (threads > MAX_THREADS) {
+		threads = MAX_THREADS;
+	}
+
+	/* A few chunks per thread evens out uneven packet density */
+	dec.num_chunks = (dec.len - start) / MIN_CHUNK_BYTES;
+
+	if (dec.num_chunks > threads * 4) {
+		dec.num_chunks = threads * 4;
+	}
+
+	if (dec.num_chunks < 1) {
+		dec.num_chunks = 1;
+	}
+
+	dec.chunks = calloc(dec.num_chunks, sizeof(*dec.chunks));
+
+	if (!dec.chunks) {
+		PyErr_NoMemory();
+		goto out;
+	}
+
+	for (int i = 0; i < dec.num_chunks; i++) {
+		dec.chunks[i].rows = calloc(dec.num_objs + 1, sizeof(npy_intp));
+
+		if (!dec.chunks[i].rows) {
+			PyErr_NoMemory();
+			goto out;
+		}
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	count_objects(&dec, start);
+	Py_END_ALLOW_THREADS
+
+	result = alloc_columns(&dec);
+
+	if (!result) {
+		goto out;
+	}
+
+	int ret;
+
+	Py_BEGIN_ALLOW_THREADS
+	ret = decode_objects(&dec, threads);
+	Py_END_ALLOW_THREADS
+
+	if (ret) {
+		Py_CLEAR(result);
+		PyErr_NoMemory();
+	}
+
+out:
+	free_decoder(&dec);
+	PyBuffer_Release(&view);
+
+	return result;
+}
+
+static PyMethodDef LogDecodeMethods[] =
+{
+	{"decode", (PyCFunction) decode, METH_VARARGS | METH_KEYWORDS,
+		"Decode a UAVTalk log into per object columns."},
+	{NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef logdecode_module = {
+	PyModuleDef_HEAD_INIT,
+	"_logdecode",
+	"Native columnar decoder for UAVTalk logs.",
+	-1,
+	LogDecodeMethods
+};
+
+PyMODINIT_FUNC
+PyInit__logdecode(void)
+{
+	import_array();
+
+	return PyModule_Create(&logdecode_module);
+}
@@ -0,0 +1,372 @@
+"""
+Bulk export of logs to CSV, a columnar binary format, or KML.
+
+Copyright (C) 2017 dRonin, http://dronin.org
+
+Licensed under the GNU LGPL version 2.1 or any later version (see COPYING.LESSER)
+
+A log is decoded once, natively and on several threads (see logdecode), and
+the columns are then written out:
+
+ - CSV: one file per object, a row per packet.  Multi-element fields get a
+   column per element, named Field:Element.
+ - Columnar: a single file holding every column as a raw little endian array,
+   after a JSON schema describing them.  read_columnar() maps it back into
+   numpy arrays without parsing anything.
+ - KML: the flight path, from GPSPosition, for Google Earth.
+
+dronin-export is the command line front end, for batches of logs.
+"""
+
+import json
+import os
+import re
+import struct
+
+import numpy as np
+
+from . import logdecode, uavo_collection
+
+__all__ = [ "COLUMNAR_MAGIC", "load_log", "write_csv", "write_columnar",
+        "read_columnar", "write_kml", "export_log" ]
+
+COLUMNAR_MAGIC = b'DRCOLS1\n'
+COLUMNAR_ALIGN = 16
+
+def load_log(filename, githash=None, xml_path=None, threads=0):
+    """ Decodes a log file written by the GCS or the flight controller.
+
+     - githash: the revision of the UAVO definitions to decode with, if not
+       the one named in the log header
+     - xml_path: a directory of UAVO definitions to decode with instead
+     - threads: how many threads to decode with, 0 for one per CPU
+
+    Returns (githash, uavo_defs, columns), where columns is as returned by
+    logdecode.decode().
+    """
+
+    with open(filename, 'rb') as f:
+        # Scan up to 100 "lines" looking for the signature, in case there's
+        # garbage at the beginning of the log
+        header_hash = None
+
+        for i in range(100):
+            sig = f.readline()
+
+            if sig.endswith(b'git hash:\n'):
+                header_hash = f.readline()[:-1]
+
+                if header_hash.find(b':') != -1:
+                    header_hash = re.search(b':(\w*)\W', header_hash).group(1)
+
+                header_hash = header_hash.decode('latin-1')
+
+                # UAVO hash
+                f.readline()
+                break
+            elif not sig:
+                break
+
+        if header_hash is None:
+            raise IOError("no header signature")
+
+        uavo_defs = uavo_collection.UAVOCollection()
+
+        if xml_path is not None:
+            uavo_defs.from_uavo_xml_path(xml_path)
+        else:
+            githash = githash or header_hash
+            uavo_defs.from_git_hash(githash)
+
+        columns = logdecode.decode_file(f, uavo_defs, threads=threads)
+
+    return githash or header_hash, uavo_defs, columns
+
+def _short_name(uavo_class):
+    return uavo_class._name[5:]
+
+def _select(columns, objects):
+    """ The decoded objects to export, by name, in a stable order. """
+
+    selected = []
+
+    for c in sorted(columns.keys(), key=_short_name):
+        if objects is None or _short_name(c) in objects:
+            selected.append(c)
+
+    return selected
+
+def _element_names(uavo_class, field, elements):
+    names = uavo_class._elemnames.get(field)
+
+    if names and len(names) == elements:
+        return names
+
+    return [ str(i) for i in range(elements) ]
+
+def _flat_columns(uavo_class, cols):
+    """ (name, 1D array) pairs, splitting multi-element fields. """
+
+    flat = []
+
+    for name, col in cols.items():
+        if col.ndim == 1:
+            flat.append((name, col))
+            continue
+
+        for i, elem in enumerate(_element_names(uavo_class, name, col.shape[1])):
+            flat.append(('%s:%s' % (name, elem), col[:, i]))
+
+    return flat
+
+def _format_column(col):
+    if col.dtype.kind == 'f':
+        fmt = '%.9g' if col.dtype.itemsize == 4 else '%.17g'
+    else:
+        fmt = '%d'
+
+    return np.char.mod(fmt, col)
+
+def _write_csv_object(filename, uavo_class, cols):
+    flat = _flat_columns(uavo_class, cols)
+
+    header = ','.join(name for name, col in flat)
+
+    with open(filename, 'w', newline='\n') as f:
+        f.write(header + '\n')
+
+        # Format a block of rows at a time, column by column, so it's done
+        # in numpy rather than row by row in python
+        rows = len(cols['time'])
+        block = 65536
+
+        for start in range(0, rows, block):
+            text = None
+
+            for name, col in flat:
+                formatted = _format_column(col[start:start + block])
+
+                if text is None:
+                    text = formatted
+                else:
+                    text = np.char.add(np.char.add(text, ','), formatted)
+
+            f.write('\n'.join(text.tolist()))
+            f.write('\n')
+
+def _pool(threads):
+    from concurrent.futures import ThreadPoolExecutor
+
+    return ThreadPoolExecutor(max_workers=(threads or os.cpu_count() or 1))
+
+def write_csv(columns, out_dir, objects=None, threads=0):
+    """ Writes one CSV file per object into out_dir.
+
+     - columns: as returned by load_log() or logdecode.decode()
+     - objects: names of the objects to write, default all
+     - threads: how many files to write at once, 0 for one per CPU
+
+    Returns the list of files written.
+    """
+
+    os.makedirs(out_dir, exist_ok=True)
+
+    jobs = []
+
+    with _pool(threads) as pool:
+        for c in _select(columns, objects):
+            filename = os.path.join(out_dir, _short_name(c) + '.csv')
+            jobs.append((filename,
+                pool.submit(_write_csv_object, filename, c, columns[c])))
+
+    for filename, job in jobs:
+        # Raise any error from the writer
+        job.result()
+
+    return [ filename for filename, job in jobs ]
+
+def _column_schema(uavo_class, name, col):
+    desc = { 'name' : name, 'dtype' : col.dtype.newbyteorder('<').str,
+            'shape' : list(col.shape) }
+
+    if name == 'time':
+        desc['units'] = 's'
+    elif name != 'inst_id':
+        desc['units'] = uavo_class._units.get(name, '')
+
+        if col.ndim > 1:
+            desc['elements'] = _element_names(uavo_class, name, col.shape[1])
+
+        if uavo_class._types.get(name) == 'enum':
+            desc['options'] = getattr(uavo_class, 'ENUMR_' + name)
+
+    return desc
+
+def _align(offset):
+    return (offset + COLUMNAR_ALIGN - 1) & ~(COLUMNAR_ALIGN - 1)
+
+def write_columnar(columns, filename, objects=None, githash=None):
+    """ Writes the columns into one file: COLUMNAR_MAGIC, the length of the
+    schema as a little endian uint32, the schema as JSON, then each column's
+    raw little endian data at the offset the schema gives for it, aligned to
+    16 bytes.  Multi-element fields are stored row major.
+
+     - columns: as returned by load_log() or logdecode.decode()
+     - objects: names of the objects to write, default all
+     - githash: recorded in the schema, for reference
+    """
+
+    selected = _select(columns, objects)
+
+    schema = { 'version' : 1, 'githash' : githash, 'objects' : [] }
+    arrays = []
+
+    for c in selected:
+        obj = { 'name' : _short_name(c), 'id' : c._id,
+                'rows' : len(columns[c]['time']), 'columns' : [] }
+
+        for name, col in columns[c].items():
+            obj['columns'].append(_column_schema(c, name, col))
+            arrays.append(np.ascontiguousarray(col,
+                dtype=col.dtype.newbyteorder('<')))
+
+        schema['objects'].append(obj)
+
+    descs = [ d for obj in schema['objects'] for d in obj['columns'] ]
+
+    # The offsets depend on the length of the schema, which includes them;
+    # reserve room for the widest offset each time round until it settles.
+    data_start = 0
+
+    while True:
+        offset = data_start
+
+        for d, arr in zip(descs, arrays):
+            d['offset'] = offset
+            offset = _align(offset + arr.nbytes)
+
+        text = json.dumps(schema).encode('utf-8')
+        needed = _align(len(COLUMNAR_MAGIC) + 4 + len(text))
+
+        if needed <= data_start:
+            break
+
+        data_start = needed
+
+    with open(filename, 'wb') as f:
+        f.write(COLUMNAR_MAGIC)
+        f.write(struct.pack('<I', len(text)))
+        f.write(text)
+
+        for d, arr in zip(descs, arrays):
+            f.write(b'\0' * (d['offset'] - f.tell()))
+            arr.tofile(f)
+
+def read_columnar(filename):
+    """ Maps a file written by write_columnar().
+
+    Returns (schema, data), where data maps each object name to a dict of
+    its columns, as read-only numpy arrays backed by the file.
+    """
+
+    with open(filename, 'rb') as f:
+        if f.read(len(COLUMNAR_MAGIC)) != COLUMNAR_MAGIC:
+            raise ValueError("not a columnar log export")
+
+        length, = struct.unpack('<I', f.read(4))
+        schema = json.loads(f.read(length).decode('utf-8'))
+
+    m = np.memmap(filename, mode='r')
+    data = {}
+
+    for obj in schema['objects']:
+        cols = {}
+
+        for d in obj['columns']:
+            dtype = np.dtype(d['dtype'])
+            count = int(np.prod(d['shape']))
+            arr = np.frombuffer(m, dtype=dtype, count=count, offset=d['offset'])
+            cols[d['name']] = arr.reshape(d['shape'])
+
+        data[obj['name']] = cols
+
+    return schema, data
+
+def write_kml(columns, uavo_defs, filename, name=None):
+    """ Writes the flight path from GPSPosition as KML.
+
+    Returns the number of points, 0 (and no file) if the log has no fix.
+    """
+
+    gps = columns.get(uavo_defs.find_by_name('GPSPosition'))
+
+    if gps is None:
+        return 0
+
+    typ = uavo_defs.find_by_name('GPSPosition')
+    fix = [ v for k, v in typ.ENUM_Status.items() if k in ('Fix2D', 'Fix3D') ]
+    usable = np.isin(gps['Status'], fix)
+
+    lat = gps['Latitude'][usable] * 1e-7
+    lon = gps['Longitude'][usable] * 1e-7
+    alt = gps['Altitude'][usable]
+
+    if len(lat) == 0:
+        return 0
+
+    coords = np.char.add(np.char.add(np.char.add(np.char.add(
+        np.char.mod('%.7f', lon), ','), np.char.mod('%.7f', lat)), ','),
+        np.char.mod('%.2f', alt))
+
+    from xml.sax.saxutils import escape
+
+    with open(filename, 'w') as f:
+        f.write('<?xml version="1.0" encoding="UTF-8"?>\n')
+        f.write('<kml xmlns="http://www.opengis.net/kml/2.2">\n')
+        f.write('<Document>\n')
+        f.write('<name>%s</name>\n' % escape(name or 'dRonin log'))
+        f.write('<Style id="path"><LineStyle><color>ff00ffff</color>'
+                '<width>3</width></LineStyle>'
+                '<PolyStyle><color>4000ffff</color></PolyStyle></Style>\n')
+        f.write('<Placemark>\n<name>Flight path</name>\n')
+        f.write('<styleUrl>#path</styleUrl>\n')
+        f.write('<LineString>\n<extrude>1</extrude>\n')
+        f.write('<altitudeMode>absolute</altitudeMode>\n<coordinates>\n')
+        f.write('\n'.join(coords.tolist()))
+        f.write('\n</coordinates>\n</LineString>\n</Placemark>\n')
+        f.write('</Document>\n</kml>\n')
+
+    return len(lat)
+
+FORMATS = ('csv', 'columnar', 'kml')
+
+def export_log(filename, out_dir, formats=('csv',), objects=None,
+        githash=None, xml_path=None, threads=0):
+    """ Decodes a log once and writes it in each of the formats, named after
+    the log, into out_dir.  Returns the list of paths written. """
+
+    githash, uavo_defs, columns = load_log(filename, githash=githash,
+            xml_path=xml_path, threads=threads)
+
+    base = os.path.splitext(os.path.basename(filename))[0]
+    written = []
+
+    os.makedirs(out_dir, exist_ok=True)
+
+    if 'csv' in formats:
+        csv_dir = os.path.join(out_dir, base)
+        written += write_csv(columns, csv_dir, objects=objects,
+                threads=threads)
+
+    if 'columnar' in formats:
+        path = os.path.join(out_dir, base + '.drcol')
+        write_columnar(columns, path, objects=objects, githash=githash)
+        written.append(path)
+
+    if 'kml' in formats:
+        path = os.path.join(out_dir, base + '.kml')
+
+        if write_kml(columns, uavo_defs, path, name=base):
+            written.append(path)
+
+    return written
@@ -0,0 +1,120 @@
+"""
+Fast, columnar decoding of UAVTalk logs.
+
+Copyright (C) 2017 dRonin, http://dronin.org
+
+Licensed under the GNU LGPL version 2.1 or any later version (see COPYING.LESSER)
+
+Rather than building one UAVO instance per packet like the telemetry module,
+this hands the whole log to a native decoder which fills one numpy array per
+field.  It needs the _logdecode extension; ImportError is raised by this
+module if it was not built.
+"""
+
+import re
+
+try:
+    from struct import calcsize
+except:
+    from .structshim import calcsize
+
+from . import _logdecode
+
+__all__ = [ "decode", "decode_file" ]
+
+_format_re = re.compile('([0-9]*)([a-zA-Z])')
+
+def _layout(uavo_class):
+    """ Describes where each field of a UAVO lives in its packed data. """
+
+    fmt = uavo_class._packstruct.format
+
+    if isinstance(fmt, bytes):
+        fmt = fmt.decode('latin-1')
+
+    codes = _format_re.findall(fmt)
+    names = uavo_class._fields[3:]
+
+    if not uavo_class._single:
+        # The instance id is decoded separately
+        codes = codes[1:]
+        names = names[1:]
+
+    fields = []
+    offset = 0
+
+    for count, code in codes:
+        elements = int(count) if count else 1
+        fields.append((offset, code, elements))
+        offset += calcsize('<' + code) * elements
+
+    layout = (uavo_class._id, bool(uavo_class._single),
+            uavo_class.get_size_of_data(), tuple(fields))
+
+    return layout, names
+
+def decode(data, uavo_defs, gcs_timestamps=None, threads=0):
+    """ Decodes a UAVTalk log held in memory.
+
+     - data: the log contents, after any header, as bytes or anything else
+       exposing the buffer protocol (e.g. a memoryview of an mmap)
+     - uavo_defs: the UAVO collection the log was written with
+     - gcs_timestamps: whether the log has GCS-style timestamps; if None,
+       autodetect
+     - threads: how many threads to decode with, 0 for one per CPU
+
+    Returns a dict mapping each UAVO class present in the log to a dict of
+    columns: 'time' in seconds, 'inst_id' for multiple instance objects, and
+    one array per field.  Fields with several elements are 2D, and each element
+    is contiguous, e.g. cols['Channel'][:, 0].  Floats are kept single
+    precision.
+    """
+
+    classes = list(uavo_defs.values())
+    layouts = []
+    names = []
+
+    for c in classes:
+        layout, field_names = _layout(c)
+        layouts.append(layout)
+        names.append(field_names)
+
+    decoded = _logdecode.decode(data, layouts,
+            gcs_timestamps=gcs_timestamps, threads=threads)
+
+    result = {}
+
+    for c, field_names, (time, inst_id, columns) in zip(classes, names, decoded):
+        if len(time) == 0:
+            continue
+
+        cols = { 'time' : time }
+
+        if inst_id is not None:
+            cols['inst_id'] = inst_id
+
+        cols.update(zip(field_names, columns))
+
+        result[c] = cols
+
+    return result
+
+def decode_file(file_obj, uavo_defs, **kwargs):
+    """ Decodes the rest of a log file, from its current position.
+
+    The file is memory mapped where possible rather than read in.  Takes the
+    same keyword arguments as decode().
+    """
+
+    import mmap
+
+    start = file_obj.tell()
+
+    try:
+        m = mmap.mmap(file_obj.fileno(), 0, access=mmap.ACCESS_READ)
+    except Exception:
+        # Not a real file, or an empty one
+        return decode(file_obj.read(), uavo_defs, **kwargs)
+
+    with m, memoryview(m) as view, view[start:] as body:
+        return decode(body, uavo_defs, **kwargs)
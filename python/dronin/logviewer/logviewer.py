@@ -8,7 +8,29 @@ from dronin.logviewer.plotdockarea import PlotDockArea
 
 from dronin_pyqtgraph.dockarea import *
 
+def get_column_series(obj_name, fields):
+    cols = columns.get(t.uavo_defs.find_by_name(obj_name))
+
+    if cols is None:
+        return []
+
+    outp = np.empty((len(cols['time']), len(fields)))
+
+    for j in range(len(fields)):
+        field_info = fields[j].split(':')
+        col = cols[field_info[0]]
+
+        if len(field_info) > 1:
+            col = col[:, int(field_info[1])]
+
+        outp[:, j] = col
+
+    return outp
+
 def get_data_series(obj_name, fields):
+    if columns is not None:
+        return get_column_series(obj_name, fields)
+
     data = get_series(obj_name)
 
     if (len(data) < 1):
@@ -152,6 +174,37 @@ def scan_for_events(uv):
 
     return events
 
+def scan_for_column_events():
+    typ = t.uavo_defs.find_by_name('FlightStatus')
+    cols = columns.get(typ)
+
+    if cols is None:
+        return []
+
+    armed = cols['Armed']
+    flight_mode = cols['FlightMode']
+
+    armed_changed = np.ones(len(armed), dtype=bool)
+    armed_changed[1:] = armed[1:] != armed[:-1]
+
+    mode_changed = np.ones(len(flight_mode), dtype=bool)
+    mode_changed[1:] = flight_mode[1:] != flight_mode[:-1]
+
+    events = []
+
+    for i in np.flatnonzero(armed_changed | mode_changed):
+        ev = []
+
+        if armed_changed[i]:
+            ev.append(typ.ENUMR_Armed[int(armed[i])])
+
+        if mode_changed[i]:
+            ev.append('MODE:' + typ.ENUMR_FlightMode[int(flight_mode[i])])
+
+        events.append((cols['time'][i], '/'.join(ev)))
+
+    return events
+
 def handle_open(ignored=False, fname=None):
     from dronin import telemetry, uavo
 
@@ -190,15 +243,28 @@ def handle_open(ignored=False, fname=None):
         t = telemetry.FileTelemetry(f, parse_header=True, service_in_iter=True,
                     gcs_timestamps=None, name=fname, progress_callback=cb)
 
-        global series, objtyps
+        global series, objtyps, columns
         series = {}
         objtyps = {}
+        columns = None
+
+        # Decode the whole log natively into columns if we can, otherwise
+        # fall back to walking the objects in python.
+        try:
+            from dronin import logdecode
+
+            columns = logdecode.decode_file(f, t.uavo_defs)
+        except ImportError:
+            pass
 
         for typ in t.uavo_defs.values():
             short_name = typ._name[5:]
             objtyps[short_name] = typ
 
-        event_series = scan_for_events(t)
+        if columns is not None:
+            event_series = scan_for_column_events()
+        else:
+            event_series = scan_for_events(t)
 
         global last_plot
         last_plot = None
@@ -217,7 +283,12 @@ def handle_open(ignored=False, fname=None):
         plot_vs_time('Gyros', ['x', 'y', 'z'])
         plot_vs_time('ActuatorCommand', ['Channel:0', 'Channel:1', 'Channel:2', 'Channel:3'])
 
-        objtyps = { k:v for k,v in objtyps.items() if v in t.last_values }
+        if columns is not None:
+            present = columns
+        else:
+            present = t.last_values
+
+        objtyps = { k:v for k,v in objtyps.items() if v in present }
 
         #add all non-settings objects, and autotune, to the keys.
         objSel.clear()
@@ -275,6 +346,7 @@ menubar = win.menuBar()
 
 win_num = 0
 menus_enabled = False
+columns = None
 
 openAction = QtGui.QAction("&Open", win)
 openAction.setShortcut(QtGui.QKeySequence.Open)
@@ -0,0 +1,349 @@
+"""
+Sensor stream replay, for regression benchmarks of the flight code.
+
+Copyright (C) 2017 dRonin, http://dronin.org
+
+Licensed under the GNU LGPL version 2.1 or any later version (see COPYING.LESSER)
+
+A flight log is turned into a sensor stream: its gyro, accel, mag, baro,
+GPS and receiver samples, time ordered, in the format flightd replays with
+-R (see flight/Modules/Stabilization/simulated/replaysensors.c).  flightd
+feeds the stream through the whole flight stack on a fake clock it drives
+from the stream, and logs what came out.  diff_logs() then compares that
+log against one from a golden build: AttitudeActual and ActuatorCommand
+sample by sample, and the CPU time each task took.
+
+The logged Gyros, Accels and Magnetometer have already been calibrated,
+filtered and rotated into the body frame on the flight controller.  flightd
+marks replayed sensors as calibrated and passes their samples through as
+they are, whatever the sensor settings say; only the state estimator's
+gyro bias is still applied.
+
+dronin-replay is the command line front end.
+"""
+
+import os
+import shutil
+import struct
+import subprocess
+import tempfile
+
+import numpy as np
+
+from . import export
+
+__all__ = [ "STREAM_MAGIC", "make_stream", "make_stream_from_log",
+        "run_flightd", "diff_logs", "format_diff" ]
+
+STREAM_MAGIC = b'DRSS'
+STREAM_VERSION = 1
+
+REC_GYRO = 1
+REC_ACCEL = 2
+REC_MAG = 3
+REC_BARO = 4
+REC_GPSPOSITION = 5
+REC_GPSVELOCITY = 6
+REC_RECEIVER = 7
+
+_header = struct.Struct('<4sHHHHB3x')
+
+_record_head = [ ('time', '<u4'), ('type', 'u1'), ('length', 'u1') ]
+
+# (object, record type, [(field, dtype)]), in the order each record packs
+# them; matching the C structures in replaysensors.c
+_sources = [
+    ('Gyros', REC_GYRO, [ ('x', '<f4'), ('y', '<f4'), ('z', '<f4'),
+        ('temperature', '<f4') ]),
+    ('Accels', REC_ACCEL, [ ('x', '<f4'), ('y', '<f4'), ('z', '<f4'),
+        ('temperature', '<f4') ]),
+    ('Magnetometer', REC_MAG, [ ('x', '<f4'), ('y', '<f4'), ('z', '<f4') ]),
+    ('BaroAltitude', REC_BARO, [ ('Temperature', '<f4'),
+        ('Pressure', '<f4'), ('Altitude', '<f4') ]),
+    ('GPSPosition', REC_GPSPOSITION, [ ('Latitude', '<i4'),
+        ('Longitude', '<i4'), ('Altitude', '<f4'),
+        ('GeoidSeparation', '<f4'), ('Heading', '<f4'),
+        ('Groundspeed', '<f4'), ('Accuracy', '<f4'), ('PDOP', '<f4'),
+        ('Satellites', 'u1'), ('Status', 'u1') ]),
+    ('GPSVelocity', REC_GPSVELOCITY, [ ('North', '<f4'), ('East', '<f4'),
+        ('Down', '<f4'), ('Accuracy', '<f4') ]),
+]
+
+def _rate(times):
+    """ The rate of a sample stream, from its median interval, in Hz. """
+
+    if len(times) < 2:
+        return 0
+
+    interval = np.median(np.diff(times))
+
+    if interval <= 0:
+        return 0
+
+    return int(min(65535, round(1.0 / interval)))
+
+def make_stream(columns, uavo_defs, filename):
+    """ Writes the sensor samples in decoded log columns as a stream.
+
+     - columns, uavo_defs: as returned by export.load_log()
+
+    Returns a dict of how many records of each object were written.
+    """
+
+    blocks = []
+    counts = {}
+    rates = {}
+
+    for name, rec_type, fields in _sources:
+        cols = columns.get(uavo_defs.find_by_name(name))
+
+        if cols is None or not len(cols['time']):
+            continue
+
+        dtype = np.dtype(_record_head + [ (f, dt) for f, dt in fields ])
+        recs = np.zeros(len(cols['time']), dtype=dtype)
+        recs['type'] = rec_type
+        recs['length'] = dtype.itemsize - 6
+
+        for f, dt in fields:
+            recs[f] = cols[f]
+
+        blocks.append((cols['time'], rec_type, recs))
+        counts[name] = len(recs)
+        rates[name] = _rate(cols['time'])
+
+    rcvr_channels = 0
+    cmd = columns.get(uavo_defs.find_by_name('ManualControlCommand'))
+
+    if cmd is not None and len(cmd['time']):
+        channels = np.atleast_2d(cmd['Channel'].T).T
+        rcvr_channels = channels.shape[1]
+
+        dtype = np.dtype(_record_head +
+                [ ('channels', '<u2', (rcvr_channels,)) ])
+        recs = np.zeros(len(cmd['time']), dtype=dtype)
+        recs['type'] = REC_RECEIVER
+        recs['length'] = 2 * rcvr_channels
+        recs['channels'] = channels
+
+        blocks.append((cmd['time'], REC_RECEIVER, recs))
+        counts['ManualControlCommand'] = len(recs)
+
+    if 'Gyros' not in counts:
+        raise ValueError("no gyro samples to replay")
+
+    if not rates['Gyros']:
+        raise ValueError("can't tell the gyro rate")
+
+    # Time order, with each gyro sample after anything else taken at the
+    # same time: flightd hands over a gyro sample with the accel, mag and
+    # baro samples that came in before it
+    times = np.concatenate([ t for t, typ, recs in blocks ])
+    last = np.concatenate([ np.full(len(t), typ == REC_GYRO)
+        for t, typ, recs in blocks ])
+    order = np.lexsort((last, times))
+
+    start = times[order[0]]
+    stamps = np.round((times - start) * 1e6).astype(np.int64) & 0xffffffff
+
+    flat = []
+    sizes = []
+    offset = 0
+
+    for t, typ, recs in blocks:
+        recs['time'] = stamps[offset:offset + len(recs)]
+        offset += len(recs)
+
+        flat.append(recs.view(np.uint8).reshape(-1))
+        sizes.append(np.full(len(recs), recs.dtype.itemsize, dtype=np.int64))
+
+    flat = np.concatenate(flat)
+    sizes = np.concatenate(sizes)
+    src = np.concatenate(([0], np.cumsum(sizes)[:-1]))
+
+    # Gather the records' bytes into time order in one go
+    out_sizes = sizes[order]
+    out_start = np.concatenate(([0], np.cumsum(out_sizes)[:-1]))
+    gather = (np.repeat(src[order] - out_start, out_sizes) +
+            np.arange(out_sizes.sum()))
+
+    with open(filename, 'wb') as f:
+        f.write(_header.pack(STREAM_MAGIC, STREAM_VERSION, rates['Gyros'],
+            rates.get('Magnetometer', 0), rates.get('BaroAltitude', 0),
+            rcvr_channels))
+        flat[gather].tofile(f)
+
+    return counts
+
+def make_stream_from_log(log_filename, filename, githash=None,
+        xml_path=None, threads=0):
+    """ Decodes a log and writes its sensor samples as a stream. """
+
+    githash, uavo_defs, columns = export.load_log(log_filename,
+            githash=githash, xml_path=xml_path, threads=threads)
+
+    return make_stream(columns, uavo_defs, filename)
+
+def run_flightd(flightd, stream, log_filename, config=None, speed=1.0,
+        timeout=None):
+    """ Replays a stream through flightd, logging to log_filename.
+
+     - config: a settings flash image to start from; it's copied, so the
+       replay can't change it
+     - speed: how much faster than real time to run
+
+    Returns flightd's exit status.
+    """
+
+    with tempfile.TemporaryDirectory() as tmp:
+        flash = os.path.join(tmp, 'config.flash')
+
+        if config is not None:
+            shutil.copyfile(config, flash)
+
+        args = [ flightd, '-c', flash, '-R', stream, '-F', str(speed),
+                '-l', log_filename ]
+
+        proc = subprocess.run(args, stdout=subprocess.DEVNULL,
+                timeout=timeout)
+
+        return proc.returncode
+
+def _compare(gold_t, gold, cand_t, cand, wrap=False):
+    """ Compares each golden sample against the candidate's sample at the
+    same time, or the latest before it.  Returns (samples, max, rms). """
+
+    if not len(gold_t) or not len(cand_t):
+        return 0, float('nan'), float('nan')
+
+    idx = np.searchsorted(cand_t, gold_t + 1e-6, side='right') - 1
+    idx = np.clip(idx, 0, len(cand_t) - 1)
+
+    d = cand[idx].astype(np.float64) - gold.astype(np.float64)
+
+    if wrap:
+        d = (d + 180.0) % 360.0 - 180.0
+
+    d = np.abs(d)
+
+    return len(d), float(np.max(d)), float(np.sqrt(np.mean(d * d)))
+
+def _rel_time(columns):
+    """ Log time is the fake clock, which starts at an arbitrary value;
+    measure from the first packet in the log instead. """
+
+    starts = [ c['time'][0] for c in columns.values() if len(c['time']) ]
+
+    return min(starts) if starts else 0.0
+
+_compared = [
+    ('AttitudeActual', [ ('Roll', True), ('Pitch', True), ('Yaw', True) ]),
+    ('ActuatorCommand', [ ('Channel', False) ]),
+]
+
+def diff_logs(golden, candidate, xml_path=None, threads=0):
+    """ Compares a replay's log against a golden one.
+
+    Returns a dict with:
+     - 'fields': (object, field, samples, max abs diff, rms diff) tuples
+     - 'tasks': (task, golden mean %, candidate mean %) tuples, from
+       TaskInfo.RunningTime
+     - 'identical': whether every compared sample matched exactly, with
+       the same number of samples
+    """
+
+    runs = []
+
+    for filename in (golden, candidate):
+        githash, uavo_defs, columns = export.load_log(filename,
+                xml_path=xml_path, threads=threads)
+        runs.append((uavo_defs, columns, _rel_time(columns)))
+
+    fields = []
+    identical = True
+
+    for obj, names in _compared:
+        cols = []
+
+        for uavo_defs, columns, t0 in runs:
+            c = columns.get(uavo_defs.find_by_name(obj))
+            cols.append((c, t0, uavo_defs.find_by_name(obj)))
+
+        (gold, gold_t0, typ), (cand, cand_t0, _) = cols
+
+        if gold is None or cand is None:
+            identical = identical and gold is None and cand is None
+            continue
+
+        if len(gold['time']) != len(cand['time']):
+            identical = False
+
+        gold_t = gold['time'] - gold_t0
+        cand_t = cand['time'] - cand_t0
+
+        for name, wrap in names:
+            g = gold[name]
+            c = cand[name]
+
+            if g.ndim == 1:
+                labels = [ name ]
+                g = g[:, None]
+                c = c[:, None]
+            else:
+                labels = [ '%s:%s' % (name, e) for e in
+                        export._element_names(typ, name, g.shape[1]) ]
+
+            for i, label in enumerate(labels):
+                n, dmax, rms = _compare(gold_t, g[:, i], cand_t, c[:, i],
+                        wrap=wrap)
+                fields.append((obj, label, n, dmax, rms))
+
+                if not n or dmax != 0:
+                    identical = False
+
+    tasks = []
+    means = []
+
+    for uavo_defs, columns, t0 in runs:
+        typ = uavo_defs.find_by_name('TaskInfo')
+        info = columns.get(typ)
+
+        if info is None or not len(info['time']):
+            means.append({})
+            continue
+
+        running = np.atleast_2d(info['RunningTime'].T).T
+        names = export._element_names(typ, 'RunningTime', running.shape[1])
+        means.append(dict(zip(names, running.mean(axis=0))))
+
+    for name in means[0]:
+        g = means[0][name]
+        c = means[1].get(name, float('nan'))
+
+        if g or c:
+            tasks.append((name, float(g), float(c)))
+
+    return { 'fields' : fields, 'tasks' : tasks, 'identical' : identical }
+
+def format_diff(result):
+    """ A table of diff_logs() results, as text. """
+
+    lines = [ '%-16s %-24s %8s %12s %12s' % ('object', 'field', 'samples',
+        'max', 'rms') ]
+
+    for obj, label, n, dmax, rms in result['fields']:
+        lines.append('%-16s %-24s %8d %12.6g %12.6g' % (obj, label, n, dmax,
+            rms))
+
+    if result['tasks']:
+        lines.append('')
+        lines.append('%-24s %8s %10s %8s' % ('task CPU %', 'golden',
+            'candidate', 'change'))
+
+        for name, g, c in result['tasks']:
+            lines.append('%-24s %8.2f %10.2f %+8.2f' % (name, g, c, c - g))
+
+    lines.append('')
+    lines.append('identical' if result['identical'] else 'different')
+
+    return '\n'.join(lines)
@@ -352,28 +352,19 @@ class TelemetryBase(metaclass=ABCMeta):
 
         self._send(uavtalk.request_filedata(file_id, offset))
 
-    def save_object(self, obj, send_first=False):
-        if send_first:
-            self.send_object(obj, req_ack=True)
-
+    def _save_request(self, save_req):
         save_obj = self.uavo_defs.find_by_name('UAVO_ObjectPersistence')
 
-        save_req = save_obj._make_to_send(
-                Operation = save_obj.ENUM_Operation['Save'],
-                ObjectID = obj._id,
-                InstanceID = 0
-        )
-
         self.send_object(save_req, req_ack=True)
 
         for i in range(30):
             try:
                 lv = self.last_values[save_obj]
-                if lv.ObjectID == obj._id:
+                if lv.ObjectID == save_req.ObjectID:
                     if lv.Operation == save_obj.ENUM_Operation['Completed']:
                         return
 
-                    if lv.Operation != save_obj.ENUM_Operation['Save']:
+                    if lv.Operation != save_req.Operation:
                         raise Exception("Did not save successfully - bad status")
             except KeyError:
                 pass
@@ -382,9 +373,58 @@ class TelemetryBase(metaclass=ABCMeta):
 
         raise Exception("Did not save successfully - timeout")
 
-    def save_objects(self, objs, *arg, **kwargs):
-        for obj in objs:
-            self.save_object(obj, *arg, **kwargs)
+    def save_object(self, obj, send_first=False):
+        if send_first:
+            self.send_object(obj, req_ack=True)
+
+        save_obj = self.uavo_defs.find_by_name('UAVO_ObjectPersistence')
+
+        save_req = save_obj._make_to_send(
+                Operation = save_obj.ENUM_Operation['Save'],
+                ObjectID = obj._id,
+                InstanceID = 0
+        )
+
+        self._save_request(save_req)
+
+    def save_objects(self, objs, send_first=False):
+        """ Saves objects to flash, as few batches as the board allows.
+
+        Each batch is saved in one flash transaction, with one reply.
+        Falls back to saving them one at a time if the board's
+        ObjectPersistence has no batches.
+        """
+
+        save_obj = self.uavo_defs.find_by_name('UAVO_ObjectPersistence')
+
+        objs = list(objs)
+
+        if 'SaveBatch' not in save_obj.ENUM_Operation:
+            for obj in objs:
+                self.save_object(obj, send_first=send_first)
+
+            return
+
+        if send_first:
+            for obj in objs:
+                self.send_object(obj, req_ack=True)
+
+        batch_len = len(save_obj._make_to_send().BatchObjectID) + 1
+
+        for i in range(0, len(objs), batch_len):
+            batch = objs[i:i + batch_len]
+            rest = [ obj._id for obj in batch[1:] ]
+            pad = [ 0 ] * (batch_len - len(batch))
+
+            save_req = save_obj._make_to_send(
+                    Operation = save_obj.ENUM_Operation['SaveBatch'],
+                    ObjectID = batch[0]._id,
+                    InstanceID = 0,
+                    BatchObjectID = tuple(rest + pad),
+                    BatchInstanceID = (0,) * (batch_len - 1)
+            )
+
+            self._save_request(save_req)
 
     def transfer_file(self, file_id):
         with self.ack_cond:
@@ -0,0 +1,196 @@
+"""
+Decodes execution traces recorded by PIOS_Trace on the flight controller.
+
+A trace is either downloaded as a file (file id 0x100) or found in a log,
+where it is carried in file data packets.  It is converted into the Chrome
+trace event format, which both chrome://tracing and https://ui.perfetto.dev
+load directly.
+
+Copyright (C) 2017 dRonin, http://dronin.org
+
+Licensed under the GNU LGPL version 2.1 or any later version (see COPYING.LESSER)
+"""
+
+from struct import Struct
+
+from . import uavtalk
+
+__all__ = [ "TRACE_FILE_ID", "records", "from_log", "to_chrome" ]
+
+TRACE_FILE_ID = 0x100
+
+# Must match struct pios_trace_record in pios_trace.h
+record_fmt = Struct('<IBBHI')
+NAME_LEN = 16
+NO_TASK = 0xff
+
+# Track for interrupts, clear of task indices
+ISR_TID = 1000
+
+(HEADER, TASK_NAME, DROPPED, TASK_SWITCH, QUEUE_SEND, QUEUE_RECEIVE,
+        EVENT_BEGIN, EVENT_END, ISR_ENTER, ISR_EXIT,
+        SPAN_BEGIN, SPAN_END) = range(12)
+
+def records(data):
+    """Generator over the records of a raw trace.
+
+    Yields (time, type, task, cpu, arg, name) tuples, where name is only set
+    for TASK_NAME records.  A partial record at the end is ignored."""
+    offset = 0
+
+    while offset + record_fmt.size <= len(data):
+        time, typ, task, cpu, arg = record_fmt.unpack_from(data, offset)
+        offset += record_fmt.size
+
+        name = None
+
+        if typ == TASK_NAME:
+            if offset + NAME_LEN > len(data):
+                return
+
+            name = data[offset:offset + NAME_LEN].split(b'\0')[0]
+            name = name.decode('latin-1')
+            offset += NAME_LEN
+
+        yield (time, typ, task, cpu, arg, name)
+
+def from_log(file_obj):
+    """Pulls the traces out of a log.
+
+    Returns a list of raw traces, one per time logging was started."""
+    traces = []
+
+    def filedata(file_id, offset, eof, last_chunk, data):
+        if file_id != TRACE_FILE_ID:
+            return
+
+        if offset == 0 or not traces:
+            traces.append(b'')
+
+        traces[-1] += data
+
+    # Skip the header: signature, git hash and UAVO hash lines
+    for i in range(100):
+        sig = file_obj.readline()
+
+        if sig.endswith(b'git hash:\n'):
+            file_obj.readline()
+            file_obj.readline()
+            break
+        elif not sig:
+            break
+
+    parser = uavtalk.process_stream({}, filedata_callback=filedata)
+    parser.send(None)
+
+    while True:
+        buf = file_obj.read(524288)
+
+        if not buf:
+            break
+
+        parser.send(buf)
+
+    # Let it finish off what it has buffered
+    try:
+        parser.send(None)
+
+        while True:
+            next(parser)
+    except StopIteration:
+        pass
+
+    return traces
+
+def to_chrome(data, names=None):
+    """Converts a raw trace to a Chrome trace event dictionary.
+
+    Each task gets its own track.  Task switches become 'running' slices,
+    UAVO event dispatch and user spans become nested slices, and queue
+    operations and lost records are instant events.
+
+     - names: optional dict mapping object ids to UAVO names"""
+    events = []
+    task_names = {}
+    us_per_2_28 = 1 << 28
+    num_cpus = 1
+
+    # Raw times wrap at 32 bits; unwrap them assuming records are never
+    # further apart than half the wrap period.
+    last_raw = None
+    now = 0
+
+    running = {}
+
+    for (raw, typ, task, cpu, arg, name) in records(data):
+        if typ == HEADER:
+            us_per_2_28 = arg
+            num_cpus = cpu
+            continue
+
+        if typ == TASK_NAME:
+            task_names[task] = name
+            continue
+
+        if last_raw is None:
+            last_raw = raw
+
+        delta = ((raw - last_raw + (1 << 31)) & 0xffffffff) - (1 << 31)
+        last_raw = raw
+        now += delta
+
+        ts = now * us_per_2_28 / (1 << 28)
+
+        ev = { 'pid' : 0, 'tid' : task, 'ts' : ts }
+
+        if typ == TASK_SWITCH:
+            prev = running.get(cpu)
+
+            if prev is not None:
+                events.append({ 'pid' : 0, 'tid' : prev[0],
+                    'ts' : prev[1], 'dur' : ts - prev[1], 'ph' : 'X',
+                    'name' : 'running', 'args' : { 'cpu' : cpu } })
+
+            running[cpu] = (task, ts)
+            continue
+        elif typ in (EVENT_BEGIN, EVENT_END):
+            obj = names.get(arg) if names else None
+            ev['name'] = obj if obj else 'event 0x%08x' % (arg)
+            ev['cat'] = 'uavo'
+            ev['ph'] = 'B' if typ == EVENT_BEGIN else 'E'
+        elif typ in (SPAN_BEGIN, SPAN_END):
+            ev['name'] = 'span %d' % (arg)
+            ev['cat'] = 'user'
+            ev['ph'] = 'B' if typ == SPAN_BEGIN else 'E'
+        elif typ in (ISR_ENTER, ISR_EXIT):
+            ev['tid'] = ISR_TID
+            ev['name'] = 'irq %d' % (arg - 16) if arg >= 16 else 'exception %d' % (arg)
+            ev['cat'] = 'isr'
+            ev['ph'] = 'B' if typ == ISR_ENTER else 'E'
+        elif typ in (QUEUE_SEND, QUEUE_RECEIVE):
+            ev['name'] = 'send' if typ == QUEUE_SEND else 'receive'
+            ev['cat'] = 'queue'
+            ev['ph'] = 'i'
+            ev['s'] = 't'
+            ev['args'] = { 'queue' : '0x%08x' % (arg) }
+        elif typ == DROPPED:
+            ev['name'] = 'dropped'
+            ev['ph'] = 'i'
+            ev['s'] = 'g'
+            ev['args'] = { 'records' : arg, 'cpu' : cpu }
+        else:
+            continue
+
+        events.append(ev)
+
+    task_names.setdefault(NO_TASK, '(unknown)')
+
+    for task, name in task_names.items():
+        events.append({ 'pid' : 0, 'tid' : task, 'ph' : 'M',
+            'name' : 'thread_name', 'args' : { 'name' : name } })
+
+    events.append({ 'pid' : 0, 'tid' : ISR_TID, 'ph' : 'M',
+        'name' : 'thread_name', 'args' : { 'name' : 'Interrupts' } })
+
+    return { 'traceEvents' : events, 'displayTimeUnit' : 'ns',
+            'otherData' : { 'cpus' : num_cpus } }
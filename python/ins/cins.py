@@ -94,6 +94,23 @@ class CINS:
 
 		self.state = ins.correction(Z, sensors)
 
+	def run(self, times, gyros, accels, sensors=None, pos=None, vel=None, mag=None, baro=None):
+		""" Run predictions and corrections over whole time series at once
+
+		gyros, accels and any measurements have one row per time; sensors
+		holds the mask of measurements to correct with at each time, as in
+		correction().  Returns the state and covariance diagonal after each
+		step.
+		"""
+
+		history, variances = ins.run(times, gyros, accels, sensors,
+			mag=mag, pos=pos, vel=vel, baro=baro)
+
+		if len(history):
+			self.state = history[-1]
+
+		return history, variances
+
 def test():
 	""" test the INS with simulated data
 	"""
@@ -7,6 +7,11 @@
 
 #include <insgps.h>
 
+//! Elements of the state returned to python, see get_state
+#define NUM_STATE_OUT 16
+//! Variances, one per filter state
+#define NUM_VARIANCES 14
+
 int not_doublevector(PyArrayObject *vec)
 {
 	if (PyArray_TYPE(vec) != NPY_DOUBLE) {
@@ -91,23 +96,13 @@ static bool parseFloatVec3(PyArrayObject *vec_in, float *vec_out)
 }
 
 /**
- * pack_state put the state information into an array
+ * get_state copy the state information into 16 doubles
  */
-static PyObject*
-pack_state(PyObject* self)
+static void get_state(double *s)
 {
-	float pos[3], vel[3], q[4], gyro_bias[3], accel_bias[3];        
+	float pos[3], vel[3], q[4], gyro_bias[3], accel_bias[3];
 	INSGetState(pos, vel, q, gyro_bias, accel_bias);
 
-	const int N = 16;
-	int nd = 1;
-	int dims[1];
-	dims[0] = N;
-
-	PyArrayObject *state;
-	state = (PyArrayObject*) PyArray_FromDims(nd, dims, NPY_DOUBLE);
-	double *s = (double *) PyArray_DATA(state);
-
 	s[0] = pos[0];
 	s[1] = pos[1];
 	s[2] = pos[2];
@@ -124,8 +119,24 @@ pack_state(PyObject* self)
 	s[13] = accel_bias[0];
 	s[14] = accel_bias[1];
 	s[15] = accel_bias[2];
+}
 
-	return Py_BuildValue("O", state);
+/**
+ * pack_state put the state information into an array
+ */
+static PyObject*
+pack_state(PyObject* self)
+{
+	npy_intp dims[1] = { NUM_STATE_OUT };
+
+	PyArrayObject *state;
+	state = (PyArrayObject*) PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+	if (state == NULL)
+		return NULL;
+
+	get_state((double *) PyArray_DATA(state));
+
+	return (PyObject *) state;
 }
 
 /**
@@ -294,6 +305,199 @@ set_state(PyObject* self, PyObject* args, PyObject *kwarg)
 }
 
 
+/**
+ * batch_array(obj, name, type, cols, N, out)
+ *
+ * @param[in] obj the python object to convert, may be None
+ * @param[in] name of the argument, for errors
+ * @param[in] type numpy type to convert to
+ * @param[in] cols number of columns, or 0 for a vector
+ * @param[in,out] N number of rows, or -1 if not yet known
+ * @param[out] out contiguous array, or NULL if obj was None
+ * @return true if successful, false if not
+ *
+ * Convert one of the time series passed to run() to a C contiguous
+ * array of the expected shape, copying only if needed.
+ */
+static bool batch_array(PyObject *obj, const char *name, int type, int cols,
+		npy_intp *N, PyArrayObject **out)
+{
+	*out = NULL;
+
+	if (obj == NULL || obj == Py_None)
+		return true;
+
+	int nd = cols ? 2 : 1;
+	PyArrayObject *arr = (PyArrayObject *) PyArray_FROMANY(obj, type, nd, nd,
+			NPY_ARRAY_IN_ARRAY | NPY_ARRAY_FORCECAST);
+	if (arr == NULL)
+		return false;
+
+	if ((cols && PyArray_DIM(arr, 1) != cols) ||
+			(*N >= 0 && PyArray_DIM(arr, 0) != *N)) {
+		PyErr_Format(PyExc_ValueError, "%s has the wrong shape", name);
+		Py_DECREF(arr);
+		return false;
+	}
+
+	*N = PyArray_DIM(arr, 0);
+	*out = arr;
+
+	return true;
+}
+
+static void get_row3(PyArrayObject *arr, npy_intp i, float *out)
+{
+	const double *row = (const double *) PyArray_DATA(arr) + 3 * i;
+
+	out[0] = row[0];
+	out[1] = row[1];
+	out[2] = row[2];
+}
+
+/**
+ * run - run the EKF over whole time series
+ * @params[in] self
+ * @params[in] args
+ *  - t - time of each step (s)
+ *  - gyro - Nx3 rates (rad/s)
+ *  - accel - Nx3 accelerations (m/s^2)
+ *  - sensors - flags for which sensors to correct with at each step
+ *  - mag, pos, vel - Nx3 measurements, needed if sensors uses them
+ *  - baro - barometric altitudes, needed if sensors uses them
+ * @return (states, variances) - Nx16 state after each step, and Nx14
+ * diagonal of the covariance
+ *
+ * Each step predicts from the previous one, then corrects.  The filter
+ * starts from its current state, so init(), configure() and set_state()
+ * are used first as for single steps.  The GIL is released while running;
+ * the filter state is per thread, so separate threads can run their own.
+ */
+static PyObject*
+run(PyObject* self, PyObject* args, PyObject *kwarg)
+{
+	static char *kwlist[] = {"t", "gyro", "accel", "sensors", "mag", "pos", "vel", "baro", NULL};
+
+	PyObject *t_obj, *gyro_obj, *accel_obj;
+	PyObject *sensors_obj = NULL, *mag_obj = NULL, *pos_obj = NULL, *vel_obj = NULL, *baro_obj = NULL;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwarg, "OOO|OOOOO", kwlist,
+		 &t_obj, &gyro_obj, &accel_obj, &sensors_obj, &mag_obj, &pos_obj,
+		 &vel_obj, &baro_obj)) {
+		return NULL;
+	}
+
+	PyArrayObject *t = NULL, *gyro = NULL, *accel = NULL, *sensors = NULL;
+	PyArrayObject *mag = NULL, *pos = NULL, *vel = NULL, *baro = NULL;
+	PyArrayObject *states = NULL, *variances = NULL;
+	PyObject *result = NULL;
+	npy_intp N = -1;
+
+	if (!batch_array(t_obj, "t", NPY_DOUBLE, 0, &N, &t) ||
+			!batch_array(gyro_obj, "gyro", NPY_DOUBLE, 3, &N, &gyro) ||
+			!batch_array(accel_obj, "accel", NPY_DOUBLE, 3, &N, &accel) ||
+			!batch_array(sensors_obj, "sensors", NPY_INT, 0, &N, &sensors) ||
+			!batch_array(mag_obj, "mag", NPY_DOUBLE, 3, &N, &mag) ||
+			!batch_array(pos_obj, "pos", NPY_DOUBLE, 3, &N, &pos) ||
+			!batch_array(vel_obj, "vel", NPY_DOUBLE, 3, &N, &vel) ||
+			!batch_array(baro_obj, "baro", NPY_DOUBLE, 0, &N, &baro))
+		goto out;
+
+	if (t == NULL || gyro == NULL || accel == NULL) {
+		PyErr_SetString(PyExc_ValueError, "t, gyro and accel are required");
+		goto out;
+	}
+
+	const int *sensors_used = sensors ? (const int *) PyArray_DATA(sensors) : NULL;
+
+	if (sensors_used) {
+		int all_used = 0;
+
+		for (npy_intp i = 0; i < N; i++)
+			all_used |= sensors_used[i];
+
+		if (((all_used & MAG_SENSORS) && !mag) ||
+				((all_used & POS_SENSORS) && !pos) ||
+				((all_used & (HORIZ_VEL_SENSORS | VERT_VEL_SENSORS)) && !vel) ||
+				((all_used & BARO_SENSOR) && !baro)) {
+			PyErr_SetString(PyExc_ValueError, "sensors uses a measurement that wasn't passed");
+			goto out;
+		}
+	}
+
+	npy_intp dims[2] = { N, NUM_STATE_OUT };
+	states = (PyArrayObject *) PyArray_SimpleNew(2, dims, NPY_DOUBLE);
+	dims[1] = NUM_VARIANCES;
+	variances = (PyArrayObject *) PyArray_SimpleNew(2, dims, NPY_DOUBLE);
+
+	if (states == NULL || variances == NULL)
+		goto out;
+
+	const double *time = (const double *) PyArray_DATA(t);
+	double *state_out = (double *) PyArray_DATA(states);
+	double *var_out = (double *) PyArray_DATA(variances);
+
+	Py_BEGIN_ALLOW_THREADS
+
+	for (npy_intp i = 0; i < N; i++) {
+		float dT = i > 0 ? time[i] - time[i - 1] : 0;
+
+		if (dT > 0) {
+			float gyro_data[3], accel_data[3];
+
+			get_row3(gyro, i, gyro_data);
+			get_row3(accel, i, accel_data);
+
+			INSStatePrediction(gyro_data, accel_data, dT);
+			INSCovariancePrediction(dT);
+		}
+
+		if (sensors_used && sensors_used[i]) {
+			float mag_data[3] = {0, 0, 0};
+			float pos_data[3] = {0, 0, 0};
+			float vel_data[3] = {0, 0, 0};
+			float baro_alt = 0;
+
+			if (mag)
+				get_row3(mag, i, mag_data);
+			if (pos)
+				get_row3(pos, i, pos_data);
+			if (vel)
+				get_row3(vel, i, vel_data);
+			if (baro)
+				baro_alt = ((const double *) PyArray_DATA(baro))[i];
+
+			INSCorrection(mag_data, pos_data, vel_data, baro_alt, sensors_used[i]);
+		}
+
+		float var[NUM_VARIANCES];
+		INSGetVariance(var);
+
+		get_state(state_out + i * NUM_STATE_OUT);
+
+		for (int j = 0; j < NUM_VARIANCES; j++)
+			var_out[i * NUM_VARIANCES + j] = var[j];
+	}
+
+	Py_END_ALLOW_THREADS
+
+	result = Py_BuildValue("OO", states, variances);
+
+out:
+	Py_XDECREF(t);
+	Py_XDECREF(gyro);
+	Py_XDECREF(accel);
+	Py_XDECREF(sensors);
+	Py_XDECREF(mag);
+	Py_XDECREF(pos);
+	Py_XDECREF(vel);
+	Py_XDECREF(baro);
+	Py_XDECREF(states);
+	Py_XDECREF(variances);
+
+	return result;
+}
+
 static PyObject*
 init(PyObject* self, PyObject* args)
 {
@@ -312,9 +516,26 @@ static PyMethodDef InsMethods[] =
 	{"correction", correction, METH_VARARGS, "Apply state correction based on measured sensors."},
 	{"configure", (PyCFunction)configure, METH_VARARGS|METH_KEYWORDS, "Configure EKF parameters."},
 	{"set_state", (PyCFunction)set_state, METH_VARARGS|METH_KEYWORDS, "Set the EKF state."},
+	{"run", (PyCFunction)run, METH_VARARGS|METH_KEYWORDS, "Run the EKF over whole time series."},
 	{NULL, NULL, 0, NULL}
 };
  
+#if PY_MAJOR_VERSION >= 3
+static struct PyModuleDef ins_module =
+{
+	PyModuleDef_HEAD_INIT, "ins", NULL, -1, InsMethods
+};
+
+PyMODINIT_FUNC
+PyInit_ins(void)
+{
+	PyObject *module = PyModule_Create(&ins_module);
+	import_array();
+	init(NULL, NULL);
+	INSGPSInit();
+	return module;
+}
+#else
 PyMODINIT_FUNC
 initins(void)
 {
@@ -323,3 +544,4 @@ initins(void)
 	init(NULL, NULL);
 	INSGPSInit();
 }
+#endif
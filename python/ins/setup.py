@@ -4,6 +4,7 @@ import numpy
 module1 = Extension('ins',
 	sources = ['insmodule.c', '../../flight/Libraries/insgps14state.c'],
 	            include_dirs=['../../flight/Libraries/inc','../../shared/api',numpy.get_include()],
+                    define_macros=[('INSGPS_STATE', '__thread')],
                     extra_compile_args=['-std=gnu99'],)
  
 setup (name = 'PackageName',
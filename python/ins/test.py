@@ -865,6 +865,52 @@ class SimulatedFlightTests(unittest.TestCase):
 
         return sim.state, history, times
 
+class BatchTestFunctions(unittest.TestCase):
+
+    def setUp(self):
+        self.sim = CINS()
+        self.sim.prepare()
+
+    def test_batch_matches_steps(self, STEPS=20000):
+        """ check running a whole series gives exactly what stepping does
+        """
+
+        numpy.random.seed(1)
+
+        dT = 1.0 / 666.0
+        times = numpy.arange(STEPS) * dT
+
+        gyros = numpy.random.randn(STEPS, 3) * 1e-2
+        accels = numpy.random.randn(STEPS, 3) * 1e-1 + [0, 0, -CINS.GRAV]
+        mag = numpy.random.randn(STEPS, 3) + [400, 0, 1600]
+        pos = numpy.random.randn(STEPS, 3)
+        vel = numpy.random.randn(STEPS, 3) * 1e-1
+        baro = numpy.random.randn(STEPS)
+
+        sensors = numpy.zeros(STEPS, dtype=int)
+        sensors[::20] |= 0x01C0
+        sensors[::60] |= 0x003B | 0x0200
+
+        history, variances = self.sim.run(times, gyros, accels, sensors,
+            pos=pos, vel=vel, mag=mag, baro=baro)
+
+        self.assertEqual(history.shape, (STEPS, 16))
+        self.assertEqual(variances.shape, (STEPS, 14))
+
+        sim = self.sim
+        sim.prepare()
+
+        for k in range(STEPS):
+            if k > 0:
+                sim.predict(gyros[k], accels[k], dT=times[k] - times[k-1])
+
+            if sensors[k]:
+                Z = numpy.concatenate((pos[k], vel[k], mag[k], [baro[k]]))
+                sim.state = ins.correction(Z, int(sensors[k]))
+
+            if k % 1000 == 0 or k == STEPS - 1:
+                numpy.testing.assert_array_equal(sim.state, history[k])
+
 if __name__ == '__main__':
     selected_test = None
 
@@ -5,7 +5,7 @@ https://github.com/pypa/sampleproject
 """
 
 # Always prefer setuptools over distutils
-from setuptools import setup, find_packages
+from setuptools import setup, find_packages, Extension
 # To use a consistent encoding
 from codecs import open
 from os import path
@@ -14,6 +14,23 @@ here = path.abspath(path.dirname(__file__))
 with open(path.join(here, 'README.rst'), encoding='utf-8') as f:
     long_description = f.read()
 
+ext_modules = []
+
+try:
+    import numpy
+    import sys
+
+    # The native log decoder is optional; without it logs are still read
+    # in pure python.
+    ext_modules.append(Extension('dronin._logdecode',
+        sources=['dronin/_logdecode.c'],
+        include_dirs=[numpy.get_include()],
+        extra_compile_args=[] if sys.platform == 'win32' else ['-std=gnu99'],
+        extra_link_args=[] if sys.platform == 'win32' else ['-pthread'],
+        optional=True))
+except ImportError:
+    pass
+
 long_description = """
 This is the dRonin UAVTalk API.  With these modules, it is possible to
 communicate with dRonin flight controllers and interpret log files and
@@ -74,6 +91,8 @@ setup(
     # simple. Or you can use find_packages().
     packages = ['dronin', 'dronin.logviewer'],
 
+    ext_modules = ext_modules,
+
     # Just requires the base python system to run
     install_requires=[],
 
@@ -85,7 +104,8 @@ setup(
 
     scripts = [ 'dronin-dumplog', 'dronin-halt',
         'dronin-getconfig', 'dronin-logfsimport',
-        'dronin-shell' ],
+        'dronin-shell', 'dronin-trace', 'dronin-export',
+        'dronin-replay', 'dronin-connbench' ],
 #    package_data={
 #        'sample': ['package_data.dat'],
 #    },